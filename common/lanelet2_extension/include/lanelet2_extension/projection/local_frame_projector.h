@@ -22,6 +22,7 @@
 #include <proj.h>
 #include <lanelet2_io/Projection.h>
 
+#include <memory>
 #include <string>
 
 namespace lanelet
@@ -59,12 +60,28 @@ public:
    */
   GPSPoint reverse(const BasicPoint3d& p) const override;
 
+  /**
+   * [LocalFrameProjector::isThreadSafe every thread projects with its own PROJ context]
+   * @return [true]
+   */
+  bool isThreadSafe() const override
+  {
+    return true;
+  }
+
   // The PROJ string used to define a WGS-84 ECEF frame
   static constexpr char ECEF_PROJ_STR[] = "+proj=geocent +ellps=WGS84 +datum=WGS84 +units=m +no_defs";
 
 private:
-  
-  PJ *P_;
+  // PROJ objects of one thread
+  struct ThreadProjection;
+
+  // PROJ objects of every thread that used this projector (or a copy of it)
+  struct ThreadProjections;
+
+  ThreadProjection& threadProjection() const;
+
+  std::shared_ptr<ThreadProjections> projections_;
 
   const std::string map_proj_string_;
 
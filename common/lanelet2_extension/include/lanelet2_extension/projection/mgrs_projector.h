@@ -24,6 +24,7 @@
 #include <lanelet2_io/Exceptions.h>
 #include <lanelet2_io/Projection.h>
 
+#include <mutex>
 #include <string>
 
 namespace lanelet
@@ -90,6 +91,7 @@ public:
    */
   std::string getProjectedMGRSGrid() const
   {
+    std::lock_guard<std::mutex> lock(projected_grid_mutex_);
     return projected_grid_;
   };
 
@@ -102,6 +104,15 @@ public:
     return !mgrs_code_.empty();
   };
 
+  /**
+   * [isThreadSafe forward only shares projected_grid_, which is locked]
+   * @return [true]
+   */
+  bool isThreadSafe() const override
+  {
+    return true;
+  }
+
 private:
   /**
    * mgrs grid code used for reverse function
@@ -113,6 +124,7 @@ private:
    * reverse function will use this if isMGRSCodeSet() returns false.
    */
   mutable std::string projected_grid_;
+  mutable std::mutex projected_grid_mutex_;
 };
 
 }  // namespace projection
@@ -17,8 +17,13 @@
  */
 
 #include <lanelet2_extension/projection/local_frame_projector.h>
+#include <atomic>
 #include <iostream>
+#include <limits>
 #include <math.h>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace lanelet
 {
@@ -31,23 +36,84 @@ namespace projection
 constexpr char LocalFrameProjector::ECEF_PROJ_STR[];  // instantiate string in cpp file
 #endif
 
-LocalFrameProjector::LocalFrameProjector(const char* projection_string, Origin origin) : Projector(origin), map_proj_string_(projection_string)
+struct LocalFrameProjector::ThreadProjection
+{
+  PJ_CONTEXT* context = nullptr;
+  PJ* map_proj = nullptr;
+  PJ* ecef_in_map_proj = nullptr;  // created by the first projectECEF call of the thread
+};
+
+struct LocalFrameProjector::ThreadProjections
+{
+  ThreadProjections() : id(next_id++)
+  {
+  }
+
+  ~ThreadProjections()
+  {
+    for (auto& thread_projection : per_thread)
+    {
+      if (thread_projection.second.ecef_in_map_proj)
+        proj_destroy(thread_projection.second.ecef_in_map_proj);
+      if (thread_projection.second.map_proj)
+        proj_destroy(thread_projection.second.map_proj);
+      proj_context_destroy(thread_projection.second.context);
+    }
+  }
+
+  static std::atomic<uint64_t> next_id;
+
+  // Never reused, so that a thread cannot mistake a new projector for a destroyed one
+  const uint64_t id;
+
+  std::mutex mutex;
+  std::unordered_map<std::thread::id, ThreadProjection> per_thread;
+};
+
+std::atomic<uint64_t> LocalFrameProjector::ThreadProjections::next_id(0);
+
+LocalFrameProjector::LocalFrameProjector(const char* projection_string, Origin origin)
+  : Projector(origin), projections_(std::make_shared<ThreadProjections>()), map_proj_string_(projection_string)
 {
-  P_ = proj_create(PJ_DEFAULT_CTX, map_proj_string_.c_str());
+}
+
+LocalFrameProjector::ThreadProjection& LocalFrameProjector::threadProjection() const
+{
+  // Most calls come from the thread that used the same projector last
+  thread_local uint64_t last_id = std::numeric_limits<uint64_t>::max();
+  thread_local ThreadProjection* last_projection = nullptr;
+
+  if (last_id == projections_->id)
+    return *last_projection;
+
+  std::lock_guard<std::mutex> lock(projections_->mutex);
+  ThreadProjection& projection = projections_->per_thread[std::this_thread::get_id()];
+  if (!projection.context)
+  {
+    projection.context = proj_context_create();
+    projection.map_proj = proj_create(projection.context, map_proj_string_.c_str());
+  }
+
+  last_id = projections_->id;
+  last_projection = &projection;
+  return projection;
 }
 
 BasicPoint3d LocalFrameProjector::forward(const GPSPoint& p) const
 {
   static constexpr double DEG2RAD =  M_PI/180.0; 
   PJ_COORD c{{p.lon * DEG2RAD, p.lat * DEG2RAD, p.ele}};
-  PJ_COORD c_out = proj_trans(P_, PJ_FWD, c);
+  PJ_COORD c_out = proj_trans(threadProjection().map_proj, PJ_FWD, c);
   return BasicPoint3d{c_out.xyz.x, c_out.xyz.y, c_out.xyz.z};
 }
 
 BasicPoint3d LocalFrameProjector::projectECEF(const BasicPoint3d& p, const int& proj_dir) const
 {
-  static PJ* ecef_in_map_proj = proj_create_crs_to_crs(PJ_DEFAULT_CTX, map_proj_string_.c_str(), ECEF_PROJ_STR, NULL);
-  
+  ThreadProjection& projection = threadProjection();
+  if (!projection.ecef_in_map_proj)
+    projection.ecef_in_map_proj = proj_create_crs_to_crs(projection.context, map_proj_string_.c_str(), ECEF_PROJ_STR, NULL);
+  PJ* ecef_in_map_proj = projection.ecef_in_map_proj;
+
   PJ_COORD c{{p[0], p[1], p[2], 0}};
   PJ_COORD c_out;
 
@@ -68,7 +134,7 @@ GPSPoint LocalFrameProjector::reverse(const BasicPoint3d& p) const
 {
   static constexpr double RAD2DEG = 180.0/M_PI;
   PJ_COORD c{{p[0], p[1], p[2], 0}};
-  PJ_COORD c_out = proj_trans(P_, PJ_INV, c);
+  PJ_COORD c_out = proj_trans(threadProjection().map_proj, PJ_INV, c);
 
   return GPSPoint{c_out.lpz.phi * RAD2DEG, c_out.lpz.lam * RAD2DEG, c_out.lpz.z};
 }
@@ -39,8 +39,6 @@ BasicPoint3d MGRSProjector::forward(const GPSPoint& gps) const
 
 BasicPoint3d MGRSProjector::forward(const GPSPoint& gps, const int precision) const
 {
-  std::string prev_projected_grid = projected_grid_;
-
   BasicPoint3d mgrs_point{ 0., 0., gps.ele };
   BasicPoint3d utm_point{ 0., 0., gps.ele };
   int zone;
@@ -61,9 +59,14 @@ BasicPoint3d MGRSProjector::forward(const GPSPoint& gps, const int precision) co
   // get mgrs values from utm values
   mgrs_point.x() = fmod(utm_point.x(), 1e5);
   mgrs_point.y() = fmod(utm_point.y(), 1e5);
-  projected_grid_ = mgrs_code;
+  std::string prev_projected_grid;
+  {
+    std::lock_guard<std::mutex> lock(projected_grid_mutex_);
+    prev_projected_grid = projected_grid_;
+    projected_grid_ = mgrs_code;
+  }
 
-  if (!prev_projected_grid.empty() && prev_projected_grid != projected_grid_)
+  if (!prev_projected_grid.empty() && prev_projected_grid != mgrs_code)
   {
     ROS_ERROR_STREAM("Projected MGRS Grid changed from last projection. Projected point "
                      "might be far away from previously projected point."
@@ -77,14 +80,15 @@ BasicPoint3d MGRSProjector::forward(const GPSPoint& gps, const int precision) co
 GPSPoint MGRSProjector::reverse(const BasicPoint3d& mgrs_point) const
 {
   GPSPoint gps{ 0., 0., 0. };
+  std::string projected_grid = getProjectedMGRSGrid();
   // reverse function cannot be used if mgrs_code_ is not set
   if (isMGRSCodeSet())
   {
     gps = reverse(mgrs_point, mgrs_code_);
   }
-  else if (!projected_grid_.empty())
+  else if (!projected_grid.empty())
   {
-    gps = reverse(mgrs_point, projected_grid_);
+    gps = reverse(mgrs_point, projected_grid);
   }
   else
   {
@@ -24,6 +24,8 @@
  * Kyle Rush<kyle.rush@leidos.com> 3/11/2020 
  */
 
+#include <lanelet2_core/geometry/BoundingBox.h>
+#include <lanelet2_core/geometry/Lanelet.h>
 #include <lanelet2_core/geometry/LineString.h>
 #include <lanelet2_core/primitives/BasicRegulatoryElements.h>
 #include <lanelet2_traffic_rules/TrafficRules.h>
@@ -139,8 +141,7 @@ void removeImpossibleCandidates(const lanelet::LaneletMapPtr lanelet_map,
  * @param  trafficRules  [traffic rules to ignore lanelets that are not
  * traversible]
  * @param  search_point  [2D point used for searching]
- * @param  search_n      [initial guess used for findNearest function (default
- * 5)]
+ * @param  search_n      [expected number of contacting lanelets (default 5)]
  * @param  contacting_lanelet_ids [array of lanelet ids that is contacting with
  * search_point]
  */
@@ -161,44 +162,23 @@ void getContactingLanelets(const lanelet::LaneletMapPtr lanelet_map,
     return;
   }
 
-  int n = search_n;
-  double max_distance = 0.0;
-  const int increment = 3;
   const double epsilon = 1e-6;
-  std::vector<std::pair<double, lanelet::Lanelet> > actuallyNearestLanelets;
+  contacting_lanelet_ids->reserve(search_n);
 
-  // keep searching nearest lanelet as long as all retrieved lanelet has
-  // distance == 0m.
-  while (max_distance < epsilon)
-  {
-    actuallyNearestLanelets = lanelet::geometry::findNearest(lanelet_map->laneletLayer, search_point, n);
-    max_distance = 0.0;
-    for (auto const& item : actuallyNearestLanelets)
-    {
-      if (item.first > max_distance)
-      {
-        max_distance = item.first;
-      }
-    }
-
-    // exit loop if all lanelets in the map intersects with the waypoint,
-    // e.g. when there is only one lanelet in the map.
-    if (actuallyNearestLanelets.size() < n)
-    {
-      break;
-    }
-
-    n += increment;
-  }
-
-  contacting_lanelet_ids->reserve(n - increment);
-  for (auto const& item : actuallyNearestLanelets)
-  {
-    if (item.first < epsilon && traffic_rules->canPass(item.second))
-    {
-      contacting_lanelet_ids->push_back(item.second.id());
-    }
-  }
+  // the lanelets come by increasing distance of their bounding boxes, so all contacting lanelets have been seen once
+  // a bounding box is farther away than epsilon.
+  lanelet_map->laneletLayer.nearestUntil(
+      search_point, [&](const lanelet::BoundingBox2d& box, const lanelet::Lanelet& lanelet) {
+        if (lanelet::geometry::distance(box, search_point) >= epsilon)
+        {
+          return true;
+        }
+        if (lanelet::geometry::distance2d(lanelet, search_point) < epsilon && traffic_rules->canPass(lanelet))
+        {
+          contacting_lanelet_ids->push_back(lanelet.id());
+        }
+        return false;
+      });
 }
 
 std::vector<double> calculateSegmentDistances(const lanelet::ConstLineString3d& line_string)
@@ -19,6 +19,9 @@
 #include <gtest/gtest.h>
 #include <math.h>
 
+#include <thread>
+#include <vector>
+
 #include <lanelet2_extension/projection/local_frame_projector.h>
 
 TEST(LocalProjector, ForwardProjection)
@@ -53,3 +56,46 @@ TEST(LocalProjector, ReverseProjection)
   ASSERT_DOUBLE_EQ(gps_point.lon, -77.14835128349988);
   ASSERT_DOUBLE_EQ(gps_point.ele, local_point.z());
 }
+
+TEST(LocalProjector, ConcurrentForwardProjection)
+{
+  std::string map_frame = "+proj=tmerc +lat_0=38.95197911150576 +lon_0=-77.14835128349988 +k=1 +x_0=0 +y_0=0 +datum=WGS84 +units=m +vunits=m +no_defs";
+  lanelet::projection::LocalFrameProjector projector(map_frame.c_str());
+  ASSERT_TRUE(projector.isThreadSafe());
+
+  std::vector<lanelet::GPSPoint> gps_points;
+  for (int i = 0; i < 4000; i++)
+    gps_points.push_back(lanelet::GPSPoint{ 38.95 + 1e-5 * i, -77.15 + 2e-5 * (i % 100), 51.6 });
+
+  std::vector<lanelet::BasicPoint3d> expected;
+  for (const auto& gps_point : gps_points)
+    expected.push_back(projector.forward(gps_point));
+
+  // Every thread projects all the points and a round trip through ECEF
+  const int thread_num = 4;
+  std::vector<std::vector<lanelet::BasicPoint3d>> results(thread_num);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; t++)
+  {
+    threads.emplace_back([&, t]() {
+      for (const auto& gps_point : gps_points)
+      {
+        lanelet::BasicPoint3d local_point = projector.forward(gps_point);
+        results[t].push_back(projector.projectECEF(projector.projectECEF(local_point, 1), -1));
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  for (int t = 0; t < thread_num; t++)
+  {
+    ASSERT_EQ(expected.size(), results[t].size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+      ASSERT_NEAR(expected[i].x(), results[t][i].x(), 1e-6);
+      ASSERT_NEAR(expected[i].y(), results[t][i].y(), 1e-6);
+      ASSERT_NEAR(expected[i].z(), results[t][i].z(), 1e-6);
+    }
+  }
+}
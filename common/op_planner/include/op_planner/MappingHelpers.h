@@ -151,6 +151,14 @@ public:
 	static WayPoint* FindWaypoint(const int& id, RoadNetwork& map);
 	static WayPoint* FindWaypointV2(const int& id, const int& l_id, RoadNetwork& map);
 
+	//Must be called again after any change to the lanes or waypoints of the map, the index points into them
+	static void BuildRoadNetworkIndex(RoadNetwork& map);
+	//False for a copy of the map or when roadSegments was reallocated, other changes are not detected
+	static bool IsRoadNetworkIndexed(const RoadNetwork& map);
+	static void GetIndexedPointsWithinDistance(const WayPoint& pos, const RoadNetwork& map, const double& distance, std::vector<int>& points_indices);
+	static void GetLanesWithinDistance(const WayPoint& pos, RoadNetwork& map, const double& distance, std::vector<std::pair<double, Lane*> >& lanes_list, std::vector<int>& closest_indices);
+	static Lane* GetClosestLaneFromMapIncreasingDistance(const WayPoint& pos, RoadNetwork& map, const bool bDirectionBased = true);
+
 	static std::vector<Curb> GetCurbsList(TiXmlElement* pElem);
 	static std::vector<Boundary> GetBoundariesList(TiXmlElement* pElem);
 	static std::vector<Marking> GetMarkingsList(TiXmlElement* pElem);
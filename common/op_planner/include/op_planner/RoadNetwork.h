@@ -11,6 +11,8 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <unordered_map>
+#include <utility>
 #include "op_utility/UtilityH.h"
 
 #define OPENPLANNER_ENABLE_LOGS
@@ -749,6 +751,30 @@ public:
 
 };
 
+//Waypoints and lanes of a RoadNetwork indexed by id, and waypoints binned in square cells for closest lane queries.
+//Built by MappingHelpers::BuildRoadNetworkIndex when the map is loaded.
+//The index holds pointers to the lanes and waypoints of the map. Any change to the lanes or waypoints after
+//BuildRoadNetworkIndex (adding or removing them, changing their ids or positions) requires calling it again.
+//Only a reallocation of roadSegments itself is detected, and then the queries fall back to the linear scans.
+class RoadNetworkIndex
+{
+public:
+	std::vector<WayPoint*> points; //waypoints of all the lanes in map order
+	std::vector<Lane*> pointLanes; //lane of each waypoint
+	std::vector<int> pointLaneOrders; //order of the lane of each waypoint in the map
+	std::vector<std::pair<long long, int> > cells; //(cell key, index in points) sorted
+	double cellSize;
+	std::unordered_map<int, int> waypoints; //index in points of the first waypoint of each id in map order
+	std::unordered_map<int, Lane*> lanes; //first lane of each id in map order
+	const RoadSegment* pRoadSegments; //roadSegments the index was built for, so that a copy of the map doesn't use it
+
+	RoadNetworkIndex()
+	{
+		cellSize = 10;
+		pRoadSegments = 0;
+	}
+};
+
 class RoadNetwork
 {
 public:
@@ -760,6 +786,7 @@ public:
 	std::vector<Crossing> crossings;
 	std::vector<Marking> markings;
 	std::vector<TrafficSign> signs;
+	RoadNetworkIndex index;
 };
 
 class VehicleState : public ObjTimeStamp
@@ -13,6 +13,8 @@
 
 #include "math.h"
 #include <fstream>
+#include <algorithm>
+#include <climits>
 
 using namespace UtilityHNS;
 using namespace std;
@@ -49,6 +51,12 @@ GPSPoint MappingHelpers::GetTransformationOrigin(const int& bToyotaCityMap)
 
 Lane* MappingHelpers::GetLaneById(const int& id,RoadNetwork& map)
 {
+	if(IsRoadNetworkIndexed(map))
+	{
+		std::unordered_map<int, Lane*>::const_iterator it = map.index.lanes.find(id);
+		return it != map.index.lanes.end() ? it->second : nullptr;
+	}
+
 	for(unsigned int rs = 0; rs < map.roadSegments.size(); rs++)
 	{
 		for(unsigned int i =0; i < map.roadSegments.at(rs).Lanes.size(); i++)
@@ -109,6 +117,7 @@ void MappingHelpers::ConstructRoadNetworkFromROSMessage(const std::vector<Utilit
 		const GPSPoint& origin, RoadNetwork& map, const bool& bSpecialFlag,
 		const bool& bFindLaneChangeLanes, const bool& bFindCurbsAndWayArea)
 {
+	map.index = RoadNetworkIndex(); //built again once the lanes are in the map
 	vector<Lane> roadLanes;
 	Lane lane_obj;
 	int laneIDSeq = 0;
@@ -441,6 +450,9 @@ void MappingHelpers::ConstructRoadNetworkFromROSMessage(const std::vector<Utilit
 	ExtractStopLinesData(stop_line_data, line_data, points_data, origin, map);
 
 
+	//Index lanes and waypoints
+	BuildRoadNetworkIndex(map);
+
 	//Link waypoints
 	LinkMissingBranchingWayPoints(map);
 
@@ -481,6 +493,12 @@ void MappingHelpers::AssignActionCostToLane(Lane* pL, ACTION_TYPE action, double
 
 WayPoint* MappingHelpers::FindWaypoint(const int& id, RoadNetwork& map)
 {
+	if(IsRoadNetworkIndexed(map))
+	{
+		std::unordered_map<int, int>::const_iterator it = map.index.waypoints.find(id);
+		return it != map.index.waypoints.end() ? map.index.points.at(it->second) : nullptr;
+	}
+
 	for(unsigned int rs = 0; rs < map.roadSegments.size(); rs++)
 	{
 		for(unsigned int i =0; i < map.roadSegments.at(rs).Lanes.size(); i++)
@@ -498,6 +516,16 @@ WayPoint* MappingHelpers::FindWaypoint(const int& id, RoadNetwork& map)
 
 WayPoint* MappingHelpers::FindWaypointV2(const int& id, const int& l_id, RoadNetwork& map)
 {
+	if(IsRoadNetworkIndexed(map))
+	{
+		//the first waypoint with this id is the answer unless it is in the excluded lane
+		std::unordered_map<int, int>::const_iterator it = map.index.waypoints.find(id);
+		if(it == map.index.waypoints.end())
+			return nullptr;
+		if(map.index.pointLanes.at(it->second)->id != l_id)
+			return map.index.points.at(it->second);
+	}
+
 	for(unsigned int rs = 0; rs < map.roadSegments.size(); rs++)
 	{
 		for(unsigned int i =0; i < map.roadSegments.at(rs).Lanes.size(); i++)
@@ -517,6 +545,196 @@ WayPoint* MappingHelpers::FindWaypointV2(const int& id, const int& l_id, RoadNet
 	return nullptr;
 }
 
+static long long GetRoadNetworkIndexCellKey(const long long& cell_x, const long long& cell_y)
+{
+	return (long long)(((unsigned long long)(unsigned int)cell_x << 32) | (unsigned int)cell_y);
+}
+
+void MappingHelpers::BuildRoadNetworkIndex(RoadNetwork& map)
+{
+	map.index = RoadNetworkIndex();
+	int lane_order = 0;
+	for(unsigned int rs = 0; rs < map.roadSegments.size(); rs++)
+	{
+		for(unsigned int i =0; i < map.roadSegments.at(rs).Lanes.size(); i++)
+		{
+			Lane* pLane = &map.roadSegments.at(rs).Lanes.at(i);
+			map.index.lanes.insert(make_pair(pLane->id, pLane));
+			for(unsigned int p= 0; p < pLane->points.size(); p++)
+			{
+				WayPoint* pWP = &pLane->points.at(p);
+				map.index.waypoints.insert(make_pair(pWP->id, (int)map.index.points.size()));
+				if(!std::isnan(pWP->pos.x) && !std::isnan(pWP->pos.y))
+				{
+					long long cell_key = GetRoadNetworkIndexCellKey(floor(pWP->pos.x/map.index.cellSize), floor(pWP->pos.y/map.index.cellSize));
+					map.index.cells.push_back(make_pair(cell_key, (int)map.index.points.size()));
+				}
+
+				map.index.points.push_back(pWP);
+				map.index.pointLanes.push_back(pLane);
+				map.index.pointLaneOrders.push_back(lane_order);
+			}
+			lane_order++;
+		}
+	}
+
+	std::sort(map.index.cells.begin(), map.index.cells.end());
+	map.index.pRoadSegments = map.roadSegments.data();
+}
+
+bool MappingHelpers::IsRoadNetworkIndexed(const RoadNetwork& map)
+{
+	return map.index.pRoadSegments != 0 && map.index.pRoadSegments == map.roadSegments.data() && map.roadSegments.size() > 0;
+}
+
+void MappingHelpers::GetIndexedPointsWithinDistance(const WayPoint& pos, const RoadNetwork& map, const double& distance, std::vector<int>& points_indices)
+{
+	points_indices.clear();
+	double min_x = floor((pos.pos.x - distance)/map.index.cellSize);
+	double max_x = floor((pos.pos.x + distance)/map.index.cellSize);
+	double min_y = floor((pos.pos.y - distance)/map.index.cellSize);
+	double max_y = floor((pos.pos.y + distance)/map.index.cellSize);
+	double nCells = (max_x - min_x + 1) * (max_y - min_y + 1);
+
+	//visiting the cells costs more than checking all the points for a large distance (or NaN position)
+	if(!(nCells <= map.index.cells.size()))
+	{
+		for(unsigned int i = 0; i < map.index.points.size(); i++)
+		{
+			if(distance2points(map.index.points.at(i)->pos, pos.pos) <= distance)
+				points_indices.push_back(i);
+		}
+		return;
+	}
+
+	for(long long cell_x = min_x; cell_x <= max_x; cell_x++)
+	{
+		for(long long cell_y = min_y; cell_y <= max_y; cell_y++)
+		{
+			long long cell_key = GetRoadNetworkIndexCellKey(cell_x, cell_y);
+			std::vector<std::pair<long long, int> >::const_iterator it = std::lower_bound(map.index.cells.begin(), map.index.cells.end(), make_pair(cell_key, INT_MIN));
+			for(; it != map.index.cells.end() && it->first == cell_key; it++)
+			{
+				if(distance2points(map.index.points.at(it->second)->pos, pos.pos) <= distance)
+					points_indices.push_back(it->second);
+			}
+		}
+	}
+
+	//back to map order, the order of the linear search
+	std::sort(points_indices.begin(), points_indices.end());
+}
+
+void MappingHelpers::GetLanesWithinDistance(const WayPoint& pos, RoadNetwork& map, const double& distance, std::vector<std::pair<double, Lane*> >& lanes_list, std::vector<int>& closest_indices)
+{
+	lanes_list.clear();
+	closest_indices.clear();
+	double d = 0;
+	double min_d = DBL_MAX;
+	int min_i = 0;
+	if(IsRoadNetworkIndexed(map))
+	{
+		vector<int> points_indices;
+		GetIndexedPointsWithinDistance(pos, map, distance, points_indices);
+		int last_order = -1;
+		for(unsigned int i = 0; i < points_indices.size(); i++)
+		{
+			int iPoint = points_indices.at(i);
+			d = distance2points(map.index.points.at(iPoint)->pos, pos.pos);
+			if(!(d < distance)) continue;
+
+			Lane* pLane = map.index.pointLanes.at(iPoint);
+			min_i = map.index.points.at(iPoint) - &pLane->points.at(0);
+			if(map.index.pointLaneOrders.at(iPoint) != last_order)
+			{
+				last_order = map.index.pointLaneOrders.at(iPoint);
+				lanes_list.push_back(make_pair(d, pLane));
+				closest_indices.push_back(min_i);
+			}
+			else if(d < lanes_list.back().first)
+			{
+				lanes_list.back().first = d;
+				closest_indices.back() = min_i;
+			}
+		}
+		return;
+	}
+
+	for(unsigned int j=0; j< map.roadSegments.size(); j ++)
+	{
+		for(unsigned int k=0; k< map.roadSegments.at(j).Lanes.size(); k ++)
+		{
+			d = 0;
+			min_d = DBL_MAX;
+			for(unsigned int pindex=0; pindex< map.roadSegments.at(j).Lanes.at(k).points.size(); pindex ++)
+			{
+				d = distance2points(map.roadSegments.at(j).Lanes.at(k).points.at(pindex).pos, pos.pos);
+				if(d < min_d)
+				{
+					min_d = d;
+					min_i = pindex;
+				}
+			}
+
+			if(min_d < distance)
+			{
+				lanes_list.push_back(make_pair(min_d, &map.roadSegments.at(j).Lanes.at(k)));
+				closest_indices.push_back(min_i);
+			}
+		}
+	}
+}
+
+Lane* MappingHelpers::GetClosestLaneFromMapIncreasingDistance(const WayPoint& pos, RoadNetwork& map, const bool bDirectionBased)
+{
+	//Same lane as GetClosestLaneFromMap with distance 1, 2, .. 99 until a lane is found,
+	//but the lanes and their relative info are found once for each search radius
+	const double search_radius[] = {4, 16, 99};
+	double distance_to_nearest_lane = 1;
+	vector<pair<double, Lane*> > laneLinksList;
+	vector<int> closest_indices;
+	vector<RelativeInfo> infos;
+	for(unsigned int r = 0; r < sizeof(search_radius)/sizeof(search_radius[0]); r++)
+	{
+		GetLanesWithinDistance(pos, map, search_radius[r], laneLinksList, closest_indices);
+		infos.clear();
+		infos.resize(laneLinksList.size());
+		for(unsigned int i = 0; i < laneLinksList.size(); i++)
+			PlanningHelpers::GetRelativeInfo(laneLinksList.at(i).second->points, pos, infos.at(i));
+
+		for(; distance_to_nearest_lane < 100 && distance_to_nearest_lane <= search_radius[r]; distance_to_nearest_lane += 1)
+		{
+			double min_d = DBL_MAX;
+			Lane* closest_lane = 0;
+			for(unsigned int i = 0; i < laneLinksList.size(); i++)
+			{
+				if(!(laneLinksList.at(i).first < distance_to_nearest_lane))
+					continue;
+
+				const RelativeInfo& info = infos.at(i);
+				if(info.perp_distance == 0 && laneLinksList.at(i).first != 0)
+					continue;
+
+				if(bDirectionBased && fabs(info.perp_distance) < min_d && fabs(info.angle_diff) < 45)
+				{
+					min_d = fabs(info.perp_distance);
+					closest_lane = laneLinksList.at(i).second;
+				}
+				else if(!bDirectionBased && fabs(info.perp_distance) < min_d)
+				{
+					min_d = fabs(info.perp_distance);
+					closest_lane = laneLinksList.at(i).second;
+				}
+			}
+
+			if(closest_lane)
+				return closest_lane;
+		}
+	}
+
+	return nullptr;
+}
+
 void MappingHelpers::ConstructRoadNetworkFromDataFiles(const std::string vectoMapPath, RoadNetwork& map, const bool& bZeroOrigin)
 {
 	/**
@@ -699,6 +917,7 @@ void MappingHelpers::LoadKML(const std::string& kmlFile, RoadNetwork& map)
 	std::cout << " >> Load Lanes from KML file .. " << std::endl;
 	vector<Lane> laneLinksList = GetLanesList(pHeadElem);
 
+	map.index = RoadNetworkIndex();
 	map.roadSegments.clear();
 	map.roadSegments = GetRoadSegmentsList(pHeadElem);
 
@@ -785,6 +1004,10 @@ void MappingHelpers::LoadKML(const std::string& kmlFile, RoadNetwork& map)
 		}
 	}
 
+	//Index lanes and waypoints
+	cout << " >> Index lanes and waypoints ... " << endl;
+	BuildRoadNetworkIndex(map);
+
 	//Link waypoints
 	cout << " >> Link missing branches and waypoints... " << endl;
 	LinkMissingBranchingWayPointsV2(map);
@@ -911,13 +1134,7 @@ TiXmlElement* MappingHelpers::GetDataFolder(const string& folderName, TiXmlEleme
 
 WayPoint* MappingHelpers::GetClosestWaypointFromMap(const WayPoint& pos, RoadNetwork& map, const bool bDirectionBased)
 {
-	double distance_to_nearest_lane = 1;
-	Lane* pLane = 0;
-	while(distance_to_nearest_lane < 100 && pLane == 0)
-	{
-		pLane = GetClosestLaneFromMap(pos, map, distance_to_nearest_lane, bDirectionBased);
-		distance_to_nearest_lane += 1;
-	}
+	Lane* pLane = GetClosestLaneFromMapIncreasingDistance(pos, map, bDirectionBased);
 
 	if(!pLane) return nullptr;
 
@@ -948,13 +1165,7 @@ vector<WayPoint*> MappingHelpers::GetClosestWaypointsListFromMap(const WayPoint&
 
 WayPoint* MappingHelpers::GetClosestBackWaypointFromMap(const WayPoint& pos, RoadNetwork& map)
 {
-	double distance_to_nearest_lane = 1;
-	Lane* pLane = 0;
-	while(distance_to_nearest_lane < 100 && pLane == 0)
-	{
-		pLane = GetClosestLaneFromMap(pos, map, distance_to_nearest_lane);
-		distance_to_nearest_lane += 1;
-	}
+	Lane* pLane = GetClosestLaneFromMapIncreasingDistance(pos, map);
 
 	if(!pLane) return nullptr;
 
@@ -973,6 +1184,30 @@ WayPoint* MappingHelpers::GetClosestBackWaypointFromMap(const WayPoint& pos, Roa
 std::vector<Lane*> MappingHelpers::GetClosestLanesFast(const WayPoint& center, RoadNetwork& map, const double& distance)
 {
 	vector<Lane*> lanesList;
+	if(IsRoadNetworkIndexed(map))
+	{
+		//only the lanes with a waypoint in the distance can pass the check
+		vector<int> points_indices;
+		GetIndexedPointsWithinDistance(center, map, distance, points_indices);
+		int last_order = -1;
+		for(unsigned int i = 0; i < points_indices.size(); i++)
+		{
+			if(map.index.pointLaneOrders.at(points_indices.at(i)) == last_order) continue;
+			last_order = map.index.pointLaneOrders.at(points_indices.at(i));
+
+			Lane* pL = map.index.pointLanes.at(points_indices.at(i));
+			int index = PlanningHelpers::GetClosestNextPointIndexFast(pL->points, center);
+
+			if(index < 0 || index >= pL->points.size()) continue;
+
+			double d = hypot(pL->points.at(index).pos.y - center.pos.y, pL->points.at(index).pos.x - center.pos.x);
+			if(d <= distance)
+				lanesList.push_back(pL);
+		}
+
+		return lanesList;
+	}
+
 	for(unsigned int j=0; j< map.roadSegments.size(); j ++)
 	{
 		for(unsigned int k=0; k< map.roadSegments.at(j).Lanes.size(); k ++)
@@ -994,27 +1229,9 @@ std::vector<Lane*> MappingHelpers::GetClosestLanesFast(const WayPoint& center, R
 Lane* MappingHelpers::GetClosestLaneFromMap(const WayPoint& pos, RoadNetwork& map, const double& distance, const bool bDirectionBased)
 {
 	vector<pair<double, Lane*> > laneLinksList;
-	double d = 0;
+	vector<int> closest_indices;
+	GetLanesWithinDistance(pos, map, distance, laneLinksList, closest_indices);
 	double min_d = DBL_MAX;
-	for(unsigned int j=0; j< map.roadSegments.size(); j ++)
-	{
-		for(unsigned int k=0; k< map.roadSegments.at(j).Lanes.size(); k ++)
-		{
-			//Lane* pLane = &pEdge->lanes.at(k);
-			 d = 0;
-			min_d = DBL_MAX;
-			for(unsigned int pindex=0; pindex< map.roadSegments.at(j).Lanes.at(k).points.size(); pindex ++)
-			{
-
-				d = distance2points(map.roadSegments.at(j).Lanes.at(k).points.at(pindex).pos, pos.pos);
-				if(d < min_d)
-					min_d = d;
-			}
-
-			if(min_d < distance)
-				laneLinksList.push_back(make_pair(min_d, &map.roadSegments.at(j).Lanes.at(k)));
-		}
-	}
 
 	if(laneLinksList.size() == 0) return nullptr;
 
@@ -1046,27 +1263,9 @@ Lane* MappingHelpers::GetClosestLaneFromMap(const WayPoint& pos, RoadNetwork& ma
 vector<Lane*> MappingHelpers::GetClosestLanesListFromMap(const WayPoint& pos, RoadNetwork& map, const double& distance, const bool bDirectionBased)
 {
 	vector<pair<double, Lane*> > laneLinksList;
-	double d = 0;
+	vector<int> closest_indices;
+	GetLanesWithinDistance(pos, map, distance, laneLinksList, closest_indices);
 	double min_d = DBL_MAX;
-	for(unsigned int j=0; j< map.roadSegments.size(); j ++)
-	{
-		for(unsigned int k=0; k< map.roadSegments.at(j).Lanes.size(); k ++)
-		{
-			//Lane* pLane = &pEdge->lanes.at(k);
-			 d = 0;
-			min_d = DBL_MAX;
-			for(unsigned int pindex=0; pindex< map.roadSegments.at(j).Lanes.at(k).points.size(); pindex ++)
-			{
-
-				d = distance2points(map.roadSegments.at(j).Lanes.at(k).points.at(pindex).pos, pos.pos);
-				if(d < min_d)
-					min_d = d;
-			}
-
-			if(min_d < distance)
-				laneLinksList.push_back(make_pair(min_d, &map.roadSegments.at(j).Lanes.at(k)));
-		}
-	}
 
 	vector<Lane*> closest_lanes;
 	if(laneLinksList.size() == 0) return closest_lanes;
@@ -1096,31 +1295,12 @@ vector<Lane*> MappingHelpers::GetClosestLanesListFromMap(const WayPoint& pos, Ro
 Lane* MappingHelpers::GetClosestLaneFromMapDirectionBased(const WayPoint& pos, RoadNetwork& map, const double& distance)
 {
 	vector<pair<double, WayPoint*> > laneLinksList;
-	double d = 0;
+	vector<pair<double, Lane*> > lanes_list;
+	vector<int> closest_indices;
+	GetLanesWithinDistance(pos, map, distance, lanes_list, closest_indices);
+	for(unsigned int i = 0; i < lanes_list.size(); i++)
+		laneLinksList.push_back(make_pair(lanes_list.at(i).first, &lanes_list.at(i).second->points.at(closest_indices.at(i))));
 	double min_d = DBL_MAX;
-	int min_i = 0;
-	for(unsigned int j=0; j< map.roadSegments.size(); j ++)
-	{
-		for(unsigned int k=0; k< map.roadSegments.at(j).Lanes.size(); k ++)
-		{
-			//Lane* pLane = &pEdge->lanes.at(k);
-			d = 0;
-			min_d = DBL_MAX;
-			for(unsigned int pindex=0; pindex< map.roadSegments.at(j).Lanes.at(k).points.size(); pindex ++)
-			{
-
-				d = distance2points(map.roadSegments.at(j).Lanes.at(k).points.at(pindex).pos, pos.pos);
-				if(d < min_d)
-				{
-					min_d = d;
-					min_i = pindex;
-				}
-			}
-
-			if(min_d < distance)
-				laneLinksList.push_back(make_pair(min_d, &map.roadSegments.at(j).Lanes.at(k).points.at(min_i)));
-		}
-	}
 
 	if(laneLinksList.size() == 0) return nullptr;
 
@@ -1152,6 +1332,38 @@ Lane* MappingHelpers::GetClosestLaneFromMapDirectionBased(const WayPoint& pos, R
 	vector<Lane*> lanesList;
 	double d = 0;
 	double a_diff = 0;
+	if(IsRoadNetworkIndexed(map))
+	{
+		vector<int> points_indices;
+		GetIndexedPointsWithinDistance(pos, map, distance, points_indices);
+		int last_order = -1;
+		for(unsigned int i = 0; i < points_indices.size(); i++)
+		{
+			if(map.index.pointLaneOrders.at(points_indices.at(i)) == last_order) continue;
+
+			a_diff = UtilityH::AngleBetweenTwoAnglesPositive(map.index.points.at(points_indices.at(i))->pos.a, pos.pos.a);
+			if(a_diff <= M_PI_4)
+			{
+				last_order = map.index.pointLaneOrders.at(points_indices.at(i));
+				Lane* pL = map.index.pointLanes.at(points_indices.at(i));
+				bool bLaneExist = false;
+				for(unsigned int il = 0; il < lanesList.size(); il++)
+				{
+					if(lanesList.at(il)->id == pL->id)
+					{
+						bLaneExist = true;
+						break;
+					}
+				}
+
+				if(!bLaneExist)
+					lanesList.push_back(pL);
+			}
+		}
+
+		return lanesList;
+	}
+
 	for(unsigned int j=0; j< map.roadSegments.size(); j ++)
 	{
 		for(unsigned int k=0; k< map.roadSegments.at(j).Lanes.size(); k ++)
@@ -2291,6 +2503,7 @@ void MappingHelpers::ConstructRoadNetworkFromROSMessageV2(const std::vector<Util
 		const GPSPoint& origin, RoadNetwork& map, const bool& bSpecialFlag,
 		const bool& bFindLaneChangeLanes, const bool& bFindCurbsAndWayArea)
 {
+	map.index = RoadNetworkIndex(); //built again once the lanes are in the map
 	vector<Lane> roadLanes;
 
 	for(unsigned int i=0; i< pLaneData->m_data_list.size(); i++)
@@ -2382,6 +2595,10 @@ void MappingHelpers::ConstructRoadNetworkFromROSMessageV2(const std::vector<Util
 		ExtractWayArea(area_data, wayarea_data, line_data, points_data, origin, map);
 	}
 
+	//Index lanes and waypoints
+	cout << " >> Index lanes and waypoints ... " << endl;
+	BuildRoadNetworkIndex(map);
+
 	//Link waypoints
 	cout << " >> Link missing branches and waypoints... " << endl;
 	LinkMissingBranchingWayPointsV2(map);
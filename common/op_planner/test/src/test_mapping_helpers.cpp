@@ -0,0 +1,239 @@
+/*
+ * Copyright 2018-2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "op_planner/MappingHelpers.h"
+
+using namespace PlannerHNS;
+
+class MappingHelpersTestSuite : public ::testing::Test
+{
+protected:
+	static const int SEGMENTS_NUM = 3;
+	static const int LANES_NUM = 100;
+
+	void SetUp() override
+	{
+		std::mt19937 rng(20);
+		std::uniform_real_distribution<double> uniform(0, 1);
+		int point_id = 1;
+		int lane_id = 1;
+		for(int s = 0; s < SEGMENTS_NUM; s++)
+		{
+			RoadSegment segment;
+			for(int l = 0; l < LANES_NUM; l++)
+			{
+				Lane lane;
+				lane.id = lane_id++;
+				double x = uniform(rng) * 600 - 300;
+				double y = uniform(rng) * 600 - 300;
+				double a = uniform(rng) * 2 * M_PI;
+				int points_num = 2 + rng() % 40;
+				for(int p = 0; p < points_num; p++)
+				{
+					WayPoint wp(x, y, 0, a);
+					wp.id = point_id++;
+					wp.laneId = lane.id;
+					lane.points.push_back(wp);
+					a += (uniform(rng) - 0.5) * 0.2;
+					x += cos(a);
+					y += sin(a);
+				}
+				segment.Lanes.push_back(lane);
+			}
+			map_.roadSegments.push_back(segment);
+		}
+
+		// Lanes that share waypoint positions, so that lanes are at exactly the same distance
+		Lane& copied = map_.roadSegments.at(0).Lanes.at(3);
+		for(int s = 1; s < SEGMENTS_NUM; s++)
+		{
+			Lane& lane = map_.roadSegments.at(s).Lanes.at(3);
+			lane.points = copied.points;
+			for(unsigned int p = 0; p < lane.points.size(); p++)
+			{
+				lane.points.at(p).id = point_id++;
+				lane.points.at(p).laneId = lane.id;
+			}
+		}
+		// and a lane that passes the same position twice
+		Lane& loop = map_.roadSegments.at(1).Lanes.at(7);
+		loop.points.push_back(loop.points.at(0));
+		loop.points.back().id = point_id++;
+
+		LinkWaypoints(map_);
+		linear_map_ = map_;
+		LinkWaypoints(linear_map_);
+		MappingHelpers::BuildRoadNetworkIndex(map_);
+	}
+
+	static void LinkWaypoints(RoadNetwork& map)
+	{
+		for(unsigned int rs = 0; rs < map.roadSegments.size(); rs++)
+		{
+			for(unsigned int i = 0; i < map.roadSegments.at(rs).Lanes.size(); i++)
+			{
+				Lane& lane = map.roadSegments.at(rs).Lanes.at(i);
+				for(unsigned int p = 0; p < lane.points.size(); p++)
+					lane.points.at(p).pLane = &lane;
+			}
+		}
+	}
+
+	// Positions near lanes, on waypoints, anywhere in the map and outside of it
+	std::vector<WayPoint> QueryPositions()
+	{
+		std::mt19937 rng(21);
+		std::uniform_real_distribution<double> uniform(0, 1);
+		std::vector<WayPoint> positions;
+		// on and next to the lanes that share their waypoints
+		const Lane& shared = map_.roadSegments.at(0).Lanes.at(3);
+		for(unsigned int p = 0; p < shared.points.size(); p++)
+		{
+			positions.push_back(shared.points.at(p));
+			positions.back().pos.y += p % 3;
+		}
+		for(int q = 0; q < 400; q++)
+		{
+			const Lane& lane = map_.roadSegments.at(rng() % SEGMENTS_NUM).Lanes.at(rng() % LANES_NUM);
+			WayPoint pos = lane.points.at(rng() % lane.points.size());
+			pos.pos.a = uniform(rng) * 2 * M_PI;
+			if(q % 4 == 1)
+			{
+				pos.pos.x += uniform(rng) * 8 - 4;
+				pos.pos.y += uniform(rng) * 8 - 4;
+			}
+			else if(q % 4 == 2)
+			{
+				pos.pos.x = uniform(rng) * 700 - 350;
+				pos.pos.y = uniform(rng) * 700 - 350;
+			}
+			else if(q % 4 == 3)
+			{
+				pos.pos.x = uniform(rng) * 4000 - 2000;
+				pos.pos.y = (uniform(rng) < 0.5 ? -1 : 1) * (400 + uniform(rng) * 2000);
+			}
+			positions.push_back(pos);
+		}
+		return positions;
+	}
+
+	// The search of the closest lane before the index
+	static Lane* GetClosestLaneFromMapLinear(const WayPoint& pos, RoadNetwork& map, const bool bDirectionBased)
+	{
+		double distance_to_nearest_lane = 1;
+		Lane* pLane = 0;
+		while(distance_to_nearest_lane < 100 && pLane == 0)
+		{
+			pLane = MappingHelpers::GetClosestLaneFromMap(pos, map, distance_to_nearest_lane, bDirectionBased);
+			distance_to_nearest_lane += 1;
+		}
+		return pLane;
+	}
+
+	static int LaneId(const Lane* pLane)
+	{
+		return pLane ? pLane->id : -1;
+	}
+
+	RoadNetwork map_;
+	RoadNetwork linear_map_;
+};
+
+TEST_F(MappingHelpersTestSuite, indexIsOnlyUsedForTheIndexedMap)
+{
+	EXPECT_TRUE(MappingHelpers::IsRoadNetworkIndexed(map_));
+	EXPECT_FALSE(MappingHelpers::IsRoadNetworkIndexed(linear_map_));
+
+	RoadNetwork copy = map_;
+	EXPECT_FALSE(MappingHelpers::IsRoadNetworkIndexed(copy));
+	MappingHelpers::BuildRoadNetworkIndex(copy);
+	EXPECT_TRUE(MappingHelpers::IsRoadNetworkIndexed(copy));
+}
+
+TEST_F(MappingHelpersTestSuite, lanesWithinDistanceMatchLinearScan)
+{
+	const double distances[] = {0, 0.5, 1, 2.5, 4, 9.99, 10, 16, 35, 99, 5000};
+	std::vector<WayPoint> positions = QueryPositions();
+	for(unsigned int q = 0; q < positions.size(); q++)
+	{
+		for(double distance : distances)
+		{
+			std::vector<std::pair<double, Lane*> > lanes, linear_lanes;
+			std::vector<int> indices, linear_indices;
+			MappingHelpers::GetLanesWithinDistance(positions.at(q), map_, distance, lanes, indices);
+			MappingHelpers::GetLanesWithinDistance(positions.at(q), linear_map_, distance, linear_lanes, linear_indices);
+			ASSERT_EQ(linear_lanes.size(), lanes.size()) << q << " " << distance;
+			for(unsigned int i = 0; i < lanes.size(); i++)
+			{
+				EXPECT_EQ(linear_lanes.at(i).first, lanes.at(i).first) << q << " " << distance;
+				EXPECT_EQ(linear_lanes.at(i).second->id, lanes.at(i).second->id) << q << " " << distance;
+			}
+			EXPECT_EQ(linear_indices, indices) << q << " " << distance;
+		}
+	}
+}
+
+TEST_F(MappingHelpersTestSuite, closestLaneMatchesLinearScan)
+{
+	std::vector<WayPoint> positions = QueryPositions();
+	int found = 0;
+	for(unsigned int q = 0; q < positions.size(); q++)
+	{
+		for(bool bDirectionBased : {true, false})
+		{
+			Lane* pLane = MappingHelpers::GetClosestLaneFromMapIncreasingDistance(positions.at(q), map_, bDirectionBased);
+			Lane* pLinearLane = GetClosestLaneFromMapLinear(positions.at(q), linear_map_, bDirectionBased);
+			EXPECT_EQ(LaneId(pLinearLane), LaneId(pLane)) << q << " " << bDirectionBased;
+			found += pLane != 0;
+		}
+	}
+	// some positions outside of the map are too far from any lane
+	EXPECT_GT(found, 0);
+	EXPECT_LT(found, 2 * (int)positions.size());
+}
+
+TEST_F(MappingHelpersTestSuite, indexIsRebuiltAfterChangingTheMap)
+{
+	// The index points into the lanes, so changing them requires BuildRoadNetworkIndex again
+	Lane lane = map_.roadSegments.at(0).Lanes.at(0);
+	lane.id = 100000;
+	for(unsigned int p = 0; p < lane.points.size(); p++)
+	{
+		lane.points.at(p).id += 100000;
+		lane.points.at(p).pos.x += 2000;
+	}
+	map_.roadSegments.at(0).Lanes.push_back(lane);
+	LinkWaypoints(map_);
+	MappingHelpers::BuildRoadNetworkIndex(map_);
+
+	EXPECT_EQ(&map_.roadSegments.at(0).Lanes.back(), MappingHelpers::GetLaneById(100000, map_));
+	EXPECT_EQ(&map_.roadSegments.at(0).Lanes.back().points.at(0),
+			MappingHelpers::FindWaypoint(lane.points.at(0).id, map_));
+	WayPoint pos = lane.points.at(1);
+	EXPECT_EQ(100000, LaneId(MappingHelpers::GetClosestLaneFromMapIncreasingDistance(pos, map_, false)));
+}
+
+int main(int argc, char** argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,393 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/PointField.h>
+
+/**
+ * @file pointcloud2_view.hpp
+ * @brief typed views over the points of a sensor_msgs::PointCloud2, without copying them
+ *
+ * The offsets of the fields are looked up once when the view is built, then each access reads
+ * the value in place in the message data. The message must outlive the views.
+ */
+
+namespace pointcloud2_view
+{
+/**
+ * @brief read-only view over one field of every point of a PointCloud2, as values of type T
+ */
+template <typename T>
+class FieldView
+{
+public:
+  /**
+   * @brief strided iterator over the values of the field
+   */
+  class const_iterator
+  {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef T reference;
+
+    const_iterator(const FieldView* view, size_t index) : view_(view), index_(index)
+    {
+    }
+    T operator*() const
+    {
+      return (*view_)[index_];
+    }
+    const_iterator& operator++()
+    {
+      ++index_;
+      return *this;
+    }
+    const_iterator operator++(int)
+    {
+      const_iterator it = *this;
+      ++index_;
+      return it;
+    }
+    const_iterator& operator--()
+    {
+      --index_;
+      return *this;
+    }
+    const_iterator operator--(int)
+    {
+      const_iterator it = *this;
+      --index_;
+      return it;
+    }
+    const_iterator& operator+=(std::ptrdiff_t n)
+    {
+      index_ += n;
+      return *this;
+    }
+    const_iterator& operator-=(std::ptrdiff_t n)
+    {
+      index_ -= n;
+      return *this;
+    }
+    const_iterator operator+(std::ptrdiff_t n) const
+    {
+      return const_iterator(view_, index_ + n);
+    }
+    friend const_iterator operator+(std::ptrdiff_t n, const const_iterator& it)
+    {
+      return it + n;
+    }
+    const_iterator operator-(std::ptrdiff_t n) const
+    {
+      return const_iterator(view_, index_ - n);
+    }
+    std::ptrdiff_t operator-(const const_iterator& other) const
+    {
+      return static_cast<std::ptrdiff_t>(index_) - static_cast<std::ptrdiff_t>(other.index_);
+    }
+    T operator[](std::ptrdiff_t n) const
+    {
+      return (*view_)[index_ + n];
+    }
+    bool operator==(const const_iterator& other) const
+    {
+      return index_ == other.index_;
+    }
+    bool operator!=(const const_iterator& other) const
+    {
+      return index_ != other.index_;
+    }
+    bool operator<(const const_iterator& other) const
+    {
+      return index_ < other.index_;
+    }
+    bool operator>(const const_iterator& other) const
+    {
+      return index_ > other.index_;
+    }
+    bool operator<=(const const_iterator& other) const
+    {
+      return index_ <= other.index_;
+    }
+    bool operator>=(const const_iterator& other) const
+    {
+      return index_ >= other.index_;
+    }
+
+  private:
+    const FieldView* view_;
+    size_t index_;
+  };
+
+  /**
+   * @brief empty view, valid() is false
+   */
+  FieldView() : data_(nullptr), point_step_(0), row_step_(0), width_(1), size_(0), contiguous_(true)
+  {
+  }
+
+  /**
+   * @param msg point cloud to view, it must outlive the view
+   * @param offset offset of the field in a point [byte]
+   * @throw std::runtime_error if the field does not fit in a point, or the points do not fit in the data
+   */
+  FieldView(const sensor_msgs::PointCloud2& msg, uint32_t offset)
+    : data_(msg.data.empty() ? nullptr : &msg.data[0] + offset)
+    , point_step_(msg.point_step)
+    , row_step_(msg.row_step)
+    , width_(msg.width)
+    , size_(static_cast<size_t>(msg.width) * msg.height)
+    , contiguous_(msg.height <= 1 || msg.row_step == msg.width * msg.point_step)
+  {
+    if (size_ == 0)
+      return;
+    // 64 bit products, so that huge sizes in a malformed message cannot wrap around
+    if (static_cast<uint64_t>(offset) + sizeof(T) > msg.point_step)
+      throw std::runtime_error("PointCloud2View: a field does not fit in point_step");
+    if (static_cast<uint64_t>(msg.width) * msg.point_step > msg.row_step)
+      throw std::runtime_error("PointCloud2View: width * point_step is larger than row_step");
+    if (static_cast<uint64_t>(msg.height) * msg.row_step > msg.data.size())
+      throw std::runtime_error("PointCloud2View: height * row_step is larger than the data");
+  }
+
+  bool valid() const
+  {
+    return data_ != nullptr;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  /**
+   * @brief value of the field for the i-th point, in row major order
+   */
+  T operator[](size_t i) const
+  {
+    T value;
+    std::memcpy(&value, pointData(i), sizeof(T));  // fields are not necessarily aligned
+    return value;
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(this, size_);
+  }
+
+private:
+  const uint8_t* pointData(size_t i) const
+  {
+    if (contiguous_)
+      return data_ + i * point_step_;
+    return data_ + (i / width_) * row_step_ + (i % width_) * point_step_;
+  }
+
+  const uint8_t* data_;
+  size_t point_step_;
+  size_t row_step_;
+  size_t width_;
+  size_t size_;
+  bool contiguous_;
+};
+
+/**
+ * @brief true if the host stores multi-byte values most significant byte first
+ */
+inline bool isHostBigEndian()
+{
+  const uint16_t one = 1;
+  uint8_t first_byte;
+  std::memcpy(&first_byte, &one, 1);
+  return first_byte == 0;
+}
+
+/**
+ * @brief view over the x, y, z, intensity and ring fields of a PointCloud2
+ *
+ * x, y and z are required and must be FLOAT32. intensity may be FLOAT32, FLOAT64, UINT8 or UINT16
+ * and is read as float, ring must be UINT16. Missing optional fields read as 0. The values are read
+ * as they are stored, so the byte order of the message must be the one of the host.
+ */
+class PointCloud2View
+{
+public:
+  /**
+   * @param msg point cloud to view, it must outlive the view
+   * @throw std::runtime_error if x, y or z is missing or is not FLOAT32, if the byte order is not the one of
+   * the host, or if the sizes of the message do not match its data
+   */
+  explicit PointCloud2View(const sensor_msgs::PointCloud2& msg)
+    : size_(static_cast<size_t>(msg.width) * msg.height), is_dense_(msg.is_dense != 0), intensity_datatype_(0)
+  {
+    if (static_cast<bool>(msg.is_bigendian) != isHostBigEndian())
+      throw std::runtime_error("PointCloud2View: the byte order of the point cloud is not the one of the host");
+
+    for (const sensor_msgs::PointField& field : msg.fields)
+    {
+      if (field.name == "x" || field.name == "y" || field.name == "z")
+      {
+        if (field.datatype != sensor_msgs::PointField::FLOAT32)
+          throw std::runtime_error("PointCloud2View: field " + field.name + " is not FLOAT32");
+        FieldView<float>& view = field.name == "x" ? x_ : (field.name == "y" ? y_ : z_);
+        view = FieldView<float>(msg, field.offset);
+      }
+      else if (field.name == "intensity")
+      {
+        switch (field.datatype)
+        {
+          case sensor_msgs::PointField::FLOAT32:
+            intensity_float_ = FieldView<float>(msg, field.offset);
+            break;
+          case sensor_msgs::PointField::FLOAT64:
+            intensity_double_ = FieldView<double>(msg, field.offset);
+            break;
+          case sensor_msgs::PointField::UINT8:
+            intensity_uint8_ = FieldView<uint8_t>(msg, field.offset);
+            break;
+          case sensor_msgs::PointField::UINT16:
+            intensity_uint16_ = FieldView<uint16_t>(msg, field.offset);
+            break;
+          default:
+            continue;
+        }
+        intensity_datatype_ = field.datatype;
+      }
+      else if (field.name == "ring" && field.datatype == sensor_msgs::PointField::UINT16)
+      {
+        ring_ = FieldView<uint16_t>(msg, field.offset);
+      }
+    }
+
+    if (size_ > 0 && (!x_.valid() || !y_.valid() || !z_.valid()))
+      throw std::runtime_error("PointCloud2View: the point cloud has no x, y or z field");
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  /**
+   * @brief is_dense of the message, false if some points may have non finite coordinates
+   */
+  bool isDense() const
+  {
+    return is_dense_;
+  }
+
+  bool hasIntensity() const
+  {
+    return intensity_datatype_ != 0;
+  }
+
+  bool hasRing() const
+  {
+    return ring_.valid();
+  }
+
+  float x(size_t i) const
+  {
+    return x_[i];
+  }
+
+  float y(size_t i) const
+  {
+    return y_[i];
+  }
+
+  float z(size_t i) const
+  {
+    return z_[i];
+  }
+
+  float intensity(size_t i) const
+  {
+    switch (intensity_datatype_)
+    {
+      case sensor_msgs::PointField::FLOAT32:
+        return intensity_float_[i];
+      case sensor_msgs::PointField::FLOAT64:
+        return static_cast<float>(intensity_double_[i]);
+      case sensor_msgs::PointField::UINT8:
+        return intensity_uint8_[i];
+      case sensor_msgs::PointField::UINT16:
+        return intensity_uint16_[i];
+      default:
+        return 0.0f;
+    }
+  }
+
+  uint16_t ring(size_t i) const
+  {
+    return ring_.valid() ? ring_[i] : 0;
+  }
+
+  const FieldView<float>& xView() const
+  {
+    return x_;
+  }
+
+  const FieldView<float>& yView() const
+  {
+    return y_;
+  }
+
+  const FieldView<float>& zView() const
+  {
+    return z_;
+  }
+
+  const FieldView<uint16_t>& ringView() const
+  {
+    return ring_;
+  }
+
+private:
+  size_t size_;
+  bool is_dense_;
+  FieldView<float> x_, y_, z_;
+  uint8_t intensity_datatype_;
+  FieldView<float> intensity_float_;
+  FieldView<double> intensity_double_;
+  FieldView<uint8_t> intensity_uint8_;
+  FieldView<uint16_t> intensity_uint16_;
+  FieldView<uint16_t> ring_;
+};
+
+}  // namespace pointcloud2_view
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "pointcloud2_view/pointcloud2_view.hpp"
+
+class TestSuite : public ::testing::Test
+{
+public:
+  TestSuite()
+  {
+  }
+
+  ~TestSuite()
+  {
+  }
+
+  void addField(sensor_msgs::PointCloud2& msg, const std::string& name, uint32_t offset, uint8_t datatype)
+  {
+    sensor_msgs::PointField field;
+    field.name = name;
+    field.offset = offset;
+    field.datatype = datatype;
+    field.count = 1;
+    msg.fields.push_back(field);
+  }
+
+  template <typename T>
+  void write(sensor_msgs::PointCloud2& msg, size_t row, size_t col, uint32_t offset, T value)
+  {
+    std::memcpy(&msg.data[row * msg.row_step + col * msg.point_step + offset], &value, sizeof(T));
+  }
+
+  // Velodyne layout, x y z intensity ring packed in 22 bytes
+  sensor_msgs::PointCloud2 makeCloud(uint32_t width, uint32_t height, uint32_t row_padding)
+  {
+    sensor_msgs::PointCloud2 msg;
+    addField(msg, "x", 0, sensor_msgs::PointField::FLOAT32);
+    addField(msg, "y", 4, sensor_msgs::PointField::FLOAT32);
+    addField(msg, "z", 8, sensor_msgs::PointField::FLOAT32);
+    addField(msg, "intensity", 12, sensor_msgs::PointField::FLOAT32);
+    addField(msg, "ring", 16, sensor_msgs::PointField::UINT16);
+    msg.width = width;
+    msg.height = height;
+    msg.point_step = 22;
+    msg.row_step = width * msg.point_step + row_padding;
+    msg.data.resize(msg.row_step * height);
+    for (size_t row = 0; row < height; row++)
+    {
+      for (size_t col = 0; col < width; col++)
+      {
+        size_t i = row * width + col;
+        write<float>(msg, row, col, 0, i);
+        write<float>(msg, row, col, 4, -1.0f * i);
+        write<float>(msg, row, col, 8, 0.5f * i);
+        write<float>(msg, row, col, 12, 2.0f * i);
+        write<uint16_t>(msg, row, col, 16, i % 128);
+      }
+    }
+    return msg;
+  }
+};
+
+TEST_F(TestSuite, ReadsFields)
+{
+  sensor_msgs::PointCloud2 msg = makeCloud(100, 1, 0);
+  pointcloud2_view::PointCloud2View view(msg);
+
+  ASSERT_EQ(view.size(), 100);
+  ASSERT_FALSE(view.isDense());
+  ASSERT_TRUE(view.hasIntensity());
+  ASSERT_TRUE(view.hasRing());
+  for (size_t i = 0; i < view.size(); i++)
+  {
+    ASSERT_EQ(view.x(i), i);
+    ASSERT_EQ(view.y(i), -1.0f * i);
+    ASSERT_EQ(view.z(i), 0.5f * i);
+    ASSERT_EQ(view.intensity(i), 2.0f * i);
+    ASSERT_EQ(view.ring(i), i % 128);
+  }
+
+  msg.is_dense = 1;
+  ASSERT_TRUE(pointcloud2_view::PointCloud2View(msg).isDense());
+}
+
+TEST_F(TestSuite, SkipsRowPadding)
+{
+  sensor_msgs::PointCloud2 msg = makeCloud(10, 7, 6);
+  pointcloud2_view::PointCloud2View view(msg);
+
+  ASSERT_EQ(view.size(), 70);
+  for (size_t i = 0; i < view.size(); i++)
+  {
+    ASSERT_EQ(view.x(i), i);
+    ASSERT_EQ(view.ring(i), i % 128);
+  }
+
+  const pointcloud2_view::FieldView<float>& x = view.xView();
+  ASSERT_EQ(std::accumulate(x.begin(), x.end(), 0.0f), 69 * 70 / 2);
+}
+
+TEST_F(TestSuite, IteratesRandomAccess)
+{
+  sensor_msgs::PointCloud2 msg = makeCloud(10, 7, 6);
+  pointcloud2_view::PointCloud2View view(msg);
+  const pointcloud2_view::FieldView<float>& x = view.xView();
+  const pointcloud2_view::FieldView<float>& y = view.yView();
+
+  ASSERT_EQ(std::distance(x.begin(), x.end()), 70);
+  pointcloud2_view::FieldView<float>::const_iterator it = x.begin();
+  std::advance(it, 42);
+  ASSERT_EQ(*it, 42.0f);
+  ASSERT_EQ(it[5], 47.0f);
+  ASSERT_EQ(*(it - 2), 40.0f);
+  ASSERT_EQ(*(3 + it), 45.0f);
+  it -= 40;
+  ASSERT_EQ(*it--, 2.0f);
+  ASSERT_EQ(*it, 1.0f);
+  ASSERT_TRUE(x.begin() < it && it <= it && it > x.begin() && x.end() >= it);
+
+  // x increases and y decreases over the points
+  ASSERT_EQ(*std::lower_bound(x.begin(), x.end(), 12.5f), 13.0f);
+  ASSERT_EQ(std::max_element(y.begin(), y.end()) - y.begin(), 0);
+  ASSERT_EQ(*std::max_element(x.begin(), x.end()), 69.0f);
+  std::reverse_iterator<pointcloud2_view::FieldView<float>::const_iterator> last(x.end());
+  ASSERT_EQ(*last, 69.0f);
+}
+
+TEST_F(TestSuite, ConvertsIntensity)
+{
+  sensor_msgs::PointCloud2 msg;
+  addField(msg, "x", 0, sensor_msgs::PointField::FLOAT32);
+  addField(msg, "y", 4, sensor_msgs::PointField::FLOAT32);
+  addField(msg, "z", 8, sensor_msgs::PointField::FLOAT32);
+  addField(msg, "intensity", 12, sensor_msgs::PointField::UINT8);
+  msg.width = 3;
+  msg.height = 1;
+  msg.point_step = 13;
+  msg.row_step = 39;
+  msg.data.resize(39);
+  for (size_t i = 0; i < 3; i++)
+    write<uint8_t>(msg, 0, i, 12, 100 * i);
+
+  pointcloud2_view::PointCloud2View view(msg);
+  ASSERT_FALSE(view.hasRing());
+  ASSERT_EQ(view.intensity(2), 200.0f);
+  ASSERT_EQ(view.ring(2), 0);
+}
+
+TEST_F(TestSuite, RequiresXYZ)
+{
+  sensor_msgs::PointCloud2 msg = makeCloud(4, 1, 0);
+  msg.fields[2].datatype = sensor_msgs::PointField::FLOAT64;
+  ASSERT_THROW(pointcloud2_view::PointCloud2View view(msg), std::runtime_error);
+
+  msg.fields.erase(msg.fields.begin() + 2);
+  ASSERT_THROW(pointcloud2_view::PointCloud2View view(msg), std::runtime_error);
+}
+
+TEST_F(TestSuite, ValidatesLayout)
+{
+  sensor_msgs::PointCloud2 msg = makeCloud(4, 3, 2);
+  ASSERT_NO_THROW(pointcloud2_view::PointCloud2View view(msg));
+
+  // the last row is truncated
+  sensor_msgs::PointCloud2 truncated = msg;
+  truncated.data.pop_back();
+  ASSERT_THROW(pointcloud2_view::PointCloud2View view(truncated), std::runtime_error);
+
+  // the rows overlap
+  sensor_msgs::PointCloud2 short_rows = msg;
+  short_rows.row_step = short_rows.width * short_rows.point_step - 1;
+  ASSERT_THROW(pointcloud2_view::PointCloud2View view(short_rows), std::runtime_error);
+
+  // the ring field ends past the point
+  sensor_msgs::PointCloud2 bad_offset = msg;
+  bad_offset.fields[4].offset = bad_offset.point_step - 1;
+  ASSERT_THROW(pointcloud2_view::PointCloud2View view(bad_offset), std::runtime_error);
+
+  // products that wrap around in 32 bits
+  sensor_msgs::PointCloud2 wrapping = msg;
+  wrapping.width = 1;
+  wrapping.height = 0x80000001u;
+  wrapping.row_step = 32;
+  ASSERT_THROW(pointcloud2_view::PointCloud2View view(wrapping), std::runtime_error);
+
+  sensor_msgs::PointCloud2 empty = makeCloud(0, 0, 0);
+  pointcloud2_view::PointCloud2View view(empty);
+  ASSERT_EQ(view.size(), 0u);
+}
+
+TEST_F(TestSuite, RejectsOtherByteOrder)
+{
+  sensor_msgs::PointCloud2 msg = makeCloud(4, 1, 0);
+  msg.is_bigendian = !pointcloud2_view::isHostBigEndian();
+  ASSERT_THROW(pointcloud2_view::PointCloud2View view(msg), std::runtime_error);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
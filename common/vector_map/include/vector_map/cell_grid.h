@@ -0,0 +1,147 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VECTOR_MAP_CELL_GRID_H
+#define VECTOR_MAP_CELL_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace vector_map
+{
+// Rectangle of cells, bounds included
+struct CellRange
+{
+  int min_row;
+  int min_col;
+  int max_row;
+  int max_col;
+
+  double getCellCount() const
+  {
+    return (static_cast<double>(max_row) - min_row + 1) * (static_cast<double>(max_col) - min_col + 1);
+  }
+};
+
+// Items binned in the square cells of a 2D grid. The (row, column, item) entries are kept sorted, so that the items
+// of a range of cells are found with one binary search per row, without a hash map.
+class CellGrid
+{
+public:
+  // Cell indices are in [-MAX_CELL, MAX_CELL), coordinates beyond that are not binned
+  static const int MAX_CELL = 1 << 30;
+
+  explicit CellGrid(double cell_size = 1.0) : cell_size_(cell_size)
+  {
+  }
+
+  // Removes all the entries, the cell size must be positive
+  void clear(double cell_size)
+  {
+    cell_size_ = cell_size;
+    entries_.clear();
+  }
+
+  double getCellSize() const
+  {
+    return cell_size_;
+  }
+
+  size_t size() const
+  {
+    return entries_.size();
+  }
+
+  void reserve(size_t size)
+  {
+    entries_.reserve(size);
+  }
+
+  // Cells of the rectangle [min_x, max_x] x [min_y, max_y], false if a bound is not finite or out of the range of
+  // the cells
+  bool getCellRange(double min_x, double min_y, double max_x, double max_y, CellRange& range) const
+  {
+    return getCell(min_y, range.min_row) && getCell(max_y, range.max_row) && getCell(min_x, range.min_col) &&
+           getCell(max_x, range.max_col);
+  }
+
+  // Adds the item to the cell of (x, y), false if the point is not finite or out of the range of the cells
+  bool insert(double x, double y, int item)
+  {
+    CellRange range;
+    if (!getCellRange(x, y, x, y, range))
+    {
+      return false;
+    }
+    entries_.push_back(std::make_pair(std::make_pair(range.min_row, range.min_col), item));
+    return true;
+  }
+
+  // Adds the item to every cell of the range
+  void insert(const CellRange& range, int item)
+  {
+    for (int row = range.min_row; row <= range.max_row; row++)
+    {
+      for (int col = range.min_col; col <= range.max_col; col++)
+      {
+        entries_.push_back(std::make_pair(std::make_pair(row, col), item));
+      }
+    }
+  }
+
+  // To be called after the inserts and before the queries
+  void sort()
+  {
+    std::sort(entries_.begin(), entries_.end());
+  }
+
+  // Calls function(item) for the entries of the range, by row then column, and by item within a cell
+  template <class Function>
+  void forEach(const CellRange& range, Function function) const
+  {
+    for (int row = range.min_row; row <= range.max_row; row++)
+    {
+      // the entries of the row are sorted by column
+      auto it = std::lower_bound(entries_.begin(), entries_.end(),
+                                 std::make_pair(std::make_pair(row, range.min_col), -1));
+      for (; it != entries_.end() && it->first.first == row && it->first.second <= range.max_col; ++it)
+      {
+        function(it->second);
+      }
+    }
+  }
+
+private:
+  double cell_size_;
+  std::vector<std::pair<std::pair<int, int>, int>> entries_;  // (row, column) and item, sorted
+
+  bool getCell(double coordinate, int& cell) const
+  {
+    // written so that NaN fails the comparison
+    const double index = std::floor(coordinate / cell_size_);
+    if (!(index >= -MAX_CELL && index < MAX_CELL))
+    {
+      return false;
+    }
+    cell = static_cast<int>(index);
+    return true;
+  }
+};
+}  // namespace vector_map
+
+#endif // VECTOR_MAP_CELL_GRID_H
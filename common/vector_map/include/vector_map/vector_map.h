@@ -18,11 +18,17 @@
 #define VECTOR_MAP_VECTOR_MAP_H
 
 #include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <ros/ros.h>
 #include <geometry_msgs/Point.h>
 #include <geometry_msgs/Quaternion.h>
 #include <visualization_msgs/Marker.h>
 
+#include <vector_map/cell_grid.h>
+
 #include <vector_map_msgs/PointArray.h>
 #include <vector_map_msgs/VectorArray.h>
 #include <vector_map_msgs/LineArray.h>
@@ -238,17 +244,32 @@ private:
   ros::Subscriber sub_;
   Updater<T, U> update_;
   std::vector<Callback<U>> cbs_;
-  std::map<Key<T>, T> map_;
+  std::vector<T> items_;                      // sorted by id
+  std::unordered_map<int, size_t> slots_;     // id to index in items_
+  size_t version_;
 
   void subscribe(const U& msg)
   {
-    update_(map_, msg);
+    // the updaters resolve the ids, then the items are moved to contiguous storage
+    std::map<Key<T>, T> map;
+    update_(map, msg);
+    items_.clear();
+    items_.reserve(map.size());
+    slots_.clear();
+    slots_.reserve(map.size());
+    for (auto& pair : map)
+    {
+      slots_.insert(std::make_pair(pair.first.getId(), items_.size()));
+      items_.push_back(std::move(pair.second));
+    }
+    ++version_;
     for (const auto& cb : cbs_)
       cb(msg);
   }
 
 public:
   Handle()
+    : version_(0)
   {
   }
 
@@ -267,31 +288,84 @@ public:
     cbs_.push_back(cb);
   }
 
-  T findByKey(const Key<T>& key) const
+  // The item is valid until the next message of this category replaces the items. A missing key gives a
+  // default constructed item.
+  const T& findByKey(const Key<T>& key) const
   {
-    auto it = map_.find(key);
-    if (it == map_.end())
-      return T();
-    return it->second;
+    static const T missing;
+    auto it = slots_.find(key.getId());
+    if (it == slots_.end())
+      return missing;
+    return items_[it->second];
   }
 
   std::vector<T> findByFilter(const Filter<T>& filter) const
   {
     std::vector<T> vector;
-    for (const auto& pair : map_)
+    for (const auto& item : items_)
     {
-      if (filter(pair.second))
-        vector.push_back(pair.second);
+      if (filter(item))
+        vector.push_back(item);
     }
     return vector;
   }
 
+  // All the items, sorted by id
+  const std::vector<T>& getItems() const
+  {
+    return items_;
+  }
+
+  // Incremented on every message, to know when data derived from the items is stale
+  size_t getVersion() const
+  {
+    return version_;
+  }
+
   bool empty() const
   {
-    return map_.empty();
+    return items_.empty();
   }
 };
 
+// 2D grid of the segments of map items, for radius queries. Items are located by a segment, or by a point as
+// a segment of zero length, and found when their segment is within the radius of the center.
+class SpatialIndex
+{
+private:
+  // segments whose bounding box spans more cells than this are checked on every query
+  static const int MAX_SEGMENT_CELLS = 256;
+
+  struct Segment
+  {
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+    size_t slot;
+  };
+
+  std::vector<Segment> segments_;
+  CellGrid grid_;
+  std::vector<int> large_segments_;  // too large or too far to be binned
+  size_t version_;
+
+  double squaredDistance(const Segment& segment, double x, double y) const;
+
+public:
+  explicit SpatialIndex(double cell_size);
+
+  void clear(size_t version);
+  void insert(size_t slot, double x0, double y0, double x1, double y1);
+  void build();
+
+  // version of the items the index was built from
+  size_t getVersion() const;
+
+  // Slots of the segments within radius of (x, y), sorted and unique
+  void findByRadius(double x, double y, double radius, std::vector<size_t>& slots) const;
+};
+
 template <class T>
 std::vector<T> parse(const std::string& csv_file)
 {
@@ -381,7 +455,16 @@ private:
   Handle<Fence, FenceArray> fence_;
   Handle<RailCrossing, RailCrossingArray> rail_crossing_;
 
+  // built by the const queries, so every use of the indexes holds index_mutex_
+  mutable std::mutex index_mutex_;
+  mutable SpatialIndex point_index_;
+  mutable SpatialIndex lane_index_;
+  mutable SpatialIndex stop_line_index_;
+
   void registerSubscriber(ros::NodeHandle& nh, category_t category);
+  void updatePointIndex() const;
+  void updateLaneIndex() const;
+  void updateStopLineIndex() const;
 
 public:
   VectorMap();
@@ -390,38 +473,40 @@ public:
   void subscribe(ros::NodeHandle& nh, category_t category, const ros::Duration& timeout);
   void subscribe(ros::NodeHandle& nh, category_t category, const size_t max_retries);
 
-  Point findByKey(const Key<Point>& key) const;
-  Vector findByKey(const Key<Vector>& key) const;
-  Line findByKey(const Key<Line>& key) const;
-  Area findByKey(const Key<Area>& key) const;
-  Pole findByKey(const Key<Pole>& key) const;
-  Box findByKey(const Key<Box>& key) const;
-  DTLane findByKey(const Key<DTLane>& key) const;
-  Node findByKey(const Key<Node>& key) const;
-  Lane findByKey(const Key<Lane>& key) const;
-  WayArea findByKey(const Key<WayArea>& key) const;
-  RoadEdge findByKey(const Key<RoadEdge>& key) const;
-  Gutter findByKey(const Key<Gutter>& key) const;
-  Curb findByKey(const Key<Curb>& key) const;
-  WhiteLine findByKey(const Key<WhiteLine>& key) const;
-  StopLine findByKey(const Key<StopLine>& key) const;
-  ZebraZone findByKey(const Key<ZebraZone>& key) const;
-  CrossWalk findByKey(const Key<CrossWalk>& key) const;
-  RoadMark findByKey(const Key<RoadMark>& key) const;
-  RoadPole findByKey(const Key<RoadPole>& key) const;
-  RoadSign findByKey(const Key<RoadSign>& key) const;
-  Signal findByKey(const Key<Signal>& key) const;
-  StreetLight findByKey(const Key<StreetLight>& key) const;
-  UtilityPole findByKey(const Key<UtilityPole>& key) const;
-  GuardRail findByKey(const Key<GuardRail>& key) const;
-  SideWalk findByKey(const Key<SideWalk>& key) const;
-  DriveOnPortion findByKey(const Key<DriveOnPortion>& key) const;
-  CrossRoad findByKey(const Key<CrossRoad>& key) const;
-  SideStrip findByKey(const Key<SideStrip>& key) const;
-  CurveMirror findByKey(const Key<CurveMirror>& key) const;
-  Wall findByKey(const Key<Wall>& key) const;
-  Fence findByKey(const Key<Fence>& key) const;
-  RailCrossing findByKey(const Key<RailCrossing>& key) const;
+  // References into the stored items, valid until the next message of their category arrives. Copy an item
+  // to keep it across callbacks.
+  const Point& findByKey(const Key<Point>& key) const;
+  const Vector& findByKey(const Key<Vector>& key) const;
+  const Line& findByKey(const Key<Line>& key) const;
+  const Area& findByKey(const Key<Area>& key) const;
+  const Pole& findByKey(const Key<Pole>& key) const;
+  const Box& findByKey(const Key<Box>& key) const;
+  const DTLane& findByKey(const Key<DTLane>& key) const;
+  const Node& findByKey(const Key<Node>& key) const;
+  const Lane& findByKey(const Key<Lane>& key) const;
+  const WayArea& findByKey(const Key<WayArea>& key) const;
+  const RoadEdge& findByKey(const Key<RoadEdge>& key) const;
+  const Gutter& findByKey(const Key<Gutter>& key) const;
+  const Curb& findByKey(const Key<Curb>& key) const;
+  const WhiteLine& findByKey(const Key<WhiteLine>& key) const;
+  const StopLine& findByKey(const Key<StopLine>& key) const;
+  const ZebraZone& findByKey(const Key<ZebraZone>& key) const;
+  const CrossWalk& findByKey(const Key<CrossWalk>& key) const;
+  const RoadMark& findByKey(const Key<RoadMark>& key) const;
+  const RoadPole& findByKey(const Key<RoadPole>& key) const;
+  const RoadSign& findByKey(const Key<RoadSign>& key) const;
+  const Signal& findByKey(const Key<Signal>& key) const;
+  const StreetLight& findByKey(const Key<StreetLight>& key) const;
+  const UtilityPole& findByKey(const Key<UtilityPole>& key) const;
+  const GuardRail& findByKey(const Key<GuardRail>& key) const;
+  const SideWalk& findByKey(const Key<SideWalk>& key) const;
+  const DriveOnPortion& findByKey(const Key<DriveOnPortion>& key) const;
+  const CrossRoad& findByKey(const Key<CrossRoad>& key) const;
+  const SideStrip& findByKey(const Key<SideStrip>& key) const;
+  const CurveMirror& findByKey(const Key<CurveMirror>& key) const;
+  const Wall& findByKey(const Key<Wall>& key) const;
+  const Fence& findByKey(const Key<Fence>& key) const;
+  const RailCrossing& findByKey(const Key<RailCrossing>& key) const;
 
   std::vector<Point> findByFilter(const Filter<Point>& filter) const;
   std::vector<Vector> findByFilter(const Filter<Vector>& filter) const;
@@ -456,6 +541,18 @@ public:
   std::vector<Fence> findByFilter(const Filter<Fence>& filter) const;
   std::vector<RailCrossing> findByFilter(const Filter<RailCrossing>& filter) const;
 
+  // Items of the filter within radius of the center, in the map frame (x of the center is ly of the points, y is
+  // bx). Points by their position, lanes by their segment from the begin to the front node, and stop lines by
+  // their line. The spatial index of a category is built on its first query, and again after a new message of
+  // the categories it depends on. Queries may run concurrently, but not concurrently with the callbacks that
+  // update the items.
+  std::vector<Point> findByRadius(const geometry_msgs::Point& center, double radius,
+                                  const Filter<Point>& filter) const;
+  std::vector<Lane> findByRadius(const geometry_msgs::Point& center, double radius,
+                                 const Filter<Lane>& filter) const;
+  std::vector<StopLine> findByRadius(const geometry_msgs::Point& center, double radius,
+                                     const Filter<StopLine>& filter) const;
+
   bool hasSubscribed(category_t category) const;
 
   void registerCallback(const Callback<PointArray>& cb);
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include <tf/transform_datatypes.h>
 #include <vector_map/vector_map.h>
 
@@ -21,6 +24,8 @@ namespace vector_map
 {
 namespace
 {
+const double SPATIAL_INDEX_CELL_SIZE = 5.0; // [m]
+
 void updatePoint(std::map<Key<Point>, Point>& map, const PointArray& msg)
 {
   map = std::map<Key<Point>, Point>();
@@ -704,6 +709,8 @@ void VectorMap::registerSubscriber(ros::NodeHandle& nh, category_t category)
 }
 
 VectorMap::VectorMap()
+  : point_index_(SPATIAL_INDEX_CELL_SIZE), lane_index_(SPATIAL_INDEX_CELL_SIZE),
+    stop_line_index_(SPATIAL_INDEX_CELL_SIZE)
 {
 }
 
@@ -742,162 +749,162 @@ void VectorMap::subscribe(ros::NodeHandle& nh, category_t category, const size_t
   }
 }
 
-Point VectorMap::findByKey(const Key<Point>& key) const
+const Point& VectorMap::findByKey(const Key<Point>& key) const
 {
   return point_.findByKey(key);
 }
 
-Vector VectorMap::findByKey(const Key<Vector>& key) const
+const Vector& VectorMap::findByKey(const Key<Vector>& key) const
 {
   return vector_.findByKey(key);
 }
 
-Line VectorMap::findByKey(const Key<Line>& key) const
+const Line& VectorMap::findByKey(const Key<Line>& key) const
 {
   return line_.findByKey(key);
 }
 
-Area VectorMap::findByKey(const Key<Area>& key) const
+const Area& VectorMap::findByKey(const Key<Area>& key) const
 {
   return area_.findByKey(key);
 }
 
-Pole VectorMap::findByKey(const Key<Pole>& key) const
+const Pole& VectorMap::findByKey(const Key<Pole>& key) const
 {
   return pole_.findByKey(key);
 }
 
-Box VectorMap::findByKey(const Key<Box>& key) const
+const Box& VectorMap::findByKey(const Key<Box>& key) const
 {
   return box_.findByKey(key);
 }
 
-DTLane VectorMap::findByKey(const Key<DTLane>& key) const
+const DTLane& VectorMap::findByKey(const Key<DTLane>& key) const
 {
   return dtlane_.findByKey(key);
 }
 
-Node VectorMap::findByKey(const Key<Node>& key) const
+const Node& VectorMap::findByKey(const Key<Node>& key) const
 {
   return node_.findByKey(key);
 }
 
-Lane VectorMap::findByKey(const Key<Lane>& key) const
+const Lane& VectorMap::findByKey(const Key<Lane>& key) const
 {
   return lane_.findByKey(key);
 }
 
-WayArea VectorMap::findByKey(const Key<WayArea>& key) const
+const WayArea& VectorMap::findByKey(const Key<WayArea>& key) const
 {
   return way_area_.findByKey(key);
 }
 
-RoadEdge VectorMap::findByKey(const Key<RoadEdge>& key) const
+const RoadEdge& VectorMap::findByKey(const Key<RoadEdge>& key) const
 {
   return road_edge_.findByKey(key);
 }
 
-Gutter VectorMap::findByKey(const Key<Gutter>& key) const
+const Gutter& VectorMap::findByKey(const Key<Gutter>& key) const
 {
   return gutter_.findByKey(key);
 }
 
-Curb VectorMap::findByKey(const Key<Curb>& key) const
+const Curb& VectorMap::findByKey(const Key<Curb>& key) const
 {
   return curb_.findByKey(key);
 }
 
-WhiteLine VectorMap::findByKey(const Key<WhiteLine>& key) const
+const WhiteLine& VectorMap::findByKey(const Key<WhiteLine>& key) const
 {
   return white_line_.findByKey(key);
 }
 
-StopLine VectorMap::findByKey(const Key<StopLine>& key) const
+const StopLine& VectorMap::findByKey(const Key<StopLine>& key) const
 {
   return stop_line_.findByKey(key);
 }
 
-ZebraZone VectorMap::findByKey(const Key<ZebraZone>& key) const
+const ZebraZone& VectorMap::findByKey(const Key<ZebraZone>& key) const
 {
   return zebra_zone_.findByKey(key);
 }
 
-CrossWalk VectorMap::findByKey(const Key<CrossWalk>& key) const
+const CrossWalk& VectorMap::findByKey(const Key<CrossWalk>& key) const
 {
   return cross_walk_.findByKey(key);
 }
 
-RoadMark VectorMap::findByKey(const Key<RoadMark>& key) const
+const RoadMark& VectorMap::findByKey(const Key<RoadMark>& key) const
 {
   return road_mark_.findByKey(key);
 }
 
-RoadPole VectorMap::findByKey(const Key<RoadPole>& key) const
+const RoadPole& VectorMap::findByKey(const Key<RoadPole>& key) const
 {
   return road_pole_.findByKey(key);
 }
 
-RoadSign VectorMap::findByKey(const Key<RoadSign>& key) const
+const RoadSign& VectorMap::findByKey(const Key<RoadSign>& key) const
 {
   return road_sign_.findByKey(key);
 }
 
-Signal VectorMap::findByKey(const Key<Signal>& key) const
+const Signal& VectorMap::findByKey(const Key<Signal>& key) const
 {
   return signal_.findByKey(key);
 }
 
-StreetLight VectorMap::findByKey(const Key<StreetLight>& key) const
+const StreetLight& VectorMap::findByKey(const Key<StreetLight>& key) const
 {
   return street_light_.findByKey(key);
 }
 
-UtilityPole VectorMap::findByKey(const Key<UtilityPole>& key) const
+const UtilityPole& VectorMap::findByKey(const Key<UtilityPole>& key) const
 {
   return utility_pole_.findByKey(key);
 }
 
-GuardRail VectorMap::findByKey(const Key<GuardRail>& key) const
+const GuardRail& VectorMap::findByKey(const Key<GuardRail>& key) const
 {
   return guard_rail_.findByKey(key);
 }
 
-SideWalk VectorMap::findByKey(const Key<SideWalk>& id) const
+const SideWalk& VectorMap::findByKey(const Key<SideWalk>& id) const
 {
   return side_walk_.findByKey(id);
 }
 
-DriveOnPortion VectorMap::findByKey(const Key<DriveOnPortion>& key) const
+const DriveOnPortion& VectorMap::findByKey(const Key<DriveOnPortion>& key) const
 {
   return drive_on_portion_.findByKey(key);
 }
 
-CrossRoad VectorMap::findByKey(const Key<CrossRoad>& key) const
+const CrossRoad& VectorMap::findByKey(const Key<CrossRoad>& key) const
 {
   return cross_road_.findByKey(key);
 }
 
-SideStrip VectorMap::findByKey(const Key<SideStrip>& id) const
+const SideStrip& VectorMap::findByKey(const Key<SideStrip>& id) const
 {
   return side_strip_.findByKey(id);
 }
 
-CurveMirror VectorMap::findByKey(const Key<CurveMirror>& key) const
+const CurveMirror& VectorMap::findByKey(const Key<CurveMirror>& key) const
 {
   return curve_mirror_.findByKey(key);
 }
 
-Wall VectorMap::findByKey(const Key<Wall>& key) const
+const Wall& VectorMap::findByKey(const Key<Wall>& key) const
 {
   return wall_.findByKey(key);
 }
 
-Fence VectorMap::findByKey(const Key<Fence>& key) const
+const Fence& VectorMap::findByKey(const Key<Fence>& key) const
 {
   return fence_.findByKey(key);
 }
 
-RailCrossing VectorMap::findByKey(const Key<RailCrossing>& key) const
+const RailCrossing& VectorMap::findByKey(const Key<RailCrossing>& key) const
 {
   return rail_crossing_.findByKey(key);
 }
@@ -1222,6 +1229,208 @@ void VectorMap::registerCallback(const Callback<RailCrossingArray>& cb)
   rail_crossing_.registerCallback(cb);
 }
 
+void VectorMap::updatePointIndex() const
+{
+  if (point_index_.getVersion() == point_.getVersion())
+    return;
+  point_index_.clear(point_.getVersion());
+  const std::vector<Point>& points = point_.getItems();
+  for (size_t i = 0; i < points.size(); ++i)
+    point_index_.insert(i, points[i].ly, points[i].bx, points[i].ly, points[i].bx);
+  point_index_.build();
+}
+
+void VectorMap::updateLaneIndex() const
+{
+  // the versions only increase, so their sum changes with any of them
+  const size_t version = lane_.getVersion() + node_.getVersion() + point_.getVersion();
+  if (lane_index_.getVersion() == version)
+    return;
+  lane_index_.clear(version);
+  const std::vector<Lane>& lanes = lane_.getItems();
+  for (size_t i = 0; i < lanes.size(); ++i)
+  {
+    Point bp = findByKey(Key<Point>(findByKey(Key<Node>(lanes[i].bnid)).pid));
+    Point fp = findByKey(Key<Point>(findByKey(Key<Node>(lanes[i].fnid)).pid));
+    if (bp.pid == 0 || fp.pid == 0)
+      continue;
+    lane_index_.insert(i, bp.ly, bp.bx, fp.ly, fp.bx);
+  }
+  lane_index_.build();
+}
+
+void VectorMap::updateStopLineIndex() const
+{
+  const size_t version = stop_line_.getVersion() + line_.getVersion() + point_.getVersion();
+  if (stop_line_index_.getVersion() == version)
+    return;
+  stop_line_index_.clear(version);
+  const std::vector<StopLine>& stop_lines = stop_line_.getItems();
+  for (size_t i = 0; i < stop_lines.size(); ++i)
+  {
+    Line line = findByKey(Key<Line>(stop_lines[i].lid));
+    Point bp = findByKey(Key<Point>(line.bpid));
+    Point fp = findByKey(Key<Point>(line.fpid));
+    if (bp.pid == 0 || fp.pid == 0)
+      continue;
+    stop_line_index_.insert(i, bp.ly, bp.bx, fp.ly, fp.bx);
+  }
+  stop_line_index_.build();
+}
+
+std::vector<Point> VectorMap::findByRadius(const geometry_msgs::Point& center, double radius,
+                                          const Filter<Point>& filter) const
+{
+  std::vector<size_t> slots;
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    updatePointIndex();
+    point_index_.findByRadius(center.x, center.y, radius, slots);
+  }
+  std::vector<Point> vector;
+  for (const auto& slot : slots)
+  {
+    if (filter(point_.getItems()[slot]))
+      vector.push_back(point_.getItems()[slot]);
+  }
+  return vector;
+}
+
+std::vector<Lane> VectorMap::findByRadius(const geometry_msgs::Point& center, double radius,
+                                         const Filter<Lane>& filter) const
+{
+  std::vector<size_t> slots;
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    updateLaneIndex();
+    lane_index_.findByRadius(center.x, center.y, radius, slots);
+  }
+  std::vector<Lane> vector;
+  for (const auto& slot : slots)
+  {
+    if (filter(lane_.getItems()[slot]))
+      vector.push_back(lane_.getItems()[slot]);
+  }
+  return vector;
+}
+
+std::vector<StopLine> VectorMap::findByRadius(const geometry_msgs::Point& center, double radius,
+                                             const Filter<StopLine>& filter) const
+{
+  std::vector<size_t> slots;
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    updateStopLineIndex();
+    stop_line_index_.findByRadius(center.x, center.y, radius, slots);
+  }
+  std::vector<StopLine> vector;
+  for (const auto& slot : slots)
+  {
+    if (filter(stop_line_.getItems()[slot]))
+      vector.push_back(stop_line_.getItems()[slot]);
+  }
+  return vector;
+}
+
+SpatialIndex::SpatialIndex(double cell_size)
+  : grid_(cell_size), version_(static_cast<size_t>(-1))
+{
+}
+
+void SpatialIndex::clear(size_t version)
+{
+  segments_.clear();
+  grid_.clear(grid_.getCellSize());
+  large_segments_.clear();
+  version_ = version;
+}
+
+void SpatialIndex::insert(size_t slot, double x0, double y0, double x1, double y1)
+{
+  if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+    return;
+  Segment segment;
+  segment.x0 = x0;
+  segment.y0 = y0;
+  segment.x1 = x1;
+  segment.y1 = y1;
+  segment.slot = slot;
+  segments_.push_back(segment);
+}
+
+void SpatialIndex::build()
+{
+  for (size_t i = 0; i < segments_.size(); ++i)
+  {
+    const Segment& segment = segments_[i];
+    CellRange range;
+    if (!grid_.getCellRange(std::min(segment.x0, segment.x1), std::min(segment.y0, segment.y1),
+                            std::max(segment.x0, segment.x1), std::max(segment.y0, segment.y1), range) ||
+        range.getCellCount() > MAX_SEGMENT_CELLS)
+    {
+      large_segments_.push_back(i);
+      continue;
+    }
+    grid_.insert(range, static_cast<int>(i));
+  }
+  grid_.sort();
+}
+
+size_t SpatialIndex::getVersion() const
+{
+  return version_;
+}
+
+double SpatialIndex::squaredDistance(const Segment& segment, double x, double y) const
+{
+  const double dx = segment.x1 - segment.x0;
+  const double dy = segment.y1 - segment.y0;
+  const double length2 = dx * dx + dy * dy;
+  double t = 0;
+  if (length2 > 0)
+    t = std::max(0.0, std::min(1.0, ((x - segment.x0) * dx + (y - segment.y0) * dy) / length2));
+  const double ex = segment.x0 + t * dx - x;
+  const double ey = segment.y0 + t * dy - y;
+  return ex * ex + ey * ey;
+}
+
+void SpatialIndex::findByRadius(double x, double y, double radius, std::vector<size_t>& slots) const
+{
+  slots.clear();
+  if (!(radius >= 0) || !std::isfinite(x) || !std::isfinite(y))
+    return;
+
+  const double radius2 = radius * radius;
+  CellRange range;
+  if (!grid_.getCellRange(x - radius, y - radius, x + radius, y + radius, range) ||
+      range.getCellCount() > grid_.size())
+  {
+    // a radius covering more cells than there are entries, or beyond the range of the cells, is answered by
+    // checking every segment
+    for (const auto& segment : segments_)
+    {
+      if (squaredDistance(segment, x, y) <= radius2)
+        slots.push_back(segment.slot);
+    }
+  }
+  else
+  {
+    grid_.forEach(range, [&](int i) {
+      if (squaredDistance(segments_[i], x, y) <= radius2)
+        slots.push_back(segments_[i].slot);
+    });
+    for (const auto& i : large_segments_)
+    {
+      if (squaredDistance(segments_[i], x, y) <= radius2)
+        slots.push_back(segments_[i].slot);
+    }
+  }
+
+  // a segment spanning several cells is found once per cell
+  std::sort(slots.begin(), slots.end());
+  slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+}
+
 const double COLOR_VALUE_MIN = 0.0;
 const double COLOR_VALUE_MAX = 1.0;
 const double COLOR_VALUE_MEDIAN = 0.5;
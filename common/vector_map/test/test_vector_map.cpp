@@ -0,0 +1,269 @@
+/*
+ * Copyright 2015-2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <vector_map/cell_grid.h>
+#include <vector_map/vector_map.h>
+
+using namespace vector_map;
+
+namespace
+{
+const int POINT_COUNT = 2000;
+const int QUERY_COUNT = 200;
+
+// Coordinates on a 0.5 m grid, so that many points lie exactly at the query radius
+double randomCoordinate(std::mt19937& rng)
+{
+  return std::uniform_int_distribution<int>(0, 400)(rng) * 0.5;
+}
+
+double squaredDistance(const Point& bp, const Point& fp, double x, double y)
+{
+  const double dx = fp.ly - bp.ly;
+  const double dy = fp.bx - bp.bx;
+  const double length2 = dx * dx + dy * dy;
+  double t = 0;
+  if (length2 > 0)
+    t = std::max(0.0, std::min(1.0, ((x - bp.ly) * dx + (y - bp.bx) * dy) / length2));
+  const double ex = bp.ly + t * dx - x;
+  const double ey = bp.bx + t * dy - y;
+  return ex * ex + ey * ey;
+}
+
+template <class T>
+bool all(const T&)
+{
+  return true;
+}
+
+class VectorMapTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    std::mt19937 rng(42);
+    // id 0 is skipped and the first of duplicate ids is kept by the updaters
+    for (int pid = 0; pid <= POINT_COUNT; ++pid)
+    {
+      Point point;
+      point.pid = pid;
+      point.bx = randomCoordinate(rng);
+      point.ly = randomCoordinate(rng);
+      points_.data.push_back(point);
+      Node node;
+      node.nid = pid;
+      node.pid = pid;
+      nodes_.data.push_back(node);
+    }
+    Point duplicate = points_.data[1];
+    duplicate.bx += 1000;
+    points_.data.push_back(duplicate);
+
+    std::uniform_int_distribution<int> node_id(1, POINT_COUNT + 10);  // some lanes reference missing nodes
+    for (int lnid = 1; lnid <= POINT_COUNT / 2; ++lnid)
+    {
+      Lane lane;
+      lane.lnid = lnid;
+      lane.bnid = node_id(rng);
+      lane.fnid = lnid % 10 == 0 ? lane.bnid : node_id(rng);  // and some have zero length
+      lanes_.data.push_back(lane);
+    }
+    for (int id = 1; id <= POINT_COUNT / 10; ++id)
+    {
+      Line line;
+      line.lid = id;
+      line.bpid = node_id(rng);
+      line.fpid = node_id(rng);
+      lines_.data.push_back(line);
+      StopLine stop_line;
+      stop_line.id = id;
+      stop_line.lid = id;
+      stop_lines_.data.push_back(stop_line);
+    }
+
+    ros::NodeHandle nh;
+    std::vector<ros::Publisher> pubs;
+    pubs.push_back(nh.advertise<PointArray>("/vector_map_info/point", 1, true));
+    pubs.back().publish(points_);
+    pubs.push_back(nh.advertise<NodeArray>("/vector_map_info/node", 1, true));
+    pubs.back().publish(nodes_);
+    pubs.push_back(nh.advertise<LaneArray>("/vector_map_info/lane", 1, true));
+    pubs.back().publish(lanes_);
+    pubs.push_back(nh.advertise<LineArray>("/vector_map_info/line", 1, true));
+    pubs.back().publish(lines_);
+    pubs.push_back(nh.advertise<StopLineArray>("/vector_map_info/stop_line", 1, true));
+    pubs.back().publish(stop_lines_);
+    vmap_.subscribe(nh, POINT | NODE | LANE | LINE | STOP_LINE, ros::Duration(10.0));
+    ASSERT_TRUE(vmap_.hasSubscribed(POINT | NODE | LANE | LINE | STOP_LINE));
+  }
+
+  // The storage of the handles before the index, filled like the updaters do
+  template <class T, class U, class F>
+  static std::map<Key<T>, T> linearMap(const U& msg, F id)
+  {
+    std::map<Key<T>, T> map;
+    for (const auto& item : msg.data)
+    {
+      if (id(item) != 0)
+        map.insert(std::make_pair(Key<T>(id(item)), item));
+    }
+    return map;
+  }
+
+  template <class T>
+  static T linearFind(const std::map<Key<T>, T>& map, int id)
+  {
+    auto it = map.find(Key<T>(id));
+    return it == map.end() ? T() : it->second;
+  }
+
+  PointArray points_;
+  NodeArray nodes_;
+  LaneArray lanes_;
+  LineArray lines_;
+  StopLineArray stop_lines_;
+  VectorMap vmap_;
+};
+}  // namespace
+
+TEST_F(VectorMapTest, findByKeyMatchesLinearMap)
+{
+  auto points = linearMap<Point>(points_, [](const Point& p) { return p.pid; });
+  auto lanes = linearMap<Lane>(lanes_, [](const Lane& l) { return l.lnid; });
+  for (int id = -1; id <= POINT_COUNT + 1; ++id)
+  {
+    Point expected = linearFind(points, id);
+    Point actual = vmap_.findByKey(Key<Point>(id));
+    EXPECT_EQ(expected.pid, actual.pid) << id;
+    EXPECT_EQ(expected.bx, actual.bx) << id;
+    EXPECT_EQ(expected.ly, actual.ly) << id;
+    EXPECT_EQ(linearFind(lanes, id).bnid, vmap_.findByKey(Key<Lane>(id)).bnid) << id;
+  }
+
+  std::vector<Point> filtered = vmap_.findByFilter(all<Point>);
+  ASSERT_EQ(points.size(), filtered.size());
+  size_t i = 0;
+  for (const auto& pair : points)
+    EXPECT_EQ(pair.first.getId(), filtered[i++].pid);
+
+  // the lookups refer to the stored items instead of copying them
+  const Point& stored = vmap_.findByKey(Key<Point>(filtered.front().pid));
+  EXPECT_EQ(&stored, &vmap_.findByKey(Key<Point>(filtered.front().pid)));
+  EXPECT_EQ(filtered.front().bx, stored.bx);
+}
+
+TEST_F(VectorMapTest, findByRadiusMatchesLinearScan)
+{
+  std::mt19937 rng(7);
+  size_t boundary_hits = 0;
+  for (int q = 0; q < QUERY_COUNT; ++q)
+  {
+    geometry_msgs::Point center;
+    center.x = randomCoordinate(rng);
+    center.y = randomCoordinate(rng);
+    const double radius = q % 10 == 9 ? 1000.0 : std::uniform_int_distribution<int>(0, 30)(rng) * 0.5;
+    const double radius2 = radius * radius;
+
+    // the queries as they were written before the index, with findByFilter
+    std::vector<Point> points = vmap_.findByFilter([&](const Point& p) {
+      return squaredDistance(p, p, center.x, center.y) <= radius2;
+    });
+    std::vector<Lane> lanes = vmap_.findByFilter([&](const Lane& l) {
+      Point bp = vmap_.findByKey(Key<Point>(vmap_.findByKey(Key<Node>(l.bnid)).pid));
+      Point fp = vmap_.findByKey(Key<Point>(vmap_.findByKey(Key<Node>(l.fnid)).pid));
+      return bp.pid != 0 && fp.pid != 0 && squaredDistance(bp, fp, center.x, center.y) <= radius2;
+    });
+    std::vector<StopLine> stop_lines = vmap_.findByFilter([&](const StopLine& s) {
+      Line line = vmap_.findByKey(Key<Line>(s.lid));
+      Point bp = vmap_.findByKey(Key<Point>(line.bpid));
+      Point fp = vmap_.findByKey(Key<Point>(line.fpid));
+      return bp.pid != 0 && fp.pid != 0 && squaredDistance(bp, fp, center.x, center.y) <= radius2;
+    });
+    for (const auto& p : points)
+      boundary_hits += squaredDistance(p, p, center.x, center.y) == radius2;
+
+    std::vector<Point> indexed_points = vmap_.findByRadius(center, radius, all<Point>);
+    std::vector<Lane> indexed_lanes = vmap_.findByRadius(center, radius, all<Lane>);
+    std::vector<StopLine> indexed_stop_lines = vmap_.findByRadius(center, radius, all<StopLine>);
+    ASSERT_EQ(points.size(), indexed_points.size()) << q;
+    ASSERT_EQ(lanes.size(), indexed_lanes.size()) << q;
+    ASSERT_EQ(stop_lines.size(), indexed_stop_lines.size()) << q;
+    for (size_t i = 0; i < points.size(); ++i)
+      EXPECT_EQ(points[i].pid, indexed_points[i].pid);
+    for (size_t i = 0; i < lanes.size(); ++i)
+      EXPECT_EQ(lanes[i].lnid, indexed_lanes[i].lnid);
+    for (size_t i = 0; i < stop_lines.size(); ++i)
+      EXPECT_EQ(stop_lines[i].id, indexed_stop_lines[i].id);
+  }
+  EXPECT_GT(boundary_hits, 0u);
+}
+
+TEST_F(VectorMapTest, findByRadiusAppliesFilter)
+{
+  geometry_msgs::Point center;
+  center.x = 100;
+  center.y = 100;
+  std::vector<Point> odd = vmap_.findByRadius(center, 20.0, [](const Point& p) { return p.pid % 2 == 1; });
+  std::vector<Point> all_points = vmap_.findByRadius(center, 20.0, all<Point>);
+  ASSERT_FALSE(odd.empty());
+  EXPECT_LT(odd.size(), all_points.size());
+  for (const auto& p : odd)
+    EXPECT_EQ(1, p.pid % 2);
+}
+
+TEST(CellGridTest, rejectsNonFiniteAndOutOfRangeCoordinates)
+{
+  vector_map::CellGrid grid(2.0);
+  EXPECT_TRUE(grid.insert(-1.0, 3.0, 0));
+  EXPECT_TRUE(grid.insert(1.0, 3.0, 1));
+  EXPECT_TRUE(grid.insert(5.0, -7.0, 2));
+  EXPECT_FALSE(grid.insert(std::numeric_limits<double>::quiet_NaN(), 0.0, 3));
+  EXPECT_FALSE(grid.insert(0.0, std::numeric_limits<double>::infinity(), 4));
+  EXPECT_FALSE(grid.insert(1e12, 0.0, 5));
+  grid.sort();
+  EXPECT_EQ(3u, grid.size());
+
+  vector_map::CellRange range;
+  ASSERT_TRUE(grid.getCellRange(-1.0, 2.0, 1.0, 3.0, range));
+  EXPECT_EQ(-1, range.min_col);
+  EXPECT_EQ(0, range.max_col);
+  EXPECT_EQ(1, range.min_row);
+  EXPECT_EQ(1, range.max_row);
+  EXPECT_EQ(2.0, range.getCellCount());
+  std::vector<int> items;
+  grid.forEach(range, [&items](int item) { items.push_back(item); });
+  EXPECT_EQ(std::vector<int>({ 0, 1 }), items);
+
+  EXPECT_FALSE(grid.getCellRange(-1e12, 0.0, 0.0, 0.0, range));
+  EXPECT_FALSE(grid.getCellRange(0.0, 0.0, 0.0, std::numeric_limits<double>::quiet_NaN(), range));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_vector_map");
+  ros::NodeHandle nh;
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,70 @@
+#ifndef GRID_EUCLIDEAN_CLUSTERING_H_
+#define GRID_EUCLIDEAN_CLUSTERING_H_
+
+#include <vector>
+
+#include <pcl/PointIndices.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+// Euclidean clustering of the points projected on the xy plane, without a kd-tree.
+// The points are binned in a 2D grid whose cells are small enough that all the points of a cell are within the
+// threshold of each other. Two cells are connected when any of their points are within the threshold, and the
+// clusters are the connected components of the cells, found with a union-find. Pairs of cells already in the same
+// component are not checked. The rows of the grid are split in bands connected in parallel, then the bands are
+// connected to each other.
+// The clusters are the ones of pcl::EuclideanClusterExtraction on the flattened cloud, sorted by decreasing size
+// with the indices of each cluster in increasing order. Non-finite points, and points too far from the origin for
+// the grid (MAX_CELL_COORDINATE cells), are in no cluster.
+class GridEuclideanCluster
+{
+public:
+  GridEuclideanCluster();
+
+  void setInputPoints(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr& input);
+  void setThreshold(double threshold);
+  void setMinClusterPts(int min_cluster_pts);
+  void setMaxClusterPts(int max_cluster_pts);
+  void extractClusters();
+  const std::vector<pcl::PointIndices>& getOutput() const;
+
+private:
+  static const int CELL_RANGE = 2;
+  static const int MAX_CELL_COORDINATE = 1 << 20;
+
+  struct CellPoint
+  {
+    float x;
+    float y;
+    int col;
+    int index;
+  };
+
+  pcl::PointCloud<pcl::PointXYZ>::ConstPtr input_;
+  double threshold_;
+  int min_cluster_pts_;
+  int max_cluster_pts_;
+  std::vector<pcl::PointIndices> clusters_;
+
+  // Buffers reused from one cloud to the next
+  std::vector<int> col_start_;        // first point of each column in col_points_
+  std::vector<CellPoint> col_points_; // points sorted by column
+  std::vector<int> row_start_;        // first point of each row in points_, plus the end
+  std::vector<int> row_fill_;
+  std::vector<CellPoint> points_;     // points sorted by row, then column
+  std::vector<int> row_cell_start_;   // first cell of each row, plus the end
+  std::vector<int> cell_start_;       // first point of each cell in points_, plus the end
+  std::vector<int> cell_col_;         // column of each cell
+  std::vector<float> cell_box_;       // min x, min y, max x, max y of the points of each cell
+  std::vector<int> parent_;           // union-find forest of the cells
+  std::vector<int> root_size_;        // number of points of the component of each root cell
+  std::vector<int> root_cluster_;     // cluster of each root cell, -1 if the component is too small or too large
+  std::vector<int> point_cell_;       // cell of each input point, -1 for invalid points
+
+  bool isConnected(int cell_a, int cell_b, double squared_threshold) const;
+  void connectRow(int row, int min_other_row, int max_other_row, double squared_threshold);
+  void connectCells(int cell_a, int cell_b, double squared_threshold);
+  int findRoot(int cell);
+};
+
+#endif
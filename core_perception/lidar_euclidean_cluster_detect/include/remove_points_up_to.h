@@ -0,0 +1,36 @@
+#ifndef REMOVE_POINTS_UP_TO_H_
+#define REMOVE_POINTS_UP_TO_H_
+
+#include <cmath>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <pointcloud2_view/pointcloud2_view.hpp>
+
+// Reads the points in place in the PointCloud2 and keeps the ones farther than in_distance from the origin on the
+// xy plane, all of them are kept if in_distance is not positive. Points with non finite coordinates are dropped, so
+// the output is always dense.
+inline void removePointsUpTo(const pointcloud2_view::PointCloud2View& in_cloud_view,
+                             pcl::PointCloud<pcl::PointXYZ>::Ptr out_cloud_ptr, const double in_distance)
+{
+  out_cloud_ptr->points.clear();
+  out_cloud_ptr->points.reserve(in_cloud_view.size());
+  for (size_t i = 0; i < in_cloud_view.size(); i++)
+  {
+    pcl::PointXYZ point(in_cloud_view.x(i), in_cloud_view.y(i), in_cloud_view.z(i));
+    if (!std::isfinite(point.x) || !std::isfinite(point.y) || !std::isfinite(point.z))
+    {
+      continue;
+    }
+    if (in_distance <= 0.0 || std::sqrt(point.x * point.x + point.y * point.y) > in_distance)
+    {
+      out_cloud_ptr->points.push_back(point);
+    }
+  }
+  out_cloud_ptr->width = out_cloud_ptr->points.size();
+  out_cloud_ptr->height = 1;
+  out_cloud_ptr->is_dense = true;
+}
+
+#endif  // REMOVE_POINTS_UP_TO_H_
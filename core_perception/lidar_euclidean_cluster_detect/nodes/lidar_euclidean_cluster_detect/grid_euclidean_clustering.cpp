@@ -0,0 +1,300 @@
+#include "grid_euclidean_clustering.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+GridEuclideanCluster::GridEuclideanCluster()
+  : threshold_(0.5), min_cluster_pts_(1), max_cluster_pts_(std::numeric_limits<int>::max())
+{
+}
+
+void GridEuclideanCluster::setInputPoints(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr& input)
+{
+  input_ = input;
+}
+
+void GridEuclideanCluster::setThreshold(double threshold)
+{
+  threshold_ = threshold;
+}
+
+void GridEuclideanCluster::setMinClusterPts(int min_cluster_pts)
+{
+  min_cluster_pts_ = min_cluster_pts;
+}
+
+void GridEuclideanCluster::setMaxClusterPts(int max_cluster_pts)
+{
+  max_cluster_pts_ = max_cluster_pts;
+}
+
+const std::vector<pcl::PointIndices>& GridEuclideanCluster::getOutput() const
+{
+  return clusters_;
+}
+
+void GridEuclideanCluster::extractClusters()
+{
+  clusters_.clear();
+  if (!input_ || input_->points.empty() || threshold_ <= 0)
+    return;
+
+  const auto& points = input_->points;
+  const int points_num = points.size();
+
+  // The diagonal of a cell is the threshold, so all the points of a cell are connected, and points within the
+  // threshold of each other are at most CELL_RANGE rows or columns apart
+  const double cell_size = threshold_ / std::sqrt(2.0);
+
+  // Points more than MAX_CELL_COORDINATE cells away from the origin are left out like the non-finite ones, so that
+  // a far outlier can neither overflow the int cell coordinates nor blow up the size of the grid
+  const double max_coordinate = MAX_CELL_COORDINATE * cell_size;
+  auto in_grid = [max_coordinate](const pcl::PointXYZ& point) {
+    return std::abs(point.x) < max_coordinate && std::abs(point.y) < max_coordinate;
+  };
+
+  double min_x = std::numeric_limits<double>::max();
+  double min_y = std::numeric_limits<double>::max();
+  double max_y = -std::numeric_limits<double>::max();
+  for (int i = 0; i < points_num; i++)
+  {
+    if (!in_grid(points[i]))
+      continue;
+    min_x = std::min(min_x, static_cast<double>(points[i].x));
+    min_y = std::min(min_y, static_cast<double>(points[i].y));
+    max_y = std::max(max_y, static_cast<double>(points[i].y));
+  }
+  if (min_x == std::numeric_limits<double>::max())
+    return;
+  const int rows_num = static_cast<int>((max_y - min_y) / cell_size) + 1;
+
+  // Counting sort of the points by column, then by row, so that they are sorted by row, column and index.
+  // point_cell_ holds the column of each point until the cells are known.
+  double max_x = -std::numeric_limits<double>::max();
+  for (int i = 0; i < points_num; i++)
+  {
+    if (in_grid(points[i]))
+      max_x = std::max(max_x, static_cast<double>(points[i].x));
+  }
+  const int cols_num = static_cast<int>((max_x - min_x) / cell_size) + 1;
+
+  point_cell_.assign(points_num, -1);
+  col_start_.assign(cols_num + 1, 0);
+  row_start_.assign(rows_num + 1, 0);
+  for (int i = 0; i < points_num; i++)
+  {
+    if (!in_grid(points[i]))
+      continue;
+    const int col = std::min(static_cast<int>((points[i].x - min_x) / cell_size), cols_num - 1);
+    const int row = std::min(static_cast<int>((points[i].y - min_y) / cell_size), rows_num - 1);
+    point_cell_[i] = col;
+    col_start_[col + 1]++;
+    row_start_[row + 1]++;
+  }
+  for (int col = 0; col < cols_num; col++)
+    col_start_[col + 1] += col_start_[col];
+  for (int row = 0; row < rows_num; row++)
+    row_start_[row + 1] += row_start_[row];
+
+  col_points_.resize(col_start_[cols_num]);
+  for (int i = 0; i < points_num; i++)
+  {
+    if (point_cell_[i] < 0)
+      continue;
+    CellPoint& point = col_points_[col_start_[point_cell_[i]]++];
+    point.x = points[i].x;
+    point.y = points[i].y;
+    point.col = point_cell_[i];
+    point.index = i;
+  }
+
+  row_fill_.assign(row_start_.begin(), row_start_.end() - 1);
+  points_.resize(col_points_.size());
+  for (const CellPoint& point : col_points_)
+  {
+    const int row = std::min(static_cast<int>((point.y - min_y) / cell_size), rows_num - 1);
+    points_[row_fill_[row]++] = point;
+  }
+
+  // Cells are the runs of points with the same row and column
+  row_cell_start_.resize(rows_num + 1);
+  cell_start_.clear();
+  cell_col_.clear();
+  for (int row = 0; row < rows_num; row++)
+  {
+    row_cell_start_[row] = cell_start_.size();
+    for (int p = row_start_[row]; p < row_start_[row + 1]; p++)
+    {
+      if (p == row_start_[row] || points_[p].col != points_[p - 1].col)
+      {
+        cell_start_.push_back(p);
+        cell_col_.push_back(points_[p].col);
+      }
+    }
+  }
+  const int cells_num = cell_col_.size();
+  row_cell_start_[rows_num] = cells_num;
+  cell_start_.push_back(points_.size());
+
+  cell_box_.resize(4 * cells_num);
+  for (int cell = 0; cell < cells_num; cell++)
+  {
+    float* box = &cell_box_[4 * cell];
+    box[0] = box[1] = std::numeric_limits<float>::max();
+    box[2] = box[3] = -std::numeric_limits<float>::max();
+    for (int p = cell_start_[cell]; p < cell_start_[cell + 1]; p++)
+    {
+      point_cell_[points_[p].index] = cell;
+      box[0] = std::min(box[0], points_[p].x);
+      box[1] = std::min(box[1], points_[p].y);
+      box[2] = std::max(box[2], points_[p].x);
+      box[3] = std::max(box[3], points_[p].y);
+    }
+  }
+
+  // Union of the connected cells. Each band of rows is connected by its own thread, which only touches the cells
+  // of its band, then the bands are connected to each other.
+  const double squared_threshold = threshold_ * threshold_;
+  parent_.resize(cells_num);
+  for (int cell = 0; cell < cells_num; cell++)
+    parent_[cell] = cell;
+
+  int bands_num = 1;
+#ifdef _OPENMP
+  bands_num = std::max(1, std::min(omp_get_max_threads(), rows_num / (4 * CELL_RANGE)));
+#endif
+  const int band_rows = (rows_num + bands_num - 1) / bands_num;
+
+#pragma omp parallel for num_threads(bands_num) schedule(static, 1)
+  for (int band = 0; band < bands_num; band++)
+  {
+    const int band_end = std::min(rows_num, (band + 1) * band_rows);
+    for (int row = band * band_rows; row < band_end; row++)
+      connectRow(row, row, band_end - 1, squared_threshold);
+  }
+
+  for (int band = 1; band < bands_num; band++)
+  {
+    const int band_start = band * band_rows;
+    for (int row = std::max(0, band_start - CELL_RANGE); row < band_start; row++)
+      connectRow(row, band_start, rows_num - 1, squared_threshold);
+  }
+
+  // Clusters are the components within the size limits
+  root_size_.assign(cells_num, 0);
+  for (int cell = 0; cell < cells_num; cell++)
+    root_size_[findRoot(cell)] += cell_start_[cell + 1] - cell_start_[cell];
+
+  root_cluster_.assign(cells_num, -1);
+  for (int cell = 0; cell < cells_num; cell++)
+  {
+    if (parent_[cell] == cell && root_size_[cell] >= min_cluster_pts_ && root_size_[cell] <= max_cluster_pts_)
+    {
+      root_cluster_[cell] = clusters_.size();
+      clusters_.push_back(pcl::PointIndices());
+      clusters_.back().indices.reserve(root_size_[cell]);
+    }
+  }
+
+  for (int i = 0; i < points_num; i++)
+  {
+    if (point_cell_[i] < 0)
+      continue;
+    const int cluster = root_cluster_[findRoot(point_cell_[i])];
+    if (cluster >= 0)
+      clusters_[cluster].indices.push_back(i);
+  }
+
+  std::stable_sort(clusters_.begin(), clusters_.end(), [](const pcl::PointIndices& a, const pcl::PointIndices& b) {
+    return a.indices.size() > b.indices.size();
+  });
+}
+
+bool GridEuclideanCluster::isConnected(int cell_a, int cell_b, double squared_threshold) const
+{
+  // The bounding boxes of the points of the cells decide most pairs without looking at the points
+  const float* box_a = &cell_box_[4 * cell_a];
+  const float* box_b = &cell_box_[4 * cell_b];
+  const double gap_x = std::max(0.0f, std::max(box_a[0] - box_b[2], box_b[0] - box_a[2]));
+  const double gap_y = std::max(0.0f, std::max(box_a[1] - box_b[3], box_b[1] - box_a[3]));
+  if (gap_x * gap_x + gap_y * gap_y > squared_threshold)
+    return false;
+  const double span_x = std::max(box_a[2], box_b[2]) - std::min(box_a[0], box_b[0]);
+  const double span_y = std::max(box_a[3], box_b[3]) - std::min(box_a[1], box_b[1]);
+  if (span_x * span_x + span_y * span_y <= squared_threshold)
+    return true;
+
+  for (int a = cell_start_[cell_a]; a < cell_start_[cell_a + 1]; a++)
+  {
+    for (int b = cell_start_[cell_b]; b < cell_start_[cell_b + 1]; b++)
+    {
+      const double dx = points_[a].x - points_[b].x;
+      const double dy = points_[a].y - points_[b].y;
+      if (dx * dx + dy * dy <= squared_threshold)
+        return true;
+    }
+  }
+  return false;
+}
+
+void GridEuclideanCluster::connectRow(int row, int min_other_row, int max_other_row, double squared_threshold)
+{
+  const bool same_row = min_other_row <= row;
+  min_other_row = std::max(min_other_row, row + 1);
+  max_other_row = std::min(max_other_row, row + CELL_RANGE);
+
+  // First cell of each following row that may be close to the current cell, the columns only increase
+  int others[CELL_RANGE];
+  for (int other_row = min_other_row; other_row <= max_other_row; other_row++)
+    others[other_row - row - 1] = row_cell_start_[other_row];
+
+  for (int cell = row_cell_start_[row]; cell < row_cell_start_[row + 1]; cell++)
+  {
+    const int col = cell_col_[cell];
+
+    // Following cells of the same row
+    if (same_row)
+    {
+      for (int other = cell + 1; other < row_cell_start_[row + 1] && cell_col_[other] <= col + CELL_RANGE; other++)
+        connectCells(cell, other, squared_threshold);
+    }
+
+    // Cells of the following rows
+    for (int other_row = min_other_row; other_row <= max_other_row; other_row++)
+    {
+      const int row_end = row_cell_start_[other_row + 1];
+      int& first = others[other_row - row - 1];
+      while (first < row_end && cell_col_[first] < col - CELL_RANGE)
+        first++;
+      for (int other = first; other < row_end && cell_col_[other] <= col + CELL_RANGE; other++)
+        connectCells(cell, other, squared_threshold);
+    }
+  }
+}
+
+void GridEuclideanCluster::connectCells(int cell_a, int cell_b, double squared_threshold)
+{
+  const int root_a = findRoot(cell_a);
+  const int root_b = findRoot(cell_b);
+  if (root_a == root_b || !isConnected(cell_a, cell_b, squared_threshold))
+    return;
+  if (root_a < root_b)
+    parent_[root_b] = root_a;
+  else
+    parent_[root_a] = root_b;
+}
+
+int GridEuclideanCluster::findRoot(int cell)
+{
+  while (parent_[cell] != cell)
+  {
+    parent_[cell] = parent_[parent_[cell]];
+    cell = parent_[cell];
+  }
+  return cell;
+}
@@ -13,6 +13,8 @@
 #include <pcl_ros/transforms.h>
 #include <pcl_ros/point_cloud.h>
 
+#include <pointcloud2_view/pointcloud2_view.hpp>
+
 #include <pcl/ModelCoefficients.h>
 #include <pcl/point_types.h>
 
@@ -73,6 +75,8 @@
 #endif
 
 #include "cluster.h"
+#include "grid_euclidean_clustering.h"
+#include "remove_points_up_to.h"
 
 #ifdef GPU_CLUSTERING
 
@@ -123,6 +127,8 @@ static double _cluster_merge_threshold;
 static double _clustering_distance;
 
 static bool _use_gpu;
+static bool _use_grid_clustering;
+static GridEuclideanCluster _grid_cluster;
 static std::chrono::system_clock::time_point _start, _end;
 
 std::vector<std::vector<geometry_msgs::Point>> _way_area_points;
@@ -407,11 +413,43 @@ std::vector<ClusterPtr> clusterAndColorGpu(const pcl::PointCloud<pcl::PointXYZ>:
 
 #endif
 
+std::vector<ClusterPtr> clusterAndColorGrid(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_ptr,
+                                            pcl::PointCloud<pcl::PointXYZRGB>::Ptr out_cloud_ptr,
+                                            autoware_msgs::Centroids &in_out_centroids,
+                                            double in_max_cluster_distance = 0.5)
+{
+  std::vector<ClusterPtr> clusters;
+
+  _grid_cluster.setInputPoints(in_cloud_ptr);
+  _grid_cluster.setThreshold(in_max_cluster_distance);
+  _grid_cluster.setMinClusterPts(_cluster_size_min);
+  _grid_cluster.setMaxClusterPts(_cluster_size_max);
+  _grid_cluster.extractClusters();
+  const std::vector<pcl::PointIndices> &cluster_indices = _grid_cluster.getOutput();
+
+  unsigned int k = 0;
+
+  for (auto it = cluster_indices.begin(); it != cluster_indices.end(); it++)
+  {
+    ClusterPtr cluster(new Cluster());
+    cluster->SetCloud(in_cloud_ptr, it->indices, _velodyne_header, k, (int) _colors[k].val[0],
+                      (int) _colors[k].val[1], (int) _colors[k].val[2], "", _pose_estimation);
+    clusters.push_back(cluster);
+
+    k++;
+  }
+
+  return clusters;
+}
+
 std::vector<ClusterPtr> clusterAndColor(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_ptr,
                                         pcl::PointCloud<pcl::PointXYZRGB>::Ptr out_cloud_ptr,
                                         autoware_msgs::Centroids &in_out_centroids,
                                         double in_max_cluster_distance = 0.5)
 {
+  if (_use_grid_clustering)
+    return clusterAndColorGrid(in_cloud_ptr, out_cloud_ptr, in_out_centroids, in_max_cluster_distance);
+
   pcl::search::KdTree<pcl::PointXYZ>::Ptr tree(new pcl::search::KdTree<pcl::PointXYZ>);
 
   // create 2d pc
@@ -835,20 +873,6 @@ void differenceNormalsSegmentation(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_
   pcl::copyPointCloud<pcl::PointNormal, pcl::PointXYZ>(*diffnormals_cloud, *out_cloud_ptr);
 }
 
-void removePointsUpTo(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_ptr,
-                      pcl::PointCloud<pcl::PointXYZ>::Ptr out_cloud_ptr, const double in_distance)
-{
-  out_cloud_ptr->points.clear();
-  for (unsigned int i = 0; i < in_cloud_ptr->points.size(); i++)
-  {
-    float origin_distance = sqrt(pow(in_cloud_ptr->points[i].x, 2) + pow(in_cloud_ptr->points[i].y, 2));
-    if (origin_distance > in_distance)
-    {
-      out_cloud_ptr->points.push_back(in_cloud_ptr->points[i]);
-    }
-  }
-}
-
 void velodyne_callback(const sensor_msgs::PointCloud2ConstPtr& in_sensor_cloud)
 {
   //_start = std::chrono::system_clock::now();
@@ -857,7 +881,6 @@ void velodyne_callback(const sensor_msgs::PointCloud2ConstPtr& in_sensor_cloud)
   {
     _using_sensor_cloud = true;
 
-    pcl::PointCloud<pcl::PointXYZ>::Ptr current_sensor_cloud_ptr(new pcl::PointCloud<pcl::PointXYZ>);
     pcl::PointCloud<pcl::PointXYZ>::Ptr removed_points_cloud_ptr(new pcl::PointCloud<pcl::PointXYZ>);
     pcl::PointCloud<pcl::PointXYZ>::Ptr downsampled_cloud_ptr(new pcl::PointCloud<pcl::PointXYZ>);
     pcl::PointCloud<pcl::PointXYZ>::Ptr inlanes_cloud_ptr(new pcl::PointCloud<pcl::PointXYZ>);
@@ -870,18 +893,21 @@ void velodyne_callback(const sensor_msgs::PointCloud2ConstPtr& in_sensor_cloud)
     autoware_msgs::Centroids centroids;
     autoware_msgs::CloudClusterArray cloud_clusters;
 
-    pcl::fromROSMsg(*in_sensor_cloud, *current_sensor_cloud_ptr);
-
-    _velodyne_header = in_sensor_cloud->header;
-
-    if (_remove_points_upto > 0.0)
+    // Read the points directly from the message instead of converting the whole cloud first
+    try
     {
-      removePointsUpTo(current_sensor_cloud_ptr, removed_points_cloud_ptr, _remove_points_upto);
+      pointcloud2_view::PointCloud2View sensor_cloud_view(*in_sensor_cloud);
+      removePointsUpTo(sensor_cloud_view, removed_points_cloud_ptr, _remove_points_upto);
     }
-    else
+    catch (std::runtime_error& e)
     {
-      removed_points_cloud_ptr = current_sensor_cloud_ptr;
+      ROS_ERROR_THROTTLE(10, "%s", e.what());
+      _using_sensor_cloud = false;
+      return;
     }
+    pcl_conversions::toPCL(in_sensor_cloud->header, removed_points_cloud_ptr->header);
+
+    _velodyne_header = in_sensor_cloud->header;
 
     if (_downsample_cloud)
       downsampleCloud(removed_points_cloud_ptr, downsampled_cloud_ptr, _leaf_size);
@@ -1018,6 +1044,8 @@ int main(int argc, char **argv)
 
   private_nh.param("use_gpu", _use_gpu, false);
   ROS_INFO("[%s] use_gpu: %d", __APP_NAME__, _use_gpu);
+  private_nh.param("use_grid_clustering", _use_grid_clustering, false);
+  ROS_INFO("[%s] use_grid_clustering: %d", __APP_NAME__, _use_grid_clustering);
 
   private_nh.param("use_multiple_thres", _use_multiple_thres, false);
   ROS_INFO("[%s] use_multiple_thres: %d", __APP_NAME__, _use_multiple_thres);
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2018-2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/segmentation/extract_clusters.h>
+
+#include "grid_euclidean_clustering.h"
+
+class GridEuclideanClusterTestSuite : public ::testing::Test
+{
+protected:
+  typedef std::vector<std::vector<int>> Clusters;
+
+  // Clusters of EuclideanClusterExtraction on the flattened cloud, as clusterAndColor computes them
+  static Clusters ExtractPcl(const pcl::PointCloud<pcl::PointXYZ>& in_cloud, double threshold, int min_size,
+                             int max_size)
+  {
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_2d(new pcl::PointCloud<pcl::PointXYZ>(in_cloud));
+    for (size_t i = 0; i < cloud_2d->points.size(); i++)
+      cloud_2d->points[i].z = 0;
+
+    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree(new pcl::search::KdTree<pcl::PointXYZ>);
+    tree->setInputCloud(cloud_2d);
+    std::vector<pcl::PointIndices> cluster_indices;
+    pcl::EuclideanClusterExtraction<pcl::PointXYZ> ec;
+    ec.setClusterTolerance(threshold);
+    ec.setMinClusterSize(min_size);
+    ec.setMaxClusterSize(max_size);
+    ec.setSearchMethod(tree);
+    ec.setInputCloud(cloud_2d);
+    ec.extract(cluster_indices);
+    return Normalize(cluster_indices);
+  }
+
+  static Clusters ExtractGrid(const pcl::PointCloud<pcl::PointXYZ>& in_cloud, double threshold, int min_size,
+                              int max_size, std::vector<pcl::PointIndices>* out_indices = nullptr)
+  {
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>(in_cloud));
+    GridEuclideanCluster grid_cluster;
+    grid_cluster.setInputPoints(cloud);
+    grid_cluster.setThreshold(threshold);
+    grid_cluster.setMinClusterPts(min_size);
+    grid_cluster.setMaxClusterPts(max_size);
+    grid_cluster.extractClusters();
+    if (out_indices)
+      *out_indices = grid_cluster.getOutput();
+    return Normalize(grid_cluster.getOutput());
+  }
+
+  // The indices of each cluster in increasing order, the clusters by their first index
+  static Clusters Normalize(const std::vector<pcl::PointIndices>& cluster_indices)
+  {
+    Clusters clusters;
+    for (const auto& indices : cluster_indices)
+    {
+      clusters.push_back(indices.indices);
+      std::sort(clusters.back().begin(), clusters.back().end());
+    }
+    std::sort(clusters.begin(), clusters.end());
+    return clusters;
+  }
+
+  // Coordinates on a grid of 0.125 m, so that the squared distances are exact and many pairs of points are exactly
+  // at the thresholds used below
+  static pcl::PointCloud<pcl::PointXYZ> RandomCloud(std::mt19937& rng, int points_num, int extent)
+  {
+    std::uniform_int_distribution<int> coordinate(-4 * extent, 4 * extent);
+    std::uniform_real_distribution<float> height(-2.0, 3.0);
+    pcl::PointCloud<pcl::PointXYZ> cloud;
+    for (int i = 0; i < points_num; i++)
+      cloud.points.push_back(pcl::PointXYZ(coordinate(rng) * 0.125f, coordinate(rng) * 0.125f, height(rng)));
+    return cloud;
+  }
+};
+
+TEST_F(GridEuclideanClusterTestSuite, matchesEuclideanClusterExtraction)
+{
+  std::mt19937 rng(10);
+  const double thresholds[] = { 0.25, 0.5, 0.625, 0.75, 1.0 };
+  for (int cloud_index = 0; cloud_index < 10; cloud_index++)
+  {
+    const pcl::PointCloud<pcl::PointXYZ> cloud = RandomCloud(rng, 3000, 10 + 2 * cloud_index);
+    for (double threshold : thresholds)
+    {
+      EXPECT_EQ(ExtractPcl(cloud, threshold, 1, 1000000), ExtractGrid(cloud, threshold, 1, 1000000))
+          << "cloud " << cloud_index << " threshold " << threshold;
+      EXPECT_EQ(ExtractPcl(cloud, threshold, 5, 200), ExtractGrid(cloud, threshold, 5, 200))
+          << "cloud " << cloud_index << " threshold " << threshold;
+    }
+  }
+}
+
+TEST_F(GridEuclideanClusterTestSuite, connectsPointsAtThreshold)
+{
+  // Pairs of points exactly at the threshold along x, along y and along a 3-4-5 diagonal, at different heights
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  cloud.points.push_back(pcl::PointXYZ(0.0, 0.0, 0.0));
+  cloud.points.push_back(pcl::PointXYZ(0.625, 0.0, 1.0));
+  cloud.points.push_back(pcl::PointXYZ(10.0, 0.0, 0.0));
+  cloud.points.push_back(pcl::PointXYZ(10.0, 0.625, -1.0));
+  cloud.points.push_back(pcl::PointXYZ(20.0, 20.0, 0.0));
+  cloud.points.push_back(pcl::PointXYZ(20.375, 20.5, 2.0));
+  // and a chain of points just farther apart than the threshold
+  for (int i = 0; i < 4; i++)
+    cloud.points.push_back(pcl::PointXYZ(-10.0 - i * 0.626, -10.0, 0.0));
+
+  const Clusters expected = { { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6 }, { 7 }, { 8 }, { 9 } };
+  EXPECT_EQ(expected, ExtractPcl(cloud, 0.625, 1, 100));
+  EXPECT_EQ(expected, ExtractGrid(cloud, 0.625, 1, 100));
+}
+
+TEST_F(GridEuclideanClusterTestSuite, sortsClustersBySize)
+{
+  std::mt19937 rng(11);
+  const pcl::PointCloud<pcl::PointXYZ> cloud = RandomCloud(rng, 2000, 15);
+  std::vector<pcl::PointIndices> cluster_indices;
+  ExtractGrid(cloud, 0.5, 1, 1000000, &cluster_indices);
+  ASSERT_GT(cluster_indices.size(), 1u);
+  for (size_t i = 1; i < cluster_indices.size(); i++)
+    EXPECT_GE(cluster_indices[i - 1].indices.size(), cluster_indices[i].indices.size());
+  for (const auto& indices : cluster_indices)
+    EXPECT_TRUE(std::is_sorted(indices.indices.begin(), indices.indices.end()));
+}
+
+TEST_F(GridEuclideanClusterTestSuite, skipsFarAndNonFinitePoints)
+{
+  // Outliers far enough to overflow an int cell coordinate must not change the clusters of the other points
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  cloud.points.push_back(pcl::PointXYZ(0.0, 0.0, 0.0));
+  cloud.points.push_back(pcl::PointXYZ(0.25, 0.0, 0.0));
+  cloud.points.push_back(pcl::PointXYZ(1e30, 0.0, 0.0));
+  cloud.points.push_back(pcl::PointXYZ(0.0, -1e12, 0.0));
+  cloud.points.push_back(pcl::PointXYZ(std::numeric_limits<float>::quiet_NaN(), 0.0, 0.0));
+  cloud.points.push_back(pcl::PointXYZ(0.0, std::numeric_limits<float>::infinity(), 0.0));
+  cloud.points.push_back(pcl::PointXYZ(5.0, 5.0, 0.0));
+
+  const Clusters expected = { { 0, 1 }, { 6 } };
+  EXPECT_EQ(expected, ExtractGrid(cloud, 0.5, 1, 100));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include <sensor_msgs/PointCloud2.h>
+
+#include "remove_points_up_to.h"
+
+class RemovePointsUpToTestSuite : public ::testing::Test
+{
+protected:
+  static void addField(sensor_msgs::PointCloud2& msg, const std::string& name, uint32_t offset)
+  {
+    sensor_msgs::PointField field;
+    field.name = name;
+    field.offset = offset;
+    field.datatype = sensor_msgs::PointField::FLOAT32;
+    field.count = 1;
+    msg.fields.push_back(field);
+  }
+
+  // An unorganized x, y, z, intensity cloud with a NaN point and a point at infinity, marked as not dense
+  static sensor_msgs::PointCloud2 makeMessage()
+  {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    const float values[5][4] = { { 1, 0, 0, 10 },
+                                 { nan, 2, 3, 20 },
+                                 { 5, 5, -1, 30 },
+                                 { 0, inf, 1, 40 },
+                                 { -0.5f, 0.5f, 2, 50 } };
+    sensor_msgs::PointCloud2 msg;
+    msg.width = 5;
+    msg.height = 1;
+    addField(msg, "x", 0);
+    addField(msg, "y", 4);
+    addField(msg, "z", 8);
+    addField(msg, "intensity", 12);
+    msg.point_step = 16;
+    msg.row_step = msg.point_step * msg.width;
+    msg.is_dense = 0;
+    msg.data.resize(sizeof(values));
+    std::memcpy(&msg.data[0], values, sizeof(values));
+    return msg;
+  }
+};
+
+TEST_F(RemovePointsUpToTestSuite, keepsFinitePointsWithoutDistance)
+{
+  const sensor_msgs::PointCloud2 msg = makeMessage();
+  pcl::PointCloud<pcl::PointXYZ>::Ptr out_cloud_ptr(new pcl::PointCloud<pcl::PointXYZ>);
+  removePointsUpTo(pointcloud2_view::PointCloud2View(msg), out_cloud_ptr, 0.0);
+
+  ASSERT_EQ(3u, out_cloud_ptr->points.size());
+  EXPECT_EQ(3u, out_cloud_ptr->width);
+  EXPECT_EQ(1u, out_cloud_ptr->height);
+  EXPECT_TRUE(out_cloud_ptr->is_dense);
+  EXPECT_EQ(1, out_cloud_ptr->points[0].x);
+  EXPECT_EQ(5, out_cloud_ptr->points[1].y);
+  EXPECT_EQ(-1, out_cloud_ptr->points[1].z);
+  EXPECT_EQ(-0.5f, out_cloud_ptr->points[2].x);
+  EXPECT_EQ(2, out_cloud_ptr->points[2].z);
+}
+
+TEST_F(RemovePointsUpToTestSuite, removesNearAndNonFinitePoints)
+{
+  const sensor_msgs::PointCloud2 msg = makeMessage();
+  pcl::PointCloud<pcl::PointXYZ>::Ptr out_cloud_ptr(new pcl::PointCloud<pcl::PointXYZ>);
+  // the output is cleared first
+  out_cloud_ptr->points.push_back(pcl::PointXYZ(100, 100, 100));
+  out_cloud_ptr->is_dense = false;
+  removePointsUpTo(pointcloud2_view::PointCloud2View(msg), out_cloud_ptr, 0.9);
+
+  ASSERT_EQ(2u, out_cloud_ptr->points.size());
+  EXPECT_EQ(2u, out_cloud_ptr->width);
+  EXPECT_TRUE(out_cloud_ptr->is_dense);
+  EXPECT_EQ(1, out_cloud_ptr->points[0].x);
+  EXPECT_EQ(5, out_cloud_ptr->points[1].x);
+  for (const pcl::PointXYZ& point : out_cloud_ptr->points)
+  {
+    EXPECT_TRUE(std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.z));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
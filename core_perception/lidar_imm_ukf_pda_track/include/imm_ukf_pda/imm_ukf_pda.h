@@ -39,6 +39,8 @@
 #include "autoware_msgs/DetectedObjectArray.h"
 
 #include "ukf.h"
+#include "lane_direction_index.h"
+#include "target_association.h"
 
 class ImmUkfPda
 {
@@ -57,6 +59,13 @@ private:
   // object association param
   int life_time_threshold_;
 
+  // batched association of the targets with the detections of a frame
+  TargetAssociation association_;
+  AssociationGates association_gates_;
+  AssociationDetections association_detections_;
+  std::vector<int> associated_detection_indices_;
+  std::vector<double> associated_nis_values_;
+
   // static classification param
   double static_velocity_threshold_;
   int static_num_history_threshold_;
@@ -82,7 +91,7 @@ private:
   double nearest_lane_distance_threshold_;
   std::string vectormap_frame_;
   vector_map::VectorMap vmap_;
-  std::vector<vector_map_msgs::Lane> lanes_;
+  LaneDirectionIndex lane_direction_index_;
 
   double merge_distance_threshold_;
   const double CENTROID_DISTANCE = 0.2;//distance to consider centroids the same
@@ -115,8 +124,10 @@ private:
 
   bool updateNecessaryTransform();
 
+  bool makeAssociationGate(UKF& target, AssociationGate& gate);
+
   void measurementValidation(const autoware_msgs::DetectedObjectArray& input, UKF& target, const bool second_init,
-                             const Eigen::VectorXd& max_det_z, const Eigen::MatrixXd& max_det_s,
+                             const int detection_index, const double nis,
                              std::vector<autoware_msgs::DetectedObject>& object_vec, std::vector<bool>& matching_vec);
   autoware_msgs::DetectedObject getNearestObject(UKF& target,
                                                  const std::vector<autoware_msgs::DetectedObject>& object_vec);
@@ -128,7 +139,7 @@ private:
   void updateTrackingNum(const std::vector<autoware_msgs::DetectedObject>& object_vec, UKF& target);
 
   bool probabilisticDataAssociation(const autoware_msgs::DetectedObjectArray& input, const double dt,
-                                    std::vector<bool>& matching_vec,
+                                    const int detection_index, const double nis, std::vector<bool>& matching_vec,
                                     std::vector<autoware_msgs::DetectedObject>& object_vec, UKF& target);
   void makeNewTargets(const double timestamp, const autoware_msgs::DetectedObjectArray& input,
                       const std::vector<bool>& matching_vec);
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBJECT_TRACKING_LANE_DIRECTION_INDEX_H
+#define OBJECT_TRACKING_LANE_DIRECTION_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <vector_map/vector_map.h>
+
+// Begin point and direction of the vectormap lanes, so that the lane nearest to an object is found among the lanes
+// the spatial index of the vector map finds around it instead of all the lanes of the map.
+class LaneDirectionIndex
+{
+public:
+  // Computes the direction of every lane from its begin and front points
+  void build(const vector_map::VectorMap& vmap, const std::vector<vector_map_msgs::Lane>& lanes);
+
+  // Direction of the lane whose begin point is the nearest to (x, y), if closer than max_distance.
+  // On equal distances, the first lane of the list given to build.
+  bool findNearestLaneDirection(const vector_map::VectorMap& vmap, const double x, const double y,
+                                const double max_distance, double& yaw) const;
+
+private:
+  struct LaneDirection
+  {
+    double x;
+    double y;
+    double yaw;
+  };
+
+  std::vector<LaneDirection> lane_directions_;
+  std::unordered_map<int, int> lane_indices_;  // index in lane_directions_ of each lnid
+
+  void checkLane(const int lane, const double x, const double y, int& nearest_lane,
+                 double& nearest_squared_distance) const;
+};
+
+#endif /* OBJECT_TRACKING_LANE_DIRECTION_INDEX_H */
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBJECT_TRACKING_TARGET_ASSOCIATION_H
+#define OBJECT_TRACKING_TARGET_ASSOCIATION_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Eigen/Dense"
+#include "Eigen/StdVector"
+
+#include <vector_map/cell_grid.h>
+
+// Validation gate of a target: measurements whose NIS (diff^T S^-1 diff) is below the gating threshold
+struct AssociationGate
+{
+  bool is_valid;
+  Eigen::Vector2d z;        // predicted measurement
+  Eigen::Matrix2d s_inv;    // inverse of the innovation covariance
+  double radius;            // distance from z outside of which the NIS is above the threshold
+
+  AssociationGate() : is_valid(false), z(Eigen::Vector2d::Zero()), s_inv(Eigen::Matrix2d::Zero()), radius(0)
+  {
+  }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+typedef std::vector<AssociationGate, Eigen::aligned_allocator<AssociationGate> > AssociationGates;
+typedef std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > AssociationDetections;
+
+// Association of all the targets of a frame with the detections of the frame.
+// The inverse of the innovation covariance is computed once per target, and the detections are binned in a 2D
+// grid so that a target only computes the NIS of the detections in the cells overlapping its gate.
+// NEAREST gives each target the detection with the smallest NIS in its gate, as the per target loop did, so a
+// detection may be given to several targets. GLOBAL_NEAREST gives each detection to at most one target,
+// minimizing the sum of the NIS of the pairs plus the gating threshold for each target left without detection
+// (Hungarian method on the gated pairs).
+class TargetAssociation
+{
+public:
+  enum Method
+  {
+    NEAREST,
+    GLOBAL_NEAREST,
+  };
+
+  TargetAssociation();
+
+  void setGatingThreshold(const double gating_threshold);
+  void setMethod(const Method method);
+
+  // false if the name is not "nearest" or "global_nearest"
+  static bool parseMethod(const std::string& name, Method& method);
+
+  // Builds the gate of a target from its predicted measurement and innovation covariance
+  AssociationGate makeGate(const Eigen::Vector2d& z, const Eigen::Matrix2d& s) const;
+
+  // For each gate, the index of the associated detection, or -1, and its NIS
+  void associate(const AssociationGates& gates, const AssociationDetections& detections,
+                 std::vector<int>& detection_indices, std::vector<double>& nis_values);
+
+private:
+  // gates larger than this number of cells on a side check all the detections
+  static const int MAX_GATE_CELLS = 64;
+
+  struct GatedPair
+  {
+    int gate;
+    int detection;
+    double nis;
+  };
+
+  double gating_threshold_;
+  Method method_;
+
+  // Buffers reused from one frame to the next
+  vector_map::CellGrid grid_;
+  std::vector<GatedPair> pairs_;
+
+  void buildGrid(const AssociationGates& gates, const AssociationDetections& detections);
+  void findGatedPairs(const AssociationGates& gates, const AssociationDetections& detections);
+  void assignNearest(std::vector<int>& detection_indices, std::vector<double>& nis_values) const;
+  void assignGlobalNearest(std::vector<int>& detection_indices, std::vector<double>& nis_values) const;
+};
+
+#endif /* OBJECT_TRACKING_TARGET_ASSOCIATION_H */
@@ -52,6 +52,31 @@ class UKF
   */
 
 public:
+  static const int NUM_STATE = 5;
+  static const int NUM_SIGMA = 2 * NUM_STATE + 1;
+  static const int NUM_LIDAR_STATE = 2;
+  static const int NUM_LIDAR_DIRECTION_STATE = 3;
+  static const int NUM_MOTION_MODEL = 3;
+
+  // Fixed-size matrices, so that prediction and update do not allocate. They are not aligned because the targets
+  // are stored by value in std::vector.
+  template <int Rows, int Cols>
+  using Matrix = Eigen::Matrix<double, Rows, Cols, Eigen::DontAlign>;
+  template <int Rows>
+  using Vector = Eigen::Matrix<double, Rows, 1, Eigen::DontAlign>;
+
+  typedef Vector<NUM_STATE> StateVector;
+  typedef Matrix<NUM_STATE, NUM_STATE> StateMatrix;
+  typedef Matrix<NUM_STATE, NUM_SIGMA> SigmaMatrix;
+  typedef Vector<NUM_SIGMA> SigmaWeights;
+  typedef Vector<NUM_LIDAR_STATE> LidarVector;
+  typedef Matrix<NUM_LIDAR_STATE, NUM_LIDAR_STATE> LidarMatrix;
+  typedef Matrix<NUM_STATE, NUM_LIDAR_STATE> LidarGain;
+  typedef Vector<NUM_LIDAR_DIRECTION_STATE> DirectionVector;
+  typedef Matrix<NUM_LIDAR_DIRECTION_STATE, NUM_LIDAR_DIRECTION_STATE> DirectionMatrix;
+  typedef Matrix<NUM_STATE, NUM_LIDAR_DIRECTION_STATE> DirectionGain;
+  typedef Vector<NUM_MOTION_MODEL> ModelVector;
+
   int ukf_id_;
 
   int num_state_;
@@ -63,37 +88,37 @@ public:
   int num_motion_model_;
 
   //* state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
-  Eigen::MatrixXd x_merge_;
+  StateVector x_merge_;
 
   //* state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
-  Eigen::MatrixXd x_cv_;
+  StateVector x_cv_;
 
   //* state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
-  Eigen::MatrixXd x_ctrv_;
+  StateVector x_ctrv_;
 
   //* state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
-  Eigen::MatrixXd x_rm_;
+  StateVector x_rm_;
 
   //* state covariance matrix
-  Eigen::MatrixXd p_merge_;
+  StateMatrix p_merge_;
 
   //* state covariance matrix
-  Eigen::MatrixXd p_cv_;
+  StateMatrix p_cv_;
 
   //* state covariance matrix
-  Eigen::MatrixXd p_ctrv_;
+  StateMatrix p_ctrv_;
 
   //* state covariance matrix
-  Eigen::MatrixXd p_rm_;
+  StateMatrix p_rm_;
 
   //* predicted sigma points matrix
-  Eigen::MatrixXd x_sig_pred_cv_;
+  SigmaMatrix x_sig_pred_cv_;
 
   //* predicted sigma points matrix
-  Eigen::MatrixXd x_sig_pred_ctrv_;
+  SigmaMatrix x_sig_pred_ctrv_;
 
   //* predicted sigma points matrix
-  Eigen::MatrixXd x_sig_pred_rm_;
+  SigmaMatrix x_sig_pred_rm_;
 
   //* time when the state is true, in us
   long long time_;
@@ -117,8 +142,8 @@ public:
   double std_laspy_;
 
   //* Weights of sigma points
-  Eigen::VectorXd weights_c_;
-  Eigen::VectorXd weights_s_;
+  SigmaWeights weights_c_;
+  SigmaWeights weights_s_;
 
   //* Sigma point spreading parameter
   double lambda_;
@@ -151,17 +176,17 @@ public:
 
   std::vector<double> p3_;
 
-  Eigen::VectorXd z_pred_cv_;
-  Eigen::VectorXd z_pred_ctrv_;
-  Eigen::VectorXd z_pred_rm_;
+  LidarVector z_pred_cv_;
+  LidarVector z_pred_ctrv_;
+  LidarVector z_pred_rm_;
 
-  Eigen::MatrixXd s_cv_;
-  Eigen::MatrixXd s_ctrv_;
-  Eigen::MatrixXd s_rm_;
+  LidarMatrix s_cv_;
+  LidarMatrix s_ctrv_;
+  LidarMatrix s_rm_;
 
-  Eigen::MatrixXd k_cv_;
-  Eigen::MatrixXd k_ctrv_;
-  Eigen::MatrixXd k_rm_;
+  LidarGain k_cv_;
+  LidarGain k_ctrv_;
+  LidarGain k_rm_;
 
   double pd_;
   double pg_;
@@ -176,67 +201,67 @@ public:
   double min_assiciation_distance_;
 
   // for env classification
-  Eigen::VectorXd init_meas_;
+  LidarVector init_meas_;
   std::vector<double> vel_history_;
 
   double x_merge_yaw_;
 
   int tracking_num_;
 
-  Eigen::VectorXd cv_meas_;
-  Eigen::VectorXd ctrv_meas_;
-  Eigen::VectorXd rm_meas_;
+  LidarVector cv_meas_;
+  LidarVector ctrv_meas_;
+  LidarVector rm_meas_;
 
-  Eigen::MatrixXd q_cv_;
-  Eigen::MatrixXd q_ctrv_;
-  Eigen::MatrixXd q_rm_;
+  StateMatrix q_cv_;
+  StateMatrix q_ctrv_;
+  StateMatrix q_rm_;
 
-  Eigen::MatrixXd r_cv_;
-  Eigen::MatrixXd r_ctrv_;
-  Eigen::MatrixXd r_rm_;
+  LidarMatrix r_cv_;
+  LidarMatrix r_ctrv_;
+  LidarMatrix r_rm_;
 
   double nis_cv_;
   double nis_ctrv_;
   double nis_rm_;
 
-  Eigen::MatrixXd new_x_sig_cv_;
-  Eigen::MatrixXd new_x_sig_ctrv_;
-  Eigen::MatrixXd new_x_sig_rm_;
+  SigmaMatrix new_x_sig_cv_;
+  SigmaMatrix new_x_sig_ctrv_;
+  SigmaMatrix new_x_sig_rm_;
 
-  Eigen::MatrixXd new_z_sig_cv_;
-  Eigen::MatrixXd new_z_sig_ctrv_;
-  Eigen::MatrixXd new_z_sig_rm_;
+  Matrix<NUM_LIDAR_STATE, NUM_SIGMA> new_z_sig_cv_;
+  Matrix<NUM_LIDAR_STATE, NUM_SIGMA> new_z_sig_ctrv_;
+  Matrix<NUM_LIDAR_STATE, NUM_SIGMA> new_z_sig_rm_;
 
-  Eigen::VectorXd new_z_pred_cv_;
-  Eigen::VectorXd new_z_pred_ctrv_;
-  Eigen::VectorXd new_z_pred_rm_;
+  LidarVector new_z_pred_cv_;
+  LidarVector new_z_pred_ctrv_;
+  LidarVector new_z_pred_rm_;
 
-  Eigen::MatrixXd new_s_cv_;
-  Eigen::MatrixXd new_s_ctrv_;
-  Eigen::MatrixXd new_s_rm_;
+  LidarMatrix new_s_cv_;
+  LidarMatrix new_s_ctrv_;
+  LidarMatrix new_s_rm_;
 
   // for lane direction combined filter
   bool is_direction_cv_available_;
   bool is_direction_ctrv_available_;
   bool is_direction_rm_available_;
   double std_lane_direction_;
-  Eigen::MatrixXd lidar_direction_r_cv_;
-  Eigen::MatrixXd lidar_direction_r_ctrv_;
-  Eigen::MatrixXd lidar_direction_r_rm_;
+  DirectionMatrix lidar_direction_r_cv_;
+  DirectionMatrix lidar_direction_r_ctrv_;
+  DirectionMatrix lidar_direction_r_rm_;
 
-  Eigen::VectorXd z_pred_lidar_direction_cv_;
-  Eigen::VectorXd z_pred_lidar_direction_ctrv_;
-  Eigen::VectorXd z_pred_lidar_direction_rm_;
+  DirectionVector z_pred_lidar_direction_cv_;
+  DirectionVector z_pred_lidar_direction_ctrv_;
+  DirectionVector z_pred_lidar_direction_rm_;
 
-  Eigen::MatrixXd s_lidar_direction_cv_;
-  Eigen::MatrixXd s_lidar_direction_ctrv_;
-  Eigen::MatrixXd s_lidar_direction_rm_;
+  DirectionMatrix s_lidar_direction_cv_;
+  DirectionMatrix s_lidar_direction_ctrv_;
+  DirectionMatrix s_lidar_direction_rm_;
 
-  Eigen::MatrixXd k_lidar_direction_cv_;
-  Eigen::MatrixXd k_lidar_direction_ctrv_;
-  Eigen::MatrixXd k_lidar_direction_rm_;
+  DirectionGain k_lidar_direction_cv_;
+  DirectionGain k_lidar_direction_ctrv_;
+  DirectionGain k_lidar_direction_rm_;
 
-  Eigen::VectorXd lidar_direction_ctrv_meas_;
+  DirectionVector lidar_direction_ctrv_meas_;
 
   /**
    * Constructor
@@ -245,9 +270,9 @@ public:
 
   void updateYawWithHighProb();
 
-  void initialize(const Eigen::VectorXd& z, const double timestamp, const int target_ind);
+  void initialize(const LidarVector& z, const double timestamp, const int target_ind);
 
-  void updateModeProb(const std::vector<double>& lambda_vec);
+  void updateModeProb(const ModelVector& lambda_vec);
 
   void mergeEstimationAndCovariance();
 
@@ -259,14 +284,14 @@ public:
 
   void predictionIMMUKF(const double dt, const bool has_subscribed_vectormap);
 
-  void findMaxZandS(Eigen::VectorXd& max_det_z, Eigen::MatrixXd& max_det_s);
+  void findMaxZandS(LidarVector& max_det_z, LidarMatrix& max_det_s);
 
   void updateMeasurementForCTRV(const std::vector<autoware_msgs::DetectedObject>& object_vec);
 
   void uppateForCTRV();
 
   void updateEachMotion(const double detection_probability, const double gate_probability, const double gating_threshold,
-                        const std::vector<autoware_msgs::DetectedObject>& object_vec, std::vector<double>& lambda_vec);
+                        const std::vector<autoware_msgs::DetectedObject>& object_vec, ModelVector& lambda_vec);
 
   void updateSUKF(const std::vector<autoware_msgs::DetectedObject>& object_vec);
 
@@ -274,13 +299,13 @@ public:
                     const std::vector<autoware_msgs::DetectedObject>& object_vec);
 
   void ctrv(const double p_x, const double p_y, const double v, const double yaw, const double yawd,
-            const double delta_t, std::vector<double>& state);
+            const double delta_t, StateVector& state);
 
   void cv(const double p_x, const double p_y, const double v, const double yaw, const double yawd, const double delta_t,
-          std::vector<double>& state);
+          StateVector& state);
 
   void randomMotion(const double p_x, const double p_y, const double v, const double yaw, const double yawd,
-                    const double delta_t, std::vector<double>& state);
+                    const double delta_t, StateVector& state);
 
   void initCovarQs(const double dt, const double yaw);
 
@@ -299,12 +324,31 @@ public:
   // void updateKalmanGain(const int motion_ind, const int num_meas_state);
   void updateKalmanGain(const int motion_ind);
 
-  double normalizeAngle(const double angle);
+  double normalizeAngle(const double angle) const;
 
   void update(const bool use_sukf, const double detection_probability, const double gate_probability,
               const double gating_threshold, const std::vector<autoware_msgs::DetectedObject>& object_vec);
 
   void prediction(const bool use_sukf, const bool has_subscribed_vectormap, const double dt);
+
+private:
+  template <int NumMeas>
+  void predictMeasurement(const SigmaMatrix& x_sig_pred, const Matrix<NumMeas, NumMeas>& covariance_r,
+                          Vector<NumMeas>& z_pred, Matrix<NumMeas, NumMeas>& s_pred) const;
+
+  template <int NumMeas>
+  void computeKalmanGain(const StateVector& x, const SigmaMatrix& x_sig_pred, const Vector<NumMeas>& z_pred,
+                         const Matrix<NumMeas, NumMeas>& s_pred, Matrix<NUM_STATE, NumMeas>& kalman_gain) const;
+
+  template <int NumMeas>
+  double updateMotion(const Vector<NumMeas>& z_pred, const Matrix<NumMeas, NumMeas>& s_pred,
+                      const Matrix<NUM_STATE, NumMeas>& kalman_gain, const double detection_probability,
+                      const double gate_probability, const double b, const double Vk,
+                      const std::vector<autoware_msgs::DetectedObject>& object_vec, StateVector& x, StateMatrix& p);
+
+  template <int NumMeas>
+  Vector<NumMeas> findMostLikelyMeasurement(const Vector<NumMeas>& z_pred, const Matrix<NumMeas, NumMeas>& s_pred,
+                                            const std::vector<autoware_msgs::DetectedObject>& object_vec) const;
 };
 
 #endif /* UKF_H */
@@ -125,7 +125,7 @@ private:
   bool updateNecessaryTransform();
 
   void measurementValidation(const autoware_msgs::DetectedObjectArray& input, UKF* target_ptr, const bool second_init,
-                             const Eigen::VectorXd& max_det_z, const Eigen::MatrixXd& max_det_s,
+                             const UKF::LidarVector& max_det_z, const UKF::LidarMatrix& max_det_s,
                              std::vector<autoware_msgs::DetectedObject>* object_vec_ptr,
                              std::vector<bool>* matching_vec_ptr);
   void updateBehaviorState(const UKF& target, const bool use_sukf, autoware_msgs::DetectedObject* object_ptr);
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays the DetectedObjectArray messages of a bag through the association of imm_ukf_pda.
+// The targets of a frame are the detections of the previous frame, with a fixed innovation covariance, and the
+// frames can be tiled to emulate busy scenes. The per target loop of measurementValidation is timed against
+// TargetAssociation with the nearest and global_nearest methods.
+//
+// usage: association_benchmark <bag> [topic] [copies] [innovation_std]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include "autoware_msgs/DetectedObjectArray.h"
+
+#include <imm_ukf_pda/target_association.h>
+
+namespace
+{
+const double GATING_THRESHOLD = 9.22;
+const double TILE_OFFSET = 1000.0;  // [m] between the copies of a frame
+
+struct Timing
+{
+  double total = 0;
+  double max = 0;
+
+  void add(double seconds)
+  {
+    total += seconds;
+    max = std::max(max, seconds);
+  }
+};
+
+// association as done before by measurementValidation, one target at a time
+void associatePerTarget(const AssociationDetections& targets, const Eigen::MatrixXd& s,
+                        const AssociationDetections& detections, std::vector<int>& detection_indices)
+{
+  detection_indices.assign(targets.size(), -1);
+  for (size_t t = 0; t < targets.size(); t++)
+  {
+    Eigen::VectorXd max_det_z = Eigen::VectorXd(2);
+    max_det_z << targets[t](0), targets[t](1);
+    double smallest_nis = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < detections.size(); i++)
+    {
+      Eigen::VectorXd meas = Eigen::VectorXd(2);
+      meas << detections[i](0), detections[i](1);
+
+      Eigen::VectorXd diff = meas - max_det_z;
+      double nis = diff.transpose() * s.inverse() * diff;
+      if (nis < GATING_THRESHOLD && nis < smallest_nis)
+      {
+        smallest_nis = nis;
+        detection_indices[t] = i;
+      }
+    }
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::fprintf(stderr, "usage: %s <bag> [topic] [copies] [innovation_std]\n", argv[0]);
+    return 1;
+  }
+  const std::string bag_path = argv[1];
+  const std::string topic = argc > 2 ? argv[2] : "/detection/fusion_tools/objects";
+  const int copies = argc > 3 ? std::max(1, std::atoi(argv[3])) : 1;
+  const double innovation_std = argc > 4 ? std::atof(argv[4]) : 1.0;
+
+  rosbag::Bag bag;
+  bag.open(bag_path, rosbag::bagmode::Read);
+  rosbag::View view(bag, rosbag::TopicQuery(std::vector<std::string>(1, topic)));
+
+  Eigen::MatrixXd s = Eigen::MatrixXd::Identity(2, 2) * innovation_std * innovation_std;
+
+  TargetAssociation nearest;
+  nearest.setGatingThreshold(GATING_THRESHOLD);
+  nearest.setMethod(TargetAssociation::NEAREST);
+  TargetAssociation global_nearest;
+  global_nearest.setGatingThreshold(GATING_THRESHOLD);
+  global_nearest.setMethod(TargetAssociation::GLOBAL_NEAREST);
+
+  typedef std::chrono::steady_clock Clock;
+  Timing per_target_time, nearest_time, global_nearest_time;
+  size_t frames_num = 0;
+  size_t pairs_num = 0;
+  size_t mismatched_frames_num = 0;
+  size_t nearest_associated_num = 0;
+  size_t global_nearest_associated_num = 0;
+
+  AssociationDetections targets;
+  AssociationDetections detections;
+  AssociationGates gates;
+  std::vector<int> per_target_indices, nearest_indices, global_nearest_indices;
+  std::vector<double> nis_values;
+
+  for (const rosbag::MessageInstance& message : view)
+  {
+    autoware_msgs::DetectedObjectArray::ConstPtr input = message.instantiate<autoware_msgs::DetectedObjectArray>();
+    if (!input)
+    {
+      continue;
+    }
+
+    detections.clear();
+    for (int copy = 0; copy < copies; copy++)
+    {
+      for (const auto& object : input->objects)
+      {
+        detections.push_back(
+            Eigen::Vector2d(object.pose.position.x + copy * TILE_OFFSET, object.pose.position.y));
+      }
+    }
+
+    if (!targets.empty() && !detections.empty())
+    {
+      Clock::time_point start = Clock::now();
+      associatePerTarget(targets, s, detections, per_target_indices);
+      per_target_time.add(std::chrono::duration<double>(Clock::now() - start).count());
+
+      start = Clock::now();
+      gates.resize(targets.size());
+      for (size_t t = 0; t < targets.size(); t++)
+      {
+        gates[t] = nearest.makeGate(targets[t], s);
+      }
+      nearest.associate(gates, detections, nearest_indices, nis_values);
+      nearest_time.add(std::chrono::duration<double>(Clock::now() - start).count());
+
+      start = Clock::now();
+      for (size_t t = 0; t < targets.size(); t++)
+      {
+        gates[t] = global_nearest.makeGate(targets[t], s);
+      }
+      global_nearest.associate(gates, detections, global_nearest_indices, nis_values);
+      global_nearest_time.add(std::chrono::duration<double>(Clock::now() - start).count());
+
+      frames_num++;
+      pairs_num += targets.size() * detections.size();
+      mismatched_frames_num += per_target_indices != nearest_indices;
+      nearest_associated_num +=
+          targets.size() - std::count(nearest_indices.begin(), nearest_indices.end(), -1);
+      global_nearest_associated_num +=
+          targets.size() - std::count(global_nearest_indices.begin(), global_nearest_indices.end(), -1);
+    }
+
+    targets.swap(detections);
+  }
+  bag.close();
+
+  if (frames_num == 0)
+  {
+    std::fprintf(stderr, "no DetectedObjectArray frames to associate on %s\n", topic.c_str());
+    return 1;
+  }
+
+  std::printf("%zu frames, %.1f targets x detections per frame\n", frames_num,
+              static_cast<double>(pairs_num) / frames_num);
+  std::printf("per target:     mean %.3f ms, max %.3f ms\n", per_target_time.total / frames_num * 1e3,
+              per_target_time.max * 1e3);
+  std::printf("nearest:        mean %.3f ms, max %.3f ms, %zu associations, %zu frames differ from per target\n",
+              nearest_time.total / frames_num * 1e3, nearest_time.max * 1e3, nearest_associated_num,
+              mismatched_frames_num);
+  std::printf("global_nearest: mean %.3f ms, max %.3f ms, %zu associations\n",
+              global_nearest_time.total / frames_num * 1e3, global_nearest_time.max * 1e3,
+              global_nearest_associated_num);
+  return 0;
+}
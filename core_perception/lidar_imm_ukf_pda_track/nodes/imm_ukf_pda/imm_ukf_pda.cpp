@@ -36,6 +36,16 @@ ImmUkfPda::ImmUkfPda()
   private_nh_.param<double>("merge_distance_threshold", merge_distance_threshold_, 0.5);
   private_nh_.param<bool>("use_sukf", use_sukf_, false);
 
+  std::string association_method;
+  private_nh_.param<std::string>("association_method", association_method, "nearest");
+  TargetAssociation::Method method = TargetAssociation::NEAREST;
+  if (!TargetAssociation::parseMethod(association_method, method))
+  {
+    ROS_WARN("Unknown association_method %s, using nearest", association_method.c_str());
+  }
+  association_.setMethod(method);
+  association_.setGatingThreshold(gating_threshold_);
+
   // for vectormap assisted tracking
   private_nh_.param<bool>("use_vectormap", use_vectormap_, false);
   private_nh_.param<double>("lane_direction_chi_threshold", lane_direction_chi_threshold_, 2.71);
@@ -99,13 +109,15 @@ void ImmUkfPda::checkVectormapSubscription()
 {
   if (use_vectormap_ && !has_subscribed_vectormap_)
   {
-    lanes_ = vmap_.findByFilter([](const vector_map_msgs::Lane& lane) { return true; });
-    if (lanes_.empty())
+    std::vector<vector_map_msgs::Lane> lanes =
+        vmap_.findByFilter([](const vector_map_msgs::Lane& lane) { return true; });
+    if (lanes.empty())
     {
       ROS_INFO("Has not subscribed vectormap");
     }
     else
     {
+      lane_direction_index_.build(vmap_, lanes);
       has_subscribed_vectormap_ = true;
     }
   }
@@ -186,40 +198,19 @@ geometry_msgs::Pose ImmUkfPda::getTransformedPose(const geometry_msgs::Pose& in_
 }
 
 void ImmUkfPda::measurementValidation(const autoware_msgs::DetectedObjectArray& input, UKF& target,
-                                      const bool second_init, const Eigen::VectorXd& max_det_z,
-                                      const Eigen::MatrixXd& max_det_s,
+                                      const bool second_init, const int detection_index, const double nis,
                                       std::vector<autoware_msgs::DetectedObject>& object_vec,
                                       std::vector<bool>& matching_vec)
 {
   // alert: different from original imm-pda filter, here picking up most likely measurement
   // if making it allows to have more than one measurement, you will see non semipositive definite covariance
-  bool exists_smallest_nis_object = false;
-  double smallest_nis = std::numeric_limits<double>::max();
-  int smallest_nis_ind = 0;
-  for (size_t i = 0; i < input.objects.size(); i++)
-  {
-    double x = input.objects[i].pose.position.x;
-    double y = input.objects[i].pose.position.y;
-
-    Eigen::VectorXd meas = Eigen::VectorXd(2);
-    meas << x, y;
-
-    Eigen::VectorXd diff = meas - max_det_z;
-    double nis = diff.transpose() * max_det_s.inverse() * diff;
-
-    if (nis < gating_threshold_)
-    {
-      if (nis < smallest_nis)
-      {
-        smallest_nis = nis;
-        target.object_ = input.objects[i];
-        smallest_nis_ind = i;
-        exists_smallest_nis_object = true;
-      }
-    }
-  }
+  // the measurement of each target was chosen for all the targets at once by association_
+  bool exists_smallest_nis_object = detection_index >= 0;
+  double smallest_nis = nis;
+  int smallest_nis_ind = detection_index;
   if (exists_smallest_nis_object)
   {
+    target.object_ = input.objects[smallest_nis_ind];
     matching_vec[smallest_nis_ind] = true;
     if (use_vectormap_ && has_subscribed_vectormap_)
     {
@@ -265,30 +256,10 @@ bool ImmUkfPda::storeObjectWithNearestLaneDirection(const autoware_msgs::Detecte
                                                  autoware_msgs::DetectedObject& out_object)
 {
   geometry_msgs::Pose lane_frame_pose = getTransformedPose(in_object.pose, tracking_frame2lane_frame_);
-  double min_dist = std::numeric_limits<double>::max();
-
   double min_yaw = 0;
-  for (auto const& lane : lanes_)
-  {
-    vector_map_msgs::Node node = vmap_.findByKey(vector_map::Key<vector_map_msgs::Node>(lane.bnid));
-    vector_map_msgs::Point point = vmap_.findByKey(vector_map::Key<vector_map_msgs::Point>(node.pid));
-    double distance = std::sqrt(std::pow(point.bx - lane_frame_pose.position.y, 2) +
-                                std::pow(point.ly - lane_frame_pose.position.x, 2));
-    if (distance < min_dist)
-    {
-      min_dist = distance;
-      vector_map_msgs::Node front_node = vmap_.findByKey(vector_map::Key<vector_map_msgs::Node>(lane.fnid));
-      vector_map_msgs::Point front_point = vmap_.findByKey(vector_map::Key<vector_map_msgs::Point>(front_node.pid));
-      min_yaw = std::atan2((front_point.bx - point.bx), (front_point.ly - point.ly));
-    }
-  }
-
-  bool success = false;
-  if (min_dist < nearest_lane_distance_threshold_)
-  {
-    success = true;
-  }
-  else
+  bool success = lane_direction_index_.findNearestLaneDirection(
+      vmap_, lane_frame_pose.position.x, lane_frame_pose.position.y, nearest_lane_distance_threshold_, min_yaw);
+  if (!success)
   {
     return success;
   }
@@ -352,7 +323,7 @@ void ImmUkfPda::initTracker(const autoware_msgs::DetectedObjectArray& input, dou
   {
     double px = input.objects[i].pose.position.x;
     double py = input.objects[i].pose.position.y;
-    Eigen::VectorXd init_meas = Eigen::VectorXd(2);
+    UKF::LidarVector init_meas;
     init_meas << px, py;
 
     UKF ukf;
@@ -437,14 +408,11 @@ void ImmUkfPda::updateTrackingNum(const std::vector<autoware_msgs::DetectedObjec
   return;
 }
 
-bool ImmUkfPda::probabilisticDataAssociation(const autoware_msgs::DetectedObjectArray& input, const double dt,
-                                             std::vector<bool>& matching_vec,
-                                             std::vector<autoware_msgs::DetectedObject>& object_vec, UKF& target)
+bool ImmUkfPda::makeAssociationGate(UKF& target, AssociationGate& gate)
 {
   double det_s = 0;
-  Eigen::VectorXd max_det_z;
-  Eigen::MatrixXd max_det_s;
-  bool success = true;
+  UKF::LidarVector max_det_z;
+  UKF::LidarMatrix max_det_s;
 
   if (use_sukf_)
   {
@@ -463,10 +431,20 @@ bool ImmUkfPda::probabilisticDataAssociation(const autoware_msgs::DetectedObject
   if (std::isnan(det_s) || det_s > prevent_explosion_threshold_)
   {
     target.tracking_num_ = TrackingState::Die;
-    success = false;
-    return success;
+    return false;
   }
 
+  gate = association_.makeGate(max_det_z, max_det_s);
+  return true;
+}
+
+bool ImmUkfPda::probabilisticDataAssociation(const autoware_msgs::DetectedObjectArray& input, const double dt,
+                                             const int detection_index, const double nis,
+                                             std::vector<bool>& matching_vec,
+                                             std::vector<autoware_msgs::DetectedObject>& object_vec, UKF& target)
+{
+  bool success = true;
+
   bool is_second_init;
   if (target.tracking_num_ == TrackingState::Init)
   {
@@ -478,7 +456,7 @@ bool ImmUkfPda::probabilisticDataAssociation(const autoware_msgs::DetectedObject
   }
 
   // measurement gating
-  measurementValidation(input, target, is_second_init, max_det_z, max_det_s, object_vec, matching_vec);
+  measurementValidation(input, target, is_second_init, detection_index, nis, object_vec, matching_vec);
 
   // second detection for a target: update v and yaw
   if (is_second_init)
@@ -507,7 +485,7 @@ void ImmUkfPda::makeNewTargets(const double timestamp, const autoware_msgs::Dete
     {
       double px = input.objects[i].pose.position.x;
       double py = input.objects[i].pose.position.y;
-      Eigen::VectorXd init_meas = Eigen::VectorXd(2);
+      UKF::LidarVector init_meas;
       init_meas << px, py;
 
       UKF ukf;
@@ -787,6 +765,7 @@ void ImmUkfPda::tracker(const autoware_msgs::DetectedObjectArray& input,
 
 
   // start UKF process
+  association_gates_.assign(targets_.size(), AssociationGate());
   for (size_t i = 0; i < targets_.size(); i++)
   {
     targets_[i].is_stable_ = false;
@@ -806,8 +785,28 @@ void ImmUkfPda::tracker(const autoware_msgs::DetectedObjectArray& input,
 
     targets_[i].prediction(use_sukf_, has_subscribed_vectormap_, dt);
 
+    makeAssociationGate(targets_[i], association_gates_[i]);
+  }
+
+  // measurement gating of all the targets at once
+  association_detections_.resize(input.objects.size());
+  for (size_t i = 0; i < input.objects.size(); i++)
+  {
+    association_detections_[i] << input.objects[i].pose.position.x, input.objects[i].pose.position.y;
+  }
+  association_.associate(association_gates_, association_detections_, associated_detection_indices_,
+                         associated_nis_values_);
+
+  for (size_t i = 0; i < targets_.size(); i++)
+  {
+    if (!association_gates_[i].is_valid)
+    {
+      continue;
+    }
+
     std::vector<autoware_msgs::DetectedObject> object_vec;
-    bool success = probabilisticDataAssociation(input, dt, matching_vec, object_vec, targets_[i]);
+    bool success = probabilisticDataAssociation(input, dt, associated_detection_indices_[i],
+                                                associated_nis_values_[i], matching_vec, object_vec, targets_[i]);
     if (!success)
     {
       continue;
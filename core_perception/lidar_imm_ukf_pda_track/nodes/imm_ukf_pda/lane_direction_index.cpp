@@ -0,0 +1,103 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <imm_ukf_pda/lane_direction_index.h>
+
+#include <cmath>
+
+void LaneDirectionIndex::build(const vector_map::VectorMap& vmap, const std::vector<vector_map_msgs::Lane>& lanes)
+{
+  lane_directions_.clear();
+  lane_indices_.clear();
+  lane_directions_.reserve(lanes.size());
+
+  for (auto const& lane : lanes)
+  {
+    const vector_map_msgs::Node& node = vmap.findByKey(vector_map::Key<vector_map_msgs::Node>(lane.bnid));
+    const vector_map_msgs::Point& point = vmap.findByKey(vector_map::Key<vector_map_msgs::Point>(node.pid));
+    const vector_map_msgs::Node& front_node = vmap.findByKey(vector_map::Key<vector_map_msgs::Node>(lane.fnid));
+    const vector_map_msgs::Point& front_point =
+        vmap.findByKey(vector_map::Key<vector_map_msgs::Point>(front_node.pid));
+    if (point.pid == 0 || front_point.pid == 0)
+    {
+      continue;
+    }
+
+    // ly and bx of the vectormap points are x and y
+    LaneDirection lane_direction;
+    lane_direction.x = point.ly;
+    lane_direction.y = point.bx;
+    lane_direction.yaw = std::atan2((front_point.bx - point.bx), (front_point.ly - point.ly));
+    if (!std::isfinite(lane_direction.x) || !std::isfinite(lane_direction.y))
+    {
+      continue;
+    }
+
+    if (lane_indices_.emplace(lane.lnid, static_cast<int>(lane_directions_.size())).second)
+    {
+      lane_directions_.push_back(lane_direction);
+    }
+  }
+}
+
+void LaneDirectionIndex::checkLane(const int lane, const double x, const double y, int& nearest_lane,
+                                   double& nearest_squared_distance) const
+{
+  const double dx = lane_directions_[lane].x - x;
+  const double dy = lane_directions_[lane].y - y;
+  const double squared_distance = dx * dx + dy * dy;
+  if (squared_distance < nearest_squared_distance ||
+      (squared_distance == nearest_squared_distance && lane < nearest_lane))
+  {
+    nearest_squared_distance = squared_distance;
+    nearest_lane = lane;
+  }
+}
+
+bool LaneDirectionIndex::findNearestLaneDirection(const vector_map::VectorMap& vmap, const double x, const double y,
+                                                  const double max_distance, double& yaw) const
+{
+  if (lane_directions_.empty() || !(max_distance > 0) || !std::isfinite(x) || !std::isfinite(y))
+  {
+    return false;
+  }
+
+  int nearest_lane = -1;
+  double nearest_squared_distance = max_distance * max_distance;
+
+  // a lane begins on its segment, so the lanes whose segment is within max_distance include all the lanes beginning
+  // within max_distance
+  geometry_msgs::Point center;
+  center.x = x;
+  center.y = y;
+  const std::vector<vector_map_msgs::Lane> lanes =
+      vmap.findByRadius(center, max_distance, [](const vector_map_msgs::Lane& lane) { return true; });
+  for (const auto& lane : lanes)
+  {
+    const auto it = lane_indices_.find(lane.lnid);
+    if (it != lane_indices_.end())
+    {
+      checkLane(it->second, x, y, nearest_lane, nearest_squared_distance);
+    }
+  }
+
+  if (nearest_lane < 0)
+  {
+    return false;
+  }
+  yaw = lane_directions_[nearest_lane].yaw;
+  return true;
+}
@@ -0,0 +1,346 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <imm_ukf_pda/target_association.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+TargetAssociation::TargetAssociation() : gating_threshold_(9.22), method_(NEAREST), grid_(1.0)
+{
+}
+
+void TargetAssociation::setGatingThreshold(const double gating_threshold)
+{
+  gating_threshold_ = gating_threshold;
+}
+
+void TargetAssociation::setMethod(const Method method)
+{
+  method_ = method;
+}
+
+bool TargetAssociation::parseMethod(const std::string& name, Method& method)
+{
+  if (name == "nearest")
+  {
+    method = NEAREST;
+    return true;
+  }
+  if (name == "global_nearest")
+  {
+    method = GLOBAL_NEAREST;
+    return true;
+  }
+  return false;
+}
+
+AssociationGate TargetAssociation::makeGate(const Eigen::Vector2d& z, const Eigen::Matrix2d& s) const
+{
+  AssociationGate gate;
+  gate.is_valid = true;
+  gate.z = z;
+  gate.s_inv = s.inverse();
+
+  // The NIS is at least the smallest eigenvalue of the symmetric part of S^-1 times the squared distance to z
+  const double a = gate.s_inv(0, 0);
+  const double b = 0.5 * (gate.s_inv(0, 1) + gate.s_inv(1, 0));
+  const double c = gate.s_inv(1, 1);
+  const double min_eigenvalue = 0.5 * (a + c) - std::sqrt(0.25 * (a - c) * (a - c) + b * b);
+  if (min_eigenvalue > 0 && std::isfinite(min_eigenvalue))
+  {
+    gate.radius = std::sqrt(gating_threshold_ / min_eigenvalue);
+  }
+  else
+  {
+    gate.radius = std::numeric_limits<double>::infinity();
+  }
+  return gate;
+}
+
+void TargetAssociation::associate(const AssociationGates& gates, const AssociationDetections& detections,
+                                  std::vector<int>& detection_indices, std::vector<double>& nis_values)
+{
+  detection_indices.assign(gates.size(), -1);
+  nis_values.assign(gates.size(), std::numeric_limits<double>::max());
+  if (gates.empty() || detections.empty())
+  {
+    return;
+  }
+
+  buildGrid(gates, detections);
+  findGatedPairs(gates, detections);
+
+  if (method_ == GLOBAL_NEAREST)
+  {
+    assignGlobalNearest(detection_indices, nis_values);
+  }
+  else
+  {
+    assignNearest(detection_indices, nis_values);
+  }
+}
+
+void TargetAssociation::buildGrid(const AssociationGates& gates, const AssociationDetections& detections)
+{
+  // Cells of the size of an average gate, so that a gate overlaps a few cells
+  double radius_sum = 0;
+  int radius_num = 0;
+  for (const auto& gate : gates)
+  {
+    if (gate.is_valid && std::isfinite(gate.radius))
+    {
+      radius_sum += gate.radius;
+      radius_num++;
+    }
+  }
+  grid_.clear(radius_num > 0 ? std::max(0.5, radius_sum / radius_num) : 1.0);
+
+  // detections not finite or beyond the range of the cells are outside of every gate within the range
+  for (size_t i = 0; i < detections.size(); i++)
+  {
+    grid_.insert(detections[i](0), detections[i](1), static_cast<int>(i));
+  }
+  grid_.sort();
+}
+
+void TargetAssociation::findGatedPairs(const AssociationGates& gates, const AssociationDetections& detections)
+{
+  pairs_.clear();
+  for (size_t g = 0; g < gates.size(); g++)
+  {
+    const AssociationGate& gate = gates[g];
+    if (!gate.is_valid)
+    {
+      continue;
+    }
+
+    const auto check_detection = [&](const int detection) {
+      const Eigen::Vector2d diff = detections[detection] - gate.z;
+      const double nis = diff.dot(gate.s_inv * diff);
+      if (nis < gating_threshold_)
+      {
+        pairs_.push_back({ static_cast<int>(g), detection, nis });
+      }
+    };
+
+    vector_map::CellRange range;
+    const bool is_bounded =
+        std::isfinite(gate.radius) && 2 * gate.radius < MAX_GATE_CELLS * grid_.getCellSize() &&
+        grid_.getCellRange(gate.z(0) - gate.radius, gate.z(1) - gate.radius, gate.z(0) + gate.radius,
+                           gate.z(1) + gate.radius, range);
+    if (!is_bounded)
+    {
+      for (size_t i = 0; i < detections.size(); i++)
+      {
+        check_detection(i);
+      }
+      continue;
+    }
+
+    grid_.forEach(range, check_detection);
+  }
+}
+
+void TargetAssociation::assignNearest(std::vector<int>& detection_indices, std::vector<double>& nis_values) const
+{
+  // smallest NIS of each gate, the smallest detection index on ties
+  for (const auto& pair : pairs_)
+  {
+    int& detection = detection_indices[pair.gate];
+    double& nis = nis_values[pair.gate];
+    if (detection < 0 || pair.nis < nis || (pair.nis == nis && pair.detection < detection))
+    {
+      detection = pair.detection;
+      nis = pair.nis;
+    }
+  }
+}
+
+void TargetAssociation::assignGlobalNearest(std::vector<int>& detection_indices,
+                                            std::vector<double>& nis_values) const
+{
+  if (pairs_.empty())
+  {
+    return;
+  }
+
+  // Gates and detections sharing no pair are independent, so the assignment is solved for each connected
+  // component of the pairs. Union-find over the gates, then the detections.
+  int gates_num = 0;
+  int detections_num = 0;
+  for (const auto& pair : pairs_)
+  {
+    gates_num = std::max(gates_num, pair.gate + 1);
+    detections_num = std::max(detections_num, pair.detection + 1);
+  }
+  std::vector<int> parent(gates_num + detections_num);
+  for (size_t i = 0; i < parent.size(); i++)
+  {
+    parent[i] = i;
+  }
+  const auto find_root = [&parent](int node) {
+    while (parent[node] != node)
+    {
+      parent[node] = parent[parent[node]];
+      node = parent[node];
+    }
+    return node;
+  };
+  for (const auto& pair : pairs_)
+  {
+    const int root_a = find_root(pair.gate);
+    const int root_b = find_root(gates_num + pair.detection);
+    if (root_a != root_b)
+    {
+      parent[std::max(root_a, root_b)] = std::min(root_a, root_b);
+    }
+  }
+
+  // pairs sorted by component
+  std::vector<std::pair<int, int>> component_pairs(pairs_.size());
+  for (size_t i = 0; i < pairs_.size(); i++)
+  {
+    component_pairs[i] = std::make_pair(find_root(pairs_[i].gate), static_cast<int>(i));
+  }
+  std::sort(component_pairs.begin(), component_pairs.end());
+
+  // rows and columns of the gates and detections in their component
+  std::vector<int> local_index(gates_num + detections_num, -1);
+  std::vector<int> row_gate;
+  std::vector<int> col_detection;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  for (size_t begin = 0; begin < component_pairs.size();)
+  {
+    size_t end = begin;
+    row_gate.clear();
+    col_detection.clear();
+    for (; end < component_pairs.size() && component_pairs[end].first == component_pairs[begin].first; end++)
+    {
+      const GatedPair& pair = pairs_[component_pairs[end].second];
+      if (local_index[pair.gate] < 0)
+      {
+        local_index[pair.gate] = row_gate.size();
+        row_gate.push_back(pair.gate);
+      }
+      if (local_index[gates_num + pair.detection] < 0)
+      {
+        local_index[gates_num + pair.detection] = col_detection.size();
+        col_detection.push_back(pair.detection);
+      }
+    }
+
+    // Cost of each gate for each detection, then for staying without detection in its own extra column.
+    // Pairs out of the gates cost more than staying without detection, so they are never chosen.
+    const int n = row_gate.size();
+    const int m = col_detection.size() + n;
+    const double out_of_gate = 2 * gating_threshold_ + 1;
+    std::vector<double> cost(n * m, out_of_gate);
+    for (int row = 0; row < n; row++)
+    {
+      cost[row * m + col_detection.size() + row] = gating_threshold_;
+    }
+    for (size_t i = begin; i < end; i++)
+    {
+      const GatedPair& pair = pairs_[component_pairs[i].second];
+      cost[local_index[pair.gate] * m + local_index[gates_num + pair.detection]] = pair.nis;
+    }
+
+    // Hungarian method with potentials, 1-based rows and columns, column 0 holds the row being assigned
+    std::vector<double> u(n + 1, 0), v(m + 1, 0);
+    std::vector<int> col_row(m + 1, 0), way(m + 1, 0);
+    std::vector<double> min_v(m + 1);
+    std::vector<char> used(m + 1);
+    for (int row = 1; row <= n; row++)
+    {
+      col_row[0] = row;
+      int col0 = 0;
+      std::fill(min_v.begin(), min_v.end(), inf);
+      std::fill(used.begin(), used.end(), false);
+      do
+      {
+        used[col0] = true;
+        const int row0 = col_row[col0];
+        double delta = inf;
+        int col1 = 0;
+        for (int col = 1; col <= m; col++)
+        {
+          if (used[col])
+          {
+            continue;
+          }
+          const double reduced = cost[(row0 - 1) * m + col - 1] - u[row0] - v[col];
+          if (reduced < min_v[col])
+          {
+            min_v[col] = reduced;
+            way[col] = col0;
+          }
+          if (min_v[col] < delta)
+          {
+            delta = min_v[col];
+            col1 = col;
+          }
+        }
+        for (int col = 0; col <= m; col++)
+        {
+          if (used[col])
+          {
+            u[col_row[col]] += delta;
+            v[col] -= delta;
+          }
+          else
+          {
+            min_v[col] -= delta;
+          }
+        }
+        col0 = col1;
+      } while (col_row[col0] != 0);
+      do
+      {
+        const int col1 = way[col0];
+        col_row[col0] = col_row[col1];
+        col0 = col1;
+      } while (col0 != 0);
+    }
+
+    for (int col = 1; col <= static_cast<int>(col_detection.size()); col++)
+    {
+      const int row = col_row[col];
+      if (row == 0)
+      {
+        continue;
+      }
+      const double nis = cost[(row - 1) * m + col - 1];
+      if (nis < gating_threshold_)
+      {
+        detection_indices[row_gate[row - 1]] = col_detection[col - 1];
+        nis_values[row_gate[row - 1]] = nis;
+      }
+    }
+
+    for (const int gate : row_gate)
+    {
+      local_index[gate] = -1;
+    }
+    for (const int detection : col_detection)
+    {
+      local_index[gates_num + detection] = -1;
+    }
+    begin = end;
+  }
+}
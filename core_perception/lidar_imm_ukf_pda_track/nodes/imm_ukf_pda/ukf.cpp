@@ -16,43 +16,50 @@
 
 #include <imm_ukf_pda/ukf.h>
 
+namespace
+{
+// measurement [pos1 pos2] or [pos1 pos2 yaw_angle] of a detected object
+template <int NumMeas>
+UKF::Vector<NumMeas> measurementOf(const autoware_msgs::DetectedObject& object)
+{
+  UKF::Vector<NumMeas> meas;
+  meas(0) = object.pose.position.x;
+  meas(1) = object.pose.position.y;
+  if (NumMeas == UKF::NUM_LIDAR_DIRECTION_STATE)
+  {
+    meas(NumMeas - 1) = object.angle;
+  }
+  return meas;
+}
+
+// measurement predicted by a sigma point
+template <int NumMeas>
+UKF::Vector<NumMeas> sigmaPointMeasurement(const UKF::SigmaMatrix& x_sig_pred, const int i)
+{
+  UKF::Vector<NumMeas> z_sig_point;
+  z_sig_point(0) = x_sig_pred(0, i);
+  z_sig_point(1) = x_sig_pred(1, i);
+  if (NumMeas == UKF::NUM_LIDAR_DIRECTION_STATE)
+  {
+    z_sig_point(NumMeas - 1) = x_sig_pred(3, i);
+  }
+  return z_sig_point;
+}
+}  // namespace
+
 /**
 * Initializes Unscented Kalman filter
  */
 UKF::UKF()
-  : num_state_(5)
-  , num_lidar_state_(2)
-  , num_lidar_direction_state_(3)
-  , num_motion_model_(3)
+  : num_state_(NUM_STATE)
+  , num_lidar_state_(NUM_LIDAR_STATE)
+  , num_lidar_direction_state_(NUM_LIDAR_DIRECTION_STATE)
+  , num_motion_model_(NUM_MOTION_MODEL)
   , is_direction_cv_available_(false)
   , is_direction_ctrv_available_(false)
   , is_direction_rm_available_(false)
   , std_lane_direction_(0.15)
 {
-  // initial state vector
-  x_merge_ = Eigen::MatrixXd(5, 1);
-
-  // initial state vector
-  x_cv_ = Eigen::MatrixXd(5, 1);
-
-  // initial state vector
-  x_ctrv_ = Eigen::MatrixXd(5, 1);
-
-  // initial state vector
-  x_rm_ = Eigen::MatrixXd(5, 1);
-
-  // initial covariance matrix
-  p_merge_ = Eigen::MatrixXd(5, 5);
-
-  // initial covariance matrix
-  p_cv_ = Eigen::MatrixXd(5, 5);
-
-  // initial covariance matrix
-  p_ctrv_ = Eigen::MatrixXd(5, 5);
-
-  // initial covariance matrix
-  p_rm_ = Eigen::MatrixXd(5, 5);
-
   // Process noise standard deviation longitudinal acceleration in m/s^2
   std_a_cv_ = 1.5;
   std_a_ctrv_ = 1.5;
@@ -69,19 +76,6 @@ UKF::UKF()
   // time when the state is true, in us
   time_ = 0.0;
 
-  // predicted sigma points matrix
-  x_sig_pred_cv_ = Eigen::MatrixXd(num_state_, 2 * num_state_ + 1);
-
-  // predicted sigma points matrix
-  x_sig_pred_ctrv_ = Eigen::MatrixXd(num_state_, 2 * num_state_ + 1);
-
-  // predicted sigma points matrix
-  x_sig_pred_rm_ = Eigen::MatrixXd(num_state_, 2 * num_state_ + 1);
-
-  // create vector for weights
-  weights_c_ = Eigen::VectorXd(2 * num_state_ + 1);
-  weights_s_ = Eigen::VectorXd(2 * num_state_ + 1);
-
   // transition probability
   p1_.push_back(0.9);
   p1_.push_back(0.05);
@@ -111,18 +105,6 @@ UKF::UKF()
   mode_prob_ctrv_ = 0.33;
   mode_prob_rm_ = 0.33;
 
-  z_pred_cv_ = Eigen::VectorXd(2);
-  z_pred_ctrv_ = Eigen::VectorXd(2);
-  z_pred_rm_ = Eigen::VectorXd(2);
-
-  s_cv_ = Eigen::MatrixXd(2, 2);
-  s_ctrv_ = Eigen::MatrixXd(2, 2);
-  s_rm_ = Eigen::MatrixXd(2, 2);
-
-  k_cv_ = Eigen::MatrixXd(5, 2);
-  k_ctrv_ = Eigen::MatrixXd(5, 2);
-  k_rm_ = Eigen::MatrixXd(5, 2);
-
   pd_ = 0.9;
   pg_ = 0.99;
 
@@ -135,57 +117,22 @@ UKF::UKF()
   object_.dimensions.x = 1.0;
   object_.dimensions.y = 1.0;
 
-  // for static classification
-  init_meas_ = Eigen::VectorXd(2);
-
   x_merge_yaw_ = 0;
 
-  // for raukf
-  cv_meas_ = Eigen::VectorXd(2);
-  ctrv_meas_ = Eigen::VectorXd(2);
-  rm_meas_ = Eigen::VectorXd(2);
-
-  r_cv_ = Eigen::MatrixXd(2, 2);
-  r_ctrv_ = Eigen::MatrixXd(2, 2);
-  r_rm_ = Eigen::MatrixXd(2, 2);
-
-  q_cv_ = Eigen::MatrixXd(5, 5);
-  q_ctrv_ = Eigen::MatrixXd(5, 5);
-  q_rm_ = Eigen::MatrixXd(5, 5);
-
   nis_cv_ = 0;
   nis_ctrv_ = 0;
   nis_rm_ = 0;
 
-  new_x_sig_cv_ = Eigen::MatrixXd(num_state_, 2 * num_state_ + 1);
-  new_x_sig_ctrv_ = Eigen::MatrixXd(num_state_, 2 * num_state_ + 1);
-  new_x_sig_rm_ = Eigen::MatrixXd(num_state_, 2 * num_state_ + 1);
-
-  new_z_sig_cv_ = Eigen::MatrixXd(2, 2 * num_state_ + 1);
-  new_z_sig_ctrv_ = Eigen::MatrixXd(2, 2 * num_state_ + 1);
-  new_z_sig_rm_ = Eigen::MatrixXd(2, 2 * num_state_ + 1);
-
-  new_z_pred_cv_ = Eigen::VectorXd(2);
-  new_z_pred_ctrv_ = Eigen::VectorXd(2);
-  new_z_pred_rm_ = Eigen::VectorXd(2);
-
-  new_s_cv_ = Eigen::MatrixXd(2, 2);
-  new_s_ctrv_ = Eigen::MatrixXd(2, 2);
-  new_s_rm_ = Eigen::MatrixXd(2, 2);
-
   // for lane direction combined filter
-  lidar_direction_r_cv_ = Eigen::MatrixXd(num_lidar_direction_state_, num_lidar_direction_state_);
-  lidar_direction_r_ctrv_ = Eigen::MatrixXd(num_lidar_direction_state_, num_lidar_direction_state_);
-  lidar_direction_r_rm_ = Eigen::MatrixXd(num_lidar_direction_state_, num_lidar_direction_state_);
-
-  k_lidar_direction_cv_ = Eigen::MatrixXd(num_state_, num_lidar_direction_state_);
-  k_lidar_direction_ctrv_ = Eigen::MatrixXd(num_state_, num_lidar_direction_state_);
-  k_lidar_direction_rm_ = Eigen::MatrixXd(num_state_, num_lidar_direction_state_);
-
-  lidar_direction_ctrv_meas_ = Eigen::VectorXd(num_lidar_direction_state_);
+  z_pred_lidar_direction_cv_.setZero();
+  z_pred_lidar_direction_ctrv_.setZero();
+  z_pred_lidar_direction_rm_.setZero();
+  s_lidar_direction_cv_.setZero();
+  s_lidar_direction_ctrv_.setZero();
+  s_lidar_direction_rm_.setZero();
 }
 
-double UKF::normalizeAngle(const double angle)
+double UKF::normalizeAngle(const double angle) const
 {
   double normalized_angle = angle;
   while (normalized_angle > M_PI)
@@ -195,7 +142,7 @@ double UKF::normalizeAngle(const double angle)
   return normalized_angle;
 }
 
-void UKF::initialize(const Eigen::VectorXd& z, const double timestamp, const int target_id)
+void UKF::initialize(const LidarVector& z, const double timestamp, const int target_id)
 {
   ukf_id_ = target_id;
 
@@ -267,11 +214,11 @@ void UKF::initialize(const Eigen::VectorXd& z, const double timestamp, const int
   tracking_num_ = 1;
 }
 
-void UKF::updateModeProb(const std::vector<double>& lambda_vec)
+void UKF::updateModeProb(const ModelVector& lambda_vec)
 {
-  double cvGauss = lambda_vec[0];
-  double ctrvGauss = lambda_vec[1];
-  double rmGauss = lambda_vec[2];
+  double cvGauss = lambda_vec(MotionModel::CV);
+  double ctrvGauss = lambda_vec(MotionModel::CTRV);
+  double rmGauss = lambda_vec(MotionModel::RM);
   double sumGauss = cvGauss * mode_prob_cv_ + ctrvGauss * mode_prob_ctrv_ + rmGauss * mode_prob_rm_;
   mode_prob_cv_ = (cvGauss * mode_prob_cv_) / sumGauss;
   mode_prob_ctrv_ = (ctrvGauss * mode_prob_ctrv_) / sumGauss;
@@ -348,12 +295,12 @@ void UKF::mixingProbability()
 
 void UKF::interaction()
 {
-  Eigen::MatrixXd x_pre_cv = x_cv_;
-  Eigen::MatrixXd x_pre_ctrv = x_ctrv_;
-  Eigen::MatrixXd x_pre_rm = x_rm_;
-  Eigen::MatrixXd p_pre_cv = p_cv_;
-  Eigen::MatrixXd p_pre_ctrv = p_ctrv_;
-  Eigen::MatrixXd p_pre_rm = p_rm_;
+  const StateVector x_pre_cv = x_cv_;
+  const StateVector x_pre_ctrv = x_ctrv_;
+  const StateVector x_pre_rm = x_rm_;
+  const StateMatrix p_pre_cv = p_cv_;
+  const StateMatrix p_pre_ctrv = p_ctrv_;
+  const StateMatrix p_pre_rm = p_rm_;
   x_cv_ = mode_match_prob_cv2cv_ * x_pre_cv + mode_match_prob_ctrv2cv_ * x_pre_ctrv + mode_match_prob_rm2cv_ * x_pre_rm;
   x_ctrv_ = mode_match_prob_cv2ctrv_ * x_pre_cv + mode_match_prob_ctrv2ctrv_ * x_pre_ctrv +
             mode_match_prob_rm2ctrv_ * x_pre_rm;
@@ -441,7 +388,7 @@ void UKF::predictionIMMUKF(const double dt, const bool has_subscribed_vectormap)
   }
 }
 
-void UKF::findMaxZandS(Eigen::VectorXd& max_det_z, Eigen::MatrixXd& max_det_s)
+void UKF::findMaxZandS(LidarVector& max_det_z, LidarMatrix& max_det_s)
 {
   double cv_det = s_cv_.determinant();
   double ctrv_det = s_ctrv_.determinant();
@@ -477,259 +424,171 @@ void UKF::findMaxZandS(Eigen::VectorXd& max_det_z, Eigen::MatrixXd& max_det_s)
 
 void UKF::updateEachMotion(const double detection_probability, const double gate_probability, const double gating_threshold,
                            const std::vector<autoware_msgs::DetectedObject>& object_vec,
-                           std::vector<double>& lambda_vec)
+                           ModelVector& lambda_vec)
 {
   // calculating association probability
   double num_meas = object_vec.size();
   double b = 2 * num_meas * (1 - detection_probability * gate_probability) / (gating_threshold * detection_probability);
 
-  Eigen::VectorXd max_det_z;
-  Eigen::MatrixXd max_det_s;
+  LidarVector max_det_z;
+  LidarMatrix max_det_s;
   findMaxZandS(max_det_z, max_det_s);
   double Vk = M_PI * sqrt(gating_threshold * max_det_s.determinant());
 
   for (int motion_ind = 0; motion_ind < num_motion_model_; motion_ind++)
   {
-    Eigen::MatrixXd x(x_cv_.rows(), x_cv_.cols());
-    Eigen::MatrixXd p(p_cv_.rows(), p_cv_.cols());
-    bool is_direction_available = false;
-    int num_meas_state = 0;
-    Eigen::VectorXd z_pred;
-    Eigen::MatrixXd s_pred;
-    Eigen::MatrixXd kalman_gain;
-    Eigen::VectorXd likely_meas;
-    double e_sum = 0;
-    std::vector<double> e_vec;
-    std::vector<Eigen::VectorXd> diff_vec;
-    std::vector<Eigen::VectorXd> meas_vec;
-
+    double lambda;
     if (motion_ind == MotionModel::CV)
     {
-      x = x_cv_;
-      p = p_cv_;
       if (is_direction_cv_available_)
       {
-        is_direction_available = true;
-        num_meas_state = num_lidar_direction_state_;
-        z_pred = Eigen::VectorXd(num_meas_state);
-        s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-        kalman_gain = Eigen::MatrixXd(num_state_, num_meas_state);
-        z_pred = z_pred_lidar_direction_cv_;
-        s_pred = s_lidar_direction_cv_;
-        kalman_gain = k_lidar_direction_cv_;
+        lambda = updateMotion<NUM_LIDAR_DIRECTION_STATE>(z_pred_lidar_direction_cv_, s_lidar_direction_cv_,
+                                                         k_lidar_direction_cv_, detection_probability,
+                                                         gate_probability, b, Vk, object_vec, x_cv_, p_cv_);
       }
       else
       {
-        num_meas_state = num_lidar_state_;
-        z_pred = Eigen::VectorXd(num_meas_state);
-        s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-        kalman_gain = Eigen::MatrixXd(num_state_, num_meas_state);
-        z_pred = z_pred_cv_;
-        s_pred = s_cv_;
-        kalman_gain = k_cv_;
+        lambda = updateMotion<NUM_LIDAR_STATE>(z_pred_cv_, s_cv_, k_cv_, detection_probability, gate_probability, b,
+                                               Vk, object_vec, x_cv_, p_cv_);
       }
     }
     else if (motion_ind == MotionModel::CTRV)
     {
-      x = x_ctrv_;
-      p = p_ctrv_;
       if (is_direction_ctrv_available_)
       {
-        is_direction_available = true;
-        num_meas_state = num_lidar_direction_state_;
-        z_pred = Eigen::VectorXd(num_meas_state);
-        s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-        kalman_gain = Eigen::MatrixXd(num_state_, num_meas_state);
-        z_pred = z_pred_lidar_direction_ctrv_;
-        s_pred = s_lidar_direction_ctrv_;
-        kalman_gain = k_lidar_direction_ctrv_;
+        lambda = updateMotion<NUM_LIDAR_DIRECTION_STATE>(z_pred_lidar_direction_ctrv_, s_lidar_direction_ctrv_,
+                                                         k_lidar_direction_ctrv_, detection_probability,
+                                                         gate_probability, b, Vk, object_vec, x_ctrv_, p_ctrv_);
       }
       else
       {
-        num_meas_state = num_lidar_state_;
-        z_pred = Eigen::VectorXd(num_meas_state);
-        s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-        kalman_gain = Eigen::MatrixXd(num_state_, num_meas_state);
-        z_pred = z_pred_ctrv_;
-        s_pred = s_ctrv_;
-        kalman_gain = k_ctrv_;
+        lambda = updateMotion<NUM_LIDAR_STATE>(z_pred_ctrv_, s_ctrv_, k_ctrv_, detection_probability,
+                                               gate_probability, b, Vk, object_vec, x_ctrv_, p_ctrv_);
       }
     }
     else
     {
-      x = x_rm_;
-      p = p_rm_;
       if (is_direction_rm_available_)
       {
-        is_direction_available = true;
-        num_meas_state = num_lidar_direction_state_;
-        z_pred = Eigen::VectorXd(num_meas_state);
-        s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-        kalman_gain = Eigen::MatrixXd(num_state_, num_meas_state);
-        z_pred = z_pred_lidar_direction_rm_;
-        s_pred = s_lidar_direction_rm_;
-        kalman_gain = k_lidar_direction_rm_;
+        lambda = updateMotion<NUM_LIDAR_DIRECTION_STATE>(z_pred_lidar_direction_rm_, s_lidar_direction_rm_,
+                                                         k_lidar_direction_rm_, detection_probability,
+                                                         gate_probability, b, Vk, object_vec, x_rm_, p_rm_);
       }
       else
       {
-        num_meas_state = num_lidar_state_;
-        z_pred = Eigen::VectorXd(num_meas_state);
-        s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-        kalman_gain = Eigen::MatrixXd(num_state_, num_meas_state);
-        z_pred = z_pred_rm_;
-        s_pred = s_rm_;
-        kalman_gain = k_rm_;
+        lambda = updateMotion<NUM_LIDAR_STATE>(z_pred_rm_, s_rm_, k_rm_, detection_probability, gate_probability, b,
+                                               Vk, object_vec, x_rm_, p_rm_);
       }
     }
+    lambda_vec(motion_ind) = lambda;
+  }
+}
 
-    for (size_t i = 0; i < num_meas; i++)
-    {
-      Eigen::VectorXd meas = Eigen::VectorXd(num_meas_state);
-      meas(0) = object_vec[i].pose.position.x;
-      meas(1) = object_vec[i].pose.position.y;
-      if (is_direction_available)
-        meas(2) = object_vec[i].angle;
-      meas_vec.push_back(meas);
-      Eigen::VectorXd diff = meas - z_pred;
-      diff_vec.push_back(diff);
-      double e = exp(-0.5 * diff.transpose() * s_pred.inverse() * diff);
-      e_vec.push_back(e);
-      e_sum += e;
-    }
-    double beta_zero = b / (b + e_sum);
-
-    std::vector<double> beta_vec;
-
-    if (num_meas != 0)
-    {
-      std::vector<double>::iterator max_iter = std::max_element(e_vec.begin(), e_vec.end());
-      int max_ind = std::distance(e_vec.begin(), max_iter);
-      likely_meas = meas_vec[max_ind];
-    }
-
-    for (size_t i = 0; i < num_meas; i++)
-    {
-      double temp = e_vec[i] / (b + e_sum);
-      beta_vec.push_back(temp);
-    }
-    Eigen::VectorXd sigma_x;
-    sigma_x.setZero(num_meas_state);
-
-    for (size_t i = 0; i < num_meas; i++)
-    {
-      sigma_x += beta_vec[i] * diff_vec[i];
-    }
-
-    Eigen::MatrixXd sigma_p;
-    sigma_p.setZero(num_meas_state, num_meas_state);
-
-    for (size_t i = 0; i < num_meas; i++)
-    {
-      sigma_p += (beta_vec[i] * diff_vec[i] * diff_vec[i].transpose() - sigma_x * sigma_x.transpose());
-    }
+template <int NumMeas>
+double UKF::updateMotion(const Vector<NumMeas>& z_pred, const Matrix<NumMeas, NumMeas>& s_pred,
+                         const Matrix<NUM_STATE, NumMeas>& kalman_gain, const double detection_probability,
+                         const double gate_probability, const double b, const double Vk,
+                         const std::vector<autoware_msgs::DetectedObject>& object_vec, StateVector& x, StateMatrix& p)
+{
+  const double num_meas = object_vec.size();
+  const Matrix<NumMeas, NumMeas> s_inv = s_pred.inverse();
 
-    // update x and P
-    Eigen::MatrixXd updated_x(x_cv_.rows(), x_cv_.cols());
-    updated_x = x + kalman_gain * sigma_x;
+  double e_sum = 0;
+  for (size_t i = 0; i < num_meas; i++)
+  {
+    const Vector<NumMeas> diff = measurementOf<NumMeas>(object_vec[i]) - z_pred;
+    e_sum += exp(-0.5 * diff.dot(s_inv * diff));
+  }
+  double beta_zero = b / (b + e_sum);
 
-    updated_x(3) = normalizeAngle(updated_x(3));
+  Vector<NumMeas> sigma_x = Vector<NumMeas>::Zero();
+  Matrix<NumMeas, NumMeas> sigma_p = Matrix<NumMeas, NumMeas>::Zero();
+  for (size_t i = 0; i < num_meas; i++)
+  {
+    const Vector<NumMeas> diff = measurementOf<NumMeas>(object_vec[i]) - z_pred;
+    const double beta = exp(-0.5 * diff.dot(s_inv * diff)) / (b + e_sum);
+    sigma_x += beta * diff;
+    sigma_p += beta * diff * diff.transpose();
+  }
+  sigma_p -= num_meas * sigma_x * sigma_x.transpose();
 
-    Eigen::MatrixXd updated_p(p_cv_.rows(), p_cv_.cols());
-    if (num_meas != 0)
-    {
-      updated_p = beta_zero * p + (1 - beta_zero) * (p - kalman_gain * s_pred * kalman_gain.transpose()) +
-                  kalman_gain * sigma_p * kalman_gain.transpose();
-    }
-    else
-    {
-      updated_p = p - kalman_gain * s_pred * kalman_gain.transpose();
-    }
+  // update x and P
+  x += kalman_gain * sigma_x;
 
-    double lambda;
-    if (num_meas != 0)
-    {
-      lambda =
-          (1 - gate_probability * detection_probability) / pow(Vk, num_meas) +
-          detection_probability * pow(Vk, 1 - num_meas) * e_sum / (num_meas * sqrt(2 * M_PI * s_pred.determinant()));
-    }
-    else
-    {
-      lambda = (1 - gate_probability * detection_probability);
-    }
+  x(3) = normalizeAngle(x(3));
 
-    lambda_vec.push_back(lambda);
+  const StateMatrix gain_s_gain = kalman_gain * s_pred * kalman_gain.transpose();
+  if (num_meas != 0)
+  {
+    p = beta_zero * p + (1 - beta_zero) * (p - gain_s_gain) + kalman_gain * sigma_p * kalman_gain.transpose();
+  }
+  else
+  {
+    p -= gain_s_gain;
+  }
 
-    if (motion_ind == MotionModel::CV)
-    {
-      x_cv_ = updated_x;
-      p_cv_ = updated_p;
-    }
-    else if (motion_ind == MotionModel::CTRV)
-    {
-      x_ctrv_ = updated_x;
-      p_ctrv_ = updated_p;
-    }
-    else
-    {
-      x_rm_ = updated_x;
-      p_rm_ = updated_p;
-    }
+  double lambda;
+  if (num_meas != 0)
+  {
+    lambda =
+        (1 - gate_probability * detection_probability) / pow(Vk, num_meas) +
+        detection_probability * pow(Vk, 1 - num_meas) * e_sum / (num_meas * sqrt(2 * M_PI * s_pred.determinant()));
   }
+  else
+  {
+    lambda = (1 - gate_probability * detection_probability);
+  }
+  return lambda;
 }
 
-void UKF::updateMeasurementForCTRV(const std::vector<autoware_msgs::DetectedObject>& object_vec)
+template <int NumMeas>
+UKF::Vector<NumMeas> UKF::findMostLikelyMeasurement(const Vector<NumMeas>& z_pred,
+                                                    const Matrix<NumMeas, NumMeas>& s_pred,
+                                                    const std::vector<autoware_msgs::DetectedObject>& object_vec) const
 {
-  std::vector<double> e_ctrv_vec;
-  std::vector<Eigen::VectorXd> meas_vec;
+  const Matrix<NumMeas, NumMeas> s_inv = s_pred.inverse();
+  Vector<NumMeas> likely_meas = Vector<NumMeas>::Zero();
+  double max_e = -1;
   for (auto const& object : object_vec)
   {
-    Eigen::VectorXd meas;
-    if (is_direction_ctrv_available_)
-    {
-      meas = Eigen::VectorXd(num_lidar_direction_state_);
-      meas << object.pose.position.x, object.pose.position.y, object.angle;
-      meas_vec.push_back(meas);
-      Eigen::VectorXd diff_ctrv = meas - z_pred_lidar_direction_ctrv_;
-      double e_ctrv = exp(-0.5 * diff_ctrv.transpose() * s_lidar_direction_ctrv_.inverse() * diff_ctrv);
-      e_ctrv_vec.push_back(e_ctrv);
-    }
-    else
+    const Vector<NumMeas> meas = measurementOf<NumMeas>(object);
+    const Vector<NumMeas> diff = meas - z_pred;
+    const double e = exp(-0.5 * diff.dot(s_inv * diff));
+    if (e > max_e)
     {
-      meas = Eigen::VectorXd(num_lidar_state_);
-      meas << object.pose.position.x, object.pose.position.y;
-      meas_vec.push_back(meas);
-      Eigen::VectorXd diff_ctrv = meas - z_pred_ctrv_;
-      double e_ctrv = exp(-0.5 * diff_ctrv.transpose() * s_ctrv_.inverse() * diff_ctrv);
-      e_ctrv_vec.push_back(e_ctrv);
+      max_e = e;
+      likely_meas = meas;
     }
   }
-  std::vector<double>::iterator max_ctrv_iter = std::max_element(e_ctrv_vec.begin(), e_ctrv_vec.end());
-  int max_ctrv_ind = std::distance(e_ctrv_vec.begin(), max_ctrv_iter);
+  return likely_meas;
+}
+
+void UKF::updateMeasurementForCTRV(const std::vector<autoware_msgs::DetectedObject>& object_vec)
+{
   if (is_direction_ctrv_available_)
   {
-    lidar_direction_ctrv_meas_ = meas_vec[max_ctrv_ind];
+    lidar_direction_ctrv_meas_ = findMostLikelyMeasurement<NUM_LIDAR_DIRECTION_STATE>(
+        z_pred_lidar_direction_ctrv_, s_lidar_direction_ctrv_, object_vec);
   }
   else
   {
-    ctrv_meas_ = meas_vec[max_ctrv_ind];
+    ctrv_meas_ = findMostLikelyMeasurement<NUM_LIDAR_STATE>(z_pred_ctrv_, s_ctrv_, object_vec);
   }
 }
 
 void UKF::uppateForCTRV()
 {
-  Eigen::VectorXd x = x_ctrv_.col(0);
-
   if (is_direction_ctrv_available_)
   {
-    x_ctrv_.col(0) = x + k_lidar_direction_ctrv_ * (lidar_direction_ctrv_meas_ - z_pred_lidar_direction_ctrv_);
-    p_ctrv_ = p_ctrv_ - k_lidar_direction_ctrv_ * s_lidar_direction_ctrv_ * k_lidar_direction_ctrv_.transpose();
-    x_merge_.col(0) = x_ctrv_.col(0);
+    x_ctrv_ += k_lidar_direction_ctrv_ * (lidar_direction_ctrv_meas_ - z_pred_lidar_direction_ctrv_);
+    p_ctrv_ -= k_lidar_direction_ctrv_ * s_lidar_direction_ctrv_ * k_lidar_direction_ctrv_.transpose();
+    x_merge_ = x_ctrv_;
   }
   else
   {
-    x_ctrv_.col(0) = x + k_ctrv_ * (ctrv_meas_ - z_pred_ctrv_);
-    p_ctrv_ = p_ctrv_ - k_ctrv_ * s_ctrv_ * k_ctrv_.transpose();
-    x_merge_.col(0) = x_ctrv_.col(0);
+    x_ctrv_ += k_ctrv_ * (ctrv_meas_ - z_pred_ctrv_);
+    p_ctrv_ -= k_ctrv_ * s_ctrv_ * k_ctrv_.transpose();
+    x_merge_ = x_ctrv_;
   }
 }
 
@@ -758,7 +617,7 @@ void UKF::updateIMMUKF(const double detection_probability, const double gate_pro
   updateKalmanGain(MotionModel::RM);
 
   // update state varibale x and state covariance p
-  std::vector<double> lambda_vec;
+  ModelVector lambda_vec;
   updateEachMotion(detection_probability, gate_probability, gating_threshold, object_vec, lambda_vec);
   /*****************************************************************************
   *  IMM Merge Step
@@ -768,7 +627,7 @@ void UKF::updateIMMUKF(const double detection_probability, const double gate_pro
 }
 
 void UKF::ctrv(const double p_x, const double p_y, const double v, const double yaw, const double yawd,
-               const double delta_t, std::vector<double>& state)
+               const double delta_t, StateVector& state)
 {
   // predicted state values
   double px_p, py_p;
@@ -801,7 +660,7 @@ void UKF::ctrv(const double p_x, const double p_y, const double v, const double
 }
 
 void UKF::cv(const double p_x, const double p_y, const double v, const double yaw, const double yawd,
-             const double delta_t, std::vector<double>& state)
+             const double delta_t, StateVector& state)
 {
   // Reference: Bayesian Environment Representation, Prediction, and Criticality Assessment for Driver Assistance
   // Systems, 2016
@@ -819,7 +678,7 @@ void UKF::cv(const double p_x, const double p_y, const double v, const double ya
 }
 
 void UKF::randomMotion(const double p_x, const double p_y, const double v, const double yaw, const double yawd,
-                       const double delta_t, std::vector<double>& state)
+                       const double delta_t, StateVector& state)
 {
   // Reference: Bayesian Environment Representation, Prediction, and Criticality Assessment for Driver Assistance
   // Systems, 2016
@@ -883,47 +742,29 @@ void UKF::predictionMotion(const double delta_t, const int model_ind)
   /*****************************************************************************
  *  Initialize model parameters
  ****************************************************************************/
-  Eigen::MatrixXd x(x_cv_.rows(), 1);
-  Eigen::MatrixXd p(p_cv_.rows(), p_cv_.cols());
-  Eigen::MatrixXd q(p_cv_.rows(), p_cv_.cols());
-  Eigen::MatrixXd x_sig_pred(x_sig_pred_cv_.rows(), x_sig_pred_cv_.cols());
-  if (model_ind == MotionModel::CV)
-  {
-    x = x_cv_.col(0);
-    p = p_cv_;
-    q = q_cv_;
-    x_sig_pred = x_sig_pred_cv_;
-  }
-  else if (model_ind == MotionModel::CTRV)
-  {
-    x = x_ctrv_.col(0);
-    p = p_ctrv_;
-    q = q_ctrv_;
-    x_sig_pred = x_sig_pred_ctrv_;
-  }
-  else
-  {
-    x = x_rm_.col(0);
-    p = p_rm_;
-    q = q_rm_;
-    x_sig_pred = x_sig_pred_rm_;
-  }
+  StateVector& x = model_ind == MotionModel::CV ? x_cv_ : (model_ind == MotionModel::CTRV ? x_ctrv_ : x_rm_);
+  StateMatrix& p = model_ind == MotionModel::CV ? p_cv_ : (model_ind == MotionModel::CTRV ? p_ctrv_ : p_rm_);
+  const StateMatrix& q = model_ind == MotionModel::CV ? q_cv_ : (model_ind == MotionModel::CTRV ? q_ctrv_ : q_rm_);
+  SigmaMatrix& x_sig_pred = model_ind == MotionModel::CV ?
+                                x_sig_pred_cv_ :
+                                (model_ind == MotionModel::CTRV ? x_sig_pred_ctrv_ : x_sig_pred_rm_);
 
   /*****************************************************************************
   *  Create Sigma Points
   ****************************************************************************/
 
-  Eigen::MatrixXd x_sig = Eigen::MatrixXd(num_state_, 2 * num_state_ + 1);
+  SigmaMatrix x_sig;
 
   // create square root matrix
-  Eigen::MatrixXd L = p.llt().matrixL();
+  const StateMatrix L = p.llt().matrixL();
+  const double spread = sqrt(lambda_ + num_state_);
 
   // create augmented sigma points
   x_sig.col(0) = x;
   for (int i = 0; i < num_state_; i++)
   {
-    Eigen::VectorXd pred1 = x + sqrt(lambda_ + num_state_) * L.col(i);
-    Eigen::VectorXd pred2 = x - sqrt(lambda_ + num_state_) * L.col(i);
+    StateVector pred1 = x + spread * L.col(i);
+    StateVector pred2 = x - spread * L.col(i);
 
     while (pred1(3) > M_PI)
       pred1(3) -= 2. * M_PI;
@@ -943,7 +784,7 @@ void UKF::predictionMotion(const double delta_t, const int model_ind)
   *  Predict Sigma Points
   ****************************************************************************/
   // predict sigma points
-  for (int i = 0; i < 2 * num_state_ + 1; i++)
+  for (int i = 0; i < NUM_SIGMA; i++)
   {
     // extract values for better readability
     double p_x = x_sig(0, i);
@@ -952,7 +793,7 @@ void UKF::predictionMotion(const double delta_t, const int model_ind)
     double yaw = x_sig(3, i);
     double yawd = x_sig(4, i);
 
-    std::vector<double> state(5);
+    StateVector state;
     if (model_ind == MotionModel::CV)
       cv(p_x, p_y, v, yaw, yawd, delta_t, state);
     else if (model_ind == MotionModel::CTRV)
@@ -961,323 +802,144 @@ void UKF::predictionMotion(const double delta_t, const int model_ind)
       randomMotion(p_x, p_y, v, yaw, yawd, delta_t, state);
 
     // write predicted sigma point into right column
-    x_sig_pred(0, i) = state[0];
-    x_sig_pred(1, i) = state[1];
-    x_sig_pred(2, i) = state[2];
-    x_sig_pred(3, i) = state[3];
-    x_sig_pred(4, i) = state[4];
+    x_sig_pred.col(i) = state;
   }
 
   /*****************************************************************************
   *  Convert Predicted Sigma Points to Mean/Covariance
   ****************************************************************************/
   // predicted state mean
-  x.fill(0.0);
-  for (int i = 0; i < 2 * num_state_ + 1; i++)
-  {  // iterate over sigma points
-    x = x + weights_s_(i) * x_sig_pred.col(i);
-  }
+  x = x_sig_pred * weights_s_;
 
   while (x(3) > M_PI)
     x(3) -= 2. * M_PI;
   while (x(3) < -M_PI)
     x(3) += 2. * M_PI;
   // predicted state covariance matrix
-  p.fill(0.0);
-  for (int i = 0; i < 2 * num_state_ + 1; i++)
+  p = q;
+  for (int i = 0; i < NUM_SIGMA; i++)
   {  // iterate over sigma points
     // state difference
-    Eigen::VectorXd x_diff = x_sig_pred.col(i) - x;
+    StateVector x_diff = x_sig_pred.col(i) - x;
     // angle normalization
     while (x_diff(3) > M_PI)
       x_diff(3) -= 2. * M_PI;
     while (x_diff(3) < -M_PI)
       x_diff(3) += 2. * M_PI;
-    p = p + weights_c_(i) * x_diff * x_diff.transpose();
-  }
-
-  p = p + q;
-
-  /*****************************************************************************
-  *  Update model parameters
-  ****************************************************************************/
-  if (model_ind == MotionModel::CV)
-  {
-    x_cv_.col(0) = x;
-    p_cv_ = p;
-    x_sig_pred_cv_ = x_sig_pred;
-  }
-  else if (model_ind == MotionModel::CTRV)
-  {
-    x_ctrv_.col(0) = x;
-    p_ctrv_ = p;
-    x_sig_pred_ctrv_ = x_sig_pred;
-  }
-  else
-  {
-    x_rm_.col(0) = x;
-    p_rm_ = p;
-    x_sig_pred_rm_ = x_sig_pred;
+    p += weights_c_(i) * x_diff * x_diff.transpose();
   }
 }
 
-void UKF::updateKalmanGain(const int motion_ind)
+template <int NumMeas>
+void UKF::computeKalmanGain(const StateVector& x, const SigmaMatrix& x_sig_pred, const Vector<NumMeas>& z_pred,
+                            const Matrix<NumMeas, NumMeas>& s_pred, Matrix<NUM_STATE, NumMeas>& kalman_gain) const
 {
-  Eigen::VectorXd x(x_cv_.rows());
-  Eigen::MatrixXd x_sig_pred(x_sig_pred_cv_.rows(), x_sig_pred_cv_.cols());
-  Eigen::VectorXd z_pred;
-  Eigen::MatrixXd s_pred;
-  int num_meas_state = 0;
-  if (motion_ind == MotionModel::CV)
-  {
-    x = x_cv_.col(0);
-    x_sig_pred = x_sig_pred_cv_;
-    if (is_direction_cv_available_)
-    {
-      num_meas_state = num_lidar_direction_state_;
-      z_pred = Eigen::VectorXd(num_meas_state);
-      z_pred = z_pred_lidar_direction_cv_;
-      s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-      s_pred = s_lidar_direction_cv_;
-    }
-    else
-    {
-      num_meas_state = num_lidar_state_;
-      z_pred = Eigen::VectorXd(num_meas_state);
-      z_pred = z_pred_cv_;
-      s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-      s_pred = s_cv_;
-    }
-  }
-  else if (motion_ind == MotionModel::CTRV)
+  Matrix<NUM_STATE, NumMeas> cross_covariance = Matrix<NUM_STATE, NumMeas>::Zero();
+  for (int i = 0; i < NUM_SIGMA; i++)
   {
-    x = x_ctrv_.col(0);
-    x_sig_pred = x_sig_pred_ctrv_;
-    if (is_direction_ctrv_available_)
-    {
-      num_meas_state = num_lidar_direction_state_;
-      z_pred = Eigen::VectorXd(num_meas_state);
-      z_pred = z_pred_lidar_direction_ctrv_;
-      s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-      s_pred = s_lidar_direction_ctrv_;
-    }
-    else
-    {
-      num_meas_state = num_lidar_state_;
-      z_pred = Eigen::VectorXd(num_meas_state);
-      z_pred = z_pred_ctrv_;
-      s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-      s_pred = s_ctrv_;
-    }
-  }
-  else
-  {
-    x = x_rm_.col(0);
-    x_sig_pred = x_sig_pred_rm_;
-    if (is_direction_rm_available_)
-    {
-      num_meas_state = num_lidar_direction_state_;
-      z_pred = Eigen::VectorXd(num_meas_state);
-      z_pred = z_pred_lidar_direction_rm_;
-      s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-      s_pred = s_lidar_direction_rm_;
-    }
-    else
-    {
-      num_meas_state = num_lidar_state_;
-      z_pred = Eigen::VectorXd(num_meas_state);
-      z_pred = z_pred_rm_;
-      s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-      s_pred = s_rm_;
-    }
-  }
-
-  Eigen::MatrixXd cross_covariance = Eigen::MatrixXd(num_state_, num_meas_state);
-  cross_covariance.fill(0.0);
-  for (int i = 0; i < 2 * num_state_ + 1; i++)
-  {
-    Eigen::VectorXd z_sig_point(num_meas_state);
-    if (num_meas_state == num_lidar_direction_state_)
-    {
-      z_sig_point << x_sig_pred(0, i), x_sig_pred(1, i), x_sig_pred(3, i);
-    }
-    else
-    {
-      z_sig_point << x_sig_pred(0, i), x_sig_pred(1, i);
-    }
-    Eigen::VectorXd z_diff = z_sig_point - z_pred;
-    Eigen::VectorXd x_diff = x_sig_pred.col(i) - x;
+    Vector<NumMeas> z_diff = sigmaPointMeasurement<NumMeas>(x_sig_pred, i) - z_pred;
+    StateVector x_diff = x_sig_pred.col(i) - x;
 
     x_diff(3) = normalizeAngle(x_diff(3));
 
-    if (num_meas_state == num_lidar_direction_state_)
+    if (NumMeas == NUM_LIDAR_DIRECTION_STATE)
     {
-      z_diff(2) = normalizeAngle(z_diff(2));
+      z_diff(NumMeas - 1) = normalizeAngle(z_diff(NumMeas - 1));
     }
 
-    cross_covariance = cross_covariance + weights_c_(i) * x_diff * z_diff.transpose();
+    cross_covariance += weights_c_(i) * x_diff * z_diff.transpose();
   }
 
-  Eigen::MatrixXd kalman_gain = cross_covariance * s_pred.inverse();
-
-  if (num_meas_state == num_lidar_direction_state_)
-  {
-    if (motion_ind == MotionModel::CV)
-    {
-      k_lidar_direction_cv_ = kalman_gain;
-    }
-    else if (motion_ind == MotionModel::CTRV)
-    {
-      k_lidar_direction_ctrv_ = kalman_gain;
-    }
-    else
-    {
-      k_lidar_direction_rm_ = kalman_gain;
-    }
-  }
-  else
-  {
-    if (motion_ind == MotionModel::CV)
-    {
-      k_cv_ = kalman_gain;
-    }
-    else if (motion_ind == MotionModel::CTRV)
-    {
-      k_ctrv_ = kalman_gain;
-    }
-    else
-    {
-      k_rm_ = kalman_gain;
-    }
-  }
+  kalman_gain = cross_covariance * s_pred.inverse();
 }
 
-void UKF::predictionLidarMeasurement(const int motion_ind, const int num_meas_state)
+void UKF::updateKalmanGain(const int motion_ind)
 {
-  Eigen::MatrixXd x_sig_pred(x_sig_pred_cv_.rows(), x_sig_pred_cv_.cols());
-  Eigen::MatrixXd covariance_r(num_meas_state, num_meas_state);
   if (motion_ind == MotionModel::CV)
   {
-    x_sig_pred = x_sig_pred_cv_;
-    if (num_meas_state == num_lidar_direction_state_)
-      covariance_r = lidar_direction_r_cv_;
+    if (is_direction_cv_available_)
+      computeKalmanGain(x_cv_, x_sig_pred_cv_, z_pred_lidar_direction_cv_, s_lidar_direction_cv_,
+                        k_lidar_direction_cv_);
     else
-      covariance_r = r_cv_;
+      computeKalmanGain(x_cv_, x_sig_pred_cv_, z_pred_cv_, s_cv_, k_cv_);
   }
   else if (motion_ind == MotionModel::CTRV)
   {
-    x_sig_pred = x_sig_pred_ctrv_;
-    if (num_meas_state == num_lidar_direction_state_)
-      covariance_r = lidar_direction_r_ctrv_;
+    if (is_direction_ctrv_available_)
+      computeKalmanGain(x_ctrv_, x_sig_pred_ctrv_, z_pred_lidar_direction_ctrv_, s_lidar_direction_ctrv_,
+                        k_lidar_direction_ctrv_);
     else
-      covariance_r = r_ctrv_;
+      computeKalmanGain(x_ctrv_, x_sig_pred_ctrv_, z_pred_ctrv_, s_ctrv_, k_ctrv_);
   }
   else
   {
-    x_sig_pred = x_sig_pred_rm_;
-    if (num_meas_state == num_lidar_direction_state_)
-      covariance_r = lidar_direction_r_rm_;
+    if (is_direction_rm_available_)
+      computeKalmanGain(x_rm_, x_sig_pred_rm_, z_pred_lidar_direction_rm_, s_lidar_direction_rm_,
+                        k_lidar_direction_rm_);
     else
-      covariance_r = r_rm_;
+      computeKalmanGain(x_rm_, x_sig_pred_rm_, z_pred_rm_, s_rm_, k_rm_);
   }
+}
 
-  Eigen::MatrixXd z_sig = Eigen::MatrixXd(num_meas_state, 2 * num_state_ + 1);
-
-  for (int i = 0; i < 2 * num_state_ + 1; i++)
+template <int NumMeas>
+void UKF::predictMeasurement(const SigmaMatrix& x_sig_pred, const Matrix<NumMeas, NumMeas>& covariance_r,
+                             Vector<NumMeas>& z_pred, Matrix<NumMeas, NumMeas>& s_pred) const
+{
+  Matrix<NumMeas, NUM_SIGMA> z_sig;
+  for (int i = 0; i < NUM_SIGMA; i++)
   {
-    double p_x = x_sig_pred(0, i);
-    double p_y = x_sig_pred(1, i);
-
-    z_sig(0, i) = p_x;
-    z_sig(1, i) = p_y;
-
-    if (num_meas_state == num_lidar_direction_state_)
-    {
-      double p_yaw = x_sig_pred(3, i);
-      z_sig(2, i) = p_yaw;
-    }
+    z_sig.col(i) = sigmaPointMeasurement<NumMeas>(x_sig_pred, i);
   }
 
-  Eigen::VectorXd z_pred = Eigen::VectorXd(num_meas_state);
-  z_pred.fill(0.0);
-  for (int i = 0; i < 2 * num_state_ + 1; i++)
-  {
-    z_pred = z_pred + weights_s_(i) * z_sig.col(i);
-  }
+  z_pred = z_sig * weights_s_;
 
-  if (num_meas_state == num_lidar_direction_state_)
-    z_pred(2) = normalizeAngle(z_pred(2));
+  if (NumMeas == NUM_LIDAR_DIRECTION_STATE)
+    z_pred(NumMeas - 1) = normalizeAngle(z_pred(NumMeas - 1));
 
-  Eigen::MatrixXd s_pred = Eigen::MatrixXd(num_meas_state, num_meas_state);
-  s_pred.fill(0.0);
-  for (int i = 0; i < 2 * num_state_ + 1; i++)
+  // add measurement noise covariance matrix
+  s_pred = covariance_r;
+  for (int i = 0; i < NUM_SIGMA; i++)
   {
-    Eigen::VectorXd z_diff = z_sig.col(i) - z_pred;
-    if (num_meas_state == num_lidar_direction_state_)
-      z_diff(2) = normalizeAngle(z_diff(2));
-    s_pred = s_pred + weights_c_(i) * z_diff * z_diff.transpose();
+    Vector<NumMeas> z_diff = z_sig.col(i) - z_pred;
+    if (NumMeas == NUM_LIDAR_DIRECTION_STATE)
+      z_diff(NumMeas - 1) = normalizeAngle(z_diff(NumMeas - 1));
+    s_pred += weights_c_(i) * z_diff * z_diff.transpose();
   }
+}
 
-  // add measurement noise covariance matrix
-  s_pred += covariance_r;
-
+void UKF::predictionLidarMeasurement(const int motion_ind, const int num_meas_state)
+{
   if (num_meas_state == num_lidar_direction_state_)
   {
     if (motion_ind == MotionModel::CV)
-    {
-      z_pred_lidar_direction_cv_ = z_pred;
-      s_lidar_direction_cv_ = s_pred;
-    }
+      predictMeasurement(x_sig_pred_cv_, lidar_direction_r_cv_, z_pred_lidar_direction_cv_, s_lidar_direction_cv_);
     else if (motion_ind == MotionModel::CTRV)
-    {
-      z_pred_lidar_direction_ctrv_ = z_pred;
-      s_lidar_direction_ctrv_ = s_pred;
-    }
+      predictMeasurement(x_sig_pred_ctrv_, lidar_direction_r_ctrv_, z_pred_lidar_direction_ctrv_,
+                         s_lidar_direction_ctrv_);
     else
-    {
-      z_pred_lidar_direction_rm_ = z_pred;
-      s_lidar_direction_rm_ = s_pred;
-    }
+      predictMeasurement(x_sig_pred_rm_, lidar_direction_r_rm_, z_pred_lidar_direction_rm_, s_lidar_direction_rm_);
   }
   else
   {
     if (motion_ind == MotionModel::CV)
-    {
-      z_pred_cv_ = z_pred;
-      s_cv_ = s_pred;
-    }
+      predictMeasurement(x_sig_pred_cv_, r_cv_, z_pred_cv_, s_cv_);
     else if (motion_ind == MotionModel::CTRV)
-    {
-      z_pred_ctrv_ = z_pred;
-      s_ctrv_ = s_pred;
-    }
+      predictMeasurement(x_sig_pred_ctrv_, r_ctrv_, z_pred_ctrv_, s_ctrv_);
     else
-    {
-      z_pred_rm_ = z_pred;
-      s_rm_ = s_pred;
-    }
+      predictMeasurement(x_sig_pred_rm_, r_rm_, z_pred_rm_, s_rm_);
   }
 }
 
 double UKF::calculateNIS(const autoware_msgs::DetectedObject& in_object, const int motion_ind)
 {
-  Eigen::VectorXd z_pred = Eigen::VectorXd(num_lidar_direction_state_);
-  Eigen::MatrixXd s_pred = Eigen::MatrixXd(num_lidar_direction_state_, num_lidar_direction_state_);
-  if (motion_ind == MotionModel::CV)
-  {
-    z_pred = z_pred_lidar_direction_cv_;
-    s_pred = s_lidar_direction_cv_;
-  }
-  else if (motion_ind == MotionModel::CTRV)
-  {
-    z_pred = z_pred_lidar_direction_ctrv_;
-    s_pred = s_lidar_direction_ctrv_;
-  }
-  else
-  {
-    z_pred = z_pred_lidar_direction_rm_;
-    s_pred = s_lidar_direction_rm_;
-  }
+  const DirectionVector& z_pred =
+      motion_ind == MotionModel::CV ?
+          z_pred_lidar_direction_cv_ :
+          (motion_ind == MotionModel::CTRV ? z_pred_lidar_direction_ctrv_ : z_pred_lidar_direction_rm_);
+  const DirectionMatrix& s_pred =
+      motion_ind == MotionModel::CV ?
+          s_lidar_direction_cv_ :
+          (motion_ind == MotionModel::CTRV ? s_lidar_direction_ctrv_ : s_lidar_direction_rm_);
 
   // Pick up yaw estimation and yaw variance
   double diff = in_object.angle - z_pred(2);
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Throughput of the prediction and update of the UKF, for targets moving on straight lines and turns.
+// Each frame, every target is predicted, then updated with its detection, or without detection one frame out of
+// ten, as imm_ukf_pda does.
+//
+// usage: ukf_benchmark [targets] [frames] [use_sukf]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <imm_ukf_pda/ukf.h>
+
+int main(int argc, char** argv)
+{
+  const int targets_num = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+  const int frames_num = argc > 2 ? std::max(1, std::atoi(argv[2])) : 200;
+  const bool use_sukf = argc > 3 && std::atoi(argv[3]) != 0;
+
+  const double dt = 0.1;
+  const double detection_probability = 0.9;
+  const double gate_probability = 0.99;
+  const double gating_threshold = 9.22;
+
+  std::srand(0);
+  std::vector<UKF> targets(targets_num);
+  std::vector<double> speeds(targets_num), yaw_rates(targets_num), yaws(targets_num);
+  std::vector<Eigen::Vector2d> positions(targets_num);
+  for (int t = 0; t < targets_num; t++)
+  {
+    positions[t] = Eigen::Vector2d(std::rand() % 200 - 100, std::rand() % 200 - 100);
+    speeds[t] = (std::rand() % 150) / 10.0;
+    yaw_rates[t] = (std::rand() % 2) * ((std::rand() % 100) / 200.0 - 0.25);
+    yaws[t] = (std::rand() % 628) / 100.0 - M_PI;
+    targets[t].initialize(positions[t], 0, t);
+
+    // velocity and yaw as set by the second detection of a target
+    UKF& target = targets[t];
+    target.x_merge_(2) = target.x_cv_(2) = target.x_ctrv_(2) = target.x_rm_(2) = speeds[t];
+    target.x_merge_(3) = target.x_cv_(3) = target.x_ctrv_(3) = target.x_rm_(3) = yaws[t];
+  }
+
+  typedef std::chrono::steady_clock Clock;
+  double total = 0;
+  std::vector<autoware_msgs::DetectedObject> object_vec;
+  for (int frame = 1; frame <= frames_num; frame++)
+  {
+    const Clock::time_point start = Clock::now();
+    for (int t = 0; t < targets_num; t++)
+    {
+      yaws[t] += yaw_rates[t] * dt;
+      positions[t] += speeds[t] * dt * Eigen::Vector2d(std::cos(yaws[t]), std::sin(yaws[t]));
+
+      object_vec.clear();
+      if ((frame + t) % 10 != 0)
+      {
+        autoware_msgs::DetectedObject object;
+        object.pose.position.x = positions[t](0) + ((std::rand() % 21) - 10) / 100.0;
+        object.pose.position.y = positions[t](1) + ((std::rand() % 21) - 10) / 100.0;
+        object_vec.push_back(object);
+      }
+
+      targets[t].prediction(use_sukf, false, dt);
+      targets[t].update(use_sukf, detection_probability, gate_probability, gating_threshold, object_vec);
+      // the process noise is set at the first prediction
+      targets[t].tracking_num_ = TrackingState::Stable;
+    }
+    total += std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  int tracked_num = 0;
+  for (int t = 0; t < targets_num; t++)
+  {
+    tracked_num += std::hypot(targets[t].x_merge_(0) - positions[t](0), targets[t].x_merge_(1) - positions[t](1)) < 1.0;
+  }
+
+  std::printf("%s: %d targets, %d frames, %.2f us per target predict+update, %d targets within 1 m at the end\n",
+              use_sukf ? "sukf" : "imm_ukf", targets_num, frames_num, total / (targets_num * frames_num) * 1e6,
+              tracked_num);
+  return 0;
+}
@@ -181,8 +181,8 @@ void ImmUkfPdaLanelet2::transformPoseToLocal(autoware_msgs::DetectedObjectArray*
 }
 
 void ImmUkfPdaLanelet2::measurementValidation(const autoware_msgs::DetectedObjectArray& input, UKF* target_ptr,
-                                              const bool second_init, const Eigen::VectorXd& max_det_z,
-                                              const Eigen::MatrixXd& max_det_s,
+                                              const bool second_init, const UKF::LidarVector& max_det_z,
+                                              const UKF::LidarMatrix& max_det_s,
                                               std::vector<autoware_msgs::DetectedObject>* object_vec_ptr,
                                               std::vector<bool>* matching_vec_ptr)
 {
@@ -196,10 +196,10 @@ void ImmUkfPdaLanelet2::measurementValidation(const autoware_msgs::DetectedObjec
     const double x = input.objects[i].pose.position.x;
     const double y = input.objects[i].pose.position.y;
 
-    Eigen::VectorXd meas = Eigen::VectorXd(2);
+    UKF::LidarVector meas;
     meas << x, y;
 
-    Eigen::VectorXd diff = meas - max_det_z;
+    const UKF::LidarVector diff = meas - max_det_z;
     const double nis = diff.transpose() * max_det_s.inverse() * diff;
 
     if (nis < param_.gating_threshold_)
@@ -377,7 +377,7 @@ void ImmUkfPdaLanelet2::initTracker(const autoware_msgs::DetectedObjectArray& in
   {
     const double px = input.objects[i].pose.position.x;
     const double py = input.objects[i].pose.position.y;
-    Eigen::VectorXd init_meas = Eigen::VectorXd(2);
+    UKF::LidarVector init_meas;
     init_meas << px, py;
 
     UKF ukf;
@@ -464,8 +464,8 @@ bool ImmUkfPdaLanelet2::probabilisticDataAssociation(const autoware_msgs::Detect
                                                      UKF* target_ptr)
 {
   double det_s = 0;
-  Eigen::VectorXd max_det_z;
-  Eigen::MatrixXd max_det_s;
+  UKF::LidarVector max_det_z;
+  UKF::LidarMatrix max_det_s;
   bool success = true;
 
   if (param_.use_sukf_)
@@ -529,7 +529,7 @@ void ImmUkfPdaLanelet2::makeNewTargets(const double timestamp, const autoware_ms
     {
       double px = input.objects[i].pose.position.x;
       double py = input.objects[i].pose.position.y;
-      Eigen::VectorXd init_meas = Eigen::VectorXd(2);
+      UKF::LidarVector init_meas;
       init_meas << px, py;
 
       UKF ukf;
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <imm_ukf_pda/lane_direction_index.h>
+
+namespace
+{
+const int POINT_COUNT = 600;
+const int QUERY_COUNT = 500;
+
+// Coordinates on a 0.5 m grid, so that several lanes begin at the same distance of a query
+double randomCoordinate(std::mt19937& rng)
+{
+  return std::uniform_int_distribution<int>(-200, 200)(rng) * 0.5;
+}
+}  // namespace
+
+class LaneDirectionIndexTestSuite : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    std::mt19937 rng(1234);
+    for (int pid = 1; pid <= POINT_COUNT; ++pid)
+    {
+      vector_map_msgs::Point point;
+      point.pid = pid;
+      point.bx = randomCoordinate(rng);
+      point.ly = randomCoordinate(rng);
+      points_.data.push_back(point);
+      vector_map_msgs::Node node;
+      node.nid = pid;
+      node.pid = pid;
+      nodes_.data.push_back(node);
+    }
+    // lanes chained like the lanes of a road, some of them sharing their begin point
+    std::uniform_int_distribution<int> node_id(1, POINT_COUNT);
+    for (int lnid = 1; lnid <= POINT_COUNT; ++lnid)
+    {
+      vector_map_msgs::Lane lane;
+      lane.lnid = lnid;
+      lane.bnid = lnid % 7 == 0 ? node_id(rng) : lnid;
+      lane.fnid = lnid % POINT_COUNT + 1;
+      lanes_.data.push_back(lane);
+    }
+
+    ros::NodeHandle nh;
+    std::vector<ros::Publisher> pubs;
+    pubs.push_back(nh.advertise<vector_map_msgs::PointArray>("/vector_map_info/point", 1, true));
+    pubs.back().publish(points_);
+    pubs.push_back(nh.advertise<vector_map_msgs::NodeArray>("/vector_map_info/node", 1, true));
+    pubs.back().publish(nodes_);
+    pubs.push_back(nh.advertise<vector_map_msgs::LaneArray>("/vector_map_info/lane", 1, true));
+    pubs.back().publish(lanes_);
+    vmap_.subscribe(nh, vector_map::Category::POINT | vector_map::Category::NODE | vector_map::Category::LANE,
+                    ros::Duration(10.0));
+    ASSERT_TRUE(vmap_.hasSubscribed(vector_map::Category::POINT | vector_map::Category::NODE |
+                                    vector_map::Category::LANE));
+    lanes_list_ = vmap_.findByFilter([](const vector_map_msgs::Lane& lane) { return true; });
+  }
+
+  // The nearest lane as found before the index, with a scan over all the lanes
+  bool findNearestLaneDirectionByScan(const double x, const double y, const double max_distance, double& yaw) const
+  {
+    double min_dist = std::numeric_limits<double>::max();
+    for (auto const& lane : lanes_list_)
+    {
+      vector_map_msgs::Node node = vmap_.findByKey(vector_map::Key<vector_map_msgs::Node>(lane.bnid));
+      vector_map_msgs::Point point = vmap_.findByKey(vector_map::Key<vector_map_msgs::Point>(node.pid));
+      double distance = std::sqrt(std::pow(point.bx - y, 2) + std::pow(point.ly - x, 2));
+      if (distance < min_dist)
+      {
+        min_dist = distance;
+        vector_map_msgs::Node front_node = vmap_.findByKey(vector_map::Key<vector_map_msgs::Node>(lane.fnid));
+        vector_map_msgs::Point front_point =
+            vmap_.findByKey(vector_map::Key<vector_map_msgs::Point>(front_node.pid));
+        yaw = std::atan2((front_point.bx - point.bx), (front_point.ly - point.ly));
+      }
+    }
+    return min_dist < max_distance;
+  }
+
+  vector_map_msgs::PointArray points_;
+  vector_map_msgs::NodeArray nodes_;
+  vector_map_msgs::LaneArray lanes_;
+  vector_map::VectorMap vmap_;
+  std::vector<vector_map_msgs::Lane> lanes_list_;
+};
+
+TEST_F(LaneDirectionIndexTestSuite, nearestLaneMatchesScan)
+{
+  // the default threshold of imm_ukf_pda, and distances up to several cells of the vector map index and beyond
+  const double max_distances[] = { 0.5, 1.5, 2.0, 4.0, 12.0, 1000.0 };
+  LaneDirectionIndex index;
+  index.build(vmap_, lanes_list_);
+
+  std::mt19937 rng(99);
+  int found_num = 0;
+  for (const double max_distance : max_distances)
+  {
+    for (int q = 0; q < QUERY_COUNT; ++q)
+    {
+      const double x = randomCoordinate(rng) + (q % 3) * 0.25;
+      const double y = randomCoordinate(rng);
+      double expected_yaw = 0;
+      const bool expected_found = findNearestLaneDirectionByScan(x, y, max_distance, expected_yaw);
+      double yaw = 0;
+      const bool found = index.findNearestLaneDirection(vmap_, x, y, max_distance, yaw);
+      ASSERT_EQ(expected_found, found) << "query " << q << " at (" << x << ", " << y << "), " << max_distance;
+      if (found)
+      {
+        EXPECT_EQ(expected_yaw, yaw) << "query " << q << " at (" << x << ", " << y << "), " << max_distance;
+        found_num++;
+      }
+    }
+  }
+  // both the found and not found cases are covered
+  EXPECT_GT(found_num, QUERY_COUNT);
+  EXPECT_LT(found_num, 6 * QUERY_COUNT);
+}
+
+TEST_F(LaneDirectionIndexTestSuite, invalidQueriesFindNothing)
+{
+  LaneDirectionIndex index;
+  double yaw = 0;
+  EXPECT_FALSE(index.findNearestLaneDirection(vmap_, 0, 0, 10.0, yaw));
+
+  index.build(vmap_, lanes_list_);
+  EXPECT_FALSE(index.findNearestLaneDirection(vmap_, std::numeric_limits<double>::quiet_NaN(), 0, 10.0, yaw));
+  EXPECT_FALSE(index.findNearestLaneDirection(vmap_, 0, 0, 0.0, yaw));
+  EXPECT_TRUE(index.findNearestLaneDirection(vmap_, 0, 0, std::numeric_limits<double>::infinity(), yaw));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_lane_direction_index");
+  ros::NodeHandle nh;
+  return RUN_ALL_TESTS();
+}
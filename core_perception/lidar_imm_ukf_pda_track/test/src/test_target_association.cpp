@@ -0,0 +1,221 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <imm_ukf_pda/target_association.h>
+
+class TargetAssociationTestSuite : public ::testing::Test
+{
+protected:
+  static constexpr double GATING_THRESHOLD = 9.22;
+
+  typedef std::vector<Eigen::Matrix2d, Eigen::aligned_allocator<Eigen::Matrix2d> > Covariances;
+
+  // Association as done before by measurementValidation, one target at a time over all the detections
+  static void associatePerTarget(const AssociationDetections& targets, const Covariances& covariances,
+                                 const AssociationDetections& detections, std::vector<int>& detection_indices)
+  {
+    detection_indices.assign(targets.size(), -1);
+    for (size_t t = 0; t < targets.size(); t++)
+    {
+      Eigen::VectorXd max_det_z = Eigen::VectorXd(2);
+      max_det_z << targets[t](0), targets[t](1);
+      Eigen::MatrixXd s = covariances[t];
+      double smallest_nis = std::numeric_limits<double>::max();
+      for (size_t i = 0; i < detections.size(); i++)
+      {
+        Eigen::VectorXd meas = Eigen::VectorXd(2);
+        meas << detections[i](0), detections[i](1);
+
+        Eigen::VectorXd diff = meas - max_det_z;
+        double nis = diff.transpose() * s.inverse() * diff;
+        if (nis < GATING_THRESHOLD && nis < smallest_nis)
+        {
+          smallest_nis = nis;
+          detection_indices[t] = i;
+        }
+      }
+    }
+  }
+
+  // A busy frame: clusters of targets with detections scattered around them, anisotropic and rotated
+  // innovation covariances of very different sizes, and a few detections far from every target
+  static void makeScenario(AssociationDetections& targets, Covariances& covariances, AssociationDetections& detections)
+  {
+    std::mt19937 generator(20190611);
+    std::uniform_real_distribution<double> position(-60.0, 60.0);
+    std::uniform_real_distribution<double> angle(0.0, M_PI);
+    std::uniform_real_distribution<double> log_std(-1.5, 1.5);
+    std::normal_distribution<double> noise(0.0, 1.5);
+
+    for (int t = 0; t < 120; t++)
+    {
+      const Eigen::Vector2d target(position(generator), position(generator));
+      targets.push_back(target);
+
+      const Eigen::Rotation2Dd rotation(angle(generator));
+      const Eigen::Vector2d stds(std::exp(log_std(generator)), std::exp(log_std(generator)));
+      covariances.push_back(rotation.toRotationMatrix() * stds.cwiseProduct(stds).asDiagonal() *
+                            rotation.toRotationMatrix().transpose());
+
+      const int detections_num = t % 4;
+      for (int i = 0; i < detections_num; i++)
+      {
+        detections.push_back(target + Eigen::Vector2d(noise(generator), noise(generator)));
+      }
+    }
+    for (int i = 0; i < 20; i++)
+    {
+      detections.push_back(Eigen::Vector2d(position(generator) + 200.0, position(generator)));
+    }
+    // a target with a gate larger than the grid covers, whose NIS is checked for all the detections
+    targets.push_back(Eigen::Vector2d(0, 0));
+    covariances.push_back(Eigen::Matrix2d::Identity() * 1e6);
+  }
+};
+
+constexpr double TargetAssociationTestSuite::GATING_THRESHOLD;
+
+TEST_F(TargetAssociationTestSuite, nearestMatchesPerTargetGating)
+{
+  AssociationDetections targets, detections;
+  Covariances covariances;
+  makeScenario(targets, covariances, detections);
+
+  std::vector<int> expected_indices;
+  associatePerTarget(targets, covariances, detections, expected_indices);
+
+  TargetAssociation association;
+  association.setGatingThreshold(GATING_THRESHOLD);
+  association.setMethod(TargetAssociation::NEAREST);
+  AssociationGates gates;
+  for (size_t t = 0; t < targets.size(); t++)
+  {
+    gates.push_back(association.makeGate(targets[t], covariances[t]));
+  }
+  std::vector<int> detection_indices;
+  std::vector<double> nis_values;
+  association.associate(gates, detections, detection_indices, nis_values);
+
+  ASSERT_EQ(expected_indices.size(), detection_indices.size());
+  int associated_num = 0;
+  for (size_t t = 0; t < targets.size(); t++)
+  {
+    EXPECT_EQ(expected_indices[t], detection_indices[t]) << "target " << t;
+    if (detection_indices[t] >= 0)
+    {
+      associated_num++;
+      const Eigen::Vector2d diff = detections[detection_indices[t]] - targets[t];
+      EXPECT_NEAR(diff.dot(covariances[t].inverse() * diff), nis_values[t], 1e-9);
+    }
+    else
+    {
+      EXPECT_EQ(std::numeric_limits<double>::max(), nis_values[t]);
+    }
+  }
+  // the scenario is not trivial: some targets are associated and some are not
+  EXPECT_GT(associated_num, 20);
+  EXPECT_LT(associated_num, static_cast<int>(targets.size()));
+
+  // the buffers reused in the next frame give the same result
+  association.associate(gates, detections, detection_indices, nis_values);
+  EXPECT_EQ(expected_indices, detection_indices);
+}
+
+TEST_F(TargetAssociationTestSuite, invalidGatesAreNotAssociated)
+{
+  TargetAssociation association;
+  association.setGatingThreshold(GATING_THRESHOLD);
+  AssociationGates gates(2);
+  gates[1] = association.makeGate(Eigen::Vector2d(1, 1), Eigen::Matrix2d::Identity());
+  AssociationDetections detections;
+  detections.push_back(Eigen::Vector2d(0, 0));
+  detections.push_back(Eigen::Vector2d(1, 1.5));
+
+  std::vector<int> detection_indices;
+  std::vector<double> nis_values;
+  association.associate(gates, detections, detection_indices, nis_values);
+  ASSERT_EQ(2u, detection_indices.size());
+  EXPECT_EQ(-1, detection_indices[0]);
+  EXPECT_EQ(1, detection_indices[1]);
+  EXPECT_NEAR(0.25, nis_values[1], 1e-12);
+}
+
+TEST_F(TargetAssociationTestSuite, globalNearestGivesEachDetectionOnce)
+{
+  // both targets are nearest to detection 0, the global assignment gives detection 1 to the second target
+  TargetAssociation association;
+  association.setGatingThreshold(GATING_THRESHOLD);
+  association.setMethod(TargetAssociation::GLOBAL_NEAREST);
+  AssociationGates gates;
+  gates.push_back(association.makeGate(Eigen::Vector2d(0, 0), Eigen::Matrix2d::Identity()));
+  gates.push_back(association.makeGate(Eigen::Vector2d(1, 0), Eigen::Matrix2d::Identity()));
+  AssociationDetections detections;
+  detections.push_back(Eigen::Vector2d(0.5, 0));
+  detections.push_back(Eigen::Vector2d(2, 0));
+
+  std::vector<int> detection_indices;
+  std::vector<double> nis_values;
+  association.associate(gates, detections, detection_indices, nis_values);
+  ASSERT_EQ(2u, detection_indices.size());
+  EXPECT_EQ(0, detection_indices[0]);
+  EXPECT_EQ(1, detection_indices[1]);
+  EXPECT_NEAR(0.25, nis_values[0], 1e-12);
+  EXPECT_NEAR(1.0, nis_values[1], 1e-12);
+
+  association.setMethod(TargetAssociation::NEAREST);
+  association.associate(gates, detections, detection_indices, nis_values);
+  EXPECT_EQ(0, detection_indices[0]);
+  EXPECT_EQ(0, detection_indices[1]);
+}
+
+TEST_F(TargetAssociationTestSuite, farAndNonFiniteCoordinatesAreNotBinned)
+{
+  // coordinates whose cells do not fit in an int are checked without the grid, and never match a gate near them
+  TargetAssociation association;
+  association.setGatingThreshold(GATING_THRESHOLD);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  AssociationGates gates;
+  gates.push_back(association.makeGate(Eigen::Vector2d(0, 0), Eigen::Matrix2d::Identity()));
+  gates.push_back(association.makeGate(Eigen::Vector2d(1e12, -1e12), Eigen::Matrix2d::Identity()));
+  gates.push_back(association.makeGate(Eigen::Vector2d(nan, 0), Eigen::Matrix2d::Identity()));
+  AssociationDetections detections;
+  detections.push_back(Eigen::Vector2d(1e12, -1e12 + 1));
+  detections.push_back(Eigen::Vector2d(0, nan));
+  detections.push_back(Eigen::Vector2d(std::numeric_limits<double>::infinity(), 0));
+  detections.push_back(Eigen::Vector2d(0.5, 0));
+
+  std::vector<int> detection_indices;
+  std::vector<double> nis_values;
+  association.associate(gates, detections, detection_indices, nis_values);
+  ASSERT_EQ(3u, detection_indices.size());
+  EXPECT_EQ(3, detection_indices[0]);
+  EXPECT_EQ(0, detection_indices[1]);
+  EXPECT_EQ(-1, detection_indices[2]);
+  EXPECT_NEAR(1.0, nis_values[1], 1e-12);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
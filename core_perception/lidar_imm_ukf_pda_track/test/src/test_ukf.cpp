@@ -0,0 +1,191 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <imm_ukf_pda/ukf.h>
+
+// The reference values were computed with the dynamic-size Eigen implementation of the UKF on the same inputs.
+class UKFTestSuite : public ::testing::Test
+{
+protected:
+  static constexpr double TOLERANCE = 1e-9;
+  static constexpr double DT = 0.1;
+
+  // A target moving at 4 m/s and turning, with correlated position, yaw and yaw rate uncertainties
+  static void initializeTarget(UKF& ukf)
+  {
+    ukf.initialize(UKF::LidarVector(1, 2), 0, 0);
+
+    UKF::StateVector x;
+    x << 1.0, 2.0, 4.0, 0.3, 0.2;
+    UKF::StateMatrix p;
+    // clang-format off
+    p << 0.5, 0.1,   0,    0,    0,
+         0.1, 0.6,   0, 0.05,    0,
+           0,   0, 2.0,    0,  0.1,
+           0, 0.05,  0,  0.4, 0.02,
+           0,   0, 0.1, 0.02,  0.3;
+    // clang-format on
+    ukf.x_cv_ = ukf.x_ctrv_ = ukf.x_rm_ = ukf.x_merge_ = x;
+    ukf.p_cv_ = ukf.p_ctrv_ = ukf.p_rm_ = ukf.p_merge_ = p;
+  }
+
+  // expected holds the coefficients in row-major order
+  template <typename Derived>
+  static void expectNear(const double* expected, const Eigen::MatrixBase<Derived>& actual, const char* name)
+  {
+    for (int row = 0; row < actual.rows(); row++)
+    {
+      for (int col = 0; col < actual.cols(); col++)
+      {
+        EXPECT_NEAR(expected[row * actual.cols() + col], actual(row, col), TOLERANCE)
+            << name << "(" << row << ", " << col << ")";
+      }
+    }
+  }
+};
+
+constexpr double UKFTestSuite::TOLERANCE;
+constexpr double UKFTestSuite::DT;
+
+TEST_F(UKFTestSuite, predictsConstantVelocity)
+{
+  UKF ukf;
+  initializeTarget(ukf);
+  ukf.initCovarQs(DT, ukf.x_merge_(3));
+  ukf.predictionMotion(DT, MotionModel::CV);
+
+  const double x[] = { 1.30570775444, 2.09456649024, 4, 0.300000000002, 0 };
+  // clang-format off
+  const double p[] = { 0.53557619749, 0.0852971642621, 0.192142051375, -0.0472831366597, 0,
+                       0.0852971642622, 0.699493379867, 0.0594365015646, 0.202853526604, 0,
+                       0.192142051375, 0.0594365015646, 2.0225, 0, 0,
+                       -0.0472831366597, 0.202853526604, 0, 0.40005625, 0.001125,
+                       0, 0, 0, 0.001125, 0.0225 };
+  // clang-format on
+  expectNear(x, ukf.x_cv_, "x_cv");
+  expectNear(p, ukf.p_cv_, "p_cv");
+}
+
+TEST_F(UKFTestSuite, predictsConstantTurnRateAndVelocity)
+{
+  UKF ukf;
+  initializeTarget(ukf);
+  ukf.initCovarQs(DT, ukf.x_merge_(3));
+  ukf.predictionMotion(DT, MotionModel::CTRV);
+
+  const double x[] = { 1.3040169495, 2.09790755824, 4, 0.320000000002, 0.199999999999 };
+  // clang-format off
+  const double p[] = { 0.535899738735, 0.0848755854858, 0.190921837117, -0.0484084206661, 0.00523338584609,
+                       0.0848755854857, 0.699678258024, 0.0632457723391, 0.204388725576, 0.0163768663145,
+                       0.190921837117, 0.0632457723391, 2.0225, 0.01, 0.1,
+                       -0.0484084206661, 0.204388725576, 0.01, 0.40705625, 0.051125,
+                       0.00523338584609, 0.0163768663145, 0.1, 0.051125, 0.3225 };
+  // clang-format on
+  expectNear(x, ukf.x_ctrv_, "x_ctrv");
+  expectNear(p, ukf.p_ctrv_, "p_ctrv");
+}
+
+TEST_F(UKFTestSuite, predictsRandomMotion)
+{
+  UKF ukf;
+  initializeTarget(ukf);
+  ukf.initCovarQs(DT, ukf.x_merge_(3));
+  ukf.predictionMotion(DT, MotionModel::RM);
+
+  const double x[] = { 1, 2, 0, 0.300000000002, 0 };
+  // clang-format off
+  const double p[] = { 0.500205350257, 0.100063522278, 0.00429901420107, 0, 0,
+                       0.100063522278, 0.600019649743, 0.00132984092998, 0.05, 0,
+                       0.00429901420107, 0.00132984092998, 0.09, 0, 0,
+                       0, 0.05, 0, 0.400225, 0.0045,
+                       0, 0, 0, 0.0045, 0.09 };
+  // clang-format on
+  expectNear(x, ukf.x_rm_, "x_rm");
+  expectNear(p, ukf.p_rm_, "p_rm");
+}
+
+TEST_F(UKFTestSuite, updatesEachMotionModel)
+{
+  UKF ukf;
+  initializeTarget(ukf);
+  // two detections in the gates, the nearest one ahead of the target
+  std::vector<autoware_msgs::DetectedObject> objects(2);
+  objects[0].pose.position.x = 1.45;
+  objects[0].pose.position.y = 2.15;
+  objects[1].pose.position.x = 1.1;
+  objects[1].pose.position.y = 2.5;
+
+  ukf.prediction(false, false, DT);
+  ukf.update(false, 0.9, 0.99, 9.22, objects);
+
+  const double x_cv[] = { 1.29056956665, 2.2987707622, 4.00323723776, 0.364710060825, 0 };
+  // clang-format off
+  const double p_cv[] = { 0.0627465097082, -0.0216871861363, 0.0221186570606, -0.0152547105735, 0,
+                          -0.0216871861363, 0.0277538194683, -0.00610622513239, 0.0114875291918, 0,
+                          0.0221186570606, -0.00610622513237, 1.96022993317, 0.00321324562313, 0,
+                          -0.0152547105735, 0.0114875291918, 0.00321324562313, 0.336967682551, 0.001125,
+                          0, 0, 0, 0.001125, 0.0225 };
+  // clang-format on
+  expectNear(x_cv, ukf.x_cv_, "x_cv");
+  expectNear(p_cv, ukf.p_cv_, "p_cv");
+
+  const double x_ctrv[] = { 1.2901665502, 2.29925389136, 4.00483579331, 0.384147535829, 0.204476348902 };
+  // clang-format off
+  const double p_ctrv[] = { 0.0627861339703, -0.0220069146089, 0.0217714913576, -0.0155428012376, -0.000111368869634,
+                            -0.0220069146089, 0.028870720022, -0.00592138111242, 0.0119871494355, 0.0005179486317,
+                            0.0217714913576, -0.00592138111246, 1.96054270053, 0.0121851729782, 0.0973877866537,
+                            -0.0155428012376, 0.0119871494355, 0.0121851729782, 0.343024380158, 0.0469687978492,
+                            -0.00011136886963, 0.000517948631699, 0.0973877866537, 0.0469687978492, 0.322107660716 };
+  // clang-format on
+  expectNear(x_ctrv, ukf.x_ctrv_, "x_ctrv");
+  expectNear(p_ctrv, ukf.p_ctrv_, "p_ctrv");
+
+  const double x_rm[] = { 1.25718992655, 2.30473632219, 0, 0.321836063522, 0 };
+  // clang-format off
+  const double p_rm[] = { -0.000763257125896, -0.0994296693955, 0.00429901420107, -0.00856029915493, 0,
+                          -0.0994296693955, -0.0231445585634, 0.00132984092998, -0.00028151465276, 0,
+                          0.00429901420107, 0.00132984092998, 0.09, 0, 0,
+                          -0.00856029915493, -0.00028151465276, 0, 0.396037978033, 0.0045,
+                          0, 0, 0, 0.0045, 0.09 };
+  // clang-format on
+  expectNear(x_rm, ukf.x_rm_, "x_rm");
+  expectNear(p_rm, ukf.p_rm_, "p_rm");
+
+  const double x_merge[] = { 1.27925838302, 2.30092905143, 2.66329345106, 0.321836063522, 0.0680279572931 };
+  // clang-format off
+  const double p_merge[] = { 0.0417387786841, -0.047867795289, 0.0456243161882, -0.0127215860428, 0.000705008629264,
+                             -0.047867795289, 0.0110895256059, -0.00865922207365, 0.00764741890174, 5.8360438511e-05,
+                             0.0456243161882, -0.00865922207366, 4.90488480759, 0.0520325360643, 0.123662671198,
+                             -0.0127215860428, 0.00764741890174, 0.0520325360643, 0.36066514575, 0.0193660478305,
+                             0.000705008629266, 5.83604385107e-05, 0.123662671198, 0.0193660478305, 0.154062067929 };
+  // clang-format on
+  expectNear(x_merge, ukf.x_merge_, "x_merge");
+  expectNear(p_merge, ukf.p_merge_, "p_merge");
+
+  EXPECT_NEAR(0.332458566639, ukf.mode_prob_cv_, TOLERANCE);
+  EXPECT_NEAR(0.332693524989, ukf.mode_prob_ctrv_, TOLERANCE);
+  EXPECT_NEAR(0.334847908372, ukf.mode_prob_rm_, TOLERANCE);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
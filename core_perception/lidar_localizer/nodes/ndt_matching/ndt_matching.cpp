@@ -22,8 +22,10 @@
 
 #include <pthread.h>
 #include <chrono>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -65,6 +67,8 @@
 #include <pcl_ros/point_cloud.h>
 #include <pcl_ros/transforms.h>
 
+#include <pointcloud2_view/pointcloud2_view.hpp>
+
 #include <autoware_config_msgs/ConfigNDT.h>
 
 #include <autoware_msgs/NDTStat.h>
@@ -117,7 +121,8 @@ static int _use_gnss = 1;
 static int init_pos_set = 0;
 
 static pcl::NormalDistributionsTransform<pcl::PointXYZ, pcl::PointXYZ> ndt;
-static cpu::NormalDistributionsTransform<pcl::PointXYZ, pcl::PointXYZ> anh_ndt;
+typedef cpu::NormalDistributionsTransform<pcl::PointXYZ, pcl::PointXYZ> AnhNdt;
+static std::shared_ptr<AnhNdt> anh_ndt_ptr = std::make_shared<AnhNdt>();
 #ifdef CUDA_FOUND
 static std::shared_ptr<gpu::GNormalDistributionsTransform> anh_gpu_ndt_ptr =
     std::make_shared<gpu::GNormalDistributionsTransform>();
@@ -131,6 +136,8 @@ static int max_iter = 30;        // Maximum iterations
 static float ndt_res = 1.0;      // Resolution
 static double step_size = 0.1;   // Step size
 static double trans_eps = 0.01;  // Transformation epsilon
+static int num_threads = 1;      // Threads for pcl_anh derivative accumulation
+static int derivative_backend = 0;  // pcl_anh derivative evaluation: scalar=0, batch_double=1, batch_float=2
 
 static ros::Publisher predict_pose_pub;
 static geometry_msgs::PoseStamped predict_pose_msg;
@@ -243,6 +250,30 @@ static unsigned int points_map_num = 0;
 
 pthread_mutex_t mutex;
 
+/* Map tile streaming (PCL_ANH only, enabled when map_tile_size > 0).
+ * points_map is split into square tiles, and only the tiles within
+ * map_tile_radius of the vehicle are kept in the NDT target. When the vehicle
+ * moves or a new map is received, the map thread removes and adds the changed
+ * tiles on a standby target, then swaps it with the one used for matching.
+ * The standby target is the previous one, so it lags behind by one update
+ * that is replayed before the next one. */
+typedef std::pair<int, int> MapTileKey;
+typedef std::map<MapTileKey, pcl::PointCloud<pcl::PointXYZ>::Ptr> MapTiles;
+
+static double _map_tile_size = 0.0;
+static double _map_tile_radius = 200.0;
+
+static MapTiles map_tiles;     // Tiles of the last points_map
+static MapTiles target_tiles;  // Tiles in the NDT target used for matching
+static float target_tiles_res = 0.0;
+
+static std::shared_ptr<AnhNdt> anh_ndt_standby_ptr = std::make_shared<AnhNdt>();
+static std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> standby_add_tiles, standby_remove_tiles;
+static bool standby_rebuild = true;
+
+static pose map_tile_center;  // Copied from current_pose by the main thread
+pthread_mutex_t map_tile_center_mutex;
+
 static pose convertPoseIntoRelativeCoordinate(const pose &target_pose, const pose &reference_pose)
 {
     tf::Quaternion target_q;
@@ -282,7 +313,10 @@ static void param_callback(const autoware_config_msgs::ConfigNDT::ConstPtr& inpu
 
   _use_gnss = input->init_pos_gnss;
 
-  // Setting parameters
+  // Setting parameters. The map thread reads them and swaps the NDT instances under the same mutex, so that an
+  // instance swapped in after this callback gets these values too.
+  pthread_mutex_lock(&mutex);
+
   if (input->resolution != ndt_res)
   {
     ndt_res = input->resolution;
@@ -290,7 +324,7 @@ static void param_callback(const autoware_config_msgs::ConfigNDT::ConstPtr& inpu
     if (_method_type == MethodType::PCL_GENERIC)
       ndt.setResolution(ndt_res);
     else if (_method_type == MethodType::PCL_ANH)
-      anh_ndt.setResolution(ndt_res);
+      anh_ndt_ptr->setResolution(ndt_res);
 #ifdef CUDA_FOUND
     else if (_method_type == MethodType::PCL_ANH_GPU)
       anh_gpu_ndt_ptr->setResolution(ndt_res);
@@ -308,7 +342,7 @@ static void param_callback(const autoware_config_msgs::ConfigNDT::ConstPtr& inpu
     if (_method_type == MethodType::PCL_GENERIC)
       ndt.setStepSize(step_size);
     else if (_method_type == MethodType::PCL_ANH)
-      anh_ndt.setStepSize(step_size);
+      anh_ndt_ptr->setStepSize(step_size);
 #ifdef CUDA_FOUND
     else if (_method_type == MethodType::PCL_ANH_GPU)
       anh_gpu_ndt_ptr->setStepSize(step_size);
@@ -326,7 +360,7 @@ static void param_callback(const autoware_config_msgs::ConfigNDT::ConstPtr& inpu
     if (_method_type == MethodType::PCL_GENERIC)
       ndt.setTransformationEpsilon(trans_eps);
     else if (_method_type == MethodType::PCL_ANH)
-      anh_ndt.setTransformationEpsilon(trans_eps);
+      anh_ndt_ptr->setTransformationEpsilon(trans_eps);
 #ifdef CUDA_FOUND
     else if (_method_type == MethodType::PCL_ANH_GPU)
       anh_gpu_ndt_ptr->setTransformationEpsilon(trans_eps);
@@ -344,7 +378,7 @@ static void param_callback(const autoware_config_msgs::ConfigNDT::ConstPtr& inpu
     if (_method_type == MethodType::PCL_GENERIC)
       ndt.setMaximumIterations(max_iter);
     else if (_method_type == MethodType::PCL_ANH)
-      anh_ndt.setMaximumIterations(max_iter);
+      anh_ndt_ptr->setMaximumIterations(max_iter);
 #ifdef CUDA_FOUND
     else if (_method_type == MethodType::PCL_ANH_GPU)
       anh_gpu_ndt_ptr->setMaximumIterations(max_iter);
@@ -355,6 +389,17 @@ static void param_callback(const autoware_config_msgs::ConfigNDT::ConstPtr& inpu
 #endif
   }
 
+  // 0 means "not set" so that publishers unaware of this field keep the launch setting
+  if (input->num_threads > 0 && input->num_threads != num_threads)
+  {
+    num_threads = input->num_threads;
+
+    if (_method_type == MethodType::PCL_ANH)
+      anh_ndt_ptr->setNumThreads(num_threads);
+  }
+
+  pthread_mutex_unlock(&mutex);
+
   if (_use_gnss == 0 && init_pos_set == 0)
   {
     initial_pose.x = input->x;
@@ -427,6 +472,197 @@ static void param_callback(const autoware_config_msgs::ConfigNDT::ConstPtr& inpu
   }
 }
 
+static void setup_anh_ndt(AnhNdt& anh_ndt)
+{
+  anh_ndt.setMaximumIterations(max_iter);
+  anh_ndt.setStepSize(step_size);
+  anh_ndt.setTransformationEpsilon(trans_eps);
+  anh_ndt.setNumThreads(num_threads);
+  anh_ndt.setDerivativeBackend(static_cast<AnhNdt::DerivativeBackend>(derivative_backend));
+}
+
+static void build_anh_ndt_target(AnhNdt& anh_ndt, const pcl::PointCloud<pcl::PointXYZ>::Ptr& target_ptr,
+                                 float resolution)
+{
+  anh_ndt.setResolution(resolution);
+  anh_ndt.setInputTarget(target_ptr);
+
+  pcl::PointCloud<pcl::PointXYZ>::Ptr dummy_scan_ptr(new pcl::PointCloud<pcl::PointXYZ>());
+  pcl::PointXYZ dummy_point;
+  dummy_scan_ptr->push_back(dummy_point);
+  anh_ndt.setInputSource(dummy_scan_ptr);
+
+  anh_ndt.align(Eigen::Matrix4f::Identity());
+}
+
+static void apply_tile_changes(AnhNdt& anh_ndt, const std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr>& add_tiles,
+                               const std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr>& remove_tiles)
+{
+  for (const auto& tile : remove_tiles)
+  {
+    anh_ndt.removeFromVoxelGrid(tile);
+  }
+
+  pcl::PointCloud<pcl::PointXYZ>::Ptr new_points(new pcl::PointCloud<pcl::PointXYZ>);
+  for (const auto& tile : add_tiles)
+  {
+    *new_points += *tile;
+  }
+
+  if (!new_points->empty())
+  {
+    anh_ndt.updateVoxelGrid(new_points);
+  }
+}
+
+static bool same_points(const pcl::PointCloud<pcl::PointXYZ>& a, const pcl::PointCloud<pcl::PointXYZ>& b)
+{
+  if (a.size() != b.size())
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.size(); i++)
+  {
+    if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Split the map into tiles. Tiles whose points did not change keep their
+// previous cloud, so that they are not reloaded into the NDT target.
+static void split_map_into_tiles(const pcl::PointCloud<pcl::PointXYZ>& input)
+{
+  MapTiles new_tiles;
+
+  for (const auto& p : input)
+  {
+    MapTileKey key(static_cast<int>(std::floor(p.x / _map_tile_size)),
+                   static_cast<int>(std::floor(p.y / _map_tile_size)));
+    pcl::PointCloud<pcl::PointXYZ>::Ptr& tile = new_tiles[key];
+
+    if (!tile)
+    {
+      tile.reset(new pcl::PointCloud<pcl::PointXYZ>);
+    }
+    tile->push_back(p);
+  }
+
+  for (auto& tile : new_tiles)
+  {
+    MapTiles::const_iterator old_tile = map_tiles.find(tile.first);
+
+    if (old_tile != map_tiles.end() && same_points(*old_tile->second, *tile.second))
+    {
+      tile.second = old_tile->second;
+    }
+  }
+
+  map_tiles.swap(new_tiles);
+}
+
+// Called periodically by the map thread
+static void update_anh_ndt_tiles()
+{
+  pthread_mutex_lock(&map_tile_center_mutex);
+  pose center = map_tile_center;
+  pthread_mutex_unlock(&map_tile_center_mutex);
+
+  MapTiles tiles;
+  for (const auto& tile : map_tiles)
+  {
+    double tile_x = (tile.first.first + 0.5) * _map_tile_size;
+    double tile_y = (tile.first.second + 0.5) * _map_tile_size;
+
+    if (hypot(tile_x - center.x, tile_y - center.y) <= _map_tile_radius)
+    {
+      tiles.insert(tile);
+    }
+  }
+
+  // Keep the current target until there is a map around the vehicle
+  if (tiles.empty())
+  {
+    return;
+  }
+
+  std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> add_tiles, remove_tiles;
+
+  for (const auto& tile : target_tiles)
+  {
+    MapTiles::const_iterator new_tile = tiles.find(tile.first);
+    if (new_tile == tiles.end() || new_tile->second != tile.second)
+    {
+      remove_tiles.push_back(tile.second);
+    }
+  }
+
+  for (const auto& tile : tiles)
+  {
+    MapTiles::const_iterator old_tile = target_tiles.find(tile.first);
+    if (old_tile == target_tiles.end() || old_tile->second != tile.second)
+    {
+      add_tiles.push_back(tile.second);
+    }
+  }
+
+  // ndt_res is written by param_callback on the main thread
+  pthread_mutex_lock(&mutex);
+  float res = ndt_res;
+  pthread_mutex_unlock(&mutex);
+
+  bool rebuild = (res != target_tiles_res || remove_tiles.size() == target_tiles.size());
+
+  if (add_tiles.empty() && remove_tiles.empty() && !rebuild)
+  {
+    return;
+  }
+
+  std::chrono::time_point<std::chrono::system_clock> update_start = std::chrono::system_clock::now();
+
+  if (rebuild || standby_rebuild)
+  {
+    pcl::PointCloud<pcl::PointXYZ>::Ptr target_ptr(new pcl::PointCloud<pcl::PointXYZ>);
+    for (const auto& tile : tiles)
+    {
+      *target_ptr += *tile.second;
+    }
+
+    anh_ndt_standby_ptr = std::make_shared<AnhNdt>();
+    build_anh_ndt_target(*anh_ndt_standby_ptr, target_ptr, res);
+  }
+  else
+  {
+    // Catch up with the previous update first
+    apply_tile_changes(*anh_ndt_standby_ptr, standby_add_tiles, standby_remove_tiles);
+    apply_tile_changes(*anh_ndt_standby_ptr, add_tiles, remove_tiles);
+  }
+
+  // Apply the current parameters under the lock, so that none set since the last swap is lost
+  pthread_mutex_lock(&mutex);
+  setup_anh_ndt(*anh_ndt_standby_ptr);
+  anh_ndt_ptr.swap(anh_ndt_standby_ptr);
+  pthread_mutex_unlock(&mutex);
+
+  // The previous target is not used for matching anymore, and becomes the standby one
+  standby_rebuild = rebuild;
+  standby_add_tiles.swap(add_tiles);
+  standby_remove_tiles.swap(remove_tiles);
+  target_tiles.swap(tiles);
+  target_tiles_res = res;
+  map_loaded = 1;
+
+  std::chrono::time_point<std::chrono::system_clock> update_end = std::chrono::system_clock::now();
+  std::cout << "Update NDT target tiles: " << target_tiles.size() << " tiles (+" << standby_add_tiles.size() << ", -"
+            << standby_remove_tiles.size() << ") in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(update_end - update_start).count() / 1000.0
+            << " ms." << std::endl;
+}
+
 static void map_callback(const sensor_msgs::PointCloud2::ConstPtr& input)
 {
   // if (map_loaded == 0)
@@ -458,6 +694,13 @@ static void map_callback(const sensor_msgs::PointCloud2::ConstPtr& input)
       pcl_ros::transformPointCloud(map, map, local_transform.inverse());
     }
 
+    if (_method_type == MethodType::PCL_ANH && _map_tile_size > 0)
+    {
+      // The NDT target is then updated from the tiles by update_anh_ndt_tiles
+      split_map_into_tiles(map);
+      return;
+    }
+
     pcl::PointCloud<pcl::PointXYZ>::Ptr map_ptr(new pcl::PointCloud<pcl::PointXYZ>(map));
 
     // Setting point cloud to be aligned to.
@@ -479,22 +722,18 @@ static void map_callback(const sensor_msgs::PointCloud2::ConstPtr& input)
     }
     else if (_method_type == MethodType::PCL_ANH)
     {
-      cpu::NormalDistributionsTransform<pcl::PointXYZ, pcl::PointXYZ> new_anh_ndt;
-      new_anh_ndt.setResolution(ndt_res);
-      new_anh_ndt.setInputTarget(map_ptr);
-      new_anh_ndt.setMaximumIterations(max_iter);
-      new_anh_ndt.setStepSize(step_size);
-      new_anh_ndt.setTransformationEpsilon(trans_eps);
-
-      pcl::PointCloud<pcl::PointXYZ>::Ptr dummy_scan_ptr(new pcl::PointCloud<pcl::PointXYZ>());
-      pcl::PointXYZ dummy_point;
-      dummy_scan_ptr->push_back(dummy_point);
-      new_anh_ndt.setInputSource(dummy_scan_ptr);
+      pthread_mutex_lock(&mutex);
+      float res = ndt_res;
+      pthread_mutex_unlock(&mutex);
 
-      new_anh_ndt.align(Eigen::Matrix4f::Identity());
+      std::shared_ptr<AnhNdt> new_anh_ndt_ptr = std::make_shared<AnhNdt>();
+      build_anh_ndt_target(*new_anh_ndt_ptr, map_ptr, res);
 
       pthread_mutex_lock(&mutex);
-      anh_ndt = new_anh_ndt;
+      setup_anh_ndt(*new_anh_ndt_ptr);
+      if (ndt_res != res)
+        new_anh_ndt_ptr->setResolution(ndt_res);
+      anh_ndt_ptr = new_anh_ndt_ptr;
       pthread_mutex_unlock(&mutex);
     }
 #ifdef CUDA_FOUND
@@ -939,13 +1178,30 @@ static void points_callback(const sensor_msgs::PointCloud2::ConstPtr& input)
     tf::Quaternion predict_q, ndt_q, current_q, localizer_q;
 
     pcl::PointXYZ p;
-    pcl::PointCloud<pcl::PointXYZ> filtered_scan;
 
     ros::Time current_scan_time = input->header.stamp;
     static ros::Time previous_scan_time = current_scan_time;
 
-    pcl::fromROSMsg(*input, filtered_scan);
-    pcl::PointCloud<pcl::PointXYZ>::Ptr filtered_scan_ptr(new pcl::PointCloud<pcl::PointXYZ>(filtered_scan));
+    // Read the points in place, without the field mapping and the extra copy of pcl::fromROSMsg
+    pcl::PointCloud<pcl::PointXYZ>::Ptr filtered_scan_ptr(new pcl::PointCloud<pcl::PointXYZ>);
+    try
+    {
+      pointcloud2_view::PointCloud2View scan_view(*input);
+      filtered_scan_ptr->points.resize(scan_view.size());
+      for (size_t i = 0; i < scan_view.size(); i++)
+      {
+        filtered_scan_ptr->points[i] = pcl::PointXYZ(scan_view.x(i), scan_view.y(i), scan_view.z(i));
+      }
+      filtered_scan_ptr->width = input->width;
+      filtered_scan_ptr->height = input->height;
+      filtered_scan_ptr->is_dense = input->is_dense;
+      pcl_conversions::toPCL(input->header, filtered_scan_ptr->header);
+    }
+    catch (std::runtime_error& e)
+    {
+      ROS_ERROR_THROTTLE(10, "%s", e.what());
+      return;
+    }
     int scan_points_num = filtered_scan_ptr->size();
 
     Eigen::Matrix4f t(Eigen::Matrix4f::Identity());   // base_link
@@ -960,7 +1216,7 @@ static void points_callback(const sensor_msgs::PointCloud2::ConstPtr& input)
     if (_method_type == MethodType::PCL_GENERIC)
       ndt.setInputSource(filtered_scan_ptr);
     else if (_method_type == MethodType::PCL_ANH)
-      anh_ndt.setInputSource(filtered_scan_ptr);
+      anh_ndt_ptr->setInputSource(filtered_scan_ptr);
 #ifdef CUDA_FOUND
     else if (_method_type == MethodType::PCL_ANH_GPU)
       anh_gpu_ndt_ptr->setInputSource(filtered_scan_ptr);
@@ -1047,19 +1303,19 @@ static void points_callback(const sensor_msgs::PointCloud2::ConstPtr& input)
     else if (_method_type == MethodType::PCL_ANH)
     {
       align_start = std::chrono::system_clock::now();
-      anh_ndt.align(init_guess);
+      anh_ndt_ptr->align(init_guess);
       align_end = std::chrono::system_clock::now();
 
-      has_converged = anh_ndt.hasConverged();
+      has_converged = anh_ndt_ptr->hasConverged();
 
-      t = anh_ndt.getFinalTransformation();
-      iteration = anh_ndt.getFinalNumIteration();
+      t = anh_ndt_ptr->getFinalTransformation();
+      iteration = anh_ndt_ptr->getFinalNumIteration();
 
       getFitnessScore_start = std::chrono::system_clock::now();
-      fitness_score = anh_ndt.getFitnessScore();
+      fitness_score = anh_ndt_ptr->getFitnessScore();
       getFitnessScore_end = std::chrono::system_clock::now();
 
-      trans_probability = anh_ndt.getTransformationProbability();
+      trans_probability = anh_ndt_ptr->getTransformationProbability();
     }
 #ifdef CUDA_FOUND
     else if (_method_type == MethodType::PCL_ANH_GPU)
@@ -1521,6 +1777,10 @@ void* thread_func(void* args)
   while (nh_map.ok())
   {
     map_callback_queue.callAvailable(ros::WallDuration());
+    if (_method_type == MethodType::PCL_ANH && _map_tile_size > 0)
+    {
+      update_anh_ndt_tiles();
+    }
     ros_rate.sleep();
   }
 
@@ -1531,6 +1791,7 @@ int main(int argc, char** argv)
 {
   ros::init(argc, argv, "ndt_matching");
   pthread_mutex_init(&mutex, NULL);
+  pthread_mutex_init(&map_tile_center_mutex, NULL);
 
   ros::NodeHandle nh;
   ros::NodeHandle private_nh("~");
@@ -1567,6 +1828,10 @@ int main(int argc, char** argv)
   private_nh.getParam("imu_topic", _imu_topic);
   private_nh.param<double>("gnss_reinit_fitness", _gnss_reinit_fitness, 500.0);
   private_nh.getParam("base_frame", _base_frame);
+  private_nh.getParam("num_threads", num_threads);
+  private_nh.getParam("derivative_backend", derivative_backend);
+  private_nh.getParam("map_tile_size", _map_tile_size);
+  private_nh.getParam("map_tile_radius", _map_tile_radius);
 
 
   if (nh.getParam("localizer", _localizer) == false)
@@ -1620,6 +1885,10 @@ int main(int argc, char** argv)
   std::cout << "localizer: " << _localizer << std::endl;
   std::cout << "gnss_reinit_fitness: " << _gnss_reinit_fitness << std::endl;
   std::cout << "base_frame: " << _base_frame << std::endl;
+  std::cout << "num_threads: " << num_threads << std::endl;
+  std::cout << "derivative_backend: " << derivative_backend << std::endl;
+  std::cout << "map_tile_size: " << _map_tile_size << std::endl;
+  std::cout << "map_tile_radius: " << _map_tile_radius << std::endl;
   std::cout << "(tf_x,tf_y,tf_z,tf_roll,tf_pitch,tf_yaw): (" << _tf_x << ", " << _tf_y << ", " << _tf_z << ", "
             << _tf_roll << ", " << _tf_pitch << ", " << _tf_yaw << ")" << std::endl;
   std::cout << "-----------------------------------------------------------------" << std::endl;
@@ -1689,6 +1958,11 @@ int main(int argc, char** argv)
   while (nh.ok())
   {
     ros::spinOnce();
+
+    pthread_mutex_lock(&map_tile_center_mutex);
+    map_tile_center = current_pose;
+    pthread_mutex_unlock(&map_tile_center_mutex);
+
     r.sleep();
   }
 
@@ -0,0 +1,75 @@
+#ifndef CPU_BATCH_DERIVATIVES_H_
+#define CPU_BATCH_DERIVATIVES_H_
+
+#include <eigen3/Eigen/Dense>
+
+namespace cpu {
+
+/* Batched evaluation of the NDT score, score gradient and Hessian
+ * (eq. 6.10, 6.12 and 6.13 [Magnusson 2009]).
+ *
+ * Point-voxel pairs are buffered into BATCH_SIZE lanes stored as
+ * structure of arrays, and every step of the evaluation (point
+ * gradient, point Hessian, Gaussian exponential and accumulation)
+ * is a loop over the lanes that the compiler turns into SIMD code
+ * (AVX2, NEON...) depending on the target architecture.
+ *
+ * ScalarType selects the precision of the evaluation. Partial sums
+ * are kept per lane and only reduced when the results are read. */
+template <typename ScalarType>
+class BatchDerivatives {
+public:
+	static const int BATCH_SIZE = 8;
+
+	BatchDerivatives();
+
+	void setGaussParameters(double gauss_d1, double gauss_d2);
+
+	/* j_ang holds the 8 angular Jacobian vectors (a to h) as columns,
+	 * h_ang holds the 15 angular Hessian vectors (a2, a3, b2, b3, c2, c3,
+	 * d1, d2, d3, e1, e2, e3, f1, f2, f3) as columns */
+	void setAngleDerivatives(const Eigen::Matrix<double, 3, 8> &j_ang, const Eigen::Matrix<double, 3, 15> &h_ang);
+
+	/* Clear the accumulated score, gradient and Hessian */
+	void reset(bool compute_hessian = true);
+
+	/* Add a pair of source point x and transformed point x_trans (already
+	 * relative to the voxel centroid) with the voxel inverse covariance c_inv.
+	 * The batch is evaluated when it becomes full. */
+	void push(const Eigen::Vector3d &x, const Eigen::Vector3d &x_trans, const Eigen::Matrix3d &c_inv);
+
+	/* Evaluate the pairs remaining in a partially filled batch */
+	void flush();
+
+	double getScore() const;
+
+	void getGradient(Eigen::Matrix<double, 6, 1> &score_gradient) const;
+
+	void getHessian(Eigen::Matrix<double, 6, 6> &hessian) const;
+
+private:
+	void evaluate(int count);
+
+	/* Computes out = exp(in) for all lanes. Inputs are expected to be non-positive. */
+	static void exp(const ScalarType *in, ScalarType *out);
+
+	// Inputs of the current batch
+	ScalarType x_[3][BATCH_SIZE];
+	ScalarType x_trans_[3][BATCH_SIZE];
+	ScalarType c_inv_[6][BATCH_SIZE];	// xx, xy, xz, yy, yz, zz
+	int count_;
+
+	// Per lane accumulators
+	ScalarType score_[BATCH_SIZE];
+	ScalarType gradient_[6][BATCH_SIZE];
+	ScalarType hessian_[21][BATCH_SIZE];	// Upper triangle, row major
+
+	ScalarType j_ang_[8][3];
+	ScalarType h_ang_[15][3];
+	ScalarType gauss_d1_, gauss_d2_;
+
+	bool compute_hessian_;
+};
+}
+
+#endif
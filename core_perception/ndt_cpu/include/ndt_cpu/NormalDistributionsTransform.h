@@ -3,6 +3,7 @@
 
 #include "Registration.h"
 #include "VoxelGrid.h"
+#include "BatchDerivatives.h"
 #include <eigen3/Eigen/Geometry>
 
 namespace cpu {
@@ -10,6 +11,13 @@ namespace cpu {
 template <typename PointSourceType, typename PointTargetType>
 class NormalDistributionsTransform: public Registration<PointSourceType, PointTargetType> {
 public:
+	/* Evaluation backend of the score, score gradient and Hessian */
+	enum DerivativeBackend {
+		SCALAR = 0,			// One point-voxel pair at a time
+		BATCH_DOUBLE = 1,	// BatchDerivatives in double precision
+		BATCH_FLOAT = 2		// BatchDerivatives in single precision
+	};
+
 	NormalDistributionsTransform();
 
 	NormalDistributionsTransform(const NormalDistributionsTransform &other);
@@ -20,12 +28,22 @@ public:
 
 	void setOutlierRatio(double olr);
 
+	/* Set the number of threads used to accumulate the score gradient and Hessian.
+	 * Values less than 2 keep the original serial accumulation. */
+	void setNumThreads(int num_threads);
+
+	void setDerivativeBackend(DerivativeBackend backend);
+
 	double getStepSize() const;
 
 	float getResolution() const;
 
 	double getOutlierRatio() const;
 
+	int getNumThreads() const;
+
+	DerivativeBackend getDerivativeBackend() const;
+
 	double getTransformationProbability() const;
 
 	int getRealIterations();
@@ -38,9 +56,18 @@ public:
 
 	void updateVoxelGrid(typename pcl::PointCloud<PointTargetType>::Ptr new_cloud);
 
+	/* Remove map points previously added by setInputTarget or updateVoxelGrid */
+	void removeFromVoxelGrid(typename pcl::PointCloud<PointTargetType>::Ptr old_cloud);
+
 protected:
 	void computeTransformation(const Eigen::Matrix<float, 4, 4> &guess);
 
+	/* Score, score gradient and Hessian of trans_cloud at pose. The same for any number of threads,
+	 * up to the rounding of the sums. */
+	double computeDerivatives(Eigen::Matrix<double, 6, 1> &score_gradient, Eigen::Matrix<double, 6, 6> &hessian,
+								typename pcl::PointCloud<PointSourceType> &trans_cloud,
+								Eigen::Matrix<double, 6, 1> pose, bool compute_hessian = true);
+
 
 	using Registration<PointSourceType, PointTargetType>::transformation_epsilon_;
 	using Registration<PointSourceType, PointTargetType>::max_iterations_;
@@ -78,9 +105,20 @@ private:
 
 	void computeHessian(Eigen::Matrix<double, 6, 6> &hessian, typename pcl::PointCloud<PointSourceType> &trans_cloud, Eigen::Matrix<double, 6, 1> &p);
 
-	double computeDerivatives(Eigen::Matrix<double, 6, 1> &score_gradient, Eigen::Matrix<double, 6, 6> &hessian,
-								typename pcl::PointCloud<PointSourceType> &trans_cloud,
-								Eigen::Matrix<double, 6, 1> pose, bool compute_hessian = true);
+	/* Accumulate the Hessian of source points in [begin, end) into hessian */
+	void computeHessianBlock(Eigen::Matrix<double, 6, 6> &hessian, typename pcl::PointCloud<PointSourceType> &trans_cloud, int begin, int end);
+
+	/* Accumulate the score, score gradient and Hessian of source points in [begin, end).
+	 * Return the score of the block. */
+	double computeDerivativesBlock(Eigen::Matrix<double, 6, 1> &score_gradient, Eigen::Matrix<double, 6, 6> &hessian,
+									typename pcl::PointCloud<PointSourceType> &trans_cloud,
+									int begin, int end, bool compute_hessian = true);
+
+	/* Same as computeDerivativesBlock, but evaluates point-voxel pairs in batches */
+	template <typename ScalarType>
+	double computeDerivativesBatch(Eigen::Matrix<double, 6, 1> &score_gradient, Eigen::Matrix<double, 6, 6> &hessian,
+									typename pcl::PointCloud<PointSourceType> &trans_cloud,
+									int begin, int end, bool compute_hessian = true);
 	void computePointDerivatives(Eigen::Vector3d &x, Eigen::Matrix<double, 3, 6> &point_gradient, Eigen::Matrix<double, 18, 6> &point_hessian, bool computeHessian = true);
 	double updateDerivatives(Eigen::Matrix<double, 6, 1> &score_gradient, Eigen::Matrix<double, 6, 6> &hessian,
 								Eigen::Matrix<double, 3, 6> point_gradient, Eigen::Matrix<double, 18, 6> point_hessian,
@@ -106,6 +144,14 @@ private:
 
 	int real_iterations_;
 
+	int num_threads_;
+
+	DerivativeBackend backend_;
+
+	/* Number of source points reduced by one partial gradient/Hessian in the parallel mode.
+	 * The partition does not depend on the number of threads, so the merged result is
+	 * reproducible from run to run. */
+	static const int POINTS_PER_BLOCK_ = 512;
 
 	VoxelGrid<PointSourceType> voxel_grid_;
 };
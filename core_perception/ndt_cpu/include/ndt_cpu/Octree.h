@@ -5,13 +5,18 @@
 #include <pcl/point_cloud.h>
 
 #include <float.h>
+#include <stdint.h>
 #include <vector>
 #include <eigen3/Eigen/Dense>
 #include <eigen3/Eigen/Geometry>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
 
-/* The octree is built on top of a voxel grid to fasten the nearest neighbor search */
+/* The octree is built on top of a voxel grid to fasten the nearest neighbor search.
+ * Only the occupied nodes are stored: each level keeps its nodes sorted by the
+ * Morton key of their indexes, so the children of a node are contiguous in the
+ * level below and the memory grows with the number of points, not with the
+ * bounding box of the map. */
 namespace cpu {
 template <typename PointSourceType>
 class Octree {
@@ -19,13 +24,16 @@ public:
 
 	Octree();
 
-	/* Input is a vector of boundaries and ptsum of the voxel grid
-	 * Those boundaries is needed since the number of actually occupied voxels may be
-	 * much smaller than reserved number of voxels */
+	/* Input is the voxel index of each point of point_cloud */
 	void setInput(std::vector<Eigen::Vector3i> occupied_voxels, typename pcl::PointCloud<PointSourceType>::Ptr point_cloud);
 
 	void update(std::vector<Eigen::Vector3i> new_voxels, typename pcl::PointCloud<PointSourceType>::Ptr new_cloud);
 
+	/* Remove every node, setInput must be called again before the next search or update */
+	void clear();
+
+	bool empty() const;
+
 	Eigen::Matrix<float, 6, 1> nearestOctreeNode(PointSourceType q);
 
 private:
@@ -35,70 +43,46 @@ private:
 		float lz, uz;
 		Eigen::Vector3d centroid;
 		int point_num;
+		int parent;			// Id of the parent in the level above, -1 at the top level
+		int first_child;	// Id of the first child in the level below, -1 for leaves
+		int child_num;
 	} OctreeNode;
 
-	typedef struct {
-		int lower_x, upper_x;
-		int lower_y, upper_y;
-		int lower_z, upper_z;
-	} OctreeLevelBoundaries;
-
-	typedef struct {
-		int x, y, z;
-	} OctreeLevelDim;
-
-	// Convert from 3d indexes and level of the tree node to the actual index in the array
-	int index2id(int idx, int idy, int idz, int level);
-	int index2id(int idx, int idy, int idz, OctreeLevelBoundaries bounds, OctreeLevelDim dims);
-
-	// Convert from the index in the array to the 3d indexes of the tree node
-	Eigen::Vector3i id2index(int id, int level);
-	Eigen::Vector3i id2index(int id, OctreeLevelBoundaries bounds, OctreeLevelDim dims);
+	/* Morton key of the leaf containing a voxel, relative to the leaf origin.
+	 * Return false if the leaf is too far from the origin to be keyed. */
+	bool leafKey(const Eigen::Vector3i &voxel, uint64_t &key);
 
-	void buildLevel(int level);
-
-	bool isOccupied(int node_id, int level);
-
-	bool isOccupied(std::vector<unsigned int> occupancy, int node_id);
-
-	void setOccupied(int node_id, int level);
-
-	void setOccupied(std::vector<unsigned int> &occupancy, int node_id);
+	int div(int input, int divisor);
 
-	void updateBoundaries(std::vector<Eigen::Vector3i> new_voxels);
+	/* Leaves of a point cloud, sorted by key */
+	void buildLeaves(const std::vector<Eigen::Vector3i> &voxels, typename pcl::PointCloud<PointSourceType>::Ptr cloud,
+						std::vector<uint64_t> &keys, std::vector<OctreeNode> &leaves);
 
-	int roundUp(int input, int factor);
-	int roundDown(int input, int factor);
+	/* Rebuild every level above the leaves */
+	void buildUpperLevels();
 
-	int div(int input, int divisor);
+	void mergeNode(OctreeNode &dst, const OctreeNode &src);
 
-	void updateOctreeContent(std::vector<Eigen::Vector3i> new_voxels, typename pcl::PointCloud<PointSourceType>::Ptr new_cloud);
+	double dist(const OctreeNode &node, PointSourceType q);
 
-	double dist(OctreeNode node, PointSourceType q);
+	double centroidDist(const OctreeNode &node, PointSourceType q);
 
 	/* Three functions to search for the nearest neighbor of a point */
 
-	void initRange(PointSourceType q, double &min_range, int &current_nn_voxel);
-
-	void goUp(Eigen::Matrix<int, 4, 1 > tree_node, PointSourceType q, double &min_range, int &current_nn_voxel);
+	void initRange(PointSourceType q, double &min_range, int &current_nn_leaf);
 
-	void goDown(Eigen::Matrix<int, 4, 1> tree_node, PointSourceType q, double &min_range, int &current_nn_voxel);
+	void goUp(int level, int node_id, PointSourceType q, double &min_range, int &current_nn_leaf);
 
-	boost::shared_ptr<std::vector<std::vector<OctreeNode> > > octree_;
-	boost::shared_ptr<std::vector<OctreeLevelBoundaries> > reserved_size_;
-	boost::shared_ptr<std::vector<OctreeLevelDim> > dimension_;
+	void goDown(int level, int node_id, PointSourceType q, double &min_range, int &current_nn_leaf);
 
-	/* Used for checking if an octree node is occupied or not
-	 * If an octree node is occupied (containing some points),
-	 * then the corresponding bit is set
-	 */
-	boost::shared_ptr<std::vector<std::vector<unsigned int> > > occupancy_check_;
+	boost::shared_ptr<std::vector<std::vector<OctreeNode> > > octree_;	// Levels from the leaves up
+	boost::shared_ptr<std::vector<std::vector<uint64_t> > > node_keys_;	// Morton key of each node of octree_
 
 	int leaf_x_, leaf_y_, leaf_z_;		// Number of voxels contained in each leaf
+	int origin_x_, origin_y_, origin_z_;	// Leaf indexes of the voxel the first input point falls in
 
-	static const int MAX_BX_ = 8;
-	static const int MAX_BY_ = 8;
-	static const int MAX_BZ_ = 4;
+	static const int MAX_TOP_NODES_ = 8;
+	static const int LEAF_BIAS_ = 1 << 20;	// Added to the leaf indexes so that they fit in 21 unsigned bits
 };
 }
 
@@ -4,6 +4,7 @@
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
 #include <float.h>
+#include <stdint.h>
 #include <vector>
 #include <eigen3/Eigen/Dense>
 #include <eigen3/Eigen/Geometry>
@@ -66,13 +67,13 @@ public:
 
 	void update(typename pcl::PointCloud<PointSourceType>::Ptr new_cloud);
 
-private:
+	/* Remove points that were previously added by setInput or update.
+	 * Voxels left without points are ignored by searches. */
+	void remove(typename pcl::PointCloud<PointSourceType>::Ptr old_cloud);
 
-	typedef struct {
-		int x, y, z;
-	} OctreeDim;
+private:
 
-	/* Construct the voxel grid and the build the octree. */
+	/* Reset the voxel store to contain no voxel. */
 	void initialize();
 
 	/* Put points into voxels */
@@ -81,25 +82,54 @@ private:
 	/* Compute centroids and covariances of voxels. */
 	void computeCentroidAndCovariance();
 
+	/* Compute the centroid and the inverse covariance of a single voxel
+	 * from its accumulated point sum and second moment */
+	void computeCentroidAndCovariance(int vid);
+
 	/* Find boundaries of input point cloud and compute
-	 * the number of necessary voxels as well as boundaries
-	 * measured in number of leaf size */
+	 * the boundaries measured in number of leaf size */
 	void findBoundaries();
 
 	void findBoundaries(typename pcl::PointCloud<PointSourceType>::Ptr input_cloud,
 							float &max_x, float &max_y, float &max_z,
 							float &min_x, float &min_y, float &min_z);
 
-	int voxelId(PointSourceType p);
+	/* Center the keys on the voxel of the mean of the points, so that a few
+	 * outliers do not move the key range away from the bulk of the map. Only
+	 * called while the grid has no voxel, as it changes the key of every voxel. */
+	void setKeyOrigin(typename pcl::PointCloud<PointSourceType>::Ptr input_cloud);
+
+	/* Whether the voxel is close enough to the key origin to have a Morton key,
+	 * less than MORTON_BIAS_ voxels away along each axis. Points in voxels
+	 * outside of this range are ignored. */
+	bool inKeyRange(int idx, int idy, int idz) const;
+
+	/* Points of input_cloud in the key range and their voxel indices, for the octree.
+	 * Return input_cloud itself if all of its points are in the key range. */
+	typename pcl::PointCloud<PointSourceType>::Ptr keyRangePoints(typename pcl::PointCloud<PointSourceType>::Ptr input_cloud,
+																	std::vector<Eigen::Vector3i> &voxel_ids) const;
+
+	/* Morton (Z-order) key of a voxel. Each index relative to the key origin is
+	 * biased to be non-negative and interleaved on MORTON_BITS_ bits. */
+	uint64_t mortonKey(int idx, int idy, int idz) const;
+
+	/* 3D index of a voxel from its Morton key */
+	Eigen::Vector3i voxelIndex(uint64_t key) const;
 
-	int voxelId(PointSourceType p,
-				float voxel_x, float voxel_y, float voxel_z,
-				int min_b_x, int min_b_y, int min_b_z,
-				int vgrid_x, int vgrid_y, int vgrid_z);
+	/* Return the slot of the voxel at (idx, idy, idz), or -1 if the voxel is empty */
+	int voxelId(int idx, int idy, int idz) const;
 
-	int voxelId(int idx, int idy, int idz,
-				int min_b_x, int min_b_y, int min_b_z,
-				int size_x, int size_y, int size_z);
+	/* Return the slot of the voxel at (idx, idy, idz), inserting an empty voxel if needed.
+	 * Return -1 if the voxel is out of the key range. */
+	int insertVoxel(int idx, int idy, int idz);
+
+	/* Rebuild the key -> slot hash table with at least min_capacity entries */
+	void rehash(int min_capacity);
+
+	/* Reorder voxel slots by Morton key so that spatially close voxels are
+	 * also close in memory, then rebuild the hash table.
+	 * Slots of voxels without points are released. */
+	void sortVoxelsByKey();
 
 	/* Private methods for merging new point cloud to the current point cloud */
 	void updateBoundaries(float max_x, float max_y, float max_z,
@@ -109,16 +139,10 @@ private:
 
 	int nearestVoxel(PointSourceType query_point, Eigen::Matrix<float, 6, 1> boundaries, float max_range);
 
-	int roundUp(int input, int factor);
-
-	int roundDown(int input, int factor);
-
-	int div(int input, int divisor);
-
 	//Coordinate of input points
 	typename pcl::PointCloud<PointSourceType>::Ptr source_cloud_;
 
-	int voxel_num_;						// Number of voxels
+	int voxel_num_;						// Number of occupied voxels
 	float max_x_, max_y_, max_z_;		// Upper bounds of the grid (maximum coordinate)
 	float min_x_, min_y_, min_z_;		// Lower bounds of the grid (minimum coordinate)
 	float voxel_x_, voxel_y_, voxel_z_;	// Leaf size, a.k.a, size of each voxel
@@ -130,23 +154,36 @@ private:
 										// per voxel is less than this number, then the voxel is ignored
 										// during computation (treated like it contains no point)
 
-	boost::shared_ptr<std::vector<Eigen::Vector3d> > centroid_;			// 3x1 Centroid vectors of voxels
-	boost::shared_ptr<std::vector<Eigen::Matrix3d> > icovariance_;		// Inverse covariance matrixes of voxel
-	boost::shared_ptr<std::vector<std::vector<int> > > points_id_;		// Indexes of points belong to each voxel
-	boost::shared_ptr<std::vector<int> > points_per_voxel_;				// Number of points belong to each voxel
-													// (may differ from size of each vector in points_id_
-													// because of changes made during computing covariances
-	boost::shared_ptr<std::vector<Eigen::Vector3d> > tmp_centroid_;
-	boost::shared_ptr<std::vector<Eigen::Matrix3d> > tmp_cov_;
+	/* Only occupied voxels are stored. Each voxel owns a slot, and the
+	 * per-voxel data is kept as a structure of arrays indexed by slot:
+	 * searches only touch the compact centroid and counter arrays, while
+	 * the accumulators are only read when building. Centroids are kept in
+	 * double precision, floats are too coarse far from the map origin. */
+	boost::shared_ptr<std::vector<uint64_t> > voxel_key_;		// Morton key of each slot
+	boost::shared_ptr<std::vector<double> > centroid_;			// 3 doubles per slot
+	boost::shared_ptr<std::vector<float> > icovariance_;		// 6 floats per slot, upper triangle of the symmetric
+																// inverse covariance (xx, xy, xz, yy, yz, zz)
+	boost::shared_ptr<std::vector<int> > point_num_;			// Number of points belong to each voxel
+	boost::shared_ptr<std::vector<int> > points_per_voxel_;		// Same as point_num_, but -1 if the covariance
+																// of the voxel is degenerated
+	boost::shared_ptr<std::vector<double> > point_sum_;			// 3 doubles per slot, sum of points
+	boost::shared_ptr<std::vector<double> > point_moment_;		// 6 doubles per slot, upper triangle of the sum of p * p^T
+
+	/* Open addressing hash table (linear probing) from Morton key to slot.
+	 * The capacity is always a power of two. */
+	boost::shared_ptr<std::vector<uint64_t> > table_key_;
+	boost::shared_ptr<std::vector<int> > table_slot_;
+	uint64_t table_mask_;
 
 	int real_max_bx_, real_max_by_, real_max_bz_;
 	int real_min_bx_, real_min_by_, real_min_bz_;
 
 	Octree<PointSourceType> octree_;
 
-	static const int MAX_BX_ = 16;
-	static const int MAX_BY_ = 16;
-	static const int MAX_BZ_ = 8;
+	int origin_b_x_, origin_b_y_, origin_b_z_;	// Voxel at the center of the key range
+
+	static const int MORTON_BITS_ = 21;
+	static const int MORTON_BIAS_ = 1 << (MORTON_BITS_ - 1);
 };
 }
 
@@ -0,0 +1,370 @@
+#include "ndt_cpu/BatchDerivatives.h"
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+namespace cpu {
+
+/* Build 2^n by writing the exponent bits directly */
+static inline double pow2(int n, double)
+{
+	int64_t bits = (static_cast<int64_t>(n) + 1023) << 52;
+	double out;
+
+	memcpy(&out, &bits, sizeof(out));
+
+	return out;
+}
+
+static inline float pow2(int n, float)
+{
+	int32_t bits = (n + 127) << 23;
+	float out;
+
+	memcpy(&out, &bits, sizeof(out));
+
+	return out;
+}
+
+/* Lower bounds of exp arguments, below which the result is flushed to zero */
+static inline double minExpArgument(double)
+{
+	return -700.0;
+}
+
+static inline float minExpArgument(float)
+{
+	return -87.0f;
+}
+
+/* exp(r) for |r| <= ln(2) / 2, Taylor series truncated at the
+ * degree where the remainder is below the type precision */
+static inline double expReduced(double r)
+{
+	return 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720 + r * (1.0 / 5040 +
+			r * (1.0 / 40320 + r * (1.0 / 362880 + r * (1.0 / 3628800 + r * (1.0 / 39916800 + r * (1.0 / 479001600))))))))))));
+}
+
+static inline float expReduced(float r)
+{
+	return 1.0f + r * (1.0f + r * (1.0f / 2 + r * (1.0f / 6 + r * (1.0f / 24 + r * (1.0f / 120 + r * (1.0f / 720 + r * (1.0f / 5040)))))));
+}
+
+template <typename ScalarType>
+BatchDerivatives<ScalarType>::BatchDerivatives()
+{
+	gauss_d1_ = gauss_d2_ = 0;
+
+	for (int i = 0; i < 8; i++) {
+		j_ang_[i][0] = j_ang_[i][1] = j_ang_[i][2] = 0;
+	}
+
+	for (int i = 0; i < 15; i++) {
+		h_ang_[i][0] = h_ang_[i][1] = h_ang_[i][2] = 0;
+	}
+
+	reset();
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::setGaussParameters(double gauss_d1, double gauss_d2)
+{
+	gauss_d1_ = static_cast<ScalarType>(gauss_d1);
+	gauss_d2_ = static_cast<ScalarType>(gauss_d2);
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::setAngleDerivatives(const Eigen::Matrix<double, 3, 8> &j_ang, const Eigen::Matrix<double, 3, 15> &h_ang)
+{
+	for (int i = 0; i < 8; i++) {
+		for (int k = 0; k < 3; k++) {
+			j_ang_[i][k] = static_cast<ScalarType>(j_ang(k, i));
+		}
+	}
+
+	for (int i = 0; i < 15; i++) {
+		for (int k = 0; k < 3; k++) {
+			h_ang_[i][k] = static_cast<ScalarType>(h_ang(k, i));
+		}
+	}
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::reset(bool compute_hessian)
+{
+	compute_hessian_ = compute_hessian;
+	count_ = 0;
+
+	for (int l = 0; l < BATCH_SIZE; l++) {
+		// Unused lanes of a partial batch must hold finite values
+		for (int k = 0; k < 3; k++) {
+			x_[k][l] = x_trans_[k][l] = 0;
+		}
+
+		for (int k = 0; k < 6; k++) {
+			c_inv_[k][l] = 0;
+		}
+
+		score_[l] = 0;
+
+		for (int i = 0; i < 6; i++) {
+			gradient_[i][l] = 0;
+		}
+
+		for (int i = 0; i < 21; i++) {
+			hessian_[i][l] = 0;
+		}
+	}
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::push(const Eigen::Vector3d &x, const Eigen::Vector3d &x_trans, const Eigen::Matrix3d &c_inv)
+{
+	// The scalar path rejects these pairs through the NaN score, but in a
+	// batch they would also poison the other lanes of the accumulators
+	if (!x.allFinite() || !x_trans.allFinite()) {
+		return;
+	}
+
+	for (int k = 0; k < 3; k++) {
+		x_[k][count_] = static_cast<ScalarType>(x(k));
+		x_trans_[k][count_] = static_cast<ScalarType>(x_trans(k));
+	}
+
+	c_inv_[0][count_] = static_cast<ScalarType>(c_inv(0, 0));
+	c_inv_[1][count_] = static_cast<ScalarType>(c_inv(0, 1));
+	c_inv_[2][count_] = static_cast<ScalarType>(c_inv(0, 2));
+	c_inv_[3][count_] = static_cast<ScalarType>(c_inv(1, 1));
+	c_inv_[4][count_] = static_cast<ScalarType>(c_inv(1, 2));
+	c_inv_[5][count_] = static_cast<ScalarType>(c_inv(2, 2));
+
+	if (++count_ == BATCH_SIZE) {
+		evaluate(BATCH_SIZE);
+		count_ = 0;
+	}
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::flush()
+{
+	if (count_ > 0) {
+		evaluate(count_);
+		count_ = 0;
+	}
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::exp(const ScalarType *in, ScalarType *out)
+{
+	const ScalarType log2e = static_cast<ScalarType>(1.4426950408889634);
+	const ScalarType ln2_hi = static_cast<ScalarType>(0.693145751953125);
+	const ScalarType ln2_lo = static_cast<ScalarType>(1.4286068203094172e-6);
+	const ScalarType min_arg = minExpArgument(ScalarType());
+
+#pragma omp simd
+	for (int l = 0; l < BATCH_SIZE; l++) {
+		ScalarType a = std::max(in[l], min_arg);
+
+		// exp(a) = 2^n * exp(r), with |r| <= ln(2) / 2. n is rounded
+		// with a truncating cast since floor() is not vectorized everywhere.
+		ScalarType t = a * log2e;
+		int n = static_cast<int>(t - static_cast<ScalarType>(0.5));
+		ScalarType r = (a - n * ln2_hi) - n * ln2_lo;
+		ScalarType underflow = (in[l] > min_arg) ? 1 : 0;
+
+		out[l] = expReduced(r) * pow2(n, ScalarType()) * underflow;
+	}
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::evaluate(int count)
+{
+	ScalarType jv[8][BATCH_SIZE];		// x dot angular Jacobian vectors
+	ScalarType u[3][BATCH_SIZE];		// c_inv * x_trans
+	ScalarType q[BATCH_SIZE], e[BATCH_SIZE], w[BATCH_SIZE];
+	ScalarType g[6][BATCH_SIZE];		// x_trans' * c_inv * point_gradient
+
+	// Point gradient (eq. 6.18, 6.19 [Magnusson 2009])
+	for (int i = 0; i < 8; i++) {
+#pragma omp simd
+		for (int l = 0; l < BATCH_SIZE; l++) {
+			jv[i][l] = x_[0][l] * j_ang_[i][0] + x_[1][l] * j_ang_[i][1] + x_[2][l] * j_ang_[i][2];
+		}
+	}
+
+#pragma omp simd
+	for (int l = 0; l < BATCH_SIZE; l++) {
+		u[0][l] = c_inv_[0][l] * x_trans_[0][l] + c_inv_[1][l] * x_trans_[1][l] + c_inv_[2][l] * x_trans_[2][l];
+		u[1][l] = c_inv_[1][l] * x_trans_[0][l] + c_inv_[3][l] * x_trans_[1][l] + c_inv_[4][l] * x_trans_[2][l];
+		u[2][l] = c_inv_[2][l] * x_trans_[0][l] + c_inv_[4][l] * x_trans_[1][l] + c_inv_[5][l] * x_trans_[2][l];
+
+		q[l] = -gauss_d2_ * (x_trans_[0][l] * u[0][l] + x_trans_[1][l] * u[1][l] + x_trans_[2][l] * u[2][l]) / 2;
+	}
+
+	exp(q, e);
+
+	const ScalarType gauss_d1 = gauss_d1_;
+	const ScalarType gauss_d2 = gauss_d2_;
+
+#pragma omp simd
+	for (int l = 0; l < BATCH_SIZE; l++) {
+		ScalarType e_x_cov_x = gauss_d2 * e[l];
+
+		// Same rejection as the scalar path, NaN fails both comparisons.
+		// Unused lanes of a partial batch are rejected as well.
+		ScalarType check = (l < count) ? e_x_cov_x : -1;
+		ScalarType score_inc = (check <= 1) ? -gauss_d1 * e[l] : 0;
+		ScalarType weight = (check <= 1) ? gauss_d1 * e_x_cov_x : 0;
+
+		score_[l] += (check >= 0) ? score_inc : 0;
+		w[l] = (check >= 0) ? weight : 0;
+
+		g[0][l] = u[0][l];
+		g[1][l] = u[1][l];
+		g[2][l] = u[2][l];
+		g[3][l] = u[1][l] * jv[0][l] + u[2][l] * jv[1][l];
+		g[4][l] = u[0][l] * jv[2][l] + u[1][l] * jv[3][l] + u[2][l] * jv[4][l];
+		g[5][l] = u[0][l] * jv[5][l] + u[1][l] * jv[6][l] + u[2][l] * jv[7][l];
+	}
+
+	for (int i = 0; i < 6; i++) {
+#pragma omp simd
+		for (int l = 0; l < BATCH_SIZE; l++) {
+			gradient_[i][l] += w[l] * g[i][l];
+		}
+	}
+
+	if (!compute_hessian_) {
+		return;
+	}
+
+	// Columns of the point gradient, the first three are the identity
+	ScalarType jc[6][3][BATCH_SIZE];
+
+#pragma omp simd
+	for (int l = 0; l < BATCH_SIZE; l++) {
+		jc[0][0][l] = 1; jc[0][1][l] = 0; jc[0][2][l] = 0;
+		jc[1][0][l] = 0; jc[1][1][l] = 1; jc[1][2][l] = 0;
+		jc[2][0][l] = 0; jc[2][1][l] = 0; jc[2][2][l] = 1;
+		jc[3][0][l] = 0; jc[3][1][l] = jv[0][l]; jc[3][2][l] = jv[1][l];
+		jc[4][0][l] = jv[2][l]; jc[4][1][l] = jv[3][l]; jc[4][2][l] = jv[4][l];
+		jc[5][0][l] = jv[5][l]; jc[5][1][l] = jv[6][l]; jc[5][2][l] = jv[7][l];
+	}
+
+	// u dot the second order point derivatives (eq. 6.20, 6.21 [Magnusson 2009]).
+	// The first component of a, b and c is zero. The last row stands for the zero blocks.
+	ScalarType uh[7][BATCH_SIZE];
+	const int h_first[6] = {-1, -1, -1, 6, 9, 12};	// Column of the first component in h_ang_, -1 if zero
+	const int h_second[6] = {0, 2, 4, 7, 10, 13};
+
+	for (int k = 0; k < 6; k++) {
+		const ScalarType *h1 = h_ang_[h_second[k]];
+		const ScalarType *h2 = h_ang_[h_second[k] + 1];
+		const ScalarType *h0 = (h_first[k] >= 0) ? h_ang_[h_first[k]] : 0;
+
+#pragma omp simd
+		for (int l = 0; l < BATCH_SIZE; l++) {
+			ScalarType x_h1 = x_[0][l] * h1[0] + x_[1][l] * h1[1] + x_[2][l] * h1[2];
+			ScalarType x_h2 = x_[0][l] * h2[0] + x_[1][l] * h2[1] + x_[2][l] * h2[2];
+
+			uh[k][l] = u[1][l] * x_h1 + u[2][l] * x_h2;
+		}
+
+		if (h0 != 0) {
+#pragma omp simd
+			for (int l = 0; l < BATCH_SIZE; l++) {
+				uh[k][l] += u[0][l] * (x_[0][l] * h0[0] + x_[1][l] * h0[1] + x_[2][l] * h0[2]);
+			}
+		}
+	}
+
+#pragma omp simd
+	for (int l = 0; l < BATCH_SIZE; l++) {
+		uh[6][l] = 0;
+	}
+
+	// Index of u dot point Hessian block (i, j) in uh
+	const int uh_id[6][6] = {
+		{6, 6, 6, 6, 6, 6},
+		{6, 6, 6, 6, 6, 6},
+		{6, 6, 6, 6, 6, 6},
+		{6, 6, 6, 0, 1, 2},
+		{6, 6, 6, 1, 3, 4},
+		{6, 6, 6, 2, 4, 5}
+	};
+
+	int id = 0;
+
+	for (int i = 0; i < 6; i++) {
+		// c_inv * i-th column of the point gradient
+		ScalarType cj[3][BATCH_SIZE];
+
+#pragma omp simd
+		for (int l = 0; l < BATCH_SIZE; l++) {
+			cj[0][l] = c_inv_[0][l] * jc[i][0][l] + c_inv_[1][l] * jc[i][1][l] + c_inv_[2][l] * jc[i][2][l];
+			cj[1][l] = c_inv_[1][l] * jc[i][0][l] + c_inv_[3][l] * jc[i][1][l] + c_inv_[4][l] * jc[i][2][l];
+			cj[2][l] = c_inv_[2][l] * jc[i][0][l] + c_inv_[4][l] * jc[i][1][l] + c_inv_[5][l] * jc[i][2][l];
+		}
+
+		for (int j = i; j < 6; j++, id++) {
+			const ScalarType *uh_ij = uh[uh_id[i][j]];
+
+#pragma omp simd
+			for (int l = 0; l < BATCH_SIZE; l++) {
+				ScalarType h = -gauss_d2_ * g[i][l] * g[j][l] + uh_ij[l] +
+								jc[j][0][l] * cj[0][l] + jc[j][1][l] * cj[1][l] + jc[j][2][l] * cj[2][l];
+
+				hessian_[id][l] += w[l] * h;
+			}
+		}
+	}
+}
+
+template <typename ScalarType>
+double BatchDerivatives<ScalarType>::getScore() const
+{
+	double score = 0;
+
+	for (int l = 0; l < BATCH_SIZE; l++) {
+		score += score_[l];
+	}
+
+	return score;
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::getGradient(Eigen::Matrix<double, 6, 1> &score_gradient) const
+{
+	for (int i = 0; i < 6; i++) {
+		double sum = 0;
+
+		for (int l = 0; l < BATCH_SIZE; l++) {
+			sum += gradient_[i][l];
+		}
+
+		score_gradient(i) = sum;
+	}
+}
+
+template <typename ScalarType>
+void BatchDerivatives<ScalarType>::getHessian(Eigen::Matrix<double, 6, 6> &hessian) const
+{
+	int id = 0;
+
+	for (int i = 0; i < 6; i++) {
+		for (int j = i; j < 6; j++, id++) {
+			double sum = 0;
+
+			for (int l = 0; l < BATCH_SIZE; l++) {
+				sum += hessian_[id][l];
+			}
+
+			hessian(i, j) = hessian(j, i) = sum;
+		}
+	}
+}
+
+template class BatchDerivatives<float>;
+template class BatchDerivatives<double>;
+
+}
@@ -29,6 +29,8 @@ NormalDistributionsTransform<PointSourceType, PointTargetType>::NormalDistributi
 	transformation_epsilon_ = 0.1;
 	max_iterations_ = 35;
 	real_iterations_ = 0;
+	num_threads_ = 1;
+	backend_ = SCALAR;
 }
 
 template <typename PointSourceType, typename PointTargetType>
@@ -49,6 +51,18 @@ void NormalDistributionsTransform<PointSourceType, PointTargetType>::setOutlierR
 	outlier_ratio_ = olr;
 }
 
+template <typename PointSourceType, typename PointTargetType>
+void NormalDistributionsTransform<PointSourceType, PointTargetType>::setNumThreads(int num_threads)
+{
+	num_threads_ = (num_threads > 1) ? num_threads : 1;
+}
+
+template <typename PointSourceType, typename PointTargetType>
+void NormalDistributionsTransform<PointSourceType, PointTargetType>::setDerivativeBackend(DerivativeBackend backend)
+{
+	backend_ = backend;
+}
+
 template <typename PointSourceType, typename PointTargetType>
 double NormalDistributionsTransform<PointSourceType, PointTargetType>::getStepSize() const
 {
@@ -67,6 +81,19 @@ double NormalDistributionsTransform<PointSourceType, PointTargetType>::getOutlie
 	return outlier_ratio_;
 }
 
+template <typename PointSourceType, typename PointTargetType>
+int NormalDistributionsTransform<PointSourceType, PointTargetType>::getNumThreads() const
+{
+	return num_threads_;
+}
+
+template <typename PointSourceType, typename PointTargetType>
+typename NormalDistributionsTransform<PointSourceType, PointTargetType>::DerivativeBackend
+NormalDistributionsTransform<PointSourceType, PointTargetType>::getDerivativeBackend() const
+{
+	return backend_;
+}
+
 template <typename PointSourceType, typename PointTargetType>
 double NormalDistributionsTransform<PointSourceType, PointTargetType>::getTransformationProbability() const
 {
@@ -186,16 +213,62 @@ double NormalDistributionsTransform<PointSourceType, PointTargetType>::computeDe
 																							typename pcl::PointCloud<PointSourceType> &trans_cloud,
 																							Eigen::Matrix<double, 6, 1> pose, bool compute_hessian)
 {
-	PointSourceType x_pt, x_trans_pt;
-	Eigen::Vector3d x, x_trans;
-	Eigen::Matrix3d c_inv;
-
 	score_gradient.setZero ();
 	hessian.setZero ();
 
 	//Compute Angle Derivatives
 	computeAngleDerivatives(pose);
 
+	int points_number = source_cloud_->points.size();
+
+	if (num_threads_ <= 1) {
+		return computeDerivativesBlock(score_gradient, hessian, trans_cloud, 0, points_number, compute_hessian);
+	}
+
+	// Each block of points owns a partial score, gradient and Hessian. The partial results
+	// are merged in block order afterwards, so the sum does not depend on thread scheduling.
+	int block_num = (points_number + POINTS_PER_BLOCK_ - 1) / POINTS_PER_BLOCK_;
+
+	std::vector<double> block_score(block_num, 0);
+	std::vector<Eigen::Matrix<double, 6, 1>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, 1> > > block_gradient(block_num);
+	std::vector<Eigen::Matrix<double, 6, 6>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, 6> > > block_hessian(block_num);
+
+#pragma omp parallel for num_threads(num_threads_) schedule(dynamic)
+	for (int block = 0; block < block_num; block++) {
+		int begin = block * POINTS_PER_BLOCK_;
+		int end = (begin + POINTS_PER_BLOCK_ < points_number) ? begin + POINTS_PER_BLOCK_ : points_number;
+
+		block_gradient[block].setZero();
+		block_hessian[block].setZero();
+		block_score[block] = computeDerivativesBlock(block_gradient[block], block_hessian[block], trans_cloud, begin, end, compute_hessian);
+	}
+
+	double score = 0;
+
+	for (int block = 0; block < block_num; block++) {
+		score += block_score[block];
+		score_gradient += block_gradient[block];
+		hessian += block_hessian[block];
+	}
+
+	return score;
+}
+
+template <typename PointSourceType, typename PointTargetType>
+double NormalDistributionsTransform<PointSourceType, PointTargetType>::computeDerivativesBlock(Eigen::Matrix<double, 6, 1> &score_gradient, Eigen::Matrix<double, 6, 6> &hessian,
+																								typename pcl::PointCloud<PointSourceType> &trans_cloud,
+																								int begin, int end, bool compute_hessian)
+{
+	if (backend_ == BATCH_DOUBLE) {
+		return computeDerivativesBatch<double>(score_gradient, hessian, trans_cloud, begin, end, compute_hessian);
+	} else if (backend_ == BATCH_FLOAT) {
+		return computeDerivativesBatch<float>(score_gradient, hessian, trans_cloud, begin, end, compute_hessian);
+	}
+
+	PointSourceType x_pt, x_trans_pt;
+	Eigen::Vector3d x, x_trans;
+	Eigen::Matrix3d c_inv;
+
 	std::vector<int> neighbor_ids;
 	Eigen::Matrix<double, 3, 6> point_gradient;
 	Eigen::Matrix<double, 18, 6> point_hessian;
@@ -205,7 +278,7 @@ double NormalDistributionsTransform<PointSourceType, PointTargetType>::computeDe
 	point_gradient.block<3, 3>(0, 0).setIdentity();
 	point_hessian.setZero();
 
-	for (int idx = 0; idx < source_cloud_->points.size(); idx++) {
+	for (int idx = begin; idx < end; idx++) {
 		neighbor_ids.clear();
 		x_trans_pt = trans_cloud.points[idx];
 
@@ -231,6 +304,64 @@ double NormalDistributionsTransform<PointSourceType, PointTargetType>::computeDe
 	return score;
 }
 
+template <typename PointSourceType, typename PointTargetType>
+template <typename ScalarType>
+double NormalDistributionsTransform<PointSourceType, PointTargetType>::computeDerivativesBatch(Eigen::Matrix<double, 6, 1> &score_gradient, Eigen::Matrix<double, 6, 6> &hessian,
+																								typename pcl::PointCloud<PointSourceType> &trans_cloud,
+																								int begin, int end, bool compute_hessian)
+{
+	Eigen::Matrix<double, 3, 8> j_ang;
+	Eigen::Matrix<double, 3, 15> h_ang;
+
+	j_ang << j_ang_a_, j_ang_b_, j_ang_c_, j_ang_d_, j_ang_e_, j_ang_f_, j_ang_g_, j_ang_h_;
+	h_ang << h_ang_a2_, h_ang_a3_, h_ang_b2_, h_ang_b3_, h_ang_c2_, h_ang_c3_,
+			h_ang_d1_, h_ang_d2_, h_ang_d3_, h_ang_e1_, h_ang_e2_, h_ang_e3_, h_ang_f1_, h_ang_f2_, h_ang_f3_;
+
+	BatchDerivatives<ScalarType> batch;
+
+	batch.setGaussParameters(gauss_d1_, gauss_d2_);
+	batch.setAngleDerivatives(j_ang, h_ang);
+	batch.reset(compute_hessian);
+
+	PointSourceType x_pt, x_trans_pt;
+	Eigen::Vector3d x, x_trans;
+	std::vector<int> neighbor_ids;
+
+	for (int idx = begin; idx < end; idx++) {
+		neighbor_ids.clear();
+		x_trans_pt = trans_cloud.points[idx];
+
+		voxel_grid_.radiusSearch(x_trans_pt, resolution_, neighbor_ids);
+
+		x_pt = source_cloud_->points[idx];
+		x = Eigen::Vector3d(x_pt.x, x_pt.y, x_pt.z);
+
+		for (int i = 0; i < neighbor_ids.size(); i++) {
+			int vid = neighbor_ids[i];
+
+			x_trans = Eigen::Vector3d(x_trans_pt.x, x_trans_pt.y, x_trans_pt.z);
+			x_trans -= voxel_grid_.getCentroid(vid);
+
+			batch.push(x, x_trans, voxel_grid_.getInverseCovariance(vid));
+		}
+	}
+
+	batch.flush();
+
+	Eigen::Matrix<double, 6, 1> batch_gradient;
+	Eigen::Matrix<double, 6, 6> batch_hessian;
+
+	batch.getGradient(batch_gradient);
+	score_gradient += batch_gradient;
+
+	if (compute_hessian) {
+		batch.getHessian(batch_hessian);
+		hessian += batch_hessian;
+	}
+
+	return batch.getScore();
+}
+
 template <typename PointSourceType, typename PointTargetType>
 void NormalDistributionsTransform<PointSourceType, PointTargetType>::computePointDerivatives(Eigen::Vector3d &x, Eigen::Matrix<double, 3, 6> &point_gradient, Eigen::Matrix<double, 18, 6> &point_hessian, bool compute_hessian)
 {
@@ -681,20 +812,62 @@ void NormalDistributionsTransform<PointSourceType, PointTargetType>::updateHessi
 template <typename PointSourceType, typename PointTargetType>
 void NormalDistributionsTransform<PointSourceType, PointTargetType>::computeHessian(Eigen::Matrix<double, 6, 6> &hessian, typename pcl::PointCloud<PointSourceType> &trans_cloud, Eigen::Matrix<double, 6, 1> &p)
 {
+	hessian.setZero();
+
+	int points_number = source_cloud_->points.size();
+
+	if (num_threads_ <= 1) {
+		computeHessianBlock(hessian, trans_cloud, 0, points_number);
+		return;
+	}
+
+	int block_num = (points_number + POINTS_PER_BLOCK_ - 1) / POINTS_PER_BLOCK_;
+
+	std::vector<Eigen::Matrix<double, 6, 6>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, 6> > > block_hessian(block_num);
+
+#pragma omp parallel for num_threads(num_threads_) schedule(dynamic)
+	for (int block = 0; block < block_num; block++) {
+		int begin = block * POINTS_PER_BLOCK_;
+		int end = (begin + POINTS_PER_BLOCK_ < points_number) ? begin + POINTS_PER_BLOCK_ : points_number;
+
+		block_hessian[block].setZero();
+		computeHessianBlock(block_hessian[block], trans_cloud, begin, end);
+	}
+
+	for (int block = 0; block < block_num; block++) {
+		hessian += block_hessian[block];
+	}
+}
+
+template <typename PointSourceType, typename PointTargetType>
+void NormalDistributionsTransform<PointSourceType, PointTargetType>::computeHessianBlock(Eigen::Matrix<double, 6, 6> &hessian, typename pcl::PointCloud<PointSourceType> &trans_cloud, int begin, int end)
+{
+	if (backend_ != SCALAR) {
+		Eigen::Matrix<double, 6, 1> score_gradient;
+
+		score_gradient.setZero();
+		computeDerivativesBlock(score_gradient, hessian, trans_cloud, begin, end, true);
+
+		return;
+	}
+
 	PointSourceType x_pt, x_trans_pt;
 	Eigen::Vector3d x, x_trans;
 	Eigen::Matrix3d c_inv;
 
-	hessian.setZero();
-
 	Eigen::Matrix<double, 3, 6> point_gradient;
 	Eigen::Matrix<double, 18, 6> point_hessian;
 
+	point_gradient.setZero();
+	point_gradient.block<3, 3>(0, 0).setIdentity();
+	point_hessian.setZero();
+
+	std::vector<int> neighbor_ids;
 
-	for (int idx = 0; idx < source_cloud_->points.size(); idx++) {
+	for (int idx = begin; idx < end; idx++) {
 		x_trans_pt = trans_cloud.points[idx];
 
-		std::vector<int> neighbor_ids;
+		neighbor_ids.clear();
 
 		voxel_grid_.radiusSearch(x_trans_pt, resolution_, neighbor_ids);
 
@@ -712,8 +885,6 @@ void NormalDistributionsTransform<PointSourceType, PointTargetType>::computeHess
 			updateHessian(hessian, point_gradient, point_hessian, x_trans, c_inv);
 		}
 	}
-
-
 }
 
 template <typename PointSourceType, typename PointTargetType>
@@ -754,6 +925,12 @@ void NormalDistributionsTransform<PointSourceType, PointTargetType>::updateVoxel
 	voxel_grid_.update(new_cloud);
 }
 
+template <typename PointSourceType, typename PointTargetType>
+void NormalDistributionsTransform<PointSourceType, PointTargetType>::removeFromVoxelGrid(typename pcl::PointCloud<PointTargetType>::Ptr old_cloud)
+{
+	voxel_grid_.remove(old_cloud);
+}
+
 template class NormalDistributionsTransform<pcl::PointXYZI, pcl::PointXYZI>;
 template class NormalDistributionsTransform<pcl::PointXYZ, pcl::PointXYZ>;
 
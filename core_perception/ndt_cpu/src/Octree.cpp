@@ -6,15 +6,29 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <utility>
+#include <unordered_map>
 
 #include <stdio.h>
 #include <sys/time.h>
 #include <iostream>
 
-#include <bitset>
-
 namespace cpu {
 
+/* Spread the lower 21 bits of v so that there are two zero bits between each of them */
+static inline uint64_t spreadBits(uint64_t v)
+{
+	v &= 0x1fffff;
+	v = (v | (v << 32)) & 0x1f00000000ffffULL;
+	v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+	v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+	v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+	v = (v | (v << 2)) & 0x1249249249249249ULL;
+
+	return v;
+}
+
 template <typename PointSourceType>
 Octree<PointSourceType>::Octree()
 {
@@ -22,22 +36,10 @@ Octree<PointSourceType>::Octree()
 	leaf_y_ = 4; //16;
 	leaf_z_ = 2; //4;
 
-	octree_.reset();
-	reserved_size_.reset();
-	dimension_.reset();
-	occupancy_check_.reset();
-}
+	origin_x_ = origin_y_ = origin_z_ = 0;
 
-template <typename PointSourceType>
-int Octree<PointSourceType>::roundUp(int input, int factor)
-{
-	return (input < 0) ? (-((-input) / factor) * factor) : ((input  + factor - 1 ) / factor) * factor;
-}
-
-template <typename PointSourceType>
-int Octree<PointSourceType>::roundDown(int input, int factor)
-{
-	return (input < 0) ? (-(-input + factor - 1) / factor) * factor : (input / factor) * factor;
+	octree_.reset();
+	node_keys_.reset();
 }
 
 template <typename PointSourceType>
@@ -47,286 +49,156 @@ int Octree<PointSourceType>::div(int input, int divisor)
 }
 
 template <typename PointSourceType>
-void Octree<PointSourceType>::setInput(std::vector<Eigen::Vector3i> occupied_voxels, typename pcl::PointCloud<PointSourceType>::Ptr point_cloud)
+bool Octree<PointSourceType>::leafKey(const Eigen::Vector3i &voxel, uint64_t &key)
 {
-	octree_.reset();
-	reserved_size_.reset();
-	dimension_.reset();
-	occupancy_check_.reset();
-
-	octree_ = boost::make_shared<std::vector<std::vector<OctreeNode> > >();
-	reserved_size_ = boost::make_shared<std::vector<OctreeLevelBoundaries> >();
-	dimension_ = boost::make_shared<std::vector<OctreeLevelDim> >();
-	occupancy_check_ = boost::make_shared<std::vector<std::vector<unsigned int> > >();
-
-	// Reserve memory
-	int max_b_x, max_b_y, max_b_z;
-	int min_b_x, min_b_y, min_b_z;
-
-	max_b_x = max_b_y = max_b_z = INT_MIN;
-	min_b_x = min_b_y = min_b_z = INT_MAX;
-
-	for (int i = 0; i < occupied_voxels.size(); i++) {
-		Eigen::Vector3i vid = occupied_voxels[i];
-
-		if (min_b_x > vid(0)) {
-			min_b_x = vid(0);
-		}
-
-		if (max_b_x < vid(0)) {
-			max_b_x = vid(0);
-		}
-
-		if (min_b_y > vid(1)) {
-			min_b_y = vid(1);
-		}
-
-		if (max_b_y < vid(1)) {
-			max_b_y = vid(1);
-		}
-
-		if (min_b_z > vid(2)) {
-			min_b_z = vid(2);
-		}
+	int64_t idx = static_cast<int64_t>(div(voxel(0), leaf_x_)) - origin_x_ + LEAF_BIAS_;
+	int64_t idy = static_cast<int64_t>(div(voxel(1), leaf_y_)) - origin_y_ + LEAF_BIAS_;
+	int64_t idz = static_cast<int64_t>(div(voxel(2), leaf_z_)) - origin_z_ + LEAF_BIAS_;
 
-		if (max_b_z < vid(2)) {
-			max_b_z = vid(2);
-		}
+	if (idx < 0 || idx >= 2 * LEAF_BIAS_ || idy < 0 || idy >= 2 * LEAF_BIAS_ || idz < 0 || idz >= 2 * LEAF_BIAS_) {
+		return false;
 	}
 
-	OctreeLevelBoundaries level;
-
-	int node_number;
-
-	OctreeLevelDim level_size;
-
-	level.lower_x = roundDown(div(min_b_x, leaf_x_), MAX_BX_);
-	level.lower_y = roundDown(div(min_b_y, leaf_y_), MAX_BY_);
-	level.lower_z = roundDown(div(min_b_z, leaf_z_), MAX_BZ_);
-
-	level.upper_x = roundUp(div(max_b_x, leaf_x_), MAX_BX_);
-	level.upper_y = roundUp(div(max_b_y, leaf_y_), MAX_BY_);
-	level.upper_z = roundUp(div(max_b_z, leaf_z_), MAX_BZ_);
-
-	level_size.x = level.upper_x - level.lower_x + 1;
-	level_size.y = level.upper_y - level.lower_y + 1;
-	level_size.z = level.upper_z - level.lower_z + 1;
-
-	node_number = level_size.x * level_size.y * level_size.z;
-
-	// construct bottom
-
-	std::vector<OctreeNode> level0(node_number);
-	std::vector<unsigned int> occupancy0(static_cast<int>((node_number + sizeof(unsigned int) * 8 - 1) / (sizeof(unsigned int) * 8)), 0);
-
-	(*octree_).push_back(level0);
-	(*reserved_size_).push_back(level);
-	(*dimension_).push_back(level_size);
-	(*occupancy_check_).push_back(occupancy0);
-
-	int tree_level = 0;
-
+	key = spreadBits(static_cast<uint64_t>(idx)) | (spreadBits(static_cast<uint64_t>(idy)) << 1) |
+			(spreadBits(static_cast<uint64_t>(idz)) << 2);
 
+	return true;
+}
 
-	while (node_number > 8) {
-		level.lower_x = div(level.lower_x, 2);
-		level.lower_y = div(level.lower_y, 2);
-		level.lower_z = div(level.lower_z, 2);
+template <typename PointSourceType>
+void Octree<PointSourceType>::setInput(std::vector<Eigen::Vector3i> occupied_voxels, typename pcl::PointCloud<PointSourceType>::Ptr point_cloud)
+{
+	clear();
 
-		level.upper_x = div(level.upper_x, 2);
-		level.upper_y = div(level.upper_y, 2);
-		level.upper_z = div(level.upper_z, 2);
+	if (occupied_voxels.empty()) {
+		return;
+	}
 
-		level_size.x = level.upper_x - level.lower_x + 1;
-		level_size.y = level.upper_y - level.lower_y + 1;
-		level_size.z = level.upper_z - level.lower_z + 1;
+	origin_x_ = div(occupied_voxels[0](0), leaf_x_);
+	origin_y_ = div(occupied_voxels[0](1), leaf_y_);
+	origin_z_ = div(occupied_voxels[0](2), leaf_z_);
 
-		node_number = level_size.x * level_size.y * level_size.z;
+	octree_ = boost::make_shared<std::vector<std::vector<OctreeNode> > >(1);
+	node_keys_ = boost::make_shared<std::vector<std::vector<uint64_t> > >(1);
 
-		std::vector<OctreeNode> new_level(node_number);
-		std::vector<unsigned int> new_occupancy_check(static_cast<int>((node_number + sizeof(unsigned int) * 8 - 1) / (sizeof(unsigned int) * 8)), 0);
+	buildLeaves(occupied_voxels, point_cloud, (*node_keys_)[0], (*octree_)[0]);
 
-		(*octree_).push_back(new_level);
-		(*reserved_size_).push_back(level);
-		(*dimension_).push_back(level_size);
-		(*occupancy_check_).push_back(new_occupancy_check);
+	if ((*octree_)[0].empty()) {
+		clear();
+		return;
 	}
 
-	// Setup the lowest level
-	for (int i = 0; i < occupied_voxels.size(); i++) {
-		Eigen::Vector3i vid = occupied_voxels[i];
-
-		// Indexes of the octree node that contains the current voxel
-		int nidx = div(vid(0), leaf_x_);
-		int nidy = div(vid(1), leaf_y_);
-		int nidz = div(vid(2), leaf_z_);
-
-		int nid = index2id(nidx, nidy, nidz, 0);
-
-		std::vector<OctreeNode> &current_level = (*octree_)[0];
-		OctreeLevelBoundaries curb = (*reserved_size_)[0];
-		OctreeNode &current_node = current_level[nid];
-		PointSourceType p = point_cloud->points[i];
-
-		// Update boundaries inside the node
-		if (!isOccupied(nid, 0)) {
-			/* If the current octree node is empty,
-			 * just set boundaries inside the node
-			 */
-			current_node.lx = current_node.ux = p.x;
-			current_node.ly = current_node.uy = p.y;
-			current_node.lz = current_node.uz = p.z;
-			current_node.point_num = 1;
-			current_node.centroid(0) = p.x;
-			current_node.centroid(1) = p.y;
-			current_node.centroid(2) = p.z;
-
-			// Update occupancy status
-			setOccupied(nid, 0);
-
-		} else {
-			/* Otherwise, update boundaries inside the node */
-			if (p.x < current_node.lx) {
-				current_node.lx = p.x;
-			}
+	buildUpperLevels();
+}
 
-			if (p.y < current_node.ly) {
-				current_node.ly = p.y;
-			}
+template <typename PointSourceType>
+void Octree<PointSourceType>::buildLeaves(const std::vector<Eigen::Vector3i> &voxels, typename pcl::PointCloud<PointSourceType>::Ptr cloud,
+											std::vector<uint64_t> &keys, std::vector<OctreeNode> &leaves)
+{
+	std::unordered_map<uint64_t, int> leaf_ids;
+	std::vector<std::pair<uint64_t, int> > key_ids;
+	std::vector<OctreeNode> unsorted_leaves;
 
-			if (p.z < current_node.lz) {
-				current_node.lz = p.z;
-			}
+	leaf_ids.reserve(voxels.size() / 16 + 1);
 
-			if (p.x > current_node.ux) {
-				current_node.ux = p.x;
-			}
+	// Accumulate the point sums in the centroids
+	for (int i = 0; i < voxels.size(); i++) {
+		uint64_t key;
 
-			if (p.y > current_node.uy) {
-				current_node.uy = p.y;
-			}
+		if (!leafKey(voxels[i], key)) {
+			continue;
+		}
 
-			if (p.z > current_node.uz) {
-				current_node.uz = p.z;
-			}
+		PointSourceType p = cloud->points[i];
+		std::pair<typename std::unordered_map<uint64_t, int>::iterator, bool> res = leaf_ids.insert(std::make_pair(key, static_cast<int>(unsorted_leaves.size())));
 
-			Eigen::Vector3d new_node(p.x, p.y, p.z);
+		if (res.second) {
+			OctreeNode node;
 
-			current_node.centroid = current_node.centroid * current_node.point_num + new_node;
-			current_node.point_num++;
-			current_node.centroid /= current_node.point_num;
+			node.lx = node.ux = p.x;
+			node.ly = node.uy = p.y;
+			node.lz = node.uz = p.z;
+			node.centroid = Eigen::Vector3d(p.x, p.y, p.z);
+			node.point_num = 1;
+			node.parent = -1;
+			node.first_child = -1;
+			node.child_num = 0;
 
+			unsorted_leaves.push_back(node);
+			key_ids.push_back(std::make_pair(key, res.first->second));
+		} else {
+			OctreeNode &node = unsorted_leaves[res.first->second];
+
+			node.lx = std::min(node.lx, p.x);
+			node.ux = std::max(node.ux, p.x);
+			node.ly = std::min(node.ly, p.y);
+			node.uy = std::max(node.uy, p.y);
+			node.lz = std::min(node.lz, p.z);
+			node.uz = std::max(node.uz, p.z);
+			node.centroid += Eigen::Vector3d(p.x, p.y, p.z);
+			node.point_num++;
 		}
 	}
 
-	// Build higher levels
-	OctreeLevelBoundaries child, parent;
+	std::sort(key_ids.begin(), key_ids.end());
 
-	for (int level = 1; level < (*octree_).size(); level++) {
-		buildLevel(level);
+	keys.resize(key_ids.size());
+	leaves.resize(key_ids.size());
+
+	for (int i = 0; i < key_ids.size(); i++) {
+		keys[i] = key_ids[i].first;
+		leaves[i] = unsorted_leaves[key_ids[i].second];
+		leaves[i].centroid /= leaves[i].point_num;
 	}
 }
 
 template <typename PointSourceType>
-bool Octree<PointSourceType>::isOccupied(int node_id, int level)
+void Octree<PointSourceType>::mergeNode(OctreeNode &dst, const OctreeNode &src)
 {
-	std::vector<unsigned int> &current_occ = (*occupancy_check_)[level];
-
-	int val_loc = node_id / (sizeof(int) * 8);
-	int bit_loc = node_id % (sizeof(int) * 8);
-
-	return ((current_occ[val_loc] & (1 << bit_loc)) == (1 << bit_loc));
+	dst.lx = std::min(dst.lx, src.lx);
+	dst.ux = std::max(dst.ux, src.ux);
+	dst.ly = std::min(dst.ly, src.ly);
+	dst.uy = std::max(dst.uy, src.uy);
+	dst.lz = std::min(dst.lz, src.lz);
+	dst.uz = std::max(dst.uz, src.uz);
+	dst.centroid = (dst.centroid * dst.point_num + src.centroid * src.point_num) / (dst.point_num + src.point_num);
+	dst.point_num += src.point_num;
 }
 
 template <typename PointSourceType>
-bool Octree<PointSourceType>::isOccupied(std::vector<unsigned int> occupancy, int node_id)
+void Octree<PointSourceType>::buildUpperLevels()
 {
-	int val_loc = node_id / (sizeof(int) * 8);
-	int bit_loc = node_id % (sizeof(int) * 8);
+	octree_->resize(1);
+	node_keys_->resize(1);
 
-	return ((occupancy[val_loc] & (1 << bit_loc)) == (1 << bit_loc));
-}
+	// Stop when the top level is small enough to be scanned entirely
+	for (int level = 0; (*octree_)[level].size() > MAX_TOP_NODES_; level++) {
+		octree_->push_back(std::vector<OctreeNode>());
+		node_keys_->push_back(std::vector<uint64_t>());
 
-template <typename PointSourceType>
-void Octree<PointSourceType>::setOccupied(int node_id, int level)
-{
-	std::vector<unsigned int> &current_occ = (*occupancy_check_)[level];
-	int val_loc = node_id / (sizeof(int) * 8);
-	int bit_loc = node_id % (sizeof(int) * 8);
+		std::vector<OctreeNode> &children = (*octree_)[level];
+		std::vector<uint64_t> &child_keys = (*node_keys_)[level];
+		std::vector<OctreeNode> &parents = (*octree_)[level + 1];
+		std::vector<uint64_t> &parent_keys = (*node_keys_)[level + 1];
 
-	current_occ[val_loc] |= (1 << bit_loc);
-}
+		for (int i = 0; i < children.size(); i++) {
+			uint64_t key = child_keys[i] >> 3;
 
-template <typename PointSourceType>
-void Octree<PointSourceType>::setOccupied(std::vector<unsigned int> &occupancy, int node_id)
-{
-	int val_loc = node_id / (sizeof(int) * 8);
-	int bit_loc = node_id % (sizeof(int) * 8);
+			if (parent_keys.empty() || parent_keys.back() != key) {
+				OctreeNode node = children[i];
 
-	occupancy[val_loc] |= (1 << bit_loc);
-}
+				node.parent = -1;
+				node.first_child = i;
+				node.child_num = 0;
 
-template <typename PointSourceType>
-void Octree<PointSourceType>::buildLevel(int level)
-{
-	// Parent list
-	std::vector<OctreeNode> &parent = (*octree_)[level];
-	std::vector<unsigned int> &poccupancy = (*occupancy_check_)[level];
-
-	// Child list
-	std::vector<OctreeNode> &child = (*octree_)[level - 1];
-	std::vector<unsigned int> &coccupancy = (*occupancy_check_)[level - 1];
-	OctreeLevelBoundaries cbounds = (*reserved_size_)[level - 1];
-
-	for (int i = cbounds.lower_x; i <= cbounds.upper_x; i++) {
-		for (int j = cbounds.lower_y; j <= cbounds.upper_y; j++) {
-			for (int k = cbounds.lower_z; k <= cbounds.upper_z; k++) {
-				int cid = index2id(i, j, k, level - 1);		// Child id
-				int pidx = div(i, 2);
-				int pidy = div(j, 2);
-				int pidz = div(k, 2);
-				int pid = index2id(pidx, pidy, pidz, level);	// Parent id
-				OctreeNode &cnode = child[cid];
-				OctreeNode &pnode = parent[pid];
-
-				if (isOccupied(cid, level - 1)) {
-					if (isOccupied(pid, level)) {
-						if (pnode.lx > cnode.lx) {
-							pnode.lx = cnode.lx;
-						}
-
-						if (pnode.ly > cnode.ly) {
-							pnode.ly = cnode.ly;
-						}
-
-						if (pnode.lz > cnode.lz) {
-							pnode.lz = cnode.lz;
-						}
-
-						if (pnode.ux < cnode.ux) {
-							pnode.ux = cnode.ux;
-						}
-
-						if (pnode.uy < cnode.uy) {
-							pnode.uy = cnode.uy;
-						}
-
-						if (pnode.uz < cnode.uz) {
-							pnode.uz = cnode.uz;
-						}
-
-						// If the parent node is already occupied, update its centroid
-						pnode.centroid = pnode.centroid * pnode.point_num + cnode.centroid * cnode.point_num;
-						pnode.point_num += cnode.point_num;
-						pnode.centroid /= pnode.point_num;
-					} else {
-						// Otherwise, set cnode to pnode and mark the pnode as occupied
-						pnode = cnode;
-
-						setOccupied(pid, level);
-					}
-				}
+				parents.push_back(node);
+				parent_keys.push_back(key);
+			} else {
+				mergeNode(parents.back(), children[i]);
 			}
+
+			parents.back().child_num++;
+			children[i].parent = parents.size() - 1;
 		}
 	}
 }
@@ -334,322 +206,70 @@ void Octree<PointSourceType>::buildLevel(int level)
 template <typename PointSourceType>
 void Octree<PointSourceType>::update(std::vector<Eigen::Vector3i> new_voxels, typename pcl::PointCloud<PointSourceType>::Ptr new_cloud)
 {
-	// First, update boundaries
-	updateBoundaries(new_voxels);
-
-	updateOctreeContent(new_voxels, new_cloud);
-}
-
-template <typename PointSourceType>
-void Octree<PointSourceType>::updateBoundaries(std::vector<Eigen::Vector3i> new_voxels)
-{
-	int new_min_bx, new_min_by, new_min_bz;
-	int new_max_bx, new_max_by, new_max_bz;
-
-	new_min_bx = new_min_by = new_min_bz = INT_MAX;
-	new_max_bx = new_max_by = new_max_bz = INT_MIN;
-
-	for (int i = 0; i < new_voxels.size(); i++) {
-		Eigen::Vector3i vid = new_voxels[i];
-
-		if (new_min_bx > vid(0)) {
-			new_min_bx = vid(0);
-		}
-
-		if (new_max_bx < vid(0)) {
-			new_max_bx = vid(0);
-		}
-
-		if (new_min_by > vid(1)) {
-			new_min_by = vid(1);
-		}
-
-		if (new_max_by < vid(1)) {
-			new_max_by = vid(1);
-		}
-
-		if (new_min_bz > vid(2)) {
-			new_min_bz = vid(2);
-		}
-
-		if (new_max_bz < vid(2)) {
-			new_max_bz = vid(2);
-		}
+	if (empty()) {
+		setInput(new_voxels, new_cloud);
+		return;
 	}
 
-	OctreeLevelBoundaries dst_bounds;
-
-	dst_bounds.lower_x = roundDown(div(new_min_bx, leaf_x_), MAX_BX_);
-	dst_bounds.lower_y = roundDown(div(new_min_by, leaf_y_), MAX_BY_);
-	dst_bounds.lower_z = roundDown(div(new_min_bz, leaf_z_), MAX_BZ_);
-
-	dst_bounds.upper_x = roundUp(div(new_max_bx, leaf_x_), MAX_BX_);
-	dst_bounds.upper_y = roundUp(div(new_max_by, leaf_y_), MAX_BY_);
-	dst_bounds.upper_z = roundUp(div(new_max_bz, leaf_z_), MAX_BZ_);
-
-	/* Compare dst_bounds with boundaries of the lowest level
-	 * of the octree to check if we need to reallocate the octree
-	 */
-	OctreeLevelBoundaries src_bounds = (*reserved_size_)[0];
-
-	if (dst_bounds.lower_x < src_bounds.lower_x || dst_bounds.lower_y < src_bounds.lower_y || dst_bounds.lower_z < src_bounds.lower_z ||
-			dst_bounds.upper_x > src_bounds.upper_x || dst_bounds.upper_y > src_bounds.upper_y || dst_bounds.upper_z > src_bounds.upper_z) {
-		// If the base voxel grid expanded, then we need expand the octree as well
-		if (dst_bounds.lower_x > src_bounds.lower_x) {
-			dst_bounds.lower_x = src_bounds.lower_x;
-		}
-
-		if (dst_bounds.lower_y > src_bounds.lower_y) {
-			dst_bounds.lower_y = src_bounds.lower_y;
-		}
-
-		if (dst_bounds.lower_z > src_bounds.lower_z) {
-			dst_bounds.lower_z = src_bounds.lower_z;
-		}
-
-		if (dst_bounds.upper_x < src_bounds.upper_x) {
-			dst_bounds.upper_x = src_bounds.upper_x;
-		}
-
-		if (dst_bounds.upper_y < src_bounds.upper_y) {
-			dst_bounds.upper_y = src_bounds.upper_y;
-		}
-
-		if (dst_bounds.upper_z < src_bounds.upper_z) {
-			dst_bounds.upper_z = src_bounds.upper_z;
-		}
-
-		OctreeLevelDim dst_dim;
-
-		dst_dim.x = dst_bounds.upper_x - dst_bounds.lower_x + 1;
-		dst_dim.y = dst_bounds.upper_y - dst_bounds.lower_y + 1;
-		dst_dim.z = dst_bounds.upper_z - dst_bounds.lower_z + 1;
-		int node_number = dst_dim.x * dst_dim.y * dst_dim.z;
-
-		// Backup old octree
-		boost::shared_ptr<std::vector<std::vector<OctreeNode> > > old_octree = octree_;
-		boost::shared_ptr<std::vector<std::vector<unsigned int> > > old_occupancy_check = occupancy_check_;
-		boost::shared_ptr<std::vector<OctreeLevelBoundaries> > old_reserved_size = reserved_size_;
-		boost::shared_ptr<std::vector<OctreeLevelDim> > old_dimension = dimension_;
+	std::vector<uint64_t> new_keys;
+	std::vector<OctreeNode> new_leaves;
 
-		// Reserve space for the new octree
-		octree_ = boost::make_shared<std::vector<std::vector<OctreeNode> > >();
-		occupancy_check_ = boost::make_shared<std::vector<std::vector<unsigned int> > >();
-		reserved_size_ = boost::make_shared<std::vector<OctreeLevelBoundaries> >();
-		dimension_ = boost::make_shared<std::vector<OctreeLevelDim> >();
+	buildLeaves(new_voxels, new_cloud, new_keys, new_leaves);
 
-		//Setup level0
+	// Merge the new leaves into the sorted old ones
+	std::vector<uint64_t> &old_keys = (*node_keys_)[0];
+	std::vector<OctreeNode> &old_leaves = (*octree_)[0];
+	std::vector<uint64_t> keys;
+	std::vector<OctreeNode> leaves;
+	int i = 0, j = 0;
 
-		std::vector<OctreeNode> new_level0(node_number);
-		std::vector<unsigned int> new_occupy0((node_number + sizeof(unsigned int) * 8 - 1) / (sizeof(unsigned int) * 8), 0);
+	keys.reserve(old_keys.size() + new_keys.size());
+	leaves.reserve(old_keys.size() + new_keys.size());
 
-		(*octree_).push_back(new_level0);
-		(*occupancy_check_).push_back(new_occupy0);
-		(*reserved_size_).push_back(dst_bounds);
-		(*dimension_).push_back(dst_dim);
-
-		while (node_number > 8) {
-			dst_bounds.lower_x = div(dst_bounds.lower_x, 2);
-			dst_bounds.lower_y = div(dst_bounds.lower_y, 2);
-			dst_bounds.lower_z = div(dst_bounds.lower_z, 2);
-			dst_bounds.upper_x = div(dst_bounds.upper_x, 2);
-			dst_bounds.upper_y = div(dst_bounds.upper_y, 2);
-			dst_bounds.upper_z = div(dst_bounds.upper_z, 2);
-
-			dst_dim.x = dst_bounds.upper_x - dst_bounds.lower_x + 1;
-			dst_dim.y = dst_bounds.upper_y - dst_bounds.lower_y + 1;
-			dst_dim.z = dst_bounds.upper_z - dst_bounds.lower_z + 1;
-
-			node_number = dst_dim.x * dst_dim.y * dst_dim.z;
-
-			std::vector<OctreeNode> new_level(node_number);
-			std::vector<unsigned int> new_occupancy(static_cast<int>((node_number + sizeof(unsigned int) * 8 - 1) / (sizeof(unsigned int) * 8)), 0);
-
-			(*octree_).push_back(new_level);
-			(*occupancy_check_).push_back(new_occupancy);
-			(*reserved_size_).push_back(dst_bounds);
-			(*dimension_).push_back(dst_dim);
-		}
-
-
-		// Copy the old octree to the new one
-		int level = 0;
-
-		for (; level < (*old_octree).size(); level++) {
-			std::vector<unsigned int> &dst_occupancy = (*occupancy_check_)[level];
-			std::vector<OctreeNode> &dst_level = (*octree_)[level];
-			OctreeLevelBoundaries dst_bounds = (*reserved_size_)[level];
-			OctreeLevelDim dst_dim = (*dimension_)[level];
-
-
-			std::vector<unsigned int> &src_occupancy = (*old_occupancy_check)[level];
-			std::vector<OctreeNode> &src_level = (*old_octree)[level];
-			OctreeLevelBoundaries src_bounds = (*old_reserved_size)[level];
-			OctreeLevelDim src_dim = (*old_dimension)[level];
-
-			for (int i = 0; i < src_occupancy.size(); i++) {
-				unsigned int stat32 = src_occupancy[i];
-
-				if (stat32 != 0) {
-					for (int j = 0; j < sizeof(unsigned int) * 8; j++) {
-						if ((stat32 & (1 << j)) == (1 << j)) {
-							int src_id = j + i * sizeof(unsigned int) * 8;
-							Eigen::Vector3i vid = id2index(src_id, src_bounds, src_dim);
-							int dst_id = index2id(vid(0), vid(1), vid(2), dst_bounds, dst_dim);
-
-							dst_level[dst_id] = src_level[src_id];
-							setOccupied(dst_occupancy, dst_id);
-						}
-					}
-				}
-			}
-		}
-
-		// Build upper levels
-		for (; level < (*octree_).size(); level++) {
-			buildLevel(level);
+	while (i < old_keys.size() || j < new_keys.size()) {
+		if (j == new_keys.size() || (i < old_keys.size() && old_keys[i] < new_keys[j])) {
+			keys.push_back(old_keys[i]);
+			leaves.push_back(old_leaves[i++]);
+		} else if (i == old_keys.size() || new_keys[j] < old_keys[i]) {
+			keys.push_back(new_keys[j]);
+			leaves.push_back(new_leaves[j++]);
+		} else {
+			keys.push_back(old_keys[i]);
+			leaves.push_back(old_leaves[i++]);
+			mergeNode(leaves.back(), new_leaves[j++]);
 		}
 	}
 
-}
-
-template <typename PointSourceType>
-int Octree<PointSourceType>::index2id(int idx, int idy, int idz, int level)
-{
-	OctreeLevelBoundaries bound = (*reserved_size_)[level];
-	OctreeLevelDim dim = (*dimension_)[level];
-
-	return ((idx - bound.lower_x) + (idy - bound.lower_y) * dim.x + (idz - bound.lower_z) * dim.x * dim.y);
-}
-
+	old_keys.swap(keys);
+	old_leaves.swap(leaves);
 
-template <typename PointSourceType>
-int Octree<PointSourceType>::index2id(int idx, int idy, int idz, OctreeLevelBoundaries bounds, OctreeLevelDim dim)
-{
-	return ((idx - bounds.lower_x) + (idy - bounds.lower_y) * dim.x + (idz - bounds.lower_z) * dim.x * dim.y);
+	buildUpperLevels();
 }
 
 template <typename PointSourceType>
-Eigen::Vector3i Octree<PointSourceType>::id2index(int id, int level)
+void Octree<PointSourceType>::clear()
 {
-	Eigen::Vector3i output;
-
-	OctreeLevelBoundaries bound = (*reserved_size_)[level];
-	OctreeLevelDim dim = (*dimension_)[level];
-
-	output(2) = id / (dim.x * dim.y);
-	id -= output(2) * dim.x * dim.y;
-	output(1) = id / dim.x;
-	output(0) = id - output(1) * dim.x;
-
-
-	output(0) += bound.lower_x;
-	output(1) += bound.lower_y;
-	output(2) += bound.lower_z;
-
-	return output;
-}
-
-template <typename PointSourceType>
-Eigen::Vector3i Octree<PointSourceType>::id2index(int id, OctreeLevelBoundaries bounds, OctreeLevelDim dims)
-{
-	Eigen::Vector3i output;
-
-	output(2) = id / (dims.x * dims.y);
-	id -= output(2) * dims.x * dims.y;
-	output(1) = id / dims.x;
-	output(0) = id - output(1) * dims.x;
-
-	output(0) += bounds.lower_x;
-	output(1) += bounds.lower_y;
-	output(2) += bounds.lower_z;
-
-	return output;
+	octree_.reset();
+	node_keys_.reset();
 }
 
 template <typename PointSourceType>
-void Octree<PointSourceType>::updateOctreeContent(std::vector<Eigen::Vector3i> new_voxels, typename pcl::PointCloud<PointSourceType>::Ptr new_cloud)
+bool Octree<PointSourceType>::empty() const
 {
-	for (int i = 0; i < new_voxels.size(); i++) {
-		Eigen::Vector3i vid = new_voxels[i];
-		int node_idx = div(vid(0), leaf_x_);
-		int node_idy = div(vid(1), leaf_y_);
-		int node_idz = div(vid(2), leaf_z_);
-		PointSourceType p = new_cloud->points[i];
-		Eigen::Vector3d point(p.x, p.y, p.z);
-
-		// Go from bottom to top to update tree nodes
-		for (int level = 0; level < (*octree_).size(); level++) {
-			int nid = index2id(node_idx, node_idy, node_idz, level);
-			std::vector<OctreeNode> &cur_level = (*octree_)[level];
-			OctreeNode &node = cur_level[nid];
-
-			if (isOccupied(nid, level)) {
-				// If the node is occupied, update the current content
-				if (p.x < node.lx) {
-					node.lx = p.x;
-				}
-
-				if (p.y < node.ly) {
-					node.ly = p.y;
-				}
-
-				if (p.z < node.lz) {
-					node.lz = p.z;
-				}
-
-				if (p.x > node.ux) {
-					node.ux = p.x;
-				}
-
-				if (p.y > node.uy) {
-					node.uy = p.y;
-				}
-
-				if (p.z > node.uz) {
-					node.uz = p.z;
-				}
-
-
-				node.centroid = node.centroid * node.point_num + point;
-				node.point_num++;
-				node.centroid /= node.point_num;
-
-			} else {
-				node.lx = node.ux = p.x;
-				node.ly = node.uy = p.y;
-				node.lz = node.uz = p.z;
-
-				node.centroid = point;
-				node.point_num = 1;
-
-				setOccupied(nid, level);
-			}
-
-			node_idx = div(node_idx, 2);
-			node_idy = div(node_idy, 2);
-			node_idz = div(node_idz, 2);
-		}
-	}
+	return !octree_;
 }
 
-
 template <typename PointSourceType>
 Eigen::Matrix<float, 6, 1> Octree<PointSourceType>::nearestOctreeNode(PointSourceType q)
 {
 	double min_range = DBL_MAX;
-	int current_nn_vid = -1;
-
-	initRange(q, min_range, current_nn_vid);
+	int current_nn_leaf = -1;
 
-	Eigen::Vector3i cur_vid = id2index(current_nn_vid, 0);
-	Eigen::Matrix<int, 4, 1> cur_nn_node(cur_vid(0), cur_vid(1), cur_vid(2), 0);
+	initRange(q, min_range, current_nn_leaf);
 
-	goUp(cur_nn_node, q, min_range, current_nn_vid);
+	goUp(0, current_nn_leaf, q, min_range, current_nn_leaf);
 
-	std::vector<OctreeNode> &bottom = (*octree_)[0];
-
-	OctreeNode out_node = bottom[current_nn_vid];
+	OctreeNode out_node = (*octree_)[0][current_nn_leaf];
 
 	Eigen::Matrix<float, 6, 1> output;
 
@@ -661,17 +281,14 @@ Eigen::Matrix<float, 6, 1> Octree<PointSourceType>::nearestOctreeNode(PointSourc
 	output(4) = out_node.uy;
 	output(5) = out_node.uz;
 
-
-
 	return output;
 }
 
 template <typename PointSourceType>
-double Octree<PointSourceType>::dist(OctreeNode node, PointSourceType p)
+double Octree<PointSourceType>::dist(const OctreeNode &node, PointSourceType p)
 {
 	double dx, dy, dz;
 
-
 	if (p.x < node.lx) {
 		dx = node.lx - p.x;
 	} else if (p.x > node.ux) {
@@ -700,217 +317,94 @@ double Octree<PointSourceType>::dist(OctreeNode node, PointSourceType p)
 }
 
 template <typename PointSourceType>
-void Octree<PointSourceType>::initRange(PointSourceType q, double &min_range, int &nn_id)
+double Octree<PointSourceType>::centroidDist(const OctreeNode &node, PointSourceType q)
 {
-	// Init min_range at maximum double value
-	min_range = DBL_MAX;
-
-	// Check top
-	int top_id;
-	int top_lv = (*octree_).size() - 1;
-	std::vector<OctreeNode> &top = (*octree_)[top_lv];
-
-	for (int i = 0; i < top.size(); i++) {
-		if (isOccupied(i, top_lv)) {
-			OctreeNode node = top[i];
-
-			double cur_dist = dist(node, q);
-
-			if (cur_dist < min_range) {
-				min_range = cur_dist;
-				top_id = i;
-			}
-		}
-	}
+	Eigen::Vector3d c = node.centroid;
 
+	return sqrt((c(0) - q.x) * (c(0) - q.x) + (c(1) - q.y) * (c(1) - q.y) + (c(2) - q.z) * (c(2) - q.z));
+}
 
-	Eigen::Vector3i top_indexes = id2index(top_id, top_lv);
-	int nidx = top_indexes(0);
-	int nidy = top_indexes(1);
-	int nidz = top_indexes(2);
-	int lower_x, upper_x, lower_y, upper_y, lower_z, upper_z;
+template <typename PointSourceType>
+void Octree<PointSourceType>::initRange(PointSourceType q, double &min_range, int &nn_id)
+{
+	// Pick the closest top node, then the closest child down to the leaves
+	int top_lv = (*octree_).size() - 1;
+	int first = 0;
+	int num = (*octree_)[top_lv].size();
 
-	// Go down to leaf
-	for (int level = (*octree_).size() - 2; level >= 1; level--) {
-		OctreeLevelBoundaries bounds = (*reserved_size_)[level];
+	for (int level = top_lv; level >= 0; level--) {
 		std::vector<OctreeNode> &cur_level = (*octree_)[level];
-
-		lower_x = (nidx * 2 < bounds.lower_x) ? bounds.lower_x : nidx * 2;
-		upper_x = (nidx * 2 + 1 > bounds.upper_x) ? bounds.upper_x : nidx * 2 + 1;
-
-		lower_y = (nidy * 2 < bounds.lower_y) ? bounds.lower_y : nidy * 2;
-		upper_y = (nidy * 2 + 1 > bounds.upper_y) ? bounds.upper_y : nidy * 2 + 1;
-
-		lower_z = (nidz * 2 < bounds.lower_z) ? bounds.lower_z : nidz * 2;
-		upper_z = (nidz * 2 + 1 > bounds.upper_z) ? bounds.upper_z : nidz * 2 + 1;
+		int best = first;
 
 		min_range = DBL_MAX;
 
-		for (int i = lower_x; i <= upper_x; i++) {
-			for (int j = lower_y; j <= upper_y; j++) {
-				for (int k = lower_z; k <= upper_z; k++) {
-					int node_id = index2id(i, j, k, level);
-
-					if (isOccupied(node_id, level)) {
-						OctreeNode node = cur_level[node_id];
-						double cur_dist = dist(node, q);
-
-						if (cur_dist < min_range) {
-							min_range = cur_dist;
-							nidx = i;
-							nidy = j;
-							nidz = k;
-						}
-					}
-				}
-			}
-		}
-	}
-
-	// Inspect leaves
-	OctreeLevelBoundaries bounds = (*reserved_size_)[0];
-	std::vector<OctreeNode> &bottom = (*octree_)[0];
-
-	lower_x = (nidx * 2 < bounds.lower_x) ? bounds.lower_x : nidx * 2;
-	upper_x = (nidx * 2 + 1 > bounds.upper_x) ? bounds.upper_x : nidx * 2 + 1;
-
-	lower_y = (nidy * 2 < bounds.lower_y) ? bounds.lower_y : nidy * 2;
-	upper_y = (nidy * 2 + 1 > bounds.upper_y) ? bounds.upper_y : nidy * 2 + 1;
-
-	lower_z = (nidz * 2 < bounds.lower_z) ? bounds.lower_z : nidz * 2;
-	upper_z = (nidz * 2 + 1 > bounds.upper_z) ? bounds.upper_z : nidz * 2 + 1;
-
-	min_range = DBL_MAX;
-
-	for (int i = lower_x; i <= upper_x; i++) {
-		for (int j = lower_y; j <= upper_y; j++) {
-			for (int k = lower_z; k <= upper_z; k++) {
-				int node_id = index2id(i, j, k, 0);
-
-				if (isOccupied(node_id, 0)) {
-					OctreeNode node = bottom[node_id];
-					Eigen::Vector3d c = node.centroid;
-					double cur_dist = sqrt((c(0) - q.x) * (c(0) - q.x) + (c(1) - q.y) * (c(1) - q.y) + (c(2) - q.z) * (c(2) - q.z));
+		for (int i = first; i < first + num; i++) {
+			double cur_dist = (level == 0) ? centroidDist(cur_level[i], q) : dist(cur_level[i], q);
 
-					if (cur_dist < min_range) {
-						min_range = cur_dist;
-						nidx = i;
-						nidy = j;
-						nidz = k;
-					}
-				}
+			if (cur_dist < min_range) {
+				min_range = cur_dist;
+				best = i;
 			}
 		}
-	}
 
-	nn_id = index2id(nidx, nidy, nidz, 0);
+		first = cur_level[best].first_child;
+		num = cur_level[best].child_num;
+		nn_id = best;
+	}
 }
 
 // Check all childrens
 template <typename PointSourceType>
-void Octree<PointSourceType>::goDown(Eigen::Matrix<int, 4, 1> node, PointSourceType q, double &min_range, int &current_nn_voxel)
+void Octree<PointSourceType>::goDown(int level, int node_id, PointSourceType q, double &min_range, int &current_nn_leaf)
 {
-	int id = index2id(node(0), node(1), node(2), node(3));
-
-	if (!isOccupied(id, node(3))) {
-		return;
-	}
+	OctreeNode &cur_node = (*octree_)[level][node_id];
 
-	std::vector<OctreeNode> &cur_level = (*octree_)[node(3)];
-	OctreeNode cur_node = cur_level[id];
-
-	if (node(3) == 0) {
-		Eigen::Vector3d c = cur_node.centroid;
-		double cur_dist = sqrt((c(0) - q.x) * (c(0) - q.x) + (c(1) - q.y) * (c(1) - q.y) + (c(2) - q.z) * (c(2) - q.z));
+	if (level == 0) {
+		double cur_dist = centroidDist(cur_node, q);
 
 		if (cur_dist < min_range) {
 			min_range = cur_dist;
-			current_nn_voxel = id;
+			current_nn_leaf = node_id;
 		}
-	}
 
-	double cur_dist = dist(cur_node, q);
-
-	if (cur_dist > min_range) {
 		return;
 	}
 
-	// Check children
-	int level = node(3) - 1;
-	OctreeLevelBoundaries bounds = (*reserved_size_)[level];
-
-	int lower_x = (node(0) * 2 < bounds.lower_x) ? bounds.lower_x : node(0) * 2;
-	int upper_x = (node(0) * 2 + 1 > bounds.upper_x) ? bounds.upper_x : node(0) * 2 + 1;
-
-	int lower_y = (node(1) * 2 < bounds.lower_y) ? bounds.lower_y : node(1) * 2;
-	int upper_y = (node(1) * 2 + 1 > bounds.upper_y) ? bounds.upper_y : node(1) * 2 + 1;
-
-	int lower_z = (node(2) * 2 < bounds.lower_z) ? bounds.lower_z : node(2) * 2;
-	int upper_z = (node(2) * 2 + 1 > bounds.upper_z) ? bounds.upper_z : node(2) * 2 + 1;
-
-	for (int i = lower_x; i <= upper_x; i++) {
-		for (int j = lower_y; j <= upper_y; j++) {
-			for (int k = lower_z; k <= upper_z; k++) {
-				Eigen::Matrix<int, 4, 1> child(i, j, k, level);
+	if (dist(cur_node, q) > min_range) {
+		return;
+	}
 
-				goDown(child, q, min_range, current_nn_voxel);
-			}
-		}
+	for (int i = cur_node.first_child; i < cur_node.first_child + cur_node.child_num; i++) {
+		goDown(level - 1, i, q, min_range, current_nn_leaf);
 	}
 }
 
 // Check siblings then go up to parent
 template <typename PointSourceType>
-void Octree<PointSourceType>::goUp(Eigen::Matrix<int, 4, 1> node, PointSourceType q, double &min_range, int &current_nn_voxel)
+void Octree<PointSourceType>::goUp(int level, int node_id, PointSourceType q, double &min_range, int &current_nn_leaf)
 {
-	if (node(3) == (*octree_).size() - 1) {
-		// If reaching top
-		int top_lv = (*octree_).size() - 1;
-		OctreeLevelBoundaries top_bound = (*reserved_size_)[top_lv];
-
-		for (int i = top_bound.lower_x; i <= top_bound.upper_x; i++) {
-			for (int j = top_bound.lower_y; j <= top_bound.upper_y; j++) {
-				for (int k = top_bound.lower_z; k <= top_bound.upper_z; k++) {
-					Eigen::Matrix<int, 4, 1> sib(i, j, k, top_lv);
-
-					if (sib != node) {
-						goDown(sib, q, min_range, current_nn_voxel);
-					}
-				}
-			}
-		}
+	int top_lv = (*octree_).size() - 1;
+	int first, num;
 
-		return;
+	if (level == top_lv) {
+		first = 0;
+		num = (*octree_)[top_lv].size();
+	} else {
+		OctreeNode &parent = (*octree_)[level + 1][(*octree_)[level][node_id].parent];
+
+		first = parent.first_child;
+		num = parent.child_num;
 	}
 
-	int px = div(node(0), 2);
-	int py = div(node(1), 2);
-	int pz = div(node(2), 2);
-	int level = node(3);
-	OctreeLevelBoundaries bounds = (*reserved_size_)[level];
-	int lower_x = (px * 2 < bounds.lower_x) ? bounds.lower_x : px * 2;
-	int upper_x = (px * 2 + 1 > bounds.upper_x) ? bounds.upper_x : px * 2 + 1;
-	int lower_y = (py * 2 < bounds.lower_y) ? bounds.lower_y : py * 2;
-	int upper_y = (py * 2 + 1 > bounds.upper_y) ? bounds.upper_y : py * 2 + 1;
-	int lower_z = (pz * 2 < bounds.lower_z) ? bounds.lower_z : pz * 2;
-	int upper_z = (pz * 2 + 1 > bounds.upper_z) ? bounds.upper_z : pz * 2 + 1;
-
-	for (int i = lower_x; i <= upper_x; i++) {
-		for (int j = lower_y; j <= upper_y; j++) {
-			for (int k = lower_z; k <= upper_z; k++) {
-				Eigen::Matrix<int, 4, 1> sib(i, j, k, level);
-
-				if (sib != node) {
-					goDown(sib, q, min_range, current_nn_voxel);
-				}
-			}
+	for (int i = first; i < first + num; i++) {
+		if (i != node_id) {
+			goDown(level, i, q, min_range, current_nn_leaf);
 		}
 	}
 
-
-	Eigen::Matrix<int, 4, 1> parent(px, py, pz, level + 1);
-
-	goUp(parent, q, min_range, current_nn_voxel);
+	if (level < top_lv) {
+		goUp(level + 1, (*octree_)[level][node_id].parent, q, min_range, current_nn_leaf);
+	}
 }
 
 template class Octree<pcl::PointXYZ>;
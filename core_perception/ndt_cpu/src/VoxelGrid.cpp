@@ -6,6 +6,7 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
 
 #include <stdio.h>
 #include <sys/time.h>
@@ -14,6 +15,45 @@
 
 namespace cpu {
 
+/* Key of empty entries in the hash table. Morton keys use
+ * 3 * MORTON_BITS_ = 63 bits, so this value never appears as a key. */
+static const uint64_t EMPTY_KEY = UINT64_MAX;
+
+/* Spread the lower 21 bits of v so that there are two zero bits between each of them */
+static inline uint64_t spreadBits(uint64_t v)
+{
+	v &= 0x1fffff;
+	v = (v | (v << 32)) & 0x1f00000000ffffULL;
+	v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+	v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+	v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+	v = (v | (v << 2)) & 0x1249249249249249ULL;
+
+	return v;
+}
+
+/* Inverse of spreadBits: gather every third bit of v into the lower 21 bits */
+static inline uint64_t compactBits(uint64_t v)
+{
+	v &= 0x1249249249249249ULL;
+	v = (v | (v >> 2)) & 0x10c30c30c30c30c3ULL;
+	v = (v | (v >> 4)) & 0x100f00f00f00f00fULL;
+	v = (v | (v >> 8)) & 0x1f0000ff0000ffULL;
+	v = (v | (v >> 16)) & 0x1f00000000ffffULL;
+	v = (v | (v >> 32)) & 0x1fffff;
+
+	return v;
+}
+
+static inline uint64_t hashKey(uint64_t key)
+{
+	key ^= key >> 31;
+	key *= 0x9e3779b97f4a7c15ULL;
+	key ^= key >> 29;
+
+	return key;
+}
+
 template <typename PointSourceType>
 VoxelGrid<PointSourceType>::VoxelGrid():
 	voxel_num_(0),
@@ -36,59 +76,36 @@ VoxelGrid<PointSourceType>::VoxelGrid():
 	vgrid_y_(0),
 	vgrid_z_(0),
 	min_points_per_voxel_(6),
+	table_mask_(0),
 	real_max_bx_(INT_MIN),
 	real_max_by_(INT_MIN),
 	real_max_bz_(INT_MIN),
 	real_min_bx_(INT_MAX),
 	real_min_by_(INT_MAX),
-	real_min_bz_(INT_MAX)
-{
-	centroid_.reset();
-	icovariance_.reset();
-	points_id_.reset();
-	points_per_voxel_.reset();
-	tmp_centroid_.reset();
-	tmp_cov_.reset();
-};
-
-template <typename PointSourceType>
-int VoxelGrid<PointSourceType>::roundUp(int input, int factor)
-{
-	return (input < 0) ? -((-input) / factor) * factor : ((input + factor - 1) / factor) * factor;
-}
-
-template <typename PointSourceType>
-int VoxelGrid<PointSourceType>::roundDown(int input, int factor)
-{
-	return (input < 0) ? -((-input + factor - 1) / factor) * factor : (input / factor) * factor;
-}
-
-template <typename PointSourceType>
-int VoxelGrid<PointSourceType>::div(int input, int divisor)
+	real_min_bz_(INT_MAX),
+	origin_b_x_(0),
+	origin_b_y_(0),
+	origin_b_z_(0)
 {
-	return (input < 0) ? -((-input + divisor - 1) / divisor) : input / divisor;
-}
+	initialize();
+};
 
 template <typename PointSourceType>
 void VoxelGrid<PointSourceType>::initialize()
 {
-	centroid_.reset();
-	centroid_ = boost::make_shared<std::vector<Eigen::Vector3d> >(voxel_num_);
-
-	icovariance_.reset();
-	icovariance_ = boost::make_shared<std::vector<Eigen::Matrix3d> >(voxel_num_);
-
-	points_id_.reset();
-	points_id_ = boost::make_shared<std::vector<std::vector<int> > >(voxel_num_);
-
-	points_per_voxel_.reset();
-	points_per_voxel_ = boost::make_shared<std::vector<int> >(voxel_num_, 0);
+	voxel_num_ = 0;
 
-	tmp_centroid_.reset();
-	tmp_centroid_ = boost::make_shared<std::vector<Eigen::Vector3d> >(voxel_num_);
+	voxel_key_ = boost::make_shared<std::vector<uint64_t> >();
+	centroid_ = boost::make_shared<std::vector<double> >();
+	icovariance_ = boost::make_shared<std::vector<float> >();
+	point_num_ = boost::make_shared<std::vector<int> >();
+	points_per_voxel_ = boost::make_shared<std::vector<int> >();
+	point_sum_ = boost::make_shared<std::vector<double> >();
+	point_moment_ = boost::make_shared<std::vector<double> >();
 
-	tmp_cov_.reset();
-	tmp_cov_ = boost::make_shared<std::vector<Eigen::Matrix3d> >(voxel_num_);
+	table_key_ = boost::make_shared<std::vector<uint64_t> >();
+	table_slot_ = boost::make_shared<std::vector<int> >();
+	table_mask_ = 0;
 }
 
 template <typename PointSourceType>
@@ -208,13 +225,22 @@ int VoxelGrid<PointSourceType>::getVgridZ() const
 template <typename PointSourceType>
 Eigen::Vector3d VoxelGrid<PointSourceType>::getCentroid(int voxel_id) const
 {
-	return (*centroid_)[voxel_id];
+	const double *c = &(*centroid_)[voxel_id * 3];
+
+	return Eigen::Vector3d(c[0], c[1], c[2]);
 }
 
 template <typename PointSourceType>
 Eigen::Matrix3d VoxelGrid<PointSourceType>::getInverseCovariance(int voxel_id) const
 {
-	return (*icovariance_)[voxel_id];
+	const float *ic = &(*icovariance_)[voxel_id * 6];
+	Eigen::Matrix3d icov;
+
+	icov << ic[0], ic[1], ic[2],
+			ic[1], ic[3], ic[4],
+			ic[2], ic[4], ic[5];
+
+	return icov;
 }
 
 template <typename PointSourceType>
@@ -226,83 +252,293 @@ void VoxelGrid<PointSourceType>::setLeafSize(float voxel_x, float voxel_y, float
 }
 
 template <typename PointSourceType>
-int VoxelGrid<PointSourceType>::voxelId(PointSourceType p)
+void VoxelGrid<PointSourceType>::setKeyOrigin(typename pcl::PointCloud<PointSourceType>::Ptr input_cloud)
+{
+	double sum_x = 0, sum_y = 0, sum_z = 0;
+
+	for (int i = 0; i < input_cloud->points.size(); i++) {
+		sum_x += input_cloud->points[i].x;
+		sum_y += input_cloud->points[i].y;
+		sum_z += input_cloud->points[i].z;
+	}
+
+	double point_num = static_cast<double>(input_cloud->points.size());
+
+	origin_b_x_ = static_cast<int>(floor(sum_x / point_num / voxel_x_));
+	origin_b_y_ = static_cast<int>(floor(sum_y / point_num / voxel_y_));
+	origin_b_z_ = static_cast<int>(floor(sum_z / point_num / voxel_z_));
+}
+
+template <typename PointSourceType>
+bool VoxelGrid<PointSourceType>::inKeyRange(int idx, int idy, int idz) const
+{
+	int64_t dx = static_cast<int64_t>(idx) - origin_b_x_;
+	int64_t dy = static_cast<int64_t>(idy) - origin_b_y_;
+	int64_t dz = static_cast<int64_t>(idz) - origin_b_z_;
+
+	return (dx >= -MORTON_BIAS_ && dx < MORTON_BIAS_ &&
+			dy >= -MORTON_BIAS_ && dy < MORTON_BIAS_ &&
+			dz >= -MORTON_BIAS_ && dz < MORTON_BIAS_);
+}
+
+template <typename PointSourceType>
+typename pcl::PointCloud<PointSourceType>::Ptr VoxelGrid<PointSourceType>::keyRangePoints(typename pcl::PointCloud<PointSourceType>::Ptr input_cloud,
+																						std::vector<Eigen::Vector3i> &voxel_ids) const
+{
+	typename pcl::PointCloud<PointSourceType>::Ptr output_cloud = input_cloud;
+
+	voxel_ids.clear();
+	voxel_ids.reserve(input_cloud->points.size());
+
+	for (int i = 0; i < input_cloud->points.size(); i++) {
+		PointSourceType p = input_cloud->points[i];
+		Eigen::Vector3i vid(static_cast<int>(floor(p.x / voxel_x_)),
+							static_cast<int>(floor(p.y / voxel_y_)),
+							static_cast<int>(floor(p.z / voxel_z_)));
+
+		if (inKeyRange(vid(0), vid(1), vid(2))) {
+			voxel_ids.push_back(vid);
+
+			if (output_cloud != input_cloud) {
+				output_cloud->points.push_back(p);
+			}
+		} else if (output_cloud == input_cloud) {
+			// Copy the points kept so far, the first time a point is out of range
+			output_cloud.reset(new pcl::PointCloud<PointSourceType>());
+			output_cloud->points.assign(input_cloud->points.begin(), input_cloud->points.begin() + i);
+		}
+	}
+
+	return output_cloud;
+}
+
+template <typename PointSourceType>
+uint64_t VoxelGrid<PointSourceType>::mortonKey(int idx, int idy, int idz) const
 {
-	int idx = static_cast<int>(floor(p.x / voxel_x_)) - min_b_x_;
-	int idy = static_cast<int>(floor(p.y / voxel_y_)) - min_b_y_;
-	int idz = static_cast<int>(floor(p.z / voxel_z_)) - min_b_z_;
+	return spreadBits(static_cast<uint64_t>(static_cast<int64_t>(idx) - origin_b_x_ + MORTON_BIAS_)) |
+			(spreadBits(static_cast<uint64_t>(static_cast<int64_t>(idy) - origin_b_y_ + MORTON_BIAS_)) << 1) |
+			(spreadBits(static_cast<uint64_t>(static_cast<int64_t>(idz) - origin_b_z_ + MORTON_BIAS_)) << 2);
+}
 
-	return (idx + idy * vgrid_x_ + idz * vgrid_x_ * vgrid_y_);
+template <typename PointSourceType>
+Eigen::Vector3i VoxelGrid<PointSourceType>::voxelIndex(uint64_t key) const
+{
+	return Eigen::Vector3i(static_cast<int>(compactBits(key)) - MORTON_BIAS_ + origin_b_x_,
+							static_cast<int>(compactBits(key >> 1)) - MORTON_BIAS_ + origin_b_y_,
+							static_cast<int>(compactBits(key >> 2)) - MORTON_BIAS_ + origin_b_z_);
 }
 
 template <typename PointSourceType>
-int VoxelGrid<PointSourceType>::voxelId(PointSourceType p,
-											float voxel_x, float voxel_y, float voxel_z,
-											int min_b_x, int min_b_y, int min_b_z,
-											int vgrid_x, int vgrid_y, int vgrid_z)
+int VoxelGrid<PointSourceType>::voxelId(int idx, int idy, int idz) const
 {
-	int idx = static_cast<int>(floor(p.x / voxel_x)) - min_b_x;
-	int idy = static_cast<int>(floor(p.y / voxel_y)) - min_b_y;
-	int idz = static_cast<int>(floor(p.z / voxel_z)) - min_b_z;
+	if (voxel_num_ == 0 || !inKeyRange(idx, idy, idz)) {
+		return -1;
+	}
 
-	return (idx + idy * vgrid_x + idz * vgrid_x * vgrid_y);
+	uint64_t key = mortonKey(idx, idy, idz);
+	const std::vector<uint64_t> &table_key = *table_key_;
+
+	for (uint64_t pos = hashKey(key) & table_mask_; table_key[pos] != EMPTY_KEY; pos = (pos + 1) & table_mask_) {
+		if (table_key[pos] == key) {
+			return (*table_slot_)[pos];
+		}
+	}
+
+	return -1;
 }
 
 template <typename PointSourceType>
-int VoxelGrid<PointSourceType>::voxelId(int idx, int idy, int idz,
-										int min_b_x, int min_b_y, int min_b_z,
-										int size_x, int size_y, int size_z)
+int VoxelGrid<PointSourceType>::insertVoxel(int idx, int idy, int idz)
 {
-	return (idx - min_b_x) + (idy - min_b_y) * size_x + (idz - min_b_z) * size_x * size_y;
+	if (!inKeyRange(idx, idy, idz)) {
+		return -1;
+	}
+
+	// Keep the load factor of the hash table under 0.5
+	if (static_cast<uint64_t>(voxel_num_ + 1) * 2 > table_key_->size()) {
+		rehash((voxel_num_ + 1) * 2);
+	}
+
+	uint64_t key = mortonKey(idx, idy, idz);
+	std::vector<uint64_t> &table_key = *table_key_;
+	uint64_t pos;
+
+	for (pos = hashKey(key) & table_mask_; table_key[pos] != EMPTY_KEY; pos = (pos + 1) & table_mask_) {
+		if (table_key[pos] == key) {
+			return (*table_slot_)[pos];
+		}
+	}
+
+	int vid = voxel_num_++;
+
+	table_key[pos] = key;
+	(*table_slot_)[pos] = vid;
+
+	voxel_key_->push_back(key);
+	centroid_->resize(voxel_num_ * 3, 0);
+	icovariance_->resize(voxel_num_ * 6, 0);
+	point_num_->push_back(0);
+	points_per_voxel_->push_back(0);
+	point_sum_->resize(voxel_num_ * 3, 0);
+
+	// The second moment starts from the identity matrix, as the
+	// original dense implementation did
+	point_moment_->resize(voxel_num_ * 6, 0);
+	(*point_moment_)[vid * 6] = (*point_moment_)[vid * 6 + 3] = (*point_moment_)[vid * 6 + 5] = 1;
+
+	return vid;
+}
+
+template <typename PointSourceType>
+void VoxelGrid<PointSourceType>::rehash(int min_capacity)
+{
+	uint64_t capacity = 1024;
+
+	while (capacity < static_cast<uint64_t>(min_capacity)) {
+		capacity <<= 1;
+	}
+
+	table_key_ = boost::make_shared<std::vector<uint64_t> >(capacity, EMPTY_KEY);
+	table_slot_ = boost::make_shared<std::vector<int> >(capacity, -1);
+	table_mask_ = capacity - 1;
+
+	std::vector<uint64_t> &table_key = *table_key_;
+
+	for (int vid = 0; vid < voxel_num_; vid++) {
+		uint64_t key = (*voxel_key_)[vid];
+		uint64_t pos;
+
+		for (pos = hashKey(key) & table_mask_; table_key[pos] != EMPTY_KEY; pos = (pos + 1) & table_mask_);
+
+		table_key[pos] = key;
+		(*table_slot_)[pos] = vid;
+	}
+}
+
+template <typename PointSourceType>
+void VoxelGrid<PointSourceType>::sortVoxelsByKey()
+{
+	std::vector<std::pair<uint64_t, int> > order;
+
+	order.reserve(voxel_num_);
+
+	for (int vid = 0; vid < voxel_num_; vid++) {
+		if ((*point_num_)[vid] > 0) {
+			order.push_back(std::make_pair((*voxel_key_)[vid], vid));
+		}
+	}
+
+	std::sort(order.begin(), order.end());
+
+	voxel_num_ = static_cast<int>(order.size());
+
+	boost::shared_ptr<std::vector<uint64_t> > voxel_key = boost::make_shared<std::vector<uint64_t> >(voxel_num_);
+	boost::shared_ptr<std::vector<double> > centroid = boost::make_shared<std::vector<double> >(voxel_num_ * 3);
+	boost::shared_ptr<std::vector<float> > icovariance = boost::make_shared<std::vector<float> >(voxel_num_ * 6);
+	boost::shared_ptr<std::vector<int> > point_num = boost::make_shared<std::vector<int> >(voxel_num_);
+	boost::shared_ptr<std::vector<int> > points_per_voxel = boost::make_shared<std::vector<int> >(voxel_num_);
+	boost::shared_ptr<std::vector<double> > point_sum = boost::make_shared<std::vector<double> >(voxel_num_ * 3);
+	boost::shared_ptr<std::vector<double> > point_moment = boost::make_shared<std::vector<double> >(voxel_num_ * 6);
+
+	for (int new_id = 0; new_id < voxel_num_; new_id++) {
+		int old_id = order[new_id].second;
+
+		(*voxel_key)[new_id] = (*voxel_key_)[old_id];
+		(*point_num)[new_id] = (*point_num_)[old_id];
+		(*points_per_voxel)[new_id] = (*points_per_voxel_)[old_id];
+
+		std::copy(centroid_->begin() + old_id * 3, centroid_->begin() + old_id * 3 + 3, centroid->begin() + new_id * 3);
+		std::copy(icovariance_->begin() + old_id * 6, icovariance_->begin() + old_id * 6 + 6, icovariance->begin() + new_id * 6);
+		std::copy(point_sum_->begin() + old_id * 3, point_sum_->begin() + old_id * 3 + 3, point_sum->begin() + new_id * 3);
+		std::copy(point_moment_->begin() + old_id * 6, point_moment_->begin() + old_id * 6 + 6, point_moment->begin() + new_id * 6);
+	}
+
+	voxel_key_ = voxel_key;
+	centroid_ = centroid;
+	icovariance_ = icovariance;
+	point_num_ = point_num;
+	points_per_voxel_ = points_per_voxel;
+	point_sum_ = point_sum;
+	point_moment_ = point_moment;
+
+	rehash(voxel_num_ * 2);
 }
 
 template <typename PointSourceType>
 void VoxelGrid<PointSourceType>::computeCentroidAndCovariance()
 {
-	for (int idx = real_min_bx_; idx <= real_max_bx_; idx++)
-		for (int idy = real_min_by_; idy <= real_max_by_; idy++)
-			for (int idz = real_min_bz_; idz <= real_max_bz_; idz++) {
-				int i = voxelId(idx, idy, idz, min_b_x_, min_b_y_, min_b_z_, vgrid_x_, vgrid_y_, vgrid_z_);
-				int ipoint_num = (*points_id_)[i].size();
-				double point_num = static_cast<double>(ipoint_num);
-				Eigen::Vector3d pt_sum = (*tmp_centroid_)[i];
+	for (int i = 0; i < voxel_num_; i++) {
+		computeCentroidAndCovariance(i);
+	}
+}
 
-				if (ipoint_num > 0) {
-					(*centroid_)[i] = pt_sum / point_num;
-				}
+template <typename PointSourceType>
+void VoxelGrid<PointSourceType>::computeCentroidAndCovariance(int i)
+{
+	int ipoint_num = (*point_num_)[i];
+	double point_num = static_cast<double>(ipoint_num);
+	const double *s = &(*point_sum_)[i * 3];
+	const double *m = &(*point_moment_)[i * 6];
+	double *c = &(*centroid_)[i * 3];
+
+	(*points_per_voxel_)[i] = ipoint_num;
 
-				Eigen::Matrix3d covariance;
+	if (ipoint_num <= 0) {
+		return;
+	}
 
-				if (ipoint_num >= min_points_per_voxel_) {
-					covariance = ((*tmp_cov_)[i] - 2.0 * (pt_sum * (*centroid_)[i].transpose())) / point_num + (*centroid_)[i] * (*centroid_)[i].transpose();
-					covariance *= (point_num - 1.0) / point_num;
+	Eigen::Vector3d pt_sum(s[0], s[1], s[2]);
+	Eigen::Vector3d centroid = pt_sum / point_num;
 
-					SymmetricEigensolver3x3 sv(covariance);
+	c[0] = centroid(0);
+	c[1] = centroid(1);
+	c[2] = centroid(2);
 
-					sv.compute();
-					Eigen::Matrix3d evecs = sv.eigenvectors();
-					Eigen::Matrix3d evals = sv.eigenvalues().asDiagonal();
+	if (ipoint_num >= min_points_per_voxel_) {
+		Eigen::Matrix3d moment;
 
-					if (evals(0, 0) < 0 || evals(1, 1) < 0 || evals(2, 2) <= 0) {
-						(*points_per_voxel_)[i] = -1;
-						continue;
-					}
+		moment << m[0], m[1], m[2],
+					m[1], m[3], m[4],
+					m[2], m[4], m[5];
 
-					double min_cov_eigvalue = evals(2, 2) * 0.01;
+		Eigen::Matrix3d covariance;
 
-					if (evals(0, 0) < min_cov_eigvalue) {
-						evals(0, 0) = min_cov_eigvalue;
+		covariance = (moment - 2.0 * (pt_sum * centroid.transpose())) / point_num + centroid * centroid.transpose();
+		covariance *= (point_num - 1.0) / point_num;
 
-						if (evals(1, 1) < min_cov_eigvalue) {
-							evals(1, 1) = min_cov_eigvalue;
-						}
+		SymmetricEigensolver3x3 sv(covariance);
 
-						covariance = evecs * evals * evecs.inverse();
-					}
+		sv.compute();
+		Eigen::Matrix3d evecs = sv.eigenvectors();
+		Eigen::Matrix3d evals = sv.eigenvalues().asDiagonal();
 
-					(*icovariance_)[i] = covariance.inverse();
-				}
+		if (evals(0, 0) < 0 || evals(1, 1) < 0 || evals(2, 2) <= 0) {
+			(*points_per_voxel_)[i] = -1;
+			return;
+		}
+
+		double min_cov_eigvalue = evals(2, 2) * 0.01;
+
+		if (evals(0, 0) < min_cov_eigvalue) {
+			evals(0, 0) = min_cov_eigvalue;
+
+			if (evals(1, 1) < min_cov_eigvalue) {
+				evals(1, 1) = min_cov_eigvalue;
 			}
+
+			covariance = evecs * evals * evecs.inverse();
+		}
+
+		Eigen::Matrix3d icov = covariance.inverse();
+		float *ic = &(*icovariance_)[i * 6];
+
+		ic[0] = static_cast<float>(icov(0, 0));
+		ic[1] = static_cast<float>(icov(0, 1));
+		ic[2] = static_cast<float>(icov(0, 2));
+		ic[3] = static_cast<float>(icov(1, 1));
+		ic[4] = static_cast<float>(icov(1, 2));
+		ic[5] = static_cast<float>(icov(2, 2));
+	}
 }
 
 //Input are supposed to be in device memory
@@ -317,18 +553,12 @@ void VoxelGrid<PointSourceType>::setInput(typename pcl::PointCloud<PointSourceTy
 
 		findBoundaries();
 
-		std::vector<Eigen::Vector3i> voxel_ids(input_cloud->points.size());
+		setKeyOrigin(input_cloud);
 
-		for (int i = 0; i < input_cloud->points.size(); i++) {
-			Eigen::Vector3i &vid = voxel_ids[i];
-			PointSourceType p = input_cloud->points[i];
+		std::vector<Eigen::Vector3i> voxel_ids;
+		typename pcl::PointCloud<PointSourceType>::Ptr octree_cloud = keyRangePoints(input_cloud, voxel_ids);
 
-			vid(0) = static_cast<int>(floor(p.x / voxel_x_));
-			vid(1) = static_cast<int>(floor(p.y / voxel_y_));
-			vid(2) = static_cast<int>(floor(p.z / voxel_z_));
-		}
-
-		octree_.setInput(voxel_ids, input_cloud);
+		octree_.setInput(voxel_ids, octree_cloud);
 
 		voxel_ids.clear();
 
@@ -336,6 +566,8 @@ void VoxelGrid<PointSourceType>::setInput(typename pcl::PointCloud<PointSourceTy
 
 		scatterPointsToVoxelGrid();
 
+		sortVoxelsByKey();
+
 		computeCentroidAndCovariance();
 	}
 }
@@ -354,28 +586,9 @@ void VoxelGrid<PointSourceType>::findBoundaries()
 	real_min_by_ = min_b_y_ = static_cast<int> (floor(min_y_ / voxel_y_));
 	real_min_bz_ = min_b_z_ = static_cast<int> (floor(min_z_ / voxel_z_));
 
-	/* Allocate a poll of memory that is larger than the requested memory so
-	 * we do not have to reallocate buffers when the target cloud is set
-	 */
-	/* Max bounds round toward plus infinity */
-	max_b_x_ = roundUp(max_b_x_, MAX_BX_);
-	max_b_y_ = roundUp(max_b_y_, MAX_BY_);
-	max_b_z_ = roundUp(max_b_z_, MAX_BZ_);
-
-	/* Min bounds round toward minus infinity */
-	min_b_x_ = roundDown(min_b_x_, MAX_BX_);
-	min_b_y_ = roundDown(min_b_y_, MAX_BY_);
-	min_b_z_ = roundDown(min_b_z_, MAX_BZ_);
-
 	vgrid_x_ = max_b_x_ - min_b_x_ + 1;
 	vgrid_y_ = max_b_y_ - min_b_y_ + 1;
 	vgrid_z_ = max_b_z_ - min_b_z_ + 1;
-
-	if (vgrid_x_ > 0 && vgrid_y_ > 0 && vgrid_z_ > 0) {
-		voxel_num_ = vgrid_x_ * vgrid_y_ * vgrid_z_;
-	} else {
-		voxel_num_ = 0;
-	}
 }
 
 template <typename PointSourceType>
@@ -432,14 +645,13 @@ void VoxelGrid<PointSourceType>::radiusSearch(PointSourceType p, float radius, s
 	for (int idx = min_id_x; idx <= max_id_x && nn < max_nn; idx++) {
 		for (int idy = min_id_y; idy <= max_id_y && nn < max_nn; idy++) {
 			for (int idz = min_id_z; idz <= max_id_z && nn < max_nn; idz++) {
-				int vid = voxelId(idx, idy, idz,
-									min_b_x_, min_b_y_, min_b_z_,
-									vgrid_x_, vgrid_y_, vgrid_z_);
+				int vid = voxelId(idx, idy, idz);
 
-				if ((*points_per_voxel_)[vid] >= min_points_per_voxel_) {
-					double cx = (*centroid_)[vid](0) - static_cast<double>(t_x);
-					double cy = (*centroid_)[vid](1) - static_cast<double>(t_y);
-					double cz = (*centroid_)[vid](2) - static_cast<double>(t_z);
+				if (vid >= 0 && (*points_per_voxel_)[vid] >= min_points_per_voxel_) {
+					const double *c = &(*centroid_)[vid * 3];
+					double cx = c[0] - static_cast<double>(t_x);
+					double cy = c[1] - static_cast<double>(t_y);
+					double cz = c[2] - static_cast<double>(t_z);
 
 					double distance = sqrt(cx * cx + cy * cy + cz * cz);
 
@@ -457,23 +669,39 @@ template <typename PointSourceType>
 void VoxelGrid<PointSourceType>::scatterPointsToVoxelGrid()
 {
 
+	int rejected_num = 0;
+
 	for (int pid = 0; pid < source_cloud_->points.size(); pid++) {
-		int vid = voxelId(source_cloud_->points[pid]);
 		PointSourceType p = source_cloud_->points[pid];
+		int vid = insertVoxel(static_cast<int>(floor(p.x / voxel_x_)),
+								static_cast<int>(floor(p.y / voxel_y_)),
+								static_cast<int>(floor(p.z / voxel_z_)));
 
-		Eigen::Vector3d p3d(p.x, p.y, p.z);
-
-		if ((*points_id_)[vid].size() == 0) {
-			(*centroid_)[vid].setZero();
-			(*points_per_voxel_)[vid] = 0;
-			(*tmp_centroid_)[vid].setZero();
-			(*tmp_cov_)[vid].setIdentity();
+		if (vid < 0) {
+			rejected_num++;
+			continue;
 		}
 
-		(*tmp_centroid_)[vid] += p3d;
-		(*tmp_cov_)[vid] += p3d * p3d.transpose();
-		(*points_id_)[vid].push_back(pid);
-		(*points_per_voxel_)[vid]++;
+		double *s = &(*point_sum_)[vid * 3];
+		double *m = &(*point_moment_)[vid * 6];
+		double x = p.x, y = p.y, z = p.z;
+
+		s[0] += x;
+		s[1] += y;
+		s[2] += z;
+
+		m[0] += x * x;
+		m[1] += x * y;
+		m[2] += x * z;
+		m[3] += y * y;
+		m[4] += y * z;
+		m[5] += z * z;
+
+		(*point_num_)[vid]++;
+	}
+
+	if (rejected_num > 0) {
+		printf("VoxelGrid: %d points are more than %d voxels away from the grid origin and are ignored\n", rejected_num, MORTON_BIAS_);
 	}
 }
 
@@ -499,11 +727,11 @@ int VoxelGrid<PointSourceType>::nearestVoxel(PointSourceType query_point, Eigen:
 	for (int i = lower_x; i <= upper_x; i++) {
 		for (int j = lower_y; j <= upper_y; j++) {
 			for (int k = lower_z; k <= upper_z; k++) {
-				int vid = voxelId(i, j, k, min_b_x_, min_b_y_, min_b_z_, vgrid_x_, vgrid_y_, vgrid_z_);
-				Eigen::Vector3d c = (*centroid_)[vid];
+				int vid = voxelId(i, j, k);
 
-				if ((*points_id_)[vid].size() > 0) {
-					double cur_dist = sqrt((qx - c(0)) * (qx - c(0)) + (qy - c(1)) * (qy - c(1)) + (qz - c(2)) * (qz - c(2)));
+				if (vid >= 0 && (*point_num_)[vid] > 0) {
+					const double *c = &(*centroid_)[vid * 3];
+					double cur_dist = sqrt((qx - c[0]) * (qx - c[0]) + (qy - c[1]) * (qy - c[1]) + (qz - c[2]) * (qz - c[2]));
 
 					if (cur_dist < min_dist) {
 						min_dist = cur_dist;
@@ -522,11 +750,19 @@ double VoxelGrid<PointSourceType>::nearestNeighborDistance(PointSourceType q, fl
 {
 	Eigen::Matrix<float, 6, 1> nn_node_bounds;
 
+	if (octree_.empty()) {
+		return DBL_MAX;
+	}
+
 	nn_node_bounds = octree_.nearestOctreeNode(q);
 
 	int nn_vid = nearestVoxel(q, nn_node_bounds, max_range);
 
-	Eigen::Vector3d c = (*centroid_)[nn_vid];
+	if (nn_vid < 0) {
+		return DBL_MAX;
+	}
+
+	Eigen::Vector3d c = getCentroid(nn_vid);
 	double min_dist = sqrt((q.x - c(0)) * (q.x - c(0)) + (q.y - c(1)) * (q.y - c(1)) + (q.z - c(2)) * (q.z - c(2)));
 
 	if (min_dist >= max_range) {
@@ -541,135 +777,27 @@ template <typename PointSourceType>
 void VoxelGrid<PointSourceType>::updateBoundaries(float max_x, float max_y, float max_z,
 													float min_x, float min_y, float min_z)
 {
+	/* Voxels are stored sparsely, so extending the boundaries
+	 * only updates the ranges that searches are clamped to */
+	max_x_ = (max_x_ >= max_x) ? max_x_ : max_x;
+	max_y_ = (max_y_ >= max_y) ? max_y_ : max_y;
+	max_z_ = (max_z_ >= max_z) ? max_z_ : max_z;
 
-	float new_max_x, new_max_y, new_max_z;
-	float new_min_x, new_min_y, new_min_z;
-
-	new_max_x = (max_x_ >= max_x) ? max_x_ : max_x;
-	new_max_y = (max_y_ >= max_y) ? max_y_ : max_y;
-	new_max_z = (max_z_ >= max_z) ? max_z_ : max_z;
-
-	new_min_x = (min_x_ <= min_x) ? min_x_ : min_x;
-	new_min_y = (min_y_ <= min_y) ? min_y_ : min_y;
-	new_min_z = (min_z_ <= min_z) ? min_z_ : min_z;
-
-	/* If the boundaries change, then we need to extend the list of voxels */
-	if (new_max_x > max_x_ || new_max_y > max_y_ || new_max_z > max_z_ ||
-			new_min_x < min_x_ || new_min_y < min_y_ || new_min_z < min_z_) {
-
-		int max_b_x = static_cast<int> (floor(new_max_x / voxel_x_));
-		int max_b_y = static_cast<int> (floor(new_max_y / voxel_y_));
-		int max_b_z = static_cast<int> (floor(new_max_z / voxel_z_));
-
-		int min_b_x = static_cast<int> (floor(new_min_x / voxel_x_));
-		int min_b_y = static_cast<int> (floor(new_min_y / voxel_y_));
-		int min_b_z = static_cast<int> (floor(new_min_z / voxel_z_));
-
-		int real_max_bx = max_b_x;
-		int real_max_by = max_b_y;
-		int real_max_bz = max_b_z;
-
-		int real_min_bx = min_b_x;
-		int real_min_by = min_b_y;
-		int real_min_bz = min_b_z;
-
-		/* Max bounds round toward plus infinity */
-		max_b_x = roundUp(max_b_x, MAX_BX_);
-		max_b_y = roundUp(max_b_y, MAX_BY_);
-		max_b_z = roundUp(max_b_z, MAX_BZ_);
-
-		/* Min bounds round toward minus infinity */
-		min_b_x = roundDown(min_b_x, MAX_BX_);
-		min_b_y = roundDown(min_b_y, MAX_BY_);
-		min_b_z = roundDown(min_b_z, MAX_BZ_);
-
-		if (max_b_x > max_b_x_ || max_b_y > max_b_y_ || max_b_z > max_b_z_ ||
-				min_b_x < min_b_x_ || min_b_y < min_b_y_ || min_b_z < min_b_z_) {
-			int vgrid_x = max_b_x - min_b_x + 1;
-			int vgrid_y = max_b_y - min_b_y + 1;
-			int vgrid_z = max_b_z - min_b_z + 1;
-
-			int voxel_num = vgrid_x * vgrid_y * vgrid_z;
-
-			boost::shared_ptr<std::vector<Eigen::Vector3d> > old_centroid = centroid_;
-			boost::shared_ptr<std::vector<Eigen::Matrix3d> > old_icovariance = icovariance_;
-			boost::shared_ptr<std::vector<std::vector<int> > > old_points_id = points_id_;
-			boost::shared_ptr<std::vector<int> > old_points_per_voxel = points_per_voxel_;
-
-			boost::shared_ptr<std::vector<Eigen::Vector3d> > old_tmp_centroid = tmp_centroid_;
-			boost::shared_ptr<std::vector<Eigen::Matrix3d> > old_tmp_cov = tmp_cov_;
-
-			centroid_ = boost::make_shared<std::vector<Eigen::Vector3d> >(voxel_num);
-			icovariance_ = boost::make_shared<std::vector<Eigen::Matrix3d> >(voxel_num);
-			points_id_ = boost::make_shared<std::vector<std::vector<int> > >(voxel_num);
-			points_per_voxel_ = boost::make_shared<std::vector<int> >(voxel_num, 0);
-			tmp_centroid_ = boost::make_shared<std::vector<Eigen::Vector3d> >(voxel_num);
-			tmp_cov_ = boost::make_shared<std::vector<Eigen::Matrix3d> >(voxel_num);
-
-			// Move the old non-empty voxels to the new list of voxels
-
-			int idx, idy, idz;
-			int old_id, new_id;
-
-			for (int idx = real_min_bx_; idx <= real_max_bx_; idx++) {
-				for (int idy = real_min_by_; idy <= real_max_by_; idy++) {
-					for (int idz = real_min_bz_; idz <= real_max_bz_; idz++) {
-						old_id = voxelId(idx, idy, idz,
-											min_b_x_, min_b_y_, min_b_z_,
-											vgrid_x_, vgrid_y_, vgrid_z_);
-						new_id = voxelId(idx, idy, idz,
-											min_b_x, min_b_y, min_b_z,
-											vgrid_x, vgrid_y, vgrid_z);
-
-						if ((*old_points_id)[old_id].size() > 0) {
-							(*points_per_voxel_)[new_id] = (*old_points_per_voxel)[old_id];
-							(*centroid_)[new_id] = (*old_centroid)[old_id];
-							(*icovariance_)[new_id] = (*old_icovariance)[old_id];
-							(*points_id_)[new_id] = (*old_points_id)[old_id];
-
-							(*tmp_centroid_)[new_id] = (*old_tmp_centroid)[old_id];
-							(*tmp_cov_)[new_id] = (*old_tmp_cov)[old_id];
-						}
-					}
-				}
-			}
-
-			// Update boundaries of voxels
-			max_b_x_ = max_b_x;
-			max_b_y_ = max_b_y;
-			max_b_z_ = max_b_z;
+	min_x_ = (min_x_ <= min_x) ? min_x_ : min_x;
+	min_y_ = (min_y_ <= min_y) ? min_y_ : min_y;
+	min_z_ = (min_z_ <= min_z) ? min_z_ : min_z;
 
-			min_b_x_ = min_b_x;
-			min_b_y_ = min_b_y;
-			min_b_z_ = min_b_z;
-
-			vgrid_x_ = vgrid_x;
-			vgrid_y_ = vgrid_y;
-			vgrid_z_ = vgrid_z;
-
-			voxel_num_ = voxel_num;
-
-		}
-		// Update actual voxel boundaries
-		real_min_bx_ = real_min_bx;
-		real_min_by_ = real_min_by;
-		real_min_bz_ = real_min_bz;
-
-		real_max_bx_ = real_max_bx;
-		real_max_by_ = real_max_by;
-		real_max_bz_ = real_max_bz;
-
-
-		//Update boundaries of points
-		max_x_ = new_max_x;
-		max_y_ = new_max_y;
-		max_z_ = new_max_z;
+	real_max_bx_ = max_b_x_ = static_cast<int> (floor(max_x_ / voxel_x_));
+	real_max_by_ = max_b_y_ = static_cast<int> (floor(max_y_ / voxel_y_));
+	real_max_bz_ = max_b_z_ = static_cast<int> (floor(max_z_ / voxel_z_));
 
-		min_x_ = new_min_x;
-		min_y_ = new_min_y;
-		min_z_ = new_min_z;
+	real_min_bx_ = min_b_x_ = static_cast<int> (floor(min_x_ / voxel_x_));
+	real_min_by_ = min_b_y_ = static_cast<int> (floor(min_y_ / voxel_y_));
+	real_min_bz_ = min_b_z_ = static_cast<int> (floor(min_z_ / voxel_z_));
 
-	}
+	vgrid_x_ = max_b_x_ - min_b_x_ + 1;
+	vgrid_y_ = max_b_y_ - min_b_y_ + 1;
+	vgrid_z_ = max_b_z_ - min_b_z_ + 1;
 }
 
 
@@ -686,102 +814,184 @@ void VoxelGrid<PointSourceType>::update(typename pcl::PointCloud<PointSourceType
 	// Find boundaries of the new point cloud
 	findBoundaries(new_cloud, new_max_x, new_max_y, new_max_z, new_min_x, new_min_y, new_min_z);
 
-	/* Update current boundaries of the voxel grid
-	 * Also allocate buffer for new voxel grid and
-	 * octree and move the current voxel grid and
-	 * octree to the new buffer if necessary
-	 */
+	// Update current boundaries of the voxel grid
 	updateBoundaries(new_max_x, new_max_y, new_max_z, new_min_x, new_min_y, new_min_z);
 
+	if (voxel_num_ == 0) {
+		setKeyOrigin(new_cloud);
+	}
+
 	/* Update changed voxels (voxels that contains new points).
 	 * Update centroids of voxels and their covariance matrixes
 	 * as well as inverse covariance matrixes */
 	updateVoxelContent(new_cloud);
 
 	/* Update octree */
-	std::vector<Eigen::Vector3i> new_voxel_id(new_cloud->points.size());
+	std::vector<Eigen::Vector3i> new_voxel_id;
+	typename pcl::PointCloud<PointSourceType>::Ptr octree_cloud = keyRangePoints(new_cloud, new_voxel_id);
 
-	for (int i = 0; i < new_cloud->points.size(); i++) {
-		Eigen::Vector3i &vid = new_voxel_id[i];
-		PointSourceType p = new_cloud->points[i];
-
-		vid(0) = static_cast<int>(floor(p.x / voxel_x_));
-		vid(1) = static_cast<int>(floor(p.y / voxel_y_));
-		vid(2) = static_cast<int>(floor(p.z / voxel_z_));
+	if (new_voxel_id.empty()) {
+		return;
 	}
 
-	octree_.update(new_voxel_id, new_cloud);
-
-	*source_cloud_ += *new_cloud;
+	if (octree_.empty()) {
+		octree_.setInput(new_voxel_id, octree_cloud);
+	} else {
+		octree_.update(new_voxel_id, octree_cloud);
+	}
 }
 
 template <typename PointSourceType>
-void VoxelGrid<PointSourceType>::updateVoxelContent(typename pcl::PointCloud<PointSourceType>::Ptr new_cloud)
+void VoxelGrid<PointSourceType>::remove(typename pcl::PointCloud<PointSourceType>::Ptr old_cloud)
 {
-	int total_points_num = source_cloud_->points.size();
+	if (old_cloud->points.size() <= 0 || voxel_num_ == 0) {
+		return;
+	}
 
-	for (int i = 0; i < new_cloud->points.size(); i++) {
-		PointSourceType p = new_cloud->points[i];
-		Eigen::Vector3d p3d(p.x, p.y, p.z);
-		int vx = static_cast<int>(floor(p.x / voxel_x_));
-		int vy = static_cast<int>(floor(p.y / voxel_y_));
-		int vz = static_cast<int>(floor(p.z / voxel_z_));
-		int vid = voxelId(vx, vy, vz, min_b_x_, min_b_y_, min_b_z_, vgrid_x_, vgrid_y_, vgrid_z_);
-		std::vector<int> &tmp_pid = (*points_id_)[vid];
-
-		if (tmp_pid.size() == 0) {
-			(*centroid_)[vid].setZero();
-			(*tmp_cov_)[vid].setIdentity();
-			(*tmp_centroid_)[vid].setZero();
+	std::vector<int> updated_voxels;
+
+	updated_voxels.reserve(old_cloud->points.size());
+
+	for (int i = 0; i < old_cloud->points.size(); i++) {
+		PointSourceType p = old_cloud->points[i];
+		int vid = voxelId(static_cast<int>(floor(p.x / voxel_x_)),
+							static_cast<int>(floor(p.y / voxel_y_)),
+							static_cast<int>(floor(p.z / voxel_z_)));
+
+		if (vid < 0 || (*point_num_)[vid] <= 0) {
+			continue;
 		}
 
-		(*tmp_centroid_)[vid] += p3d;
-		(*tmp_cov_)[vid] += p3d * p3d.transpose();
-		(*points_id_)[vid].push_back(total_points_num + i);
+		double *s = &(*point_sum_)[vid * 3];
+		double *m = &(*point_moment_)[vid * 6];
+		double x = p.x, y = p.y, z = p.z;
 
-		// Update centroids
-		int ipoint_num = (*points_id_)[vid].size();
-		(*centroid_)[vid] = (*tmp_centroid_)[vid] / static_cast<double>(ipoint_num);
-		(*points_per_voxel_)[vid] = ipoint_num;
+		s[0] -= x;
+		s[1] -= y;
+		s[2] -= z;
 
+		m[0] -= x * x;
+		m[1] -= x * y;
+		m[2] -= x * z;
+		m[3] -= y * y;
+		m[4] -= y * z;
+		m[5] -= z * z;
 
-		// Update covariance
-		double point_num = static_cast<double>(ipoint_num);
-		Eigen::Vector3d pt_sum = (*tmp_centroid_)[vid];
+		(*point_num_)[vid]--;
+		updated_voxels.push_back(vid);
+	}
 
-		// Update  centroids
-		(*centroid_)[vid] = (*tmp_centroid_)[vid] / point_num;
+	std::sort(updated_voxels.begin(), updated_voxels.end());
+	updated_voxels.erase(std::unique(updated_voxels.begin(), updated_voxels.end()), updated_voxels.end());
 
-		if (ipoint_num >= min_points_per_voxel_) {
-			Eigen::Matrix3d covariance;
-			covariance = ((*tmp_cov_)[vid] - 2.0 * (pt_sum * (*centroid_)[vid].transpose())) / point_num + (*centroid_)[vid] * (*centroid_)[vid].transpose();
-			covariance *= (point_num - 1.0) / point_num;
+	int empty_num = 0;
 
-			SymmetricEigensolver3x3 sv(covariance);
+	for (int i = 0; i < updated_voxels.size(); i++) {
+		int vid = updated_voxels[i];
 
-			sv.compute();
-			Eigen::Matrix3d evecs = sv.eigenvectors();
-			Eigen::Matrix3d evals = sv.eigenvalues().asDiagonal();
+		if ((*point_num_)[vid] == 0) {
+			/* Reset the accumulators of emptied voxels to their initial
+			 * values, so rounding errors of the subtractions do not
+			 * leak into points added to the voxel later */
+			double *s = &(*point_sum_)[vid * 3];
+			double *m = &(*point_moment_)[vid * 6];
 
-			if (evals(0, 0) < 0 || evals(1, 1) < 0 || evals(2, 2) <= 0) {
-				(*points_per_voxel_)[vid] = -1;
-				continue;
-			}
+			s[0] = s[1] = s[2] = 0;
+			m[0] = m[3] = m[5] = 1;
+			m[1] = m[2] = m[4] = 0;
+		}
 
-			double min_cov_eigvalue = evals(2, 2) * 0.01;
+		computeCentroidAndCovariance(vid);
+	}
 
-			if (evals(0, 0) < min_cov_eigvalue) {
-				evals(0, 0) = min_cov_eigvalue;
+	for (int vid = 0; vid < voxel_num_; vid++) {
+		empty_num += ((*point_num_)[vid] == 0) ? 1 : 0;
+	}
 
-				if (evals(1, 1) < min_cov_eigvalue) {
-					evals(1, 1) = min_cov_eigvalue;
-				}
+	// Reclaim slots of emptied voxels once they are a significant part of the store
+	if (empty_num * 4 > voxel_num_) {
+		sortVoxelsByKey();
+	}
 
-				covariance = evecs * evals * evecs.inverse();
-			}
+	/* The octree only supports insertions, so rebuild it from the remaining
+	 * voxels, using their centroids as representative points */
+	std::vector<Eigen::Vector3i> voxel_ids;
+	typename pcl::PointCloud<PointSourceType>::Ptr centroids(new pcl::PointCloud<PointSourceType>());
 
-			(*icovariance_)[vid] = covariance.inverse();
+	voxel_ids.reserve(voxel_num_);
+	centroids->points.reserve(voxel_num_);
+
+	for (int vid = 0; vid < voxel_num_; vid++) {
+		if ((*point_num_)[vid] > 0) {
+			const double *c = &(*centroid_)[vid * 3];
+			PointSourceType p;
+
+			p.x = c[0];
+			p.y = c[1];
+			p.z = c[2];
+
+			voxel_ids.push_back(voxelIndex((*voxel_key_)[vid]));
+			centroids->points.push_back(p);
+		}
+	}
+
+	if (voxel_ids.size() > 0) {
+		octree_.setInput(voxel_ids, centroids);
+	} else {
+		// Every voxel was removed, the next update rebuilds the octree from its points
+		octree_.clear();
+	}
+}
+
+template <typename PointSourceType>
+void VoxelGrid<PointSourceType>::updateVoxelContent(typename pcl::PointCloud<PointSourceType>::Ptr new_cloud)
+{
+	std::vector<int> updated_voxels;
+
+	updated_voxels.reserve(new_cloud->points.size());
+
+	int rejected_num = 0;
+
+	for (int i = 0; i < new_cloud->points.size(); i++) {
+		PointSourceType p = new_cloud->points[i];
+		int vid = insertVoxel(static_cast<int>(floor(p.x / voxel_x_)),
+								static_cast<int>(floor(p.y / voxel_y_)),
+								static_cast<int>(floor(p.z / voxel_z_)));
+
+		if (vid < 0) {
+			rejected_num++;
+			continue;
 		}
+
+		double *s = &(*point_sum_)[vid * 3];
+		double *m = &(*point_moment_)[vid * 6];
+		double x = p.x, y = p.y, z = p.z;
+
+		s[0] += x;
+		s[1] += y;
+		s[2] += z;
+
+		m[0] += x * x;
+		m[1] += x * y;
+		m[2] += x * z;
+		m[3] += y * y;
+		m[4] += y * z;
+		m[5] += z * z;
+
+		(*point_num_)[vid]++;
+		updated_voxels.push_back(vid);
+	}
+
+	if (rejected_num > 0) {
+		printf("VoxelGrid: %d points are more than %d voxels away from the grid origin and are ignored\n", rejected_num, MORTON_BIAS_);
+	}
+
+	// Recompute each changed voxel once, after all of its new points were added
+	std::sort(updated_voxels.begin(), updated_voxels.end());
+	updated_voxels.erase(std::unique(updated_voxels.begin(), updated_voxels.end()), updated_voxels.end());
+
+	for (int i = 0; i < updated_voxels.size(); i++) {
+		computeCentroidAndCovariance(updated_voxels[i]);
 	}
 }
 
@@ -0,0 +1,321 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+
+#include <pcl/common/transforms.h>
+
+#include "ndt_cpu/NormalDistributionsTransform.h"
+#include "ndt_cpu/VoxelGrid.h"
+
+typedef cpu::NormalDistributionsTransform<pcl::PointXYZ, pcl::PointXYZ> NDT;
+
+// Exposes computeDerivatives at a fixed pose
+class DerivativesNDT : public NDT
+{
+public:
+  double derivatives(const Eigen::Matrix4f& pose, Eigen::Matrix<double, 6, 1>& score_gradient,
+                     Eigen::Matrix<double, 6, 6>& hessian)
+  {
+    pcl::PointCloud<pcl::PointXYZ> trans_cloud;
+    pcl::transformPointCloud(*source_cloud_, trans_cloud, pose);
+
+    Eigen::Transform<float, 3, Eigen::Affine, Eigen::ColMajor> transformation(pose);
+    Eigen::Vector3f translation = transformation.translation();
+    Eigen::Vector3f rotation = transformation.rotation().eulerAngles(0, 1, 2);
+    Eigen::Matrix<double, 6, 1> p;
+    p << translation(0), translation(1), translation(2), rotation(0), rotation(1), rotation(2);
+
+    return computeDerivatives(score_gradient, hessian, trans_cloud, p);
+  }
+};
+
+class TestSuite : public ::testing::Test
+{
+protected:
+  void SetUp()
+  {
+    srand(0);
+
+    map_.reset(new pcl::PointCloud<pcl::PointXYZ>);
+    scan_.reset(new pcl::PointCloud<pcl::PointXYZ>);
+
+    // A ground plane with two walls, so that every axis is constrained
+    for (int i = 0; i < 40000; i++)
+    {
+      float u = uniform(-20, 20);
+      float v = uniform(-20, 20);
+      float n = uniform(-0.05, 0.05);
+
+      map_->push_back(pcl::PointXYZ(u, v, 0.2 * std::sin(u) + n));
+      map_->push_back(pcl::PointXYZ(u, 15 + n, std::fabs(v) / 4));
+      map_->push_back(pcl::PointXYZ(12 + n, u, std::fabs(v) / 4));
+    }
+
+    for (int i = 0; i < map_->points.size(); i += 13)
+    {
+      scan_->push_back(map_->points[i]);
+    }
+
+    guess_ = Eigen::Matrix4f::Identity();
+    guess_(0, 3) = 0.4;
+    guess_(1, 3) = -0.3;
+  }
+
+  float uniform(float min, float max)
+  {
+    return min + (max - min) * static_cast<float>(rand()) / RAND_MAX;
+  }
+
+  void align(NDT& ndt)
+  {
+    ndt.setResolution(1.0);
+    ndt.setStepSize(0.1);
+    ndt.setTransformationEpsilon(0.01);
+    ndt.setMaximumIterations(30);
+    ndt.setInputTarget(map_);
+    ndt.setInputSource(scan_);
+    ndt.align(guess_);
+  }
+
+  pcl::PointCloud<pcl::PointXYZ>::Ptr map_, scan_;
+  Eigen::Matrix4f guess_;
+};
+
+TEST_F(TestSuite, BatchDoubleMatchesScalar)
+{
+  NDT scalar_ndt, batch_ndt;
+
+  batch_ndt.setDerivativeBackend(NDT::BATCH_DOUBLE);
+
+  align(scalar_ndt);
+  align(batch_ndt);
+
+  ASSERT_TRUE(scalar_ndt.hasConverged());
+  ASSERT_TRUE(batch_ndt.hasConverged());
+  ASSERT_EQ(scalar_ndt.getFinalNumIteration(), batch_ndt.getFinalNumIteration());
+  ASSERT_NEAR(scalar_ndt.getTransformationProbability(), batch_ndt.getTransformationProbability(), 1e-9);
+
+  Eigen::Matrix4f scalar_t = scalar_ndt.getFinalTransformation();
+  Eigen::Matrix4f batch_t = batch_ndt.getFinalTransformation();
+
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      ASSERT_NEAR(scalar_t(i, j), batch_t(i, j), 1e-6);
+}
+
+TEST_F(TestSuite, BatchFloatMatchesScalar)
+{
+  NDT scalar_ndt, batch_ndt;
+
+  batch_ndt.setDerivativeBackend(NDT::BATCH_FLOAT);
+
+  align(scalar_ndt);
+  align(batch_ndt);
+
+  ASSERT_TRUE(batch_ndt.hasConverged());
+  ASSERT_NEAR(scalar_ndt.getTransformationProbability(), batch_ndt.getTransformationProbability(), 1e-3);
+
+  Eigen::Matrix4f scalar_t = scalar_ndt.getFinalTransformation();
+  Eigen::Matrix4f batch_t = batch_ndt.getFinalTransformation();
+
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      ASSERT_NEAR(scalar_t(i, j), batch_t(i, j), 1e-3);
+}
+
+TEST_F(TestSuite, RemovedPointsMatchRebuild)
+{
+  NDT rebuilt_ndt, updated_ndt;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr extra(new pcl::PointCloud<pcl::PointXYZ>);
+
+  // Points overlapping the map and points far from it
+  for (int i = 0; i < map_->points.size(); i += 3)
+  {
+    pcl::PointXYZ p = map_->points[i];
+    extra->push_back(pcl::PointXYZ(p.y, p.x, p.z + 0.5));
+    extra->push_back(pcl::PointXYZ(p.x + 100, p.y, p.z));
+  }
+
+  align(rebuilt_ndt);
+
+  updated_ndt.setResolution(1.0);
+  updated_ndt.setStepSize(0.1);
+  updated_ndt.setTransformationEpsilon(0.01);
+  updated_ndt.setMaximumIterations(30);
+  updated_ndt.setInputTarget(map_);
+  updated_ndt.updateVoxelGrid(extra);
+  updated_ndt.removeFromVoxelGrid(extra);
+  updated_ndt.setInputSource(scan_);
+  updated_ndt.align(guess_);
+
+  ASSERT_EQ(rebuilt_ndt.getFinalNumIteration(), updated_ndt.getFinalNumIteration());
+  ASSERT_NEAR(rebuilt_ndt.getTransformationProbability(), updated_ndt.getTransformationProbability(), 1e-6);
+
+  Eigen::Matrix4f rebuilt_t = rebuilt_ndt.getFinalTransformation();
+  Eigen::Matrix4f updated_t = updated_ndt.getFinalTransformation();
+
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      ASSERT_NEAR(rebuilt_t(i, j), updated_t(i, j), 1e-5);
+}
+
+TEST_F(TestSuite, RemovingAllPointsClearsOctree)
+{
+  NDT rebuilt_ndt, updated_ndt;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr moved_map(new pcl::PointCloud<pcl::PointXYZ>);
+  pcl::PointCloud<pcl::PointXYZ>::Ptr moved_scan(new pcl::PointCloud<pcl::PointXYZ>);
+
+  for (const auto& p : map_->points)
+    moved_map->push_back(pcl::PointXYZ(p.x + 100, p.y, p.z));
+  for (const auto& p : scan_->points)
+    moved_scan->push_back(pcl::PointXYZ(p.x + 100, p.y, p.z));
+
+  rebuilt_ndt.setResolution(1.0);
+  rebuilt_ndt.setInputTarget(moved_map);
+  rebuilt_ndt.setInputSource(moved_scan);
+  rebuilt_ndt.align(guess_);
+
+  updated_ndt.setResolution(1.0);
+  updated_ndt.setInputTarget(map_);
+  updated_ndt.removeFromVoxelGrid(map_);
+  updated_ndt.setInputSource(moved_scan);
+  ASSERT_EQ(DBL_MAX, updated_ndt.getFitnessScore());
+
+  updated_ndt.updateVoxelGrid(moved_map);
+  updated_ndt.align(guess_);
+
+  ASSERT_EQ(rebuilt_ndt.getFinalNumIteration(), updated_ndt.getFinalNumIteration());
+  ASSERT_NEAR(rebuilt_ndt.getFitnessScore(), updated_ndt.getFitnessScore(), 1e-6);
+
+  // Nothing of the removed map is left for the nearest neighbor search
+  rebuilt_ndt.setInputSource(scan_);
+  updated_ndt.setInputSource(scan_);
+  ASSERT_NEAR(rebuilt_ndt.getFitnessScore(), updated_ndt.getFitnessScore(), 1e-6);
+}
+
+TEST_F(TestSuite, ThreadedDerivativesMatchSingleThread)
+{
+  const NDT::DerivativeBackend backends[] = { NDT::SCALAR, NDT::BATCH_DOUBLE, NDT::BATCH_FLOAT };
+
+  Eigen::Matrix4f pose = guess_;
+  pose.topLeftCorner<3, 3>() = Eigen::AngleAxisf(0.05, Eigen::Vector3f::UnitZ()).toRotationMatrix();
+
+  for (NDT::DerivativeBackend backend : backends)
+  {
+    DerivativesNDT ndt;
+    ndt.setResolution(1.0);
+    ndt.setDerivativeBackend(backend);
+    ndt.setInputTarget(map_);
+    ndt.setInputSource(scan_);
+
+    Eigen::Matrix<double, 6, 1> single_gradient;
+    Eigen::Matrix<double, 6, 6> single_hessian;
+    ndt.setNumThreads(1);
+    double single_score = ndt.derivatives(pose, single_gradient, single_hessian);
+    ASSERT_NE(0, single_score);
+
+    Eigen::Matrix<double, 6, 1> first_gradient;
+    Eigen::Matrix<double, 6, 6> first_hessian;
+    ndt.setNumThreads(4);
+    double first_score = ndt.derivatives(pose, first_gradient, first_hessian);
+
+    // The sums are only reordered between 1 and 4 threads, BATCH_FLOAT accumulates in single precision
+    const double relative_tolerance = (backend == NDT::BATCH_FLOAT) ? 1e-5 : 1e-9;
+    ASSERT_NEAR(single_score, first_score, relative_tolerance * std::fabs(single_score)) << backend;
+    for (int i = 0; i < 6; i++)
+    {
+      ASSERT_NEAR(single_gradient(i), first_gradient(i), relative_tolerance * single_gradient.norm()) << backend;
+      for (int j = 0; j < 6; j++)
+        ASSERT_NEAR(single_hessian(i, j), first_hessian(i, j), relative_tolerance * single_hessian.norm()) << backend;
+    }
+
+    // and the threaded results are the same from run to run, whatever the number of threads
+    for (int threads_num : { 4, 4, 2, 3 })
+    {
+      Eigen::Matrix<double, 6, 1> gradient;
+      Eigen::Matrix<double, 6, 6> hessian;
+      ndt.setNumThreads(threads_num);
+      ASSERT_EQ(first_score, ndt.derivatives(pose, gradient, hessian)) << backend;
+      ASSERT_EQ(first_gradient, gradient) << backend;
+      ASSERT_EQ(first_hessian, hessian) << backend;
+    }
+  }
+}
+
+TEST_F(TestSuite, VoxelGridKeepsLargeCoordinates)
+{
+  cpu::VoxelGrid<pcl::PointXYZ> grid;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
+
+  // Two voxels at UTM scale, more than 2^20 voxels away from 0. The mean of each voxel is not a float.
+  for (int i = 0; i < 8; i++)
+  {
+    cloud->push_back(pcl::PointXYZ(3000000 + 0.25 * (i % 2), 4000000 + 0.25 * (i % 2), 0.5 * (i % 2)));
+    cloud->push_back(pcl::PointXYZ(2999990 + 0.25 * (i % 2), 4000000, 0));
+  }
+  // and a point farther than 2^20 voxels from them
+  cloud->push_back(pcl::PointXYZ(3000000 + 4194304, 4000000, 0));
+
+  grid.setLeafSize(1.0, 1.0, 1.0);
+  grid.setInput(cloud);
+  ASSERT_EQ(2, grid.getVoxelNum());
+
+  std::vector<int> voxel_ids;
+  grid.radiusSearch(pcl::PointXYZ(3000000, 4000000, 0), 1.0, voxel_ids);
+  ASSERT_EQ(1, voxel_ids.size());
+  Eigen::Vector3d centroid = grid.getCentroid(voxel_ids[0]);
+  ASSERT_EQ(3000000.125, centroid(0));
+  ASSERT_EQ(4000000.125, centroid(1));
+  ASSERT_EQ(0.25, centroid(2));
+
+  voxel_ids.clear();
+  grid.radiusSearch(pcl::PointXYZ(2999990, 4000000, 0), 1.0, voxel_ids);
+  ASSERT_EQ(1, voxel_ids.size());
+  ASSERT_EQ(2999990.125, grid.getCentroid(voxel_ids[0])(0));
+
+  voxel_ids.clear();
+  grid.radiusSearch(cloud->points.back(), 1.0, voxel_ids);
+  ASSERT_TRUE(voxel_ids.empty());
+
+  // Points added later out of the key range are ignored as well
+  pcl::PointCloud<pcl::PointXYZ>::Ptr near_zero(new pcl::PointCloud<pcl::PointXYZ>);
+  for (int i = 0; i < 8; i++)
+    near_zero->push_back(pcl::PointXYZ(0.25 * i, 0, 0));
+  grid.update(near_zero);
+  ASSERT_EQ(2, grid.getVoxelNum());
+}
+
+TEST_F(TestSuite, NearestNeighborOnSparseMap)
+{
+  cpu::VoxelGrid<pcl::PointXYZ> grid;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
+
+  // Two voxels 20 km apart, the octree must not cover the box between them
+  for (int i = 0; i < 4; i++)
+  {
+    cloud->push_back(pcl::PointXYZ(0.25 + 0.5 * (i % 2), 0.5, 0.5));
+    cloud->push_back(pcl::PointXYZ(20000.25 + 0.5 * (i % 2), 20000.5, 30.5));
+  }
+
+  grid.setLeafSize(1.0, 1.0, 1.0);
+  grid.setInput(cloud);
+  ASSERT_EQ(2, grid.getVoxelNum());
+
+  ASSERT_NEAR(3.0, grid.nearestNeighborDistance(pcl::PointXYZ(3.5, 0.5, 0.5), 100), 1e-9);
+  ASSERT_NEAR(4.0, grid.nearestNeighborDistance(pcl::PointXYZ(20000.5, 20004.5, 30.5), 100), 1e-9);
+  ASSERT_EQ(DBL_MAX, grid.nearestNeighborDistance(pcl::PointXYZ(10000, 10000, 0), 100));
+
+  // Points added later get their own leaves
+  pcl::PointCloud<pcl::PointXYZ>::Ptr far_cloud(new pcl::PointCloud<pcl::PointXYZ>);
+  far_cloud->push_back(pcl::PointXYZ(-20000.5, 20000.5, 0.5));
+  grid.update(far_cloud);
+  ASSERT_NEAR(2.0, grid.nearestNeighborDistance(pcl::PointXYZ(-20000.5, 20002.5, 0.5), 100), 1e-9);
+  ASSERT_NEAR(3.0, grid.nearestNeighborDistance(pcl::PointXYZ(3.5, 0.5, 0.5), 100), 1e-9);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
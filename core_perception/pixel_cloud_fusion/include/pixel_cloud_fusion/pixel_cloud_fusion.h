@@ -70,6 +70,8 @@ namespace std {
 
 class ROSPixelCloudFusionApp
 {
+	friend class PixelCloudFusionTestSuite;
+
 	ros::NodeHandle                     node_handle_;
 	ros::Publisher                      publisher_fused_cloud_;
 	ros::Subscriber                     intrinsics_subscriber_;
@@ -91,6 +93,17 @@ class ROSPixelCloudFusionApp
 	float                               fx_, fy_, cx_, cy_;
 	pcl::PointCloud<pcl::PointXYZRGB>   colored_cloud_;
 
+	// fusion_mode z_buffer: the raw image is kept as is, and only the pixels of the projected points are read,
+	// through a lookup table built once from the CameraInfo
+	std::string                         fusion_mode_;
+	cv_bridge::CvImageConstPtr          raw_frame_;
+	std::vector<int>                    undistort_lut_;  // undistorted pixel -> raw pixel, -1 outside the raw image
+	cv::Size                            undistort_lut_size_;
+	std::vector<int>                    depth_index_;    // pixel -> nearest projected point, -1 if none
+	std::vector<int>                    point_pixel_;    // point -> pixel it projects to, -1 if none
+	std::vector<float>                  point_depth_;
+	pcl::PointCloud<pcl::PointXYZ>      in_cloud_;
+
 	typedef
 	message_filters::sync_policies::ApproximateTime<sensor_msgs::PointCloud2, sensor_msgs::Image> SyncPolicyT;
 
@@ -104,6 +117,27 @@ class ROSPixelCloudFusionApp
 
 	void CloudCallback(const sensor_msgs::PointCloud2::ConstPtr &in_cloud_msg);
 
+	/*!
+	 * Colors the first point inserted for each pixel, looking up every pixel of the undistorted image
+	 * @param in_cloud points in the lidar frame
+	 * @param out_cloud colored points, in pixel order
+	 */
+	void FuseHashMap(const pcl::PointCloud<pcl::PointXYZ> &in_cloud, pcl::PointCloud<pcl::PointXYZRGB> &out_cloud);
+
+	/*!
+	 * Colors the nearest point of each pixel, using a z-buffer of point indices
+	 * @param in_cloud points in the lidar frame
+	 * @param out_cloud colored points, in point order
+	 */
+	void FuseZBuffer(const pcl::PointCloud<pcl::PointXYZ> &in_cloud, pcl::PointCloud<pcl::PointXYZRGB> &out_cloud);
+
+	/*!
+	 * Computes for each pixel of the undistorted image the pixel of the raw image it is read from,
+	 * as cv::undistort does with nearest interpolation
+	 * @param in_size size of the images
+	 */
+	void BuildUndistortLut(const cv::Size &in_size);
+
 	/*!
 	 * Obtains Transformation between two transforms registered in the TF Tree
 	 * @param in_target_frame
@@ -41,6 +41,22 @@ void ROSPixelCloudFusionApp::ImageCallback(const sensor_msgs::Image::ConstPtr &i
 	if (processing_)
 		return;
 
+	if (fusion_mode_ == "z_buffer")
+	{
+		// No undistortion here, FuseZBuffer reads the raw pixels through the lookup table
+		raw_frame_ = cv_bridge::toCvShare(in_image_msg, "bgr8");
+		current_frame_ = raw_frame_->image;
+		if (!current_frame_.isContinuous())
+			current_frame_ = current_frame_.clone();
+		if (undistort_lut_size_ != current_frame_.size())
+			BuildUndistortLut(current_frame_.size());
+
+		image_frame_id_ = in_image_msg->header.frame_id;
+		image_size_.height = current_frame_.rows;
+		image_size_.width = current_frame_.cols;
+		return;
+	}
+
 	cv_bridge::CvImagePtr cv_image = cv_bridge::toCvCopy(in_image_msg, "bgr8");
 	cv::Mat in_image = cv_image->image;
 
@@ -70,15 +86,29 @@ void ROSPixelCloudFusionApp::CloudCallback(const sensor_msgs::PointCloud2::Const
 		return;
 	}
 
-	pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud(new pcl::PointCloud<pcl::PointXYZ>);
+	pcl::fromROSMsg(*in_cloud_msg, in_cloud_);
 	pcl::PointCloud<pcl::PointXYZRGB>::Ptr out_cloud(new pcl::PointCloud<pcl::PointXYZRGB>);
-	pcl::fromROSMsg(*in_cloud_msg, *in_cloud);
+	if (fusion_mode_ == "z_buffer")
+		FuseZBuffer(in_cloud_, *out_cloud);
+	else
+		FuseHashMap(in_cloud_, *out_cloud);
+
+	// Publish PC
+	sensor_msgs::PointCloud2 cloud_msg;
+	pcl::toROSMsg(*out_cloud, cloud_msg);
+	cloud_msg.header = in_cloud_msg->header;
+	publisher_fused_cloud_.publish(cloud_msg);
+}
+
+void ROSPixelCloudFusionApp::FuseHashMap(const pcl::PointCloud<pcl::PointXYZ> &in_cloud,
+                                         pcl::PointCloud<pcl::PointXYZRGB> &out_cloud)
+{
 	std::unordered_map<cv::Point, pcl::PointXYZ> projection_map;
 
-	std::vector<pcl::PointXYZ> cam_cloud(in_cloud->points.size());
-	for (size_t i = 0; i < in_cloud->points.size(); i++)
+	std::vector<pcl::PointXYZ> cam_cloud(in_cloud.points.size());
+	for (size_t i = 0; i < in_cloud.points.size(); i++)
 	{
-		cam_cloud[i] = TransformPoint(in_cloud->points[i], camera_lidar_tf_);
+		cam_cloud[i] = TransformPoint(in_cloud.points[i], camera_lidar_tf_);
 		int u = int(cam_cloud[i].x * fx_ / cam_cloud[i].z + cx_);
 		int v = int(cam_cloud[i].y * fy_ / cam_cloud[i].z + cy_);
 		if ((u >= 0) && (u < image_size_.width)
@@ -86,11 +116,11 @@ void ROSPixelCloudFusionApp::CloudCallback(const sensor_msgs::PointCloud2::Const
 			&& cam_cloud[i].z > 0
 				)
 		{
-			projection_map.insert(std::pair<cv::Point, pcl::PointXYZ>(cv::Point(u, v), in_cloud->points[i]));
+			projection_map.insert(std::pair<cv::Point, pcl::PointXYZ>(cv::Point(u, v), in_cloud.points[i]));
 		}
 	}
 
-	out_cloud->points.clear();
+	out_cloud.points.clear();
 
 #pragma omp for
 	for (int row = 0; row < image_size_.height; row++)
@@ -111,15 +141,105 @@ void ROSPixelCloudFusionApp::CloudCallback(const sensor_msgs::PointCloud2::Const
 				colored_3d_point.r = rgb_pixel[2];
 				colored_3d_point.g = rgb_pixel[1];
 				colored_3d_point.b = rgb_pixel[0];
-				out_cloud->points.push_back(colored_3d_point);
+				out_cloud.points.push_back(colored_3d_point);
 			}
 		}
 	}
-	// Publish PC
-	sensor_msgs::PointCloud2 cloud_msg;
-	pcl::toROSMsg(*out_cloud, cloud_msg);
-	cloud_msg.header = in_cloud_msg->header;
-	publisher_fused_cloud_.publish(cloud_msg);
+}
+
+void ROSPixelCloudFusionApp::FuseZBuffer(const pcl::PointCloud<pcl::PointXYZ> &in_cloud,
+                                         pcl::PointCloud<pcl::PointXYZRGB> &out_cloud)
+{
+	const int width = image_size_.width;
+	const int height = image_size_.height;
+	if (depth_index_.size() != static_cast<size_t>(width * height))
+		depth_index_.assign(width * height, -1);
+
+	const size_t points_num = in_cloud.points.size();
+	point_pixel_.resize(points_num);
+	point_depth_.resize(points_num);
+
+	const tf::Matrix3x3 &basis = camera_lidar_tf_.getBasis();
+	const tf::Vector3 &origin = camera_lidar_tf_.getOrigin();
+	Eigen::Matrix3f rotation;
+	for (int row = 0; row < 3; row++)
+		for (int col = 0; col < 3; col++)
+			rotation(row, col) = basis[row][col];
+	const Eigen::Vector3f translation(origin.x(), origin.y(), origin.z());
+
+	// Project the points, each pixel keeps the nearest one
+	for (size_t i = 0; i < points_num; i++)
+	{
+		point_pixel_[i] = -1;
+		const Eigen::Vector3f cam_point = rotation * in_cloud.points[i].getVector3fMap() + translation;
+		if (!(cam_point.z() > 0))
+			continue;
+		int u = int(cam_point.x() * fx_ / cam_point.z() + cx_);
+		int v = int(cam_point.y() * fy_ / cam_point.z() + cy_);
+		if ((u < 0) || (u >= width) || (v < 0) || (v >= height))
+			continue;
+
+		const int pixel = v * width + u;
+		point_pixel_[i] = pixel;
+		point_depth_[i] = cam_point.z();
+		int &nearest = depth_index_[pixel];
+		if (nearest < 0 || cam_point.z() < point_depth_[nearest])
+			nearest = i;
+	}
+
+	// Color the visible points only, then clear the pixels they used
+	out_cloud.points.clear();
+	out_cloud.points.reserve(points_num);
+	const cv::Vec3b *raw_pixels = current_frame_.ptr<cv::Vec3b>();
+	for (size_t i = 0; i < points_num; i++)
+	{
+		const int pixel = point_pixel_[i];
+		if (pixel < 0 || depth_index_[pixel] != static_cast<int>(i))
+			continue;
+		const int raw_pixel = undistort_lut_[pixel];
+		const cv::Vec3b rgb_pixel = raw_pixel >= 0 ? raw_pixels[raw_pixel] : cv::Vec3b(0, 0, 0);
+		pcl::PointXYZRGB colored_3d_point;
+		colored_3d_point.x = in_cloud.points[i].x;
+		colored_3d_point.y = in_cloud.points[i].y;
+		colored_3d_point.z = in_cloud.points[i].z;
+		colored_3d_point.r = rgb_pixel[2];
+		colored_3d_point.g = rgb_pixel[1];
+		colored_3d_point.b = rgb_pixel[0];
+		out_cloud.points.push_back(colored_3d_point);
+	}
+	for (size_t i = 0; i < points_num; i++)
+	{
+		if (point_pixel_[i] >= 0)
+			depth_index_[point_pixel_[i]] = -1;
+	}
+	out_cloud.width = out_cloud.points.size();
+	out_cloud.height = 1;
+}
+
+void ROSPixelCloudFusionApp::BuildUndistortLut(const cv::Size &in_size)
+{
+	cv::Mat map_x, map_y;
+	cv::initUndistortRectifyMap(camera_instrinsics_, distortion_coefficients_, cv::Mat(), camera_instrinsics_,
+	                            in_size, CV_32FC1, map_x, map_y);
+
+	undistort_lut_.resize(in_size.width * in_size.height);
+	for (int row = 0; row < in_size.height; row++)
+	{
+		const float *row_x = map_x.ptr<float>(row);
+		const float *row_y = map_y.ptr<float>(row);
+		for (int col = 0; col < in_size.width; col++)
+		{
+			const int raw_col = cvRound(row_x[col]);
+			const int raw_row = cvRound(row_y[col]);
+			int &raw_pixel = undistort_lut_[row * in_size.width + col];
+			if (raw_col < 0 || raw_col >= in_size.width || raw_row < 0 || raw_row >= in_size.height)
+				raw_pixel = -1;
+			else
+				raw_pixel = raw_row * in_size.width + raw_col;
+		}
+	}
+	undistort_lut_size_ = in_size;
+	ROS_INFO("[%s] Undistortion lookup table built for %dx%d images.", __APP_NAME__, in_size.width, in_size.height);
 }
 
 void ROSPixelCloudFusionApp::IntrinsicsCallback(const sensor_msgs::CameraInfo &in_message)
@@ -147,6 +267,9 @@ void ROSPixelCloudFusionApp::IntrinsicsCallback(const sensor_msgs::CameraInfo &i
 	cx_ = static_cast<float>(in_message.P[2]);
 	cy_ = static_cast<float>(in_message.P[6]);
 
+	if (fusion_mode_ == "z_buffer" && image_size_.area() > 0)
+		BuildUndistortLut(image_size_);
+
 	intrinsics_subscriber_.shutdown();
 	camera_info_ok_ = true;
 	ROS_INFO("[%s] CameraIntrinsics obtained.", __APP_NAME__);
@@ -188,6 +311,9 @@ void ROSPixelCloudFusionApp::InitializeROSIo(ros::NodeHandle &in_private_handle)
 	in_private_handle.param<std::string>("camera_info_src", camera_info_src, "/camera_info");
 	ROS_INFO("[%s] camera_info_src: %s", __APP_NAME__, camera_info_src.c_str());
 
+	in_private_handle.param<std::string>("fusion_mode", fusion_mode_, "hash_map");
+	ROS_INFO("[%s] fusion_mode: %s", __APP_NAME__, fusion_mode_.c_str());
+
 	if (name_space_str != "/")
 	{
 		if (name_space_str.substr(0, 2) == "//")
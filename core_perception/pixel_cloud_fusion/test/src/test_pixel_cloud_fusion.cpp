@@ -0,0 +1,215 @@
+/*
+ * Copyright 2018-2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <ros/ros.h>
+
+#include "pixel_cloud_fusion/pixel_cloud_fusion.h"
+
+class PixelCloudFusionTestSuite : public ::testing::Test
+{
+protected:
+	static const int WIDTH = 64;
+	static const int HEIGHT = 48;
+	static constexpr double FOCAL = 50.0;
+
+	void SetUp() override
+	{
+		sensor_msgs::CameraInfo info;
+		info.width = WIDTH;
+		info.height = HEIGHT;
+		info.D.assign(5, 0.0);
+		info.K = {FOCAL, 0, WIDTH / 2, 0, FOCAL, HEIGHT / 2, 0, 0, 1};
+		info.P = {FOCAL, 0, WIDTH / 2, 0, 0, FOCAL, HEIGHT / 2, 0, 0, 0, 1, 0};
+		app_.IntrinsicsCallback(info);
+
+		// camera looking along the lidar x axis, slightly offset
+		tf::Transform lidar_to_camera(tf::Matrix3x3(0, -1, 0, 0, 0, -1, 1, 0, 0), tf::Vector3(0.1, -0.2, 0.05));
+		app_.camera_lidar_tf_ = tf::StampedTransform(lidar_to_camera, ros::Time(0), "camera", "lidar");
+		app_.camera_lidar_tf_ok_ = true;
+
+		raw_image_ = cv::Mat(HEIGHT, WIDTH, CV_8UC3);
+		cv::randu(raw_image_, cv::Scalar::all(0), cv::Scalar::all(256));
+	}
+
+	// A point in the lidar frame that projects to the center of the pixel, at the given depth
+	pcl::PointXYZ PointAtPixel(double u, double v, double depth)
+	{
+		tf::Vector3 cam_point((u + 0.5 - WIDTH / 2) * depth / FOCAL, (v + 0.5 - HEIGHT / 2) * depth / FOCAL, depth);
+		tf::Vector3 lidar_point = app_.camera_lidar_tf_.inverse() * cam_point;
+		return pcl::PointXYZ(lidar_point.x(), lidar_point.y(), lidar_point.z());
+	}
+
+	pcl::PointCloud<pcl::PointXYZRGB> FuseHashMap(const pcl::PointCloud<pcl::PointXYZ> &in_cloud)
+	{
+		// as ImageCallback prepares the image in hash_map mode
+		app_.fusion_mode_ = "hash_map";
+		cv::undistort(raw_image_, app_.current_frame_, app_.camera_instrinsics_, app_.distortion_coefficients_);
+		pcl::PointCloud<pcl::PointXYZRGB> out_cloud;
+		app_.FuseHashMap(in_cloud, out_cloud);
+		return out_cloud;
+	}
+
+	pcl::PointCloud<pcl::PointXYZRGB> FuseZBuffer(const pcl::PointCloud<pcl::PointXYZ> &in_cloud)
+	{
+		// as ImageCallback prepares the image in z_buffer mode
+		app_.fusion_mode_ = "z_buffer";
+		app_.current_frame_ = raw_image_;
+		app_.BuildUndistortLut(raw_image_.size());
+		pcl::PointCloud<pcl::PointXYZRGB> out_cloud;
+		app_.FuseZBuffer(in_cloud, out_cloud);
+		return out_cloud;
+	}
+
+	static void SortPoints(pcl::PointCloud<pcl::PointXYZRGB> &cloud)
+	{
+		std::sort(cloud.points.begin(), cloud.points.end(),
+		          [](const pcl::PointXYZRGB &a, const pcl::PointXYZRGB &b)
+		          {
+			          return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+		          });
+	}
+
+	ROSPixelCloudFusionApp app_;
+	cv::Mat raw_image_;
+};
+
+TEST_F(PixelCloudFusionTestSuite, zBufferMatchesHashMap)
+{
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<double> depth(1.0, 30.0);
+
+	// at most one point per pixel, where both modes keep the same point
+	std::vector<int> pixels(WIDTH * HEIGHT);
+	std::iota(pixels.begin(), pixels.end(), 0);
+	std::shuffle(pixels.begin(), pixels.end(), rng);
+	pcl::PointCloud<pcl::PointXYZ> in_cloud;
+	for (size_t i = 0; i < pixels.size() / 2; i++)
+		in_cloud.points.push_back(PointAtPixel(pixels[i] % WIDTH, pixels[i] / WIDTH, depth(rng)));
+	// and points that both modes drop, behind the camera or outside the image
+	for (int i = 0; i < 50; i++)
+	{
+		in_cloud.points.push_back(PointAtPixel(i % WIDTH, i % HEIGHT, -depth(rng)));
+		in_cloud.points.push_back(PointAtPixel(WIDTH + i, i % HEIGHT, depth(rng)));
+		in_cloud.points.push_back(PointAtPixel(i % WIDTH, -2 - i, depth(rng)));
+	}
+
+	pcl::PointCloud<pcl::PointXYZRGB> hash_map_cloud = FuseHashMap(in_cloud);
+	pcl::PointCloud<pcl::PointXYZRGB> z_buffer_cloud = FuseZBuffer(in_cloud);
+	ASSERT_EQ(pixels.size() / 2, hash_map_cloud.points.size());
+	ASSERT_EQ(hash_map_cloud.points.size(), z_buffer_cloud.points.size());
+
+	SortPoints(hash_map_cloud);
+	SortPoints(z_buffer_cloud);
+	for (size_t i = 0; i < hash_map_cloud.points.size(); i++)
+	{
+		const pcl::PointXYZRGB &expected = hash_map_cloud.points[i];
+		const pcl::PointXYZRGB &actual = z_buffer_cloud.points[i];
+		ASSERT_EQ(expected.x, actual.x);
+		ASSERT_EQ(expected.y, actual.y);
+		ASSERT_EQ(expected.z, actual.z);
+		EXPECT_EQ(expected.r, actual.r);
+		EXPECT_EQ(expected.g, actual.g);
+		EXPECT_EQ(expected.b, actual.b);
+	}
+}
+
+TEST_F(PixelCloudFusionTestSuite, zBufferKeepsNearestPoint)
+{
+	pcl::PointCloud<pcl::PointXYZ> in_cloud;
+	in_cloud.points.push_back(PointAtPixel(10, 20, 15.0));
+	in_cloud.points.push_back(PointAtPixel(10, 20, 5.0));
+	in_cloud.points.push_back(PointAtPixel(10, 20, 10.0));
+
+	pcl::PointCloud<pcl::PointXYZRGB> hash_map_cloud = FuseHashMap(in_cloud);
+	pcl::PointCloud<pcl::PointXYZRGB> z_buffer_cloud = FuseZBuffer(in_cloud);
+	ASSERT_EQ(1u, hash_map_cloud.points.size());
+	ASSERT_EQ(1u, z_buffer_cloud.points.size());
+	EXPECT_EQ(in_cloud.points[0].x, hash_map_cloud.points[0].x);
+	EXPECT_EQ(in_cloud.points[1].x, z_buffer_cloud.points[0].x);
+	const cv::Vec3b pixel = raw_image_.at<cv::Vec3b>(20, 10);
+	EXPECT_EQ(pixel[2], z_buffer_cloud.points[0].r);
+	EXPECT_EQ(pixel[1], z_buffer_cloud.points[0].g);
+	EXPECT_EQ(pixel[0], z_buffer_cloud.points[0].b);
+}
+
+TEST_F(PixelCloudFusionTestSuite, zBufferIsClearedBetweenClouds)
+{
+	pcl::PointCloud<pcl::PointXYZ> near_cloud;
+	near_cloud.points.push_back(PointAtPixel(30, 30, 2.0));
+	pcl::PointCloud<pcl::PointXYZ> far_cloud;
+	far_cloud.points.push_back(PointAtPixel(30, 30, 20.0));
+
+	ASSERT_EQ(1u, FuseZBuffer(near_cloud).points.size());
+	pcl::PointCloud<pcl::PointXYZRGB> out_cloud = FuseZBuffer(far_cloud);
+	ASSERT_EQ(1u, out_cloud.points.size());
+	EXPECT_EQ(far_cloud.points[0].x, out_cloud.points[0].x);
+}
+
+TEST_F(PixelCloudFusionTestSuite, undistortLutMatchesUndistortPoints)
+{
+	// pincushion with some tangential distortion, the corners of the undistorted image come from outside the raw one
+	app_.distortion_coefficients_ = (cv::Mat_<double>(1, 5) << 0.1, 0.02, 0.002, 0, 0);
+	app_.BuildUndistortLut(raw_image_.size());
+	ASSERT_EQ(static_cast<size_t>(WIDTH * HEIGHT), app_.undistort_lut_.size());
+	EXPECT_EQ(-1, app_.undistort_lut_[0]);
+	EXPECT_EQ(-1, app_.undistort_lut_[WIDTH * HEIGHT - 1]);
+
+	std::vector<cv::Point2f> raw_points;
+	std::vector<cv::Point2f> lut_points;
+	int moved_pixels = 0;
+	for (int row = 0; row < HEIGHT; row++)
+	{
+		for (int col = 0; col < WIDTH; col++)
+		{
+			const int raw_pixel = app_.undistort_lut_[row * WIDTH + col];
+			if (raw_pixel < 0)
+				continue;
+			raw_points.push_back(cv::Point2f(raw_pixel % WIDTH, raw_pixel / WIDTH));
+			lut_points.push_back(cv::Point2f(col, row));
+			if (raw_pixel != row * WIDTH + col)
+				moved_pixels++;
+		}
+	}
+	ASSERT_FALSE(raw_points.empty());
+	EXPECT_GT(moved_pixels, 0);
+
+	// the raw pixel is the nearest one to where the undistorted pixel is read from, so undistorting it gives back the
+	// undistorted pixel within the rounding
+	std::vector<cv::Point2f> undistorted_points;
+	cv::undistortPoints(raw_points, undistorted_points, app_.camera_instrinsics_, app_.distortion_coefficients_,
+	                    cv::noArray(), app_.camera_instrinsics_);
+	ASSERT_EQ(raw_points.size(), undistorted_points.size());
+	for (size_t i = 0; i < raw_points.size(); i++)
+	{
+		EXPECT_NEAR(lut_points[i].x, undistorted_points[i].x, 1.0);
+		EXPECT_NEAR(lut_points[i].y, undistorted_points[i].y, 1.0);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+	ros::init(argc, argv, "pixel_cloud_fusion_test");
+	return RUN_ALL_TESTS();
+}
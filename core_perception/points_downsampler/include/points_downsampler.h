@@ -1,6 +1,8 @@
 #ifndef POINTS_DOWNSAMPLER_H
 #define POINTS_DOWNSAMPLER_H
 
+#include <pointcloud2_view/pointcloud2_view.hpp>
+
 static pcl::PointCloud<pcl::PointXYZI> removePointsByRange(pcl::PointCloud<pcl::PointXYZI> scan, double min_range, double max_range)
 {
   pcl::PointCloud<pcl::PointXYZI> narrowed_scan;
@@ -33,4 +35,61 @@ static pcl::PointCloud<pcl::PointXYZI> removePointsByRange(pcl::PointCloud<pcl::
   return narrowed_scan;
 }
 
+// Copies the points of a PointCloud2 read in place, without the field mapping of pcl::fromROSMsg.
+// is_dense is kept as pcl::fromROSMsg does, so that the filters still skip non finite points.
+static inline void copyPoints(const pointcloud2_view::PointCloud2View& scan, pcl::PointCloud<pcl::PointXYZI>& out_scan)
+{
+  out_scan.points.clear();
+  out_scan.points.reserve(scan.size());
+
+  pcl::PointXYZI p;
+  for(size_t i = 0; i < scan.size(); i++)
+  {
+    p.x = scan.x(i);
+    p.y = scan.y(i);
+    p.z = scan.z(i);
+    p.intensity = scan.intensity(i);
+    out_scan.points.push_back(p);
+  }
+  out_scan.width = out_scan.points.size();
+  out_scan.height = 1;
+  out_scan.is_dense = scan.isDense();
+}
+
+// Same as removePointsByRange above, reading the points of a PointCloud2 in place
+static inline void removePointsByRange(const pointcloud2_view::PointCloud2View& scan, double min_range, double max_range,
+                                       pcl::PointCloud<pcl::PointXYZI>& narrowed_scan)
+{
+#if 1     //  This error handling should be detemind.
+  if( min_range>=max_range ) {
+    ROS_ERROR_ONCE("min_range>=max_range @(%lf, %lf)", min_range, max_range );
+    copyPoints(scan, narrowed_scan);
+    return;
+  }
+#endif
+
+  double square_min_range = min_range * min_range;
+  double square_max_range = max_range * max_range;
+
+  narrowed_scan.points.clear();
+  narrowed_scan.points.reserve(scan.size());
+
+  pcl::PointXYZI p;
+  for(size_t i = 0; i < scan.size(); i++)
+  {
+    p.x = scan.x(i);
+    p.y = scan.y(i);
+    double square_distance = p.x * p.x + p.y * p.y;
+
+    if(square_min_range <= square_distance && square_distance <= square_max_range){
+      p.z = scan.z(i);
+      p.intensity = scan.intensity(i);
+      narrowed_scan.points.push_back(p);
+    }
+  }
+  narrowed_scan.width = narrowed_scan.points.size();
+  narrowed_scan.height = 1;
+  narrowed_scan.is_dense = scan.isDense();
+}
+
 #endif // POINTS_DOWNSAMPLER_H
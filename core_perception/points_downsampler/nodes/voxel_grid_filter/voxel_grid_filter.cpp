@@ -56,14 +56,27 @@ static void config_callback(const autoware_config_msgs::ConfigVoxelGridFilter::C
 
 static void scan_callback(const sensor_msgs::PointCloud2::ConstPtr& input)
 {
-  pcl::PointCloud<pcl::PointXYZI> scan;
-  pcl::fromROSMsg(*input, scan);
-
-  if(measurement_range != MAX_MEASUREMENT_RANGE){
-    scan = removePointsByRange(scan, 0, measurement_range);
+  // Read the points in place and only copy the ones in range
+  pcl::PointCloud<pcl::PointXYZI>::Ptr scan_ptr(new pcl::PointCloud<pcl::PointXYZI>());
+  size_t original_points_size = 0;
+  try
+  {
+    pointcloud2_view::PointCloud2View scan(*input);
+
+    if(measurement_range != MAX_MEASUREMENT_RANGE){
+      removePointsByRange(scan, 0, measurement_range, *scan_ptr);
+    }
+    else{
+      copyPoints(scan, *scan_ptr);
+    }
+    original_points_size = scan_ptr->size();
   }
-
-  pcl::PointCloud<pcl::PointXYZI>::Ptr scan_ptr(new pcl::PointCloud<pcl::PointXYZI>(scan));
+  catch (std::runtime_error& e)
+  {
+    ROS_ERROR_THROTTLE(10, "%s", e.what());
+    return;
+  }
+  pcl_conversions::toPCL(input->header, scan_ptr->header);
   pcl::PointCloud<pcl::PointXYZI>::Ptr filtered_scan_ptr(new pcl::PointCloud<pcl::PointXYZI>());
 
   sensor_msgs::PointCloud2 filtered_msg;
@@ -93,7 +106,7 @@ static void scan_callback(const sensor_msgs::PointCloud2::ConstPtr& input)
   points_downsampler_info_msg.header = input->header;
   points_downsampler_info_msg.filter_name = "voxel_grid_filter";
   points_downsampler_info_msg.measurement_range = measurement_range;
-  points_downsampler_info_msg.original_points_size = scan.size();
+  points_downsampler_info_msg.original_points_size = original_points_size;
   if (voxel_leaf_size >= 0.1)
   {
     points_downsampler_info_msg.filtered_points_size = filtered_scan_ptr->size();
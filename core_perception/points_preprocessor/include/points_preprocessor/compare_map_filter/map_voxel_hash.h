@@ -0,0 +1,222 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef POINTS_PREPROCESSOR_COMPARE_MAP_FILTER_MAP_VOXEL_HASH_H
+#define POINTS_PREPROCESSOR_COMPARE_MAP_FILTER_MAP_VOXEL_HASH_H
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <pcl/point_cloud.h>
+
+namespace points_preprocessor
+{
+/*!
+ * Occupancy voxel hash of a point cloud map, answering whether a point is within a distance threshold of the map.
+ *
+ * The space is divided into cubic voxels of a given resolution. When the map is set, every voxel holding a map
+ * point is dilated by the distance threshold: the voxels whose center is within the threshold of the center of an
+ * occupied voxel are marked. isMatched() then looks up the voxel of the point, which is one hash lookup whatever
+ * the size of the map.
+ *
+ * The decision is the one of a nearest neighbour search up to the resolution: points further than
+ * threshold + resolution * sqrt(3) from the map are never matched, points closer than
+ * threshold - resolution * sqrt(3) are always matched.
+ *
+ * Voxels are stored by blocks of 4x4x4, as a 64 bit mask per block.
+ */
+class MapVoxelHash
+{
+public:
+  MapVoxelHash() : resolution_(1.0), inverse_resolution_(1.0), distance_threshold_(0.0)
+  {
+  }
+
+  /*!
+   * Builds the hash of a map, replacing the previous one
+   * @param[in] in_map Map to compare to
+   * @param[in] in_distance_threshold Distance from the map under which a point is matched [m]
+   * @param[in] in_resolution Size of the voxels [m]
+   */
+  template <typename PointT>
+  void setInputCloud(const pcl::PointCloud<PointT>& in_map, double in_distance_threshold, double in_resolution)
+  {
+    resolution_ = in_resolution;
+    inverse_resolution_ = 1.0 / in_resolution;
+    distance_threshold_ = in_distance_threshold;
+
+    // Voxels holding at least one map point
+    std::unordered_map<uint64_t, uint64_t> occupied_blocks;
+    occupied_blocks.reserve(in_map.points.size() / 16 + 1);
+    for (const PointT& point : in_map.points)
+    {
+      int32_t voxel[3];
+      if (!getVoxel(point.x, point.y, point.z, voxel))
+      {
+        continue;
+      }
+      occupied_blocks[getBlockKey(voxel)] |= getVoxelBit(voxel);
+    }
+
+    // Offsets of the voxels whose center is within the threshold of the center of a voxel
+    std::vector<int32_t> stencil;
+    const int32_t radius = static_cast<int32_t>(std::floor(in_distance_threshold * inverse_resolution_));
+    const double squared_radius = in_distance_threshold * in_distance_threshold * inverse_resolution_ *
+                                  inverse_resolution_;
+    for (int32_t dx = -radius; dx <= radius; dx++)
+    {
+      for (int32_t dy = -radius; dy <= radius; dy++)
+      {
+        for (int32_t dz = -radius; dz <= radius; dz++)
+        {
+          if (dx * dx + dy * dy + dz * dz <= squared_radius)
+          {
+            stencil.push_back(dx);
+            stencil.push_back(dy);
+            stencil.push_back(dz);
+          }
+        }
+      }
+    }
+
+    blocks_.clear();
+    blocks_.reserve(occupied_blocks.size() * 2);
+    for (const std::pair<const uint64_t, uint64_t>& block : occupied_blocks)
+    {
+      int32_t block_origin[3];
+      getBlockOrigin(block.first, block_origin);
+      for (uint32_t bit = 0; bit < 64; bit++)
+      {
+        if ((block.second & (static_cast<uint64_t>(1) << bit)) == 0)
+        {
+          continue;
+        }
+        const int32_t x = block_origin[0] + static_cast<int32_t>(bit & 3);
+        const int32_t y = block_origin[1] + static_cast<int32_t>((bit >> 2) & 3);
+        const int32_t z = block_origin[2] + static_cast<int32_t>(bit >> 4);
+        for (size_t i = 0; i < stencil.size(); i += 3)
+        {
+          const int32_t voxel[3] = { x + stencil[i], y + stencil[i + 1], z + stencil[i + 2] };
+          if (!isInRange(voxel))
+          {
+            continue;
+          }
+          blocks_[getBlockKey(voxel)] |= getVoxelBit(voxel);
+        }
+      }
+    }
+  }
+
+  /*!
+   * @return Whether a point is within the distance threshold of the map, up to the resolution. Points with non
+   * finite coordinates, or out of the range of the voxels, are not matched.
+   */
+  template <typename PointT>
+  bool isMatched(const PointT& in_point) const
+  {
+    int32_t voxel[3];
+    if (!getVoxel(in_point.x, in_point.y, in_point.z, voxel))
+    {
+      return false;
+    }
+    const std::unordered_map<uint64_t, uint64_t>::const_iterator block = blocks_.find(getBlockKey(voxel));
+    return block != blocks_.end() && (block->second & getVoxelBit(voxel)) != 0;
+  }
+
+  bool empty() const
+  {
+    return blocks_.empty();
+  }
+
+  double getDistanceThreshold() const
+  {
+    return distance_threshold_;
+  }
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+  /*!
+   * @return Number of blocks of 4x4x4 voxels holding at least one marked voxel
+   */
+  size_t getBlockCount() const
+  {
+    return blocks_.size();
+  }
+
+private:
+  // Blocks indices are stored on 21 bits per axis, which covers +-4e6 voxels
+  static const int32_t BLOCK_OFFSET = 1 << 20;
+  static const uint64_t BLOCK_MASK = (1 << 21) - 1;
+  // Voxel indices are in [-MAX_VOXEL, MAX_VOXEL), beyond that the block keys would wrap around
+  static const int32_t MAX_VOXEL = BLOCK_OFFSET * 4;
+
+  // false if a coordinate is not finite or out of the range of the voxels
+  bool getVoxel(double x, double y, double z, int32_t* out_voxel) const
+  {
+    const double coordinates[3] = { x, y, z };
+    for (int i = 0; i < 3; i++)
+    {
+      // written so that NaN fails the comparison
+      const double voxel = std::floor(coordinates[i] * inverse_resolution_);
+      if (!(voxel >= -MAX_VOXEL && voxel < MAX_VOXEL))
+      {
+        return false;
+      }
+      out_voxel[i] = static_cast<int32_t>(voxel);
+    }
+    return true;
+  }
+
+  static bool isInRange(const int32_t* in_voxel)
+  {
+    return in_voxel[0] >= -MAX_VOXEL && in_voxel[0] < MAX_VOXEL && in_voxel[1] >= -MAX_VOXEL &&
+           in_voxel[1] < MAX_VOXEL && in_voxel[2] >= -MAX_VOXEL && in_voxel[2] < MAX_VOXEL;
+  }
+
+  static uint64_t getBlockKey(const int32_t* in_voxel)
+  {
+    // Arithmetic shift, so that negative voxels are rounded down
+    const uint64_t x = static_cast<uint64_t>((in_voxel[0] >> 2) + BLOCK_OFFSET) & BLOCK_MASK;
+    const uint64_t y = static_cast<uint64_t>((in_voxel[1] >> 2) + BLOCK_OFFSET) & BLOCK_MASK;
+    const uint64_t z = static_cast<uint64_t>((in_voxel[2] >> 2) + BLOCK_OFFSET) & BLOCK_MASK;
+    return x | (y << 21) | (z << 42);
+  }
+
+  static void getBlockOrigin(uint64_t in_key, int32_t* out_voxel)
+  {
+    out_voxel[0] = (static_cast<int32_t>(in_key & BLOCK_MASK) - BLOCK_OFFSET) * 4;
+    out_voxel[1] = (static_cast<int32_t>((in_key >> 21) & BLOCK_MASK) - BLOCK_OFFSET) * 4;
+    out_voxel[2] = (static_cast<int32_t>((in_key >> 42) & BLOCK_MASK) - BLOCK_OFFSET) * 4;
+  }
+
+  static uint64_t getVoxelBit(const int32_t* in_voxel)
+  {
+    const uint32_t bit = (in_voxel[0] & 3) | ((in_voxel[1] & 3) << 2) | ((in_voxel[2] & 3) << 4);
+    return static_cast<uint64_t>(1) << bit;
+  }
+
+  double resolution_;
+  double inverse_resolution_;
+  double distance_threshold_;
+  std::unordered_map<uint64_t, uint64_t> blocks_;  // Key of a block -> mask of its marked voxels
+};
+}  // namespace points_preprocessor
+
+#endif  // POINTS_PREPROCESSOR_COMPARE_MAP_FILTER_MAP_VOXEL_HASH_H
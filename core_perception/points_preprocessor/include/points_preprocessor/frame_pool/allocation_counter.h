@@ -0,0 +1,40 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef POINTS_PREPROCESSOR_FRAME_POOL_ALLOCATION_COUNTER_H
+#define POINTS_PREPROCESSOR_FRAME_POOL_ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+namespace points_preprocessor
+{
+/*!
+ * Number of heap allocations made by the calling thread through the global operator new since the thread started.
+ *
+ * Defined in nodes/frame_pool/allocation_counter.cpp, which every target using the frame pool links. The allocations
+ * are only counted in executables that also link nodes/frame_pool/counting_operator_new.cpp, which replaces the
+ * global operator new and delete. It must stay out of libraries, where it would replace the allocator of every
+ * process loading them. Without it, the count stays at 0. Memory allocated with malloc directly, like the Eigen
+ * aligned buffers of the PCL clouds, is not counted.
+ */
+uint64_t getThreadAllocationCount();
+
+/*!
+ * Counts one allocation of the calling thread, called by the operator new of nodes/frame_pool/counting_operator_new.cpp
+ */
+void countThreadAllocation();
+}  // namespace points_preprocessor
+
+#endif  // POINTS_PREPROCESSOR_FRAME_POOL_ALLOCATION_COUNTER_H
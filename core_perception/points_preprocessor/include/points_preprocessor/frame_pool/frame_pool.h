@@ -0,0 +1,300 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef POINTS_PREPROCESSOR_FRAME_POOL_FRAME_POOL_H
+#define POINTS_PREPROCESSOR_FRAME_POOL_FRAME_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#include <sensor_msgs/PointCloud2.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl/conversions.h>
+#include <pcl/point_cloud.h>
+
+#include "points_preprocessor/frame_pool/allocation_counter.h"
+
+namespace points_preprocessor
+{
+/*!
+ * Point buffers of a node reused from one frame to the next.
+ *
+ * The clouds, indices and messages of a frame are kept by the node and only cleared or resized, which keeps
+ * their memory. Every buffer is sized through the pool before being filled, so a buffer only grows when a frame is
+ * larger than all the previous ones.
+ *
+ * getFrameAllocationCount() counts the heap allocations made by the thread of the frame: those of the pool, of the PCL
+ * filters and search structures, of roscpp when it serializes a published message and of the tf lookups. It only
+ * works with nodes/frame_pool/counting_operator_new.cpp linked into the executable. Buffers with an aligned allocator,
+ * like the points of the clouds, take their memory from malloc without going through operator new, so the pool
+ * counts their growths itself. Allocations of other threads, like OpenMP workers, are not counted.
+ *
+ * getFrameGrowthCount() only counts what goes through the pool: the growths of its buffers and the computations of
+ * the field layouts of the conversions. At 0, the buffers have grown to the largest frame.
+ *
+ * Buffers may be sized from several threads, as long as each buffer is only sized by one of them.
+ *
+ * The conversions from and to sensor_msgs::PointCloud2 replace pcl::fromROSMsg and pcl::toROSMsg, which build
+ * their field mapping and an intermediate pcl::PCLPointCloud2 on every call.
+ */
+class FramePool
+{
+public:
+  FramePool()
+    : growth_count_(0)
+    , aligned_growth_count_(0)
+    , frame_start_growth_count_(0)
+    , frame_start_aligned_growth_count_(0)
+    , frame_start_allocation_count_(0)
+    , field_map_type_(nullptr)
+    , out_fields_type_(nullptr)
+  {
+  }
+
+  /*!
+   * Marks the start of a frame, the frame counts are counted from here
+   */
+  void startFrame()
+  {
+    frame_start_growth_count_ = growth_count_;
+    frame_start_aligned_growth_count_ = aligned_growth_count_;
+    frame_start_allocation_count_ = getThreadAllocationCount();
+  }
+
+  /*!
+   * @return Number of heap allocations of the calling thread since the last call to startFrame(), which has to be
+   * called from the same thread
+   */
+  uint64_t getFrameAllocationCount() const
+  {
+    return getThreadAllocationCount() - frame_start_allocation_count_ + aligned_growth_count_ -
+           frame_start_aligned_growth_count_;
+  }
+
+  /*!
+   * @return Number of buffer growths and layout computations of the pool since it was created
+   */
+  uint64_t getGrowthCount() const
+  {
+    return growth_count_;
+  }
+
+  /*!
+   * @return Number of buffer growths and layout computations of the pool since the last call to startFrame()
+   */
+  uint64_t getFrameGrowthCount() const
+  {
+    return growth_count_ - frame_start_growth_count_;
+  }
+
+  /*!
+   * Grows the capacity of a buffer to at least in_size elements, counting a growth if it had to grow
+   * @param[in,out] buffer Buffer to grow
+   * @param[in] in_size Number of elements the buffer has to hold without reallocating
+   */
+  template <typename T, typename Alloc>
+  void reserve(std::vector<T, Alloc>& buffer, size_t in_size)
+  {
+    if (buffer.capacity() < in_size)
+    {
+      buffer.reserve(in_size);
+      growth_count_++;
+      // operator new counts the growths of the other buffers
+      if (!std::is_same<Alloc, std::allocator<T>>::value)
+      {
+        aligned_growth_count_++;
+      }
+    }
+  }
+
+  /*!
+   * Resizes a buffer, counting a growth if it had to grow
+   * @param[in,out] buffer Buffer to resize
+   * @param[in] in_size New number of elements
+   */
+  template <typename T, typename Alloc>
+  void resize(std::vector<T, Alloc>& buffer, size_t in_size)
+  {
+    reserve(buffer, in_size);
+    buffer.resize(in_size);
+  }
+
+  /*!
+   * Clears a cloud and makes room for in_size points, the header of the cloud is kept
+   * @param[in,out] out_cloud Cloud to clear
+   * @param[in] in_size Number of points the cloud has to hold without reallocating
+   */
+  template <typename PointT>
+  void clear(pcl::PointCloud<PointT>& out_cloud, size_t in_size)
+  {
+    out_cloud.points.clear();
+    reserve(out_cloud.points, in_size);
+    out_cloud.width = 0;
+    out_cloud.height = 1;
+    out_cloud.is_dense = true;
+  }
+
+  /*!
+   * Copies a cloud into another one, reusing the memory of out_cloud
+   * @param[in] in_cloud Cloud to copy
+   * @param[out] out_cloud Resulting copy
+   */
+  template <typename PointT>
+  void copy(const pcl::PointCloud<PointT>& in_cloud, pcl::PointCloud<PointT>& out_cloud)
+  {
+    out_cloud.header = in_cloud.header;
+    resize(out_cloud.points, in_cloud.points.size());
+    std::copy(in_cloud.points.begin(), in_cloud.points.end(), out_cloud.points.begin());
+    out_cloud.width = in_cloud.width;
+    out_cloud.height = in_cloud.height;
+    out_cloud.is_dense = in_cloud.is_dense;
+  }
+
+  /*!
+   * Converts a message into a cloud, reusing the memory of out_cloud.
+   * The field mapping is only computed again when the layout of the messages changes.
+   * @param[in] in_msg Message to convert
+   * @param[out] out_cloud Resulting cloud
+   */
+  template <typename PointT>
+  void fromROSMsg(const sensor_msgs::PointCloud2& in_msg, pcl::PointCloud<PointT>& out_cloud)
+  {
+    if (field_map_type_ != &typeid(PointT) || !isSameLayout(in_msg.fields))
+    {
+      std::vector<pcl::PCLPointField> pcl_fields;
+      pcl_conversions::toPCL(in_msg.fields, pcl_fields);
+      pcl::createMapping<PointT>(pcl_fields, field_map_);
+      in_fields_ = in_msg.fields;
+      field_map_type_ = &typeid(PointT);
+      growth_count_++;
+    }
+
+    pcl_conversions::toPCL(in_msg.header, out_cloud.header);
+    out_cloud.width = in_msg.width;
+    out_cloud.height = in_msg.height;
+    out_cloud.is_dense = in_msg.is_dense == 1;
+    resize(out_cloud.points, in_msg.width * in_msg.height);
+    if (out_cloud.points.empty())
+    {
+      return;
+    }
+
+    uint8_t* cloud_data = reinterpret_cast<uint8_t*>(&out_cloud.points[0]);
+    const bool single_block = field_map_.size() == 1 && field_map_[0].serialized_offset == 0 &&
+                              field_map_[0].struct_offset == 0 && field_map_[0].size == in_msg.point_step &&
+                              field_map_[0].size == sizeof(PointT);
+    for (uint32_t row = 0; row < in_msg.height; row++)
+    {
+      const uint8_t* row_data = &in_msg.data[row * in_msg.row_step];
+      if (single_block)
+      {
+        std::memcpy(cloud_data, row_data, in_msg.width * sizeof(PointT));
+        cloud_data += in_msg.width * sizeof(PointT);
+        continue;
+      }
+      for (uint32_t col = 0; col < in_msg.width; col++)
+      {
+        const uint8_t* msg_data = row_data + col * in_msg.point_step;
+        for (const pcl::detail::FieldMapping& mapping : field_map_)
+        {
+          std::memcpy(cloud_data + mapping.struct_offset, msg_data + mapping.serialized_offset, mapping.size);
+        }
+        cloud_data += sizeof(PointT);
+      }
+    }
+  }
+
+  /*!
+   * Converts a cloud into a message, reusing the memory of out_msg
+   * @param[in] in_cloud Cloud to convert
+   * @param[out] out_msg Resulting message, its header is the one of in_cloud
+   */
+  template <typename PointT>
+  void toROSMsg(const pcl::PointCloud<PointT>& in_cloud, sensor_msgs::PointCloud2& out_msg)
+  {
+    if (out_fields_type_ != &typeid(PointT))
+    {
+      std::vector<pcl::PCLPointField> pcl_fields;
+      pcl::for_each_type<typename pcl::traits::fieldList<PointT>::type>(pcl::detail::FieldAdder<PointT>(pcl_fields));
+      pcl_conversions::fromPCL(pcl_fields, out_fields_);
+      out_fields_type_ = &typeid(PointT);
+      growth_count_++;
+    }
+
+    const size_t points_num = in_cloud.points.size();
+    pcl_conversions::fromPCL(in_cloud.header, out_msg.header);
+    if (in_cloud.width * in_cloud.height == points_num)
+    {
+      out_msg.width = in_cloud.width;
+      out_msg.height = in_cloud.height;
+    }
+    else
+    {
+      out_msg.width = points_num;
+      out_msg.height = 1;
+    }
+    reserve(out_msg.fields, out_fields_.size());
+    out_msg.fields = out_fields_;
+    out_msg.is_bigendian = false;
+    out_msg.point_step = sizeof(PointT);
+    out_msg.row_step = sizeof(PointT) * out_msg.width;
+    out_msg.is_dense = in_cloud.is_dense;
+
+    resize(out_msg.data, points_num * sizeof(PointT));
+    if (points_num > 0)
+    {
+      std::memcpy(&out_msg.data[0], &in_cloud.points[0], points_num * sizeof(PointT));
+    }
+  }
+
+private:
+  bool isSameLayout(const std::vector<sensor_msgs::PointField>& in_fields) const
+  {
+    if (in_fields.size() != in_fields_.size())
+    {
+      return false;
+    }
+    for (size_t i = 0; i < in_fields.size(); i++)
+    {
+      if (in_fields[i].name != in_fields_[i].name || in_fields[i].offset != in_fields_[i].offset ||
+          in_fields[i].datatype != in_fields_[i].datatype || in_fields[i].count != in_fields_[i].count)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::atomic<uint64_t> growth_count_;
+  std::atomic<uint64_t> aligned_growth_count_;
+  uint64_t frame_start_growth_count_;
+  uint64_t frame_start_aligned_growth_count_;
+  uint64_t frame_start_allocation_count_;
+
+  std::vector<sensor_msgs::PointField> in_fields_;  // Layout of the last converted message
+  pcl::MsgFieldMap field_map_;                       // Mapping from in_fields_ to the point type
+  const std::type_info* field_map_type_;
+
+  std::vector<sensor_msgs::PointField> out_fields_;  // Fields of the output messages
+  const std::type_info* out_fields_type_;
+};
+}  // namespace points_preprocessor
+
+#endif  // POINTS_PREPROCESSOR_FRAME_POOL_FRAME_POOL_H
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef POINTS_PREPROCESSOR_POINTS_CONCAT_FILTER_DESKEW_H
+#define POINTS_PREPROCESSOR_POINTS_CONCAT_FILTER_DESKEW_H
+
+#include <cmath>
+
+#include <tf/transform_datatypes.h>
+
+namespace points_preprocessor
+{
+/*!
+ * Expresses a twist given in a frame at the origin of another frame.
+ *
+ * @param[in] in_twist_to_output transform from the frame of the twist to the other frame
+ * @param[in,out] io_linear linear velocity, of the origin of the frame of the twist, then of the other frame
+ * @param[in,out] io_angular angular velocity
+ */
+inline void transformTwist(const tf::Transform& in_twist_to_output, tf::Vector3& io_linear, tf::Vector3& io_angular)
+{
+  const tf::Vector3 lever_arm = in_twist_to_output.inverse().getOrigin();
+  io_linear = tf::quatRotate(in_twist_to_output.getRotation(), io_linear + io_angular.cross(lever_arm));
+  io_angular = tf::quatRotate(in_twist_to_output.getRotation(), io_angular);
+}
+
+/*!
+ * Motion of a frame moving with a constant twist, expressed at its origin, during in_time_difference.
+ *
+ * Applied to points given in the frame at the end of the motion, it gives them in the frame at its start. The
+ * frame moves along a helix, the exponential of the twist.
+ */
+inline tf::Transform getDeskewTransform(const tf::Vector3& in_linear, const tf::Vector3& in_angular,
+                                        double in_time_difference)
+{
+  const tf::Vector3 rotation_vector = in_angular * in_time_difference;
+  const tf::Vector3 translation = in_linear * in_time_difference;
+  const double angle = rotation_vector.length();
+  if (angle < 1e-9)
+  {
+    return tf::Transform(tf::Quaternion::getIdentity(), translation);
+  }
+
+  const tf::Vector3 cross = rotation_vector.cross(translation);
+  const double angle2 = angle * angle;
+  return tf::Transform(tf::Quaternion(rotation_vector / angle, angle),
+                       translation + (1 - std::cos(angle)) / angle2 * cross +
+                           (angle - std::sin(angle)) / (angle2 * angle) * rotation_vector.cross(cross));
+}
+}  // namespace points_preprocessor
+
+#endif  // POINTS_PREPROCESSOR_POINTS_CONCAT_FILTER_DESKEW_H
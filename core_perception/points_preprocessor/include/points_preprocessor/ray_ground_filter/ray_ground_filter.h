@@ -25,14 +25,17 @@
 #include <string>
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
+#include <std_msgs/Float32MultiArray.h>
+#include <std_msgs/UInt32.h>
 #include <pcl_ros/point_cloud.h>
 #include <pcl_conversions/pcl_conversions.h>
 #include <pcl/point_types.h>
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/normal_3d_omp.h>
-#include <pcl/filters/extract_indices.h>
 #include <velodyne_pointcloud/point_types.h>
 #include "autoware_config_msgs/ConfigRayGroundFilter.h"
+#include "points_preprocessor/frame_pool/frame_pool.h"
+#include <pointcloud2_view/pointcloud2_view.hpp>
 
 #include <tf2/transform_datatypes.h>
 #include <tf2_ros/transform_listener.h>
@@ -51,15 +54,17 @@
 class RayGroundFilter
 {
 private:
+  // Created by Run(), so that the filter can be built and tested without a ROS master
   std::shared_ptr<autoware_health_checker::HealthChecker> health_checker_ptr_;
-  ros::NodeHandle node_handle_;
   ros::Subscriber points_node_sub_;
   ros::Subscriber config_node_sub_;
   ros::Publisher groundless_points_pub_;
   ros::Publisher ground_points_pub_;
+  ros::Publisher stage_time_pub_;
+  ros::Publisher frame_allocations_pub_;
 
-  tf2_ros::Buffer tf_buffer_;
-  tf2_ros::TransformListener tf_listener_;
+  std::unique_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::unique_ptr<tf2_ros::TransformListener> tf_listener_;
 
   std::string input_point_topic_;
   std::string base_frame_;
@@ -97,6 +102,26 @@ private:
   };
   typedef std::vector<PointXYZIRTColor> PointCloudXYZIRTColor;
 
+  // Buffers reused across frames, so that their memory is only allocated when the input grows
+  points_preprocessor::FramePool frame_pool_;
+  sensor_msgs::PointCloud2::Ptr trans_sensor_cloud_ptr_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr clipped_cloud_ptr_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr filtered_cloud_ptr_;
+  std::shared_ptr<PointCloudXYZIRTColor> organized_points_;
+  std::shared_ptr<std::vector<pcl::PointIndices> > radial_division_indices_;
+  std::shared_ptr<std::vector<PointCloudXYZIRTColor> > radial_ordered_clouds_;
+  std::vector<size_t> radial_histogram_;  // Points per radial division for each thread, then scatter offsets
+  pcl::PointIndices::Ptr ground_indices_;
+  pcl::PointIndices::Ptr no_ground_indices_;
+  std::vector<uint8_t> extract_mask_;  // Points kept by ExtractPointsIndices
+  pcl::PointCloud<pcl::PointXYZI>::Ptr ground_cloud_ptr_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr no_ground_cloud_ptr_;
+  sensor_msgs::PointCloud2::Ptr ground_cloud_msg_ptr_;
+  sensor_msgs::PointCloud2::Ptr trans_ground_cloud_msg_ptr_;
+  sensor_msgs::PointCloud2::Ptr no_ground_cloud_msg_ptr_;
+  sensor_msgs::PointCloud2::Ptr trans_no_ground_cloud_msg_ptr_;
+  std_msgs::Float32MultiArray stage_time_;  // Time spent in each stage [ms]
+
   void update_config_params(const autoware_config_msgs::ConfigRayGroundFilter::ConstPtr& param);
 
   /*!
@@ -110,12 +135,24 @@ private:
   bool TransformPointCloud(const std::string& in_target_frame, const sensor_msgs::PointCloud2::ConstPtr& in_cloud_ptr,
                            const sensor_msgs::PointCloud2::Ptr& out_cloud_ptr);
 
+  /*!
+   * Publishes a PointCloud in the frame of in_header
+   * @param[in] in_publisher Publisher of the PointCloud
+   * @param[in] in_cloud_to_publish_ptr PointCloud in base_frame_
+   * @param[in] in_header Header of the input PointCloud
+   * @param[out] out_cloud_msg_ptr Message buffer for the PointCloud in base_frame_
+   * @param[out] out_trans_cloud_msg_ptr Message buffer for the published PointCloud
+   */
   void publish_cloud(const ros::Publisher& in_publisher,
                      const pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_to_publish_ptr,
-                     const std_msgs::Header& in_header);
+                     const std_msgs::Header& in_header, const sensor_msgs::PointCloud2::Ptr& out_cloud_msg_ptr,
+                     const sensor_msgs::PointCloud2::Ptr& out_trans_cloud_msg_ptr);
 
   /*!
-   *
+   * Bins the points into radial divisions with a counting sort: each thread counts the points of its part of
+   * the cloud per division, a prefix sum over the threads gives where each thread writes in each division,
+   * then the points are scattered without locks. Points keep their input order inside a division before
+   * being sorted by radius.
    * @param[in] in_cloud Input Point Cloud to be organized in radial segments
    * @param[out] out_organized_points Custom Point Cloud filled with XYZRTZColor data
    * @param[out] out_radial_divided_indices Indices of the points in the original cloud for each radial segment
@@ -145,6 +182,15 @@ private:
   void ClipCloud(const pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_ptr, const double in_clip_height,
                  pcl::PointCloud<pcl::PointXYZI>::Ptr out_clipped_cloud_ptr);
 
+  /*!
+   * Removes the points higher than a threshold, reading the input in place instead of converting it first
+   * @param in_cloud_view View over the PointCloud2 to perform Clipping
+   * @param in_clip_height Maximum allowed height in the cloud
+   * @param out_clipped_cloud_ptr Resultung PointCloud with the points removed
+   */
+  void ClipCloud(const pointcloud2_view::PointCloud2View& in_cloud_view, const double in_clip_height,
+                 pcl::PointCloud<pcl::PointXYZI>::Ptr out_clipped_cloud_ptr);
+
   /*!
    * Returns the resulting complementary PointCloud, one with the points kept and the other removed as indicated
    * in the indices
@@ -170,6 +216,7 @@ private:
   void CloudCallback(const sensor_msgs::PointCloud2ConstPtr& in_sensor_cloud);
 
   friend class RayGroundFilter_clipCloud_Test;
+  friend class RayGroundFilter_convertXYZIToRTZColor_Test;
 
 public:
   RayGroundFilter();
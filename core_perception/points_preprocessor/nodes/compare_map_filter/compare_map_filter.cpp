@@ -28,12 +28,15 @@
  *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstdlib>
+
 #include <ros/ros.h>
 
 #include <tf/tf.h>
 
 #include <sensor_msgs/point_cloud_conversion.h>
 #include <sensor_msgs/PointCloud2.h>
+#include <std_msgs/UInt32.h>
 
 #include <pcl_conversions/pcl_conversions.h>
 #include <pcl_ros/transforms.h>
@@ -42,6 +45,9 @@
 
 #include <autoware_config_msgs/ConfigCompareMapFilter.h>
 
+#include "points_preprocessor/compare_map_filter/map_voxel_hash.h"
+#include "points_preprocessor/frame_pool/frame_pool.h"
+
 class CompareMapFilter
 {
 public:
@@ -56,20 +62,43 @@ private:
   ros::Subscriber map_sub_;
   ros::Publisher match_points_pub_;
   ros::Publisher unmatch_points_pub_;
+  ros::Publisher frame_allocations_pub_;
 
   tf::TransformListener* tf_listener_;
 
   pcl::KdTreeFLANN<pcl::PointXYZI> tree_;
 
+  // search_method voxel_hash: the map is hashed once per map message with the distance threshold baked in
+  points_preprocessor::MapVoxelHash voxel_hash_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr map_cloud_ptr_;
+
+  std::string search_method_;
+  double voxel_hash_resolution_;
   double distance_threshold_;
   double min_clipping_height_;
   double max_clipping_height_;
 
   std::string map_frame_;
 
+  // Buffers reused across frames
+  points_preprocessor::FramePool frame_pool_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr sensorTF_cloud_ptr_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr sensorTF_clipping_height_cloud_ptr_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr mapTF_cloud_ptr_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr mapTF_match_cloud_ptr_;
+  pcl::PointCloud<pcl::PointXYZI>::Ptr mapTF_unmatch_cloud_ptr_;
+  sensor_msgs::PointCloud2 mapTF_match_cloud_msg_;
+  sensor_msgs::PointCloud2 mapTF_unmatch_cloud_msg_;
+  sensor_msgs::PointCloud2 sensorTF_match_cloud_msg_;
+  sensor_msgs::PointCloud2 sensorTF_unmatch_cloud_msg_;
+  tf::StampedTransform map_from_sensor_;  // Looked up once per frame, for the sensor cloud and the results
+  std::vector<int> nn_indices_;
+  std::vector<float> nn_dists_;
+
   void configCallback(const autoware_config_msgs::ConfigCompareMapFilter::ConstPtr& config_msg_ptr);
   void pointsMapCallback(const sensor_msgs::PointCloud2::ConstPtr& map_cloud_msg_ptr);
   void sensorPointsCallback(const sensor_msgs::PointCloud2::ConstPtr& sensorTF_cloud_msg_ptr);
+  void setMapSearch();
   void searchMatchingCloud(const pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_ptr,
                            pcl::PointCloud<pcl::PointXYZI>::Ptr match_cloud_ptr,
                            pcl::PointCloud<pcl::PointXYZI>::Ptr unmatch_cloud_ptr);
@@ -79,20 +108,39 @@ CompareMapFilter::CompareMapFilter()
   : nh_()
   , nh_private_("~")
   , tf_listener_(new tf::TransformListener)
+  , search_method_("kdtree")
+  , voxel_hash_resolution_(0.1)
   , distance_threshold_(0.3)
   , min_clipping_height_(-2.0)
   , max_clipping_height_(0.5)
   , map_frame_("/map")
+  , sensorTF_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , sensorTF_clipping_height_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , mapTF_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , mapTF_match_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , mapTF_unmatch_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , nn_indices_(1)
+  , nn_dists_(1)
 {
+  nh_private_.param("search_method", search_method_, search_method_);
+  nh_private_.param("voxel_hash_resolution", voxel_hash_resolution_, voxel_hash_resolution_);
   nh_private_.param("distance_threshold", distance_threshold_, distance_threshold_);
   nh_private_.param("min_clipping_height", min_clipping_height_, min_clipping_height_);
   nh_private_.param("max_clipping_height", max_clipping_height_, max_clipping_height_);
 
+  // The voxel hash divides by the resolution, written so that NaN is rejected too
+  if (!(voxel_hash_resolution_ > 0))
+  {
+    ROS_FATAL("voxel_hash_resolution must be positive, got %f. Terminate program... ", voxel_hash_resolution_);
+    exit(EXIT_FAILURE);
+  }
+
   config_sub_ = nh_.subscribe("/config/compare_map_filter", 10, &CompareMapFilter::configCallback, this);
   sensor_points_sub_ = nh_.subscribe("/points_raw", 1, &CompareMapFilter::sensorPointsCallback, this);
   map_sub_ = nh_.subscribe("/points_map", 10, &CompareMapFilter::pointsMapCallback, this);
   match_points_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("/points_ground", 10);
   unmatch_points_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("/points_no_ground", 10);
+  frame_allocations_pub_ = nh_private_.advertise<std_msgs::UInt32>("frame_allocations", 10);
 }
 
 void CompareMapFilter::configCallback(const autoware_config_msgs::ConfigCompareMapFilter::ConstPtr& config_msg_ptr)
@@ -100,108 +148,131 @@ void CompareMapFilter::configCallback(const autoware_config_msgs::ConfigCompareM
   distance_threshold_ = config_msg_ptr->distance_threshold;
   min_clipping_height_ = config_msg_ptr->min_clipping_height;
   max_clipping_height_ = config_msg_ptr->max_clipping_height;
+
+  // The threshold is part of the voxel hash
+  if (search_method_ == "voxel_hash" && map_cloud_ptr_ && voxel_hash_.getDistanceThreshold() != distance_threshold_)
+  {
+    setMapSearch();
+  }
 }
 
 void CompareMapFilter::pointsMapCallback(const sensor_msgs::PointCloud2::ConstPtr& map_cloud_msg_ptr)
 {
-  pcl::PointCloud<pcl::PointXYZI>::Ptr map_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  pcl::fromROSMsg(*map_cloud_msg_ptr, *map_cloud_ptr);
-  tree_.setInputCloud(map_cloud_ptr);
+  map_cloud_ptr_.reset(new pcl::PointCloud<pcl::PointXYZI>);
+  pcl::fromROSMsg(*map_cloud_msg_ptr, *map_cloud_ptr_);
+  setMapSearch();
 
   map_frame_ = map_cloud_msg_ptr->header.frame_id;
 }
 
-void CompareMapFilter::sensorPointsCallback(const sensor_msgs::PointCloud2::ConstPtr& sensorTF_cloud_msg_ptr)
+void CompareMapFilter::setMapSearch()
 {
-  const ros::Time sensor_time = sensorTF_cloud_msg_ptr->header.stamp;
-  const std::string sensor_frame = sensorTF_cloud_msg_ptr->header.frame_id;
-
-  pcl::PointCloud<pcl::PointXYZI>::Ptr sensorTF_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  pcl::fromROSMsg(*sensorTF_cloud_msg_ptr, *sensorTF_cloud_ptr);
-
-  pcl::PointCloud<pcl::PointXYZI>::Ptr sensorTF_clipping_height_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  sensorTF_clipping_height_cloud_ptr->header = sensorTF_cloud_ptr->header;
-  for (size_t i = 0; i < sensorTF_cloud_ptr->points.size(); ++i)
+  if (search_method_ == "voxel_hash")
   {
-    if (sensorTF_cloud_ptr->points[i].z > min_clipping_height_ &&
-        sensorTF_cloud_ptr->points[i].z < max_clipping_height_)
-    {
-      sensorTF_clipping_height_cloud_ptr->points.push_back(sensorTF_cloud_ptr->points[i]);
-    }
+    const ros::WallTime start = ros::WallTime::now();
+    voxel_hash_.setInputCloud(*map_cloud_ptr_, distance_threshold_, voxel_hash_resolution_);
+    ROS_INFO("Built the voxel hash of %zu map points in %.3f s (%zu blocks)", map_cloud_ptr_->points.size(),
+             (ros::WallTime::now() - start).toSec(), voxel_hash_.getBlockCount());
   }
-
-  pcl::PointCloud<pcl::PointXYZI>::Ptr mapTF_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  try
-  {
-    tf_listener_->waitForTransform(map_frame_, sensor_frame, sensor_time, ros::Duration(3.0));
-    pcl_ros::transformPointCloud(map_frame_, sensor_time, *sensorTF_clipping_height_cloud_ptr, sensor_frame,
-                                 *mapTF_cloud_ptr, *tf_listener_);
-  }
-  catch (tf::TransformException& ex)
+  else
   {
-    ROS_ERROR("Transform error: %s", ex.what());
-    return;
+    tree_.setInputCloud(map_cloud_ptr_);
   }
+}
 
-  pcl::PointCloud<pcl::PointXYZI>::Ptr mapTF_match_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  pcl::PointCloud<pcl::PointXYZI>::Ptr mapTF_unmatch_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  searchMatchingCloud(mapTF_cloud_ptr, mapTF_match_cloud_ptr, mapTF_unmatch_cloud_ptr);
+void CompareMapFilter::sensorPointsCallback(const sensor_msgs::PointCloud2::ConstPtr& sensorTF_cloud_msg_ptr)
+{
+  const ros::Time sensor_time = sensorTF_cloud_msg_ptr->header.stamp;
+  const std::string& sensor_frame = sensorTF_cloud_msg_ptr->header.frame_id;
 
-  sensor_msgs::PointCloud2 mapTF_match_cloud_msg;
-  pcl::toROSMsg(*mapTF_match_cloud_ptr, mapTF_match_cloud_msg);
-  mapTF_match_cloud_msg.header.stamp = sensor_time;
-  mapTF_match_cloud_msg.header.frame_id = map_frame_;
-  mapTF_match_cloud_msg.fields = sensorTF_cloud_msg_ptr->fields;
+  frame_pool_.startFrame();
 
-  sensor_msgs::PointCloud2 sensorTF_match_cloud_msg;
-  try
-  {
-    pcl_ros::transformPointCloud(sensor_frame, mapTF_match_cloud_msg, sensorTF_match_cloud_msg, *tf_listener_);
-  }
-  catch (tf::TransformException& ex)
+  frame_pool_.fromROSMsg(*sensorTF_cloud_msg_ptr, *sensorTF_cloud_ptr_);
+
+  frame_pool_.clear(*sensorTF_clipping_height_cloud_ptr_, sensorTF_cloud_ptr_->points.size());
+  sensorTF_clipping_height_cloud_ptr_->header = sensorTF_cloud_ptr_->header;
+  for (size_t i = 0; i < sensorTF_cloud_ptr_->points.size(); ++i)
   {
-    ROS_ERROR("Transform error: %s", ex.what());
-    return;
+    if (sensorTF_cloud_ptr_->points[i].z > min_clipping_height_ &&
+        sensorTF_cloud_ptr_->points[i].z < max_clipping_height_)
+    {
+      sensorTF_clipping_height_cloud_ptr_->points.push_back(sensorTF_cloud_ptr_->points[i]);
+    }
   }
-  match_points_pub_.publish(sensorTF_match_cloud_msg);
-
-  sensor_msgs::PointCloud2 mapTF_unmatch_cloud_msg;
-  pcl::toROSMsg(*mapTF_unmatch_cloud_ptr, mapTF_unmatch_cloud_msg);
-  mapTF_unmatch_cloud_msg.header.stamp = sensor_time;
-  mapTF_unmatch_cloud_msg.header.frame_id = map_frame_;
-  mapTF_unmatch_cloud_msg.fields = sensorTF_cloud_msg_ptr->fields;
 
-  sensor_msgs::PointCloud2 sensorTF_unmatch_cloud_msg;
   try
   {
-    pcl_ros::transformPointCloud(sensor_frame, mapTF_unmatch_cloud_msg, sensorTF_unmatch_cloud_msg, *tf_listener_);
+    tf_listener_->waitForTransform(map_frame_, sensor_frame, sensor_time, ros::Duration(3.0));
+    tf_listener_->lookupTransform(map_frame_, sensor_frame, sensor_time, map_from_sensor_);
   }
   catch (tf::TransformException& ex)
   {
     ROS_ERROR("Transform error: %s", ex.what());
     return;
   }
-  unmatch_points_pub_.publish(sensorTF_unmatch_cloud_msg);
+  const tf::Transform sensor_from_map = map_from_sensor_.inverse();
+
+  frame_pool_.reserve(mapTF_cloud_ptr_->points, sensorTF_clipping_height_cloud_ptr_->points.size());
+  pcl_ros::transformPointCloud(*sensorTF_clipping_height_cloud_ptr_, *mapTF_cloud_ptr_, map_from_sensor_);
+  mapTF_cloud_ptr_->header.frame_id = map_frame_;
+
+  searchMatchingCloud(mapTF_cloud_ptr_, mapTF_match_cloud_ptr_, mapTF_unmatch_cloud_ptr_);
+
+  // the fields of the input are kept, assigning them reuses the strings of the previous frame
+  frame_pool_.toROSMsg(*mapTF_match_cloud_ptr_, mapTF_match_cloud_msg_);
+  mapTF_match_cloud_msg_.header.stamp = sensor_time;
+  mapTF_match_cloud_msg_.header.frame_id = map_frame_;
+  mapTF_match_cloud_msg_.fields = sensorTF_cloud_msg_ptr->fields;
+
+  frame_pool_.reserve(sensorTF_match_cloud_msg_.data, mapTF_match_cloud_msg_.data.size());
+  pcl_ros::transformPointCloud(sensor_frame, sensor_from_map, mapTF_match_cloud_msg_, sensorTF_match_cloud_msg_);
+  match_points_pub_.publish(sensorTF_match_cloud_msg_);
+
+  frame_pool_.toROSMsg(*mapTF_unmatch_cloud_ptr_, mapTF_unmatch_cloud_msg_);
+  mapTF_unmatch_cloud_msg_.header.stamp = sensor_time;
+  mapTF_unmatch_cloud_msg_.header.frame_id = map_frame_;
+  mapTF_unmatch_cloud_msg_.fields = sensorTF_cloud_msg_ptr->fields;
+
+  frame_pool_.reserve(sensorTF_unmatch_cloud_msg_.data, mapTF_unmatch_cloud_msg_.data.size());
+  pcl_ros::transformPointCloud(sensor_frame, sensor_from_map, mapTF_unmatch_cloud_msg_, sensorTF_unmatch_cloud_msg_);
+  unmatch_points_pub_.publish(sensorTF_unmatch_cloud_msg_);
+
+  // roscpp serializes each published message into a new buffer, and the tf lookup copies frame names: these
+  // allocations remain in every frame
+  std_msgs::UInt32 frame_allocations;
+  frame_allocations.data = frame_pool_.getFrameAllocationCount();
+  frame_allocations_pub_.publish(frame_allocations);
 }
 
 void CompareMapFilter::searchMatchingCloud(const pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_ptr,
                                            pcl::PointCloud<pcl::PointXYZI>::Ptr match_cloud_ptr,
                                            pcl::PointCloud<pcl::PointXYZI>::Ptr unmatch_cloud_ptr)
 {
-  match_cloud_ptr->points.clear();
-  unmatch_cloud_ptr->points.clear();
+  frame_pool_.clear(*match_cloud_ptr, in_cloud_ptr->points.size());
+  frame_pool_.clear(*unmatch_cloud_ptr, in_cloud_ptr->points.size());
 
-  match_cloud_ptr->points.reserve(in_cloud_ptr->points.size());
-  unmatch_cloud_ptr->points.reserve(in_cloud_ptr->points.size());
+  if (search_method_ == "voxel_hash")
+  {
+    for (size_t i = 0; i < in_cloud_ptr->points.size(); ++i)
+    {
+      if (voxel_hash_.isMatched(in_cloud_ptr->points[i]))
+      {
+        match_cloud_ptr->points.push_back(in_cloud_ptr->points[i]);
+      }
+      else
+      {
+        unmatch_cloud_ptr->points.push_back(in_cloud_ptr->points[i]);
+      }
+    }
+    return;
+  }
 
-  std::vector<int> nn_indices(1);
-  std::vector<float> nn_dists(1);
   const double squared_distance_threshold = distance_threshold_ * distance_threshold_;
 
   for (size_t i = 0; i < in_cloud_ptr->points.size(); ++i)
   {
-    tree_.nearestKSearch(in_cloud_ptr->points[i], 1, nn_indices, nn_dists);
-    if (nn_dists[0] <= squared_distance_threshold)
+    tree_.nearestKSearch(in_cloud_ptr->points[i], 1, nn_indices_, nn_dists_);
+    if (nn_dists_[0] <= squared_distance_threshold)
     {
       match_cloud_ptr->points.push_back(in_cloud_ptr->points[i]);
     }
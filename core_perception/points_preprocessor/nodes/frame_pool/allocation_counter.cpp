@@ -0,0 +1,35 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "points_preprocessor/frame_pool/allocation_counter.h"
+
+namespace
+{
+// Per thread, so that a node only counts the allocations of its callback and not those of the roscpp threads
+thread_local uint64_t thread_allocation_count = 0;
+}  // namespace
+
+namespace points_preprocessor
+{
+void countThreadAllocation()
+{
+  thread_allocation_count++;
+}
+
+uint64_t getThreadAllocationCount()
+{
+  return thread_allocation_count;
+}
+}  // namespace points_preprocessor
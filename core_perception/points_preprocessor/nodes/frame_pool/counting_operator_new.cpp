@@ -0,0 +1,109 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Replaces the global operator new and delete to count the allocations, so it may only be linked into executables
+#include "points_preprocessor/frame_pool/allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+void* allocate(std::size_t size)
+{
+  points_preprocessor::countThreadAllocation();
+  // operator new has to return a unique pointer for a size of 0
+  if (size == 0)
+  {
+    size = 1;
+  }
+  while (true)
+  {
+    void* ptr = std::malloc(size);
+    if (ptr != nullptr)
+    {
+      return ptr;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void* allocateNoThrow(std::size_t size) noexcept
+{
+  try
+  {
+    return allocate(size);
+  }
+  catch (const std::bad_alloc&)
+  {
+    return nullptr;
+  }
+}
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+  return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+  return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  return allocateNoThrow(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  return allocateNoThrow(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
@@ -14,6 +14,13 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <geometry_msgs/TwistStamped.h>
 #include <message_filters/subscriber.h>
 #include <message_filters/sync_policies/approximate_time.h>
 #include <message_filters/synchronizer.h>
@@ -28,10 +35,13 @@
 #include <velodyne_pointcloud/point_types.h>
 #include <yaml-cpp/yaml.h>
 
+#include "points_preprocessor/points_concat_filter/deskew.h"
+
 class PointsConcatFilter
 {
 public:
   PointsConcatFilter();
+  void run();
 
 private:
   typedef pcl::PointXYZI PointT;
@@ -52,6 +62,28 @@ private:
   size_t input_topics_size_;
   std::string input_topics_;
   std::string output_frame_id_;
+  std::string concat_mode_;
+
+  // deskew mode: each cloud is transformed and deskewed in its own callback as soon as it arrives, the
+  // concatenated cloud is published when the last cloud of a frame is ready
+  std::vector<ros::Subscriber> deskew_subscribers_;
+  ros::Subscriber twist_subscriber_;
+  double max_stamp_difference_;  // [s] a cloud further from the frame stamp starts a new frame
+
+  std::mutex twist_mutex_;
+  geometry_msgs::TwistStamped::ConstPtr twist_;
+
+  std::mutex frame_mutex_;
+  ros::Time frame_stamp_;                  // common stamp the clouds of the frame are deskewed to
+  size_t frame_id_;                        // incremented each time a new frame starts
+  std::vector<bool> frame_started_;        // a cloud of this input was assigned to the frame
+  std::vector<PointCloudT::Ptr> frame_clouds_;  // clouds of the frame, in output_frame_id_ at frame_stamp_
+  size_t frame_ready_num_;
+
+  void twist_callback(const geometry_msgs::TwistStamped::ConstPtr &msg);
+  void deskew_callback(const PointCloudMsgT::ConstPtr &msg, size_t input_index);
+  tf::Transform get_deskew_transform(double in_time_difference);
+  void publish_frame(const std::vector<PointCloudT::Ptr> &in_clouds, const ros::Time &in_stamp);
 
   void pointcloud_callback(const PointCloudMsgT::ConstPtr &msg1, const PointCloudMsgT::ConstPtr &msg2,
                            const PointCloudMsgT::ConstPtr &msg3, const PointCloudMsgT::ConstPtr &msg4,
@@ -59,13 +91,39 @@ private:
                            const PointCloudMsgT::ConstPtr &msg7, const PointCloudMsgT::ConstPtr &msg8);
 };
 
-PointsConcatFilter::PointsConcatFilter() : node_handle_(), private_node_handle_("~"), tf_listener_()
+PointsConcatFilter::PointsConcatFilter()
+  : node_handle_(), private_node_handle_("~"), tf_listener_(), frame_id_(0), frame_ready_num_(0)
 {
   private_node_handle_.param("input_topics", input_topics_, std::string("[/points_alpha, /points_beta]"));
   private_node_handle_.param("output_frame_id", output_frame_id_, std::string("velodyne"));
+  private_node_handle_.param("concat_mode", concat_mode_, std::string("approximate_time"));
 
   YAML::Node topics = YAML::Load(input_topics_);
   input_topics_size_ = topics.size();
+
+  if (concat_mode_ == "deskew")
+  {
+    std::string twist_topic;
+    private_node_handle_.param("twist_topic", twist_topic, std::string("/current_velocity"));
+    private_node_handle_.param("max_stamp_difference", max_stamp_difference_, 0.1);
+
+    if (input_topics_size_ < 2)
+    {
+      ROS_ERROR("The size of input_topics must be at least 2");
+      ros::shutdown();
+    }
+    frame_started_.assign(input_topics_size_, false);
+    frame_clouds_.resize(input_topics_size_);
+    for (size_t i = 0; i < input_topics_size_; ++i)
+    {
+      deskew_subscribers_.push_back(node_handle_.subscribe<PointCloudMsgT>(
+          topics[i].as<std::string>(), 1, boost::bind(&PointsConcatFilter::deskew_callback, this, _1, i)));
+    }
+    twist_subscriber_ = node_handle_.subscribe(twist_topic, 1, &PointsConcatFilter::twist_callback, this);
+    cloud_publisher_ = node_handle_.advertise<PointCloudMsgT>("/points_concat", 1);
+    return;
+  }
+
   if (input_topics_size_ < 2 || 8 < input_topics_size_)
   {
     ROS_ERROR("The size of input_topics must be between 2 and 8");
@@ -92,6 +150,165 @@ PointsConcatFilter::PointsConcatFilter() : node_handle_(), private_node_handle_(
   cloud_publisher_ = node_handle_.advertise<PointCloudMsgT>("/points_concat", 1);
 }
 
+void PointsConcatFilter::run()
+{
+  if (concat_mode_ == "deskew")
+  {
+    // one thread per input, so that the clouds are transformed in parallel
+    ros::AsyncSpinner spinner(input_topics_size_);
+    spinner.start();
+    ros::waitForShutdown();
+  }
+  else
+  {
+    ros::spin();
+  }
+}
+
+void PointsConcatFilter::twist_callback(const geometry_msgs::TwistStamped::ConstPtr &msg)
+{
+  std::lock_guard<std::mutex> lock(twist_mutex_);
+  twist_ = msg;
+}
+
+// Motion of output_frame_id_ between the frame stamp and a cloud stamp in_time_difference later, assuming a
+// constant twist. Applied to points of the cloud, it gives them in output_frame_id_ at the frame stamp.
+tf::Transform PointsConcatFilter::get_deskew_transform(double in_time_difference)
+{
+  geometry_msgs::TwistStamped::ConstPtr twist;
+  {
+    std::lock_guard<std::mutex> lock(twist_mutex_);
+    twist = twist_;
+  }
+  if (!twist)
+  {
+    ROS_WARN_THROTTLE(10, "No twist received, the clouds are not deskewed");
+    return tf::Transform::getIdentity();
+  }
+
+  tf::Vector3 linear, angular;
+  tf::vector3MsgToTF(twist->twist.linear, linear);
+  tf::vector3MsgToTF(twist->twist.angular, angular);
+
+  // express the twist at the origin of output_frame_id_
+  if (!twist->header.frame_id.empty() && twist->header.frame_id != output_frame_id_)
+  {
+    tf::StampedTransform twist_to_output;
+    tf_listener_.lookupTransform(output_frame_id_, twist->header.frame_id, ros::Time(0), twist_to_output);
+    points_preprocessor::transformTwist(twist_to_output, linear, angular);
+  }
+
+  return points_preprocessor::getDeskewTransform(linear, angular, in_time_difference);
+}
+
+void PointsConcatFilter::deskew_callback(const PointCloudMsgT::ConstPtr &msg, size_t input_index)
+{
+  std::vector<PointCloudT::Ptr> finished_clouds;
+  ros::Time finished_stamp;
+  ros::Time frame_stamp;
+  size_t frame_id;
+
+  // assign the cloud to a frame
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    const bool frame_empty = std::find(frame_started_.begin(), frame_started_.end(), true) == frame_started_.end();
+    if (frame_started_[input_index] ||
+        (!frame_empty && std::fabs((msg->header.stamp - frame_stamp_).toSec()) > max_stamp_difference_))
+    {
+      // a cloud is missing, publish what the frame has
+      for (size_t i = 0; i < input_topics_size_; ++i)
+      {
+        if (frame_clouds_[i])
+          finished_clouds.push_back(frame_clouds_[i]);
+      }
+      finished_stamp = frame_stamp_;
+      if (!finished_clouds.empty())
+        ROS_WARN_THROTTLE(10, "Publishing %zu of %zu clouds, the others did not arrive in time",
+                          finished_clouds.size(), input_topics_size_);
+      frame_started_.assign(input_topics_size_, false);
+      frame_clouds_.assign(input_topics_size_, PointCloudT::Ptr());
+      frame_ready_num_ = 0;
+    }
+    if (std::find(frame_started_.begin(), frame_started_.end(), true) == frame_started_.end())
+    {
+      // first cloud of a new frame
+      frame_stamp_ = msg->header.stamp;
+      frame_id_++;
+    }
+    frame_started_[input_index] = true;
+    frame_stamp = frame_stamp_;
+    frame_id = frame_id_;
+  }
+  if (!finished_clouds.empty())
+  {
+    publish_frame(finished_clouds, finished_stamp);
+    finished_clouds.clear();
+  }
+
+  // transform and deskew without holding the lock, in parallel with the other inputs
+  PointCloudT::Ptr cloud(new PointCloudT);
+  pcl::fromROSMsg(*msg, *cloud);
+  try
+  {
+    tf::StampedTransform sensor_to_output;
+    tf_listener_.waitForTransform(output_frame_id_, msg->header.frame_id, msg->header.stamp, ros::Duration(1.0));
+    tf_listener_.lookupTransform(output_frame_id_, msg->header.frame_id, msg->header.stamp, sensor_to_output);
+    const tf::Transform deskew = get_deskew_transform((msg->header.stamp - frame_stamp).toSec());
+    pcl_ros::transformPointCloud(*cloud, *cloud, deskew * sensor_to_output);
+  }
+  catch (tf::TransformException &ex)
+  {
+    ROS_ERROR("%s", ex.what());
+    return;
+  }
+  cloud->header.frame_id = output_frame_id_;
+
+  // store the cloud, the last one of the frame publishes it
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    if (frame_id != frame_id_)
+    {
+      ROS_WARN_THROTTLE(10, "Dropping a cloud that arrived after its frame was published");
+      return;
+    }
+    frame_clouds_[input_index] = cloud;
+    frame_ready_num_++;
+    if (frame_ready_num_ == input_topics_size_)
+    {
+      finished_clouds.swap(frame_clouds_);
+      finished_stamp = frame_stamp_;
+      frame_started_.assign(input_topics_size_, false);
+      frame_clouds_.assign(input_topics_size_, PointCloudT::Ptr());
+      frame_ready_num_ = 0;
+    }
+  }
+  if (!finished_clouds.empty())
+  {
+    publish_frame(finished_clouds, finished_stamp);
+  }
+}
+
+void PointsConcatFilter::publish_frame(const std::vector<PointCloudT::Ptr> &in_clouds, const ros::Time &in_stamp)
+{
+  PointCloudT::Ptr cloud_concatenated(new PointCloudT);
+  size_t points_num = 0;
+  for (const PointCloudT::Ptr &cloud : in_clouds)
+  {
+    points_num += cloud->points.size();
+  }
+  cloud_concatenated->points.reserve(points_num);
+  for (const PointCloudT::Ptr &cloud : in_clouds)
+  {
+    *cloud_concatenated += *cloud;
+  }
+
+  std_msgs::Header header;
+  header.stamp = in_stamp;
+  header.frame_id = output_frame_id_;
+  cloud_concatenated->header = pcl_conversions::toPCL(header);
+  cloud_publisher_.publish(cloud_concatenated);
+}
+
 void PointsConcatFilter::pointcloud_callback(const PointCloudMsgT::ConstPtr &msg1, const PointCloudMsgT::ConstPtr &msg2,
                                              const PointCloudMsgT::ConstPtr &msg3, const PointCloudMsgT::ConstPtr &msg4,
                                              const PointCloudMsgT::ConstPtr &msg5, const PointCloudMsgT::ConstPtr &msg6,
@@ -138,6 +355,6 @@ int main(int argc, char **argv)
 {
   ros::init(argc, argv, "points_concat_filter");
   PointsConcatFilter node;
-  ros::spin();
+  node.run();
   return 0;
 }
@@ -17,6 +17,7 @@
  */
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 #include <vector>
 #include <string>
 #include <ros/ros.h>
@@ -27,7 +28,6 @@
 #include <pcl/point_types.h>
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/normal_3d_omp.h>
-#include <pcl/filters/extract_indices.h>
 #include <velodyne_pointcloud/point_types.h>
 #include "autoware_config_msgs/ConfigRayGroundFilter.h"
 
@@ -40,6 +40,10 @@
 
 #include "points_preprocessor/ray_ground_filter/ray_ground_filter.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 void RayGroundFilter::update_config_params(const autoware_config_msgs::ConfigRayGroundFilter::ConstPtr& param)
 {
   general_max_slope_ = param->general_max_slope;
@@ -56,6 +60,7 @@ bool RayGroundFilter::TransformPointCloud(const std::string& in_target_frame,
                                           const sensor_msgs::PointCloud2::ConstPtr& in_cloud_ptr,
                                           const sensor_msgs::PointCloud2::Ptr& out_cloud_ptr)
 {
+  frame_pool_.reserve(out_cloud_ptr->data, in_cloud_ptr->data.size());
   if (in_target_frame == in_cloud_ptr->header.frame_id)
   {
     *out_cloud_ptr = *in_cloud_ptr;
@@ -65,7 +70,7 @@ bool RayGroundFilter::TransformPointCloud(const std::string& in_target_frame,
   geometry_msgs::TransformStamped transform_stamped;
   try
   {
-    transform_stamped = tf_buffer_.lookupTransform(in_target_frame, in_cloud_ptr->header.frame_id,
+    transform_stamped = tf_buffer_->lookupTransform(in_target_frame, in_cloud_ptr->header.frame_id,
                                                    in_cloud_ptr->header.stamp, ros::Duration(1.0));
   }
   catch (tf2::TransformException& ex)
@@ -82,25 +87,28 @@ bool RayGroundFilter::TransformPointCloud(const std::string& in_target_frame,
 
 void RayGroundFilter::publish_cloud(const ros::Publisher& in_publisher,
                                     const pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_to_publish_ptr,
-                                    const std_msgs::Header& in_header)
+                                    const std_msgs::Header& in_header,
+                                    const sensor_msgs::PointCloud2::Ptr& out_cloud_msg_ptr,
+                                    const sensor_msgs::PointCloud2::Ptr& out_trans_cloud_msg_ptr)
 {
-  sensor_msgs::PointCloud2::Ptr cloud_msg_ptr(new sensor_msgs::PointCloud2);
-  sensor_msgs::PointCloud2::Ptr trans_cloud_msg_ptr(new sensor_msgs::PointCloud2);
-  pcl::toROSMsg(*in_cloud_to_publish_ptr, *cloud_msg_ptr);
-  cloud_msg_ptr->header.frame_id = base_frame_;
-  cloud_msg_ptr->header.stamp = in_header.stamp;
-  const bool succeeded = TransformPointCloud(in_header.frame_id, cloud_msg_ptr, trans_cloud_msg_ptr);
+  frame_pool_.toROSMsg(*in_cloud_to_publish_ptr, *out_cloud_msg_ptr);
+  out_cloud_msg_ptr->header.frame_id = base_frame_;
+  out_cloud_msg_ptr->header.stamp = in_header.stamp;
+  const bool succeeded = TransformPointCloud(in_header.frame_id, out_cloud_msg_ptr, out_trans_cloud_msg_ptr);
   if (!succeeded)
   {
-    ROS_ERROR_STREAM_THROTTLE(10, "Failed transform from " << cloud_msg_ptr->header.frame_id << " to "
+    ROS_ERROR_STREAM_THROTTLE(10, "Failed transform from " << out_cloud_msg_ptr->header.frame_id << " to "
                                                            << in_header.frame_id);
     return;
   }
-  in_publisher.publish(*trans_cloud_msg_ptr);
+  in_publisher.publish(*out_trans_cloud_msg_ptr);
 }
 
 /*!
- *
+ * Bins the points into radial divisions with a counting sort: each thread counts the points of its part of
+ * the cloud per division, a prefix sum over the threads gives where each thread writes in each division,
+ * then the points are scattered without locks. Points keep their input order inside a division before
+ * being sorted by radius.
  * @param[in] in_cloud Input Point Cloud to be organized in radial segments
  * @param[out] out_organized_points Custom Point Cloud filled with XYZRTZColor data
  * @param[out] out_radial_divided_indices Indices of the points in the original cloud for each radial segment
@@ -112,54 +120,113 @@ void RayGroundFilter::ConvertXYZIToRTZColor(
     const std::shared_ptr<std::vector<pcl::PointIndices> >& out_radial_divided_indices,
     const std::shared_ptr<std::vector<PointCloudXYZIRTColor> >& out_radial_ordered_clouds)
 {
-  out_organized_points->resize(in_cloud->points.size());
-  out_radial_divided_indices->clear();
-  out_radial_divided_indices->resize(radial_dividers_num_);
-  out_radial_ordered_clouds->resize(radial_dividers_num_);
+  const size_t points_num = in_cloud->points.size();
+
+  frame_pool_.resize(*out_organized_points, points_num);
+  frame_pool_.resize(*out_radial_divided_indices, radial_dividers_num_);
+  frame_pool_.resize(*out_radial_ordered_clouds, radial_dividers_num_);
+
+  size_t max_threads_num = 1;
+#ifdef _OPENMP
+  max_threads_num = omp_get_max_threads();
+#endif
+  frame_pool_.resize(radial_histogram_, max_threads_num * radial_dividers_num_);
+  std::fill(radial_histogram_.begin(), radial_histogram_.end(), 0);
 
-  for (size_t i = 0; i < in_cloud->points.size(); i++)
+#pragma omp parallel num_threads(max_threads_num)
   {
-    PointXYZIRTColor new_point;
-    auto radius = static_cast<float>(
-        sqrt(in_cloud->points[i].x * in_cloud->points[i].x + in_cloud->points[i].y * in_cloud->points[i].y));
-    auto theta = static_cast<float>(atan2(in_cloud->points[i].y, in_cloud->points[i].x) * 180 / M_PI);
-    if (theta < 0)
-    {
-      theta += 360;
-    }
-    if (theta >= 360)
+    size_t thread_id = 0;
+    size_t threads_num = 1;
+#ifdef _OPENMP
+    thread_id = omp_get_thread_num();
+    threads_num = omp_get_num_threads();
+#endif
+    // Each thread handles a contiguous part of the cloud, in the order of the thread ids
+    const size_t begin = points_num * thread_id / threads_num;
+    const size_t end = points_num * (thread_id + 1) / threads_num;
+    size_t* histogram = &radial_histogram_[thread_id * radial_dividers_num_];
+
+    // Pass 1: convert to cylindrical coordinates and count the points of each radial division
+    for (size_t i = begin; i < end; i++)
     {
-      theta -= 360;
+      PointXYZIRTColor& new_point = (*out_organized_points)[i];
+      auto radius = static_cast<float>(
+          sqrt(in_cloud->points[i].x * in_cloud->points[i].x + in_cloud->points[i].y * in_cloud->points[i].y));
+      auto theta = static_cast<float>(atan2(in_cloud->points[i].y, in_cloud->points[i].x) * 180 / M_PI);
+      if (theta < 0)
+      {
+        theta += 360;
+      }
+      if (theta >= 360)
+      {
+        theta -= 360;
+      }
+
+      auto radial_div = (size_t)floor(theta / radial_divider_angle_);
+      // radial_dividers_num_ is rounded up, but guard against rounding of theta close to 360
+      if (radial_div >= radial_dividers_num_)
+      {
+        radial_div = radial_dividers_num_ - 1;
+      }
+
+      // a distance of 0, the default, disables the concentric divisions
+      size_t concentric_div = 0;
+      if (concentric_divider_distance_ > 0)
+      {
+        concentric_div = (size_t)floor(fabs(radius / concentric_divider_distance_));
+      }
+
+      new_point.point = in_cloud->points[i];
+      new_point.radius = radius;
+      new_point.theta = theta;
+      new_point.radial_div = radial_div;
+      new_point.concentric_div = concentric_div;
+      new_point.red = (size_t)colors_[new_point.radial_div % color_num_].val[0];
+      new_point.green = (size_t)colors_[new_point.radial_div % color_num_].val[1];
+      new_point.blue = (size_t)colors_[new_point.radial_div % color_num_].val[2];
+      new_point.original_index = i;
+
+      histogram[radial_div]++;
     }
 
-    auto radial_div = (size_t)floor(theta / radial_divider_angle_);
+#pragma omp barrier
 
-    auto concentric_div = (size_t)floor(fabs(radius / concentric_divider_distance_));
+// Prefix sum over the threads: turn the counts into the first position of each thread in each division
+#pragma omp for
+    for (size_t div = 0; div < radial_dividers_num_; div++)
+    {
+      size_t count = 0;
+      for (size_t t = 0; t < threads_num; t++)
+      {
+        size_t thread_count = radial_histogram_[t * radial_dividers_num_ + div];
+        radial_histogram_[t * radial_dividers_num_ + div] = count;
+        count += thread_count;
+      }
 
-    new_point.point = in_cloud->points[i];
-    new_point.radius = radius;
-    new_point.theta = theta;
-    new_point.radial_div = radial_div;
-    new_point.concentric_div = concentric_div;
-    new_point.red = (size_t)colors_[new_point.radial_div % color_num_].val[0];
-    new_point.green = (size_t)colors_[new_point.radial_div % color_num_].val[1];
-    new_point.blue = (size_t)colors_[new_point.radial_div % color_num_].val[2];
-    new_point.original_index = i;
+      // Keeps the capacity of the previous frames
+      frame_pool_.resize((*out_radial_ordered_clouds)[div], count);
+      frame_pool_.resize((*out_radial_divided_indices)[div].indices, count);
+    }
 
-    out_organized_points->at(i) = new_point;
+    // Pass 2: scatter the points, every thread writes to its own range of each division
+    for (size_t i = begin; i < end; i++)
+    {
+      const PointXYZIRTColor& point = (*out_organized_points)[i];
+      size_t position = histogram[point.radial_div]++;
 
-    // radial divisions
-    out_radial_divided_indices->at(radial_div).indices.push_back(i);
+      (*out_radial_ordered_clouds)[point.radial_div][position] = point;
+      (*out_radial_divided_indices)[point.radial_div].indices[position] = i;
+    }
 
-    out_radial_ordered_clouds->at(radial_div).push_back(new_point);
-  }  // end for
+#pragma omp barrier
 
 // order radial points on each division
-#pragma omp for
-  for (size_t i = 0; i < radial_dividers_num_; i++)
-  {
-    std::sort(out_radial_ordered_clouds->at(i).begin(), out_radial_ordered_clouds->at(i).end(),
-              [](const PointXYZIRTColor& a, const PointXYZIRTColor& b) { return a.radius < b.radius; });  // NOLINT
+#pragma omp for schedule(dynamic, 16)
+    for (size_t i = 0; i < radial_dividers_num_; i++)
+    {
+      std::sort((*out_radial_ordered_clouds)[i].begin(), (*out_radial_ordered_clouds)[i].end(),
+                [](const PointXYZIRTColor& a, const PointXYZIRTColor& b) { return a.radius < b.radius; });  // NOLINT
+    }
   }
 }
 
@@ -255,21 +322,43 @@ void RayGroundFilter::ClassifyPointCloud(const std::vector<PointCloudXYZIRTColor
 void RayGroundFilter::ClipCloud(const pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_ptr, const double in_clip_height,
                                 pcl::PointCloud<pcl::PointXYZI>::Ptr out_clipped_cloud_ptr)
 {
-  pcl::ExtractIndices<pcl::PointXYZI> extractor;
-  extractor.setInputCloud(in_cloud_ptr);
-  pcl::PointIndices indices;
+  frame_pool_.clear(*out_clipped_cloud_ptr, in_cloud_ptr->points.size());
+  out_clipped_cloud_ptr->header = in_cloud_ptr->header;
 
-#pragma omp for
   for (size_t i = 0; i < in_cloud_ptr->points.size(); i++)
   {
-    if (in_cloud_ptr->points[i].z > in_clip_height)
+    if (!(in_cloud_ptr->points[i].z > in_clip_height))
     {
-      indices.indices.push_back(i);
+      out_clipped_cloud_ptr->points.push_back(in_cloud_ptr->points[i]);
     }
   }
-  extractor.setIndices(boost::make_shared<pcl::PointIndices>(indices));
-  extractor.setNegative(true);  // true removes the indices, false leaves only the indices
-  extractor.filter(*out_clipped_cloud_ptr);
+  out_clipped_cloud_ptr->width = out_clipped_cloud_ptr->points.size();
+}
+
+/*!
+ * Removes the points higher than a threshold, reading the input in place instead of converting it first
+ * @param in_cloud_view View over the PointCloud2 to perform Clipping
+ * @param in_clip_height Maximum allowed height in the cloud
+ * @param out_clipped_cloud_ptr Resultung PointCloud with the points removed
+ */
+void RayGroundFilter::ClipCloud(const pointcloud2_view::PointCloud2View& in_cloud_view, const double in_clip_height,
+                                pcl::PointCloud<pcl::PointXYZI>::Ptr out_clipped_cloud_ptr)
+{
+  frame_pool_.clear(*out_clipped_cloud_ptr, in_cloud_view.size());
+
+  pcl::PointXYZI point;
+  for (size_t i = 0; i < in_cloud_view.size(); i++)
+  {
+    point.z = in_cloud_view.z(i);
+    if (!(point.z > in_clip_height))
+    {
+      point.x = in_cloud_view.x(i);
+      point.y = in_cloud_view.y(i);
+      point.intensity = in_cloud_view.intensity(i);
+      out_clipped_cloud_ptr->points.push_back(point);
+    }
+  }
+  out_clipped_cloud_ptr->width = out_clipped_cloud_ptr->points.size();
 }
 
 /*!
@@ -285,15 +374,31 @@ void RayGroundFilter::ExtractPointsIndices(const pcl::PointCloud<pcl::PointXYZI>
                                            pcl::PointCloud<pcl::PointXYZI>::Ptr out_only_indices_cloud_ptr,
                                            pcl::PointCloud<pcl::PointXYZI>::Ptr out_removed_indices_cloud_ptr)
 {
-  pcl::ExtractIndices<pcl::PointXYZI> extract_ground;
-  extract_ground.setInputCloud(in_cloud_ptr);
-  extract_ground.setIndices(boost::make_shared<pcl::PointIndices>(in_indices));
+  const size_t points_num = in_cloud_ptr->points.size();
 
-  extract_ground.setNegative(false);  // true removes the indices, false leaves only the indices
-  extract_ground.filter(*out_only_indices_cloud_ptr);
+  frame_pool_.clear(*out_only_indices_cloud_ptr, in_indices.indices.size());
+  frame_pool_.clear(*out_removed_indices_cloud_ptr, points_num);
+  out_only_indices_cloud_ptr->header = in_cloud_ptr->header;
+  out_removed_indices_cloud_ptr->header = in_cloud_ptr->header;
 
-  extract_ground.setNegative(true);  // true removes the indices, false leaves only the indices
-  extract_ground.filter(*out_removed_indices_cloud_ptr);
+  frame_pool_.resize(extract_mask_, points_num);
+  std::fill(extract_mask_.begin(), extract_mask_.end(), 0);
+
+  // the kept points are in the order of the indices, the removed ones in the order of the cloud
+  for (const int index : in_indices.indices)
+  {
+    out_only_indices_cloud_ptr->points.push_back(in_cloud_ptr->points[index]);
+    extract_mask_[index] = 1;
+  }
+  for (size_t i = 0; i < points_num; i++)
+  {
+    if (!extract_mask_[i])
+    {
+      out_removed_indices_cloud_ptr->points.push_back(in_cloud_ptr->points[i]);
+    }
+  }
+  out_only_indices_cloud_ptr->width = out_only_indices_cloud_ptr->points.size();
+  out_removed_indices_cloud_ptr->width = out_removed_indices_cloud_ptr->points.size();
 }
 
 /*!
@@ -305,22 +410,18 @@ void RayGroundFilter::ExtractPointsIndices(const pcl::PointCloud<pcl::PointXYZI>
 void RayGroundFilter::RemovePointsUpTo(const pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_ptr, double in_min_distance,
                                        pcl::PointCloud<pcl::PointXYZI>::Ptr out_filtered_cloud_ptr)
 {
-  pcl::ExtractIndices<pcl::PointXYZI> extractor;
-  extractor.setInputCloud(in_cloud_ptr);
-  pcl::PointIndices indices;
+  frame_pool_.clear(*out_filtered_cloud_ptr, in_cloud_ptr->points.size());
+  out_filtered_cloud_ptr->header = in_cloud_ptr->header;
 
-#pragma omp for
   for (size_t i = 0; i < in_cloud_ptr->points.size(); i++)
   {
-    if (sqrt(in_cloud_ptr->points[i].x * in_cloud_ptr->points[i].x +
-             in_cloud_ptr->points[i].y * in_cloud_ptr->points[i].y) < in_min_distance)
+    if (!(sqrt(in_cloud_ptr->points[i].x * in_cloud_ptr->points[i].x +
+               in_cloud_ptr->points[i].y * in_cloud_ptr->points[i].y) < in_min_distance))
     {
-      indices.indices.push_back(i);
+      out_filtered_cloud_ptr->points.push_back(in_cloud_ptr->points[i]);
     }
   }
-  extractor.setIndices(boost::make_shared<pcl::PointIndices>(indices));
-  extractor.setNegative(true);  // true removes the indices, false leaves only the indices
-  extractor.filter(*out_filtered_cloud_ptr);
+  out_filtered_cloud_ptr->width = out_filtered_cloud_ptr->points.size();
 }
 
 void RayGroundFilter::CloudCallback(const sensor_msgs::PointCloud2ConstPtr& in_sensor_cloud)
@@ -328,8 +429,27 @@ void RayGroundFilter::CloudCallback(const sensor_msgs::PointCloud2ConstPtr& in_s
   health_checker_ptr_->NODE_ACTIVATE();
   health_checker_ptr_->CHECK_RATE("topic_rate_points_raw_slow", 8, 5, 1, "topic points_raw subscribe rate slow.");
 
-  sensor_msgs::PointCloud2::Ptr trans_sensor_cloud(new sensor_msgs::PointCloud2);
-  const bool succeeded = TransformPointCloud(base_frame_, in_sensor_cloud, trans_sensor_cloud);
+  frame_pool_.startFrame();
+
+  // Time spent in each stage [ms], published on the stage time topic
+  size_t stage = 0;
+  auto stage_start = std::chrono::steady_clock::now();
+  auto end_stage = [this, &stage, &stage_start](const char* in_stage_name) {
+    auto stage_end = std::chrono::steady_clock::now();
+    if (stage_time_.layout.dim.size() <= stage)
+    {
+      std_msgs::MultiArrayDimension dim;
+      dim.label = in_stage_name;
+      dim.size = 1;
+      dim.stride = 1;
+      stage_time_.layout.dim.push_back(dim);
+      stage_time_.data.push_back(0.f);
+    }
+    stage_time_.data[stage++] = std::chrono::duration<float, std::milli>(stage_end - stage_start).count();
+    stage_start = stage_end;
+  };
+
+  const bool succeeded = TransformPointCloud(base_frame_, in_sensor_cloud, trans_sensor_cloud_ptr_);
   if (!succeeded)
   {
     ROS_ERROR_STREAM_THROTTLE(10, "Failed transform from " << base_frame_ << " to "
@@ -337,50 +457,76 @@ void RayGroundFilter::CloudCallback(const sensor_msgs::PointCloud2ConstPtr& in_s
     return;
   }
 
-  pcl::PointCloud<pcl::PointXYZI>::Ptr current_sensor_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  pcl::fromROSMsg(*trans_sensor_cloud, *current_sensor_cloud_ptr);
+  end_stage("transform");
 
-  pcl::PointCloud<pcl::PointXYZI>::Ptr clipped_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-
-  // remove points above certain point
-  ClipCloud(current_sensor_cloud_ptr, clipping_height_, clipped_cloud_ptr);
+  // remove points above certain point, reading them directly from the message
+  try
+  {
+    pointcloud2_view::PointCloud2View sensor_cloud_view(*trans_sensor_cloud_ptr_);
+    ClipCloud(sensor_cloud_view, clipping_height_, clipped_cloud_ptr_);
+  }
+  catch (std::runtime_error& ex)
+  {
+    ROS_ERROR_STREAM_THROTTLE(10, ex.what());
+    return;
+  }
+  pcl_conversions::toPCL(trans_sensor_cloud_ptr_->header, clipped_cloud_ptr_->header);
+  end_stage("clip");
 
   // remove closer points than a threshold
-  pcl::PointCloud<pcl::PointXYZI>::Ptr filtered_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  RemovePointsUpTo(clipped_cloud_ptr, min_point_distance_, filtered_cloud_ptr);
+  RemovePointsUpTo(clipped_cloud_ptr_, min_point_distance_, filtered_cloud_ptr_);
+  end_stage("remove_close_points");
 
   // GetCloud Normals
   // pcl::PointCloud<pcl::PointXYZINormal>::Ptr cloud_with_normals_ptr (new pcl::PointCloud<pcl::PointXYZINormal>);
   // GetCloudNormals(current_sensor_cloud_ptr, cloud_with_normals_ptr, 5.0);
 
-  std::shared_ptr<PointCloudXYZIRTColor> organized_points(new PointCloudXYZIRTColor);
-  std::shared_ptr<std::vector<pcl::PointIndices> > radial_division_indices(new std::vector<pcl::PointIndices>);
-  std::shared_ptr<std::vector<PointCloudXYZIRTColor> > radial_ordered_clouds(new std::vector<PointCloudXYZIRTColor>);
-
   radial_dividers_num_ = ceil(360 / radial_divider_angle_);
 
-  ConvertXYZIToRTZColor(filtered_cloud_ptr, organized_points, radial_division_indices, radial_ordered_clouds);
+  ConvertXYZIToRTZColor(filtered_cloud_ptr_, organized_points_, radial_division_indices_, radial_ordered_clouds_);
+  end_stage("radial_binning");
 
-  pcl::PointIndices::Ptr ground_indices(new pcl::PointIndices), no_ground_indices(new pcl::PointIndices);
+  frame_pool_.reserve(ground_indices_->indices, filtered_cloud_ptr_->points.size());
+  frame_pool_.reserve(no_ground_indices_->indices, filtered_cloud_ptr_->points.size());
 
-  ClassifyPointCloud(*radial_ordered_clouds, ground_indices, no_ground_indices);
+  ClassifyPointCloud(*radial_ordered_clouds_, ground_indices_, no_ground_indices_);
+  end_stage("classify");
 
-  pcl::PointCloud<pcl::PointXYZI>::Ptr ground_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
-  pcl::PointCloud<pcl::PointXYZI>::Ptr no_ground_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
+  ExtractPointsIndices(filtered_cloud_ptr_, *ground_indices_, ground_cloud_ptr_, no_ground_cloud_ptr_);
+  end_stage("extract");
 
-  ExtractPointsIndices(filtered_cloud_ptr, *ground_indices, ground_cloud_ptr, no_ground_cloud_ptr);
+  publish_cloud(ground_points_pub_, ground_cloud_ptr_, in_sensor_cloud->header, ground_cloud_msg_ptr_,
+                trans_ground_cloud_msg_ptr_);
+  publish_cloud(groundless_points_pub_, no_ground_cloud_ptr_, in_sensor_cloud->header, no_ground_cloud_msg_ptr_,
+                trans_no_ground_cloud_msg_ptr_);
+  end_stage("publish");
 
-  publish_cloud(ground_points_pub_, ground_cloud_ptr, in_sensor_cloud->header);
-  publish_cloud(groundless_points_pub_, no_ground_cloud_ptr, in_sensor_cloud->header);
-}
+  stage_time_pub_.publish(stage_time_);
 
-RayGroundFilter::RayGroundFilter() : node_handle_("~"), tf_listener_(tf_buffer_)
+  // The stage times reuse their message. What remains in every frame: the tf2 lookups, which return the frame
+  // names in a new message, roscpp serializing each published message into a new buffer, and the OpenMP workers,
+  // which are not counted.
+  std_msgs::UInt32 frame_allocations;
+  frame_allocations.data = frame_pool_.getFrameAllocationCount();
+  frame_allocations_pub_.publish(frame_allocations);
+}
 
+RayGroundFilter::RayGroundFilter()
+  : trans_sensor_cloud_ptr_(new sensor_msgs::PointCloud2)
+  , clipped_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , filtered_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , organized_points_(new PointCloudXYZIRTColor)
+  , radial_division_indices_(new std::vector<pcl::PointIndices>)
+  , radial_ordered_clouds_(new std::vector<PointCloudXYZIRTColor>)
+  , ground_indices_(new pcl::PointIndices)
+  , no_ground_indices_(new pcl::PointIndices)
+  , ground_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , no_ground_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZI>)
+  , ground_cloud_msg_ptr_(new sensor_msgs::PointCloud2)
+  , trans_ground_cloud_msg_ptr_(new sensor_msgs::PointCloud2)
+  , no_ground_cloud_msg_ptr_(new sensor_msgs::PointCloud2)
+  , trans_no_ground_cloud_msg_ptr_(new sensor_msgs::PointCloud2)
 {
-  ros::NodeHandle nh;
-  ros::NodeHandle pnh("~");
-  health_checker_ptr_ = std::make_shared<autoware_health_checker::HealthChecker>(nh, pnh);
-  health_checker_ptr_->ENABLE();
 }
 
 void RayGroundFilter::Run()
@@ -392,29 +538,36 @@ void RayGroundFilter::Run()
   // VLP-16  |     0.1-0.4    |     2.0      |  -15.0<=x<=15.0   (30    / 0.52)
   // VLP-16HD|     0.1-0.4    |     1.33     |  -10.0<=x<=10.0   (20    / 0.35)
   ROS_INFO("Initializing Ground Filter, please wait...");
-  node_handle_.param<std::string>("input_point_topic", input_point_topic_, "/points_raw");
+  ros::NodeHandle nh;
+  ros::NodeHandle node_handle("~");
+  health_checker_ptr_ = std::make_shared<autoware_health_checker::HealthChecker>(nh, node_handle);
+  health_checker_ptr_->ENABLE();
+  tf_buffer_.reset(new tf2_ros::Buffer);
+  tf_listener_.reset(new tf2_ros::TransformListener(*tf_buffer_));
+
+  node_handle.param<std::string>("input_point_topic", input_point_topic_, "/points_raw");
   ROS_INFO("Input point_topic: %s", input_point_topic_.c_str());
 
-  node_handle_.param<std::string>("base_frame", base_frame_, "base_link");
+  node_handle.param<std::string>("base_frame", base_frame_, "base_link");
   ROS_INFO("base_frame: %s", base_frame_.c_str());
 
-  node_handle_.param("general_max_slope", general_max_slope_, 3.0);
+  node_handle.param("general_max_slope", general_max_slope_, 3.0);
   ROS_INFO("general_max_slope[deg]: %f", general_max_slope_);
 
-  node_handle_.param("local_max_slope", local_max_slope_, 5.0);
+  node_handle.param("local_max_slope", local_max_slope_, 5.0);
   ROS_INFO("local_max_slope[deg]: %f", local_max_slope_);
 
-  node_handle_.param("radial_divider_angle", radial_divider_angle_, 0.1);  // 1 degree default
+  node_handle.param("radial_divider_angle", radial_divider_angle_, 0.1);  // 1 degree default
   ROS_INFO("radial_divider_angle[deg]: %f", radial_divider_angle_);
-  node_handle_.param("concentric_divider_distance", concentric_divider_distance_, 0.0);  // 0.0 meters default
+  node_handle.param("concentric_divider_distance", concentric_divider_distance_, 0.0);  // 0.0 meters default
   ROS_INFO("concentric_divider_distance[meters]: %f", concentric_divider_distance_);
-  node_handle_.param("min_height_threshold", min_height_threshold_, 0.05);  // 0.05 meters default
+  node_handle.param("min_height_threshold", min_height_threshold_, 0.05);  // 0.05 meters default
   ROS_INFO("min_height_threshold[meters]: %f", min_height_threshold_);
-  node_handle_.param("clipping_height", clipping_height_, 2.0);  // 2.0 meters default above the car
+  node_handle.param("clipping_height", clipping_height_, 2.0);  // 2.0 meters default above the car
   ROS_INFO("clipping_height[meters]: %f", clipping_height_);
-  node_handle_.param("min_point_distance", min_point_distance_, 1.85);  // 1.85 meters default
+  node_handle.param("min_point_distance", min_point_distance_, 1.85);  // 1.85 meters default
   ROS_INFO("min_point_distance[meters]: %f", min_point_distance_);
-  node_handle_.param("reclass_distance_threshold", reclass_distance_threshold_, 0.2);  // 0.5 meters default
+  node_handle.param("reclass_distance_threshold", reclass_distance_threshold_, 0.2);  // 0.5 meters default
   ROS_INFO("reclass_distance_threshold[meters]: %f", reclass_distance_threshold_);
 
 #if (CV_MAJOR_VERSION == 3)
@@ -427,19 +580,28 @@ void RayGroundFilter::Run()
   ROS_INFO("Radial Divisions: %d", (int)radial_dividers_num_);
 
   std::string no_ground_topic, ground_topic;
-  node_handle_.param<std::string>("no_ground_point_topic", no_ground_topic, "/points_no_ground");
+  node_handle.param<std::string>("no_ground_point_topic", no_ground_topic, "/points_no_ground");
   ROS_INFO("No Ground Output Point Cloud no_ground_point_topic: %s", no_ground_topic.c_str());
-  node_handle_.param<std::string>("ground_point_topic", ground_topic, "/points_ground");
+  node_handle.param<std::string>("ground_point_topic", ground_topic, "/points_ground");
   ROS_INFO("Only Ground Output Point Cloud ground_topic: %s", ground_topic.c_str());
+  std::string stage_time_topic;
+  node_handle.param<std::string>("stage_time_topic", stage_time_topic, "/ray_ground_filter/stage_time");
+  ROS_INFO("Processing time of each stage stage_time_topic: %s", stage_time_topic.c_str());
+  std::string frame_allocations_topic;
+  node_handle.param<std::string>("frame_allocations_topic", frame_allocations_topic,
+                                  "/ray_ground_filter/frame_allocations");
+  ROS_INFO("Heap allocations of each frame frame_allocations_topic: %s", frame_allocations_topic.c_str());
 
   ROS_INFO("Subscribing to... %s", input_point_topic_.c_str());
-  points_node_sub_ = node_handle_.subscribe(input_point_topic_, 1, &RayGroundFilter::CloudCallback, this);
+  points_node_sub_ = node_handle.subscribe(input_point_topic_, 1, &RayGroundFilter::CloudCallback, this);
 
   config_node_sub_ =
-      node_handle_.subscribe("/config/ray_ground_filter", 1, &RayGroundFilter::update_config_params, this);
+      node_handle.subscribe("/config/ray_ground_filter", 1, &RayGroundFilter::update_config_params, this);
 
-  groundless_points_pub_ = node_handle_.advertise<sensor_msgs::PointCloud2>(no_ground_topic, 2);
-  ground_points_pub_ = node_handle_.advertise<sensor_msgs::PointCloud2>(ground_topic, 2);
+  groundless_points_pub_ = node_handle.advertise<sensor_msgs::PointCloud2>(no_ground_topic, 2);
+  ground_points_pub_ = node_handle.advertise<sensor_msgs::PointCloud2>(ground_topic, 2);
+  stage_time_pub_ = node_handle.advertise<std_msgs::Float32MultiArray>(stage_time_topic, 2);
+  frame_allocations_pub_ = node_handle.advertise<std_msgs::UInt32>(frame_allocations_topic, 2);
 
   ROS_INFO("Ready");
 
@@ -7,12 +7,15 @@
  */
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
+#include <std_msgs/UInt32.h>
 #include <pcl_ros/point_cloud.h>
 #include <pcl_conversions/pcl_conversions.h>
 #include <pcl/point_types.h>
 #include <velodyne_pointcloud/point_types.h>
 #include <opencv/cv.h>
 
+#include "points_preprocessor/frame_pool/frame_pool.h"
+
 enum Label
 {
 	GROUND,
@@ -32,6 +35,7 @@ private:
 	ros::Subscriber points_node_sub_;
 	ros::Publisher groundless_points_pub_;
 	ros::Publisher ground_points_pub_;
+	ros::Publisher frame_allocations_pub_;
 
 	std::string point_topic_;
 	std::string no_ground_topic, ground_topic;
@@ -47,6 +51,14 @@ private:
 	Label 		class_label_[64];
 	double	radius_table_[64];
 
+	//Buffers reused across frames
+	points_preprocessor::FramePool 	frame_pool_;
+	pcl::PointCloud<velodyne_pointcloud::PointXYZIR>::Ptr 	in_cloud_ptr_;
+	pcl::PointCloud<velodyne_pointcloud::PointXYZIR> 		vertical_points_;
+	pcl::PointCloud<velodyne_pointcloud::PointXYZIR> 		ground_points_;
+	sensor_msgs::PointCloud2 	groundless_points_msg_;
+	sensor_msgs::PointCloud2 	ground_points_msg_;
+
 	//boost::chrono::high_resolution_clock::time_point t1_;
 	//boost::chrono::high_resolution_clock::time_point t2_;
 	//boost::chrono::nanoseconds elap_time_;
@@ -59,14 +71,16 @@ private:
 	void InitLabelArray(int in_model);
 	void InitRadiusTable(int in_model);
 	void InitDepthMap(int in_width);
-	void VelodyneCallback(const pcl::PointCloud<velodyne_pointcloud::PointXYZIR>::ConstPtr &in_cloud_msg);
+	void VelodyneCallback(const sensor_msgs::PointCloud2::ConstPtr &in_sensor_cloud_msg);
 	void FilterGround(const pcl::PointCloud<velodyne_pointcloud::PointXYZIR>::ConstPtr &in_cloud_msg,
 				pcl::PointCloud<velodyne_pointcloud::PointXYZIR> &out_groundless_points,
 				pcl::PointCloud<velodyne_pointcloud::PointXYZIR> &out_ground_points);
 
 };
 
-GroundFilter::GroundFilter() : node_handle_("~")
+GroundFilter::GroundFilter() :
+		node_handle_("~"),
+		in_cloud_ptr_(new pcl::PointCloud<velodyne_pointcloud::PointXYZIR>)
 {
 	ROS_INFO("Inititalizing Ground Filter...");
 	node_handle_.param<std::string>("point_topic", point_topic_, "/points_raw");
@@ -109,6 +123,7 @@ GroundFilter::GroundFilter() : node_handle_("~")
 	points_node_sub_ = node_handle_.subscribe(point_topic_, 10000, &GroundFilter::VelodyneCallback, this);
 	groundless_points_pub_ = node_handle_.advertise<sensor_msgs::PointCloud2>(no_ground_topic, 10000);
 	ground_points_pub_ = node_handle_.advertise<sensor_msgs::PointCloud2>(ground_topic, 10000);
+	frame_allocations_pub_ = node_handle_.advertise<std_msgs::UInt32>("frame_allocations", 10);
 
 	vertical_res_ = sensor_model_;
 	InitLabelArray(sensor_model_);
@@ -192,7 +207,15 @@ void GroundFilter::InitRadiusTable(int in_model)
 void GroundFilter::InitDepthMap(int in_width)
 {
 	const int mOne = -1;
-	index_map_ = cv::Mat_<int>(vertical_res_, in_width, mOne);
+	//Only allocated for the first frame, then reset in place
+	if (index_map_.rows != vertical_res_ || index_map_.cols != in_width)
+	{
+		index_map_ = cv::Mat_<int>(vertical_res_, in_width, mOne);
+	}
+	else
+	{
+		index_map_.setTo(mOne);
+	}
 }
 
 void GroundFilter::FilterGround(const pcl::PointCloud<velodyne_pointcloud::PointXYZIR>::ConstPtr &in_cloud_msg,
@@ -314,26 +337,33 @@ void GroundFilter::FilterGround(const pcl::PointCloud<velodyne_pointcloud::Point
 	}
 }
 
-void GroundFilter::VelodyneCallback(const pcl::PointCloud<velodyne_pointcloud::PointXYZIR>::ConstPtr &in_cloud_msg)
+void GroundFilter::VelodyneCallback(const sensor_msgs::PointCloud2::ConstPtr &in_sensor_cloud_msg)
 {
 
 	//t1_ = ros::Time().now();
-	pcl::PointCloud<velodyne_pointcloud::PointXYZIR> vertical_points;
-	pcl::PointCloud<velodyne_pointcloud::PointXYZIR> ground_points;
-	vertical_points.header = in_cloud_msg->header;
-	ground_points.header = in_cloud_msg->header;
-	vertical_points.clear();
-	ground_points.clear();
+	frame_pool_.startFrame();
+	frame_pool_.fromROSMsg(*in_sensor_cloud_msg, *in_cloud_ptr_);
 
-	FilterGround(in_cloud_msg, vertical_points, ground_points);
+	vertical_points_.header = in_cloud_ptr_->header;
+	ground_points_.header = in_cloud_ptr_->header;
+	frame_pool_.clear(vertical_points_, in_cloud_ptr_->points.size());
+	frame_pool_.clear(ground_points_, in_cloud_ptr_->points.size());
+
+	FilterGround(in_cloud_ptr_, vertical_points_, ground_points_);
 
 	if (!floor_removal_)
 	{
-		vertical_points = *in_cloud_msg;
+		frame_pool_.copy(*in_cloud_ptr_, vertical_points_);
 	}
 
-	groundless_points_pub_.publish(vertical_points);
-	ground_points_pub_.publish(ground_points);
+	frame_pool_.toROSMsg(vertical_points_, groundless_points_msg_);
+	frame_pool_.toROSMsg(ground_points_, ground_points_msg_);
+	groundless_points_pub_.publish(groundless_points_msg_);
+	ground_points_pub_.publish(ground_points_msg_);
+
+	std_msgs::UInt32 frame_allocations;
+	frame_allocations.data = frame_pool_.getFrameAllocationCount();
+	frame_allocations_pub_.publish(frame_allocations);
 	//t2_ = boost::chrono::high_resolution_clock::now();
 	//t2_ = ros::Time().now();
 	//elap_time_ = t2_ - t1_;//boost::chrono::duration_cast<boost::chrono::nanoseconds>(t2_-t1_);
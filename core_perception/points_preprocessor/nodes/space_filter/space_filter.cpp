@@ -6,10 +6,12 @@
  */
 #include <ros/ros.h>
 #include <pcl_conversions/pcl_conversions.h>
-#include <pcl/filters/extract_indices.h>
 #include <sensor_msgs/point_cloud_conversion.h>
 #include <sensor_msgs/PointCloud.h>
 #include <sensor_msgs/PointCloud2.h>
+#include <std_msgs/UInt32.h>
+
+#include "points_preprocessor/frame_pool/frame_pool.h"
 
 
 class SpaceFilter
@@ -22,6 +24,7 @@ private:
 	ros::NodeHandle node_handle_;
 	ros::Subscriber cloud_sub_;
 	ros::Publisher 	cloud_pub_;
+	ros::Publisher 	frame_allocations_pub_;
 
 	std::string 	subscribe_topic_;
 
@@ -33,6 +36,13 @@ private:
 	double 			below_distance_;
 	double 			above_distance_;
 
+	//Buffers reused across frames
+	points_preprocessor::FramePool 			frame_pool_;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr 	current_sensor_cloud_ptr_;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr 	inlanes_cloud_ptr_;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr 	clipped_cloud_ptr_;
+	sensor_msgs::PointCloud2 				cloud_msg_;
+
 	void VelodyneCallback(const sensor_msgs::PointCloud2::Ptr& in_sensor_cloud_ptr);
 	void KeepLanes(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_ptr,
 							pcl::PointCloud<pcl::PointXYZ>::Ptr out_cloud_ptr,
@@ -45,7 +55,10 @@ private:
 };
 
 SpaceFilter::SpaceFilter() :
-		node_handle_("~")
+		node_handle_("~"),
+		current_sensor_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZ>),
+		inlanes_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZ>),
+		clipped_cloud_ptr_(new pcl::PointCloud<pcl::PointXYZ>)
 {
 
 	node_handle_.param<std::string>("subscribe_topic",  subscribe_topic_,  "/points_raw");
@@ -60,6 +73,7 @@ SpaceFilter::SpaceFilter() :
 
 	cloud_sub_ = node_handle_.subscribe(subscribe_topic_, 10, &SpaceFilter::VelodyneCallback, this);
 	cloud_pub_ = node_handle_.advertise<sensor_msgs::PointCloud2>( "/points_clipped", 10);
+	frame_allocations_pub_ = node_handle_.advertise<std_msgs::UInt32>("frame_allocations", 10);
 }
 
 void SpaceFilter::KeepLanes(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_ptr,
@@ -67,27 +81,18 @@ void SpaceFilter::KeepLanes(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_p
 		float in_left_lane_threshold,
 		float in_right_lane_threshold)
 {
-	pcl::PointIndices::Ptr far_indices (new pcl::PointIndices);
+	frame_pool_.clear(*out_cloud_ptr, in_cloud_ptr->points.size());
 	for(unsigned int i=0; i< in_cloud_ptr->points.size(); i++)
 	{
-		pcl::PointXYZ current_point;
-		current_point.x=in_cloud_ptr->points[i].x;
-		current_point.y=in_cloud_ptr->points[i].y;
-		current_point.z=in_cloud_ptr->points[i].z;
+		const pcl::PointXYZ& current_point = in_cloud_ptr->points[i];
 
-		if (
+		if (!(
 			current_point.y > (in_left_lane_threshold) || current_point.y < -1.0*in_right_lane_threshold
-		)
+		))
 		{
-			far_indices->indices.push_back(i);
+			out_cloud_ptr->points.push_back(current_point);
 		}
 	}
-	out_cloud_ptr->points.clear();
-	pcl::ExtractIndices<pcl::PointXYZ> extract;
-	extract.setInputCloud (in_cloud_ptr);
-	extract.setIndices(far_indices);
-	extract.setNegative(true);//true removes the indices, false leaves only the indices
-	extract.filter(*out_cloud_ptr);
 }
 
 void SpaceFilter::ClipCloud(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_ptr,
@@ -95,7 +100,7 @@ void SpaceFilter::ClipCloud(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_p
 		float in_min_height,
 		float in_max_height)
 {
-	out_cloud_ptr->points.clear();
+	frame_pool_.clear(*out_cloud_ptr, in_cloud_ptr->points.size());
 	for (unsigned int i=0; i<in_cloud_ptr->points.size(); i++)
 	{
 		if (in_cloud_ptr->points[i].z >= in_min_height &&
@@ -108,11 +113,13 @@ void SpaceFilter::ClipCloud(const pcl::PointCloud<pcl::PointXYZ>::Ptr in_cloud_p
 
 void SpaceFilter::VelodyneCallback(const sensor_msgs::PointCloud2::Ptr& in_sensor_cloud_ptr)
 {
-	pcl::PointCloud<pcl::PointXYZ>::Ptr current_sensor_cloud_ptr (new pcl::PointCloud<pcl::PointXYZ>);
-	pcl::PointCloud<pcl::PointXYZ>::Ptr inlanes_cloud_ptr (new pcl::PointCloud<pcl::PointXYZ>);
-	pcl::PointCloud<pcl::PointXYZ>::Ptr clipped_cloud_ptr (new pcl::PointCloud<pcl::PointXYZ>);
+	frame_pool_.startFrame();
+
+	pcl::PointCloud<pcl::PointXYZ>::Ptr current_sensor_cloud_ptr = current_sensor_cloud_ptr_;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr inlanes_cloud_ptr = inlanes_cloud_ptr_;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr clipped_cloud_ptr = clipped_cloud_ptr_;
 
-	pcl::fromROSMsg(*in_sensor_cloud_ptr, *current_sensor_cloud_ptr);
+	frame_pool_.fromROSMsg(*in_sensor_cloud_ptr, *current_sensor_cloud_ptr);
 
 	if (lateral_removal_)
 	{
@@ -131,12 +138,14 @@ void SpaceFilter::VelodyneCallback(const sensor_msgs::PointCloud2::Ptr& in_senso
 		clipped_cloud_ptr = inlanes_cloud_ptr;
 	}
 
-	sensor_msgs::PointCloud2 cloud_msg;
+	frame_pool_.toROSMsg(*clipped_cloud_ptr, cloud_msg_);
 
-	pcl::toROSMsg(*clipped_cloud_ptr, cloud_msg);
+	cloud_msg_.header=in_sensor_cloud_ptr->header;
+	cloud_pub_.publish(cloud_msg_);
 
-	cloud_msg.header=in_sensor_cloud_ptr->header;
-	cloud_pub_.publish(cloud_msg);
+	std_msgs::UInt32 frame_allocations;
+	frame_allocations.data = frame_pool_.getFrameAllocationCount();
+	frame_allocations_pub_.publish(frame_allocations);
 }
 
 int main(int argc, char **argv)
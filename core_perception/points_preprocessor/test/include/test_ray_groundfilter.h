@@ -1,16 +1,12 @@
 
 #include <cmath>
 
-#include <ros/ros.h>
-
-#include "ray_ground_filter.h"
+#include "points_preprocessor/ray_ground_filter/ray_ground_filter.h"
 
+// The filter only connects to ROS in Run(), so its steps are tested without a ROS master.
 // test fixtures are necessary to use friend classes
 TEST(RayGroundFilter, clipCloud)
 {
-  char* argv = "test_points_preprocessor";
-  int argc = 1;
-  ros::init(argc, &argv, "test_raygroundfilter_clipcloud");
   pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
   pcl::PointCloud<pcl::PointXYZI>::Ptr out_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
 
@@ -38,7 +34,7 @@ TEST(RayGroundFilter, clipCloud)
   rgfilter.ClipCloud(in_cloud_ptr, CLIP_HEIGHT, out_cloud_ptr);
 
   // make sure everything worked correctly
-  ASSERT_EQ(out_cloud_ptr->points.size(), 4);
+  ASSERT_EQ(out_cloud_ptr->points.size(), 4u);
   const float TOL = 1.0E-6F;
   ASSERT_LT(fabsf(out_cloud_ptr->points[0].x), TOL);
   ASSERT_LT(fabsf(out_cloud_ptr->points[0].y), TOL);
@@ -53,3 +49,55 @@ TEST(RayGroundFilter, clipCloud)
   ASSERT_LT(fabsf(out_cloud_ptr->points[3].y - 6.0F), TOL);
   ASSERT_LT(fabsf(out_cloud_ptr->points[3].z - 1.5F), TOL);
 }
+
+TEST(RayGroundFilter, convertXYZIToRTZColor)
+{
+  pcl::PointCloud<pcl::PointXYZI>::Ptr in_cloud_ptr(new pcl::PointCloud<pcl::PointXYZI>);
+
+  RayGroundFilter rgfilter;
+  rgfilter.radial_divider_angle_ = 1.0;
+  rgfilter.concentric_divider_distance_ = 5.0;
+  rgfilter.radial_dividers_num_ = 360;
+  rgfilter.colors_.resize(rgfilter.color_num_);
+
+  // points on a spiral, so that every division gets points at decreasing radius
+  pcl::PointXYZI pt;
+  for (int i = 0; i < 5000; i++)
+  {
+    float angle = i * 0.37F;
+    float radius = 50.0F - i * 0.01F;
+    pt.x = radius * cosf(angle);
+    pt.y = radius * sinf(angle);
+    pt.z = 0.0F;
+    in_cloud_ptr->push_back(pt);
+  }
+
+  // run twice, the second run reuses the buffers of the first one
+  for (int run = 0; run < 2; run++)
+  {
+    rgfilter.ConvertXYZIToRTZColor(in_cloud_ptr, rgfilter.organized_points_, rgfilter.radial_division_indices_,
+                                   rgfilter.radial_ordered_clouds_);
+
+    ASSERT_EQ(rgfilter.radial_ordered_clouds_->size(), 360u);
+    size_t points_num = 0;
+    for (size_t div = 0; div < 360; div++)
+    {
+      const auto& ray = rgfilter.radial_ordered_clouds_->at(div);
+      const auto& indices = rgfilter.radial_division_indices_->at(div).indices;
+      ASSERT_EQ(ray.size(), indices.size());
+      for (size_t j = 0; j < ray.size(); j++)
+      {
+        ASSERT_EQ(ray[j].radial_div, div);
+        ASSERT_EQ(ray[j].concentric_div, (size_t)floor(ray[j].radius / 5.0));
+        ASSERT_EQ(rgfilter.organized_points_->at(indices[j]).radial_div, div);
+        if (j > 0)
+        {
+          ASSERT_LE(ray[j - 1].radius, ray[j].radius);
+          ASSERT_LT(indices[j - 1], indices[j]);
+        }
+      }
+      points_num += ray.size();
+    }
+    ASSERT_EQ(points_num, in_cloud_ptr->points.size());
+  }
+}
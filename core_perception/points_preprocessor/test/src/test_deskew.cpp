@@ -0,0 +1,102 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "points_preprocessor/points_concat_filter/deskew.h"
+
+using points_preprocessor::getDeskewTransform;
+using points_preprocessor::transformTwist;
+
+namespace
+{
+const double TOLERANCE = 1e-9;
+
+void expectNear(const tf::Vector3& expected, const tf::Vector3& actual)
+{
+  EXPECT_NEAR(expected.x(), actual.x(), TOLERANCE);
+  EXPECT_NEAR(expected.y(), actual.y(), TOLERANCE);
+  EXPECT_NEAR(expected.z(), actual.z(), TOLERANCE);
+}
+}  // namespace
+
+TEST(DeskewTestSuite, constantVelocityShiftsPoints)
+{
+  // a cloud 50 ms after the frame stamp, driving at 10 m/s
+  const tf::Transform deskew = getDeskewTransform(tf::Vector3(10, 0, 0), tf::Vector3(0, 0, 0), 0.05);
+  expectNear(tf::Vector3(1.5, 2, 3), deskew * tf::Vector3(1, 2, 3));
+  expectNear(tf::Vector3(-4.5, 0, -1), deskew * tf::Vector3(-5, 0, -1));
+
+  // a cloud before the frame stamp
+  const tf::Transform backwards = getDeskewTransform(tf::Vector3(10, -2, 0), tf::Vector3(0, 0, 0), -0.1);
+  expectNear(tf::Vector3(0, 2.2, 3), backwards * tf::Vector3(1, 2, 3));
+}
+
+TEST(DeskewTestSuite, constantYawRateRotatesPoints)
+{
+  const tf::Transform deskew = getDeskewTransform(tf::Vector3(0, 0, 0), tf::Vector3(0, 0, M_PI / 2), 1.0);
+  expectNear(tf::Vector3(0, 1, 0), deskew * tf::Vector3(1, 0, 0));
+  expectNear(tf::Vector3(-2, 0, 5), deskew * tf::Vector3(0, 2, 5));
+}
+
+TEST(DeskewTestSuite, pointsOfStaticObjectsMatchOnCircle)
+{
+  // the frame drives on a circle with a constant twist, a static point seen at the end of the motion is
+  // deskewed to where it was seen at the start
+  const double speed = 8.0;
+  const double yaw_rate = 0.6;
+  const double time_difference = 0.1;
+  const double radius = speed / yaw_rate;
+  const double yaw = yaw_rate * time_difference;
+  const tf::Transform end_pose(tf::Quaternion(tf::Vector3(0, 0, 1), yaw),
+                               tf::Vector3(radius * std::sin(yaw), radius * (1 - std::cos(yaw)), 0));
+
+  const tf::Transform deskew =
+      getDeskewTransform(tf::Vector3(speed, 0, 0), tf::Vector3(0, 0, yaw_rate), time_difference);
+  const tf::Vector3 points[] = { tf::Vector3(10, 0, 0), tf::Vector3(2, -1, 0.5), tf::Vector3(-20, 15, -1.8) };
+  for (const tf::Vector3& start_point : points)
+  {
+    const tf::Vector3 end_point = end_pose.inverse() * start_point;
+    expectNear(start_point, deskew * end_point);
+  }
+
+  // and the motion backwards in time is the inverse
+  const tf::Transform backwards =
+      getDeskewTransform(tf::Vector3(speed, 0, 0), tf::Vector3(0, 0, yaw_rate), -time_difference);
+  for (const tf::Vector3& start_point : points)
+    expectNear(start_point, backwards * (deskew * start_point));
+}
+
+TEST(DeskewTestSuite, twistIsMovedToOutputFrame)
+{
+  // a sensor 1 m ahead of and 2 m above the base, turned by 90 degrees to the left
+  const tf::Transform base_to_sensor(tf::Quaternion(tf::Vector3(0, 0, 1), M_PI / 2), tf::Vector3(1, 0, 2));
+  tf::Vector3 linear(2, 0, 0);
+  tf::Vector3 angular(0, 0, 1);
+  transformTwist(base_to_sensor.inverse(), linear, angular);
+
+  // the sensor moves at (2, 1, 0) in the base frame, which is (1, -2, 0) in the sensor frame
+  expectNear(tf::Vector3(1, -2, 0), linear);
+  expectNear(tf::Vector3(0, 0, 1), angular);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <pcl/point_types.h>
+
+#include "points_preprocessor/frame_pool/frame_pool.h"
+
+using points_preprocessor::FramePool;
+
+class FramePoolTestSuite : public ::testing::Test
+{
+protected:
+  static void addField(sensor_msgs::PointCloud2& msg, const std::string& name, uint32_t offset, uint8_t datatype)
+  {
+    sensor_msgs::PointField field;
+    field.name = name;
+    field.offset = offset;
+    field.datatype = datatype;
+    field.count = 1;
+    msg.fields.push_back(field);
+  }
+
+  // A driver-like layout: packed x, y, z, intensity and ring, and padding at the end of each row
+  static sensor_msgs::PointCloud2 makeRingMessage(uint32_t width, uint32_t height)
+  {
+    sensor_msgs::PointCloud2 msg;
+    msg.header.frame_id = "velodyne";
+    msg.width = width;
+    msg.height = height;
+    addField(msg, "x", 0, sensor_msgs::PointField::FLOAT32);
+    addField(msg, "y", 4, sensor_msgs::PointField::FLOAT32);
+    addField(msg, "z", 8, sensor_msgs::PointField::FLOAT32);
+    addField(msg, "intensity", 12, sensor_msgs::PointField::FLOAT32);
+    addField(msg, "ring", 16, sensor_msgs::PointField::UINT16);
+    msg.point_step = 18;
+    msg.row_step = msg.point_step * width + 6;
+    msg.is_dense = 1;
+    msg.data.resize(msg.row_step * height);
+    for (uint32_t row = 0; row < height; row++)
+    {
+      for (uint32_t col = 0; col < width; col++)
+      {
+        const float values[4] = { expectedX(row, col), expectedY(row, col), expectedZ(row, col),
+                                  expectedIntensity(row, col) };
+        const uint16_t ring = static_cast<uint16_t>(row);
+        uint8_t* point_data = &msg.data[row * msg.row_step + col * msg.point_step];
+        std::memcpy(point_data, values, sizeof(values));
+        std::memcpy(point_data + 16, &ring, sizeof(ring));
+      }
+    }
+    return msg;
+  }
+
+  static float expectedX(uint32_t row, uint32_t col)
+  {
+    return col * 0.5f;
+  }
+
+  static float expectedY(uint32_t row, uint32_t col)
+  {
+    return row - 100.0f;
+  }
+
+  static float expectedZ(uint32_t row, uint32_t col)
+  {
+    return row * 0.25f - col;
+  }
+
+  static float expectedIntensity(uint32_t row, uint32_t col)
+  {
+    return static_cast<float>((row * 7 + col) % 256);
+  }
+};
+
+TEST_F(FramePoolTestSuite, singleBlockRoundTrip)
+{
+  // pcl::PointXY has no padding, so its messages are copied as a single block
+  pcl::PointCloud<pcl::PointXY> cloud;
+  cloud.header.frame_id = "base_link";
+  cloud.width = 5;
+  cloud.height = 3;
+  for (int i = 0; i < 15; i++)
+  {
+    pcl::PointXY point;
+    point.x = i * 1.5f;
+    point.y = -i;
+    cloud.points.push_back(point);
+  }
+
+  FramePool pool;
+  sensor_msgs::PointCloud2 msg;
+  pool.toROSMsg(cloud, msg);
+  EXPECT_EQ("base_link", msg.header.frame_id);
+  EXPECT_EQ(5u, msg.width);
+  EXPECT_EQ(3u, msg.height);
+  EXPECT_EQ(sizeof(pcl::PointXY), msg.point_step);
+  EXPECT_EQ(5 * sizeof(pcl::PointXY), msg.row_step);
+  ASSERT_EQ(2u, msg.fields.size());
+  EXPECT_EQ("x", msg.fields[0].name);
+  EXPECT_EQ("y", msg.fields[1].name);
+
+  pcl::PointCloud<pcl::PointXY> result;
+  pool.fromROSMsg(msg, result);
+  EXPECT_EQ("base_link", result.header.frame_id);
+  EXPECT_EQ(5u, result.width);
+  EXPECT_EQ(3u, result.height);
+  ASSERT_EQ(cloud.points.size(), result.points.size());
+  for (size_t i = 0; i < cloud.points.size(); i++)
+  {
+    EXPECT_EQ(cloud.points[i].x, result.points[i].x);
+    EXPECT_EQ(cloud.points[i].y, result.points[i].y);
+  }
+}
+
+TEST_F(FramePoolTestSuite, fieldMappedRoundTrip)
+{
+  pcl::PointCloud<pcl::PointXYZI> cloud;
+  cloud.header.frame_id = "base_link";
+  for (int i = 0; i < 100; i++)
+  {
+    pcl::PointXYZI point;
+    point.x = i;
+    point.y = i * 2.0f;
+    point.z = -i;
+    point.intensity = i % 10;
+    cloud.points.push_back(point);
+  }
+  // width and height do not match the points, the message is unorganized
+  cloud.width = 7;
+  cloud.height = 1;
+
+  FramePool pool;
+  sensor_msgs::PointCloud2 msg;
+  pool.toROSMsg(cloud, msg);
+  EXPECT_EQ(100u, msg.width);
+  EXPECT_EQ(1u, msg.height);
+  EXPECT_EQ(100 * sizeof(pcl::PointXYZI), msg.data.size());
+
+  pcl::PointCloud<pcl::PointXYZI> result;
+  pool.fromROSMsg(msg, result);
+  ASSERT_EQ(100u, result.points.size());
+  for (size_t i = 0; i < result.points.size(); i++)
+  {
+    EXPECT_EQ(cloud.points[i].x, result.points[i].x);
+    EXPECT_EQ(cloud.points[i].y, result.points[i].y);
+    EXPECT_EQ(cloud.points[i].z, result.points[i].z);
+    EXPECT_EQ(cloud.points[i].intensity, result.points[i].intensity);
+  }
+}
+
+TEST_F(FramePoolTestSuite, fieldMappedLayouts)
+{
+  const sensor_msgs::PointCloud2 msg = makeRingMessage(50, 4);
+  FramePool pool;
+
+  pcl::PointCloud<pcl::PointXYZI> cloud;
+  pool.fromROSMsg(msg, cloud);
+  EXPECT_EQ("velodyne", cloud.header.frame_id);
+  EXPECT_EQ(50u, cloud.width);
+  EXPECT_EQ(4u, cloud.height);
+  ASSERT_EQ(200u, cloud.points.size());
+  for (uint32_t row = 0; row < 4; row++)
+  {
+    for (uint32_t col = 0; col < 50; col++)
+    {
+      const pcl::PointXYZI& point = cloud.points[row * 50 + col];
+      EXPECT_EQ(expectedX(row, col), point.x);
+      EXPECT_EQ(expectedY(row, col), point.y);
+      EXPECT_EQ(expectedZ(row, col), point.z);
+      EXPECT_EQ(expectedIntensity(row, col), point.intensity);
+    }
+  }
+
+  // another point type from the same layout
+  pcl::PointCloud<pcl::PointXYZ> xyz_cloud;
+  pool.fromROSMsg(msg, xyz_cloud);
+  ASSERT_EQ(200u, xyz_cloud.points.size());
+  EXPECT_EQ(expectedX(3, 49), xyz_cloud.points[199].x);
+  EXPECT_EQ(expectedZ(3, 49), xyz_cloud.points[199].z);
+
+  // and another layout with the same fields in a different order
+  sensor_msgs::PointCloud2 reordered;
+  reordered.width = 2;
+  reordered.height = 1;
+  addField(reordered, "intensity", 0, sensor_msgs::PointField::FLOAT32);
+  addField(reordered, "z", 4, sensor_msgs::PointField::FLOAT32);
+  addField(reordered, "y", 8, sensor_msgs::PointField::FLOAT32);
+  addField(reordered, "x", 12, sensor_msgs::PointField::FLOAT32);
+  reordered.point_step = 16;
+  reordered.row_step = 32;
+  const float values[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  reordered.data.resize(sizeof(values));
+  std::memcpy(&reordered.data[0], values, sizeof(values));
+  pool.fromROSMsg(reordered, xyz_cloud);
+  ASSERT_EQ(2u, xyz_cloud.points.size());
+  EXPECT_EQ(4, xyz_cloud.points[0].x);
+  EXPECT_EQ(3, xyz_cloud.points[0].y);
+  EXPECT_EQ(2, xyz_cloud.points[0].z);
+  EXPECT_EQ(8, xyz_cloud.points[1].x);
+  EXPECT_EQ(6, xyz_cloud.points[1].z);
+}
+
+TEST_F(FramePoolTestSuite, countsBufferGrowth)
+{
+  FramePool pool;
+  std::vector<int> buffer;
+
+  pool.startFrame();
+  pool.resize(buffer, 100);
+  EXPECT_EQ(100u, buffer.size());
+  EXPECT_EQ(1u, pool.getFrameGrowthCount());
+
+  // smaller and equal sizes keep the capacity
+  pool.resize(buffer, 10);
+  pool.reserve(buffer, 100);
+  pool.resize(buffer, 100);
+  EXPECT_EQ(1u, pool.getFrameGrowthCount());
+  EXPECT_GE(buffer.capacity(), 100u);
+
+  pool.reserve(buffer, 101);
+  EXPECT_EQ(2u, pool.getFrameGrowthCount());
+  EXPECT_GE(buffer.capacity(), 101u);
+
+  pool.startFrame();
+  EXPECT_EQ(0u, pool.getFrameGrowthCount());
+  EXPECT_EQ(2u, pool.getGrowthCount());
+
+  pcl::PointCloud<pcl::PointXYZ> cloud, copy;
+  cloud.points.push_back(pcl::PointXYZ(1, 2, 3));
+  cloud.width = 1;
+  cloud.height = 1;
+  pool.copy(cloud, copy);
+  EXPECT_EQ(1u, pool.getFrameGrowthCount());
+  ASSERT_EQ(1u, copy.points.size());
+  EXPECT_EQ(3, copy.points[0].z);
+
+  pool.clear(copy, 1);
+  EXPECT_TRUE(copy.points.empty());
+  EXPECT_EQ(0u, copy.width);
+  EXPECT_GE(copy.points.capacity(), 1u);
+  EXPECT_EQ(1u, pool.getFrameGrowthCount());
+}
+
+TEST_F(FramePoolTestSuite, framesStopGrowingAtLargestFrame)
+{
+  FramePool pool;
+  pcl::PointCloud<pcl::PointXYZI> cloud;
+  sensor_msgs::PointCloud2 output;
+
+  const uint32_t heights[] = { 4, 4, 2, 4, 8, 8, 1 };
+  const uint64_t expected_counts[] = { 5, 0, 0, 0, 2, 0, 0 };
+  for (int frame = 0; frame < 7; frame++)
+  {
+    const sensor_msgs::PointCloud2 msg = makeRingMessage(50, heights[frame]);
+    pool.startFrame();
+    pool.fromROSMsg(msg, cloud);
+    pool.toROSMsg(cloud, output);
+    // the first frame computes the field mapping and the output fields, and sizes the cloud, the output fields and
+    // the output data, larger frames only grow the cloud and the output data
+    EXPECT_EQ(expected_counts[frame], pool.getFrameGrowthCount()) << "frame " << frame;
+    // once the buffers have grown, a frame makes no heap allocation at all
+    if (expected_counts[frame] == 0)
+    {
+      EXPECT_EQ(0u, pool.getFrameAllocationCount()) << "frame " << frame;
+    }
+    EXPECT_EQ(50u * heights[frame], cloud.points.size());
+    EXPECT_EQ(50u * heights[frame] * sizeof(pcl::PointXYZI), output.data.size());
+  }
+  EXPECT_EQ(7u, pool.getGrowthCount());
+}
+
+TEST_F(FramePoolTestSuite, countsHeapAllocationsOfTheFrame)
+{
+  FramePool pool;
+
+  // allocations made outside of the pool are counted
+  pool.startFrame();
+  std::vector<int> other(10);
+  std::string name(100, 'x');
+  EXPECT_EQ(2u, pool.getFrameAllocationCount());
+  EXPECT_EQ(0u, pool.getFrameGrowthCount());
+
+  // the points of a cloud take their memory from malloc, their growths are counted by the pool
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  pool.startFrame();
+  pool.clear(cloud, 100);
+  EXPECT_EQ(1u, pool.getFrameAllocationCount());
+  pool.startFrame();
+  pool.clear(cloud, 50);
+  EXPECT_EQ(0u, pool.getFrameAllocationCount());
+
+  // the conversions allocate their layouts and buffers on the first frame only
+  pcl::PointCloud<pcl::PointXYZI> ring_cloud;
+  sensor_msgs::PointCloud2 output;
+  const sensor_msgs::PointCloud2 msg = makeRingMessage(50, 4);
+  pool.startFrame();
+  pool.fromROSMsg(msg, ring_cloud);
+  pool.toROSMsg(ring_cloud, output);
+  EXPECT_GE(pool.getFrameAllocationCount(), pool.getFrameGrowthCount());
+  pool.startFrame();
+  pool.fromROSMsg(msg, ring_cloud);
+  pool.toROSMsg(ring_cloud, output);
+  EXPECT_EQ(0u, pool.getFrameAllocationCount());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/point_types.h>
+
+#include "points_preprocessor/compare_map_filter/map_voxel_hash.h"
+
+class TestSuite : public ::testing::Test
+{
+protected:
+  void SetUp()
+  {
+    srand(0);
+
+    map_.reset(new pcl::PointCloud<pcl::PointXYZI>);
+    scan_.reset(new pcl::PointCloud<pcl::PointXYZI>);
+
+    // A ground plane with a wall, around negative and positive coordinates
+    for (int i = 0; i < 200000; i++)
+    {
+      map_->push_back(point(uniform(-30, 30), uniform(-30, 30), 0.1 * std::sin(uniform(-3, 3))));
+      map_->push_back(point(uniform(-30, 30), 10 + uniform(-0.05, 0.05), uniform(0, 3)));
+    }
+
+    // Points on the map and up to 1 m away from it
+    for (int i = 0; i < 100000; i++)
+    {
+      const pcl::PointXYZI& p = map_->points[rand() % map_->points.size()];
+      scan_->push_back(point(p.x + uniform(-1, 1), p.y + uniform(-1, 1), p.z + uniform(-1, 1)));
+    }
+  }
+
+  static float uniform(float min, float max)
+  {
+    return min + (max - min) * static_cast<float>(rand()) / RAND_MAX;
+  }
+
+  static pcl::PointXYZI point(float x, float y, float z)
+  {
+    pcl::PointXYZI p;
+    p.x = x;
+    p.y = y;
+    p.z = z;
+    p.intensity = 0;
+    return p;
+  }
+
+  pcl::PointCloud<pcl::PointXYZI>::Ptr map_, scan_;
+};
+
+TEST_F(TestSuite, MatchesKdTreeUpToResolution)
+{
+  const double threshold = 0.3;
+  const double resolution = 0.05;
+  const double tolerance = resolution * std::sqrt(3.0);
+
+  pcl::KdTreeFLANN<pcl::PointXYZI> tree;
+  tree.setInputCloud(map_);
+
+  points_preprocessor::MapVoxelHash voxel_hash;
+  voxel_hash.setInputCloud(*map_, threshold, resolution);
+
+  std::vector<int> nn_indices(1);
+  std::vector<float> nn_dists(1);
+  size_t matched = 0;
+  for (const pcl::PointXYZI& p : scan_->points)
+  {
+    tree.nearestKSearch(p, 1, nn_indices, nn_dists);
+    const double distance = std::sqrt(nn_dists[0]);
+    const bool is_matched = voxel_hash.isMatched(p);
+    if (distance < threshold - tolerance)
+    {
+      ASSERT_TRUE(is_matched) << "distance " << distance;
+    }
+    if (distance > threshold + tolerance)
+    {
+      ASSERT_FALSE(is_matched) << "distance " << distance;
+    }
+    matched += is_matched;
+  }
+  ASSERT_GT(matched, 0);
+  ASSERT_LT(matched, scan_->points.size());
+}
+
+TEST_F(TestSuite, EmptyMapMatchesNothing)
+{
+  points_preprocessor::MapVoxelHash voxel_hash;
+  voxel_hash.setInputCloud(pcl::PointCloud<pcl::PointXYZI>(), 0.3, 0.1);
+
+  ASSERT_TRUE(voxel_hash.empty());
+  ASSERT_FALSE(voxel_hash.isMatched(point(0, 0, 0)));
+}
+
+TEST_F(TestSuite, NonFiniteAndFarPointsAreNotMatched)
+{
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float inf = std::numeric_limits<float>::infinity();
+  pcl::PointCloud<pcl::PointXYZI> map;
+  map.push_back(point(0.05f, 0.05f, 0.05f));
+  map.push_back(point(nan, 0, 0));
+  map.push_back(point(0, -inf, 0));
+  map.push_back(point(1e12f, 0, 0));
+
+  points_preprocessor::MapVoxelHash voxel_hash;
+  voxel_hash.setInputCloud(map, 0.05, 0.1);
+  ASSERT_EQ(1u, voxel_hash.getBlockCount());
+  ASSERT_TRUE(voxel_hash.isMatched(point(0.05f, 0.05f, 0.05f)));
+
+  ASSERT_FALSE(voxel_hash.isMatched(point(nan, 0.05f, 0.05f)));
+  ASSERT_FALSE(voxel_hash.isMatched(point(0.05f, inf, 0.05f)));
+  ASSERT_FALSE(voxel_hash.isMatched(point(0.05f, 0.05f, -inf)));
+  // beyond the range of int32_t voxels
+  ASSERT_FALSE(voxel_hash.isMatched(point(1e12f, 0.05f, 0.05f)));
+  // in the range of int32_t, but 2^23 voxels away, where the block keys would wrap around onto the map voxel
+  ASSERT_FALSE(voxel_hash.isMatched(point(838860.8f, 0.05f, 0.05f)));
+}
+
+TEST_F(TestSuite, BenchmarkAgainstKdTree)
+{
+  typedef std::chrono::steady_clock Clock;
+  const double threshold = 0.3;
+  const double squared_threshold = threshold * threshold;
+
+  Clock::time_point start = Clock::now();
+  pcl::KdTreeFLANN<pcl::PointXYZI> tree;
+  tree.setInputCloud(map_);
+  const double tree_build = std::chrono::duration<double>(Clock::now() - start).count();
+
+  start = Clock::now();
+  points_preprocessor::MapVoxelHash voxel_hash;
+  voxel_hash.setInputCloud(*map_, threshold, 0.1);
+  const double hash_build = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<int> nn_indices(1);
+  std::vector<float> nn_dists(1);
+  size_t tree_matched = 0;
+  start = Clock::now();
+  for (const pcl::PointXYZI& p : scan_->points)
+  {
+    tree.nearestKSearch(p, 1, nn_indices, nn_dists);
+    tree_matched += nn_dists[0] <= squared_threshold;
+  }
+  const double tree_search = std::chrono::duration<double>(Clock::now() - start).count();
+
+  size_t hash_matched = 0;
+  start = Clock::now();
+  for (const pcl::PointXYZI& p : scan_->points)
+  {
+    hash_matched += voxel_hash.isMatched(p);
+  }
+  const double hash_search = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::cout << "map " << map_->points.size() << " points, scan " << scan_->points.size() << " points" << std::endl
+            << "kdtree:     build " << tree_build * 1e3 << " ms, search " << tree_search * 1e3 << " ms, "
+            << tree_matched << " matched" << std::endl
+            << "voxel_hash: build " << hash_build * 1e3 << " ms, search " << hash_search * 1e3 << " ms, "
+            << hash_matched << " matched" << std::endl;
+
+  ASSERT_NEAR(static_cast<double>(tree_matched), static_cast<double>(hash_matched), 0.05 * scan_->points.size());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -61,6 +61,12 @@ private:
   bool detectCollision(const SimpleNode& sn);
   bool calcWaveFrontHeuristic(const SimpleNode& sn);
   bool detectCollisionWaveFront(const WaveFrontNode& sn);
+  AstarNode& getNode(int index_x, int index_y, int index_theta);
+  void createFootprintTable();
+  void calcObstacleClearances();
+  void addFootprintCell(double x, double y, FootprintCells* footprint);
+  void removeDuplicateFootprintCells(FootprintCells* footprint);
+  bool detectFootprintCollision(int index_x, int index_y, const FootprintCells& footprint);
 
   // ros param
   ros::NodeHandle n_;
@@ -92,17 +98,29 @@ private:
 
   // hybrid astar variables
   std::vector<std::vector<NodeUpdate>> state_update_table_;
-  std::vector<std::vector<std::vector<AstarNode>>> nodes_;
+  std::vector<AstarNode> nodes_;    // [index_y][index_x][index_theta], valid if reached in search_generation_
+  unsigned int search_generation_;  // incremented by reset() instead of clearing all the nodes
   std::priority_queue<SimpleNode, std::vector<SimpleNode>, std::greater<SimpleNode>> openlist_;
   std::vector<SimpleNode> goallist_;
 
+  // costmap cells, [index_y][index_x]
+  std::vector<uint8_t> obstacles_;   // 1 for obstacle or unknown area
+  std::vector<double> cell_costs_;  // potential or wavefront heuristic cost
+  std::vector<int> obstacle_clearances_;  // rows or columns to the nearest obstacle, the larger of the two
+
+  // cells of the robot footprint for each theta index, and of the square used by wavefront search
+  std::vector<FootprintCells> footprint_table_;
+  FootprintCells wavefront_footprint_;
+
   // costmap as occupancy grid
   nav_msgs::OccupancyGrid costmap_;
+  tf::Transform origin_inverse_tf_;  // from the costmap frame to the grid, computed once per costmap
 
   // pose in costmap frame
   geometry_msgs::PoseStamped start_pose_local_;
   geometry_msgs::PoseStamped goal_pose_local_;
   double goal_yaw_;
+  tf::Transform goal_inverse_tf_;  // from the costmap frame to the goal pose
 
   // result path
   nav_msgs::Path path_;
@@ -17,6 +17,8 @@
 #ifndef ASTAR_UTIL_H
 #define ASTAR_UTIL_H
 
+#include <vector>
+
 #include <tf/tf.h>
 
 enum class STATUS : uint8_t
@@ -27,15 +29,17 @@ enum class STATUS : uint8_t
   OBS
 };
 
+// The small members are last, so that a node fits in 64 bytes
 struct AstarNode
 {
   double x, y, theta;            // Coordinate of each node
-  STATUS status = STATUS::NONE;  // NONE, OPEN, CLOSED or OBS
   double gc = 0;                 // Actual cost
   double hc = 0;                 // heuristic cost
   double move_distance = 0;      // actual move distance
-  bool back;                     // true if the current direction of the vehicle is back
   AstarNode* parent = NULL;      // parent node
+  unsigned int generation = 0;   // search in which the node was last reached
+  STATUS status = STATUS::NONE;  // NONE, OPEN, CLOSED or OBS
+  bool back;                     // true if the current direction of the vehicle is back
 };
 
 struct WaveFrontNode
@@ -59,6 +63,17 @@ struct NodeUpdate
   bool back;
 };
 
+// Grid cells covered by the robot footprint, relative to the cell of base_link
+struct FootprintCells
+{
+  std::vector<int> offsets;  // index offsets in the grid, row-major
+  int min_x = 0;             // bounding box of the cells [-]
+  int max_x = 0;
+  int min_y = 0;
+  int max_y = 0;
+  int radius = 0;            // largest row or column offset of the cells [-]
+};
+
 // For open list and goal list
 struct SimpleNode
 {
@@ -14,9 +14,13 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
 #include "astar_search/astar_search.h"
 
-AstarSearch::AstarSearch()
+AstarSearch::AstarSearch() : search_generation_(1)
 {
   ros::NodeHandle private_nh_("~");
 
@@ -149,19 +153,10 @@ void AstarSearch::initialize(const nav_msgs::OccupancyGrid& costmap)
   int height = costmap_.info.height;
   int width = costmap_.info.width;
 
-  // size initialization
-  nodes_.resize(height);
-  for (int i = 0; i < height; i++)
-  {
-    nodes_[i].resize(width);
-  }
-  for (int i = 0; i < height; i++)
-  {
-    for (int j = 0; j < width; j++)
-    {
-      nodes_[i][j].resize(theta_size_);
-    }
-  }
+  // size initialization, the nodes are cleared when they are reached by a search
+  nodes_.resize(static_cast<size_t>(height) * width * theta_size_);
+  obstacles_.assign(static_cast<size_t>(height) * width, 0);
+  cell_costs_.assign(static_cast<size_t>(height) * width, 0);
 
   // cost initialization
   for (int i = 0; i < height; i++)
@@ -172,7 +167,6 @@ void AstarSearch::initialize(const nav_msgs::OccupancyGrid& costmap)
       int og_index = i * width + j;
       int cost = costmap_.data[og_index];
 
-      // hc is set to be 0 when reset()
       if (cost == 0)
       {
         continue;
@@ -181,19 +175,137 @@ void AstarSearch::initialize(const nav_msgs::OccupancyGrid& costmap)
       // obstacle or unknown area
       if (cost < 0 || obstacle_threshold_ <= cost)
       {
-        nodes_[i][j][0].status = STATUS::OBS;
+        obstacles_[og_index] = 1;
       }
 
       // the cost more than threshold is regarded almost same as an obstacle
       // because of its very high cost
       if (use_potential_heuristic_)
       {
-        nodes_[i][j][0].hc = cost * potential_weight_;
+        cell_costs_[og_index] = cost * potential_weight_;
+      }
+    }
+  }
+
+  tf::Transform orig_tf;
+  tf::poseMsgToTF(costmap_.info.origin, orig_tf);
+  origin_inverse_tf_ = orig_tf.inverse();
+
+  calcObstacleClearances();
+  createFootprintTable();
+}
+
+// Chebyshev distance transform of the obstacles, in two passes over the grid: a footprint whose cells are at most
+// radius rows and columns away from its base cell can not touch an obstacle if the clearance of that cell is larger
+void AstarSearch::calcObstacleClearances()
+{
+  int height = costmap_.info.height;
+  int width = costmap_.info.width;
+  int no_obstacle = width + height;
+
+  obstacle_clearances_.resize(static_cast<size_t>(height) * width);
+  for (int i = 0; i < height; i++)
+  {
+    for (int j = 0; j < width; j++)
+    {
+      int index = i * width + j;
+      int clearance = obstacles_[index] ? 0 : no_obstacle;
+      if (clearance > 0 && j > 0)
+        clearance = std::min(clearance, obstacle_clearances_[index - 1] + 1);
+      if (clearance > 0 && i > 0)
+      {
+        for (int k = std::max(0, j - 1); k <= std::min(width - 1, j + 1); k++)
+          clearance = std::min(clearance, obstacle_clearances_[index - width - j + k] + 1);
       }
+      obstacle_clearances_[index] = clearance;
+    }
+  }
+  for (int i = height - 1; i >= 0; i--)
+  {
+    for (int j = width - 1; j >= 0; j--)
+    {
+      int index = i * width + j;
+      int clearance = obstacle_clearances_[index];
+      if (clearance > 0 && j < width - 1)
+        clearance = std::min(clearance, obstacle_clearances_[index + 1] + 1);
+      if (clearance > 0 && i < height - 1)
+      {
+        for (int k = std::max(0, j - 1); k <= std::min(width - 1, j + 1); k++)
+          clearance = std::min(clearance, obstacle_clearances_[index + width - j + k] + 1);
+      }
+      obstacle_clearances_[index] = clearance;
     }
   }
 }
 
+// cells covered by the robot for each angle, at the resolution of the costmap
+void AstarSearch::createFootprintTable()
+{
+  // Define the robot as rectangle
+  double left = -1.0 * robot_base2back_;
+  double right = robot_length_ - robot_base2back_;
+  double top = robot_width_ / 2.0;
+  double bottom = -1.0 * robot_width_ / 2.0;
+  double resolution = costmap_.info.resolution;
+  double one_angle_range = 2.0 * M_PI / theta_size_;
+
+  footprint_table_.assign(theta_size_, FootprintCells());
+  for (int i = 0; i < theta_size_; i++)
+  {
+    // Calculate cos and sin in advance
+    double cos_theta = std::cos(i * one_angle_range);
+    double sin_theta = std::sin(i * one_angle_range);
+
+    for (double x = left; x < right; x += resolution)
+    {
+      for (double y = top; y > bottom; y -= resolution)
+      {
+        // 2D point rotation
+        addFootprintCell(x * cos_theta - y * sin_theta, x * sin_theta + y * cos_theta, &footprint_table_[i]);
+      }
+    }
+    removeDuplicateFootprintCells(&footprint_table_[i]);
+  }
+
+  // Define the robot as square for wavefront search
+  double half = robot_width_ / 2;
+  wavefront_footprint_ = FootprintCells();
+  for (double y = half; y > -1.0 * half; y -= resolution)
+  {
+    for (double x = -1.0 * half; x < half; x += resolution)
+    {
+      addFootprintCell(x, y, &wavefront_footprint_);
+    }
+  }
+  removeDuplicateFootprintCells(&wavefront_footprint_);
+}
+
+void AstarSearch::addFootprintCell(double x, double y, FootprintCells* footprint)
+{
+  int index_x = std::floor(x / costmap_.info.resolution);
+  int index_y = std::floor(y / costmap_.info.resolution);
+
+  if (footprint->offsets.empty())
+  {
+    footprint->min_x = footprint->max_x = index_x;
+    footprint->min_y = footprint->max_y = index_y;
+  }
+  footprint->offsets.push_back(index_y * static_cast<int>(costmap_.info.width) + index_x);
+  footprint->min_x = std::min(footprint->min_x, index_x);
+  footprint->max_x = std::max(footprint->max_x, index_x);
+  footprint->min_y = std::min(footprint->min_y, index_y);
+  footprint->max_y = std::max(footprint->max_y, index_y);
+  footprint->radius = std::max(footprint->radius, std::max(std::abs(index_x), std::abs(index_y)));
+}
+
+void AstarSearch::removeDuplicateFootprintCells(FootprintCells* footprint)
+{
+  // the points of the footprint are spaced by the resolution, so several of them can be in the same cell
+  std::sort(footprint->offsets.begin(), footprint->offsets.end());
+  footprint->offsets.erase(std::unique(footprint->offsets.begin(), footprint->offsets.end()),
+                           footprint->offsets.end());
+}
+
 bool AstarSearch::makePlan(const geometry_msgs::Pose& start_pose, const geometry_msgs::Pose& goal_pose)
 {
   if (!setStartNode(start_pose))
@@ -226,7 +338,7 @@ bool AstarSearch::setStartNode(const geometry_msgs::Pose& start_pose)
   }
 
   // Set start node
-  AstarNode& start_node = nodes_[index_y][index_x][index_theta];
+  AstarNode& start_node = getNode(index_x, index_y, index_theta);
   start_node.x = start_pose_local_.pose.position.x;
   start_node.y = start_pose_local_.pose.position.y;
   start_node.theta = 2.0 * M_PI / theta_size_ * index_theta;
@@ -262,6 +374,9 @@ bool AstarSearch::setGoalNode(const geometry_msgs::Pose& goal_pose)
 {
   goal_pose_local_.pose = goal_pose;
   goal_yaw_ = modifyTheta(tf::getYaw(goal_pose_local_.pose.orientation));
+  tf::Transform goal_tf;
+  tf::poseMsgToTF(goal_pose_local_.pose, goal_tf);
+  goal_inverse_tf_ = goal_tf.inverse();
 
   // Get index of goal pose
   int index_x, index_y, index_theta;
@@ -314,12 +429,13 @@ void AstarSearch::poseToIndex(const geometry_msgs::Pose& pose, int* index_x, int
   *index_theta %= theta_size_;
 }
 
+// Same as the position of poseToIndex, without transforming an orientation for each expanded node
 void AstarSearch::pointToIndex(const geometry_msgs::Point& point, int* index_x, int* index_y)
 {
-  geometry_msgs::Pose pose;
-  pose.position = point;
-  int index_theta;
-  poseToIndex(pose, index_x, index_y, &index_theta);
+  tf::Point point2d = origin_inverse_tf_ * tf::Point(point.x, point.y, point.z);
+
+  *index_x = point2d.x() / costmap_.info.resolution;
+  *index_y = point2d.y() / costmap_.info.resolution;
 }
 
 bool AstarSearch::isOutOfRange(int index_x, int index_y)
@@ -354,7 +470,7 @@ bool AstarSearch::search()
     openlist_.pop();
 
     // Expand nodes from this node
-    AstarNode* current_an = &nodes_[top_sn.index_y][top_sn.index_x][top_sn.index_theta];
+    AstarNode* current_an = &getNode(top_sn.index_x, top_sn.index_y, top_sn.index_theta);
     current_an->status = STATUS::CLOSED;
 
     // Goal check
@@ -396,14 +512,15 @@ bool AstarSearch::search()
         continue;
       }
 
-      AstarNode* next_an = &nodes_[next_sn.index_y][next_sn.index_x][next_sn.index_theta];
+      AstarNode* next_an = &getNode(next_sn.index_x, next_sn.index_y, next_sn.index_theta);
+      double cell_cost = cell_costs_[next_sn.index_y * costmap_.info.width + next_sn.index_x];
       double next_gc = current_an->gc + move_cost;
-      double next_hc = nodes_[next_sn.index_y][next_sn.index_x][0].hc;  // wavefront or distance transform heuristic
+      double next_hc = cell_cost;  // wavefront or distance transform heuristic
 
       // increase the cost with euclidean distance
       if (use_potential_heuristic_)
       {
-        next_gc += nodes_[next_sn.index_y][next_sn.index_x][0].hc;
+        next_gc += cell_cost;
         next_hc += calcDistance(next_x, next_y, goal_pose_local_.pose.position.x, goal_pose_local_.pose.position.y) *
                    distance_heuristic_weight_;
       }
@@ -467,7 +584,7 @@ void AstarSearch::setPath(const SimpleNode& goal)
   path_.header = header;
 
   // From the goal node to the start node
-  AstarNode* node = &nodes_[goal.index_y][goal.index_x][goal.index_theta];
+  AstarNode* node = &getNode(goal.index_x, goal.index_y, goal.index_theta);
 
   while (node != NULL)
   {
@@ -502,14 +619,14 @@ bool AstarSearch::isGoal(double x, double y, double theta)
       longitudinal_goal_range_ / 2.0;                                         // [meter], check only behind of the goal
   static const double goal_angle = M_PI * (angle_goal_range_ / 2.0) / 180.0;  // degrees -> radian
 
-  // Calculate the node coordinate seen from the goal point
-  tf::Point p(x, y, 0);
-  geometry_msgs::Point relative_node_point = calcRelativeCoordinate(goal_pose_local_.pose, p);
+  // Calculate the node coordinate seen from the goal point, as calcRelativeCoordinate with the inverse of the goal
+  // pose computed once in setGoalNode
+  tf::Point relative_node_point = goal_inverse_tf_ * tf::Point(x, y, 0);
 
   // Check Pose of goal
-  if (relative_node_point.x < 0 &&  // shoud be behind of goal
-      std::fabs(relative_node_point.x) < longitudinal_goal_range &&
-      std::fabs(relative_node_point.y) < lateral_goal_range)
+  if (relative_node_point.x() < 0 &&  // shoud be behind of goal
+      std::fabs(relative_node_point.x()) < longitudinal_goal_range &&
+      std::fabs(relative_node_point.y()) < lateral_goal_range)
   {
     // Check the orientation of goal
     if (calcDiffOfRadian(goal_yaw_, theta) < goal_angle)
@@ -523,7 +640,7 @@ bool AstarSearch::isGoal(double x, double y, double theta)
 
 bool AstarSearch::isObs(int index_x, int index_y)
 {
-  if (nodes_[index_y][index_x][0].status == STATUS::OBS)
+  if (obstacles_[index_y * costmap_.info.width + index_x])
   {
     return true;
   }
@@ -533,51 +650,57 @@ bool AstarSearch::isObs(int index_x, int index_y)
 
 bool AstarSearch::detectCollision(const SimpleNode& sn)
 {
-  // Define the robot as rectangle
-  static double left = -1.0 * robot_base2back_;
-  static double right = robot_length_ - robot_base2back_;
-  static double top = robot_width_ / 2.0;
-  static double bottom = -1.0 * robot_width_ / 2.0;
-  static double resolution = costmap_.info.resolution;
+  return detectFootprintCollision(sn.index_x, sn.index_y, footprint_table_[sn.index_theta]);
+}
 
-  // Coordinate of base_link in OccupancyGrid frame
-  static double one_angle_range = 2.0 * M_PI / theta_size_;
-  double base_x = sn.index_x * resolution;
-  double base_y = sn.index_y * resolution;
-  double base_theta = sn.index_theta * one_angle_range;
+// Check if the footprint at the cell is out of range or on an obstacle
+bool AstarSearch::detectFootprintCollision(int index_x, int index_y, const FootprintCells& footprint)
+{
+  if (isOutOfRange(index_x + footprint.min_x, index_y + footprint.min_y) ||
+      isOutOfRange(index_x + footprint.max_x, index_y + footprint.max_y))
+  {
+    return true;
+  }
 
-  // Calculate cos and sin in advance
-  double cos_theta = std::cos(base_theta);
-  double sin_theta = std::sin(base_theta);
+  // no obstacle within the rows and columns of the footprint
+  int index = index_y * costmap_.info.width + index_x;
+  if (obstacle_clearances_[index] > footprint.radius)
+  {
+    return false;
+  }
 
-  // Convert each point to index and check if the node is Obstacle
-  for (double x = left; x < right; x += resolution)
+  const uint8_t* base = &obstacles_[index];
+  for (int offset : footprint.offsets)
   {
-    for (double y = top; y > bottom; y -= resolution)
+    if (base[offset])
     {
-      // 2D point rotation
-      int index_x = (x * cos_theta - y * sin_theta + base_x) / resolution;
-      int index_y = (x * sin_theta + y * cos_theta + base_y) / resolution;
-
-      if (isOutOfRange(index_x, index_y))
-      {
-        return true;
-      }
-      else if (nodes_[index_y][index_x][0].status == STATUS::OBS)
-      {
-        return true;
-      }
+      return true;
     }
   }
 
   return false;
 }
 
+// Node of the current search, nodes reached in previous searches are cleared first
+AstarNode& AstarSearch::getNode(int index_x, int index_y, int index_theta)
+{
+  AstarNode& node = nodes_[(static_cast<size_t>(index_y) * costmap_.info.width + index_x) * theta_size_ + index_theta];
+  if (node.generation != search_generation_)
+  {
+    // other values will be updated during the search
+    node.generation = search_generation_;
+    node.status = STATUS::NONE;
+    node.hc = 0;
+  }
+
+  return node;
+}
+
 bool AstarSearch::calcWaveFrontHeuristic(const SimpleNode& sn)
 {
   // Set start point for wavefront search
   // This is goal for Astar search
-  nodes_[sn.index_y][sn.index_x][0].hc = 0;
+  cell_costs_[sn.index_y * costmap_.info.width + sn.index_x] = 0;
   WaveFrontNode wf_node(sn.index_x, sn.index_y, 1e-10);
   std::queue<WaveFrontNode> qu;
   qu.push(wf_node);
@@ -618,8 +741,8 @@ bool AstarSearch::calcWaveFrontHeuristic(const SimpleNode& sn)
       next.index_y = ref.index_y + u.index_y;
 
       // out of range OR already visited OR obstacle node
-      if (isOutOfRange(next.index_x, next.index_y) || nodes_[next.index_y][next.index_x][0].hc > 0 ||
-          nodes_[next.index_y][next.index_x][0].status == STATUS::OBS)
+      if (isOutOfRange(next.index_x, next.index_y) ||
+          cell_costs_[next.index_y * costmap_.info.width + next.index_x] > 0 || isObs(next.index_x, next.index_y))
       {
         continue;
       }
@@ -638,7 +761,7 @@ bool AstarSearch::calcWaveFrontHeuristic(const SimpleNode& sn)
 
       // Set wavefront heuristic cost
       next.hc = ref.hc + u.hc;
-      nodes_[next.index_y][next.index_x][0].hc = next.hc;
+      cell_costs_[next.index_y * costmap_.info.width + next.index_x] = next.hc;
 
       qu.push(next);
     }
@@ -651,31 +774,7 @@ bool AstarSearch::calcWaveFrontHeuristic(const SimpleNode& sn)
 // Simple collidion detection for wavefront search
 bool AstarSearch::detectCollisionWaveFront(const WaveFrontNode& ref)
 {
-  // Define the robot as square
-  static double half = robot_width_ / 2;
-  double robot_x = ref.index_x * costmap_.info.resolution;
-  double robot_y = ref.index_y * costmap_.info.resolution;
-
-  for (double y = half; y > -1.0 * half; y -= costmap_.info.resolution)
-  {
-    for (double x = -1.0 * half; x < half; x += costmap_.info.resolution)
-    {
-      int index_x = (robot_x + x) / costmap_.info.resolution;
-      int index_y = (robot_y + y) / costmap_.info.resolution;
-
-      if (isOutOfRange(index_x, index_y))
-      {
-        return true;
-      }
-
-      if (nodes_[index_y][index_x][0].status == STATUS::OBS)
-      {
-        return true;
-      }
-    }
-  }
-
-  return false;
+  return detectFootprintCollision(ref.index_x, ref.index_y, wavefront_footprint_);
 }
 
 void AstarSearch::reset()
@@ -686,23 +785,14 @@ void AstarSearch::reset()
   std::priority_queue<SimpleNode, std::vector<SimpleNode>, std::greater<SimpleNode>> empty;
   std::swap(openlist_, empty);
 
-  // ros::WallTime begin = ros::WallTime::now();
-
-  // Reset node info here ...?
-  for (size_t i = 0; i < costmap_.info.height; i++)
+  // Nodes of the previous searches are cleared when getNode() reaches them
+  search_generation_++;
+  if (search_generation_ == 0)
   {
-    for (size_t j = 0; j < costmap_.info.width; j++)
+    for (auto& node : nodes_)
     {
-      for (int k = 0; k < theta_size_; k++)
-      {
-        // other values will be updated during the search
-        nodes_[i][j][k].status = STATUS::NONE;
-        nodes_[i][j][k].hc = 0;
-      }
+      node.generation = 0;
     }
+    search_generation_ = 1;
   }
-
-  // ros::WallTime end = ros::WallTime::now();
-
-  // ROS_INFO("Reset time: %lf [ms]", (end - begin).toSec() * 1000);
 }
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Time of initialize(), makePlan() and reset() of AstarSearch, as astar_navi and astar_avoid call them on each
+// replan. The costmaps are made as in test_class.cpp, with the origin at the centre of the grid: the test costmap
+// itself, then costmaps of the size published by costmap_generator with the obstacles of the test scaled to them.
+//
+// usage: astar_search-benchmark [repetitions]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <ros/ros.h>
+
+#include "astar_search/astar_search.h"
+
+namespace
+{
+nav_msgs::OccupancyGrid makeCostmap(double resolution, int width, int height)
+{
+  nav_msgs::OccupancyGrid costmap;
+  costmap.header.frame_id = "world";
+  costmap.info.resolution = resolution;
+  costmap.info.width = width;
+  costmap.info.height = height;
+
+  // Costmap origin set to be the centre of the grid (as in points2costmap.cpp)
+  costmap.info.origin.position.x = -costmap.info.resolution * costmap.info.width / 2;
+  costmap.info.origin.position.y = -costmap.info.resolution * costmap.info.height / 2;
+  costmap.info.origin.orientation.w = 1;
+  costmap.data.assign(width * height, 0);
+
+  // obstacle at the corner and wall over the lower half of the grid, at the same place as in the test costmap
+  int wall_x = width * 24 / 41;
+  costmap.data[0] = 100;
+  for (int row = 0; row < height / 2; ++row)
+  {
+    for (int col = wall_x; col < std::min(width, wall_x + std::max(1, width / 41)); ++col)
+    {
+      costmap.data[row * width + col] = 100;
+    }
+  }
+
+  // cost decreasing around the wall, as the blurred costmap of costmap_generator
+  for (int row = 0; row < height; ++row)
+  {
+    for (int col = 0; col < width; ++col)
+    {
+      int distance = std::abs(col - wall_x) + std::max(0, row - height / 2 + 1);
+      int8_t& cost = costmap.data[row * width + col];
+      cost = std::max<int>(cost, std::max(0, 60 - 10 * distance));
+    }
+  }
+
+  return costmap;
+}
+
+geometry_msgs::Pose makePose(double x, double y, double yaw)
+{
+  geometry_msgs::Pose pose;
+  pose.position.x = x;
+  pose.position.y = y;
+  pose.orientation = tf::createQuaternionMsgFromYaw(yaw);
+  return pose;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "astar_search_benchmark");
+  ros::NodeHandle nh("~");
+  nh.setParam("lateral_goal_range", 1.5);
+
+  const int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+
+  struct Scenario
+  {
+    std::string name;
+    nav_msgs::OccupancyGrid costmap;
+    geometry_msgs::Pose start_pose;
+    geometry_msgs::Pose goal_pose;
+  };
+  Scenario scenarios[] = {
+    { "test costmap, 41x11 cells of 1 m, goal 10 m ahead", makeCostmap(1.0, 41, 11), makePose(0, 0, 0),
+      makePose(10, 0, 0) },
+    { "costmap_generator size, 250x150 cells of 0.2 m, goal 10 m ahead", makeCostmap(0.2, 250, 150),
+      makePose(0, 0, 0), makePose(10, 0, 0) },
+    { "costmap_generator size, 250x150 cells of 0.2 m, goal behind the wall", makeCostmap(0.2, 250, 150),
+      makePose(-10, 6, 0), makePose(12, -6, 0) },
+    { "costmap_generator size, 250x150 cells of 0.2 m, turn back", makeCostmap(0.2, 250, 150), makePose(-8, 8, 0),
+      makePose(-14, 10, M_PI) },
+  };
+
+  typedef std::chrono::steady_clock Clock;
+  for (const auto& scenario : scenarios)
+  {
+    AstarSearch astar;
+    double initialize_time = 0;
+    double plan_time = 0;
+    double reset_time = 0;
+    bool found = false;
+    size_t path_size = 0;
+    for (int repetition = 0; repetition < repetitions; repetition++)
+    {
+      Clock::time_point start = Clock::now();
+      astar.initialize(scenario.costmap);
+      Clock::time_point initialized = Clock::now();
+      found = astar.makePlan(scenario.start_pose, scenario.goal_pose);
+      path_size = astar.getPath().poses.size();
+      Clock::time_point planned = Clock::now();
+      astar.reset();
+      Clock::time_point end = Clock::now();
+
+      initialize_time += std::chrono::duration<double>(initialized - start).count();
+      plan_time += std::chrono::duration<double>(planned - initialized).count();
+      reset_time += std::chrono::duration<double>(end - planned).count();
+    }
+
+    std::printf("%s: %s (%zu poses), initialize %.3f ms, makePlan %.3f ms, reset %.3f ms\n", scenario.name.c_str(),
+                found ? "found" : "not found", path_size, initialize_time / repetitions * 1e3,
+                plan_time / repetitions * 1e3, reset_time / repetitions * 1e3);
+  }
+
+  return 0;
+}
@@ -167,3 +167,16 @@ TEST_F(TestSuite, checkMakePlan)
   test_obj_.astar_search_obj.initialize(test_obj_.costmap_);
   ASSERT_TRUE(test_obj_.astar_search_obj.makePlan(start_pose_, goal_pose_)) << "makePlan should return True";
 }
+
+TEST_F(TestSuite, checkMakePlanAfterReset)
+{
+  test_obj_.astar_search_obj.initialize(test_obj_.costmap_);
+  ASSERT_TRUE(test_obj_.astar_search_obj.makePlan(start_pose_, goal_pose_)) << "makePlan should return True";
+  size_t path_size = test_obj_.astar_search_obj.getPath().poses.size();
+
+  // nodes of the previous search should not be reused
+  test_obj_.astar_search_obj.reset();
+  test_obj_.astar_search_obj.initialize(test_obj_.costmap_);
+  ASSERT_TRUE(test_obj_.astar_search_obj.makePlan(start_pose_, goal_pose_)) << "makePlan should return True after reset";
+  ASSERT_EQ(path_size, test_obj_.astar_search_obj.getPath().poses.size()) << "path should be the same after reset";
+}
@@ -45,6 +45,7 @@
 #include "autoware_msgs/DetectedObjectArray.h"
 #include "points_to_costmap.h"
 #include "objects_to_costmap.h"
+#include "wayarea_to_costmap.h"
 
 // headers in STL
 #include <memory>
@@ -101,6 +102,7 @@ private:
 
   PointsToCostmap points2costmap_;
   ObjectsToCostmap objects2costmap_;
+  WayareaToCostmap wayarea2costmap_;
 
   const std::string OBJECTS_BOX_COSTMAP_LAYER_;
   const std::string OBJECTS_CONVEX_HULL_COSTMAP_LAYER_;
@@ -134,11 +136,11 @@ private:
   grid_map::Matrix generateObjectsCostmap(const autoware_msgs::DetectedObjectArray::ConstPtr& in_objects,
                                           const bool use_objects_convex_hull);
 
-  /// \brief calculate cost from vectormap
-  grid_map::Matrix generateVectormapCostmap();
+  /// \brief calculate cost from vectormap in costmap_, in place
+  void generateVectormapCostmap();
 
-  /// \brief calculate cost for final output
-  grid_map::Matrix generateCombinedCostmap();
+  /// \brief calculate cost for final output in costmap_, in place
+  void generateCombinedCostmap();
 };
 
 #endif  // COSTMAP_GENERATOR_H
@@ -106,6 +106,7 @@ private:
 
   PointsToCostmap points2costmap_;
   ObjectsToCostmap objects2costmap_;
+  WayareaToCostmap wayarea2costmap_;
 
   const std::string OBJECTS_BOX_COSTMAP_LAYER_;
   const std::string OBJECTS_CONVEX_HULL_COSTMAP_LAYER_;
@@ -152,11 +153,11 @@ private:
   grid_map::Matrix generateObjectsCostmap(const autoware_msgs::DetectedObjectArray::ConstPtr& in_objects,
                                           const bool use_objects_convex_hull);
 
-  /// \brief calculate cost from lanelet2 map
-  grid_map::Matrix generateLanelet2Costmap();
+  /// \brief calculate cost from lanelet2 map in costmap_, in place
+  void generateLanelet2Costmap();
 
-  /// \brief calculate cost for final output
-  grid_map::Matrix generateCombinedCostmap();
+  /// \brief calculate cost for final output in costmap_, in place
+  void generateCombinedCostmap();
 };
 
 #endif  // COSTMAP_GENERATOR_H
@@ -31,6 +31,9 @@
 #ifndef OBJECTS_TO_COSTMAP_H
 #define OBJECTS_TO_COSTMAP_H
 
+// headers in standard library
+#include <vector>
+
 // headers in ROS
 #include <ros/ros.h>
 #include <grid_map_ros/grid_map_ros.hpp>
@@ -55,6 +58,15 @@ public:
                                           const autoware_msgs::DetectedObjectArray::ConstPtr& in_objects,
                                           const bool use_objects_convex_hull);
 
+  /// \brief blur cost with the mean of the finite costs in a window around each cell, in place. Same result as
+  /// setting each cell in the order of grid_map::SlidingWindowIterator with CROP edges to meanOfFinites(), which
+  /// reads the cells already blurred, but with summed-area tables instead of summing the whole window for each cell
+  /// \param[in] gridmap_layer_name: target gridmap layer name for blurred cost
+  /// \param[in] size_of_expansion_kernel: odd window size in cells, std::invalid_argument is thrown for even sizes
+  /// \param[in] objects_costmap: update cost in this objects_costmap[gridmap_layer_name]
+  void blurCostInLayer(const std::string& gridmap_layer_name, const double size_of_expansion_kernel,
+                       grid_map::GridMap& objects_costmap);
+
 private:
   friend class TestClass;
 
@@ -62,6 +74,23 @@ private:
   const int NUMBER_OF_DIMENSIONS;
   const std::string OBJECTS_COSTMAP_LAYER_;
   const std::string BLURRED_OBJECTS_COSTMAP_LAYER_;
+  // windows up to this size are summed cell by cell in blurCostInLayer
+  const int MAX_SUMMED_WINDOW_SIZE_;
+
+  grid_map::GridMap objects_costmap_;
+
+  // sum of the finite costs, number of finite, positive and negative costs of the rectangle from cell (0, 0)
+  struct CostSums
+  {
+    double sum;
+    int finite_count;
+    int positive_count;
+    int negative_count;
+  };
+
+  // summed-area tables of the costs before and after blurring, of (rows + 1) x (cols + 1) in column-major order
+  std::vector<CostSums> original_sums_;
+  std::vector<CostSums> blurred_sums_;
 
   /// \brief make 4 rectangle points from centroid position and orientation
   /// \param[in] in_object: subscribed one of DetectedObjectArray
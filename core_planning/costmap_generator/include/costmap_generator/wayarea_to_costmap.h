@@ -0,0 +1,82 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WAYAREA_TO_COSTMAP_H
+#define WAYAREA_TO_COSTMAP_H
+
+// headers in ROS
+#include <geometry_msgs/Point.h>
+#include <grid_map_ros/grid_map_ros.hpp>
+#include <tf/transform_datatypes.h>
+
+// headers in STL
+#include <string>
+#include <vector>
+
+/// Wayarea polygons are rasterized once in map frame, around the costmap, and the raster is resampled into the
+/// costmap on every frame. The raster is made again only when the costmap moves out of it.
+class WayareaToCostmap
+{
+public:
+  WayareaToCostmap();
+  ~WayareaToCostmap();
+
+  /// \brief set wayarea polygons, the raster is made on the next call of makeCostmapFromWayarea
+  /// \param[in] area_points: wayarea polygons in map frame
+  void setAreaPoints(const std::vector<std::vector<geometry_msgs::Point>>& area_points);
+
+  /// \brief check if wayarea polygons were set
+  /// \param[out] bool: true if there is at least one wayarea polygon
+  bool hasAreaPoints() const;
+
+  /// \brief calculate cost from wayarea in the layer of costmap, in place
+  /// \param[in] costmap2map: transform from costmap frame to map frame
+  /// \param[in] grid_min_value: cost in wayarea
+  /// \param[in] grid_max_value: cost out of wayarea
+  /// \param[in] gridmap_layer_name: gridmap layer name for calculated cost
+  /// \param[in] costmap: update cost in this costmap[gridmap_layer_name]
+  void makeCostmapFromWayarea(const tf::Transform& costmap2map, const double grid_min_value,
+                              const double grid_max_value, const std::string& gridmap_layer_name,
+                              grid_map::GridMap& costmap);
+
+private:
+  friend class TestClass;
+
+  std::vector<std::vector<geometry_msgs::Point>> area_points_;
+
+  // 1 for the cells whose center is in wayarea, row-major from (raster_min_x_, raster_min_y_)
+  std::vector<unsigned char> raster_;
+  double raster_resolution_;
+  double raster_min_x_;
+  double raster_min_y_;
+  int raster_cols_;
+  int raster_rows_;
+
+  /// \brief check if the raster covers a bounding box in map frame at the resolution
+  /// \param[in] min_x, min_y, max_x, max_y: bounding box in map frame
+  /// \param[in] resolution: cell size of the raster
+  /// \param[out] bool: true if the raster can be resampled for this bounding box
+  bool isCoveredByRaster(const double min_x, const double min_y, const double max_x, const double max_y,
+                         const double resolution) const;
+
+  /// \brief rasterize wayarea polygons in a window around a bounding box in map frame
+  /// \param[in] min_x, min_y, max_x, max_y: bounding box in map frame
+  /// \param[in] resolution: cell size of the raster
+  void rasterizeAreas(const double min_x, const double min_y, const double max_x, const double max_y,
+                      const double resolution);
+};
+
+#endif  // WAYAREA_TO_COSTMAP_H
@@ -29,7 +29,6 @@
  ********************/
 
 #include <costmap_generator/costmap_generator_lanelet2.h>
-#include <object_map/object_map_utils.hpp>
 
 #include <lanelet2_extension/utility/query.h>
 #include <lanelet2_extension/visualization/visualization.h>
@@ -119,6 +118,7 @@ void CostmapGeneratorLanelet2::laneletBinMapCallback(const autoware_lanelet2_msg
   lanelet::utils::conversion::fromBinMsg(msg, lanelet_map_);
   loaded_lanelet_map_ = true;
   loadRoadAreasFromLaneletMap(lanelet_map_, &area_points_);
+  wayarea2costmap_.setAreaPoints(area_points_);
 }
 
 void CostmapGeneratorLanelet2::objectsCallback(const autoware_msgs::DetectedObjectArray::ConstPtr& in_objects)
@@ -138,8 +138,8 @@ void CostmapGeneratorLanelet2::objectsCallback(const autoware_msgs::DetectedObje
   {
     costmap_[OBJECTS_CONVEX_HULL_COSTMAP_LAYER_] = generateObjectsCostmap(in_objects, use_objects_convex_hull_);
   }
-  costmap_[LANELET2_COSTMAP_LAYER_] = generateLanelet2Costmap();
-  costmap_[COMBINED_COSTMAP_LAYER_] = generateCombinedCostmap();
+  generateLanelet2Costmap();
+  generateCombinedCostmap();
 
   std_msgs::Header in_header = in_objects->header;
   publishRosMsg(costmap_, in_header);
@@ -155,8 +155,8 @@ void CostmapGeneratorLanelet2::sensorPointsCallback(const sensor_msgs::PointClou
   pcl::PointCloud<pcl::PointXYZ>::Ptr in_sensor_points(new pcl::PointCloud<pcl::PointXYZ>);
   pcl::fromROSMsg(*in_sensor_points_msg, *in_sensor_points);
   costmap_[SENSOR_POINTS_COSTMAP_LAYER_] = generateSensorPointsCostmap(in_sensor_points);
-  costmap_[LANELET2_COSTMAP_LAYER_] = generateLanelet2Costmap();
-  costmap_[COMBINED_COSTMAP_LAYER_] = generateCombinedCostmap();
+  generateLanelet2Costmap();
+  generateCombinedCostmap();
 
   std_msgs::Header in_header = in_sensor_points_msg->header;
   publishRosMsg(costmap_, in_header);
@@ -192,33 +192,36 @@ grid_map::Matrix CostmapGeneratorLanelet2::generateObjectsCostmap(
   return objects_costmap;
 }
 
-grid_map::Matrix CostmapGeneratorLanelet2::generateLanelet2Costmap()
+void CostmapGeneratorLanelet2::generateLanelet2Costmap()
 {
-  grid_map::GridMap lanelet2_costmap = costmap_;
-  if (use_wayarea_ && !area_points_.empty())
+  if (!use_wayarea_ || !wayarea2costmap_.hasAreaPoints())
   {
-    has_subscribed_wayarea_ = true;
-    object_map::FillPolygonAreas(lanelet2_costmap, area_points_, LANELET2_COSTMAP_LAYER_, grid_max_value_,
-                                 grid_min_value_, grid_min_value_, grid_max_value_, lidar_frame_, map_frame_,
-                                 tf_listener_);
+    return;
+  }
+
+  tf::StampedTransform lidar2map;
+  try
+  {
+    tf_listener_.lookupTransform(map_frame_, lidar_frame_, ros::Time(0), lidar2map);
+  }
+  catch (tf::TransformException ex)
+  {
+    ROS_ERROR("%s", ex.what());
+    return;
   }
-  return lanelet2_costmap[LANELET2_COSTMAP_LAYER_];
+  wayarea2costmap_.makeCostmapFromWayarea(lidar2map, grid_min_value_, grid_max_value_, LANELET2_COSTMAP_LAYER_,
+                                          costmap_);
 }
 
-grid_map::Matrix CostmapGeneratorLanelet2::generateCombinedCostmap()
+void CostmapGeneratorLanelet2::generateCombinedCostmap()
 {
   // assuming combined_costmap is calculated by element wise max operation
-  grid_map::GridMap combined_costmap = costmap_;
-  combined_costmap[COMBINED_COSTMAP_LAYER_].setConstant(grid_min_value_);
-  combined_costmap[COMBINED_COSTMAP_LAYER_] =
-      combined_costmap[COMBINED_COSTMAP_LAYER_].cwiseMax(combined_costmap[SENSOR_POINTS_COSTMAP_LAYER_]);
-  combined_costmap[COMBINED_COSTMAP_LAYER_] =
-      combined_costmap[COMBINED_COSTMAP_LAYER_].cwiseMax(combined_costmap[LANELET2_COSTMAP_LAYER_]);
-  combined_costmap[COMBINED_COSTMAP_LAYER_] =
-      combined_costmap[COMBINED_COSTMAP_LAYER_].cwiseMax(combined_costmap[OBJECTS_BOX_COSTMAP_LAYER_]);
-  combined_costmap[COMBINED_COSTMAP_LAYER_] =
-      combined_costmap[COMBINED_COSTMAP_LAYER_].cwiseMax(combined_costmap[OBJECTS_CONVEX_HULL_COSTMAP_LAYER_]);
-  return combined_costmap[COMBINED_COSTMAP_LAYER_];
+  grid_map::Matrix& combined_costmap = costmap_[COMBINED_COSTMAP_LAYER_];
+  combined_costmap.setConstant(grid_min_value_);
+  combined_costmap = combined_costmap.cwiseMax(costmap_[SENSOR_POINTS_COSTMAP_LAYER_]);
+  combined_costmap = combined_costmap.cwiseMax(costmap_[LANELET2_COSTMAP_LAYER_]);
+  combined_costmap = combined_costmap.cwiseMax(costmap_[OBJECTS_BOX_COSTMAP_LAYER_]);
+  combined_costmap = combined_costmap.cwiseMax(costmap_[OBJECTS_CONVEX_HULL_COSTMAP_LAYER_]);
 }
 
 void CostmapGeneratorLanelet2::publishRosMsg(const grid_map::GridMap& costmap, const std_msgs::Header& in_header)
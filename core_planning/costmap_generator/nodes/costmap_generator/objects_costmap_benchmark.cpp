@@ -0,0 +1,115 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Time of the blur of the objects costmap, with grid_map::SlidingWindowIterator and meanOfFinites() as
+// makeCostmapFromObjects used to do, and with ObjectsToCostmap::blurCostInLayer, for several grid sizes and
+// size_of_expansion_kernel values. The costmap has random object boxes and a few NaN cells.
+//
+// usage: costmap_generator_objects_benchmark [repetitions]
+
+// headers in standard library
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+// headers in local directory
+#include "costmap_generator/objects_to_costmap.h"
+
+int main(int argc, char** argv)
+{
+  const int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+  const std::string layer = "blurred_objects_costmap";
+  const double grid_resolution = 0.2;
+  const double grid_lengths[][2] = { { 50, 30 }, { 100, 100 }, { 200, 200 } };
+  const int kernel_sizes[] = { 3, 9, 15, 31 };
+
+  typedef std::chrono::steady_clock Clock;
+  ObjectsToCostmap objects2costmap;
+  for (const auto& grid_length : grid_lengths)
+  {
+    grid_map::GridMap costmap;
+    costmap.setGeometry(grid_map::Length(grid_length[0], grid_length[1]), grid_resolution);
+    costmap.add(layer, 0);
+
+    // boxes of 1 to 5 m with scores, one per 20 m x 20 m
+    std::srand(0);
+    grid_map::Matrix& costs = costmap[layer];
+    const int objects_num = static_cast<int>(grid_length[0] * grid_length[1] / 400) + 1;
+    for (int object = 0; object < objects_num; object++)
+    {
+      const int row = std::rand() % costs.rows();
+      const int col = std::rand() % costs.cols();
+      const int rows = static_cast<int>((1 + std::rand() % 5) / grid_resolution);
+      const int cols = static_cast<int>((1 + std::rand() % 5) / grid_resolution);
+      const float score = (1 + std::rand() % 100) / 100.0;
+      costs.block(row, col, std::min(rows, static_cast<int>(costs.rows()) - row),
+                  std::min(cols, static_cast<int>(costs.cols()) - col))
+          .setConstant(score);
+    }
+    for (int cell = 0; cell < 10; cell++)
+    {
+      costs(std::rand() % costs.rows(), std::rand() % costs.cols()) = std::numeric_limits<float>::quiet_NaN();
+    }
+
+    for (const int kernel_size : kernel_sizes)
+    {
+      double iterator_time = 0;
+      double blur_time = 0;
+      double max_difference = 0;
+      for (int repetition = 0; repetition < repetitions; repetition++)
+      {
+        grid_map::GridMap iterator_costmap = costmap;
+        Clock::time_point start = Clock::now();
+        for (grid_map::SlidingWindowIterator iterator(iterator_costmap, layer,
+                                                      grid_map::SlidingWindowIterator::EdgeHandling::CROP,
+                                                      kernel_size);
+             !iterator.isPastEnd(); ++iterator)
+        {
+          iterator_costmap.at(layer, *iterator) = iterator.getData().meanOfFinites();
+        }
+        iterator_time += std::chrono::duration<double>(Clock::now() - start).count();
+
+        grid_map::GridMap blurred_costmap = costmap;
+        start = Clock::now();
+        objects2costmap.blurCostInLayer(layer, kernel_size, blurred_costmap);
+        blur_time += std::chrono::duration<double>(Clock::now() - start).count();
+
+        const grid_map::Matrix& expected = iterator_costmap[layer];
+        const grid_map::Matrix& blurred = blurred_costmap[layer];
+        for (int i = 0; i < expected.size(); i++)
+        {
+          if (std::isfinite(expected(i)) != std::isfinite(blurred(i)))
+          {
+            max_difference = std::numeric_limits<double>::infinity();
+          }
+          else if (std::isfinite(expected(i)))
+          {
+            max_difference = std::max(max_difference, static_cast<double>(std::fabs(expected(i) - blurred(i))));
+          }
+        }
+      }
+
+      std::printf("%4dx%-4d cells, kernel %2d: sliding window %8.3f ms, blurCostInLayer %7.3f ms, max difference "
+                  "%.2g\n",
+                  static_cast<int>(costs.rows()), static_cast<int>(costs.cols()), kernel_size,
+                  iterator_time / repetitions * 1e3, blur_time / repetitions * 1e3, max_difference);
+    }
+  }
+  return 0;
+}
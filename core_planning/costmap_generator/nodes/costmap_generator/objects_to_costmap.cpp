@@ -29,7 +29,10 @@
  ********************/
 
 // headers in standard library
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
 
 // headers in ROS
 #include <tf/transform_datatypes.h>
@@ -42,7 +45,8 @@ ObjectsToCostmap::ObjectsToCostmap() :
 NUMBER_OF_POINTS(4),
 NUMBER_OF_DIMENSIONS(2),
 OBJECTS_COSTMAP_LAYER_("objects_costmap"),
-BLURRED_OBJECTS_COSTMAP_LAYER_("blurred_objects_costmap")
+BLURRED_OBJECTS_COSTMAP_LAYER_("blurred_objects_costmap"),
+MAX_SUMMED_WINDOW_SIZE_(3)
 {
 }
 
@@ -145,7 +149,10 @@ grid_map::Matrix ObjectsToCostmap::makeCostmapFromObjects(const grid_map::GridMa
                                                          const autoware_msgs::DetectedObjectArray::ConstPtr& in_objects,
                                                          const bool use_objects_convex_hull)
 {
-  grid_map::GridMap objects_costmap = costmap;
+  // Only the geometry of costmap is used, the layers are made in objects_costmap_ which is reused between calls
+  grid_map::GridMap& objects_costmap = objects_costmap_;
+  objects_costmap.setFrameId(costmap.getFrameId());
+  objects_costmap.setGeometry(costmap.getLength(), costmap.getResolution(), costmap.getPosition());
   objects_costmap.add(OBJECTS_COSTMAP_LAYER_, 0);
   objects_costmap.add(BLURRED_OBJECTS_COSTMAP_LAYER_, 0);
 
@@ -164,18 +171,135 @@ grid_map::Matrix ObjectsToCostmap::makeCostmapFromObjects(const grid_map::GridMa
     setCostInPolygon(expanded_polygon, BLURRED_OBJECTS_COSTMAP_LAYER_, object.score, objects_costmap);
   }
   // Applying mean filter to expanded gridmap
-  const grid_map::SlidingWindowIterator::EdgeHandling edge_handling =
-      grid_map::SlidingWindowIterator::EdgeHandling::CROP;
-  for (grid_map::SlidingWindowIterator iterator(objects_costmap, BLURRED_OBJECTS_COSTMAP_LAYER_, edge_handling,
-                                                size_of_expansion_kernel);
-       !iterator.isPastEnd(); ++iterator)
-  {
-    objects_costmap.at(BLURRED_OBJECTS_COSTMAP_LAYER_, *iterator) =
-        iterator.getData().meanOfFinites();  // Blurring.
-  }
+  blurCostInLayer(BLURRED_OBJECTS_COSTMAP_LAYER_, size_of_expansion_kernel, objects_costmap);
 
   objects_costmap[OBJECTS_COSTMAP_LAYER_] =
       objects_costmap[OBJECTS_COSTMAP_LAYER_].cwiseMax(objects_costmap[BLURRED_OBJECTS_COSTMAP_LAYER_]);
 
   return objects_costmap[OBJECTS_COSTMAP_LAYER_];
 }
+
+void ObjectsToCostmap::blurCostInLayer(const std::string& gridmap_layer_name, const double size_of_expansion_kernel,
+                                       grid_map::GridMap& objects_costmap)
+{
+  const int window_size = static_cast<int>(size_of_expansion_kernel);
+  if (window_size % 2 == 0)
+  {
+    throw std::invalid_argument("ObjectsToCostmap: size_of_expansion_kernel must be odd!");
+  }
+  const int window_margin = (window_size - 1) / 2;
+
+  grid_map::Matrix& layer = objects_costmap[gridmap_layer_name];
+  const int rows = layer.rows();
+  const int cols = layer.cols();
+
+  // The cells are blurred in the order of the iterator, with the row index increasing first. The window of a cell
+  // has blurred costs in the previous columns and above it in its column, and costs not blurred yet elsewhere.
+  if (window_size <= MAX_SUMMED_WINDOW_SIZE_)
+  {
+    for (int col = 0; col < cols; col++)
+    {
+      for (int row = 0; row < rows; row++)
+      {
+        double sum = 0;
+        int finite_count = 0;
+        for (int window_col = std::max(0, col - window_margin); window_col <= std::min(cols - 1, col + window_margin);
+             window_col++)
+        {
+          for (int window_row = std::max(0, row - window_margin);
+               window_row <= std::min(rows - 1, row + window_margin); window_row++)
+          {
+            const float cost = layer(window_row, window_col);
+            if (std::isfinite(cost))
+            {
+              sum += cost;
+              finite_count++;
+            }
+          }
+        }
+        layer(row, col) = finite_count > 0 ? sum / finite_count : std::numeric_limits<float>::quiet_NaN();
+      }
+    }
+    return;
+  }
+
+  const int table_rows = rows + 1;
+  const CostSums zero_sums = { 0, 0, 0, 0 };
+  original_sums_.assign(static_cast<size_t>(table_rows) * (cols + 1), zero_sums);
+  blurred_sums_.assign(static_cast<size_t>(table_rows) * (cols + 1), zero_sums);
+
+  // entry (row, col) of a table sums the cells above and on the left of cell (row, col)
+  const auto add_cost = [table_rows](std::vector<CostSums>& table, const int row, const int col, const float cost) {
+    CostSums& sums = table[static_cast<size_t>(col + 1) * table_rows + row + 1];
+    const CostSums& up = table[static_cast<size_t>(col + 1) * table_rows + row];
+    const CostSums& left = table[static_cast<size_t>(col) * table_rows + row + 1];
+    const CostSums& up_left = table[static_cast<size_t>(col) * table_rows + row];
+    const bool is_finite = std::isfinite(cost);
+    sums.sum = up.sum + left.sum - up_left.sum + (is_finite ? cost : 0);
+    sums.finite_count = up.finite_count + left.finite_count - up_left.finite_count + is_finite;
+    sums.positive_count = up.positive_count + left.positive_count - up_left.positive_count + (is_finite && cost > 0);
+    sums.negative_count = up.negative_count + left.negative_count - up_left.negative_count + (is_finite && cost < 0);
+  };
+  // adds the sums of the cells from (min_row, min_col) to (max_row, max_col) to window_sums
+  const auto add_rectangle = [table_rows](const std::vector<CostSums>& table, const int min_row, const int max_row,
+                                          const int min_col, const int max_col, CostSums& window_sums) {
+    if (min_row > max_row || min_col > max_col)
+    {
+      return;
+    }
+    const CostSums& bottom_right = table[static_cast<size_t>(max_col + 1) * table_rows + max_row + 1];
+    const CostSums& top_right = table[static_cast<size_t>(max_col + 1) * table_rows + min_row];
+    const CostSums& bottom_left = table[static_cast<size_t>(min_col) * table_rows + max_row + 1];
+    const CostSums& top_left = table[static_cast<size_t>(min_col) * table_rows + min_row];
+    window_sums.sum += bottom_right.sum - top_right.sum - bottom_left.sum + top_left.sum;
+    window_sums.finite_count +=
+        bottom_right.finite_count - top_right.finite_count - bottom_left.finite_count + top_left.finite_count;
+    window_sums.positive_count +=
+        bottom_right.positive_count - top_right.positive_count - bottom_left.positive_count + top_left.positive_count;
+    window_sums.negative_count +=
+        bottom_right.negative_count - top_right.negative_count - bottom_left.negative_count + top_left.negative_count;
+  };
+
+  for (int col = 0; col < cols; col++)
+  {
+    for (int row = 0; row < rows; row++)
+    {
+      add_cost(original_sums_, row, col, layer(row, col));
+    }
+  }
+
+  for (int col = 0; col < cols; col++)
+  {
+    const int min_col = std::max(0, col - window_margin);
+    const int max_col = std::min(cols - 1, col + window_margin);
+    for (int row = 0; row < rows; row++)
+    {
+      const int min_row = std::max(0, row - window_margin);
+      const int max_row = std::min(rows - 1, row + window_margin);
+      CostSums window_sums = zero_sums;
+      add_rectangle(blurred_sums_, min_row, max_row, min_col, col - 1, window_sums);
+      add_rectangle(blurred_sums_, min_row, row - 1, col, col, window_sums);
+      add_rectangle(original_sums_, row, max_row, col, col, window_sums);
+      add_rectangle(original_sums_, min_row, max_row, col + 1, max_col, window_sums);
+
+      // The differences of the tables round the sum, so the mean is kept at the sign of the costs of the window,
+      // which also gives exactly 0 to windows of zero costs.
+      float blurred_cost = std::numeric_limits<float>::quiet_NaN();
+      if (window_sums.finite_count > 0)
+      {
+        double mean = window_sums.sum / window_sums.finite_count;
+        if (window_sums.negative_count == 0)
+        {
+          mean = std::max(0.0, mean);
+        }
+        if (window_sums.positive_count == 0)
+        {
+          mean = std::min(0.0, mean);
+        }
+        blurred_cost = mean;
+      }
+      layer(row, col) = blurred_cost;
+      add_cost(blurred_sums_, row, col, blurred_cost);
+    }
+  }
+}
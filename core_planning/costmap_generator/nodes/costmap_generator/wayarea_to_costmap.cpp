@@ -0,0 +1,181 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// headers in standard library
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// headers in local directory
+#include "costmap_generator/wayarea_to_costmap.h"
+
+// Constructor
+WayareaToCostmap::WayareaToCostmap()
+  : raster_resolution_(0), raster_min_x_(0), raster_min_y_(0), raster_cols_(0), raster_rows_(0)
+{
+}
+
+WayareaToCostmap::~WayareaToCostmap()
+{
+}
+
+void WayareaToCostmap::setAreaPoints(const std::vector<std::vector<geometry_msgs::Point>>& area_points)
+{
+  area_points_ = area_points;
+  raster_.clear();
+  raster_cols_ = 0;
+  raster_rows_ = 0;
+}
+
+bool WayareaToCostmap::hasAreaPoints() const
+{
+  return !area_points_.empty();
+}
+
+bool WayareaToCostmap::isCoveredByRaster(const double min_x, const double min_y, const double max_x,
+                                         const double max_y, const double resolution) const
+{
+  if (raster_.empty() || resolution != raster_resolution_)
+  {
+    return false;
+  }
+  return min_x >= raster_min_x_ && min_y >= raster_min_y_ && max_x <= raster_min_x_ + raster_cols_ * resolution &&
+         max_y <= raster_min_y_ + raster_rows_ * resolution;
+}
+
+void WayareaToCostmap::rasterizeAreas(const double min_x, const double min_y, const double max_x,
+                                      const double max_y, const double resolution)
+{
+  // window of the size of the bounding box on each of its sides, so that it is made again after the costmap
+  // moved by about its size
+  const double margin = std::max(max_x - min_x, max_y - min_y);
+  raster_resolution_ = resolution;
+  raster_min_x_ = std::floor((min_x - margin) / resolution) * resolution;
+  raster_min_y_ = std::floor((min_y - margin) / resolution) * resolution;
+  raster_cols_ = static_cast<int>(std::ceil((max_x + margin - raster_min_x_) / resolution));
+  raster_rows_ = static_cast<int>(std::ceil((max_y + margin - raster_min_y_) / resolution));
+  raster_.assign(static_cast<size_t>(raster_cols_) * raster_rows_, 0);
+
+  std::vector<double> crossings;
+  for (const auto& points : area_points_)
+  {
+    if (points.size() < 3)
+    {
+      continue;
+    }
+    double area_min_y = points[0].y;
+    double area_max_y = points[0].y;
+    double area_min_x = points[0].x;
+    double area_max_x = points[0].x;
+    for (const auto& point : points)
+    {
+      area_min_y = std::min(area_min_y, point.y);
+      area_max_y = std::max(area_max_y, point.y);
+      area_min_x = std::min(area_min_x, point.x);
+      area_max_x = std::max(area_max_x, point.x);
+    }
+    const int first_row = std::max(0, static_cast<int>(std::ceil((area_min_y - raster_min_y_) / resolution - 0.5)));
+    const int last_row =
+        std::min(raster_rows_ - 1, static_cast<int>(std::floor((area_max_y - raster_min_y_) / resolution - 0.5)));
+    if (first_row > last_row || area_max_x < raster_min_x_ || area_min_x > raster_min_x_ + raster_cols_ * resolution)
+    {
+      continue;
+    }
+
+    // scanline fill of the cell centers in the polygon, with the even-odd rule
+    for (int row = first_row; row <= last_row; row++)
+    {
+      const double y = raster_min_y_ + (row + 0.5) * resolution;
+      crossings.clear();
+      for (size_t i = 0, j = points.size() - 1; i < points.size(); j = i++)
+      {
+        if ((points[i].y <= y) != (points[j].y <= y))
+        {
+          crossings.push_back(points[i].x +
+                              (y - points[i].y) * (points[j].x - points[i].x) / (points[j].y - points[i].y));
+        }
+      }
+      std::sort(crossings.begin(), crossings.end());
+      for (size_t k = 0; k + 1 < crossings.size(); k += 2)
+      {
+        const int first_col =
+            std::max(0, static_cast<int>(std::ceil((crossings[k] - raster_min_x_) / resolution - 0.5)));
+        const int last_col = std::min(
+            raster_cols_ - 1, static_cast<int>(std::floor((crossings[k + 1] - raster_min_x_) / resolution - 0.5)));
+        if (first_col <= last_col)
+        {
+          std::fill(raster_.begin() + static_cast<size_t>(row) * raster_cols_ + first_col,
+                    raster_.begin() + static_cast<size_t>(row) * raster_cols_ + last_col + 1, 1);
+        }
+      }
+    }
+  }
+}
+
+void WayareaToCostmap::makeCostmapFromWayarea(const tf::Transform& costmap2map, const double grid_min_value,
+                                              const double grid_max_value, const std::string& gridmap_layer_name,
+                                              grid_map::GridMap& costmap)
+{
+  const double resolution = costmap.getResolution();
+  const grid_map::Size size = costmap.getSize();
+
+  // bounding box of the costmap in map frame
+  const grid_map::Position center = costmap.getPosition();
+  const grid_map::Length half_length = costmap.getLength() / 2.0;
+  double min_x = std::numeric_limits<double>::max();
+  double min_y = std::numeric_limits<double>::max();
+  double max_x = std::numeric_limits<double>::lowest();
+  double max_y = std::numeric_limits<double>::lowest();
+  for (const double sign_x : { -1.0, 1.0 })
+  {
+    for (const double sign_y : { -1.0, 1.0 })
+    {
+      const tf::Vector3 corner = costmap2map * tf::Vector3(center.x() + sign_x * half_length.x(),
+                                                          center.y() + sign_y * half_length.y(), 0);
+      min_x = std::min(min_x, corner.x());
+      min_y = std::min(min_y, corner.y());
+      max_x = std::max(max_x, corner.x());
+      max_y = std::max(max_y, corner.y());
+    }
+  }
+  if (!isCoveredByRaster(min_x, min_y, max_x, max_y, resolution))
+  {
+    rasterizeAreas(min_x, min_y, max_x, max_y, resolution);
+  }
+
+  // Cell (0, 0) is at the top left of the costmap, and the index increases towards -x and -y.
+  // The costmaps of costmap_generator are never moved, so the buffer starts at cell (0, 0).
+  grid_map::Position first_position;
+  costmap.getPosition(grid_map::Index(0, 0), first_position);
+  const tf::Vector3 origin = costmap2map * tf::Vector3(first_position.x(), first_position.y(), 0);
+  const tf::Vector3 step_x = costmap2map.getBasis() * tf::Vector3(-resolution, 0, 0);
+  const tf::Vector3 step_y = costmap2map.getBasis() * tf::Vector3(0, -resolution, 0);
+
+  grid_map::Matrix& layer = costmap[gridmap_layer_name];
+  for (int y_ind = 0; y_ind < size.y(); y_ind++)
+  {
+    for (int x_ind = 0; x_ind < size.x(); x_ind++)
+    {
+      const double map_x = origin.x() + x_ind * step_x.x() + y_ind * step_y.x();
+      const double map_y = origin.y() + x_ind * step_x.y() + y_ind * step_y.y();
+      const int col = static_cast<int>(std::floor((map_x - raster_min_x_) / resolution));
+      const int row = static_cast<int>(std::floor((map_y - raster_min_y_) / resolution));
+      const bool is_wayarea = col >= 0 && col < raster_cols_ && row >= 0 && row < raster_rows_ &&
+                              raster_[static_cast<size_t>(row) * raster_cols_ + col] != 0;
+      layer(x_ind, y_ind) = is_wayarea ? grid_min_value : grid_max_value;
+    }
+  }
+}
@@ -30,6 +30,7 @@
 
 #include <ros/ros.h>
 #include <gtest/gtest.h>
+#include <stdexcept>
 
 #include "costmap_generator/costmap_generator.h"
 #include "test_costmap_generator.hpp"
@@ -449,6 +450,115 @@ TEST_F(TestSuite, CheckMakeCostmapFromObjectsBoxBlur)
   EXPECT_NEAR(expected_score, gridmap_mat(7,6), buffer);
 }
 
+TEST_F(TestSuite, CheckBlurCostInLayer)
+{
+  grid_map::Matrix& dummy_mat = (*test_obj_.dummy_costmap_)[test_obj_.dummy_layer_name_];
+  dummy_mat(4, 4) = 1;
+  dummy_mat(4, 5) = 0.5;
+  dummy_mat(7, 2) = 0.8;
+  dummy_mat(6, 6) = NAN;
+
+  // 3 is summed cell by cell, the larger kernels use the summed-area tables, and 21 is wider than the 10 x 10 cells
+  // of the map so that every window is clipped by its edges
+  for (const double size_of_expansion_kernel : { 3, 5, 9, 21 })
+  {
+    grid_map::GridMap expected_costmap = *test_obj_.dummy_costmap_;
+    for (grid_map::SlidingWindowIterator iterator(expected_costmap, test_obj_.dummy_layer_name_,
+                                                  grid_map::SlidingWindowIterator::EdgeHandling::CROP,
+                                                  size_of_expansion_kernel);
+         !iterator.isPastEnd(); ++iterator)
+    {
+      expected_costmap.at(test_obj_.dummy_layer_name_, *iterator) = iterator.getData().meanOfFinites();
+    }
+
+    grid_map::GridMap blurred_costmap = *test_obj_.dummy_costmap_;
+    test_obj_.objects2costmap_->blurCostInLayer(test_obj_.dummy_layer_name_, size_of_expansion_kernel,
+                                                blurred_costmap);
+    const grid_map::Matrix& expected_mat = expected_costmap[test_obj_.dummy_layer_name_];
+    const grid_map::Matrix& blurred_mat = blurred_costmap[test_obj_.dummy_layer_name_];
+    double buffer = 0.00001;
+    for (int row = 0; row < expected_mat.rows(); row++)
+    {
+      for (int col = 0; col < expected_mat.cols(); col++)
+      {
+        EXPECT_NEAR(expected_mat(row, col), blurred_mat(row, col), buffer);
+      }
+    }
+    if (size_of_expansion_kernel <= 5)
+    {
+      EXPECT_EQ(0, blurred_mat(0, 0));
+    }
+  }
+
+  grid_map::GridMap blurred_costmap = *test_obj_.dummy_costmap_;
+  EXPECT_THROW(test_obj_.objects2costmap_->blurCostInLayer(test_obj_.dummy_layer_name_, 4, blurred_costmap),
+               std::invalid_argument);
+}
+
+TEST_F(TestSuite, CheckMakeCostmapFromWayarea)
+{
+  std::vector<geometry_msgs::Point> area;
+  geometry_msgs::Point point;
+  point.x = -2;
+  point.y = -2;
+  area.push_back(point);
+  point.x = 2;
+  point.y = -2;
+  area.push_back(point);
+  point.x = 2;
+  point.y = 2;
+  area.push_back(point);
+  point.x = -2;
+  point.y = 2;
+  area.push_back(point);
+  WayareaToCostmap wayarea2costmap;
+  wayarea2costmap.setAreaPoints(std::vector<std::vector<geometry_msgs::Point>>(1, area));
+
+  float grid_min_value = 0;
+  float grid_max_value = 1;
+  tf::Transform costmap2map(tf::Quaternion(0, 0, 0, 1), tf::Vector3(0, 0, 0));
+  wayarea2costmap.makeCostmapFromWayarea(costmap2map, grid_min_value, grid_max_value,
+                                         test_obj_.dummy_layer_name_, *test_obj_.dummy_costmap_);
+  grid_map::Matrix gridmap_mat = (*test_obj_.dummy_costmap_)[test_obj_.dummy_layer_name_];
+  EXPECT_EQ(grid_min_value, gridmap_mat(5, 5));
+  EXPECT_EQ(grid_max_value, gridmap_mat(0, 0));
+}
+
+TEST_F(TestSuite, CheckMakeCostmapFromWayareaMovedCostmap)
+{
+  std::vector<geometry_msgs::Point> area;
+  geometry_msgs::Point point;
+  point.x = -2;
+  point.y = -2;
+  area.push_back(point);
+  point.x = 2;
+  point.y = -2;
+  area.push_back(point);
+  point.x = 2;
+  point.y = 2;
+  area.push_back(point);
+  point.x = -2;
+  point.y = 2;
+  area.push_back(point);
+  WayareaToCostmap wayarea2costmap;
+  wayarea2costmap.setAreaPoints(std::vector<std::vector<geometry_msgs::Point>>(1, area));
+
+  float grid_min_value = 0;
+  float grid_max_value = 1;
+  tf::Transform costmap2map(tf::Quaternion(0, 0, 0, 1), tf::Vector3(0, 0, 0));
+  wayarea2costmap.makeCostmapFromWayarea(costmap2map, grid_min_value, grid_max_value,
+                                         test_obj_.dummy_layer_name_, *test_obj_.dummy_costmap_);
+
+  // the wayarea is at (-3, 0) in the costmap once it moved by 3 m along x
+  costmap2map.setOrigin(tf::Vector3(3, 0, 0));
+  wayarea2costmap.makeCostmapFromWayarea(costmap2map, grid_min_value, grid_max_value,
+                                         test_obj_.dummy_layer_name_, *test_obj_.dummy_costmap_);
+  grid_map::Matrix gridmap_mat = (*test_obj_.dummy_costmap_)[test_obj_.dummy_layer_name_];
+  EXPECT_EQ(grid_max_value, gridmap_mat(5, 5));
+  EXPECT_EQ(grid_min_value,
+    test_obj_.dummy_costmap_->atPosition(test_obj_.dummy_layer_name_, grid_map::Position(-2.5, 0.5)));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
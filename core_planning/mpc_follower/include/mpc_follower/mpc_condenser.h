@@ -0,0 +1,145 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file mpc_condenser.h
+ * @brief condensing of the MPC problem into a QP on the input sequence
+ */
+
+#pragma once
+#include <eigen3/Eigen/Core>
+
+/**
+ * @class MPC condenser
+ * @brief calculate QP matrix H and f from the discrete model and weight of each prediction step
+ *
+ * The QP is the same as the one of the stacked matrix,
+ *   predict equation: Xex = Aex * x0 + Bex * Uex + Wex
+ *   cost function: J = Xex' * Cex' * Qex * Cex * Xex + (Uex - Urefex)' * Rex * (Uex - Urefex)
+ *   H = (Cex * Bex)' * Qex * (Cex * Bex) + Rex, f = (Cex * (Aex * x0 + Wex))' * Qex * Cex * Bex - Urefex' * Rex
+ * but the block-lower-triangular Bex is never made: H and f are calculated by a Riccati-like backward recursion
+ * on the prediction steps, in O(N^2) instead of O(N^3), and all the matrices are allocated only when the size changes.
+ */
+class MPCCondenser
+{
+public:
+  /**
+   * @brief constructor
+   */
+  MPCCondenser();
+
+  /**
+   * @brief destructor
+   */
+  ~MPCCondenser();
+
+  /**
+   * @brief set problem size, and clear the weight of input difference
+   * @param [in] dim_x dimension of state x
+   * @param [in] dim_u dimension of input u
+   * @param [in] dim_y dimension of output y
+   * @param [in] horizon prediction horizon step N
+   */
+  void resize(const int dim_x, const int dim_u, const int dim_y, const int horizon);
+
+  /**
+   * @brief set model and weight of a prediction step : x_i = Ad * x_i-1 + Bd * u_i + Wd, y_i = Cd * x_i
+   * @param [in] i prediction step
+   * @param [in] Ad coefficient matrix of state
+   * @param [in] Bd coefficient matrix of input
+   * @param [in] Cd coefficient matrix of output
+   * @param [in] Wd offset
+   * @param [in] Q weight for output
+   * @param [in] R weight for input
+   * @param [in] Uref reference input
+   */
+  void setStep(const int i, const Eigen::MatrixXd &Ad, const Eigen::MatrixXd &Bd, const Eigen::MatrixXd &Cd,
+               const Eigen::MatrixXd &Wd, const Eigen::MatrixXd &Q, const Eigen::MatrixXd &R,
+               const Eigen::MatrixXd &Uref);
+
+  /**
+   * @brief add weight for the difference {u_i+1(0) - u_i(0)}^2 of the first input between two steps
+   * @param [in] i prediction step
+   * @param [in] weight weight of the difference
+   */
+  void addInputDifferenceWeight(const int i, const double &weight);
+
+  /**
+   * @brief check if the model of any prediction step includes NaN
+   * @return true if Ad, Bd, Cd or Wd includes NaN
+   */
+  bool hasNaN() const;
+
+  /**
+   * @brief calculate QP matrix of cost function 1/2 * Uex' * H * Uex + f' * Uex
+   * @param [in] x0 initial state
+   */
+  void calculateQPMatrix(const Eigen::VectorXd &x0);
+
+  /**
+   * @brief get H calculated by calculateQPMatrix()
+   * @return symmetric matrix of size (dim_u * N, dim_u * N)
+   */
+  const Eigen::MatrixXd &getH() const { return H_; }
+
+  /**
+   * @brief get f calculated by calculateQPMatrix()
+   * @return column vector of size (dim_u * N, 1)
+   */
+  const Eigen::MatrixXd &getF() const { return f_; }
+
+  /**
+   * @brief get reference input of all the prediction steps
+   * @return column vector Urefex of size (dim_u * N, 1)
+   */
+  const Eigen::MatrixXd &getReferenceInput() const { return Urefex_; }
+
+  /**
+   * @brief calculate predicted state Xex = Aex * x0 + Bex * Uex + Wex
+   * @param [in] x0 initial state
+   * @param [in] Uex input of all the prediction steps
+   * @param [out] Xex state of all the prediction steps
+   */
+  void predictState(const Eigen::VectorXd &x0, const Eigen::VectorXd &Uex, Eigen::VectorXd &Xex) const;
+
+private:
+  int dim_x_;   //!< @brief dimension of state x
+  int dim_u_;   //!< @brief dimension of input u
+  int dim_y_;   //!< @brief dimension of output y
+  int horizon_; //!< @brief prediction horizon step N
+
+  /* model and weight of each step, side by side */
+  Eigen::MatrixXd A_;      //!< @brief Ad of each step, size (dim_x, dim_x * N)
+  Eigen::MatrixXd B_;      //!< @brief Bd of each step, size (dim_x, dim_u * N)
+  Eigen::MatrixXd C_;      //!< @brief Cd of each step, size (dim_y, dim_x * N)
+  Eigen::MatrixXd W_;      //!< @brief Wd of each step, size (dim_x, N)
+  Eigen::MatrixXd CQC_;    //!< @brief Cd' * Q * Cd of each step, size (dim_x, dim_x * N)
+  Eigen::MatrixXd R_;      //!< @brief R of each step, size (dim_u, dim_u * N)
+  Eigen::MatrixXd Urefex_; //!< @brief reference input of each step, size (dim_u * N, 1)
+  Eigen::VectorXd input_difference_weight_; //!< @brief weight of {u_i+1(0) - u_i(0)}^2, size (N - 1)
+
+  /* workspace */
+  Eigen::MatrixXd H_;      //!< @brief QP matrix H
+  Eigen::MatrixXd f_;      //!< @brief QP vector f
+  Eigen::MatrixXd S_;      //!< @brief backward recursion for H, size (dim_x, dim_x)
+  Eigen::MatrixXd S_next_; //!< @brief backward recursion for H, size (dim_x, dim_x)
+  Eigen::MatrixXd SA_;     //!< @brief S * Ad, size (dim_x, dim_x)
+  Eigen::MatrixXd T_;      //!< @brief a row of blocks of H before multiplying Bd, size (dim_u, dim_x)
+  Eigen::MatrixXd T_next_; //!< @brief a row of blocks of H before multiplying Bd, size (dim_u, dim_x)
+  Eigen::MatrixXd Xfree_;  //!< @brief state of each step for zero input, size (dim_x, N)
+  Eigen::VectorXd g_;      //!< @brief backward recursion for f, size (dim_x)
+  Eigen::VectorXd g_next_; //!< @brief backward recursion for f, size (dim_x)
+};
@@ -47,6 +47,7 @@
 #include <autoware_msgs/VehicleStatus.h>
 
 #include "mpc_follower/mpc_utils.h"
+#include "mpc_follower/mpc_condenser.h"
 #include "mpc_follower/mpc_trajectory.h"
 #include "mpc_follower/lowpass_filter.h"
 #include "mpc_follower/vehicle_model/vehicle_model_bicycle_kinematics.h"
@@ -91,6 +92,7 @@ private:
   std::shared_ptr<VehicleModelInterface> vehicle_model_ptr_; //!< @brief vehicle model for MPC
   std::string vehicle_model_type_;                           //!< @brief vehicle model type for MPC
   std::shared_ptr<QPSolverInterface> qpsolver_ptr_;          //!< @brief qp solver for MPC
+  MPCCondenser mpc_condenser_;                               //!< @brief QP matrix of MPC, kept over control periods
   std::string output_interface_;                             //!< @brief output command type
   std::deque<double> input_buffer_;                          //!< @brief control input (mpc_output) buffer for delay time conpemsation
 
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2019 Autoware Foundation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "mpc_follower/mpc_condenser.h"
+
+MPCCondenser::MPCCondenser() : dim_x_(0), dim_u_(0), dim_y_(0), horizon_(0){};
+
+MPCCondenser::~MPCCondenser(){};
+
+void MPCCondenser::resize(const int dim_x, const int dim_u, const int dim_y, const int horizon)
+{
+  dim_x_ = dim_x;
+  dim_u_ = dim_u;
+  dim_y_ = dim_y;
+  horizon_ = horizon;
+
+  /* Eigen does not reallocate when the size is the same */
+  A_.resize(dim_x, dim_x * horizon);
+  B_.resize(dim_x, dim_u * horizon);
+  C_.resize(dim_y, dim_x * horizon);
+  W_.resize(dim_x, horizon);
+  CQC_.resize(dim_x, dim_x * horizon);
+  R_.resize(dim_u, dim_u * horizon);
+  Urefex_.resize(dim_u * horizon, 1);
+  input_difference_weight_.setZero(std::max(horizon - 1, 0));
+
+  H_.resize(dim_u * horizon, dim_u * horizon);
+  f_.resize(dim_u * horizon, 1);
+  S_.resize(dim_x, dim_x);
+  S_next_.resize(dim_x, dim_x);
+  SA_.resize(dim_x, dim_x);
+  T_.resize(dim_u, dim_x);
+  T_next_.resize(dim_u, dim_x);
+  Xfree_.resize(dim_x, horizon);
+  g_.resize(dim_x);
+  g_next_.resize(dim_x);
+};
+
+void MPCCondenser::setStep(const int i, const Eigen::MatrixXd &Ad, const Eigen::MatrixXd &Bd,
+                           const Eigen::MatrixXd &Cd, const Eigen::MatrixXd &Wd, const Eigen::MatrixXd &Q,
+                           const Eigen::MatrixXd &R, const Eigen::MatrixXd &Uref)
+{
+  A_.block(0, i * dim_x_, dim_x_, dim_x_) = Ad;
+  B_.block(0, i * dim_u_, dim_x_, dim_u_) = Bd;
+  C_.block(0, i * dim_x_, dim_y_, dim_x_) = Cd;
+  W_.col(i) = Wd.col(0);
+  CQC_.block(0, i * dim_x_, dim_x_, dim_x_).noalias() = Cd.transpose() * Q * Cd;
+  R_.block(0, i * dim_u_, dim_u_, dim_u_) = R;
+  Urefex_.block(i * dim_u_, 0, dim_u_, 1) = Uref;
+};
+
+void MPCCondenser::addInputDifferenceWeight(const int i, const double &weight)
+{
+  input_difference_weight_(i) += weight;
+};
+
+bool MPCCondenser::hasNaN() const
+{
+  return A_.array().isNaN().any() || B_.array().isNaN().any() || C_.array().isNaN().any() ||
+         W_.array().isNaN().any();
+};
+
+void MPCCondenser::calculateQPMatrix(const Eigen::VectorXd &x0)
+{
+  const int N = horizon_;
+  const int DIM_X = dim_x_;
+  const int DIM_U = dim_u_;
+
+  /*
+   * Bex(i, k) = Ad_i * ... * Ad_k+1 * Bd_k for i >= k, and with P_i = Cd_i' * Q_i * Cd_i,
+   *   H(j, k) = sum_{i >= j} Bex(i, j)' * P_i * Bex(i, k) = Bd_j' * S_j * Ad_j * ... * Ad_k+1 * Bd_k  (j >= k)
+   *   S_j = P_j + Ad_j+1' * S_j+1 * Ad_j+1  (Riccati-like backward recursion, S_N-1 = P_N-1)
+   * so each row of blocks of H is made by multiplying T = Bd_j' * S_j by Ad from the right, towards k = 0.
+   */
+  for (int j = N - 1; j >= 0; --j)
+  {
+    const int idx_x_j = j * DIM_X;
+    const int idx_u_j = j * DIM_U;
+    if (j == N - 1)
+    {
+      S_ = CQC_.block(0, idx_x_j, DIM_X, DIM_X);
+    }
+    else
+    {
+      SA_.noalias() = S_ * A_.block(0, idx_x_j + DIM_X, DIM_X, DIM_X);
+      S_next_ = CQC_.block(0, idx_x_j, DIM_X, DIM_X);
+      S_next_.noalias() += A_.block(0, idx_x_j + DIM_X, DIM_X, DIM_X).transpose() * SA_;
+      S_.swap(S_next_);
+    }
+
+    T_.noalias() = B_.block(0, idx_u_j, DIM_X, DIM_U).transpose() * S_;
+    H_.block(idx_u_j, idx_u_j, DIM_U, DIM_U).noalias() = T_ * B_.block(0, idx_u_j, DIM_X, DIM_U);
+    for (int k = j - 1; k >= 0; --k)
+    {
+      const int idx_u_k = k * DIM_U;
+      T_next_.noalias() = T_ * A_.block(0, (k + 1) * DIM_X, DIM_X, DIM_X);
+      T_.swap(T_next_);
+      H_.block(idx_u_j, idx_u_k, DIM_U, DIM_U).noalias() = T_ * B_.block(0, idx_u_k, DIM_X, DIM_U);
+      H_.block(idx_u_k, idx_u_j, DIM_U, DIM_U) = H_.block(idx_u_j, idx_u_k, DIM_U, DIM_U).transpose();
+    }
+  }
+
+  /*
+   * with the state for zero input Xfree_i = Aex_i * x0 + Wex_i, f is made by a backward recursion too,
+   *   f_k = Bd_k' * g_k, g_k = P_k * Xfree_k + Ad_k+1' * g_k+1
+   */
+  Xfree_.col(0).noalias() = A_.block(0, 0, DIM_X, DIM_X) * x0;
+  Xfree_.col(0) += W_.col(0);
+  for (int i = 1; i < N; ++i)
+  {
+    Xfree_.col(i).noalias() = A_.block(0, i * DIM_X, DIM_X, DIM_X) * Xfree_.col(i - 1);
+    Xfree_.col(i) += W_.col(i);
+  }
+  g_.noalias() = CQC_.block(0, (N - 1) * DIM_X, DIM_X, DIM_X) * Xfree_.col(N - 1);
+  f_.block((N - 1) * DIM_U, 0, DIM_U, 1).noalias() = B_.block(0, (N - 1) * DIM_U, DIM_X, DIM_U).transpose() * g_;
+  for (int k = N - 2; k >= 0; --k)
+  {
+    g_next_.noalias() = CQC_.block(0, k * DIM_X, DIM_X, DIM_X) * Xfree_.col(k);
+    g_next_.noalias() += A_.block(0, (k + 1) * DIM_X, DIM_X, DIM_X).transpose() * g_;
+    g_.swap(g_next_);
+    f_.block(k * DIM_U, 0, DIM_U, 1).noalias() = B_.block(0, k * DIM_U, DIM_X, DIM_U).transpose() * g_;
+  }
+
+  /* input weight : block diagonal Rex, and input difference on the first input of neighboring steps */
+  for (int i = 0; i < N; ++i)
+  {
+    const int idx_u_i = i * DIM_U;
+    H_.block(idx_u_i, idx_u_i, DIM_U, DIM_U) += R_.block(0, idx_u_i, DIM_U, DIM_U);
+    f_.block(idx_u_i, 0, DIM_U, 1).noalias() -= R_.block(0, idx_u_i, DIM_U, DIM_U) * Urefex_.block(idx_u_i, 0, DIM_U, 1);
+  }
+  for (int i = 0; i < N - 1; ++i)
+  {
+    const int idx_curr = i * DIM_U;
+    const int idx_next = (i + 1) * DIM_U;
+    const double weight = input_difference_weight_(i);
+    H_(idx_curr, idx_curr) += weight;
+    H_(idx_next, idx_curr) -= weight;
+    H_(idx_curr, idx_next) -= weight;
+    H_(idx_next, idx_next) += weight;
+    f_(idx_curr, 0) -= weight * (Urefex_(idx_curr, 0) - Urefex_(idx_next, 0));
+    f_(idx_next, 0) -= weight * (Urefex_(idx_next, 0) - Urefex_(idx_curr, 0));
+  }
+};
+
+void MPCCondenser::predictState(const Eigen::VectorXd &x0, const Eigen::VectorXd &Uex, Eigen::VectorXd &Xex) const
+{
+  Xex.resize(dim_x_ * horizon_);
+  Eigen::VectorXd x = x0;
+  for (int i = 0; i < horizon_; ++i)
+  {
+    Xex.segment(i * dim_x_, dim_x_) = A_.block(0, i * dim_x_, dim_x_, dim_x_) * x +
+                                      B_.block(0, i * dim_u_, dim_x_, dim_u_) * Uex.segment(i * dim_u_, dim_u_) +
+                                      W_.col(i);
+    x = Xex.segment(i * dim_x_, dim_x_);
+  }
+};
@@ -314,15 +314,9 @@ bool MPCFollower::calculateMPC(double &vel_cmd, double &acc_cmd, double &steer_c
    * predict equation: Xec = Aex * x0 + Bex * Uex + Wex
    * cost function: J = Xex' * Qex * Xex + (Uex - Uref)' * Rex * (Uex - Urefex)
    * Qex = diag([Q,Q,...]), Rex = diag([R,R,...])
+   * only the model and weight of each step are set here, the QP is condensed by mpc_condenser_.
    */
-
-  Eigen::MatrixXd Aex = Eigen::MatrixXd::Zero(DIM_X * N, DIM_X);
-  Eigen::MatrixXd Bex = Eigen::MatrixXd::Zero(DIM_X * N, DIM_U * N);
-  Eigen::MatrixXd Wex = Eigen::MatrixXd::Zero(DIM_X * N, 1);
-  Eigen::MatrixXd Cex = Eigen::MatrixXd::Zero(DIM_Y * N, DIM_X * N);
-  Eigen::MatrixXd Qex = Eigen::MatrixXd::Zero(DIM_Y * N, DIM_Y * N);
-  Eigen::MatrixXd Rex = Eigen::MatrixXd::Zero(DIM_U * N, DIM_U * N);
-  Eigen::MatrixXd Urefex = Eigen::MatrixXd::Zero(DIM_U * N, 1);
+  mpc_condenser_.resize(DIM_X, DIM_U, DIM_Y, N);
 
   /* weight matrix depends on the vehicle model */
   Eigen::MatrixXd Q = Eigen::MatrixXd::Zero(DIM_Y, DIM_Y);
@@ -368,32 +362,6 @@ bool MPCFollower::calculateMPC(double &vel_cmd, double &acc_cmd, double &steer_c
     Q_adaptive(1, 1) += ref_vx_squared * mpc_param_.weight_heading_error_squared_vel_coeff;
     R_adaptive(0, 0) += ref_vx_squared * mpc_param_.weight_steering_input_squared_vel_coeff;
 
-    /* update mpc matrix */
-    int idx_x_i = i * DIM_X;
-    int idx_x_i_prev = (i - 1) * DIM_X;
-    int idx_u_i = i * DIM_U;
-    int idx_y_i = i * DIM_Y;
-    if (i == 0)
-    {
-      Aex.block(0, 0, DIM_X, DIM_X) = Ad;
-      Bex.block(0, 0, DIM_X, DIM_U) = Bd;
-      Wex.block(0, 0, DIM_X, 1) = Wd;
-    }
-    else
-    {
-      Aex.block(idx_x_i, 0, DIM_X, DIM_X) = Ad * Aex.block(idx_x_i_prev, 0, DIM_X, DIM_X);
-      for (int j = 0; j < i; ++j)
-      {
-        int idx_u_j = j * DIM_U;
-        Bex.block(idx_x_i, idx_u_j, DIM_X, DIM_U) = Ad * Bex.block(idx_x_i_prev, idx_u_j, DIM_X, DIM_U);
-      }
-      Wex.block(idx_x_i, 0, DIM_X, 1) = Ad * Wex.block(idx_x_i_prev, 0, DIM_X, 1) + Wd;
-    }
-    Bex.block(idx_x_i, idx_u_i, DIM_X, DIM_U) = Bd;
-    Cex.block(idx_y_i, idx_x_i, DIM_Y, DIM_X) = Cd;
-    Qex.block(idx_y_i, idx_y_i, DIM_Y, DIM_Y) = Q_adaptive;
-    Rex.block(idx_u_i, idx_u_i, DIM_U, DIM_U) = R_adaptive;
-
     /* get reference input (feed-forward) */
     vehicle_model_ptr_->calculateReferenceInput(Uref);
     if (std::fabs(Uref(0, 0)) < amathutils::deg2rad(mpc_param_.zero_ff_steer_deg))
@@ -401,7 +369,8 @@ bool MPCFollower::calculateMPC(double &vel_cmd, double &acc_cmd, double &steer_c
       Uref(0, 0) = 0.0; // ignore curvature noise
     }
 
-    Urefex.block(i * DIM_U, 0, DIM_U, 1) = Uref;
+    /* update mpc matrix */
+    mpc_condenser_.setStep(i, Ad, Bd, Cd, Wd, Q_adaptive, R_adaptive, Uref);
 
     mpc_curr_time += DT;
   }
@@ -411,14 +380,10 @@ bool MPCFollower::calculateMPC(double &vel_cmd, double &acc_cmd, double &steer_c
   {
     const double v = mpc_resampled_ref_traj.vx[i];
     const double lateral_jerk_weight = v * v * mpc_param_.weight_lat_jerk;
-    Rex(i, i) += lateral_jerk_weight;
-    Rex(i + 1, i) -= lateral_jerk_weight;
-    Rex(i, i + 1) -= lateral_jerk_weight;
-    Rex(i + 1, i + 1) += lateral_jerk_weight;
+    mpc_condenser_.addInputDifferenceWeight(i, lateral_jerk_weight);
   }
 
-  if (Aex.array().isNaN().any() || Bex.array().isNaN().any() ||
-      Cex.array().isNaN().any() || Wex.array().isNaN().any())
+  if (mpc_condenser_.hasNaN())
   {
     ROS_WARN("[MPC] calculateMPC: model matrix includes NaN, stop MPC.");
     return false;
@@ -429,13 +394,9 @@ bool MPCFollower::calculateMPC(double &vel_cmd, double &acc_cmd, double &steer_c
    * solve quadratic optimization.
    * cost function: 1/2 * Uex' * H * Uex + f' * Uex
    */
-  const Eigen::MatrixXd CB = Cex * Bex;
-  const Eigen::MatrixXd QCB = Qex * CB;
-  Eigen::MatrixXd H = Eigen::MatrixXd::Zero(DIM_U * N, DIM_U * N);
-  H.triangularView<Eigen::Upper>() = CB.transpose() * QCB; // NOTE: This calculation is very heavy. searching for a good way...
-  H.triangularView<Eigen::Upper>() += Rex;
-  H.triangularView<Eigen::Lower>() = H.transpose();
-  Eigen::MatrixXd f = (Cex * (Aex * x0 + Wex)).transpose() * QCB - Urefex.transpose() * Rex;
+  mpc_condenser_.calculateQPMatrix(x0);
+  const Eigen::MatrixXd &H = mpc_condenser_.getH();
+  const Eigen::MatrixXd &f = mpc_condenser_.getF();
 
   /* constraint matrix : lb < U < ub, lbA < A*U < ubA */
   const double u_lim = amathutils::deg2rad(steer_lim_deg_);
@@ -447,7 +408,7 @@ bool MPCFollower::calculateMPC(double &vel_cmd, double &acc_cmd, double &steer_c
 
   auto start = std::chrono::system_clock::now();
   Eigen::VectorXd Uex;
-  if (!qpsolver_ptr_->solve(H, f.transpose(), A, lb, ub, lbA, ubA, Uex))
+  if (!qpsolver_ptr_->solve(H, f, A, lb, ub, lbA, ubA, Uex))
   {
     ROS_WARN("[MPC] qp solver error");
     return false;
@@ -487,7 +448,8 @@ bool MPCFollower::calculateMPC(double &vel_cmd, double &acc_cmd, double &steer_c
   ////////////////// DEBUG ///////////////////
 
   /* calculate predicted trajectory */
-  Eigen::VectorXd Xex = Aex * x0 + Bex * Uex + Wex;
+  Eigen::VectorXd Xex;
+  mpc_condenser_.predictState(x0, Uex, Xex);
   MPCTrajectory debug_mpc_predicted_traj;
   for (int i = 0; i < N; ++i)
   {
@@ -513,7 +475,7 @@ bool MPCFollower::calculateMPC(double &vel_cmd, double &acc_cmd, double &steer_c
     std_msgs::Float64MultiArray debug_values;
     debug_values.data.push_back(steer_cmd);                                      // [0] final steering command (MPC + LPF)
     debug_values.data.push_back(u_sat);                                          // [1] mpc calculation result
-    debug_values.data.push_back(Urefex(0));                                      // [2] feedforward steering value
+    debug_values.data.push_back(mpc_condenser_.getReferenceInput()(0));          // [2] feedforward steering value
     debug_values.data.push_back(std::atan(nearest_k * wheelbase_));              // [3] feedforward steering value raw
     debug_values.data.push_back(steer);                                          // [4] current steering angle
     debug_values.data.push_back(err_lat);                                        // [5] lateral error
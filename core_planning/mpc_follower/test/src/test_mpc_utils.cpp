@@ -20,6 +20,8 @@
 #include <gtest/gtest.h>
 #include <amathutils_lib/amathutils.hpp>
 #include "mpc_follower/mpc_utils.h"
+#include "mpc_follower/mpc_condenser.h"
+#include "mpc_follower/vehicle_model/vehicle_model_bicycle_kinematics.h"
 
 class TestSuite: public ::testing::Test {
 public:
@@ -285,6 +287,100 @@ TEST(TestSuite, TestMPCTrajSize)
     ASSERT_EQ(0, traj.size()) << "invalid size, zero expected";
 }
 
+TEST(TestSuite, CondensedQPMatrix){
+
+    /* H and f of the stacked matrix, as calculated before MPCCondenser */
+    KinematicsBicycleModel model(2.9, amathutils::deg2rad(35.0), 0.3);
+    const int N = 30;
+    const int DIM_X = model.getDimX();
+    const int DIM_U = model.getDimU();
+    const int DIM_Y = model.getDimY();
+    const double DT = 0.1;
+
+    Eigen::MatrixXd Aex = Eigen::MatrixXd::Zero(DIM_X * N, DIM_X);
+    Eigen::MatrixXd Bex = Eigen::MatrixXd::Zero(DIM_X * N, DIM_U * N);
+    Eigen::MatrixXd Wex = Eigen::MatrixXd::Zero(DIM_X * N, 1);
+    Eigen::MatrixXd Cex = Eigen::MatrixXd::Zero(DIM_Y * N, DIM_X * N);
+    Eigen::MatrixXd Qex = Eigen::MatrixXd::Zero(DIM_Y * N, DIM_Y * N);
+    Eigen::MatrixXd Rex = Eigen::MatrixXd::Zero(DIM_U * N, DIM_U * N);
+    Eigen::MatrixXd Urefex = Eigen::MatrixXd::Zero(DIM_U * N, 1);
+    Eigen::MatrixXd Ad(DIM_X, DIM_X), Bd(DIM_X, DIM_U), Wd(DIM_X, 1), Cd(DIM_Y, DIM_X), Uref(DIM_U, 1);
+
+    MPCCondenser condenser;
+    condenser.resize(DIM_X, DIM_U, DIM_Y, N);
+    for (int i = 0; i < N; ++i) {
+        const double v = 3.0 + 0.2 * i;
+        model.setVelocity(v);
+        model.setCurvature(0.05 * std::sin(0.3 * i));
+        model.calculateDiscreteMatrix(Ad, Bd, Cd, Wd, DT);
+        model.calculateReferenceInput(Uref);
+        Eigen::MatrixXd Q = Eigen::MatrixXd::Zero(DIM_Y, DIM_Y);
+        Q(0, 0) = (i == N - 1) ? 10.0 : 1.0;
+        Q(1, 1) = 0.3 * v * v;
+        Eigen::MatrixXd R = Eigen::MatrixXd::Constant(DIM_U, DIM_U, 1.0 + 0.25 * v * v);
+
+        const int idx_x_i = i * DIM_X;
+        const int idx_u_i = i * DIM_U;
+        const int idx_y_i = i * DIM_Y;
+        if (i == 0) {
+            Aex.block(0, 0, DIM_X, DIM_X) = Ad;
+            Wex.block(0, 0, DIM_X, 1) = Wd;
+        } else {
+            Aex.block(idx_x_i, 0, DIM_X, DIM_X) = Ad * Aex.block(idx_x_i - DIM_X, 0, DIM_X, DIM_X);
+            for (int j = 0; j < i; ++j) {
+                Bex.block(idx_x_i, j * DIM_U, DIM_X, DIM_U) = Ad * Bex.block(idx_x_i - DIM_X, j * DIM_U, DIM_X, DIM_U);
+            }
+            Wex.block(idx_x_i, 0, DIM_X, 1) = Ad * Wex.block(idx_x_i - DIM_X, 0, DIM_X, 1) + Wd;
+        }
+        Bex.block(idx_x_i, idx_u_i, DIM_X, DIM_U) = Bd;
+        Cex.block(idx_y_i, idx_x_i, DIM_Y, DIM_X) = Cd;
+        Qex.block(idx_y_i, idx_y_i, DIM_Y, DIM_Y) = Q;
+        Rex.block(idx_u_i, idx_u_i, DIM_U, DIM_U) = R;
+        Urefex.block(idx_u_i, 0, DIM_U, 1) = Uref;
+        condenser.setStep(i, Ad, Bd, Cd, Wd, Q, R, Uref);
+    }
+    for (int i = 0; i < N - 1; ++i) {
+        const double lateral_jerk_weight = 0.1 * i;
+        Rex(i, i) += lateral_jerk_weight;
+        Rex(i + 1, i) -= lateral_jerk_weight;
+        Rex(i, i + 1) -= lateral_jerk_weight;
+        Rex(i + 1, i + 1) += lateral_jerk_weight;
+        condenser.addInputDifferenceWeight(i, lateral_jerk_weight);
+    }
+    ASSERT_FALSE(condenser.hasNaN());
+
+    Eigen::VectorXd x0(DIM_X);
+    x0 << 0.5, 0.1, -0.05;
+    const Eigen::MatrixXd CB = Cex * Bex;
+    const Eigen::MatrixXd QCB = Qex * CB;
+    const Eigen::MatrixXd H = CB.transpose() * QCB + Rex;
+    const Eigen::MatrixXd f = ((Cex * (Aex * x0 + Wex)).transpose() * QCB - Urefex.transpose() * Rex).transpose();
+
+    condenser.calculateQPMatrix(x0);
+    ASSERT_EQ(H.rows(), condenser.getH().rows());
+    ASSERT_EQ(H.cols(), condenser.getH().cols());
+    ASSERT_EQ(f.rows(), condenser.getF().rows());
+    const double tolerance = 1.0E-9;
+    ASSERT_LT((condenser.getH() - H).cwiseAbs().maxCoeff(), tolerance * H.cwiseAbs().maxCoeff()) << "H differs from the stacked matrix";
+    ASSERT_LT((condenser.getF() - f).cwiseAbs().maxCoeff(), tolerance * f.cwiseAbs().maxCoeff()) << "f differs from the stacked matrix";
+    ASSERT_TRUE(condenser.getH().isApprox(condenser.getH().transpose())) << "H is not symmetric";
+    ASSERT_DOUBLE_EQ(Urefex(0), condenser.getReferenceInput()(0));
+
+    Eigen::VectorXd Uex = Eigen::VectorXd::LinSpaced(DIM_U * N, -0.1, 0.1);
+    Eigen::VectorXd Xex;
+    condenser.predictState(x0, Uex, Xex);
+    const Eigen::VectorXd Xex_stacked = Aex * x0 + Bex * Uex + Wex;
+    ASSERT_LT((Xex - Xex_stacked).cwiseAbs().maxCoeff(), tolerance * Xex_stacked.cwiseAbs().maxCoeff());
+
+    /* same problem size, no reallocation and no remaining input difference weight */
+    condenser.resize(DIM_X, DIM_U, DIM_Y, N);
+    for (int i = 0; i < N - 1; ++i) {
+        condenser.addInputDifferenceWeight(i, 0.1 * i);
+    }
+    condenser.calculateQPMatrix(x0);
+    ASSERT_LT((condenser.getH() - H).cwiseAbs().maxCoeff(), tolerance * H.cwiseAbs().maxCoeff());
+}
+
 int main(int argc, char **argv) {
 	testing::InitGoogleTest(&argc, argv);
 	ros::init(argc, argv, "TestNode");
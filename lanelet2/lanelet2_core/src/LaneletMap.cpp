@@ -1,8 +1,12 @@
 #define LANELET_LAYER_DEFINITION
 #include "LaneletMap.h"
+#include <array>
 #include <atomic>
-#include <boost/geometry/index/rtree.hpp>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <queue>
 #include <random>
 #include "geometry/Area.h"
 #include "geometry/BoundingBox.h"
@@ -11,27 +15,6 @@
 #include "geometry/Polygon.h"
 #include "geometry/RegulatoryElement.h"
 
-// boost geometry stuff
-namespace bgi = boost::geometry::index;
-
-// we need this hack to cleanly remove things from the RTree
-// because remove() internally uses equals to find the correct element to
-// remove. However, this is not implemented for our primitives.
-namespace boost {
-namespace geometry {
-template <>
-bool equals<lanelet::LineString3d, lanelet::LineString3d>(const lanelet::LineString3d& geometry1,
-                                                          const lanelet::LineString3d& geometry2) {
-  return geometry1 == geometry2;
-}
-template <>
-bool equals<lanelet::Polygon3d, lanelet::Polygon3d>(const lanelet::Polygon3d& geometry1,
-                                                    const lanelet::Polygon3d& geometry2) {
-  return geometry1 == geometry2;
-}
-}  // namespace geometry
-}  // namespace boost
-
 // need id visitor before hash
 namespace lanelet {
 namespace {
@@ -164,30 +147,618 @@ std::vector<T> forEachMatchInMultiMap(const MapT& map, const KeyT& key, Func&& f
   return utils::transform(range.first, range.second, f);
 }
 
-template <typename RetT, typename TreeT, typename Func>
-Optional<RetT> findUntilImpl(TreeT&& tree, const BoundingBox2d& area, const Func& func) {
-  if (tree.empty()) {
-    return {};
+//! Bounding box in single precision relative to the origin of a SpatialIndex. It is rounded outwards and therefore
+//! contains the box it was created from.
+struct FloatBox {
+  float minX;
+  float minY;
+  float maxX;
+  float maxY;
+};
+
+constexpr float FloatInf = std::numeric_limits<float>::infinity();
+
+float roundDown(double value) {
+  auto rounded = static_cast<float>(value);
+  return double(rounded) > value ? std::nextafter(rounded, -FloatInf) : rounded;
+}
+
+float roundUp(double value) {
+  auto rounded = static_cast<float>(value);
+  return double(rounded) < value ? std::nextafter(rounded, FloatInf) : rounded;
+}
+
+FloatBox merge(const FloatBox& lhs, const FloatBox& rhs) {
+  return {std::min(lhs.minX, rhs.minX), std::min(lhs.minY, rhs.minY), std::max(lhs.maxX, rhs.maxX),
+          std::max(lhs.maxY, rhs.maxY)};
+}
+
+bool operator==(const FloatBox& lhs, const FloatBox& rhs) {
+  return lhs.minX == rhs.minX && lhs.minY == rhs.minY && lhs.maxX == rhs.maxX && lhs.maxY == rhs.maxY;
+}
+
+FloatBox toFloatBox(const BasicPoint2d& min, const BasicPoint2d& max) {
+  return {roundDown(min.x()), roundDown(min.y()), roundUp(max.x()), roundUp(max.y())};
+}
+
+bool intersects(const FloatBox& lhs, const FloatBox& rhs) {
+  return lhs.minX <= rhs.maxX && lhs.maxX >= rhs.minX && lhs.minY <= rhs.maxY && lhs.maxY >= rhs.minY;
+}
+
+//! The area rounded inwards, for certainlyIntersects
+FloatBox toInnerFloatBox(const BasicPoint2d& min, const BasicPoint2d& max) {
+  return {roundUp(min.x()), roundUp(min.y()), roundDown(max.x()), roundDown(max.y())};
+}
+
+// The original coordinates are less than one step of float precision inside of the float box. If the box still
+// intersects the inner area after moving its borders inwards by that step, the original box intersects for sure.
+bool certainlyIntersects(const FloatBox& box, const FloatBox& innerArea) {
+  return box.minX < innerArea.maxX && box.maxX > innerArea.minX && box.minY < innerArea.maxY &&
+         box.maxY > innerArea.minY;
+}
+
+double squaredDistance(double minX, double minY, double maxX, double maxY, const BasicPoint2d& point) {
+  double dx = std::max(minX - point.x(), 0.) + std::max(point.x() - maxX, 0.);
+  double dy = std::max(minY - point.y(), 0.) + std::max(point.y() - maxY, 0.);
+  return dx * dx + dy * dy;
+}
+
+//! Lower bound of the squared distance of the original box to a point
+double squaredDistance(const FloatBox& box, const BasicPoint2d& point) {
+  return squaredDistance(box.minX, box.minY, box.maxX, box.maxY, point);
+}
+
+//! Upper bound of the squared distance of the original box to a point
+double maxSquaredDistance(const FloatBox& box, const BasicPoint2d& point) {
+  return squaredDistance(std::nextafter(box.minX, FloatInf), std::nextafter(box.minY, FloatInf),
+                         std::nextafter(box.maxX, -FloatInf), std::nextafter(box.maxY, -FloatInf), point);
+}
+
+double squaredDistance(const BoundingBox2d& box, const BasicPoint2d& point) {
+  return squaredDistance(box.min().x(), box.min().y(), box.max().x(), box.max().y(), point);
+}
+
+/**
+ * @brief R-tree over slots and float boxes that is bulk loaded once. Afterwards, entries can only be erased.
+ *
+ * The entries are sorted so that each NodeSize consecutive entries (or nodes) form a node of the level above that is
+ * as compact as possible (sort-tile-recursive, top down). The levels are plain arrays of boxes, so there are no child
+ * pointers and no allocations per node.
+ */
+class PackedRTree {
+ public:
+  struct Entry {
+    FloatBox box;
+    std::uint32_t slot;  //!< Erased once the entry is erased
+  };
+  static constexpr size_t NodeSize = 16;
+  static constexpr std::uint32_t Erased = std::numeric_limits<std::uint32_t>::max();
+
+  explicit PackedRTree(std::vector<Entry> entries) : entries_{std::move(entries)} {
+    sortTiles();
+    size_t count = entries_.size();
+    while (count > 1) {
+      std::vector<FloatBox> level((count + NodeSize - 1) / NodeSize);
+      for (size_t i = 0; i < count; ++i) {
+        const auto& childBox = box(levels_.size(), i);
+        level[i / NodeSize] = i % NodeSize == 0 ? childBox : merge(level[i / NodeSize], childBox);
+      }
+      levels_.push_back(std::move(level));
+      count = levels_.back().size();
+    }
+  }
+
+  //! Numbers the entries in the order of the tree, so that entries that are close get adjacent slots. Returns the
+  //! previous slot of each entry.
+  std::vector<std::uint32_t> numberEntries() {
+    std::vector<std::uint32_t> previousSlots(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      previousSlots[i] = entries_[i].slot;
+      entries_[i].slot = std::uint32_t(i);
+    }
+    return previousSlots;
+  }
+
+  const std::vector<Entry>& entries() const noexcept { return entries_; }
+  size_t size() const noexcept { return entries_.size() - numErased_; }
+  size_t numErased() const noexcept { return numErased_; }
+  size_t rootLevel() const noexcept { return levels_.size(); }
+  size_t levelSize(size_t level) const { return level == 0 ? entries_.size() : levels_[level - 1].size(); }
+  //! Level 0 are the entries, the root is the only node on the highest level
+  const FloatBox& box(size_t level, size_t index) const {
+    return level == 0 ? entries_[index].box : levels_[level - 1][index];
+  }
+  //! Indices of the children of a node on the level below
+  std::pair<size_t, size_t> children(size_t level, size_t index) const {
+    return {index * NodeSize, std::min((index + 1) * NodeSize, levelSize(level - 1))};
+  }
+
+  //! Calls func for the entries whose box intersects the area until it returns true
+  template <typename Func>
+  bool search(const FloatBox& area, Func&& func) const {
+    return !entries_.empty() && searchNode(rootLevel(), 0, area, [&](size_t i) { return func(entries_[i]); });
+  }
+
+  //! Marks the entry with this box whose slot matches isSlot as erased. Returns its slot, or Erased if there is none.
+  template <typename Pred>
+  std::uint32_t erase(const FloatBox& entryBox, Pred&& isSlot) {
+    auto erased = Erased;
+    if (!entries_.empty()) {
+      searchNode(rootLevel(), 0, entryBox, [&](size_t i) {
+        if (!(entries_[i].box == entryBox) || !isSlot(entries_[i].slot)) {
+          return false;
+        }
+        erased = entries_[i].slot;
+        markErased(i);
+        return true;
+      });
+    }
+    return erased;
+  }
+
+  //! Like erase, but checks every entry regardless of its box
+  template <typename Pred>
+  std::uint32_t eraseAnywhere(Pred&& isSlot) {
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      if (entries_[i].slot != Erased && isSlot(entries_[i].slot)) {
+        auto erased = entries_[i].slot;
+        markErased(i);
+        return erased;
+      }
+    }
+    return Erased;
+  }
+
+ private:
+  template <typename Func>
+  bool searchNode(size_t level, size_t index, const FloatBox& area, Func&& func) const {
+    if (!intersects(box(level, index), area)) {
+      return false;
+    }
+    if (level == 0) {
+      return entries_[index].slot != Erased && func(index);
+    }
+    auto range = children(level, index);
+    if (level == 1) {
+      for (auto child = range.first; child < range.second; ++child) {
+        if (entries_[child].slot != Erased && intersects(entries_[child].box, area) && func(child)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    for (auto child = range.first; child < range.second; ++child) {
+      if (searchNode(level - 1, child, area, func)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void markErased(size_t index) {
+    entries_[index].slot = Erased;
+    ++numErased_;
+  }
+
+  void sortTiles() {
+    size_t subtreeSize = 1;
+    while (subtreeSize * NodeSize < entries_.size()) {
+      subtreeSize *= NodeSize;
+    }
+    sortTiles(entries_.begin(), entries_.end(), subtreeSize);
+  }
+
+  //! Splits the entries into slices along x and the slices into tiles of subtreeSize entries along y, recursively.
+  //! Only the membership of the slices and tiles matters, so they are selected with nth_element instead of sorted.
+  static void sortTiles(std::vector<Entry>::iterator begin, std::vector<Entry>::iterator end, size_t subtreeSize) {
+    if (subtreeSize == 1) {
+      return;
+    }
+    auto count = size_t(end - begin);
+    auto numTiles = (count + subtreeSize - 1) / subtreeSize;
+    auto numSlices = size_t(std::ceil(std::sqrt(double(numTiles))));
+    auto sliceSize = subtreeSize * ((numTiles + numSlices - 1) / numSlices);
+    partitionGroups(begin, end, sliceSize,
+                    [](auto& lhs, auto& rhs) { return lhs.box.minX + lhs.box.maxX < rhs.box.minX + rhs.box.maxX; });
+    for (auto slice = begin; slice < end; slice += std::min(sliceSize, size_t(end - slice))) {
+      auto sliceEnd = slice + std::min(sliceSize, size_t(end - slice));
+      partitionGroups(slice, sliceEnd, subtreeSize,
+                      [](auto& lhs, auto& rhs) { return lhs.box.minY + lhs.box.maxY < rhs.box.minY + rhs.box.maxY; });
+      for (auto tile = slice; tile < sliceEnd; tile += std::min(subtreeSize, size_t(sliceEnd - tile))) {
+        sortTiles(tile, tile + std::min(subtreeSize, size_t(sliceEnd - tile)), subtreeSize / NodeSize);
+      }
+    }
+  }
+
+  //! Reorders the entries so that no entry of a group of groupSize consecutive entries is greater than the entries of
+  //! the groups after it. The order within a group is unspecified.
+  template <typename Less>
+  static void partitionGroups(std::vector<Entry>::iterator begin, std::vector<Entry>::iterator end, size_t groupSize,
+                              const Less& less) {
+    while (size_t(end - begin) > groupSize) {
+      auto numGroups = (size_t(end - begin) + groupSize - 1) / groupSize;
+      auto middle = begin + groupSize * (numGroups / 2);
+      std::nth_element(begin, middle, end, less);
+      partitionGroups(begin, middle, groupSize, less);
+      begin = middle;
+    }
+  }
+
+  std::vector<Entry> entries_;
+  std::vector<std::vector<FloatBox>> levels_;  //!< boxes of the nodes, from the lowest level up to the root
+  size_t numErased_{0};
+};
+
+/**
+ * @brief Spatial index over the bounding boxes of primitives that supports insertion and erasing.
+ *
+ * The entries refer to the primitives by a slot, the index of the primitive in an array kept by the owner of the index,
+ * so that a hit costs no lookup by id.
+ *
+ * The boxes are stored in single precision relative to an origin that is fixed with the first box, so that they keep
+ * a precision of about a millimeter in maps with e.g. UTM coordinates. The index consists of packed R-trees of
+ * decreasing size. Inserted entries form a new tree, which is rebuilt together with all trees that are not larger than
+ * it (logarithmic method). Bulk loading therefore results in a single tree, while inserting one entry after another
+ * costs O(log^2 n) amortized.
+ */
+class SpatialIndex {
+ public:
+  using Entry = PackedRTree::Entry;
+
+  /**
+   * @brief Replaces the content of the index by a single tree.
+   *
+   * The entries are renumbered in the order of the tree so that the hits of a query are close to each other in the
+   * array of the owner. Returns the slot each entry was passed with, by its new slot.
+   */
+  std::vector<std::uint32_t> build(const std::vector<std::pair<BoundingBox2d, std::uint32_t>>& boxes) {
+    trees_.clear();
+    if (boxes.empty()) {
+      return {};
+    }
+    BoundingBox2d extent;
+    for (const auto& box : boxes) {
+      extent.extend(box.first);
+    }
+    origin_ = extent.center();
+    hasOrigin_ = true;
+    auto entries = utils::transform(boxes, [this](auto& box) { return toEntry(box.first, box.second); });
+    trees_.emplace_back(std::move(entries));
+    return trees_.back().numberEntries();
+  }
+
+  void insert(const BoundingBox2d& box, std::uint32_t slot) {
+    if (!hasOrigin_) {
+      origin_ = box.center();
+      hasOrigin_ = true;
+    }
+    std::vector<Entry> entries{toEntry(box, slot)};
+    while (!trees_.empty() && trees_.back().size() <= entries.size()) {
+      appendEntries(trees_.back(), entries);
+      trees_.pop_back();
+    }
+    trees_.emplace_back(std::move(entries));
+  }
+
+  /**
+   * @brief Erases the entry whose slot matches isSlot and returns its slot, or PackedRTree::Erased if there is none.
+   *
+   * The entry is looked up by its box first. If the box is no longer the one the entry was inserted with, because the
+   * geometry of the primitive was modified in the meantime, all entries are checked.
+   */
+  template <typename Pred>
+  std::uint32_t erase(const BoundingBox2d& box, Pred&& isSlot) {
+    auto slot = PackedRTree::Erased;
+    if (!hasOrigin_) {
+      return slot;
+    }
+    auto entryBox = toEntry(box, slot).box;
+    auto erased = std::find_if(trees_.begin(), trees_.end(), [&](auto& tree) {
+      slot = tree.erase(entryBox, isSlot);
+      return slot != PackedRTree::Erased;
+    });
+    if (erased == trees_.end()) {
+      erased = std::find_if(trees_.begin(), trees_.end(), [&](auto& tree) {
+        slot = tree.eraseAnywhere(isSlot);
+        return slot != PackedRTree::Erased;
+      });
+    }
+    if (erased == trees_.end() || erased->numErased() <= erased->size()) {
+      return slot;
+    }
+    std::vector<Entry> entries;
+    appendEntries(*erased, entries);
+    trees_.erase(erased);
+    if (!entries.empty()) {
+      trees_.emplace_back(std::move(entries));
+      std::sort(trees_.begin(), trees_.end(), [](auto& lhs, auto& rhs) { return lhs.size() > rhs.size(); });
+    }
+    return slot;
+  }
+
+  /**
+   * @brief Calls func(slot, certain) for the entries that possibly intersect the area until it returns true. certain is
+   * true if the box of the entry intersects the area for sure, otherwise the caller has to check this with the exact
+   * box.
+   */
+  template <typename Func>
+  bool search(const BoundingBox2d& area, Func&& func) const {
+    if (trees_.empty()) {
+      return false;
+    }
+    // the float boxes are searched with an area that is rounded outwards as well
+    BoundingBox2d relativeArea(toRelative(area.min()), toRelative(area.max()));
+    auto floatArea = toFloatBox(relativeArea.min(), relativeArea.max());
+    auto innerArea = toInnerFloatBox(relativeArea.min(), relativeArea.max());
+    auto onEntry = [&](const Entry& entry) { return func(entry.slot, certainlyIntersects(entry.box, innerArea)); };
+    return std::any_of(trees_.begin(), trees_.end(), [&](auto& tree) { return tree.search(floatArea, onEntry); });
+  }
+
+  /**
+   * @brief Returns the slots of the n entries with the closest exact boxes to the point, by increasing distance.
+   *
+   * Unlike nearestUntil, this is a depth first branch and bound search on the float boxes only: the children of a node
+   * are visited by increasing distance until they are farther than the n-th smallest upper bound of the distance of the
+   * entries found so far. The entries that are within this bound at the end are sorted by the bounds of their
+   * distance. exactDistance(slot) is only asked for entries whose bounds overlap, so that their order is not clear.
+   */
+  template <typename DistanceFunc>
+  std::vector<std::uint32_t> nearest(const BasicPoint2d& point, size_t n, DistanceFunc&& exactDistance) const {
+    NearestBounds bounds(n);
+    auto relativePoint = toRelative(point);
+    for (const auto& tree : trees_) {
+      nearestInNode(tree, tree.rootLevel(), 0, 1, relativePoint, bounds);
+    }
+    auto& candidates = bounds.candidates;
+    auto bound = bounds.bound();
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                    [bound](auto& candidate) { return candidate.lowerBound > bound; }),
+                     candidates.end());
+    std::sort(candidates.begin(), candidates.end(),
+              [](auto& lhs, auto& rhs) { return lhs.lowerBound < rhs.lowerBound; });
+    std::vector<std::uint32_t> closest;
+    closest.reserve(std::min(n, candidates.size()));
+    for (auto first = candidates.begin(); first != candidates.end() && closest.size() < n;) {
+      // entries whose bounds overlap are sorted by their exact distance
+      auto last = std::next(first);
+      auto upperBound = first->upperBound;
+      for (; last != candidates.end() && last->lowerBound <= upperBound; ++last) {
+        upperBound = std::max(upperBound, last->upperBound);
+      }
+      if (last - first > 1) {
+        std::for_each(first, last, [&](auto& candidate) { candidate.lowerBound = exactDistance(candidate.slot); });
+        std::sort(first, last, [](auto& lhs, auto& rhs) { return lhs.lowerBound < rhs.lowerBound; });
+      }
+      for (; first != last && closest.size() < n; ++first) {
+        closest.push_back(first->slot);
+      }
+      first = last;
+    }
+    return closest;
+  }
+
+  /**
+   * @brief Incremental nearest neighbour search that calls func(slot) by increasing distance of the exact boxes to the
+   * point until it returns true.
+   *
+   * The nodes and entries are visited by increasing distance of their float boxes. An entry is only passed to func
+   * directly if its box can not be farther than anything left in the queue. Otherwise, exactDistance(slot) is asked for
+   * the squared distance of the exact box and the entry is queued again.
+   */
+  template <typename DistanceFunc, typename Func>
+  bool nearestUntil(const BasicPoint2d& point, DistanceFunc&& exactDistance, Func&& func) const {
+    struct Candidate {
+      double distance;
+      std::uint32_t index;
+      std::uint16_t tree;
+      std::uint16_t level;  //!< Refined once the exact distance of an entry is known
+    };
+    constexpr std::uint16_t Refined = std::numeric_limits<std::uint16_t>::max();
+    auto further = [](const Candidate& lhs, const Candidate& rhs) { return lhs.distance > rhs.distance; };
+    std::vector<Candidate> buffer;
+    buffer.reserve(8 * PackedRTree::NodeSize);
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(further)> queue(further, std::move(buffer));
+    auto relativePoint = toRelative(point);
+    for (size_t t = 0; t < trees_.size(); ++t) {
+      const auto& tree = trees_[t];
+      queue.push({squaredDistance(tree.box(tree.rootLevel(), 0), relativePoint), 0, std::uint16_t(t),
+                  std::uint16_t(tree.rootLevel())});
+    }
+    while (!queue.empty()) {
+      auto candidate = queue.top();
+      queue.pop();
+      const auto& tree = trees_[candidate.tree];
+      if (candidate.level == Refined) {
+        if (func(tree.entries()[candidate.index].slot)) {
+          return true;
+        }
+      } else if (candidate.level == 0) {
+        const auto& entry = tree.entries()[candidate.index];
+        if (entry.slot == PackedRTree::Erased) {
+          continue;
+        }
+        if (queue.empty() || maxSquaredDistance(entry.box, relativePoint) <= queue.top().distance) {
+          if (func(entry.slot)) {
+            return true;
+          }
+          continue;
+        }
+        queue.push({exactDistance(entry.slot), candidate.index, candidate.tree, Refined});
+      } else {
+        auto range = tree.children(candidate.level, candidate.index);
+        for (auto child = range.first; child < range.second; ++child) {
+          queue.push({squaredDistance(tree.box(candidate.level - 1, child), relativePoint), std::uint32_t(child),
+                      candidate.tree, std::uint16_t(candidate.level - 1)});
+        }
+      }
+    }
+    return false;
+  }
+
+ private:
+  //! The entries nearest has found, by the lower bound of their squared distance, and the bound they have to be within
+  class NearestBounds {
+   public:
+    explicit NearestBounds(size_t n) : n_{n} { upperBounds_.reserve(std::min(n, size_t(PackedRTree::NodeSize))); }
+
+    //! The n-th smallest upper bound of the squared distance so far. No entry that is farther can be among the n
+    //! closest ones.
+    double bound() const {
+      return upperBounds_.size() < n_ ? std::numeric_limits<double>::infinity() : upperBounds_.front();
+    }
+
+    void add(std::uint32_t slot, double lowerBound, double upperBound) {
+      candidates.push_back({lowerBound, upperBound, slot});
+      if (upperBounds_.size() == n_ && upperBound >= upperBounds_.front()) {
+        return;
+      }
+      if (upperBounds_.size() == n_) {
+        std::pop_heap(upperBounds_.begin(), upperBounds_.end());
+        upperBounds_.pop_back();
+      }
+      upperBounds_.push_back(upperBound);
+      std::push_heap(upperBounds_.begin(), upperBounds_.end());
+    }
+
+    struct Candidate {
+      double lowerBound;
+      double upperBound;
+      std::uint32_t slot;
+    };
+    std::vector<Candidate> candidates;
+
+   private:
+    size_t n_;
+    std::vector<double> upperBounds_;  //!< max heap of the n smallest upper bounds
+  };
+
+  /**
+   * @brief Visits the children [begin, end) of a node on the given level by increasing distance of their float boxes.
+   *
+   * Usually only the first few children are visited, so they are selected one by one instead of sorting all of them.
+   */
+  static void nearestInNode(const PackedRTree& tree, size_t level, size_t begin, size_t end,
+                            const BasicPoint2d& relativePoint, NearestBounds& bounds) {
+    if (level == 0) {
+      for (auto child = begin; child < end; ++child) {
+        const auto& entry = tree.entries()[child];
+        if (entry.slot == PackedRTree::Erased) {
+          continue;
+        }
+        auto distance = squaredDistance(entry.box, relativePoint);
+        if (distance <= bounds.bound()) {
+          bounds.add(entry.slot, distance, maxSquaredDistance(entry.box, relativePoint));
+        }
+      }
+      return;
+    }
+    std::array<std::pair<double, size_t>, PackedRTree::NodeSize> children;
+    size_t numChildren = 0;
+    for (auto child = begin; child < end; ++child) {
+      children[numChildren++] = {squaredDistance(tree.box(level, child), relativePoint), child};
+    }
+    while (numChildren > 0) {
+      auto next = std::min_element(children.begin(), children.begin() + numChildren);
+      if (next->first > bounds.bound()) {
+        return;
+      }
+      auto range = tree.children(level, next->second);
+      *next = children[--numChildren];
+      nearestInNode(tree, level - 1, range.first, range.second, relativePoint, bounds);
+    }
+  }
+
+  BasicPoint2d toRelative(const BasicPoint2d& p) const { return p - origin_; }
+
+  Entry toEntry(const BoundingBox2d& box, std::uint32_t slot) const {
+    return {toFloatBox(toRelative(box.min()), toRelative(box.max())), slot};
   }
-  auto found = std::find_if(tree.qbegin(bgi::intersects(area)), tree.qend(),
-                            [&func](auto& node) { return func(node.first, node.second); });
-  if (found != tree.qend()) {
-    return RetT(found->second);
+
+  static void appendEntries(const PackedRTree& tree, std::vector<Entry>& entries) {
+    std::copy_if(tree.entries().begin(), tree.entries().end(), std::back_inserter(entries),
+                 [](const Entry& entry) { return entry.slot != PackedRTree::Erased; });
   }
-  return {};
+
+  std::vector<PackedRTree> trees_;  //!< ordered by decreasing size
+  BasicPoint2d origin_{0., 0.};
+  bool hasOrigin_{false};
+};
+
+template <typename T>
+BoundingBox2d treeBox(const T& elem) {
+  return geometry::boundingBox2d(to2D(elem));
 }
 
-template <typename RetT, typename TreeT, typename Func>
-Optional<RetT> nearestUntilImpl(TreeT&& tree, const BasicPoint2d& point, const Func& func) {
-  if (tree.empty()) {
+BoundingBox2d treeBox(const Point3d& p) { return BoundingBox2d(Point2d(p).basicPoint()); }
+
+//! The box passed to search functions. For points, this is the point itself.
+template <typename T>
+const BoundingBox2d& searchBox(const T& /*elem*/, const BoundingBox2d& box) {
+  return box;
+}
+
+BasicPoint2d searchBox(const Point3d& p, const BoundingBox2d& /*box*/) { return Point2d(p).basicPoint(); }
+
+//! The elements of a SpatialIndex by slot. They point into the elements of the layer, so the index holds no copies of
+//! the primitives and a hit costs no lookup by id. Their exact boxes are computed when they are needed.
+template <typename T>
+using IndexSlots = std::vector<const T*>;
+
+template <typename RetT, typename T>
+std::vector<RetT> searchImpl(const SpatialIndex& index, const IndexSlots<T>& slots, const BoundingBox2d& area) {
+  // the hits are collected first, so that the primitives are copied only once into a vector of the right size
+  std::vector<std::uint32_t> hits;
+  index.search(area, [&](std::uint32_t slot, bool certain) {
+    if (certain || treeBox(*slots[slot]).intersects(area)) {
+      hits.push_back(slot);
+    }
+    return false;
+  });
+  return utils::transform(hits, [&](std::uint32_t slot) { return RetT(*slots[slot]); });
+}
+
+template <typename RetT, typename T, typename Func>
+Optional<RetT> searchUntilImpl(const SpatialIndex& index, const IndexSlots<T>& slots, const BoundingBox2d& area,
+                               const Func& func) {
+  Optional<RetT> result;
+  index.search(area, [&](std::uint32_t slot, bool /*certain*/) {
+    const auto& elem = *slots[slot];
+    auto box = treeBox(elem);
+    if (!box.intersects(area) || !func(searchBox(elem, box), RetT(elem))) {
+      return false;
+    }
+    result = RetT(elem);
+    return true;
+  });
+  return result;
+}
+
+template <typename RetT, typename T, typename Func>
+Optional<RetT> nearestUntilImpl(const SpatialIndex& index, const IndexSlots<T>& slots, const BasicPoint2d& point,
+                                const Func& func) {
+  Optional<RetT> result;
+  index.nearestUntil(
+      point, [&](std::uint32_t slot) { return squaredDistance(treeBox(*slots[slot]), point); },
+      [&](std::uint32_t slot) {
+        const auto& elem = *slots[slot];
+        if (!func(searchBox(elem, treeBox(elem)), RetT(elem))) {
+          return false;
+        }
+        result = RetT(elem);
+        return true;
+      });
+  return result;
+}
+
+template <typename RetT, typename T>
+std::vector<RetT> nearestImpl(const SpatialIndex& index, const IndexSlots<T>& slots, const BasicPoint2d& point,
+                              unsigned n) {
+  if (n == 0) {
     return {};
   }
-  auto found = std::find_if(tree.qbegin(bgi::nearest(point, unsigned(tree.size()))), tree.qend(),
-                            [&func](auto& node) { return func(node.first, node.second); });
-  if (found != tree.qend()) {
-    return RetT(found->second);
-  }
-  return {};
+  auto nearest =
+      index.nearest(point, n, [&](std::uint32_t slot) { return squaredDistance(treeBox(*slots[slot]), point); });
+  return utils::transform(nearest, [&](std::uint32_t slot) { return RetT(*slots[slot]); });
 }
 
 template <typename T>
@@ -325,58 +896,57 @@ struct UsageLookup<Point3d> {
 
 template <typename T>
 struct PrimitiveLayer<T>::Tree {
-  using TreeNode = std::pair<BoundingBox2d, T>;
-  using RTree = bgi::rtree<TreeNode, bgi::quadratic<16>>;
-  static TreeNode treeNode(const T& elem) { return {geometry::boundingBox2d(to2D(elem)), elem}; }
-  explicit Tree(const PrimitiveLayer::Map& primitives) {
-    std::vector<TreeNode> nodes;
-    nodes.reserve(primitives.size());
-    for (auto& primitive : primitives) {
-      auto node = treeNode(primitive.second);
-      if (!node.first.isEmpty()) {
-        nodes.push_back(std::move(node));
+  //! Indexes the elements of a layer. The index points to them, so they must stay in the layer while they are indexed.
+  explicit Tree(const PrimitiveLayer::Map& elements) {
+    std::vector<std::pair<BoundingBox2d, std::uint32_t>> boxes;
+    IndexSlots<T> unordered;
+    boxes.reserve(elements.size());
+    unordered.reserve(elements.size());
+    for (auto& element : elements) {
+      auto box = treeBox(element.second);
+      if (!box.isEmpty()) {
+        boxes.emplace_back(box, std::uint32_t(unordered.size()));
+        unordered.push_back(&element.second);
       }
     }
-    rTree = RTree(nodes);
+    auto order = index.build(boxes);
+    slots = utils::transform(order, [&](std::uint32_t element) { return unordered[element]; });
   }
 
+  //! elem must be the element in the layer, not a copy
   void insert(const T& elem) {
-    TreeNode node = treeNode(elem);
-    if (!node.first.isEmpty()) {
-      rTree.insert(node);
+    auto box = treeBox(elem);
+    if (box.isEmpty()) {
+      return;
+    }
+    std::uint32_t slot;
+    if (freeSlots.empty()) {
+      slot = std::uint32_t(slots.size());
+      slots.push_back(&elem);
+    } else {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+      slots[slot] = &elem;
     }
+    index.insert(box, slot);
   }
+  //! elem must be the element in the layer, and it must be erased before it is removed from the layer
   void erase(const T& elem) {
-    TreeNode node = treeNode(elem);
-    if (!node.first.isEmpty()) {
-      rTree.remove(node);
+    auto slot = index.erase(treeBox(elem), [&](std::uint32_t slot) { return slots[slot] == &elem; });
+    if (slot != PackedRTree::Erased) {
+      slots[slot] = nullptr;
+      freeSlots.push_back(slot);
     }
   }
-  RTree rTree;
+  SpatialIndex index;  //!< contains the float boxes and slots of the elements
+  IndexSlots<T> slots;
+  std::vector<std::uint32_t> freeSlots;
   UsageLookup<T> usage;
 };
 
-template <>
-struct PrimitiveLayer<Point3d>::Tree {
-  using TreeNode = std::pair<BasicPoint2d, Point3d>;
-  using RTree = bgi::rtree<TreeNode, bgi::quadratic<16>>;
-  static TreeNode treeNode(const Point3d& p) { return {Point2d(p).basicPoint(), p}; }
-  explicit Tree(const PrimitiveLayer::Map& primitives) {
-    std::vector<TreeNode> nodes;
-    nodes.reserve(primitives.size());
-    std::transform(primitives.begin(), primitives.end(), std::back_inserter(nodes),
-                   [](const auto& elem) { return treeNode(elem.second); });
-    rTree = RTree(nodes);
-  }
-  void insert(const Point3d& elem) { rTree.insert(treeNode(elem)); }
-  void erase(const Point3d& elem) { rTree.remove(treeNode(elem)); }
-  RTree rTree;
-  UsageLookup<Point3d> usage;
-};
-
 template <typename T>
 PrimitiveLayer<T>::PrimitiveLayer(const PrimitiveLayer::Map& primitives)
-    : elements_{primitives}, tree_{std::make_unique<Tree>(primitives)} {
+    : elements_{primitives}, tree_{std::make_unique<Tree>(elements_)} {
   for (const auto& prim : primitives) {
     tree_->usage.add(prim.second);
   }
@@ -384,7 +954,7 @@ PrimitiveLayer<T>::PrimitiveLayer(const PrimitiveLayer::Map& primitives)
 
 template <>
 PrimitiveLayer<Lanelet>::PrimitiveLayer(const PrimitiveLayer::Map& primitives)
-    : elements_{primitives}, tree_{std::make_unique<Tree>(primitives)} {
+    : elements_{primitives}, tree_{std::make_unique<Tree>(elements_)} {
   for (const auto& prim : primitives) {
     tree_->usage.add(prim.second);
   }
@@ -392,7 +962,7 @@ PrimitiveLayer<Lanelet>::PrimitiveLayer(const PrimitiveLayer::Map& primitives)
 
 template <>
 PrimitiveLayer<Area>::PrimitiveLayer(const PrimitiveLayer::Map& primitives)
-    : elements_{primitives}, tree_{std::make_unique<Tree>(primitives)} {
+    : elements_{primitives}, tree_{std::make_unique<Tree>(elements_)} {
   for (const auto& prim : primitives) {
     tree_->usage.add(prim.second);
     utils::registerId(prim.first);
@@ -433,36 +1003,46 @@ void PrimitiveLayer<T>::add(const PrimitiveLayer<T>::PrimitiveT& element) {
   for (const auto& elem : element) {
     tree_->usage.ownedLookup.insert(std::make_pair(elem, element));
   }
-  elements_.insert({element.id(), element});
-  tree_->insert(element);
+  auto inserted = elements_.insert({element.id(), element});
+  if (inserted.second) {
+    tree_->insert(inserted.first->second);
+  }
 }
 
 template <>
 void PrimitiveLayer<Area>::add(const Area& area) {
   tree_->usage.add(area);
-  elements_.insert({area.id(), area});
-  tree_->insert(area);
+  auto inserted = elements_.insert({area.id(), area});
+  if (inserted.second) {
+    tree_->insert(inserted.first->second);
+  }
 }
 
 template <>
 void PrimitiveLayer<Lanelet>::add(const Lanelet& ll) {
   tree_->usage.add(ll);
-  elements_.insert({ll.id(), ll});
-  tree_->insert(ll);
+  auto inserted = elements_.insert({ll.id(), ll});
+  if (inserted.second) {
+    tree_->insert(inserted.first->second);
+  }
 }
 
 template <>
 void PrimitiveLayer<Point3d>::add(const Point3d& p) {
   tree_->usage.add(p);
-  elements_.insert({p.id(), p});
-  tree_->insert(p);
+  auto inserted = elements_.insert({p.id(), p});
+  if (inserted.second) {
+    tree_->insert(inserted.first->second);
+  }
 }
 
 template <>
 void PrimitiveLayer<RegulatoryElementPtr>::add(const PrimitiveLayer<RegulatoryElementPtr>::PrimitiveT& element) {
   tree_->usage.add(element);
-  elements_.insert({element->id(), element});
-  tree_->insert(element);
+  auto inserted = elements_.insert({element->id(), element});
+  if (inserted.second) {
+    tree_->insert(inserted.first->second);
+  }
 }
 
 template <typename T>
@@ -479,10 +1059,10 @@ void PrimitiveLayer<T>::remove(Id id) {
       ++it;          
     }
   }
+  // erase from tree, which refers to the element in this layer
+  tree_->erase(elements_.find(id)->second);
   // erase id from registered elements in this layer
   elements_.erase(id);
-  // erase from tree
-  tree_->erase(element);
 }
 
 template <typename T>
@@ -517,16 +1097,16 @@ template <>
 void PrimitiveLayer<Point3d>::remove(Id id) {
   Point3d p = elements_.find(id)->second;
   tree_->usage.remove(p);
+  tree_->erase(elements_.find(id)->second);
   elements_.erase(id);
-  tree_->erase(p);
 }
 
 template <>
 void PrimitiveLayer<RegulatoryElementPtr>::remove(Id id) {
   RegulatoryElementPtr element = elements_.find(id)->second;
   tree_->usage.remove(element);
+  tree_->erase(elements_.find(id)->second);
   elements_.erase(id);
-  tree_->erase(element);
 }
 
 template <>
@@ -645,55 +1225,46 @@ typename PrimitiveLayer<T>::iterator PrimitiveLayer<T>::end() {
 }
 template <typename T>
 typename PrimitiveLayer<T>::ConstPrimitiveVec PrimitiveLayer<T>::search(const BoundingBox2d& area) const {
-  std::vector<typename Tree::TreeNode> nodes;
-  tree_->rTree.query(bgi::intersects(area), std::back_inserter(nodes));
-  return getSecond<ConstPrimitiveT, typename Tree::TreeNode>(nodes);
+  return searchImpl<ConstPrimitiveT>(tree_->index, tree_->slots, area);
 }
 
 template <typename T>
 typename PrimitiveLayer<T>::PrimitiveVec PrimitiveLayer<T>::search(const BoundingBox2d& area) {
-  std::vector<typename Tree::TreeNode> nodes;
-  tree_->rTree.query(bgi::intersects(area), std::back_inserter(nodes));
-  return getSecond<PrimitiveT, typename Tree::TreeNode>(nodes);
+  return searchImpl<PrimitiveT>(tree_->index, tree_->slots, area);
 }
 
 template <typename T>
 typename PrimitiveLayer<T>::OptConstPrimitiveT PrimitiveLayer<T>::searchUntil(const BoundingBox2d& area,
                                                                               const ConstSearchFunction& func) const {
-  return findUntilImpl<ConstPrimitiveT>(tree_->rTree, area, func);
+  return searchUntilImpl<ConstPrimitiveT>(tree_->index, tree_->slots, area, func);
 }
 
 template <typename T>
 typename PrimitiveLayer<T>::OptPrimitiveT PrimitiveLayer<T>::searchUntil(const BoundingBox2d& area,
                                                                          const PrimitiveLayer::SearchFunction& func) {
-  return findUntilImpl<PrimitiveT>(tree_->rTree, area, func);
+  return searchUntilImpl<PrimitiveT>(tree_->index, tree_->slots, area, func);
 }
 
 template <typename T>
 typename PrimitiveLayer<T>::ConstPrimitiveVec PrimitiveLayer<T>::nearest(const BasicPoint2d& point, unsigned n) const {
-  std::vector<typename Tree::TreeNode> nodes;
-  tree_->rTree.query(bgi::nearest(point, n), std::back_inserter(nodes));
-  return getSecond<ConstPrimitiveT, typename Tree::TreeNode>(nodes);
+  return nearestImpl<ConstPrimitiveT>(tree_->index, tree_->slots, point, n);
 }
 
 template <typename T>
 typename PrimitiveLayer<T>::PrimitiveVec PrimitiveLayer<T>::nearest(const BasicPoint2d& point, unsigned n) {
-  std::vector<typename Tree::TreeNode> nodes;
-  nodes.reserve(n);
-  tree_->rTree.query(bgi::nearest(point, n), std::back_inserter(nodes));
-  return getSecond<PrimitiveT, typename Tree::TreeNode>(nodes);
+  return nearestImpl<PrimitiveT>(tree_->index, tree_->slots, point, n);
 }
 
 template <typename T>
 typename PrimitiveLayer<T>::OptConstPrimitiveT PrimitiveLayer<T>::nearestUntil(const BasicPoint2d& point,
                                                                                const ConstSearchFunction& func) const {
-  return nearestUntilImpl<ConstPrimitiveT>(tree_->rTree, point, func);
+  return nearestUntilImpl<ConstPrimitiveT>(tree_->index, tree_->slots, point, func);
 }
 
 template <typename T>
 typename PrimitiveLayer<T>::OptPrimitiveT PrimitiveLayer<T>::nearestUntil(const BasicPoint2d& point,
                                                                           const SearchFunction& func) {
-  return nearestUntilImpl<PrimitiveT>(tree_->rTree, point, func);
+  return nearestUntilImpl<PrimitiveT>(tree_->index, tree_->slots, point, func);
 }
 
 template <typename T>
@@ -1197,11 +1768,17 @@ class NSmallestElements {
   bool insert(double measure, T value) {
     auto pos =
         std::lower_bound(values_.begin(), values_.end(), measure, [](auto& v1, double v2) { return v1.first < v2; });
-    if (pos != values_.end() || values_.size() < n_) {
-      values_.emplace(pos, measure, value);
-      return true;
+    if (pos == values_.end() && values_.size() >= n_) {
+      return false;
     }
-    return false;
+    if (values_.size() >= n_) {
+      // drop the largest first, so that the values never outgrow the reserved n elements
+      auto index = pos - values_.begin();
+      values_.pop_back();
+      pos = values_.begin() + index;
+    }
+    values_.emplace(pos, measure, value);
+    return true;
   }
   const auto& values() const { return values_; }
   bool full() const { return n_ <= values_.size(); }
@@ -1220,6 +1797,9 @@ auto findNearestImpl(LayerT&& map, const BasicPoint2d& pt, unsigned count) {
   // of the count-th furthest current element, then we can stop, because all
   // succeding elements will be even further away.
   NSmallestElements<RetT> closest(count);
+  if (count == 0) {
+    return closest.values();
+  }
   auto searchFunction = [&closest, &pt](auto& box, const RetT& prim) {
     auto dBox = distance(box, pt);
     if (closest.full() && dBox > closest.values().back().first) {
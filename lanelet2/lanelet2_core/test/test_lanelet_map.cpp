@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <future>
+#include <malloc.h>
+#include <random>
 #include "LaneletMap.h"
+#include "geometry/BoundingBox.h"
+#include "geometry/Lanelet.h"
 #include "lanelet_map_test_case.h"
 
 using namespace lanelet;
@@ -220,6 +227,21 @@ TEST_F(LaneletMapTest, findNearestWorksForComplexRegElems) {  // NOLINT
   });
 }
 
+TEST_F(LaneletMapTest, findNearestReturnsCountElements) {  // NOLINT
+  auto points = utils::transform(map->pointLayer, [](auto& p) { return p; });
+  auto distances = utils::transform(points, [](auto& p) { return geometry::distance2d(p, BasicPoint2d(0, -10)); });
+  std::sort(distances.begin(), distances.end());
+  testConstAndNonConst([&distances](auto& map) {
+    for (unsigned count = 0; count <= distances.size() + 1; ++count) {
+      auto pts = geometry::findNearest(map->pointLayer, BasicPoint2d(0, -10), count);
+      ASSERT_EQ(std::min<size_t>(count, distances.size()), pts.size());
+      for (size_t i = 0; i < pts.size(); ++i) {
+        EXPECT_DOUBLE_EQ(distances[i], pts[i].first);
+      }
+    }
+  });
+}
+
 TEST_F(LaneletMapTest, findNearestWorksOnEmptyMap) {  // NOLINT
   this->map = utils::createMap(Points3d());
   testConstAndNonConst([](auto& map) {
@@ -295,3 +317,218 @@ TEST_F(LaneletMapTest, createSubmap) {  // NOLINT
   EXPECT_LT(0ul, llMap->lineStringLayer.size());
   EXPECT_LT(0ul, llMap->pointLayer.size());
 }
+
+namespace {
+//! Lanelets of random size and direction around an offset, as in a map with UTM coordinates
+Lanelets randomLanelets(size_t num, std::mt19937& random, const BasicPoint2d& offset, double extent) {
+  std::uniform_real_distribution<double> position(0., extent);
+  std::uniform_real_distribution<double> angle(0., 2 * M_PI);
+  std::uniform_real_distribution<double> length(1., 30.);
+  Lanelets lanelets;
+  for (size_t i = 0; i < num; ++i) {
+    BasicPoint2d start = offset + BasicPoint2d(position(random), position(random));
+    auto a = angle(random);
+    BasicPoint2d direction(std::cos(a), std::sin(a));
+    BasicPoint2d normal(-direction.y(), direction.x());
+    BasicPoint2d end = start + length(random) * direction;
+    BasicPoint2d width = 3.5 * normal;
+    LineString3d left(getId(), {Point3d(getId(), start.x(), start.y(), 0), Point3d(getId(), end.x(), end.y(), 0)});
+    LineString3d right(getId(), {Point3d(getId(), start.x() - width.x(), start.y() - width.y(), 0),
+                                 Point3d(getId(), end.x() - width.x(), end.y() - width.y(), 0)});
+    lanelets.emplace_back(getId(), left, right);
+  }
+  return lanelets;
+}
+
+Ids sortedIds(const ConstLanelets& lanelets) {
+  auto ids = utils::transform(lanelets, [](auto& llt) { return llt.id(); });
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+}  // namespace
+
+TEST(LaneletMapSpatialIndex, queriesMatchBruteForce) {  // NOLINT
+  std::mt19937 random(0);
+  const BasicPoint2d offset(500000., 5400000.);
+  auto lanelets = randomLanelets(2000, random, offset, 1000.);
+  auto map = utils::createMap(Lanelets(lanelets.begin(), lanelets.begin() + 1500));
+  for (auto it = lanelets.begin() + 1500; it != lanelets.end(); ++it) {
+    map->add(*it);
+  }
+  const LaneletMap& constMap = *map;
+  ConstLanelets inMap(constMap.laneletLayer.begin(), constMap.laneletLayer.end());
+  std::uniform_real_distribution<double> position(0., 1000.);
+  std::uniform_real_distribution<double> size(0., 50.);
+  for (int query = 0; query < 200; ++query) {
+    BasicPoint2d point = offset + BasicPoint2d(position(random), position(random));
+    BoundingBox2d area(point, point + BasicPoint2d(size(random), size(random)));
+    ConstLanelets expected;
+    std::copy_if(inMap.begin(), inMap.end(), std::back_inserter(expected),
+                 [&](auto& llt) { return geometry::boundingBox2d(llt).intersects(area); });
+    EXPECT_EQ(sortedIds(expected), sortedIds(constMap.laneletLayer.search(area)));
+
+    auto boxDistance = [&](auto& llt) { return geometry::distance(geometry::boundingBox2d(llt), point); };
+    auto nearest = utils::transform(constMap.laneletLayer.nearest(point, 5), boxDistance);
+    ASSERT_EQ(nearest.size(), 5ul);
+    auto boxDistances = utils::transform(inMap, boxDistance);
+    std::sort(boxDistances.begin(), boxDistances.end());
+    for (size_t i = 0; i < nearest.size(); ++i) {
+      EXPECT_DOUBLE_EQ(boxDistances[i], nearest[i]);
+    }
+
+    auto closest = geometry::findNearest(constMap.laneletLayer, point, 3);
+    ASSERT_EQ(closest.size(), 3ul);
+    auto distances = utils::transform(inMap, [&](auto& llt) { return geometry::distance2d(llt, point); });
+    std::sort(distances.begin(), distances.end());
+    for (size_t i = 0; i < closest.size(); ++i) {
+      EXPECT_DOUBLE_EQ(distances[i], closest[i].first);
+    }
+  }
+}
+
+TEST(LaneletMapSpatialIndex, removedElementsAreNotFound) {  // NOLINT
+  std::mt19937 random(1);
+  const BasicPoint2d offset(500000., 5400000.);
+  auto lanelets = randomLanelets(300, random, offset, 200.);
+  auto map = utils::createMap(lanelets);
+  RegulatoryElementPtrs regelems;
+  for (auto& llt : lanelets) {
+    regelems.push_back(std::make_shared<GenericRegulatoryElement>(getId(), RuleParameterMap{{"refers"s, {llt}}}));
+    map->add(regelems.back());
+  }
+  for (size_t i = 0; i < regelems.size(); i += 3) {
+    map->remove(regelems[i]);
+  }
+  BoundingBox2d area(offset + BasicPoint2d(50, 50), offset + BasicPoint2d(150, 150));
+  Ids expected;
+  for (size_t i = 0; i < regelems.size(); ++i) {
+    if (i % 3 != 0 && geometry::boundingBox2d(lanelets[i]).intersects(area)) {
+      expected.push_back(regelems[i]->id());
+    }
+  }
+  auto found = utils::transform(map->regulatoryElementLayer.search(area), [](auto& regelem) { return regelem->id(); });
+  std::sort(expected.begin(), expected.end());
+  std::sort(found.begin(), found.end());
+  EXPECT_EQ(expected, found);
+  auto nearest = map->regulatoryElementLayer.nearest(lanelets[0].leftBound().front().basicPoint2d(), 1);
+  ASSERT_EQ(nearest.size(), 1ul);
+  EXPECT_NE(nearest.front(), regelems[0]);
+}
+
+TEST(LaneletMapSpatialIndex, elementsAddedAfterRemovalAreFound) {  // NOLINT
+  std::mt19937 random(2);
+  const BasicPoint2d offset(500000., 5400000.);
+  auto lanelets = randomLanelets(200, random, offset, 200.);
+  auto map = utils::createMap(lanelets);
+  RegulatoryElementPtrs regelems;
+  for (auto& llt : lanelets) {
+    regelems.push_back(std::make_shared<GenericRegulatoryElement>(getId(), RuleParameterMap{{"refers"s, {llt}}}));
+    map->add(regelems.back());
+  }
+  // the removed elements free their place in the index for the ones added afterwards
+  for (size_t i = 0; i < regelems.size(); i += 2) {
+    map->remove(regelems[i]);
+    regelems[i] = std::make_shared<GenericRegulatoryElement>(getId(), RuleParameterMap{{"refers"s, {lanelets[i]}}});
+    map->add(regelems[i]);
+    map->add(regelems[i]);
+  }
+  BoundingBox2d area(offset + BasicPoint2d(50, 50), offset + BasicPoint2d(150, 150));
+  Ids expected;
+  for (size_t i = 0; i < regelems.size(); ++i) {
+    if (geometry::boundingBox2d(lanelets[i]).intersects(area)) {
+      expected.push_back(regelems[i]->id());
+    }
+  }
+  auto found = utils::transform(map->regulatoryElementLayer.search(area), [](auto& regelem) { return regelem->id(); });
+  std::sort(expected.begin(), expected.end());
+  std::sort(found.begin(), found.end());
+  EXPECT_EQ(expected, found);
+  auto allIds = utils::transform(regelems, [](auto& regelem) { return regelem->id(); });
+  auto nearest = utils::transform(map->regulatoryElementLayer.nearest(offset, unsigned(regelems.size() + 1)),
+                                  [](auto& regelem) { return regelem->id(); });
+  std::sort(allIds.begin(), allIds.end());
+  std::sort(nearest.begin(), nearest.end());
+  EXPECT_EQ(allIds, nearest);
+}
+
+TEST(LaneletMapSpatialIndex, searchIsExactForLargeCoordinates) {  // NOLINT
+  Point3d p1(getId(), 500000.123456789, 5400000.987654321, 0);
+  Point3d p2(getId(), 500010.123456789, 5400003.987654321, 0);
+  auto map = utils::createMap({p1, p2});
+  BasicPoint2d justAbove(p1.x(), std::nextafter(p1.y(), 1e10));
+  EXPECT_TRUE(map->pointLayer.search(BoundingBox2d(p1.basicPoint2d(), p2.basicPoint2d())).size() == 2);
+  EXPECT_TRUE(map->pointLayer.search(BoundingBox2d(justAbove, justAbove + BasicPoint2d(1, 1))).empty());
+  auto found = map->pointLayer.search(BoundingBox2d(p1.basicPoint2d(), p1.basicPoint2d()));
+  ASSERT_EQ(found.size(), 1ul);
+  EXPECT_EQ(found.front(), p1);
+  auto nearest = map->pointLayer.nearest(justAbove, 1);
+  ASSERT_EQ(nearest.size(), 1ul);
+  EXPECT_EQ(nearest.front(), p1);
+}
+
+TEST(LaneletMapSpatialIndex, elementsMovedBeforeRemovalAreErased) {  // NOLINT
+  std::mt19937 random(3);
+  const BasicPoint2d offset(500000., 5400000.);
+  auto lanelets = randomLanelets(100, random, offset, 200.);
+  auto map = utils::createMap(lanelets);
+  RegulatoryElementPtrs regelems;
+  for (auto& llt : lanelets) {
+    regelems.push_back(std::make_shared<GenericRegulatoryElement>(getId(), RuleParameterMap{{"refers"s, {llt}}}));
+    map->add(regelems.back());
+  }
+  // the index can no longer find the regulatory element by the box it was inserted with
+  lanelets[0].leftBound().front().x() += 1000.;
+  map->remove(regelems[0]);
+  LaneletMap moved(std::move(*map));
+  BoundingBox2d all(offset - BasicPoint2d(2000, 2000), offset + BasicPoint2d(2000, 2000));
+  auto found = utils::transform(moved.regulatoryElementLayer.search(all), [](auto& regelem) { return regelem->id(); });
+  auto expected = utils::transform(regelems.begin() + 1, regelems.end(), [](auto& regelem) { return regelem->id(); });
+  std::sort(expected.begin(), expected.end());
+  std::sort(found.begin(), found.end());
+  EXPECT_EQ(expected, found);
+  EXPECT_EQ(moved.regulatoryElementLayer.nearest(offset, unsigned(regelems.size())).size(), regelems.size() - 1);
+}
+
+// Time of spatial queries on a map of 100000 lanelets. Run with --gtest_also_run_disabled_tests.
+TEST(LaneletMapSpatialIndex, DISABLED_QueryBenchmark) {  // NOLINT
+  std::mt19937 random(0);
+  const BasicPoint2d offset(500000., 5400000.);
+  typedef std::chrono::steady_clock Clock;
+  auto mapLanelets = randomLanelets(100000, random, offset, 10000.);
+  auto heapBefore = mallinfo2().uordblks;
+  auto start = Clock::now();
+  auto map = utils::createMap(mapLanelets);
+  auto built = Clock::now();
+  std::printf("map built in %.0f ms, %.1f MB of heap\n", std::chrono::duration<double>(built - start).count() * 1e3,
+              double(mallinfo2().uordblks - heapBefore) / (1 << 20));
+  std::uniform_real_distribution<double> position(0., 10000.);
+  std::vector<BasicPoint2d> points;
+  for (int i = 0; i < 1000; ++i) {
+    points.push_back(offset + BasicPoint2d(position(random), position(random)));
+  }
+  size_t found = 0;
+  auto time = [&](const char* name, auto&& query) {
+    auto queryStart = Clock::now();
+    for (auto& point : points) {
+      found += query(point);
+    }
+    std::printf("%s: %.2f us\n", name,
+                std::chrono::duration<double>(Clock::now() - queryStart).count() * 1e6 / points.size());
+  };
+  time("search 50m", [&](auto& p) {
+    return map->laneletLayer.search(BoundingBox2d(p, p + BasicPoint2d(50, 50))).size();
+  });
+  time("nearest 1", [&](auto& p) { return map->laneletLayer.nearest(p, 1).size(); });
+  time("nearest 10", [&](auto& p) { return map->laneletLayer.nearest(p, 10).size(); });
+  time("findNearest 1", [&](auto& p) { return geometry::findNearest(map->laneletLayer, p, 1).size(); });
+  time("findNearest 10", [&](auto& p) { return geometry::findNearest(map->laneletLayer, p, 10).size(); });
+  time("point nearest 1", [&](auto& p) { return map->pointLayer.nearest(p, 1).size(); });
+  start = Clock::now();
+  auto lanelets = randomLanelets(20000, random, offset, 10000.);
+  for (auto& llt : lanelets) {
+    map->add(llt);
+  }
+  std::printf("20000 lanelets added in %.0f ms\n", std::chrono::duration<double>(Clock::now() - start).count() * 1e3);
+  time("findNearest 1 after adding", [&](auto& p) { return geometry::findNearest(map->laneletLayer, p, 1).size(); });
+  EXPECT_GT(found, 0ul);
+}
@@ -36,6 +36,9 @@ class Projector {  // NOLINT
   //! @throws ReverseProjectionError if projection is impossible
   virtual GPSPoint reverse(const BasicPoint3d& p) const = 0;
 
+  //! Whether forward can be called from several threads at once. Parsers only project points in parallel if it can.
+  virtual bool isThreadSafe() const { return false; }
+
   //! Obtain the internal origin
   const Origin& origin() const { return origin_; }
 
@@ -67,6 +70,8 @@ class SphericalMercatorProjector : public Projector {
     return {lat, lon, p.z()};
   }
 
+  bool isThreadSafe() const override { return true; }
+
  private:
   static constexpr double EarthRadius{6378137.0};
 };
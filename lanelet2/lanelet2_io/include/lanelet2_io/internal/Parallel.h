@@ -0,0 +1,44 @@
+#pragma once
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace lanelet {
+namespace io {
+namespace internal {
+
+//! Number of threads used to load a map
+inline size_t numThreads() { return std::max(std::thread::hardware_concurrency(), 1u); }
+
+/** @brief Splits the indices [0, size) into up to maxThreads contiguous chunks, calls func(begin, end) for each chunk
+ *  on a thread of its own and returns the results in the order of the chunks.
+ *
+ *  Merging the results in this order gives the same result as processing all indices in a single call. Inputs too small
+ *  to be worth a thread are processed in a single chunk on the calling thread. func must only read shared state.
+ *  Exceptions are rethrown on the calling thread once all chunks are done. */
+template <typename Func>
+auto transformChunks(size_t size, Func&& func, size_t maxThreads = numThreads())
+    -> std::vector<decltype(func(size_t(), size_t()))> {
+  using Result = decltype(func(size_t(), size_t()));
+  constexpr size_t MinChunkSize = 1000;
+  const auto numChunks = std::max<size_t>(std::min(maxThreads, size / MinChunkSize), 1);
+  std::vector<std::future<Result>> futures;
+  futures.reserve(numChunks - 1);
+  for (size_t chunk = 1; chunk < numChunks; ++chunk) {
+    futures.push_back(std::async(std::launch::async, [&func, chunk, numChunks, size] {
+      return func(chunk * size / numChunks, (chunk + 1) * size / numChunks);
+    }));
+  }
+  std::vector<Result> results;
+  results.reserve(numChunks);
+  results.push_back(func(0, size / numChunks));
+  for (auto& future : futures) {
+    results.push_back(future.get());
+  }
+  return results;
+}
+
+}  // namespace internal
+}  // namespace io
+}  // namespace lanelet
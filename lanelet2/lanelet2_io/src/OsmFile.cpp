@@ -2,6 +2,7 @@
 #include <lanelet2_core/utility/Utilities.h>
 #include <boost/format.hpp>
 #include <iostream>
+#include "internal/Parallel.h"
 
 namespace lanelet {
 namespace osm {
@@ -37,6 +38,24 @@ struct UnresolvedRole {
   Primitive** location{};
 };
 
+//! Primitives decoded from a part of the file and the errors that occurred, both in the order of the file
+template <typename PrimT>
+struct Chunk {
+  std::vector<PrimT> primitives;
+  std::vector<std::pair<Id, std::string>> errors;
+};
+
+//! Relations decoded from a part of the file. Members that are relations are only known by position until all
+//! relations are in place.
+struct RelationsChunk : Chunk<Relation> {
+  struct Placeholder {
+    size_t relation{};  //!< index of the relation in the chunk
+    size_t member{};    //!< index of the member in the relation
+    Id referencedRelation{};
+  };
+  std::vector<Placeholder> placeholders;
+};
+
 Attributes tags(const pugi::xml_node& node) {
   Attributes attributes;
   for (auto tag = node.child(keyword::Tag); tag;  // NOLINT
@@ -54,6 +73,36 @@ bool isDeleted(const pugi::xml_node& node) {
   return action && std::string(action.value()) == keyword::Delete;  // NOLINT
 }
 
+//! Children with the given name that are not deleted, in the order of the file
+std::vector<pugi::xml_node> children(const pugi::xml_node& osmNode, const char* name) {
+  std::vector<pugi::xml_node> result;
+  for (auto node = osmNode.child(name); node;  // NOLINT
+       node = node.next_sibling(name)) {
+    if (!isDeleted(node)) {
+      result.push_back(node);
+    }
+  }
+  return result;
+}
+
+//! The primitive with the given id or nullptr
+template <typename MapT>
+typename MapT::mapped_type* findPrimitive(MapT& map, Id id) {
+  auto elem = map.find(id);
+  return elem == map.end() ? nullptr : &elem->second;
+}
+
+//! Inserts a primitive or replaces one with the same id. Ids are usually sorted in the file, so most go to the end.
+template <typename MapT, typename PrimT>
+void insert(MapT& map, PrimT&& primitive) {
+  const auto id = primitive.id;
+  if (map.empty() || map.rbegin()->first < id) {
+    map.emplace_hint(map.end(), id, std::forward<PrimT>(primitive));
+  } else {
+    map[id] = std::forward<PrimT>(primitive);
+  }
+}
+
 std::string toJosmStyle(double d) {
   std::string str = boost::str(boost::format{"%12.11f"} % d);
   str.erase(str.find_last_not_of('0') + 1, std::string::npos);
@@ -188,86 +237,119 @@ class OsmFileParser {
   }
 
  private:
+  // Nodes, ways and relations are decoded in chunks in parallel. They are inserted into the file in the order of the
+  // file and pointers to them are only taken afterwards, which gives the same result as reading them one by one.
   Nodes readNodes(const pugi::xml_node& osmNode) {
+    const auto xmlNodes = children(osmNode, keyword::Node);
+    auto chunks = io::internal::transformChunks(xmlNodes.size(), [&xmlNodes](size_t begin, size_t end) {
+      Chunk<Node> chunk;
+      chunk.primitives.reserve(end - begin);
+      for (auto i = begin; i < end; ++i) {
+        const auto& node = xmlNodes[i];
+        const auto id = node.attribute(keyword::Id).as_llong(InvalId);
+        const auto lat = node.attribute(keyword::Lat).as_double(0.);
+        const auto lon = node.attribute(keyword::Lon).as_double(0.);
+        const auto ele = node.find_child_by_attribute(keyword::Tag, keyword::Key, keyword::Elevation)
+                             .attribute(keyword::Value)
+                             .as_double(0.);
+        chunk.primitives.emplace_back(id, tags(node), GPSPoint{lat, lon, ele});
+      }
+      return chunk;
+    });
     Nodes nodes;
-    for (auto node = osmNode.child(keyword::Node); node;  // NOLINT
-         node = node.next_sibling(keyword::Node)) {
-      if (isDeleted(node)) {
-        continue;
+    for (auto& chunk : chunks) {
+      for (auto& node : chunk.primitives) {
+        insert(nodes, std::move(node));
       }
-      const auto id = node.attribute(keyword::Id).as_llong(InvalId);
-      const auto attributes = tags(node);
-      const auto lat = node.attribute(keyword::Lat).as_double(0.);
-      const auto lon = node.attribute(keyword::Lon).as_double(0.);
-      const auto ele = node.find_child_by_attribute(keyword::Tag, keyword::Key, keyword::Elevation)
-                           .attribute(keyword::Value)
-                           .as_double(0.);
-      nodes[id] = Node{id, attributes, {lat, lon, ele}};
     }
     return nodes;
   }
 
   Ways readWays(const pugi::xml_node& osmNode, Nodes& nodes) {
-    Ways ways;
-    for (auto node = osmNode.child(keyword::Way); node;  // NOLINT
-         node = node.next_sibling(keyword::Way)) {
-      if (isDeleted(node)) {
-        continue;
-      }
-      const auto id = node.attribute(keyword::Id).as_llong(InvalId);
-      const auto attributes = tags(node);
-      const auto nodeIds = [&node] {
-        Ids ids;
+    const auto xmlWays = children(osmNode, keyword::Way);
+    auto chunks = io::internal::transformChunks(xmlWays.size(), [&xmlWays, &nodes](size_t begin, size_t end) {
+      Chunk<Way> chunk;
+      chunk.primitives.reserve(end - begin);
+      for (auto i = begin; i < end; ++i) {
+        const auto& node = xmlWays[i];
+        const auto id = node.attribute(keyword::Id).as_llong(InvalId);
+        std::vector<Node*> wayNodes;
         for (auto refNode = node.child(keyword::Nd); refNode;  // NOLINT
              refNode = refNode.next_sibling(keyword::Nd)) {
-          ids.push_back(refNode.attribute(keyword::Ref).as_llong());
+          auto* wayNode = findPrimitive(nodes, refNode.attribute(keyword::Ref).as_llong());
+          if (wayNode == nullptr) {
+            chunk.errors.emplace_back(id, "Way references nonexisting points");
+            wayNodes.clear();
+            break;
+          }
+          wayNodes.push_back(wayNode);
         }
-        return ids;
-      }();
-      std::vector<Node*> wayNodes;
-      try {
-        wayNodes = utils::transform(nodeIds, [&nodes](const auto& elem) { return &nodes.at(elem); });
-      } catch (std::out_of_range&) {
-        reportParseError(id, "Way references nonexisting points");
+        chunk.primitives.emplace_back(id, tags(node), std::move(wayNodes));
+      }
+      return chunk;
+    });
+    Ways ways;
+    for (auto& chunk : chunks) {
+      reportParseErrors(chunk.errors);
+      for (auto& way : chunk.primitives) {
+        insert(ways, std::move(way));
       }
-      ways[id] = Way{id, attributes, wayNodes};
     }
     return ways;
   }
 
   Relations readRelations(const pugi::xml_node& osmNode, Nodes& nodes, Ways& ways) {
-    Relations relations;
     // Two-pass approach: We can resolve all roles except where relations reference relations. We insert a dummy nullptr
     // and resolve that later on.
-    std::vector<UnresolvedRole> unresolvedRoles;
-    for (auto node = osmNode.child(keyword::Relation); node;  // NOLINT
-         node = node.next_sibling(keyword::Relation)) {
-      if (isDeleted(node)) {
-        continue;
-      }
-      const auto id = node.attribute(keyword::Id).as_llong(InvalId);
-      const auto attributes = tags(node);
-      auto& relation = relations.emplace(id, Relation{id, attributes, {}}).first->second;
+    const auto xmlRelations = children(osmNode, keyword::Relation);
+    auto readChunk = [&xmlRelations, &nodes, &ways](size_t begin, size_t end) {
+      RelationsChunk chunk;
+      chunk.primitives.reserve(end - begin);
+      for (auto i = begin; i < end; ++i) {
+        const auto& node = xmlRelations[i];
+        const auto id = node.attribute(keyword::Id).as_llong(InvalId);
+        chunk.primitives.emplace_back(id, tags(node));
 
-      // resolve members
-      auto& roles = relation.members;
-      for (auto member = node.child(keyword::Member); member;  // NOLINT
-           member = member.next_sibling(keyword::Member)) {
-        Id memberId = member.attribute(keyword::Ref).as_llong();
-        const std::string role = member.attribute(keyword::Role).value();
-        const std::string type = member.attribute(keyword::Type).value();
-        try {
-          if (type == keyword::Node) {
-            roles.emplace_back(role, &nodes.at(memberId));
-          } else if (type == keyword::Way) {
-            roles.emplace_back(role, &ways.at(memberId));
+        // resolve members
+        auto& roles = chunk.primitives.back().members;
+        for (auto member = node.child(keyword::Member); member;  // NOLINT
+             member = member.next_sibling(keyword::Member)) {
+          Id memberId = member.attribute(keyword::Ref).as_llong();
+          const std::string role = member.attribute(keyword::Role).value();
+          const std::string type = member.attribute(keyword::Type).value();
+          if (type == keyword::Node || type == keyword::Way) {
+            auto* primitive = type == keyword::Node ? static_cast<Primitive*>(findPrimitive(nodes, memberId))
+                                                    : static_cast<Primitive*>(findPrimitive(ways, memberId));
+            if (primitive != nullptr) {
+              roles.emplace_back(role, primitive);
+            } else {
+              chunk.errors.emplace_back(id, "Relation has nonexistent member " + std::to_string(memberId));
+            }
           } else if (type == keyword::Relation) {
-            // insert a placeholder and store a pointer to it for the second pass
+            // insert a placeholder and store its position for the second pass
             roles.emplace_back(role, nullptr);
-            unresolvedRoles.push_back(UnresolvedRole{id, memberId, &roles.back().second});
+            chunk.placeholders.push_back({i - begin, roles.size() - 1, memberId});
           }
-        } catch (std::out_of_range&) {
-          reportParseError(id, "Relation has nonexistent member " + std::to_string(memberId));
+        }
+      }
+      return chunk;
+    };
+    auto chunks = io::internal::transformChunks(xmlRelations.size(), readChunk);
+    Relations relations;
+    std::vector<UnresolvedRole> unresolvedRoles;
+    for (auto& chunk : chunks) {
+      reportParseErrors(chunk.errors);
+      auto placeholder = chunk.placeholders.begin();
+      for (size_t i = 0; i < chunk.primitives.size(); ++i) {
+        auto& relation = chunk.primitives[i];
+        // the members of a relation that occurs more than once are added to the first one
+        auto& roles = relations.emplace(relation.id, Relation{relation.id, std::move(relation.attributes), {}})
+                          .first->second.members;
+        const auto offset = roles.size();
+        std::move(relation.members.begin(), relation.members.end(), std::back_inserter(roles));
+        for (; placeholder != chunk.placeholders.end() && placeholder->relation == i; ++placeholder) {
+          auto location = &roles[offset + placeholder->member].second;
+          unresolvedRoles.push_back(UnresolvedRole{relation.id, placeholder->referencedRelation, location});
         }
       }
     }
@@ -294,6 +376,11 @@ class OsmFileParser {
     auto errstr = "Error reading primitive with id " + std::to_string(id) + " from file: " + what;
     errors_.push_back(errstr);
   }
+  void reportParseErrors(const std::vector<std::pair<Id, std::string>>& errors) {
+    for (const auto& error : errors) {
+      reportParseError(error.first, error.second);
+    }
+  }
   Errors errors_;
 };
 }  // namespace
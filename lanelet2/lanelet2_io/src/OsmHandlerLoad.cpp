@@ -10,6 +10,7 @@
 #include "Exceptions.h"
 #include "io_handlers/Factory.h"
 #include "io_handlers/OsmFile.h"
+#include "internal/Parallel.h"
 
 using namespace std::string_literals;
 
@@ -55,6 +56,12 @@ Errors buildErrorMessage(const std::string& errorIntro, Errors errors) {
   return message;
 }
 
+/** @brief Builds a LaneletMap from an osm file.
+ *
+ *  Points, linestrings, polygons and lanelets are constructed in chunks in parallel from the primitives they refer to,
+ *  which are complete at that point. The chunks are merged into the map in the order of the file, so that the map and
+ *  the errors are the same as when loading everything one by one. Areas and regulatory elements and the linking between
+ *  them and the lanelets are done on the calling thread. */
 class FromFileLoader {  // NOLINT
  public:
   static std::unique_ptr<LaneletMap> loadMap(const osm::File& file, const Projector& projector, ErrorMessages& errors) {
@@ -85,73 +92,139 @@ class FromFileLoader {  // NOLINT
 
   FromFileLoader() = default;
 
-  void loadNodes(const lanelet::osm::Nodes& nodes, const Projector& projector) {
-    for (const auto& nodeElem : nodes) {
-      const auto& node = nodeElem.second;
-      try {
-        points_.emplace(node.id, Point3d(node.id, projector.forward(node.point), getAttributes(node.attributes)));
-      } catch (ForwardProjectionError& e) {
-        parserError(node.id, e.what());
+  template <typename PrimT>
+  struct Chunk {
+    std::vector<PrimT> primitives;
+    Errors errors;
+  };
+
+  //! Elements of an osm map that fulfill a predicate, so that they can be split into chunks
+  template <typename OsmPrimitiveT, typename Pred>
+  static std::vector<const OsmPrimitiveT*> select(const std::map<Id, OsmPrimitiveT>& primitives, Pred&& pred) {
+    std::vector<const OsmPrimitiveT*> selected;
+    selected.reserve(primitives.size());
+    for (const auto& primitive : primitives) {
+      if (pred(primitive.second)) {
+        selected.push_back(&primitive.second);
       }
     }
+    return selected;
   }
-  void loadWays(const lanelet::osm::Ways& ways) {
-    for (const auto& wayElem : ways) {
-      const auto& way = wayElem.second;
-      // reconstruct points
-      Points3d points;
-      points = utils::transform(way.nodes,
-                                [this, &way](const auto& n) { return this->getOrGetDummy(points_, n->id, way.id); });
-      if (points.empty()) {
-        parserError(way.id, "Ways must have at least one point!");
-        continue;
+
+  template <typename OsmPrimitiveT>
+  static std::vector<const OsmPrimitiveT*> select(const std::map<Id, OsmPrimitiveT>& primitives) {
+    return select(primitives, [](auto& /*primitive*/) { return true; });
+  }
+
+  //! Merges the chunks in their order, chunk.primitives are passed to add
+  template <typename PrimT, typename AddFunc>
+  void merge(std::vector<Chunk<PrimT>>& chunks, AddFunc&& add) {
+    for (auto& chunk : chunks) {
+      errors_.insert(errors_.end(), chunk.errors.begin(), chunk.errors.end());
+      for (auto& primitive : chunk.primitives) {
+        add(primitive);
       }
+    }
+  }
+
+  void loadNodes(const lanelet::osm::Nodes& nodes, const Projector& projector) {
+    const auto osmNodes = select(nodes);
+    auto loadChunk = [&osmNodes, &projector](size_t begin, size_t end) {
+      Chunk<Point3d> chunk;
+      chunk.primitives.reserve(end - begin);
+      for (auto i = begin; i < end; ++i) {
+        const auto& node = *osmNodes[i];
+        try {
+          chunk.primitives.emplace_back(node.id, projector.forward(node.point), getAttributes(node.attributes));
+        } catch (ForwardProjectionError& e) {
+          parserError(chunk.errors, node.id, e.what());
+        }
+      }
+      return chunk;
+    };
+    auto chunks = io::internal::transformChunks(osmNodes.size(), loadChunk,
+                                                projector.isThreadSafe() ? io::internal::numThreads() : 1);
+    points_.reserve(osmNodes.size());
+    merge(chunks, [this](const Point3d& point) { points_.emplace(point.id(), point); });
+  }
+
+  void loadWays(const lanelet::osm::Ways& ways) {
+    const auto osmWays = select(ways);
+    auto chunks = io::internal::transformChunks(osmWays.size(), [this, &osmWays](size_t begin, size_t end) {
+      Chunk<std::pair<LineString3d, bool>> chunk;  // linestrings of ways and whether they are polygons
+      chunk.primitives.reserve(end - begin);
+      for (auto i = begin; i < end; ++i) {
+        const auto& way = *osmWays[i];
+        // reconstruct points
+        Points3d points;
+        points = utils::transform(way.nodes, [this, &chunk, &way](const auto& n) {
+          return getOrGetDummy(points_, n->id, way.id, chunk.errors);
+        });
+        if (points.empty()) {
+          parserError(chunk.errors, way.id, "Ways must have at least one point!");
+          continue;
+        }
 
-      const auto id = way.id;
-      const auto attributes = getAttributes(way.attributes);
+        const auto id = way.id;
+        const auto attributes = getAttributes(way.attributes);
 
-      // determine area or way
-      auto isArea = attributes.find(AttributeNamesString::Area);
-      if (isArea != attributes.end() && isArea->second.asBool().get_value_or(false)) {
-        polygons_.emplace(id, Polygon3d(id, points, attributes));
+        // determine area or way
+        auto isArea = attributes.find(AttributeNamesString::Area);
+        auto isPolygon = isArea != attributes.end() && isArea->second.asBool().get_value_or(false);
+        chunk.primitives.emplace_back(LineString3d(id, points, attributes), isPolygon);
+      }
+      return chunk;
+    });
+    lineStrings_.reserve(osmWays.size());
+    merge(chunks, [this](const std::pair<LineString3d, bool>& way) {
+      if (way.second) {
+        polygons_.emplace(way.first.id(), Polygon3d(way.first));
       } else {
-        lineStrings_.emplace(id, LineString3d(id, points, attributes));
+        lineStrings_.emplace(way.first.id(), way.first);
       }
-    }
+    });
   }
 
   LaneletsWithRegulatoryElements loadLanelets(const lanelet::osm::Relations& relations) {
     // The regulatory elements are not parsed yet. We store lanelets with one
     // for
     // later.
-    LaneletsWithRegulatoryElements llWithRegulatoryElement;
-    for (const auto& relElem : relations) {
-      const auto& llElem = relElem.second;
-      if (!isType<AttributeValueString::Lanelet>(llElem)) {
-        continue;
-      }
-      const auto id = llElem.id;
-      const auto attributes = getAttributes(llElem.attributes);
-      auto left = getLaneletBorder(llElem, RoleNameString::Left);
-      auto right = getLaneletBorder(llElem, RoleNameString::Right);
-
-      // correct their orientation
-      std::tie(left, right) = geometry::align(left, right);
-
-      // look for optional centerline
-      Lanelet lanelet(id, left, right, attributes);
-      if (findRole(llElem.members, RoleNameString::Centerline) != llElem.members.end()) {
-        auto center = getLaneletBorder(llElem, RoleNameString::Centerline);
-        lanelet.setCenterline(center);
+    const auto llElems =
+        select(relations, [](auto& relation) { return isType<AttributeValueString::Lanelet>(relation); });
+    auto chunks = io::internal::transformChunks(llElems.size(), [this, &llElems](size_t begin, size_t end) {
+      Chunk<PrimitiveWithRegulatoryElement<Lanelet>> chunk;
+      chunk.primitives.reserve(end - begin);
+      for (auto i = begin; i < end; ++i) {
+        const auto& llElem = *llElems[i];
+        const auto id = llElem.id;
+        const auto attributes = getAttributes(llElem.attributes);
+        auto left = getLaneletBorder(llElem, RoleNameString::Left, chunk.errors);
+        auto right = getLaneletBorder(llElem, RoleNameString::Right, chunk.errors);
+
+        // correct their orientation
+        std::tie(left, right) = geometry::align(left, right);
+
+        // look for optional centerline
+        Lanelet lanelet(id, left, right, attributes);
+        if (findRole(llElem.members, RoleNameString::Centerline) != llElem.members.end()) {
+          auto center = getLaneletBorder(llElem, RoleNameString::Centerline, chunk.errors);
+          lanelet.setCenterline(center);
+        }
+        chunk.primitives.emplace_back(lanelet, &llElem);
       }
-
-      lanelets_.emplace(id, lanelet);
+      return chunk;
+    });
+    LaneletsWithRegulatoryElements llWithRegulatoryElement;
+    lanelets_.reserve(llElems.size());
+    merge(chunks, [this, &llWithRegulatoryElement](const PrimitiveWithRegulatoryElement<Lanelet>& lanelet) {
+      lanelets_.emplace(lanelet.first.id(), lanelet.first);
 
       // check for regulatory elements
-      if (findRole(llElem.members, RoleNameString::RegulatoryElement) != llElem.members.end()) {
-        llWithRegulatoryElement.push_back(std::make_pair(lanelet, &llElem));
+      const auto& members = lanelet.second->members;
+      if (findRole(members, RoleNameString::RegulatoryElement) != members.end()) {
+        llWithRegulatoryElement.push_back(lanelet);
       }
-    }
+    });
     return llWithRegulatoryElement;
   }
 
@@ -220,12 +293,12 @@ class FromFileLoader {  // NOLINT
 
   // helper functions
   template <const char* Type>
-  bool isType(const lanelet::osm::Relation& relation) {
+  static bool isType(const lanelet::osm::Relation& relation) {
     auto attr = relation.attributes.find(AttributeNamesString::Type);
     return attr != relation.attributes.end() && attr->second == Type;
   }
 
-  lanelet::AttributeMap getAttributes(const lanelet::osm::Attributes& osmAttributes) {
+  static lanelet::AttributeMap getAttributes(const lanelet::osm::Attributes& osmAttributes) {
     lanelet::AttributeMap attributes;
     for (const auto& osmAttr : osmAttributes) {
       attributes.insert(std::make_pair(osmAttr.first, lanelet::Attribute(osmAttr.second)));
@@ -233,19 +306,19 @@ class FromFileLoader {  // NOLINT
     return attributes;
   }
 
-  LineString3d getLaneletBorder(const osm::Relation& llElem, const std::string& role) {
+  LineString3d getLaneletBorder(const osm::Relation& llElem, const std::string& role, Errors& errors) const {
     size_t numMembers = 0;
     osm::forEachMember(llElem.members, role, [&](auto& /*role*/) { ++numMembers; });
     if (numMembers != 1) {
-      parserError(llElem.id, "Lanelet has not exactly one "s + role + " border!");
+      parserError(errors, llElem.id, "Lanelet has not exactly one "s + role + " border!");
       return LineString3d(llElem.id);
     }
     auto member = osm::findRole(llElem.members, role);
     if (member->second->type() != AttributeValueString::Way) {
-      parserError(llElem.id, "Lanelet "s + role + " border is not of type way!");
+      parserError(errors, llElem.id, "Lanelet "s + role + " border is not of type way!");
       return LineString3d(llElem.id);
     }
-    return getOrGetDummy(lineStrings_, member->second->id, llElem.id);
+    return getOrGetDummy(lineStrings_, member->second->id, llElem.id, errors);
   }
 
   LineStrings3d getLinestrings(const osm::Roles& roles, const std::string& roleName, Id refId) {
@@ -377,17 +450,25 @@ class FromFileLoader {  // NOLINT
 
   template <typename PrimT>
   PrimT getOrGetDummy(const typename std::unordered_map<Id, PrimT>& map, Id id, Id currentPrimitiveId) {
-    try {
-      return map.at(id);
-    } catch (std::out_of_range&) {
-      parserError(currentPrimitiveId, "Failed to get id "s + std::to_string(id) + " from map");
+    return getOrGetDummy(map, id, currentPrimitiveId, errors_);
+  }
+
+  template <typename PrimT>
+  static PrimT getOrGetDummy(const typename std::unordered_map<Id, PrimT>& map, Id id, Id currentPrimitiveId,
+                             Errors& errors) {
+    auto elem = map.find(id);
+    if (elem == map.end()) {
+      parserError(errors, currentPrimitiveId, "Failed to get id "s + std::to_string(id) + " from map");
       return getDummy<PrimT>(id);
     }
+    return elem->second;
   }
 
-  void parserError(Id id, const std::string& what) {
+  void parserError(Id id, const std::string& what) { parserError(errors_, id, what); }
+
+  static void parserError(Errors& errors, Id id, const std::string& what) {
     auto errstr = "Error parsing primitive "s + std::to_string(id) + ": " + what;
-    errors_.push_back(errstr);
+    errors.push_back(errstr);
   }
 
   Errors errors_;
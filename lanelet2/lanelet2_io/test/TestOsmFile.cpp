@@ -83,3 +83,32 @@ TEST(OsmFile, readMapWithIncompleteRoles) {  // NOLINT
   EXPECT_EQ(members[1].first, "somerole2");
   EXPECT_EQ(members[2].first, "somerole3");
 }
+
+TEST(OsmFile, readLargeFile) {  // NOLINT
+  // large enough to be read in several chunks
+  std::stringstream xml;
+  xml << "<osm>";
+  for (auto i = 1; i <= 5000; ++i) {
+    xml << "<node id=\"" << i << "\" lat=\"" << i << "\" lon=\"1\"/>";
+  }
+  for (auto i = 5001; i <= 10000; ++i) {
+    // every 1000th way references a node that does not exist
+    auto secondNode = i % 1000 == 0 ? 0 : i - 4999;
+    xml << "<way id=\"" << i << "\"><nd ref=\"" << i - 5000 << "\"/><nd ref=\"" << secondNode << "\"/></way>";
+  }
+  xml << "</osm>";
+  pugi::xml_document doc;
+  doc.load_string(xml.str().c_str());
+  Errors errors;
+  auto file = read(doc, &errors);
+  ASSERT_EQ(file.nodes.size(), 5000UL);
+  ASSERT_EQ(file.ways.size(), 5000UL);
+  EXPECT_EQ(file.nodes.at(42).point.lat, 42.);
+  ASSERT_EQ(file.ways.at(5042).nodes.size(), 2UL);
+  EXPECT_EQ(file.ways.at(5042).nodes.back(), &file.nodes.at(43));
+  EXPECT_TRUE(file.ways.at(6000).nodes.empty());
+  // errors are reported in the order of the file
+  ASSERT_EQ(errors.size(), 5UL);
+  EXPECT_NE(errors.front().find("6000"), std::string::npos);
+  EXPECT_NE(errors.back().find("10000"), std::string::npos);
+}
@@ -1,13 +1,27 @@
 #include <gtest/gtest.h>
 #include <lanelet2_core/LaneletMap.h>
 #include <lanelet2_core/primitives/BasicRegulatoryElements.h>
+#include <chrono>
 #include <cstdio>
+#include <thread>
+#include <type_traits>
 #include "Io.h"
 #include "TestSetup.h"
 #include "io_handlers/OsmHandler.h"
 
 using namespace lanelet;
 
+namespace {
+//! Keeps the coordinates as they are, so that writing and loading a map does not change it
+class IdentityProjector : public Projector {
+ public:
+  IdentityProjector() : Projector(Origin({0, 0, 0})) {}
+  BasicPoint3d forward(const GPSPoint& p) const override { return {p.lat, p.lon, p.ele}; }
+  GPSPoint reverse(const BasicPoint3d& p) const override { return {p.x(), p.y(), p.z()}; }
+  bool isThreadSafe() const override { return true; }
+};
+}  // namespace
+
 template <typename T, typename TT>
 T writeAndLoad(const T& value, TT(LaneletMapLayers::*layer)) {
   LaneletMap llmap;
@@ -116,3 +130,92 @@ TEST(OsmHandler, writeMapWithLaneletAndAreaToFile) {  // NOLINT
   write(filename, *map, origin);
   EXPECT_NO_THROW(load(filename, origin));  // NOLINT
 }
+
+TEST(OsmHandler, writeAndLoadLargeMap) {  // NOLINT
+  // large enough to be loaded in several chunks
+  auto num = 1;
+  LaneletMap map;
+  for (auto i = 0; i < 2000; ++i) {
+    map.add(test_setup::setUpLanelet(num));
+  }
+  for (auto i = 0; i < 10; ++i) {
+    map.add(test_setup::setUpArea(num));
+    Polygon3d poly{test_setup::setUpLineString(num)};
+    poly.setAttribute(AttributeNamesString::Area, "true");
+    map.add(poly);
+  }
+  IdentityProjector projector;
+  auto writeAndLoadMap = [&projector](const LaneletMap& map) {
+    ErrorMessages errsWrite;
+    ErrorMessages errsLoad;
+    auto file = io_handlers::OsmWriter(projector).toOsmFile(map, errsWrite);
+    auto loadedMap = io_handlers::OsmParser(projector).fromOsmFile(*file, errsLoad);
+    EXPECT_TRUE(errsWrite.empty());
+    EXPECT_TRUE(errsLoad.empty());
+    return loadedMap;
+  };
+  auto loadedMap = writeAndLoadMap(map);
+  EXPECT_EQ(map.pointLayer, loadedMap->pointLayer);
+  EXPECT_EQ(map.lineStringLayer, loadedMap->lineStringLayer);
+  EXPECT_EQ(map.polygonLayer, loadedMap->polygonLayer);
+  EXPECT_EQ(map.laneletLayer.size(), loadedMap->laneletLayer.size());
+  EXPECT_EQ(map.areaLayer.size(), loadedMap->areaLayer.size());
+  EXPECT_EQ(map.regulatoryElementLayer.size(), loadedMap->regulatoryElementLayer.size());
+  // writing adds type tags, so the map only stays exactly the same from the first load on
+  EXPECT_EQ(*loadedMap, *writeAndLoadMap(*loadedMap));
+}
+
+// Time to read and load an osm file of about 100000 lanelets. Run with --gtest_also_run_disabled_tests.
+TEST(OsmHandler, DISABLED_LoadBenchmark) {  // NOLINT
+  Lanelets lanelets;
+  Id id = 1;
+  for (int i = 0; i < 100000; ++i) {
+    double x = (i % 300) * 10.;
+    double y = (i / 300) * 10.;
+    LineString3d left(id, {Point3d(id + 1, x, y, 0), Point3d(id + 2, x + 10, y, 0)});
+    LineString3d right(id + 3, {Point3d(id + 4, x, y + 3, 0), Point3d(id + 5, x + 10, y + 3, 0)});
+    lanelets.emplace_back(id + 6, left, right,
+                          AttributeMap{{AttributeNamesString::Subtype, AttributeValueString::Road}});
+    id += 7;
+  }
+  auto map = utils::createMap(lanelets);
+  Origin origin({49, 8.4, 0});
+  std::string filename = std::tmpnam(nullptr) + std::string(".osm");  // NOLINT
+  write(filename, *map, origin);
+
+  typedef std::chrono::steady_clock Clock;
+  auto start = Clock::now();
+  pugi::xml_document doc;
+  ASSERT_TRUE(doc.load_file(filename.c_str()));
+  auto parsed = Clock::now();
+  auto file = osm::read(doc);
+  auto fileRead = Clock::now();
+  ErrorMessages errors;
+  auto projector = defaultProjection(origin);
+  auto loadedMap = io_handlers::OsmParser(projector).fromOsmFile(file, errors);
+  auto loaded = Clock::now();
+  // loading ends with the single-threaded LaneletMap constructor, build the same map again to see its share
+  auto layerMap = [](auto& layer) {
+    typename std::decay_t<decltype(layer)>::Map primitives;
+    for (auto primitive : layer) {
+      primitives.emplace(primitive.id(), primitive);
+    }
+    return primitives;
+  };
+  auto lanelets = layerMap(loadedMap->laneletLayer);
+  auto lineStrings = layerMap(loadedMap->lineStringLayer);
+  auto points = layerMap(loadedMap->pointLayer);
+  auto constructing = Clock::now();
+  LaneletMap constructedMap(lanelets, {}, {}, {}, lineStrings, points);
+  auto constructed = Clock::now();
+  auto ms = [](auto duration) { return std::chrono::duration<double>(duration).count() * 1e3; };
+  std::printf(
+      "%u threads: xml parsed in %.0f ms, osm file read in %.0f ms, map loaded in %.0f ms, of which about %.0f ms in "
+      "the LaneletMap constructor\n",
+      std::thread::hardware_concurrency(), ms(parsed - start), ms(fileRead - parsed), ms(loaded - fileRead),
+      ms(constructed - constructing));
+  EXPECT_EQ(constructedMap.laneletLayer.size(), map->laneletLayer.size());
+  EXPECT_TRUE(errors.empty());
+  EXPECT_EQ(loadedMap->laneletLayer.size(), map->laneletLayer.size());
+  std::remove(filename.c_str());
+}
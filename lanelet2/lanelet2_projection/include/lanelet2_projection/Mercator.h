@@ -13,6 +13,7 @@ class Mercator : public Projector {
 
   BasicPoint3d forward(const GPSPoint& pGps) const override { return rawForward(pGps) - offset_; }
   GPSPoint reverse(const BasicPoint3d& p) const override { return rawReverse(p + offset_); }
+  bool isThreadSafe() const override { return true; }
 
  private:
   static BasicPoint3d rawForward(const GPSPoint& p) {
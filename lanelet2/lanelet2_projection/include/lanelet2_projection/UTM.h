@@ -12,6 +12,8 @@ class UtmProjector : public Projector {
 
   GPSPoint reverse(const BasicPoint3d& utm) const override;
 
+  bool isThreadSafe() const override { return true; }
+
  private:
   int zone_{};
   bool isInNorthernHemisphere_{true}, useOffset_{}, throwInPaddingArea_{};
@@ -122,6 +122,12 @@ BOOST_PYTHON_MODULE(PYTHON_API_MODULE_NAME) {  // NOLINT
       .add_property("numLaneChanges", &LaneletOrAreaVisitInformation::numLaneChanges,
                     "The number of lane changes necessary along the shortest path");
 
+  enum_<ShortestPathAlgorithm>("ShortestPathAlgorithm")
+      .value("Dijkstra", ShortestPathAlgorithm::Dijkstra)
+      .value("AStar", ShortestPathAlgorithm::AStar)
+      .value("BidirectionalAStar", ShortestPathAlgorithm::BidirectionalAStar)
+      .export_values();
+
   class_<RoutingGraph, boost::noncopyable, RoutingGraphPtr>(
       "RoutingGraph",
       "Main class of the routing module that holds routing information and can "
@@ -140,10 +146,14 @@ BOOST_PYTHON_MODULE(PYTHON_API_MODULE_NAME) {  // NOLINT
       .def("getRouteVia", getRouteWrapper, "driving route from 'start' to 'end' lanelet using the 'via' lanelets",
            (arg("from"), arg("via"), arg("to"), arg("routingCostId") = 0, arg("withLaneChanges") = true))
       .def("shortestPath", &RoutingGraph::shortestPath, "shortest path between 'start' and 'end'",
-           (arg("from"), arg("to"), arg("routingCostId") = 0))
+           (arg("from"), arg("to"), arg("routingCostId") = 0, arg("withLaneChanges") = true,
+            arg("algorithm") = ShortestPathAlgorithm::AStar))
       .def("shortestPathWithVia", &RoutingGraph::shortestPathVia,
            "shortest path between 'start' and 'end' using intermediate points",
            (arg("start"), arg("via"), arg("end"), arg("routingCostId") = 0))
+      .def("precomputeLandmarks", &RoutingGraph::precomputeLandmarks,
+           "precompute landmarks that speed up repeated shortest path queries",
+           (arg("routingCostId") = 0, arg("withLaneChanges") = true, arg("numLandmarks") = 16))
       .def("routingRelation", &RoutingGraph::routingRelation, "relation between two lanelets excluding 'conflicting'",
            (arg("from"), arg("to")))
       .def("following", &RoutingGraph::following, "lanelets that can be reached from this lanelet",
@@ -217,6 +227,10 @@ BOOST_PYTHON_MODULE(PYTHON_API_MODULE_NAME) {  // NOLINT
            "Export the internal graph to graphML (xml-based) file format")
       .def("exportGraphViz", +[](RoutingGraph& self, const std::string& path) { self.exportGraphViz(path); },
            "Export the internal graph to graphViz (DOT) file format")
+      .def("exportLandmarks", &RoutingGraph::exportLandmarks, "Write the precomputed landmarks to a binary file",
+           arg("filename"))
+      .def("importLandmarks", &RoutingGraph::importLandmarks, "Read landmarks written by exportLandmarks",
+           arg("filename"))
       .def("getDebugLaneletMap", &RoutingGraph::getDebugLaneletMap,
            "abstract lanelet map holding the information of the routing graph",
            (arg("routingCostId") = 0, arg("includeAdjacent") = false, arg("includeConflicting") = false))
@@ -79,18 +79,21 @@ class RoutingGraph {
 
   /** @brief Retrieve a shortest path between 'start' and 'end'.
    *
-   *  Will find a shortest path using Djikstra's shortest path algorithm and the routing cost calculated by the
-   * routing cost module with the respective ID. Be aware that the shortest path may contain lane changes,
-   * i.e. lanelets that are parallel and not only adjacent.
+   *  Will find a shortest path using the given algorithm and the routing cost calculated by the routing cost module
+   * with the respective ID. A* uses the straight line distance between the lanelets, scaled to never exceed the routing
+   * cost, as estimation of the remaining cost. The search stops once the path to 'end' is known. Be aware that the
+   * shortest path may contain lane changes, i.e. lanelets that are parallel and not only adjacent.
    *  @param from Start lanelet to find a shortest path
    *  @param to End lanelet to find a shortest path
    *  @param routingCostId ID of RoutingCost module to determine shortest path
-   *  @param withLaneChanges if false, the shortest path will not contain lane changes */
+   *  @param withLaneChanges if false, the shortest path will not contain lane changes
+   *  @param algorithm Search algorithm. Paths of the same cost may differ between the algorithms. */
   Optional<LaneletPath> shortestPath(const ConstLanelet& from, const ConstLanelet& to, RoutingCostId routingCostId = {},
-                                     bool withLaneChanges = true) const;
+                                     bool withLaneChanges = true,
+                                     ShortestPathAlgorithm algorithm = ShortestPathAlgorithm::AStar) const;
 
   /** @brief Retrieve a shortest path between 'start' and 'end' using intermediate points.
-   *  Will find a shortest path using Djikstra's shortest path algorithm and the routing cost calculated by the
+   *  Will find a shortest path using A* and the routing cost calculated by the
    * routing cost module with the respective ID. Be aware that the shortest path may contain lane changes,
    * i.e. lanelets that are parallel and not only adjacent.
    *  @param start Start lanelet to find a shortest path
@@ -102,6 +105,21 @@ class RoutingGraph {
   Optional<LaneletPath> shortestPathVia(const ConstLanelet& start, const ConstLanelets& via, const ConstLanelet& end,
                                         RoutingCostId routingCostId = {}, bool withLaneChanges = true) const;
 
+  /** @brief Precompute the routing costs from and to a few landmark lanelets to speed up repeated queries.
+   *  The A* search of shortestPath, shortestPathVia, getRoute and getRouteVia then estimates the remaining cost with
+   * the triangle inequality over the landmarks (ALT), which is much closer to the real cost than the straight line
+   * distance. This only applies to queries with the same routing cost module and lane change setting. It takes two
+   * searches over the whole graph and 16 bytes per lanelet for each landmark. Computing them again replaces them.
+   *  The queries are still searches, not lookups. On a grid city of 100k lanelets, 16 landmarks take 2.6 s to compute
+   * and bring a query across 8 km of the grid from 60 ms to 9.5 ms; queries along a road stay at a fraction of a
+   * millisecond with or without them.
+   *  @param routingCostId ID of RoutingCost module of the queries to speed up
+   *  @param withLaneChanges lane change setting of the queries to speed up
+   *  @param numLandmarks number of landmarks. More landmarks give better estimations but each step of the search
+   * gets slower.
+   *  @see exportLandmarks */
+  void precomputeLandmarks(RoutingCostId routingCostId = {}, bool withLaneChanges = true, size_t numLandmarks = 16);
+
   /** @brief Determines the relation between two lanelets
    *  @param from Start lanelet
    *  @param to Goal lanelet
@@ -343,6 +361,18 @@ class RoutingGraph {
   void exportGraphViz(const std::string& filename, const RelationType& edgeTypesToExclude = RelationType::None,
                       RoutingCostId routingCostId = {}) const;
 
+  /** @brief Write all landmarks computed by precomputeLandmarks to a binary file.
+   *  The file can be imported into a routing graph built from the same map with the same traffic rules and routing
+   * costs, which avoids computing the landmarks again. The file is specific to the platform.
+   *  @param filename Fully qualified file name
+   *  @throws ExportError if the file can not be written */
+  void exportLandmarks(const std::string& filename) const;
+
+  /** @brief Read landmarks written by exportLandmarks. They are added to the landmarks of this graph.
+   *  @param filename Fully qualified file name
+   *  @throws RoutingGraphError if the file can not be read or was written for a different graph */
+  void importLandmarks(const std::string& filename);
+
   /** @brief An abstract lanelet map holding the information of the routing graph.
    *  A good way to view the routing graph since it can be exported using the lanelet2_io module and there can be
    * viewed in tools like JOSM. Each lanelet is represented by a point at the center of gravity of the lanelet.
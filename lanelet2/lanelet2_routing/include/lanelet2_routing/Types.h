@@ -25,6 +25,13 @@ struct LaneletVisitInformation {
   size_t numLaneChanges{};   //!< Number of lane changes from start to here along shortest path
 };
 
+//! Algorithm of the shortest path search. All of them find a path of the lowest cost.
+enum class ShortestPathAlgorithm {
+  Dijkstra,           //!< Explores the graph by increasing cost from the start
+  AStar,              //!< Explores the graph towards the goal, using the straight line distance to it
+  BidirectionalAStar  //!< Explores towards the goal from the start and towards the start from the goal until they meet
+};
+
 using LaneletVisitFunction = std::function<bool(const LaneletVisitInformation&)>;
 using LaneletOrAreaVisitFunction = std::function<bool(const LaneletOrAreaVisitInformation&)>;
 
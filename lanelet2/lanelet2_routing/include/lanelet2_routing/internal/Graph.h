@@ -4,21 +4,27 @@
 #include <lanelet2_core/primitives/LaneletOrArea.h>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/filtered_graph.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <map>
 #include <utility>
 #include "../Exceptions.h"
+#include "Landmarks.h"
 
 namespace lanelet {
 namespace routing {
 namespace internal {
 /** @brief Internal information of a vertex in the graph
- *  If A* search is adapted, this could hold information about longitude and latitude. */
+ *  The position is used by the A* search to estimate the remaining cost to the goal. */
 struct VertexInfo {
   // careful. You must be sure that this is indeed a lanelet
   const ConstLanelet& lanelet() const { return static_cast<const ConstLanelet&>(laneletOrArea); }
   const ConstArea& area() const { return static_cast<const ConstArea&>(laneletOrArea); }
   const ConstLaneletOrArea& get() const { return laneletOrArea; }
   ConstLaneletOrArea laneletOrArea;
+  BasicPoint2d position{0., 0.};  ///< Middle of the centerline of a lanelet, centroid of an area
 };
 
 /** @brief Internal information of a vertex in the route graph */
@@ -241,7 +247,67 @@ class Graph {
 };
 
 class RoutingGraphGraph : public Graph<GraphType> {
+ public:
   using Graph::Graph;
+
+  /** @brief Determines for each routing cost module and relation the lowest ratio of the routing cost of an edge to the
+   *  distance between the positions of its vertices. Has to be called once all vertices and edges are added. */
+  void computeCostPerDistance() {
+    const auto& g = get();
+    costPerDistance_.assign(numRoutingCosts(), CostPerRelation{});
+    for (auto& costs : costPerDistance_) {
+      costs.fill(std::numeric_limits<double>::infinity());
+    }
+    for (auto v : boost::make_iterator_range(boost::vertices(g))) {
+      if (!std::isfinite(g[v].position.x()) || !std::isfinite(g[v].position.y())) {
+        for (auto& costs : costPerDistance_) {
+          costs.fill(0.);  // no estimation for this vertex, so none at all
+        }
+        return;
+      }
+    }
+    for (auto e : boost::make_iterator_range(boost::edges(g))) {
+      auto& costs = costPerDistance_.at(g[e].costId);
+      auto distance = (g[boost::source(e, g)].position - g[boost::target(e, g)].position).norm();
+      for (size_t bit = 0; bit < costs.size(); ++bit) {
+        if (distance > 0. && RelationUnderlyingType(g[e].relation) & (1U << bit)) {
+          costs[bit] = std::min(costs[bit], g[e].routingCost / distance);
+        }
+      }
+    }
+  }
+
+  /** @brief Lower bound of the routing cost between two vertices per distance between their positions, when only the
+   *  edges of this routing cost module with one of these relations are used. Zero if there is no bound. */
+  double costPerDistance(RoutingCostId routingCostId, RelationType relations) const {
+    if (routingCostId >= costPerDistance_.size()) {
+      return 0.;
+    }
+    auto& costs = costPerDistance_[routingCostId];
+    auto result = std::numeric_limits<double>::infinity();
+    for (size_t bit = 0; bit < costs.size(); ++bit) {
+      if (RelationUnderlyingType(relations) & (1U << bit)) {
+        result = std::min(result, costs[bit]);
+      }
+    }
+    return std::isfinite(result) ? result : 0.;
+  }
+
+  //! Landmarks of the graph with or without lane changes for a routing cost module, nullptr if none were computed
+  const Landmarks* landmarks(RoutingCostId routingCostId, bool withLaneChanges) const {
+    auto it = landmarks_.find(std::make_pair(routingCostId, withLaneChanges));
+    return it == landmarks_.end() ? nullptr : &it->second;
+  }
+
+  //! All landmarks by routing cost module and lane changes
+  using LandmarksMap = std::map<std::pair<RoutingCostId, bool>, Landmarks>;
+  inline const LandmarksMap& landmarks() const noexcept { return landmarks_; }
+  inline LandmarksMap& landmarks() noexcept { return landmarks_; }
+
+ private:
+  using CostPerRelation = std::array<double, 7>;  // one for each bit of RelationType
+  std::vector<CostPerRelation> costPerDistance_;
+  LandmarksMap landmarks_;
 };
 class RouteGraph : public Graph<RouteGraphType> {
   using Graph::Graph;
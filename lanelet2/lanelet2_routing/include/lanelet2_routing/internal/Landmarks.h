@@ -0,0 +1,225 @@
+#pragma once
+#include <boost/graph/graph_traits.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "../Exceptions.h"
+
+namespace lanelet {
+namespace routing {
+namespace internal {
+
+/** @brief Routing costs from and to a few landmark vertices of a graph (ALT, see Goldberg and Harrelson, "Computing the
+ *  shortest path: A* search meets graph theory").
+ *
+ *  By the triangle inequality, cost(v, w) >= cost(l, w) - cost(l, v) and cost(v, w) >= cost(v, l) - cost(w, l) for
+ *  every landmark l. The largest of these bounds is a consistent estimation of the remaining cost for the A* search.
+ *  The bounds are only valid for the graph (and filter) the costs were computed on. */
+class Landmarks {
+ public:
+  Landmarks() = default;
+
+  /** @brief Selects the landmarks one by one at the vertex farthest from the landmarks selected so far and computes
+   *  the costs from and to them. Each landmark takes two Dijkstra searches over the whole graph. */
+  template <typename G>
+  static Landmarks compute(const G& graph, size_t numLandmarks) {
+    Landmarks result;
+    result.numVertices_ = boost::num_vertices(graph);
+    if (result.numVertices_ == 0) {
+      return result;
+    }
+    auto hasEdges = [&graph](size_t v) {
+      return boost::out_edges(v, graph).first != boost::out_edges(v, graph).second ||
+             boost::in_edges(v, graph).first != boost::in_edges(v, graph).second;
+    };
+    // the first landmark is the vertex farthest from an arbitrary vertex
+    size_t next = 0;
+    while (next + 1 < result.numVertices_ && !hasEdges(next)) {
+      ++next;
+    }
+    next = farthest(dijkstra(graph, next, true));
+    // cost from and back to the closest landmark so far (or one way only if there is no way back)
+    std::vector<double> closest(result.numVertices_, std::numeric_limits<double>::infinity());
+    std::vector<std::vector<double>> costsFrom;
+    std::vector<std::vector<double>> costsTo;
+    while (costsFrom.size() < numLandmarks) {
+      costsFrom.push_back(dijkstra(graph, next, true));
+      costsTo.push_back(dijkstra(graph, next, false));
+      result.landmarks_.push_back(next);
+      bool found = false;
+      double maxCost = 0.;
+      for (size_t v = 0; v < result.numVertices_; ++v) {
+        auto from = costsFrom.back()[v];
+        auto to = costsTo.back()[v];
+        auto cost = std::isfinite(from) && std::isfinite(to) ? from + to : std::isfinite(from) ? from : to;
+        closest[v] = std::min(closest[v], cost);
+        if (!hasEdges(v) || (found && !std::isfinite(maxCost))) {
+          continue;
+        }
+        // vertices that are not connected to any landmark yet come first
+        if (closest[v] > maxCost) {
+          found = true;
+          maxCost = closest[v];
+          next = v;
+        }
+      }
+      if (!found) {
+        break;  // every vertex with edges is a landmark
+      }
+    }
+    auto numLandmarksFound = result.landmarks_.size();
+    result.costFrom_.resize(result.numVertices_ * numLandmarksFound);
+    result.costTo_.resize(result.numVertices_ * numLandmarksFound);
+    for (size_t v = 0; v < result.numVertices_; ++v) {
+      for (size_t l = 0; l < numLandmarksFound; ++l) {
+        result.costFrom_[v * numLandmarksFound + l] = costsFrom[l][v];
+        result.costTo_[v * numLandmarksFound + l] = costsTo[l][v];
+      }
+    }
+    return result;
+  }
+
+  //! Lower bound of the routing cost from one vertex to another. Zero if the landmarks give no bound.
+  double lowerBound(size_t from, size_t to) const {
+    auto numLandmarks = landmarks_.size();
+    const double* costFromLandmarkToFrom = costFrom_.data() + from * numLandmarks;
+    const double* costFromLandmarkToTo = costFrom_.data() + to * numLandmarks;
+    const double* costFromFromToLandmark = costTo_.data() + from * numLandmarks;
+    const double* costFromToToLandmark = costTo_.data() + to * numLandmarks;
+    double bound = 0.;
+    for (size_t l = 0; l < numLandmarks; ++l) {
+      if (std::isfinite(costFromLandmarkToFrom[l]) && std::isfinite(costFromLandmarkToTo[l])) {
+        bound = std::max(bound, costFromLandmarkToTo[l] - costFromLandmarkToFrom[l]);
+      }
+      if (std::isfinite(costFromFromToLandmark[l]) && std::isfinite(costFromToToLandmark[l])) {
+        bound = std::max(bound, costFromFromToLandmark[l] - costFromToToLandmark[l]);
+      }
+    }
+    return bound;
+  }
+
+  inline const std::vector<size_t>& landmarks() const noexcept { return landmarks_; }
+  inline size_t numVertices() const noexcept { return numVertices_; }
+
+  //! Writes the landmarks in a binary format for the same platform
+  void write(std::ostream& out) const {
+    writeValue(out, std::uint64_t(numVertices_));
+    writeValue(out, std::uint64_t(landmarks_.size()));
+    for (auto landmark : landmarks_) {
+      writeValue(out, std::uint64_t(landmark));
+    }
+    out.write(reinterpret_cast<const char*>(costFrom_.data()), std::streamsize(costFrom_.size() * sizeof(double)));
+    out.write(reinterpret_cast<const char*>(costTo_.data()), std::streamsize(costTo_.size() * sizeof(double)));
+  }
+
+  /** @brief Reads landmarks written by write for a graph with numVertices vertices. Throws a RoutingGraphError if they
+   *  were written for a different number of vertices or the stream ends too early. The sizes are checked before the
+   *  cost arrays are allocated, so a corrupt file can not make them arbitrarily large. */
+  static Landmarks read(std::istream& in, size_t numVertices) {
+    Landmarks result;
+    result.numVertices_ = size_t(readValue<std::uint64_t>(in));
+    if (result.numVertices_ != numVertices) {
+      throw RoutingGraphError("Landmarks were computed for a different number of vertices");
+    }
+    auto numLandmarks = size_t(readValue<std::uint64_t>(in));
+    if (numLandmarks > numVertices) {
+      throw RoutingGraphError("Invalid number of landmarks");
+    }
+    for (size_t l = 0; l < numLandmarks; ++l) {
+      auto landmark = size_t(readValue<std::uint64_t>(in));
+      if (landmark >= result.numVertices_) {
+        throw RoutingGraphError("Invalid landmark vertex");
+      }
+      result.landmarks_.push_back(landmark);
+    }
+    result.costFrom_.resize(result.numVertices_ * numLandmarks);
+    result.costTo_.resize(result.numVertices_ * numLandmarks);
+    auto numBytes = std::streamsize(result.costFrom_.size() * sizeof(double));
+    in.read(reinterpret_cast<char*>(result.costFrom_.data()), numBytes);
+    in.read(reinterpret_cast<char*>(result.costTo_.data()), numBytes);
+    if (!in) {
+      throw RoutingGraphError("Landmark data ended unexpectedly");
+    }
+    return result;
+  }
+
+  template <typename T>
+  static void writeValue(std::ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  static T readValue(std::istream& in) {
+    T value{};
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    if (!in) {
+      throw RoutingGraphError("Landmark data ended unexpectedly");
+    }
+    return value;
+  }
+
+ private:
+  //! Costs of the cheapest paths from (or to, if not forward) a vertex to all vertices, infinity where there is none
+  template <typename G>
+  static std::vector<double> dijkstra(const G& graph, size_t source, bool forward) {
+    using QueueEntry = std::pair<double, size_t>;
+    std::vector<double> cost(boost::num_vertices(graph), std::numeric_limits<double>::infinity());
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<>> queue;
+    cost[source] = 0.;
+    queue.emplace(0., source);
+    auto relax = [&](size_t v, size_t w, double edgeCost) {
+      if (cost[v] + edgeCost < cost[w]) {
+        cost[w] = cost[v] + edgeCost;
+        queue.emplace(cost[w], w);
+      }
+    };
+    while (!queue.empty()) {
+      auto top = queue.top();
+      queue.pop();
+      auto v = top.second;
+      if (top.first > cost[v]) {
+        continue;
+      }
+      if (forward) {
+        for (auto e : boost::make_iterator_range(boost::out_edges(v, graph))) {
+          relax(v, boost::target(e, graph), graph[e].routingCost);
+        }
+      } else {
+        for (auto e : boost::make_iterator_range(boost::in_edges(v, graph))) {
+          relax(v, boost::source(e, graph), graph[e].routingCost);
+        }
+      }
+    }
+    return cost;
+  }
+
+  //! Vertex with the highest finite cost
+  static size_t farthest(const std::vector<double>& cost) {
+    size_t result = 0;
+    double maxCost = -1.;
+    for (size_t v = 0; v < cost.size(); ++v) {
+      if (std::isfinite(cost[v]) && cost[v] > maxCost) {
+        maxCost = cost[v];
+        result = v;
+      }
+    }
+    return result;
+  }
+
+  size_t numVertices_{0};
+  std::vector<size_t> landmarks_;
+  std::vector<double> costFrom_;  //!< Cost from each landmark to a vertex, the landmarks of a vertex side by side
+  std::vector<double> costTo_;    //!< Cost from a vertex to each landmark, the landmarks of a vertex side by side
+};
+
+}  // namespace internal
+}  // namespace routing
+}  // namespace lanelet
@@ -2,9 +2,17 @@
 #include <boost/graph/dijkstra_shortest_paths_no_color_map.hpp>
 #include <boost/graph/filtered_graph.hpp>
 #include <boost/property_map/property_map.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
 #include "Exceptions.h"
 #include "Graph.h"
 #include "GraphUtils.h"
+#include "Landmarks.h"
 
 namespace lanelet {
 namespace routing {
@@ -133,6 +141,148 @@ class DijkstraStyleSearch {
   DijkstraSearchMapType vertices_;
 };
 
+/** @brief Shortest path search between two vertices that stops once the path is known, without exploring the rest of
+ *  the graph.
+ *
+ *  The cost still to go to the goal is estimated with the straight line distance between the vertex positions, scaled
+ *  by a cost per distance that never overestimates the cost of an edge (see RoutingGraphGraph::costPerDistance), or
+ *  with the bound given by the landmarks if that is higher. The estimation is consistent, so A* settles each vertex
+ *  only once and the bidirectional search may use the average of the estimations of the two directions. A cost per
+ *  distance of zero and no landmarks give the Dijkstra search. */
+template <typename G>
+class GoalDirectedSearch {
+ public:
+  using VertexType = typename boost::graph_traits<G>::vertex_descriptor;
+
+  GoalDirectedSearch(const G& graph, double costPerDistance, const Landmarks* landmarks = nullptr)
+      : graph_{graph}, costPerDistance_{costPerDistance}, landmarks_{landmarks} {}
+
+  //! Searches from start towards goal. Returns the vertices of the shortest path, or nothing if there is no path.
+  std::vector<VertexType> aStar(VertexType start, VertexType goal) {
+    Direction forward{boost::num_vertices(graph_)};
+    auto estimate = [&](VertexType v) { return lowerBound(v, goal); };
+    forward.push(start, start, 0., estimate(start));
+    while (!forward.queue.empty()) {
+      auto v = forward.pop();
+      if (v == goal) {
+        return forward.pathTo(goal);
+      }
+      for (auto e : boost::make_iterator_range(boost::out_edges(v, graph_))) {
+        auto w = boost::target(e, graph_);
+        auto cost = forward.cost[v] + graph_[e].routingCost;
+        if (cost < forward.cost[w]) {
+          forward.push(w, v, cost, cost + estimate(w));
+        }
+      }
+    }
+    return {};
+  }
+
+  //! Searches from start and from goal in turn until the searches meet. Returns the vertices of the shortest path, or
+  //! nothing if there is no path.
+  std::vector<VertexType> bidirectional(VertexType start, VertexType goal) {
+    if (start == goal) {
+      return {start};
+    }
+    auto numVertices = boost::num_vertices(graph_);
+    Direction forward{numVertices};
+    Direction backward{numVertices};
+    // the forward search uses p(v), the backward search -p(v). Both are consistent, so the search can stop when the
+    // smallest keys add up to the best path found (see Ikeda et al., "A fast algorithm for finding better routes by AI
+    // search techniques")
+    auto potential = [&](VertexType v) { return (lowerBound(v, goal) - lowerBound(start, v)) / 2; };
+    forward.push(start, start, 0., potential(start));
+    backward.push(goal, goal, 0., -potential(goal));
+    auto best = std::numeric_limits<double>::infinity();
+    auto meeting = start;
+    while (!forward.queue.empty() && !backward.queue.empty() &&
+           forward.queue.top().key + backward.queue.top().key < best) {
+      auto isForward = forward.queue.top().key <= backward.queue.top().key;
+      auto& search = isForward ? forward : backward;
+      auto& other = isForward ? backward : forward;
+      auto v = search.pop();
+      if (v == (isForward ? goal : start)) {
+        continue;  // reached the other end, the path was found by relaxing the edge to it
+      }
+      auto relax = [&](VertexType w, double edgeCost) {
+        auto cost = search.cost[v] + edgeCost;
+        if (cost < search.cost[w]) {
+          search.push(w, v, cost, cost + (isForward ? potential(w) : -potential(w)));
+          if (cost + other.cost[w] < best) {
+            best = cost + other.cost[w];
+            meeting = w;
+          }
+        }
+      };
+      if (isForward) {
+        for (auto e : boost::make_iterator_range(boost::out_edges(v, graph_))) {
+          relax(boost::target(e, graph_), graph_[e].routingCost);
+        }
+      } else {
+        for (auto e : boost::make_iterator_range(boost::in_edges(v, graph_))) {
+          relax(boost::source(e, graph_), graph_[e].routingCost);
+        }
+      }
+    }
+    if (!std::isfinite(best)) {
+      return {};
+    }
+    auto path = forward.pathTo(meeting);
+    auto rest = backward.pathTo(meeting);
+    path.insert(path.end(), rest.rbegin() + 1, rest.rend());
+    return path;
+  }
+
+ private:
+  struct QueueEntry {
+    double key;
+    double cost;
+    VertexType vertex;
+    bool operator>(const QueueEntry& other) const { return key > other.key; }
+  };
+
+  //! State of the search from one end. Entries of the queue are not removed when a shorter path is found, they are
+  //! skipped when they come up.
+  struct Direction {
+    explicit Direction(size_t numVertices)
+        : cost(numVertices, std::numeric_limits<double>::infinity()), predecessor(numVertices) {}
+    void push(VertexType v, VertexType from, double c, double key) {
+      cost[v] = c;
+      predecessor[v] = from;
+      queue.push(QueueEntry{key, c, v});
+    }
+    VertexType pop() {
+      auto v = queue.top().vertex;
+      queue.pop();
+      while (!queue.empty() && queue.top().cost > cost[queue.top().vertex]) {
+        queue.pop();
+      }
+      return v;
+    }
+    std::vector<VertexType> pathTo(VertexType v) const {
+      std::vector<VertexType> path{v};
+      while (predecessor[v] != v) {
+        v = predecessor[v];
+        path.push_back(v);
+      }
+      std::reverse(path.begin(), path.end());
+      return path;
+    }
+    std::vector<double> cost;
+    std::vector<VertexType> predecessor;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<>> queue;
+  };
+
+  double lowerBound(VertexType v, VertexType w) const {
+    auto bound = costPerDistance_ > 0. ? costPerDistance_ * (graph_[v].position - graph_[w].position).norm() : 0.;
+    return landmarks_ != nullptr ? std::max(bound, landmarks_->lowerBound(v, w)) : bound;
+  }
+
+  const G& graph_;
+  double costPerDistance_;
+  const Landmarks* landmarks_;
+};
+
 }  // namespace internal
 }  // namespace routing
 }  // namespace lanelet
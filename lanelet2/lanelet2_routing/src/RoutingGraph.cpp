@@ -9,6 +9,8 @@
 #include <algorithm>
 #include <boost/graph/reverse_graph.hpp>
 #include <cassert>  // Asserts
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include <queue>
 #include <utility>
@@ -70,6 +72,35 @@ struct MoreLaneChanges {
   }
 };
 
+//! Start of a file written by RoutingGraph::exportLandmarks
+constexpr char LandmarksFileTag[8] = {'L', 'L', '2', 'L', 'M', 'R', 'K', '\0'};
+constexpr std::uint32_t LandmarksFileVersion = 1;
+
+//! Hash of the lanelets and edges of a graph, to make sure that imported landmarks belong to it
+std::uint64_t graphFingerprint(const RoutingGraphGraph& graph) {
+  std::uint64_t hash = 14695981039346656037ULL;  // 64 bit FNV-1a
+  auto add = [&hash](auto value) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+    for (size_t i = 0; i < sizeof(value); ++i) {
+      hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+  };
+  const auto& g = graph.get();
+  add(std::uint64_t(boost::num_vertices(g)));
+  for (auto v : boost::make_iterator_range(boost::vertices(g))) {
+    add(std::int64_t(g[v].laneletOrArea.id()));
+    add(std::uint8_t(g[v].laneletOrArea.isLanelet() && g[v].laneletOrArea.lanelet()->inverted()));
+  }
+  for (auto e : boost::make_iterator_range(boost::edges(g))) {
+    add(std::uint64_t(boost::source(e, g)));
+    add(std::uint64_t(boost::target(e, g)));
+    add(std::uint16_t(g[e].costId));
+    add(RelationUnderlyingType(g[e].relation));
+    add(g[e].routingCost);
+  }
+  return hash;
+}
+
 /** @brief Simple helper function to combine shortest paths */
 bool addToPath(ConstLanelets& path, const Optional<LaneletPath>& newElements) {
   if (newElements) {
@@ -310,26 +341,33 @@ Optional<Route> RoutingGraph::getRouteVia(const ConstLanelet& from, const ConstL
 }
 
 Optional<LaneletPath> RoutingGraph::shortestPath(const ConstLanelet& from, const ConstLanelet& to,
-                                                 RoutingCostId routingCostId, bool withLaneChanges) const {
+                                                 RoutingCostId routingCostId, bool withLaneChanges,
+                                                 ShortestPathAlgorithm algorithm) const {
   auto startVertex = graph_->getVertex(from);
   auto endVertex = graph_->getVertex(to);
   if (!startVertex || !endVertex) {
     return {};
   }
   auto graph = withLaneChanges ? graph_->withLaneChanges(routingCostId) : graph_->withoutLaneChanges(routingCostId);
-  DijkstraStyleSearch<FilteredRoutingGraph> search(graph);
-  class DestinationReached {};
-  try {
-    search.query(*startVertex, [endVertex](const internal::VertexVisitInformation& i) {
-      if (i.vertex == *endVertex) {
-        throw DestinationReached{};
-      }
-      return true;
-    });
-  } catch (DestinationReached) {
-    return LaneletPath{buildPath<false, ConstLanelet>(search.getMap(), *endVertex, graph)};
+  auto relations = withLaneChanges ? RelationType::Successor | RelationType::Left | RelationType::Right
+                                   : RelationType::Successor;
+  auto costPerDistance =
+      algorithm == ShortestPathAlgorithm::Dijkstra ? 0. : graph_->costPerDistance(routingCostId, relations);
+  auto landmarks =
+      algorithm == ShortestPathAlgorithm::Dijkstra ? nullptr : graph_->landmarks(routingCostId, withLaneChanges);
+  internal::GoalDirectedSearch<FilteredRoutingGraph> search(graph, costPerDistance, landmarks);
+  auto vertices = algorithm == ShortestPathAlgorithm::BidirectionalAStar
+                      ? search.bidirectional(*startVertex, *endVertex)
+                      : search.aStar(*startVertex, *endVertex);
+  if (vertices.empty()) {
+    return {};
   }
-  return {};
+  ConstLanelets path;
+  path.reserve(vertices.size());
+  for (auto vertex : vertices) {
+    path.push_back(static_cast<ConstLanelet>(graph[vertex].laneletOrArea));
+  }
+  return LaneletPath{path};
 }
 
 Optional<LaneletPath> RoutingGraph::shortestPathVia(const ConstLanelet& start, const ConstLanelets& via,
@@ -350,6 +388,15 @@ Optional<LaneletPath> RoutingGraph::shortestPathVia(const ConstLanelet& start, c
   return LaneletPath(path);
 }
 
+void RoutingGraph::precomputeLandmarks(RoutingCostId routingCostId, bool withLaneChanges, size_t numLandmarks) {
+  if (routingCostId >= graph_->numRoutingCosts()) {
+    throw InvalidInputError("Routing Cost ID is higher than the number of routing modules.");
+  }
+  auto graph = withLaneChanges ? graph_->withLaneChanges(routingCostId) : graph_->withoutLaneChanges(routingCostId);
+  graph_->landmarks()[std::make_pair(routingCostId, withLaneChanges)] =
+      internal::Landmarks::compute(graph, numLandmarks);
+}
+
 Optional<RelationType> RoutingGraph::routingRelation(const ConstLanelet& from, const ConstLanelet& to,
                                                      bool includeConflicting) const {
   auto edgeInfo = includeConflicting ? graph_->getEdgeInfo(from, to)
@@ -658,6 +705,55 @@ void RoutingGraph::exportGraphML(const std::string& filename, const RelationType
   internal::exportGraphMLImpl<GraphType>(filename, graph_->get(), relations, routingCostId);
 }
 
+void RoutingGraph::exportLandmarks(const std::string& filename) const {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw ExportError("Could not open file at " + filename + ".");
+  }
+  file.write(LandmarksFileTag, sizeof(LandmarksFileTag));
+  internal::Landmarks::writeValue(file, LandmarksFileVersion);
+  internal::Landmarks::writeValue(file, graphFingerprint(*graph_));
+  internal::Landmarks::writeValue(file, std::uint64_t(graph_->landmarks().size()));
+  for (auto& landmarks : graph_->landmarks()) {
+    internal::Landmarks::writeValue(file, std::uint16_t(landmarks.first.first));
+    internal::Landmarks::writeValue(file, std::uint8_t(landmarks.first.second));
+    landmarks.second.write(file);
+  }
+  if (!file) {
+    throw ExportError("Could not write landmarks to " + filename + ".");
+  }
+}
+
+void RoutingGraph::importLandmarks(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw RoutingGraphError("Could not open file at " + filename + ".");
+  }
+  char tag[sizeof(LandmarksFileTag)];
+  file.read(tag, sizeof(tag));
+  if (!file || std::memcmp(tag, LandmarksFileTag, sizeof(tag)) != 0 ||
+      internal::Landmarks::readValue<std::uint32_t>(file) != LandmarksFileVersion) {
+    throw RoutingGraphError(filename + " is not a landmark file of this version.");
+  }
+  if (internal::Landmarks::readValue<std::uint64_t>(file) != graphFingerprint(*graph_)) {
+    throw RoutingGraphError("The landmarks in " + filename + " were computed for a different routing graph.");
+  }
+  auto numEntries = internal::Landmarks::readValue<std::uint64_t>(file);
+  RoutingGraphGraph::LandmarksMap landmarks;
+  for (std::uint64_t entry = 0; entry < numEntries; ++entry) {
+    auto routingCostId = RoutingCostId(internal::Landmarks::readValue<std::uint16_t>(file));
+    auto withLaneChanges = internal::Landmarks::readValue<std::uint8_t>(file) != 0;
+    if (routingCostId >= graph_->numRoutingCosts()) {
+      throw RoutingGraphError("The landmarks in " + filename + " were computed for a different routing graph.");
+    }
+    auto entryLandmarks = internal::Landmarks::read(file, boost::num_vertices(graph_->get()));
+    landmarks[std::make_pair(routingCostId, withLaneChanges)] = std::move(entryLandmarks);
+  }
+  for (auto& entry : landmarks) {
+    graph_->landmarks()[entry.first] = std::move(entry.second);
+  }
+}
+
 void RoutingGraph::exportGraphViz(const std::string& filename, const RelationType& edgeTypesToExclude,
                                   RoutingCostId routingCostId) const {
   if (filename.empty()) {
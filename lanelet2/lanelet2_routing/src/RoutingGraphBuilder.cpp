@@ -2,6 +2,8 @@
 #include <lanelet2_core/LaneletMap.h>
 #include <lanelet2_core/geometry/Area.h>
 #include <lanelet2_core/geometry/Lanelet.h>
+#include <lanelet2_core/geometry/LineString.h>
+#include <limits>
 #include <unordered_map>
 #include "Exceptions.h"
 #include "RoutingGraph.h"
@@ -12,6 +14,20 @@ namespace routing {
 namespace internal {
 namespace {
 inline IdPair orderedIdPair(const Id id1, const Id id2) { return (id1 < id2) ? IdPair(id1, id2) : IdPair(id2, id1); }
+
+inline BasicPoint2d centerlineMiddle(const ConstLanelet& ll) {
+  auto centerline = ll.centerline2d();
+  if (centerline.empty()) {
+    return BasicPoint2d{std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()};
+  }
+  return geometry::interpolatedPointAtDistance(centerline, geometry::length(centerline) / 2);
+}
+
+inline BasicPoint2d areaCentroid(const ConstArea& ar) {
+  BasicPoint2d centroid;
+  boost::geometry::centroid(utils::toHybrid(utils::to2D(ar.outerBoundPolygon())), centroid);
+  return centroid;
+}
 }  // namespace
 
 //! This class collects lane changable lanelets and combines them to a sequence of adjacent lanechangable lanelets
@@ -97,6 +113,7 @@ RoutingGraphUPtr RoutingGraphBuilder::build(const LaneletMapLayers& laneletMapLa
   addAreasToGraph(passableAreas);
   addEdges(passableLanelets, passableMap->laneletLayer);
   addEdges(passableAreas, passableMap->laneletLayer, passableMap->areaLayer);
+  graph_->computeCostPerDistance();
   return std::make_unique<RoutingGraph>(std::move(graph_), std::move(passableMap));
 }
 
@@ -131,14 +148,14 @@ void RoutingGraphBuilder::appendBidirectionalLanelets(ConstLanelets& llts) {
 
 void RoutingGraphBuilder::addLaneletsToGraph(ConstLanelets& llts) {
   for (auto& ll : llts) {
-    graph_->addVertex(VertexInfo{ll});
+    graph_->addVertex(VertexInfo{ll, centerlineMiddle(ll)});
     addPointsToSearchIndex(ll);
   }
 }
 
 void RoutingGraphBuilder::addAreasToGraph(ConstAreas& areas) {
   for (auto& ar : areas) {
-    graph_->addVertex(VertexInfo{ar});
+    graph_->addVertex(VertexInfo{ar, areaCentroid(ar)});
   }
 }
 
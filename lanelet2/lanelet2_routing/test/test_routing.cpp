@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <lanelet2_core/geometry/Lanelet.h>
 #include <lanelet2_core/primitives/LaneletSequence.h>
 #include <sched.h>
 #include <algorithm>
@@ -63,6 +64,19 @@ TEST(DijkstraSearch, onSimpleGraph) {
   }
 }
 
+TEST(GoalDirectedSearch, onSimpleGraph) {  // NOLINT
+  auto g = getSimpleGraph();
+  GoalDirectedSearch<GraphType> search(g, 0.);
+  std::vector<GraphType::vertex_descriptor> expPath{0, 1, 4, 5};
+  EXPECT_EQ(search.aStar(0, 5), expPath);
+  EXPECT_EQ(search.bidirectional(0, 5), expPath);
+  expPath = {3};
+  EXPECT_EQ(search.aStar(3, 3), expPath);
+  EXPECT_EQ(search.bidirectional(3, 3), expPath);
+  EXPECT_TRUE(search.aStar(5, 0).empty());
+  EXPECT_TRUE(search.bidirectional(5, 0).empty());
+}
+
 TEST_F(GermanPedestrianGraph, NumberOfLanelets) {  // NOLINT
   EXPECT_EQ(graph->passableSubmap()->laneletLayer.size(), 5ul);
   EXPECT_TRUE(graph->passableSubmap()->laneletLayer.exists(2031));
@@ -145,6 +159,42 @@ TEST_F(GermanVehicleGraph, GetShortestPathInvalid) {  // NOLINT
   EXPECT_THROW(graph->shortestPath(lanelets.at(2001), lanelets.at(2004), numCostModules), InvalidInputError);  // NOLINT
 }
 
+TEST_F(GermanVehicleGraph, GetShortestPathAlgorithms) {  // NOLINT
+  // cost of a path for the distance routing cost module
+  auto pathCost = [&](const LaneletPath& path) {
+    double cost = 0.;
+    for (size_t i = 1; i < path.size(); ++i) {
+      auto relation = graph->routingRelation(path[i - 1], path[i]);
+      EXPECT_TRUE(!!relation);
+      cost += *relation == RelationType::Successor ? (geometry::approximatedLength2d(path[i - 1]) +
+                                                      geometry::approximatedLength2d(path[i])) /
+                                                         2
+                                                   : testData.laneChangeCost;
+    }
+    return cost;
+  };
+  for (const auto& from : graph->passableSubmap()->laneletLayer) {
+    for (const auto& to : graph->passableSubmap()->laneletLayer) {
+      for (auto withLaneChanges : {true, false}) {
+        auto dijkstra = graph->shortestPath(from, to, 0, withLaneChanges, ShortestPathAlgorithm::Dijkstra);
+        auto aStar = graph->shortestPath(from, to, 0, withLaneChanges, ShortestPathAlgorithm::AStar);
+        auto bidirectional =
+            graph->shortestPath(from, to, 0, withLaneChanges, ShortestPathAlgorithm::BidirectionalAStar);
+        ASSERT_EQ(!!dijkstra, !!aStar) << from.id() << " " << to.id();
+        ASSERT_EQ(!!dijkstra, !!bidirectional) << from.id() << " " << to.id();
+        if (!!dijkstra) {
+          EXPECT_EQ(aStar->front(), from);
+          EXPECT_EQ(aStar->back(), to);
+          EXPECT_EQ(bidirectional->front(), from);
+          EXPECT_EQ(bidirectional->back(), to);
+          EXPECT_NEAR(pathCost(*dijkstra), pathCost(*aStar), 1e-9) << from.id() << " " << to.id();
+          EXPECT_NEAR(pathCost(*dijkstra), pathCost(*bidirectional), 1e-9) << from.id() << " " << to.id();
+        }
+      }
+    }
+  }
+}
+
 TEST_F(GermanVehicleGraph, GetShortestPathVia1) {  // NOLINT
   // Multiple1
   ConstLanelets interm;
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include <lanelet2_core/LaneletMap.h>
+#include <lanelet2_core/geometry/Lanelet.h>
+#include <lanelet2_traffic_rules/TrafficRulesFactory.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include "Exceptions.h"
+#include "RoutingGraph.h"
+
+using namespace lanelet;
+using namespace lanelet::routing;
+
+namespace {
+/** @brief A grid of intersections with a lane in each direction between neighboring intersections. Inside each
+ *  intersection, a lanelet leads from each incoming lane to each outgoing lane except the one going back.
+ *  @param size Number of intersections along x and y. 80 gives about 100000 lanelets. */
+LaneletMapPtr makeGridCity(int size, double blockLength = 100., double laneWidth = 3.5, double intersectionSize = 20.) {
+  const double a = intersectionSize / 2;
+  const BasicPoint2d sides[] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};  // direction from the center to each side
+  Id id = 1;
+  // points of the start (out) and end (in) of the lanes at each side of each intersection, as (left, right)
+  std::vector<std::pair<Point3d, Point3d>> gatesOut;
+  std::vector<std::pair<Point3d, Point3d>> gatesIn;
+  auto gate = [&](int x, int y, int side) { return (x * size + y) * 4 + side; };
+  auto hasRoad = [&](int x, int y, int side) {
+    return side == 0 ? x + 1 < size : side == 1 ? y + 1 < size : side == 2 ? x > 0 : y > 0;
+  };
+  for (int x = 0; x < size; ++x) {
+    for (int y = 0; y < size; ++y) {
+      for (auto& u : sides) {
+        BasicPoint2d center{x * blockLength, y * blockLength};
+        BasicPoint2d n{-u.y(), u.x()};
+        BasicPoint2d middle = center + a * u;
+        BasicPoint2d rightOut = middle - laneWidth * n;
+        BasicPoint2d rightIn = middle + laneWidth * n;
+        gatesOut.emplace_back(Point3d(id, middle.x(), middle.y(), 0), Point3d(id + 1, rightOut.x(), rightOut.y(), 0));
+        gatesIn.emplace_back(Point3d(id + 2, middle.x(), middle.y(), 0), Point3d(id + 3, rightIn.x(), rightIn.y(), 0));
+        id += 4;
+      }
+    }
+  }
+  Lanelets lanelets;
+  auto addLanelet = [&](const std::pair<Point3d, Point3d>& from, const std::pair<Point3d, Point3d>& to) {
+    Lanelet ll(id, LineString3d(id + 1, {from.first, to.first}), LineString3d(id + 2, {from.second, to.second}));
+    ll.setAttribute(AttributeName::Subtype, AttributeValueString::Road);
+    lanelets.push_back(ll);
+    id += 3;
+  };
+  for (int x = 0; x < size; ++x) {
+    for (int y = 0; y < size; ++y) {
+      // roads to the next intersections along x and y, in both directions
+      if (x + 1 < size) {
+        addLanelet(gatesOut[gate(x, y, 0)], gatesIn[gate(x + 1, y, 2)]);
+        addLanelet(gatesOut[gate(x + 1, y, 2)], gatesIn[gate(x, y, 0)]);
+      }
+      if (y + 1 < size) {
+        addLanelet(gatesOut[gate(x, y, 1)], gatesIn[gate(x, y + 1, 3)]);
+        addLanelet(gatesOut[gate(x, y + 1, 3)], gatesIn[gate(x, y, 1)]);
+      }
+      // turns and straight through the intersection, there is no road at the sides on the border of the city
+      for (int in = 0; in < 4; ++in) {
+        for (int out = 0; out < 4; ++out) {
+          if (in != out && hasRoad(x, y, in) && hasRoad(x, y, out)) {
+            addLanelet(gatesIn[gate(x, y, in)], gatesOut[gate(x, y, out)]);
+          }
+        }
+      }
+    }
+  }
+  return utils::createMap(lanelets);
+}
+
+RoutingGraphUPtr makeGridCityGraph(LaneletMap& map) {
+  auto trafficRules = traffic_rules::TrafficRulesFactory::create(Locations::Germany, Participants::Vehicle);
+  return RoutingGraph::build(map, *trafficRules);
+}
+
+double pathLength(const LaneletPath& path) {
+  double length = 0.;
+  for (auto& ll : path) {
+    length += geometry::approximatedLength2d(ll);
+  }
+  return length;
+}
+
+//! The distance cost of a path is its length minus half of the first and the last lanelet
+double pathCost(const LaneletPath& path) {
+  return pathLength(path) -
+         (geometry::approximatedLength2d(path.front()) + geometry::approximatedLength2d(path.back())) / 2;
+}
+
+//! Compares the cost of the paths found by the different algorithms for random pairs of lanelets
+void testShortestPathCosts(const LaneletMap& map, const RoutingGraph& graph, bool withLaneChanges) {
+  std::mt19937 random(0);
+  std::uniform_int_distribution<size_t> pick(0, map.laneletLayer.size() - 1);
+  std::vector<ConstLanelet> lanelets(map.laneletLayer.begin(), map.laneletLayer.end());
+  for (int i = 0; i < 200; ++i) {
+    auto& from = lanelets[pick(random)];
+    auto& to = lanelets[pick(random)];
+    auto dijkstra = graph.shortestPath(from, to, 0, withLaneChanges, ShortestPathAlgorithm::Dijkstra);
+    auto aStar = graph.shortestPath(from, to, 0, withLaneChanges, ShortestPathAlgorithm::AStar);
+    auto bidirectional = graph.shortestPath(from, to, 0, withLaneChanges, ShortestPathAlgorithm::BidirectionalAStar);
+    ASSERT_TRUE(!!dijkstra);
+    ASSERT_TRUE(!!aStar);
+    ASSERT_TRUE(!!bidirectional);
+    EXPECT_NEAR(pathCost(*dijkstra), pathCost(*aStar), 1e-6) << from.id() << " " << to.id();
+    EXPECT_NEAR(pathCost(*dijkstra), pathCost(*bidirectional), 1e-6) << from.id() << " " << to.id();
+    EXPECT_EQ(aStar->front(), from);
+    EXPECT_EQ(aStar->back(), to);
+    EXPECT_EQ(bidirectional->front(), from);
+    EXPECT_EQ(bidirectional->back(), to);
+  }
+}
+}  // namespace
+
+TEST(GridCity, ShortestPathAlgorithmsFindTheSameCost) {  // NOLINT
+  auto map = makeGridCity(6);
+  auto graph = makeGridCityGraph(*map);
+  testShortestPathCosts(*map, *graph, true);
+}
+
+TEST(GridCity, LandmarksKeepShortestPaths) {  // NOLINT
+  auto map = makeGridCity(6);
+  auto graph = makeGridCityGraph(*map);
+  graph->precomputeLandmarks(0, true, 4);
+  graph->precomputeLandmarks(0, false, 4);
+  testShortestPathCosts(*map, *graph, true);
+  testShortestPathCosts(*map, *graph, false);
+}
+
+TEST(GridCity, LandmarksExportImport) {  // NOLINT
+  auto map = makeGridCity(4);
+  auto graph = makeGridCityGraph(*map);
+  graph->precomputeLandmarks(0, true, 4);
+  auto filename = std::string(std::tmpnam(nullptr)) + ".landmarks";  // NOLINT
+  graph->exportLandmarks(filename);
+
+  auto importingGraph = makeGridCityGraph(*map);
+  EXPECT_NO_THROW(importingGraph->importLandmarks(filename));  // NOLINT
+  testShortestPathCosts(*map, *importingGraph, true);
+
+  auto otherMap = makeGridCity(3);
+  auto otherGraph = makeGridCityGraph(*otherMap);
+  EXPECT_THROW(otherGraph->importLandmarks(filename), RoutingGraphError);                 // NOLINT
+  EXPECT_THROW(importingGraph->importLandmarks(filename + ".missing"), RoutingGraphError);  // NOLINT
+  std::remove(filename.c_str());
+}
+
+TEST(GridCity, LandmarksImportRejectsCorruptSizes) {  // NOLINT
+  auto map = makeGridCity(3);
+  auto graph = makeGridCityGraph(*map);
+  graph->precomputeLandmarks(0, true, 4);
+  auto filename = std::string(std::tmpnam(nullptr)) + ".landmarks";  // NOLINT
+  graph->exportLandmarks(filename);
+
+  // The number of vertices and of landmarks of the first entry follow the tag, version, fingerprint, number of
+  // entries, routing cost id and lane change flag
+  const std::streamoff numVerticesPos = 8 + 4 + 8 + 8 + 2 + 1;
+  auto overwrite = [&filename](std::streamoff pos, std::uint64_t value) {
+    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(pos);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  overwrite(numVerticesPos, std::uint64_t(1) << 60);
+  EXPECT_THROW(graph->importLandmarks(filename), RoutingGraphError);  // NOLINT
+
+  graph->exportLandmarks(filename);
+  overwrite(numVerticesPos + 8, std::uint64_t(1) << 60);
+  EXPECT_THROW(graph->importLandmarks(filename), RoutingGraphError);  // NOLINT
+  std::remove(filename.c_str());
+}
+
+// Time of the shortest path search from a corner of a grid city of about 100000 lanelets to lanelets along the border
+// and across the city, without and with landmarks. Run with --gtest_also_run_disabled_tests.
+TEST(GridCity, DISABLED_ShortestPathBenchmark) {  // NOLINT
+  const int size = 80;
+  typedef std::chrono::steady_clock Clock;
+  auto start = Clock::now();
+  auto map = makeGridCity(size);
+  auto graph = makeGridCityGraph(*map);
+  std::printf("%zu lanelets, graph built in %.1f s\n", map->laneletLayer.size(),
+              std::chrono::duration<double>(Clock::now() - start).count());
+
+  auto from = map->laneletLayer.nearest(BasicPoint2d(0, -5), 1).front();
+  // along a road, where the air-line distance is a good estimate, and diagonally across the grid, where it is not
+  const BasicPoint2d goals[] = {{2000, -5}, {7900, -5}, {2000, 2005}, {7900, 7905}};
+  const char* names[] = {"Dijkstra", "A*", "bidirectional A*"};
+  auto timeSearches = [&](const char* suffix) {
+    for (auto& goal : goals) {
+      auto to = map->laneletLayer.nearest(goal, 1).front();
+      for (auto algorithm :
+           {ShortestPathAlgorithm::Dijkstra, ShortestPathAlgorithm::AStar, ShortestPathAlgorithm::BidirectionalAStar}) {
+        const int repetitions = 3;
+        Optional<LaneletPath> path;
+        auto searchStart = Clock::now();
+        for (int repetition = 0; repetition < repetitions; ++repetition) {
+          path = graph->shortestPath(from, to, 0, true, algorithm);
+        }
+        auto time = std::chrono::duration<double>(Clock::now() - searchStart).count() / repetitions;
+        ASSERT_TRUE(!!path);
+        std::printf("goal at (%.0f, %.0f) m, %s%s: %.3f ms, %zu lanelets, %.0f m\n", goal.x(), goal.y(),
+                    names[static_cast<int>(algorithm)], suffix, time * 1e3, path->size(), pathLength(*path));
+      }
+    }
+  };
+  timeSearches("");
+
+  start = Clock::now();
+  graph->precomputeLandmarks();
+  std::printf("landmarks computed in %.1f s\n", std::chrono::duration<double>(Clock::now() - start).count());
+  timeSearches(" with landmarks");
+}